@@ -0,0 +1,26 @@
+// Hand-written equivalent of examples/collatz.rh
+#include <inttypes.h>
+#include <stdio.h>
+
+static int64_t steps(int64_t n) {
+	int64_t count = 0;
+	while (n != 1) {
+		if (n % 2 == 0) n = n / 2;
+		else n = 3 * n + 1;
+		count++;
+	}
+	return count;
+}
+
+int main(void) {
+	int64_t best = 0, best_n = 1;
+	for (int64_t n = 1; n < 1000000; n++) {
+		int64_t s = steps(n);
+		if (s > best) {
+			best = s;
+			best_n = n;
+		}
+	}
+	printf("%" PRId64 " %" PRId64 "\n", best_n, best);
+	return 0;
+}
@@ -0,0 +1,30 @@
+// Hand-written equivalent of examples/mandelbrot.rh
+#include <inttypes.h>
+#include <stdio.h>
+
+static int64_t escape_time(double cr, double ci, int64_t limit) {
+	double zr = 0.0, zi = 0.0;
+	int64_t n = 0;
+	while (n < limit && zr * zr + zi * zi <= 4.0) {
+		double t = zr * zr - zi * zi + cr;
+		zi = 2.0 * zr * zi + ci;
+		zr = t;
+		n++;
+	}
+	return n;
+}
+
+int main(void) {
+	int64_t size = 1000, total = 0, inside = 0;
+	for (int64_t y = 0; y < size; y++) {
+		double ci = 2.0 * y / size - 1.0;
+		for (int64_t x = 0; x < size; x++) {
+			double cr = 3.0 * x / size - 2.0;
+			int64_t n = escape_time(cr, ci, 200);
+			total += n;
+			if (n == 200) inside++;
+		}
+	}
+	printf("%" PRId64 " %" PRId64 "\n", total, inside);
+	return 0;
+}
@@ -0,0 +1,34 @@
+// Hand-written equivalent of examples/matmul.rh
+#include <stdio.h>
+
+#define N 128
+
+static void fill(double m[N][N], long seed) {
+	for (long i = 0; i < N; i++) {
+		for (long j = 0; j < N; j++) m[i][j] = (double) ((i * seed + j * 7) % 19 - 9);
+	}
+}
+
+static void multiply(double (*restrict c)[N], double (*a)[N], double (*b)[N]) {
+	for (long i = 0; i < N; i++) {
+		for (long j = 0; j < N; j++) c[i][j] = 0.0;
+		for (long k = 0; k < N; k++) {
+			double aik = a[i][k];
+			for (long j = 0; j < N; j++) c[i][j] += aik * b[k][j];
+		}
+	}
+}
+
+int main(void) {
+	static double a[N][N], b[N][N], c[N][N];
+	fill(a, 3);
+	fill(b, 5);
+	double total = 0.0;
+	for (long round = 0; round < 100; round++) {
+		multiply(c, a, b);
+		total += c[round][127 - round];
+		a[round][round] = c[round][round] / 1000.0;
+	}
+	printf("%g %g %g\n", total, c[5][7], c[127][0]);
+	return 0;
+}
@@ -0,0 +1,32 @@
+// Hand-written equivalent of examples/particles.rh
+#include <stdio.h>
+
+typedef struct { double x, y; } Vec;
+typedef struct { Vec position, velocity; double mass; } Particle;
+
+static void step(Particle* restrict p, Vec center, double dt) {
+	double k = 4.0 / p->mass;
+	Vec force = { (center.x - p->position.x) * k, (center.y - p->position.y) * k };
+	p->velocity.x += force.x * dt;
+	p->velocity.y += force.y * dt;
+	p->position.x += p->velocity.x * dt;
+	p->position.y += p->velocity.y * dt;
+}
+
+int main(void) {
+	Particle particles[64];
+	for (int i = 0; i < 64; i++) {
+		particles[i] = (Particle) { { i * 1.0, 64.0 - i }, { 0.0, 0.0 }, 1.0 + i % 4 };
+	}
+	Vec center = { 32.0, 32.0 };
+	for (long t = 0; t < 1000000; t++) {
+		for (int i = 0; i < 64; i++) step(&particles[i], center, 0.001);
+	}
+	double energy = 0.0;
+	for (int i = 0; i < 64; i++) {
+		Particle* p = &particles[i];
+		energy += 0.5 * p->mass * (p->velocity.x * p->velocity.x + p->velocity.y * p->velocity.y);
+	}
+	printf("%g %g %g\n", energy, particles[3].position.x, particles[60].velocity.y);
+	return 0;
+}
@@ -0,0 +1,28 @@
+// Hand-written equivalent of examples/saxpy.rh
+#include <stdio.h>
+
+#define N 4096
+
+static void saxpy(double* restrict y, const double* x, long n, double a) {
+	for (long i = 0; i < n; i++) y[i] = y[i] + a * x[i];
+}
+
+static double dot(const double* x, const double* y, long n) {
+	double s = 0.0;
+	for (long i = 0; i < n; i++) s += x[i] * y[i];
+	return s;
+}
+
+int main(void) {
+	static double x[N], y[N];
+	for (long i = 0; i < N; i++) {
+		x[i] = i % 13 * 0.25;
+		y[i] = i % 7 * 0.5;
+	}
+	for (long round = 0; round < 20000; round++) {
+		saxpy(y, x, N, 0.0001);
+		saxpy(x, y, N, -0.0001);
+	}
+	printf("%g %g %g\n", dot(x, y, N), x[100], y[4000]);
+	return 0;
+}
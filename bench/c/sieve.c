@@ -0,0 +1,31 @@
+// Hand-written equivalent of examples/sieve.rh
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#define N 2000000
+
+int main(void) {
+	static bool composite[N];
+	for (int64_t i = 2; i < N; i++) {
+		if (composite[i]) continue;
+		for (int64_t j = i * i; j < N; j += i) composite[j] = true;
+	}
+	int64_t count = 0, sevens = 0, sum = 0;
+	for (int64_t n = 2; n < N; n++) {
+		if (composite[n]) continue;
+		count++;
+		sum += n;
+		if (n % 10 == 7) sevens++;
+	}
+	// The first gap between primes of more than 100
+	int64_t gap = 0;
+	for (int64_t n = 2; n < N && !gap; n++) {
+		if (composite[n]) continue;
+		int64_t m = n + 1;
+		while (m < N && composite[m]) m++;
+		if (m < N && m - n > 100) gap = n;
+	}
+	printf("%" PRId64 " %" PRId64 " %" PRId64 " %" PRId64 " %d\n", count, sum, sevens, gap, 10);
+	return 0;
+}
@@ -0,0 +1,62 @@
+#!/usr/bin/env python3
+"""Times the examples as built by the C backend against hand-written C doing the same.
+
+Usage: bench/c_backend.py [COMPILER] [--cc gcc] [--cflags '-O3 -march=native -fwrapv'] [--runs N] [NAME...]
+Each examples/NAME.rh is written as C with --emit-c, and it and bench/c/NAME.c are built with
+the same C compiler and flags. Both must print the same; the best wall time of each over the
+runs is given, with the generated code's time relative to the hand-written code's.
+"""
+
+import argparse
+import os
+import shlex
+import subprocess
+import tempfile
+import time
+
+def build(cc, cflags, source, binary):
+    result = subprocess.run([cc, *cflags, '-o', binary, source, '-lm'], capture_output=True)
+    if result.returncode != 0:
+        raise SystemExit(f'{source} failed to build\n{result.stderr.decode()[-2000:]}')
+
+def best_time(binary, runs):
+    best, output = float('inf'), None
+    for _ in range(runs):
+        start = time.perf_counter()
+        result = subprocess.run([binary], capture_output=True)
+        best = min(best, time.perf_counter() - start)
+        output = result.stdout.decode()
+    return best, output
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    examples = os.path.join(here, '..', 'examples')
+    ap = argparse.ArgumentParser()
+    ap.add_argument('compiler', nargs='?', default=os.path.join(here, '..', 'compiler'))
+    ap.add_argument('--cc', default='gcc')
+    ap.add_argument('--cflags', default='-std=c11 -O3 -march=native -fwrapv')
+    ap.add_argument('--runs', type=int, default=5)
+    ap.add_argument('names', nargs='*')
+    args = ap.parse_args()
+    names = args.names or sorted(f[:-2] for f in os.listdir(os.path.join(here, 'c')) if f.endswith('.c'))
+    cflags = shlex.split(args.cflags)
+
+    print(f'{args.cc} {args.cflags}, best of {args.runs}')
+    print(f'{"example":12} {"C":>10} {"generated":>10}  ratio')
+    with tempfile.TemporaryDirectory() as tmp:
+        for name in names:
+            generated = os.path.join(tmp, f'{name}.c')
+            with open(generated, 'w') as f:
+                result = subprocess.run([args.compiler, '--emit-c', os.path.join(examples, f'{name}.rh')], stdout=f, stderr=subprocess.PIPE)
+            if result.returncode != 0:
+                raise SystemExit(f'{name}.rh failed to compile\n{result.stderr.decode()[-2000:]}')
+            build(args.cc, cflags, generated, os.path.join(tmp, name))
+            build(args.cc, cflags, os.path.join(here, 'c', f'{name}.c'), os.path.join(tmp, f'{name}.hand'))
+            hand, expected = best_time(os.path.join(tmp, f'{name}.hand'), args.runs)
+            ours, output = best_time(os.path.join(tmp, name), args.runs)
+            if output != expected:
+                raise SystemExit(f'{name}: the generated code printed {output!r}, where the hand-written code printed {expected!r}')
+            print(f'{name:12} {hand * 1e3:8.1f}ms {ours * 1e3:8.1f}ms  {ours / hand:5.2f}x')
+
+if __name__ == '__main__':
+    main()
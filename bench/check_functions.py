@@ -0,0 +1,76 @@
+#!/usr/bin/env python3
+"""Times type checking of one module of many functions with different numbers of threads.
+
+Usage: bench/check_functions.py [COMPILER] [--functions N] [--runs N] [--jobs 1,2,4,8]
+The module is written to a temporary directory and checked with --quiet --check --jobs N; the
+best time the compiler reports for the module over the runs is given for each number of jobs,
+along with the speedup over the first.
+"""
+
+import argparse
+import os
+import re
+import subprocess
+import tempfile
+
+def module(n_funcs):
+    lines = [
+        'struct Point {',
+        '\tx, y: Float',
+        '\tweight: Int = 1',
+        '}',
+        '',
+        'const SCALE = 3',
+        '',
+    ]
+    for f in range(n_funcs):
+        # Bodies of a few sizes, so that an even split of them isn't an even split of the work
+        size = 1 + (f * 7919) % 7
+        callee = f'work{(f * 31) % n_funcs}'
+        lines.append(f'func work{f}(n: Int, p: Point, scale: Float = 1.5): Float {{')
+        lines.append('\ttotal := 0.0')
+        lines.append('\tcount := n * SCALE')
+        for i in range(size):
+            lines.append(f'\tfor i{i}: 0..<count {{')
+            lines.append(f'\t\tq{i} := Point(p.x * scale + i{i}, p.y - {i}.5)')
+            lines.append(f'\t\tif q{i}.x > q{i}.y and i{i} % {i + 2} == 0 {{')
+            lines.append(f'\t\t\ttotal += q{i}.x * q{i}.weight')
+            lines.append('\t\t}')
+            lines.append(f'\t\telse {{')
+            lines.append(f'\t\t\ttotal -= {callee}(i{i}, q{i}) / (scale + 1)')
+            lines.append('\t\t}')
+            lines.append('\t}')
+        lines.append('\treturn total')
+        lines.append('}')
+        lines.append('')
+    return '\n'.join(lines)
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    ap = argparse.ArgumentParser()
+    ap.add_argument('compiler', nargs='?', default=os.path.join(here, '..', 'compiler'))
+    ap.add_argument('--functions', type=int, default=10000)
+    ap.add_argument('--runs', type=int, default=5)
+    ap.add_argument('--jobs', default='1,2,4,8')
+    args = ap.parse_args()
+
+    with tempfile.TemporaryDirectory() as tmp:
+        path = os.path.join(tmp, 'functions.rh')
+        with open(path, 'w') as f:
+            f.write(module(args.functions))
+        size = os.path.getsize(path)
+        print(f'{args.functions} functions, {size / 1e6:.2f} MB, {os.cpu_count()} processors')
+        baseline = None
+        for jobs in (int(j) for j in args.jobs.split(',')):
+            best = float('inf')
+            for _ in range(args.runs):
+                result = subprocess.run([args.compiler, '--quiet', '--check', '--jobs', str(jobs), path], capture_output=True)
+                stderr = result.stderr.decode()
+                if result.returncode != 0:
+                    raise SystemExit(f'check failed\n{stderr[-2000:]}')
+                best = min(best, float(re.search(r'type errors \(([\d.]+) ms\)', stderr).group(1)))
+            baseline = baseline or best
+            print(f'{jobs:3} jobs  {best:8.1f} ms  {baseline / best:5.2f}x')
+
+if __name__ == '__main__':
+    main()
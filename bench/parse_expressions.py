@@ -0,0 +1,102 @@
+#!/usr/bin/env python3
+"""Times the parser on synthetic, expression-heavy sources.
+
+Usage: bench/parse_expressions.py [COMPILER] [--runs N]
+Each case is written to a temporary directory and parsed with --quiet; the best CPU time of N runs
+is reported.
+"""
+
+import argparse
+import os
+import resource
+import subprocess
+import tempfile
+
+OPERATORS = ['+', '-', '*', '/', '%', '^', '&', '|', '**', '+%']
+
+def arithmetic_chains(n_funcs=2000, chain_len=60):
+    lines = []
+    for f in range(n_funcs):
+        terms = []
+        for i in range(chain_len):
+            terms.append(f'x{i % 7}' if i % 3 else str(i))
+            terms.append(OPERATORS[(f + i) % len(OPERATORS)])
+        terms.pop()
+        lines.append(f'func chain{f}(x0: Int, x1: Int, x2: Int, x3: Int, x4: Int, x5: Int, x6: Int): Int {{')
+        lines.append(f'\ta := {" ".join(terms)}')
+        lines.append(f'\tb := (a + x1) * (a - x2) / (x3 + 1) \\max x4 if a > x5 and b != x6 else -a')
+        lines.append('\treturn a + b')
+        lines.append('}')
+    return '\n'.join(lines) + '\n'
+
+def nested_calls(n_funcs=2000, depth=40):
+    lines = []
+    for f in range(n_funcs):
+        expr = 'x'
+        for d in range(depth):
+            expr = f'g{d % 5}({expr}, {d})' if d % 2 else f'h({expr})[{d}].field'
+        lines.append(f'func nested{f}(x: Int): Int {{')
+        lines.append(f'\treturn {expr}')
+        lines.append('}')
+    return '\n'.join(lines) + '\n'
+
+def parenthesized(n_funcs=2000, depth=40):
+    lines = []
+    for f in range(n_funcs):
+        expr = 'x'
+        for d in range(depth):
+            expr = f'({expr} * {d} + y)'
+        lines.append(f'func parens{f}(x: Int, y: Int): Int {{')
+        lines.append(f'\treturn {expr}')
+        lines.append('}')
+    return '\n'.join(lines) + '\n'
+
+# A few expressions nested thousands of levels deep, for comparison against the flat cases above
+
+def deep_arrays(n_funcs=20, depth=10000):
+    expr = '[' * depth + '0' + ', 1]' * depth
+    return ''.join(f'func arrays{f}(): Int {{\n\ta := {expr}\n}}\n' for f in range(n_funcs))
+
+def deep_calls(n_funcs=20, depth=10000):
+    expr = 'g(' * depth + 'x' + ', 1)' * depth
+    return ''.join(f'func calls{f}(x: Int): Int {{\n\treturn {expr}\n}}\n' for f in range(n_funcs))
+
+def deep_exponents(n_funcs=20, depth=10000):
+    expr = ' ^ '.join(f'x{d % 7}' for d in range(depth))
+    return ''.join(f'func exponents{f}(x: Int): Int {{\n\treturn {expr}\n}}\n' for f in range(n_funcs))
+
+CASES = {
+    'arithmetic chains': arithmetic_chains,
+    'nested calls': nested_calls,
+    'parenthesized': parenthesized,
+    'deep arrays': deep_arrays,
+    'deep calls': deep_calls,
+    'deep exponents': deep_exponents,
+}
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    ap = argparse.ArgumentParser()
+    ap.add_argument('compiler', nargs='?', default=os.path.join(here, '..', 'compiler'))
+    ap.add_argument('--runs', type=int, default=5)
+    args = ap.parse_args()
+
+    with tempfile.TemporaryDirectory() as tmp:
+        for name, make in CASES.items():
+            path = os.path.join(tmp, name.replace(' ', '_') + '.rh')
+            with open(path, 'w') as f:
+                f.write(make())
+            size = os.path.getsize(path)
+            best = float('inf')
+            for _ in range(args.runs):
+                before = resource.getrusage(resource.RUSAGE_CHILDREN)
+                result = subprocess.run([args.compiler, '--quiet', path], capture_output=True)
+                after = resource.getrusage(resource.RUSAGE_CHILDREN)
+                cpu = (after.ru_utime - before.ru_utime) + (after.ru_stime - before.ru_stime)
+                best = min(best, cpu)
+                if result.returncode != 0:
+                    raise SystemExit(f'{name}: parse failed\n{result.stderr.decode()[-2000:]}')
+            print(f'{name:20} {size / 1e6:6.2f} MB  {best * 1e3:8.1f} ms  {size / best / 1e6:6.1f} MB/s')
+
+if __name__ == '__main__':
+    main()
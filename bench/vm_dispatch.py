@@ -0,0 +1,52 @@
+#!/usr/bin/env python3
+"""Times the bytecode VM on the programs in bench/vm, to track its dispatch overhead.
+
+Usage: bench/vm_dispatch.py [COMPILER] [--runs N] [NAME...]
+Each bench/vm/NAME.rh is run with --run --no-jit, which reports the instructions it
+dispatched and the time it took. The best of the runs is given, in millions of instructions a
+second and nanoseconds an instruction, then the best time with hot functions compiled to
+machine code by the JIT, which must print the same.
+"""
+
+import argparse
+import os
+import re
+import subprocess
+
+STATS = re.compile(r': (\d+) instructions in ([\d.]+) ms')
+
+def run(compiler, source, jit):
+    result = subprocess.run([compiler, '--run', source] + ([] if jit else ['--no-jit']), capture_output=True)
+    stderr = result.stderr.decode()
+    stats = STATS.search(stderr)
+    if result.returncode != 0 or not stats:
+        raise SystemExit(f'{source} failed to run\n{stderr[-2000:]}')
+    return int(stats.group(1)), float(stats.group(2)), result.stdout.decode()
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    ap = argparse.ArgumentParser()
+    ap.add_argument('compiler', nargs='?', default=os.path.join(here, '..', 'compiler'))
+    ap.add_argument('--runs', type=int, default=5)
+    ap.add_argument('names', nargs='*')
+    args = ap.parse_args()
+    names = args.names or sorted(f[:-3] for f in os.listdir(os.path.join(here, 'vm')) if f.endswith('.rh'))
+
+    print(f'best of {args.runs}')
+    print(f'{"program":12} {"instructions":>14} {"time":>10} {"M/s":>8} {"ns each":>8} {"with JIT":>10} {"speedup":>8}')
+    for name in names:
+        source = os.path.join(here, 'vm', f'{name}.rh')
+        best, jit_best, instructions, output = float('inf'), float('inf'), 0, None
+        for _ in range(args.runs):
+            instructions, ms, printed = run(args.compiler, source, False)
+            _, jit_ms, jit_printed = run(args.compiler, source, True)
+            for p in (printed, jit_printed):
+                if output is not None and p != output:
+                    raise SystemExit(f'{name}: printed {p!r}, then {output!r}')
+                output = p
+            best, jit_best = min(best, ms), min(jit_best, jit_ms)
+        print(f'{name:12} {instructions:14,} {best:8.1f}ms {instructions / best / 1e3:8.1f} {best * 1e6 / instructions:8.2f}'
+              f' {jit_best:8.1f}ms {best / jit_best:7.1f}x')
+
+if __name__ == '__main__':
+    main()
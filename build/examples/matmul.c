@@ -0,0 +1,240 @@
+// Generated from /root/repo/examples/matmul.rh. Integers wrap, so build with -fwrapv.
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __GNUC__
+#define RH_ASSUME(c) do { if (!(c)) __builtin_unreachable(); } while (0)
+#define RH_UNLIKELY(c) __builtin_expect(!!(c), 0)
+#define RH_UNUSED __attribute__((unused))
+#else
+#define RH_ASSUME(c) ((void) 0)
+#define RH_UNLIKELY(c) (c)
+#define RH_UNUSED
+#endif
+
+typedef struct { const char* data; int64_t len; } rh_string;
+#define RH_STR(s) ((rh_string) { (s), sizeof(s) - 1 })
+#define RH_STR_INIT(s) { (s), sizeof(s) - 1 }
+
+static inline _Noreturn void rh_fail(const char* file, int line, const char* what, rh_string message) {
+	fflush(stdout);
+	fprintf(stderr, "%s:%d: %s%s%.*s\n", file, line, what, message.len? ": " : "", (int) message.len, message.data? message.data : "");
+	exit(1);
+}
+
+static inline _Noreturn void rh_index_error(int64_t start, int64_t end, int64_t n, const char* file, int line) {
+	fflush(stdout);
+	if (end < 0) fprintf(stderr, "%s:%d: Index %" PRId64 " is out of bounds for length %" PRId64 "\n", file, line, start, n);
+	else fprintf(stderr, "%s:%d: Slice %" PRId64 "..<%" PRId64 " is out of bounds for length %" PRId64 "\n", file, line, start, end, n);
+	exit(1);
+}
+
+static inline int64_t rh_check(int64_t i, int64_t n, const char* file, int line) {
+	if (RH_UNLIKELY((uint64_t) i >= (uint64_t) n)) rh_index_error(i, -1, n, file, line);
+	return i;
+}
+
+// The start of a slice from start to before end
+static inline int64_t rh_check_slice(int64_t start, int64_t end, int64_t n, const char* file, int line) {
+	if (RH_UNLIKELY(start < 0 || end < start || end > n)) rh_index_error(start, end, n, file, line);
+	return start;
+}
+
+static inline int rh_string_cmp(rh_string a, rh_string b) {
+	int order = a.len && b.len? memcmp(a.data, b.data, a.len < b.len? a.len : b.len) : 0;
+	return order? order : (a.len > b.len) - (a.len < b.len);
+}
+
+static inline bool rh_string_eq(rh_string a, rh_string b) {
+	return a.len == b.len && rh_string_cmp(a, b) == 0;
+}
+
+// Integers wrap, as they do at compile time
+static inline uint64_t rh_upow(uint64_t base, uint64_t e) {
+	uint64_t result = 1;
+	for (; e; e >>= 1, base *= base) {
+		if (e & 1) result *= base;
+	}
+	return result;
+}
+
+static inline int64_t rh_ipow(int64_t base, int64_t e) {
+	return (int64_t) rh_upow((uint64_t) base, (uint64_t) e);
+}
+
+static inline double rh_pow(double a, double b) { return pow(a, b); }
+static inline float rh_powf(float a, float b) { return powf(a, b); }
+static inline double rh_fmod(double a, double b) { return fmod(a, b); }
+static inline float rh_fmodf(float a, float b) { return fmodf(a, b); }
+
+// The builtins min, max, abs and the shifts; shifts by 64 or more leave 0, or the sign
+static inline int64_t rh_min(int64_t a, int64_t b) { return a < b? a : b; }
+static inline int64_t rh_max(int64_t a, int64_t b) { return a > b? a : b; }
+static inline uint64_t rh_umin(uint64_t a, uint64_t b) { return a < b? a : b; }
+static inline uint64_t rh_umax(uint64_t a, uint64_t b) { return a > b? a : b; }
+static inline int64_t rh_abs(int64_t a) { return a < 0? (int64_t) (0 - (uint64_t) a) : a; }
+static inline uint64_t rh_shl(uint64_t a, uint64_t n) { return n < 64? a << n : 0; }
+static inline int64_t rh_shr(int64_t a, uint64_t n) { return n < 64? a >> n : a >> 63; }
+static inline uint64_t rh_ushr(uint64_t a, uint64_t n) { return n < 64? a >> n : 0; }
+
+// The primary allocator
+static inline void* rh_alloc(size_t size) {
+	void* p = calloc(1, size? size : 1);
+	if (!p) {
+		fputs("Out of memory\n", stderr);
+		exit(1);
+	}
+	return p;
+}
+
+static inline void* rh_copy(void* to, const void* from, size_t size) {
+	return memcpy(to, from, size);
+}
+
+static inline void rh_free(void* p) { free(p); }
+
+// The temporary allocator of the thread, a stack: functions give back what they took of it when
+// they return. What doesn't fit is taken from the primary allocator, and never given back.
+#define RH_TEMP_SIZE ((size_t) 64 << 20)
+static _Thread_local char* rh_temp_base;
+static _Thread_local size_t rh_temp_used;
+
+static inline size_t rh_temp_mark(void) { return rh_temp_used; }
+static inline void rh_temp_release(size_t mark) { rh_temp_used = mark; }
+
+static inline void* rh_temp_alloc(size_t size) {
+	if (!rh_temp_base) rh_temp_base = rh_alloc(RH_TEMP_SIZE);
+	size = (size + 15) & ~(size_t) 15;
+	if (size > RH_TEMP_SIZE - rh_temp_used) return rh_alloc(size);
+	void* p = rh_temp_base + rh_temp_used;
+	rh_temp_used += size;
+	return memset(p, 0, size);
+}
+
+static inline void rh_print_text(const char* text) { fputs(text, stdout); }
+static inline void rh_print_int(int64_t x) { printf("%" PRId64, x); }
+static inline void rh_print_uint(uint64_t x) { printf("%" PRIu64, x); }
+static inline void rh_print_float(double x) { printf("%g", x); }
+static inline void rh_print_bool(bool x) { fputs(x? "true" : "false", stdout); }
+static inline void rh_print_string(rh_string s) { fwrite(s.data, 1, (size_t) s.len, stdout); }
+
+static inline void rh_print_rune(int32_t r) {
+	char utf8[4];
+	int n = 0;
+	if (r < 0x80) utf8[n++] = (char) r;
+	else if (r < 0x800) {
+		utf8[n++] = (char) (0xC0 | r >> 6);
+		utf8[n++] = (char) (0x80 | (r & 0x3F));
+	}
+	else if (r < 0x10000) {
+		utf8[n++] = (char) (0xE0 | r >> 12);
+		utf8[n++] = (char) (0x80 | (r >> 6 & 0x3F));
+		utf8[n++] = (char) (0x80 | (r & 0x3F));
+	}
+	else {
+		utf8[n++] = (char) (0xF0 | r >> 18);
+		utf8[n++] = (char) (0x80 | (r >> 12 & 0x3F));
+		utf8[n++] = (char) (0x80 | (r >> 6 & 0x3F));
+		utf8[n++] = (char) (0x80 | (r & 0x3F));
+	}
+	fwrite(utf8, 1, n, stdout);
+}
+
+RH_UNUSED static const char rh_src[] = "/root/repo/examples/matmul.rh";
+
+typedef struct { double e[16384]; } rh_array21;
+
+static void rh_main(void);
+static void rh_fill(rh_array21* restrict m, int64_t seed);
+static void rh_multiply(rh_array21* restrict c, rh_array21* a, rh_array21* b);
+
+
+#line 24 "/root/repo/examples/matmul.rh"
+static void rh_main(void) {
+	rh_array21 a = ((rh_array21) { 0 });
+	rh_array21 b = ((rh_array21) { 0 });
+	rh_array21 c = ((rh_array21) { 0 });
+	rh_fill((&a), 3);
+	rh_fill((&b), 5);
+	double total = 0.0;
+	{
+		int64_t rh_end1 = 100;
+		for (int64_t round = 0; round < rh_end1; round++) {
+#line 32 "/root/repo/examples/matmul.rh"
+			rh_multiply((&c), (&a), (&b));
+			total += (c).e[rh_check(round, 128, rh_src, 33) * 128 + rh_check((127 - round), 128, rh_src, 33)];
+			(a).e[(round) * 128 + (round)] = ((c).e[(round) * 128 + (round)] / 1000.0);
+		}
+	}
+#line 36 "/root/repo/examples/matmul.rh"
+	{
+		rh_print_float(total);
+		rh_print_text(" ");
+		rh_print_float((c).e[(5) * 128 + (7)]);
+		rh_print_text(" ");
+		rh_print_float((c).e[(127) * 128 + (0)]);
+		rh_print_text("\n");
+	}
+}
+
+#line 2 "/root/repo/examples/matmul.rh"
+static void rh_fill(rh_array21* restrict m, int64_t seed) {
+	{
+		int64_t rh_end3 = 128;
+		for (int64_t i = 0; i < rh_end3; i++) {
+#line 4 "/root/repo/examples/matmul.rh"
+			{
+				int64_t rh_end5 = 128;
+				for (int64_t j = 0; j < rh_end5; j++) {
+#line 5 "/root/repo/examples/matmul.rh"
+					((*m)).e[(i) * 128 + (j)] = ((((i * seed) + (j * 7)) % 19) - 9);
+				}
+			}
+		}
+	}
+}
+
+#line 10 "/root/repo/examples/matmul.rh"
+static void rh_multiply(rh_array21* restrict c, rh_array21* a, rh_array21* b) {
+	{
+		int64_t rh_end7 = 128;
+		for (int64_t i = 0; i < rh_end7; i++) {
+#line 12 "/root/repo/examples/matmul.rh"
+			{
+				int64_t rh_end9 = 128;
+				for (int64_t j = 0; j < rh_end9; j++) {
+#line 13 "/root/repo/examples/matmul.rh"
+					((*c)).e[(i) * 128 + (j)] = 0.0;
+				}
+			}
+#line 15 "/root/repo/examples/matmul.rh"
+			{
+				int64_t rh_end11 = 128;
+				for (int64_t k = 0; k < rh_end11; k++) {
+#line 16 "/root/repo/examples/matmul.rh"
+					double aik = ((*a)).e[(i) * 128 + (k)];
+					{
+						int64_t rh_end13 = 128;
+						for (int64_t j = 0; j < rh_end13; j++) {
+#line 18 "/root/repo/examples/matmul.rh"
+							((*c)).e[(i) * 128 + (j)] += (aik * ((*b)).e[(k) * 128 + (j)]);
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+int main(void) {
+	rh_main();
+	return 0;
+}
+
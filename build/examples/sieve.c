@@ -0,0 +1,263 @@
+// Generated from /root/repo/examples/sieve.rh. Integers wrap, so build with -fwrapv.
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __GNUC__
+#define RH_ASSUME(c) do { if (!(c)) __builtin_unreachable(); } while (0)
+#define RH_UNLIKELY(c) __builtin_expect(!!(c), 0)
+#define RH_UNUSED __attribute__((unused))
+#else
+#define RH_ASSUME(c) ((void) 0)
+#define RH_UNLIKELY(c) (c)
+#define RH_UNUSED
+#endif
+
+typedef struct { const char* data; int64_t len; } rh_string;
+#define RH_STR(s) ((rh_string) { (s), sizeof(s) - 1 })
+#define RH_STR_INIT(s) { (s), sizeof(s) - 1 }
+
+static inline _Noreturn void rh_fail(const char* file, int line, const char* what, rh_string message) {
+	fflush(stdout);
+	fprintf(stderr, "%s:%d: %s%s%.*s\n", file, line, what, message.len? ": " : "", (int) message.len, message.data? message.data : "");
+	exit(1);
+}
+
+static inline _Noreturn void rh_index_error(int64_t start, int64_t end, int64_t n, const char* file, int line) {
+	fflush(stdout);
+	if (end < 0) fprintf(stderr, "%s:%d: Index %" PRId64 " is out of bounds for length %" PRId64 "\n", file, line, start, n);
+	else fprintf(stderr, "%s:%d: Slice %" PRId64 "..<%" PRId64 " is out of bounds for length %" PRId64 "\n", file, line, start, end, n);
+	exit(1);
+}
+
+static inline int64_t rh_check(int64_t i, int64_t n, const char* file, int line) {
+	if (RH_UNLIKELY((uint64_t) i >= (uint64_t) n)) rh_index_error(i, -1, n, file, line);
+	return i;
+}
+
+// The start of a slice from start to before end
+static inline int64_t rh_check_slice(int64_t start, int64_t end, int64_t n, const char* file, int line) {
+	if (RH_UNLIKELY(start < 0 || end < start || end > n)) rh_index_error(start, end, n, file, line);
+	return start;
+}
+
+static inline int rh_string_cmp(rh_string a, rh_string b) {
+	int order = a.len && b.len? memcmp(a.data, b.data, a.len < b.len? a.len : b.len) : 0;
+	return order? order : (a.len > b.len) - (a.len < b.len);
+}
+
+static inline bool rh_string_eq(rh_string a, rh_string b) {
+	return a.len == b.len && rh_string_cmp(a, b) == 0;
+}
+
+// Integers wrap, as they do at compile time
+static inline uint64_t rh_upow(uint64_t base, uint64_t e) {
+	uint64_t result = 1;
+	for (; e; e >>= 1, base *= base) {
+		if (e & 1) result *= base;
+	}
+	return result;
+}
+
+static inline int64_t rh_ipow(int64_t base, int64_t e) {
+	return (int64_t) rh_upow((uint64_t) base, (uint64_t) e);
+}
+
+static inline double rh_pow(double a, double b) { return pow(a, b); }
+static inline float rh_powf(float a, float b) { return powf(a, b); }
+static inline double rh_fmod(double a, double b) { return fmod(a, b); }
+static inline float rh_fmodf(float a, float b) { return fmodf(a, b); }
+
+// The builtins min, max, abs and the shifts; shifts by 64 or more leave 0, or the sign
+static inline int64_t rh_min(int64_t a, int64_t b) { return a < b? a : b; }
+static inline int64_t rh_max(int64_t a, int64_t b) { return a > b? a : b; }
+static inline uint64_t rh_umin(uint64_t a, uint64_t b) { return a < b? a : b; }
+static inline uint64_t rh_umax(uint64_t a, uint64_t b) { return a > b? a : b; }
+static inline int64_t rh_abs(int64_t a) { return a < 0? (int64_t) (0 - (uint64_t) a) : a; }
+static inline uint64_t rh_shl(uint64_t a, uint64_t n) { return n < 64? a << n : 0; }
+static inline int64_t rh_shr(int64_t a, uint64_t n) { return n < 64? a >> n : a >> 63; }
+static inline uint64_t rh_ushr(uint64_t a, uint64_t n) { return n < 64? a >> n : 0; }
+
+// The primary allocator
+static inline void* rh_alloc(size_t size) {
+	void* p = calloc(1, size? size : 1);
+	if (!p) {
+		fputs("Out of memory\n", stderr);
+		exit(1);
+	}
+	return p;
+}
+
+static inline void* rh_copy(void* to, const void* from, size_t size) {
+	return memcpy(to, from, size);
+}
+
+static inline void rh_free(void* p) { free(p); }
+
+// The temporary allocator of the thread, a stack: functions give back what they took of it when
+// they return. What doesn't fit is taken from the primary allocator, and never given back.
+#define RH_TEMP_SIZE ((size_t) 64 << 20)
+static _Thread_local char* rh_temp_base;
+static _Thread_local size_t rh_temp_used;
+
+static inline size_t rh_temp_mark(void) { return rh_temp_used; }
+static inline void rh_temp_release(size_t mark) { rh_temp_used = mark; }
+
+static inline void* rh_temp_alloc(size_t size) {
+	if (!rh_temp_base) rh_temp_base = rh_alloc(RH_TEMP_SIZE);
+	size = (size + 15) & ~(size_t) 15;
+	if (size > RH_TEMP_SIZE - rh_temp_used) return rh_alloc(size);
+	void* p = rh_temp_base + rh_temp_used;
+	rh_temp_used += size;
+	return memset(p, 0, size);
+}
+
+static inline void rh_print_text(const char* text) { fputs(text, stdout); }
+static inline void rh_print_int(int64_t x) { printf("%" PRId64, x); }
+static inline void rh_print_uint(uint64_t x) { printf("%" PRIu64, x); }
+static inline void rh_print_float(double x) { printf("%g", x); }
+static inline void rh_print_bool(bool x) { fputs(x? "true" : "false", stdout); }
+static inline void rh_print_string(rh_string s) { fwrite(s.data, 1, (size_t) s.len, stdout); }
+
+static inline void rh_print_rune(int32_t r) {
+	char utf8[4];
+	int n = 0;
+	if (r < 0x80) utf8[n++] = (char) r;
+	else if (r < 0x800) {
+		utf8[n++] = (char) (0xC0 | r >> 6);
+		utf8[n++] = (char) (0x80 | (r & 0x3F));
+	}
+	else if (r < 0x10000) {
+		utf8[n++] = (char) (0xE0 | r >> 12);
+		utf8[n++] = (char) (0x80 | (r >> 6 & 0x3F));
+		utf8[n++] = (char) (0x80 | (r & 0x3F));
+	}
+	else {
+		utf8[n++] = (char) (0xF0 | r >> 18);
+		utf8[n++] = (char) (0x80 | (r >> 12 & 0x3F));
+		utf8[n++] = (char) (0x80 | (r >> 6 & 0x3F));
+		utf8[n++] = (char) (0x80 | (r & 0x3F));
+	}
+	fwrite(utf8, 1, n, stdout);
+}
+
+RH_UNUSED static const char rh_src[] = "/root/repo/examples/sieve.rh";
+
+typedef struct { bool e[2000000]; } rh_array25;
+typedef int64_t rh_Digit;
+#define rh_Digit_one ((rh_Digit) 1)
+#define rh_Digit_three ((rh_Digit) 3)
+#define rh_Digit_seven ((rh_Digit) 7)
+#define rh_Digit_nine ((rh_Digit) 9)
+#define rh_Digit_other ((rh_Digit) (rh_Digit_nine + 1))
+
+static void rh_main(void);
+static rh_Digit rh_digit(int64_t n);
+
+
+#line 27 "/root/repo/examples/sieve.rh"
+static void rh_main(void) {
+	rh_array25 composite = ((rh_array25) { 0 });
+	{
+		int64_t rh_end1 = 2000000;
+		for (int64_t i = 2; i < rh_end1; i++) {
+#line 30 "/root/repo/examples/sieve.rh"
+			if ((composite).e[(i)]) {
+				continue;
+			}
+			{
+				int64_t rh_end3 = 2000000;
+				int64_t rh_step3 = i;
+				for (int64_t j = (i * i); rh_step3 > 0? j < rh_end3 : j > rh_end3; j += (int64_t) rh_step3) {
+#line 34 "/root/repo/examples/sieve.rh"
+					(composite).e[rh_check(j, 2000000, rh_src, 34)] = true;
+				}
+			}
+		}
+	}
+#line 37 "/root/repo/examples/sieve.rh"
+	int64_t count = 0;
+	int64_t sevens = 0;
+	int64_t sum = 0;
+	{
+		int64_t rh_end5 = 2000000;
+		for (int64_t n = 2; n < rh_end5; n++) {
+#line 41 "/root/repo/examples/sieve.rh"
+			if ((!(composite).e[(n)])) {
+				count += 1;
+				sum += n;
+				if ((rh_digit(n) == rh_Digit_seven)) {
+					sevens += 1;
+				}
+			}
+		}
+	}
+	int64_t gap = 0;
+	{
+		int64_t rh_end7 = 2000000;
+		for (int64_t n = 2; n < rh_end7; n++) {
+#line 52 "/root/repo/examples/sieve.rh"
+			if ((composite).e[(n)]) {
+				continue;
+			}
+			{
+				int64_t rh_end9 = 2000000;
+				for (int64_t m = (n + 1); m < rh_end9; m++) {
+#line 56 "/root/repo/examples/sieve.rh"
+					if ((!(composite).e[(m)])) {
+						if (((m - n) > 100)) {
+							gap = n;
+							goto rh_break8;
+						}
+						goto rh_skip8;
+					}
+				}
+			}
+			rh_skip8: ;
+		}
+		rh_break8: ;
+	}
+#line 65 "/root/repo/examples/sieve.rh"
+	{
+		rh_print_int(count);
+		rh_print_text(" ");
+		rh_print_int(sum);
+		rh_print_text(" ");
+		rh_print_int(sevens);
+		rh_print_text(" ");
+		rh_print_int(gap);
+		rh_print_text(" ");
+		rh_print_int(rh_Digit_other);
+		rh_print_text("\n");
+	}
+}
+
+#line 10 "/root/repo/examples/sieve.rh"
+static rh_Digit rh_digit(int64_t n) {
+	int64_t d = (n % 10);
+	if ((d == 1)) {
+		return rh_Digit_one;
+	}
+	if ((d == 3)) {
+		return rh_Digit_three;
+	}
+	if ((d == 7)) {
+		return rh_Digit_seven;
+	}
+	if ((d == 9)) {
+		return rh_Digit_nine;
+	}
+	return rh_Digit_other;
+}
+
+int main(void) {
+	rh_main();
+	return 0;
+}
+
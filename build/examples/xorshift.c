@@ -0,0 +1,265 @@
+// Generated from /root/repo/examples/xorshift.rh. Integers wrap, so build with -fwrapv.
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __GNUC__
+#define RH_ASSUME(c) do { if (!(c)) __builtin_unreachable(); } while (0)
+#define RH_UNLIKELY(c) __builtin_expect(!!(c), 0)
+#define RH_UNUSED __attribute__((unused))
+#else
+#define RH_ASSUME(c) ((void) 0)
+#define RH_UNLIKELY(c) (c)
+#define RH_UNUSED
+#endif
+
+typedef struct { const char* data; int64_t len; } rh_string;
+#define RH_STR(s) ((rh_string) { (s), sizeof(s) - 1 })
+#define RH_STR_INIT(s) { (s), sizeof(s) - 1 }
+
+static inline _Noreturn void rh_fail(const char* file, int line, const char* what, rh_string message) {
+	fflush(stdout);
+	fprintf(stderr, "%s:%d: %s%s%.*s\n", file, line, what, message.len? ": " : "", (int) message.len, message.data? message.data : "");
+	exit(1);
+}
+
+static inline _Noreturn void rh_index_error(int64_t start, int64_t end, int64_t n, const char* file, int line) {
+	fflush(stdout);
+	if (end < 0) fprintf(stderr, "%s:%d: Index %" PRId64 " is out of bounds for length %" PRId64 "\n", file, line, start, n);
+	else fprintf(stderr, "%s:%d: Slice %" PRId64 "..<%" PRId64 " is out of bounds for length %" PRId64 "\n", file, line, start, end, n);
+	exit(1);
+}
+
+static inline int64_t rh_check(int64_t i, int64_t n, const char* file, int line) {
+	if (RH_UNLIKELY((uint64_t) i >= (uint64_t) n)) rh_index_error(i, -1, n, file, line);
+	return i;
+}
+
+// The start of a slice from start to before end
+static inline int64_t rh_check_slice(int64_t start, int64_t end, int64_t n, const char* file, int line) {
+	if (RH_UNLIKELY(start < 0 || end < start || end > n)) rh_index_error(start, end, n, file, line);
+	return start;
+}
+
+static inline int rh_string_cmp(rh_string a, rh_string b) {
+	int order = a.len && b.len? memcmp(a.data, b.data, a.len < b.len? a.len : b.len) : 0;
+	return order? order : (a.len > b.len) - (a.len < b.len);
+}
+
+static inline bool rh_string_eq(rh_string a, rh_string b) {
+	return a.len == b.len && rh_string_cmp(a, b) == 0;
+}
+
+// Integers wrap, as they do at compile time
+static inline uint64_t rh_upow(uint64_t base, uint64_t e) {
+	uint64_t result = 1;
+	for (; e; e >>= 1, base *= base) {
+		if (e & 1) result *= base;
+	}
+	return result;
+}
+
+static inline int64_t rh_ipow(int64_t base, int64_t e) {
+	return (int64_t) rh_upow((uint64_t) base, (uint64_t) e);
+}
+
+static inline double rh_pow(double a, double b) { return pow(a, b); }
+static inline float rh_powf(float a, float b) { return powf(a, b); }
+static inline double rh_fmod(double a, double b) { return fmod(a, b); }
+static inline float rh_fmodf(float a, float b) { return fmodf(a, b); }
+
+// The builtins min, max, abs and the shifts; shifts by 64 or more leave 0, or the sign
+static inline int64_t rh_min(int64_t a, int64_t b) { return a < b? a : b; }
+static inline int64_t rh_max(int64_t a, int64_t b) { return a > b? a : b; }
+static inline uint64_t rh_umin(uint64_t a, uint64_t b) { return a < b? a : b; }
+static inline uint64_t rh_umax(uint64_t a, uint64_t b) { return a > b? a : b; }
+static inline int64_t rh_abs(int64_t a) { return a < 0? (int64_t) (0 - (uint64_t) a) : a; }
+static inline uint64_t rh_shl(uint64_t a, uint64_t n) { return n < 64? a << n : 0; }
+static inline int64_t rh_shr(int64_t a, uint64_t n) { return n < 64? a >> n : a >> 63; }
+static inline uint64_t rh_ushr(uint64_t a, uint64_t n) { return n < 64? a >> n : 0; }
+
+// The primary allocator
+static inline void* rh_alloc(size_t size) {
+	void* p = calloc(1, size? size : 1);
+	if (!p) {
+		fputs("Out of memory\n", stderr);
+		exit(1);
+	}
+	return p;
+}
+
+static inline void* rh_copy(void* to, const void* from, size_t size) {
+	return memcpy(to, from, size);
+}
+
+static inline void rh_free(void* p) { free(p); }
+
+// The temporary allocator of the thread, a stack: functions give back what they took of it when
+// they return. What doesn't fit is taken from the primary allocator, and never given back.
+#define RH_TEMP_SIZE ((size_t) 64 << 20)
+static _Thread_local char* rh_temp_base;
+static _Thread_local size_t rh_temp_used;
+
+static inline size_t rh_temp_mark(void) { return rh_temp_used; }
+static inline void rh_temp_release(size_t mark) { rh_temp_used = mark; }
+
+static inline void* rh_temp_alloc(size_t size) {
+	if (!rh_temp_base) rh_temp_base = rh_alloc(RH_TEMP_SIZE);
+	size = (size + 15) & ~(size_t) 15;
+	if (size > RH_TEMP_SIZE - rh_temp_used) return rh_alloc(size);
+	void* p = rh_temp_base + rh_temp_used;
+	rh_temp_used += size;
+	return memset(p, 0, size);
+}
+
+static inline void rh_print_text(const char* text) { fputs(text, stdout); }
+static inline void rh_print_int(int64_t x) { printf("%" PRId64, x); }
+static inline void rh_print_uint(uint64_t x) { printf("%" PRIu64, x); }
+static inline void rh_print_float(double x) { printf("%g", x); }
+static inline void rh_print_bool(bool x) { fputs(x? "true" : "false", stdout); }
+static inline void rh_print_string(rh_string s) { fwrite(s.data, 1, (size_t) s.len, stdout); }
+
+static inline void rh_print_rune(int32_t r) {
+	char utf8[4];
+	int n = 0;
+	if (r < 0x80) utf8[n++] = (char) r;
+	else if (r < 0x800) {
+		utf8[n++] = (char) (0xC0 | r >> 6);
+		utf8[n++] = (char) (0x80 | (r & 0x3F));
+	}
+	else if (r < 0x10000) {
+		utf8[n++] = (char) (0xE0 | r >> 12);
+		utf8[n++] = (char) (0x80 | (r >> 6 & 0x3F));
+		utf8[n++] = (char) (0x80 | (r & 0x3F));
+	}
+	else {
+		utf8[n++] = (char) (0xF0 | r >> 18);
+		utf8[n++] = (char) (0x80 | (r >> 12 & 0x3F));
+		utf8[n++] = (char) (0x80 | (r >> 6 & 0x3F));
+		utf8[n++] = (char) (0x80 | (r & 0x3F));
+	}
+	fwrite(utf8, 1, n, stdout);
+}
+
+RH_UNUSED static const char rh_src[] = "/root/repo/examples/xorshift.rh";
+
+static int64_t rh_main(void);
+static int64_t rh_next(int64_t state);
+static double rh_unit(int64_t x);
+static int64_t rh_bits(int64_t x);
+
+
+#line 21 "/root/repo/examples/xorshift.rh"
+static int64_t rh_main(void) {
+	int64_t state = INT64_C(88172645463325252);
+	int64_t inside = 0;
+	double near = 1.0;
+	double far = 0.0;
+	int64_t ones = 0;
+	{
+		int64_t rh_end1 = 20000000;
+		for (int64_t i = 0; i < rh_end1; i++) {
+#line 28 "/root/repo/examples/xorshift.rh"
+			state = rh_next(state);
+			double px = (rh_unit(state) - 0.5);
+			state = rh_next(state);
+			double py = (rh_unit(state) - 0.5);
+			double d = sqrt(((px * px) + (py * py)));
+			near = fmin(near, d);
+			far = fmax(far, d);
+			if ((d <= 0.5)) {
+				inside += 1;
+			}
+			ones += ((rh_bits(((int64_t) (state | 1))) - rh_bits(((int64_t) ~(state)))) + ((int64_t) rh_abs(((int64_t) rh_min(0, (state % 3))))));
+		}
+	}
+#line 40 "/root/repo/examples/xorshift.rh"
+	{
+		rh_print_float(((4.0 * ((double) inside)) / 20000000.0));
+		rh_print_text(" ");
+		rh_print_float(near);
+		rh_print_text(" ");
+		rh_print_float(far);
+		rh_print_text(" ");
+		rh_print_int(ones);
+		rh_print_text("\n");
+	}
+#line 41 "/root/repo/examples/xorshift.rh"
+	{
+		rh_print_float(floor(-2.5));
+		rh_print_text(" ");
+		rh_print_float(ceil(-2.5));
+		rh_print_text(" ");
+		rh_print_float(fabs(-3.5));
+		rh_print_text(" ");
+		rh_print_float(exp(log(2.0)));
+		rh_print_text(" ");
+		rh_print_float(sin(0.0));
+		rh_print_text(" ");
+		rh_print_float(cos(0.0));
+		rh_print_text(" ");
+		rh_print_float(tan(0.0));
+		rh_print_text("\n");
+	}
+#line 42 "/root/repo/examples/xorshift.rh"
+	{
+		rh_print_int(((int64_t) rh_shl(1, (uint64_t) 64)));
+		rh_print_text(" ");
+		rh_print_int(((int64_t) rh_shr(-8, (uint64_t) 1)));
+		rh_print_text(" ");
+		rh_print_int(((int64_t) rh_shr(-8, (uint64_t) 70)));
+		rh_print_text(" ");
+		rh_print_int(((int8_t) ~(((int8_t) 5))));
+		rh_print_text(" ");
+		rh_print_int(((int8_t) rh_abs(((int8_t) -128))));
+		rh_print_text(" ");
+		rh_print_uint(((uint8_t) rh_shl(((uint8_t) 255), (uint64_t) 4)));
+		rh_print_text("\n");
+	}
+#line 43 "/root/repo/examples/xorshift.rh"
+	{
+		rh_print_float(sqrtf(((float) 2.0)));
+		rh_print_text(" ");
+		rh_print_uint(((uint32_t) rh_umin(((uint32_t) 3), ((uint32_t) INT64_C(4000000000)))));
+		rh_print_text(" ");
+		rh_print_int(((int64_t) rh_max(-7, 7)));
+		rh_print_text("\n");
+	}
+#line 44 "/root/repo/examples/xorshift.rh"
+	return 0;
+}
+
+#line 3 "/root/repo/examples/xorshift.rh"
+static int64_t rh_next(int64_t state) {
+	int64_t x = ((int64_t) (state ^ ((int64_t) rh_shl(state, (uint64_t) 13))));
+	x = ((int64_t) (x ^ ((int64_t) rh_shr(((int64_t) (x & INT64_C(9223372036854775807))), (uint64_t) 7))));
+	return ((int64_t) (x ^ ((int64_t) rh_shl(x, (uint64_t) 17))));
+}
+
+static double rh_unit(int64_t x) {
+	return (((double) ((int64_t) rh_shr(((int64_t) (x & INT64_C(4503599627370495))), (uint64_t) 20))) / 4294967296.0);
+}
+
+static int64_t rh_bits(int64_t x) {
+	int64_t count = 0;
+	{
+		int64_t rh_end3 = 64;
+		for (int64_t i = 0; i < rh_end3; i++) {
+#line 16 "/root/repo/examples/xorshift.rh"
+			count += ((int64_t) (((int64_t) rh_shr(x, (uint64_t) i)) & 1));
+		}
+	}
+#line 18 "/root/repo/examples/xorshift.rh"
+	return count;
+}
+
+int main(void) {
+	return (int) rh_main();
+}
+
@@ -0,0 +1,1679 @@
+static const char* enum_packed_to_json(PackedKind value) {
+	switch (value) {
+		case PACKED_INT: return "\"INT\"";
+		case PACKED_FLOAT: return "\"FLOAT\"";
+		default: return "null";
+	}
+}
+
+static const char* enum_init_to_json(VarInit value) {
+	switch (value) {
+		case INIT_ZERO: return "\"ZERO\"";
+		case INIT_EXPR: return "\"EXPR\"";
+		case INIT_DEFAULT: return "\"DEFAULT\"";
+		case INIT_UNINITIALIZED: return "\"UNINITIALIZED\"";
+		default: return "null";
+	}
+}
+
+static const char* enum_for_to_json(ForMode value) {
+	switch (value) {
+		case FOR_NORMAL: return "\"NORMAL\"";
+		case FOR_PARALLEL: return "\"PARALLEL\"";
+		case FOR_GPU: return "\"GPU\"";
+		default: return "null";
+	}
+}
+
+static const char* enum_contract_to_json(ContractKind value) {
+	switch (value) {
+		default: return "null";
+	}
+}
+
+static bool emit_json_step(Emitter* e, EmitFrame* f, EmitFrame* child) {
+	const AST_Node* node = f->node;
+	if (!node) {
+		EMIT_LITERAL(e, "null");
+		return false;
+	}
+
+	if (!f->step) {
+		switch (node->node_type) {
+			case NODE_AND: EMIT_LITERAL(e, "{\"node\": \"And\""); break;
+			case NODE_ARRAY: EMIT_LITERAL(e, "{\"node\": \"ArrayLiteral\""); break;
+			case NODE_ARRAY_COMP: EMIT_LITERAL(e, "{\"node\": \"ArrayComprehension\""); break;
+			case NODE_ARRAY_RANGE: EMIT_LITERAL(e, "{\"node\": \"ArrayRange\""); break;
+			case NODE_ARRAY_TYPE: EMIT_LITERAL(e, "{\"node\": \"ArrayType\""); break;
+			case NODE_ASSERT: EMIT_LITERAL(e, "{\"node\": \"Assert\""); break;
+			case NODE_ASSIGN: EMIT_LITERAL(e, "{\"node\": \"AssignChain\""); break;
+			case NODE_ASSIGN_MANY: EMIT_LITERAL(e, "{\"node\": \"AssignParallel\""); break;
+			case NODE_ASYNC: EMIT_LITERAL(e, "{\"node\": \"Async\""); break;
+			case NODE_AWAIT: EMIT_LITERAL(e, "{\"node\": \"Await\""); break;
+			case NODE_BINOP: EMIT_LITERAL(e, "{\"node\": \"Binop\""); break;
+			case NODE_BLOCK: EMIT_LITERAL(e, "{\"node\": \"Block\""); break;
+			case NODE_BOOL: EMIT_LITERAL(e, "{\"node\": \"Bool\""); break;
+			case NODE_BREAK: EMIT_LITERAL(e, "{\"node\": \"Break\""); break;
+			case NODE_BROADCAST: EMIT_LITERAL(e, "{\"node\": \"Broadcast\""); break;
+			case NODE_CANCEL: EMIT_LITERAL(e, "{\"node\": \"Cancel\""); break;
+			case NODE_CHAR: EMIT_LITERAL(e, "{\"node\": \"Char\""); break;
+			case NODE_COMPARISON: EMIT_LITERAL(e, "{\"node\": \"ComparisonChain\""); break;
+			case NODE_CONST: EMIT_LITERAL(e, "{\"node\": \"Const\""); break;
+			case NODE_CONTEXT: EMIT_LITERAL(e, "{\"node\": \"Context\""); break;
+			case NODE_CONTRACT: EMIT_LITERAL(e, "{\"node\": \"Contract\""); break;
+			case NODE_DEFER: EMIT_LITERAL(e, "{\"node\": \"Defer\""); break;
+			case NODE_ENUM: EMIT_LITERAL(e, "{\"node\": \"Enum\""); break;
+			case NODE_ENUM_VALUE: EMIT_LITERAL(e, "{\"node\": \"EnumValue\""); break;
+			case NODE_FAIL: EMIT_LITERAL(e, "{\"node\": \"Fail\""); break;
+			case NODE_FIELD: EMIT_LITERAL(e, "{\"node\": \"Field\""); break;
+			case NODE_FIELD_ACCESS: EMIT_LITERAL(e, "{\"node\": \"FieldAccess\""); break;
+			case NODE_FLOAT: EMIT_LITERAL(e, "{\"node\": \"Float\""); break;
+			case NODE_FOR_LOOP: EMIT_LITERAL(e, "{\"node\": \"ForLoop\""); break;
+			case NODE_FOR_PARALLEL: EMIT_LITERAL(e, "{\"node\": \"ForParallel\""); break;
+			case NODE_FOR_RANGE: EMIT_LITERAL(e, "{\"node\": \"ForRange\""); break;
+			case NODE_FOR_SIMPLE: EMIT_LITERAL(e, "{\"node\": \"ForSimple\""); break;
+			case NODE_FUNC_CALL: EMIT_LITERAL(e, "{\"node\": \"FuncCall\""); break;
+			case NODE_FUNC_DEF: EMIT_LITERAL(e, "{\"node\": \"FuncDef\""); break;
+			case NODE_FUNC_OVERLOAD: EMIT_LITERAL(e, "{\"node\": \"FuncOverload\""); break;
+			case NODE_FUNC_TYPE: EMIT_LITERAL(e, "{\"node\": \"FuncType\""); break;
+			case NODE_IF_STMT: EMIT_LITERAL(e, "{\"node\": \"IfStatement\""); break;
+			case NODE_IMPORT: EMIT_LITERAL(e, "{\"node\": \"Import\""); break;
+			case NODE_INT: EMIT_LITERAL(e, "{\"node\": \"Int\""); break;
+			case NODE_MACRO: EMIT_LITERAL(e, "{\"node\": \"Macro\""); break;
+			case NODE_MATCH: EMIT_LITERAL(e, "{\"node\": \"Match\""); break;
+			case NODE_MATCH_CASE: EMIT_LITERAL(e, "{\"node\": \"MatchCase\""); break;
+			case NODE_MODULE: EMIT_LITERAL(e, "{\"node\": \"Module\""); break;
+			case NODE_MUTABLE_TYPE: EMIT_LITERAL(e, "{\"node\": \"MutableType\""); break;
+			case NODE_NAME: EMIT_LITERAL(e, "{\"node\": \"Name\""); break;
+			case NODE_NOT: EMIT_LITERAL(e, "{\"node\": \"Not\""); break;
+			case NODE_NULL: EMIT_LITERAL(e, "{\"node\": \"Null\""); break;
+			case NODE_OPTIONAL_TYPE: EMIT_LITERAL(e, "{\"node\": \"OptionalType\""); break;
+			case NODE_OP_ASSIGN: EMIT_LITERAL(e, "{\"node\": \"OpAssign\""); break;
+			case NODE_OR: EMIT_LITERAL(e, "{\"node\": \"Or\""); break;
+			case NODE_PACKED_ARRAY: EMIT_LITERAL(e, "{\"node\": \"PackedArray\""); break;
+			case NODE_PARAM: EMIT_LITERAL(e, "{\"node\": \"Param\""); break;
+			case NODE_POINTER_TYPE: EMIT_LITERAL(e, "{\"node\": \"PointerType\""); break;
+			case NODE_QUALNAME: EMIT_LITERAL(e, "{\"node\": \"Qualname\""); break;
+			case NODE_REREFERENCE: EMIT_LITERAL(e, "{\"node\": \"Reref\""); break;
+			case NODE_RETURN: EMIT_LITERAL(e, "{\"node\": \"Return\""); break;
+			case NODE_RUN: EMIT_LITERAL(e, "{\"node\": \"Run\""); break;
+			case NODE_SIMPLE_TYPE: EMIT_LITERAL(e, "{\"node\": \"SimpleType\""); break;
+			case NODE_SKIP: EMIT_LITERAL(e, "{\"node\": \"Skip\""); break;
+			case NODE_SLICE: EMIT_LITERAL(e, "{\"node\": \"Slice\""); break;
+			case NODE_STRING: EMIT_LITERAL(e, "{\"node\": \"String\""); break;
+			case NODE_STRUCT: EMIT_LITERAL(e, "{\"node\": \"Struct\""); break;
+			case NODE_SUBSCRIPT: EMIT_LITERAL(e, "{\"node\": \"Subscript\""); break;
+			case NODE_TEMPLATE_TYPE: EMIT_LITERAL(e, "{\"node\": \"TemplateType\""); break;
+			case NODE_TERNARY: EMIT_LITERAL(e, "{\"node\": \"Ternary\""); break;
+			case NODE_TEST: EMIT_LITERAL(e, "{\"node\": \"Test\""); break;
+			case NODE_UNARY: EMIT_LITERAL(e, "{\"node\": \"Unary\""); break;
+			case NODE_UNION: EMIT_LITERAL(e, "{\"node\": \"UnionType\""); break;
+			case NODE_VAR_DECL: EMIT_LITERAL(e, "{\"node\": \"VarDecl\""); break;
+			case NODE_WARN: EMIT_LITERAL(e, "{\"node\": \"Warn\""); break;
+			case NODE_WHILE_LOOP: EMIT_LITERAL(e, "{\"node\": \"WhileLoop\""); break;
+			case NODE_WITH: EMIT_LITERAL(e, "{\"node\": \"With\""); break;
+			default:
+				EMIT_LITERAL(e, "{\"node\":");
+				emit_uint(e, node->node_type);
+		}
+		EMIT_LITERAL(e, ",\"loc\":[");
+		emit_uint(e, node->start_line);
+		emit_char(e, ',');
+		emit_uint(e, node->start_col);
+		emit_char(e, ',');
+		emit_uint(e, node->end_line);
+		emit_char(e, ',');
+		emit_uint(e, node->end_col);
+		emit_char(e, ']');
+		if (node->src_file != f->parent_file && (!node->src_file || !f->parent_file || strcmp(node->src_file, f->parent_file) != 0)) {
+			EMIT_LITERAL(e, ",\"file\":");
+			emit_json_string(e, node->src_file);
+		}
+	}
+	const char* file = node->src_file;
+
+	switch (node->node_type) {
+		case NODE_AND: {
+			const AST_And* and_node = (const AST_And*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"lhs\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) and_node->lhs, .parent_file = file };
+					f->step = 1;
+					return true;
+				case 1:
+					EMIT_LITERAL(e, ",\"rhs\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) and_node->rhs, .parent_file = file };
+					f->step = 2;
+					return true;
+				case 2:
+					break;
+			}
+		} break;
+		case NODE_ARRAY: {
+			const AST_ArrayLiteral* arrayliteral_node = (const AST_ArrayLiteral*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"elements\":");
+					if (!arrayliteral_node->elements) {
+						EMIT_LITERAL(e, "null");
+					}
+					else emit_char(e, '[');
+					f->index = 0;
+					// fallthrough
+				case 1:
+					if (f->index < arrlen(arrayliteral_node->elements)) {
+						int i = f->index;
+						if (i) emit_char(e, ',');
+						*child = (EmitFrame) { .node = (const AST_Node*) arrayliteral_node->elements[i], .parent_file = file };
+						f->step = 1;
+						f->index++;
+						return true;
+					}
+					if (arrayliteral_node->elements) emit_char(e, ']');
+					break;
+			}
+		} break;
+		case NODE_ARRAY_COMP: {
+			const AST_ArrayComprehension* arraycomprehension_node = (const AST_ArrayComprehension*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"element\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) arraycomprehension_node->element, .parent_file = file };
+					f->step = 1;
+					return true;
+				case 1:
+					EMIT_LITERAL(e, ",\"range\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) arraycomprehension_node->range, .parent_file = file };
+					f->step = 2;
+					return true;
+				case 2:
+					EMIT_LITERAL(e, ",\"filter\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) arraycomprehension_node->filter, .parent_file = file };
+					f->step = 3;
+					return true;
+				case 3:
+					break;
+			}
+		} break;
+		case NODE_ARRAY_RANGE: {
+			const AST_ArrayRange* arrayrange_node = (const AST_ArrayRange*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"start\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) arrayrange_node->start, .parent_file = file };
+					f->step = 1;
+					return true;
+				case 1:
+					EMIT_LITERAL(e, ",\"end\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) arrayrange_node->end, .parent_file = file };
+					f->step = 2;
+					return true;
+				case 2:
+					EMIT_LITERAL(e, ",\"step\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) arrayrange_node->step, .parent_file = file };
+					f->step = 3;
+					return true;
+				case 3:
+					EMIT_LITERAL(e, ",\"is_inclusive\":");
+					emit_str(e, arrayrange_node->is_inclusive? "true" : "false");
+					break;
+			}
+		} break;
+		case NODE_ARRAY_TYPE: {
+			const AST_ArrayType* arraytype_node = (const AST_ArrayType*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"element_type\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) arraytype_node->element_type, .parent_file = file };
+					f->step = 1;
+					return true;
+				case 1:
+					EMIT_LITERAL(e, ",\"shape\":");
+					if (!arraytype_node->shape) {
+						EMIT_LITERAL(e, "null");
+					}
+					else emit_char(e, '[');
+					f->index = 0;
+					// fallthrough
+				case 2:
+					if (f->index < arrlen(arraytype_node->shape)) {
+						int i = f->index;
+						if (i) emit_char(e, ',');
+						*child = (EmitFrame) { .node = (const AST_Node*) arraytype_node->shape[i], .parent_file = file };
+						f->step = 2;
+						f->index++;
+						return true;
+					}
+					if (arraytype_node->shape) emit_char(e, ']');
+					EMIT_LITERAL(e, ",\"is_dynamic\":");
+					emit_str(e, arraytype_node->is_dynamic? "true" : "false");
+					break;
+			}
+		} break;
+		case NODE_ASSERT: {
+			const AST_Assert* assert_node = (const AST_Assert*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"value\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) assert_node->value, .parent_file = file };
+					f->step = 1;
+					return true;
+				case 1:
+					EMIT_LITERAL(e, ",\"message\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) assert_node->message, .parent_file = file };
+					f->step = 2;
+					return true;
+				case 2:
+					break;
+			}
+		} break;
+		case NODE_ASSIGN: {
+			const AST_AssignChain* assignchain_node = (const AST_AssignChain*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"dest_exprs\":");
+					if (!assignchain_node->dest_exprs) {
+						EMIT_LITERAL(e, "null");
+					}
+					else emit_char(e, '[');
+					f->index = 0;
+					// fallthrough
+				case 1:
+					if (f->index < arrlen(assignchain_node->dest_exprs)) {
+						int i = f->index;
+						if (i) emit_char(e, ',');
+						*child = (EmitFrame) { .node = (const AST_Node*) assignchain_node->dest_exprs[i], .parent_file = file };
+						f->step = 1;
+						f->index++;
+						return true;
+					}
+					if (assignchain_node->dest_exprs) emit_char(e, ']');
+					EMIT_LITERAL(e, ",\"src_expr\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) assignchain_node->src_expr, .parent_file = file };
+					f->step = 2;
+					return true;
+				case 2:
+					break;
+			}
+		} break;
+		case NODE_ASSIGN_MANY: {
+			const AST_AssignParallel* assignparallel_node = (const AST_AssignParallel*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"dest_exprs\":");
+					if (!assignparallel_node->dest_exprs) {
+						EMIT_LITERAL(e, "null");
+					}
+					else emit_char(e, '[');
+					f->index = 0;
+					// fallthrough
+				case 1:
+					if (f->index < arrlen(assignparallel_node->dest_exprs)) {
+						int i = f->index;
+						if (i) emit_char(e, ',');
+						*child = (EmitFrame) { .node = (const AST_Node*) assignparallel_node->dest_exprs[i], .parent_file = file };
+						f->step = 1;
+						f->index++;
+						return true;
+					}
+					if (assignparallel_node->dest_exprs) emit_char(e, ']');
+					EMIT_LITERAL(e, ",\"src_exprs\":");
+					if (!assignparallel_node->src_exprs) {
+						EMIT_LITERAL(e, "null");
+					}
+					else emit_char(e, '[');
+					f->index = 0;
+					// fallthrough
+				case 2:
+					if (f->index < arrlen(assignparallel_node->src_exprs)) {
+						int i = f->index;
+						if (i) emit_char(e, ',');
+						*child = (EmitFrame) { .node = (const AST_Node*) assignparallel_node->src_exprs[i], .parent_file = file };
+						f->step = 2;
+						f->index++;
+						return true;
+					}
+					if (assignparallel_node->src_exprs) emit_char(e, ']');
+					break;
+			}
+		} break;
+		case NODE_ASYNC: {
+			const AST_Async* async_node = (const AST_Async*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"target\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) async_node->target, .parent_file = file };
+					f->step = 1;
+					return true;
+				case 1:
+					break;
+			}
+		} break;
+		case NODE_AWAIT: {
+			const AST_Await* await_node = (const AST_Await*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"target\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) await_node->target, .parent_file = file };
+					f->step = 1;
+					return true;
+				case 1:
+					break;
+			}
+		} break;
+		case NODE_BINOP: {
+			const AST_Binop* binop_node = (const AST_Binop*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"lhs\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) binop_node->lhs, .parent_file = file };
+					f->step = 1;
+					return true;
+				case 1:
+					EMIT_LITERAL(e, ",\"op\":");
+					emit_json_string(e, binop_node->op);
+					EMIT_LITERAL(e, ",\"rhs\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) binop_node->rhs, .parent_file = file };
+					f->step = 2;
+					return true;
+				case 2:
+					break;
+			}
+		} break;
+		case NODE_BLOCK: {
+			const AST_Block* block_node = (const AST_Block*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"body\":");
+					if (!block_node->body) {
+						EMIT_LITERAL(e, "null");
+					}
+					else emit_char(e, '[');
+					f->index = 0;
+					// fallthrough
+				case 1:
+					if (f->index < arrlen(block_node->body)) {
+						int i = f->index;
+						if (i) emit_char(e, ',');
+						*child = (EmitFrame) { .node = (const AST_Node*) block_node->body[i], .parent_file = file };
+						f->step = 1;
+						f->index++;
+						return true;
+					}
+					if (block_node->body) emit_char(e, ']');
+					break;
+			}
+		} break;
+		case NODE_BOOL: {
+			const AST_Bool* bool_node = (const AST_Bool*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"value\":");
+					emit_str(e, bool_node->value? "true" : "false");
+					break;
+			}
+		} break;
+		case NODE_BREAK: {
+			const AST_Break* break_node = (const AST_Break*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"label\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) break_node->label, .parent_file = file };
+					f->step = 1;
+					return true;
+				case 1:
+					break;
+			}
+		} break;
+		case NODE_BROADCAST: {
+			const AST_Broadcast* broadcast_node = (const AST_Broadcast*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"target\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) broadcast_node->target, .parent_file = file };
+					f->step = 1;
+					return true;
+				case 1:
+					break;
+			}
+		} break;
+		case NODE_CANCEL: {
+			const AST_Cancel* cancel_node = (const AST_Cancel*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"target\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) cancel_node->target, .parent_file = file };
+					f->step = 1;
+					return true;
+				case 1:
+					break;
+			}
+		} break;
+		case NODE_CHAR: {
+			const AST_Char* char_node = (const AST_Char*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"value\":");
+					emit_json_rune(e, char_node->value);
+					break;
+			}
+		} break;
+		case NODE_COMPARISON: {
+			const AST_ComparisonChain* comparisonchain_node = (const AST_ComparisonChain*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"comparisons\":");
+					if (!comparisonchain_node->comparisons) {
+						EMIT_LITERAL(e, "null");
+					}
+					else emit_char(e, '[');
+					for (int i = 0; i < arrlen(comparisonchain_node->comparisons); i++) {
+						if (i) emit_char(e, ',');
+						emit_json_string(e, comparisonchain_node->comparisons[i]);
+					}
+					if (comparisonchain_node->comparisons) emit_char(e, ']');
+					EMIT_LITERAL(e, ",\"operands\":");
+					if (!comparisonchain_node->operands) {
+						EMIT_LITERAL(e, "null");
+					}
+					else emit_char(e, '[');
+					f->index = 0;
+					// fallthrough
+				case 1:
+					if (f->index < arrlen(comparisonchain_node->operands)) {
+						int i = f->index;
+						if (i) emit_char(e, ',');
+						*child = (EmitFrame) { .node = (const AST_Node*) comparisonchain_node->operands[i], .parent_file = file };
+						f->step = 1;
+						f->index++;
+						return true;
+					}
+					if (comparisonchain_node->operands) emit_char(e, ']');
+					break;
+			}
+		} break;
+		case NODE_CONST: {
+			const AST_Const* const_node = (const AST_Const*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"name\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) const_node->name, .parent_file = file };
+					f->step = 1;
+					return true;
+				case 1:
+					EMIT_LITERAL(e, ",\"type\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) const_node->type, .parent_file = file };
+					f->step = 2;
+					return true;
+				case 2:
+					EMIT_LITERAL(e, ",\"value\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) const_node->value, .parent_file = file };
+					f->step = 3;
+					return true;
+				case 3:
+					EMIT_LITERAL(e, ",\"pub\":");
+					emit_str(e, const_node->pub? "true" : "false");
+					break;
+			}
+		} break;
+		case NODE_CONTEXT: {
+			const AST_Context* context_node = (const AST_Context*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"name\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) context_node->name, .parent_file = file };
+					f->step = 1;
+					return true;
+				case 1:
+					EMIT_LITERAL(e, ",\"value\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) context_node->value, .parent_file = file };
+					f->step = 2;
+					return true;
+				case 2:
+					break;
+			}
+		} break;
+		case NODE_CONTRACT: {
+			const AST_Contract* contract_node = (const AST_Contract*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"kind\":");
+					emit_str(e, enum_contract_to_json(contract_node->kind));
+					EMIT_LITERAL(e, ",\"condition\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) contract_node->condition, .parent_file = file };
+					f->step = 1;
+					return true;
+				case 1:
+					break;
+			}
+		} break;
+		case NODE_DEFER: {
+			const AST_Defer* defer_node = (const AST_Defer*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"code\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) defer_node->code, .parent_file = file };
+					f->step = 1;
+					return true;
+				case 1:
+					break;
+			}
+		} break;
+		case NODE_ENUM: {
+			const AST_Enum* enum_node = (const AST_Enum*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"name\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) enum_node->name, .parent_file = file };
+					f->step = 1;
+					return true;
+				case 1:
+					EMIT_LITERAL(e, ",\"fields\":");
+					if (!enum_node->fields) {
+						EMIT_LITERAL(e, "null");
+					}
+					else emit_char(e, '{');
+					f->index = 0;
+					// fallthrough
+				case 2:
+					if (f->index < shlen(enum_node->fields)) {
+						int i = f->index;
+						if (i) emit_char(e, ',');
+						emit_json_string(e, enum_node->fields[i].key);
+						emit_char(e, ':');
+						*child = (EmitFrame) { .node = (const AST_Node*) enum_node->fields[i].value, .parent_file = file };
+						f->step = 2;
+						f->index++;
+						return true;
+					}
+					if (enum_node->fields) emit_char(e, '}');
+					EMIT_LITERAL(e, ",\"pub\":");
+					emit_str(e, enum_node->pub? "true" : "false");
+					EMIT_LITERAL(e, ",\"is_flags\":");
+					emit_str(e, enum_node->is_flags? "true" : "false");
+					break;
+			}
+		} break;
+		case NODE_ENUM_VALUE: {
+			const AST_EnumValue* enumvalue_node = (const AST_EnumValue*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"name\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) enumvalue_node->name, .parent_file = file };
+					f->step = 1;
+					return true;
+				case 1:
+					EMIT_LITERAL(e, ",\"value\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) enumvalue_node->value, .parent_file = file };
+					f->step = 2;
+					return true;
+				case 2:
+					break;
+			}
+		} break;
+		case NODE_FAIL: {
+			const AST_Fail* fail_node = (const AST_Fail*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"value\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) fail_node->value, .parent_file = file };
+					f->step = 1;
+					return true;
+				case 1:
+					EMIT_LITERAL(e, ",\"message\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) fail_node->message, .parent_file = file };
+					f->step = 2;
+					return true;
+				case 2:
+					break;
+			}
+		} break;
+		case NODE_FIELD: {
+			const AST_Field* field_node = (const AST_Field*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"name\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) field_node->name, .parent_file = file };
+					f->step = 1;
+					return true;
+				case 1:
+					EMIT_LITERAL(e, ",\"type\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) field_node->type, .parent_file = file };
+					f->step = 2;
+					return true;
+				case 2:
+					EMIT_LITERAL(e, ",\"default_value\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) field_node->default_value, .parent_file = file };
+					f->step = 3;
+					return true;
+				case 3:
+					EMIT_LITERAL(e, ",\"invariant\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) field_node->invariant, .parent_file = file };
+					f->step = 4;
+					return true;
+				case 4:
+					EMIT_LITERAL(e, ",\"is_using\":");
+					emit_str(e, field_node->is_using? "true" : "false");
+					break;
+			}
+		} break;
+		case NODE_FIELD_ACCESS: {
+			const AST_FieldAccess* fieldaccess_node = (const AST_FieldAccess*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"base\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) fieldaccess_node->base, .parent_file = file };
+					f->step = 1;
+					return true;
+				case 1:
+					EMIT_LITERAL(e, ",\"field\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) fieldaccess_node->field, .parent_file = file };
+					f->step = 2;
+					return true;
+				case 2:
+					break;
+			}
+		} break;
+		case NODE_FLOAT: {
+			const AST_Float* float_node = (const AST_Float*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"value\":");
+					emit_float(e, float_node->value, true);
+					break;
+			}
+		} break;
+		case NODE_FOR_LOOP: {
+			const AST_ForLoop* forloop_node = (const AST_ForLoop*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"iterables\":");
+					if (!forloop_node->iterables) {
+						EMIT_LITERAL(e, "null");
+					}
+					else emit_char(e, '[');
+					f->index = 0;
+					// fallthrough
+				case 1:
+					if (f->index < arrlen(forloop_node->iterables)) {
+						int i = f->index;
+						if (i) emit_char(e, ',');
+						*child = (EmitFrame) { .node = (const AST_Node*) forloop_node->iterables[i], .parent_file = file };
+						f->step = 1;
+						f->index++;
+						return true;
+					}
+					if (forloop_node->iterables) emit_char(e, ']');
+					EMIT_LITERAL(e, ",\"label\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) forloop_node->label, .parent_file = file };
+					f->step = 2;
+					return true;
+				case 2:
+					EMIT_LITERAL(e, ",\"body\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) forloop_node->body, .parent_file = file };
+					f->step = 3;
+					return true;
+				case 3:
+					EMIT_LITERAL(e, ",\"mode\":");
+					emit_str(e, enum_for_to_json(forloop_node->mode));
+					break;
+			}
+		} break;
+		case NODE_FOR_PARALLEL: {
+			const AST_ForParallel* forparallel_node = (const AST_ForParallel*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"names\":");
+					if (!forparallel_node->names) {
+						EMIT_LITERAL(e, "null");
+					}
+					else emit_char(e, '[');
+					f->index = 0;
+					// fallthrough
+				case 1:
+					if (f->index < arrlen(forparallel_node->names)) {
+						int i = f->index;
+						if (i) emit_char(e, ',');
+						*child = (EmitFrame) { .node = (const AST_Node*) forparallel_node->names[i], .parent_file = file };
+						f->step = 1;
+						f->index++;
+						return true;
+					}
+					if (forparallel_node->names) emit_char(e, ']');
+					EMIT_LITERAL(e, ",\"zips\":");
+					if (!forparallel_node->zips) {
+						EMIT_LITERAL(e, "null");
+					}
+					else emit_char(e, '{');
+					f->index = 0;
+					// fallthrough
+				case 2:
+					if (f->index < shlen(forparallel_node->zips)) {
+						int i = f->index;
+						if (i) emit_char(e, ',');
+						emit_json_string(e, forparallel_node->zips[i].key);
+						emit_char(e, ':');
+						*child = (EmitFrame) { .node = (const AST_Node*) forparallel_node->zips[i].value, .parent_file = file };
+						f->step = 2;
+						f->index++;
+						return true;
+					}
+					if (forparallel_node->zips) emit_char(e, '}');
+					break;
+			}
+		} break;
+		case NODE_FOR_RANGE: {
+			const AST_ForRange* forrange_node = (const AST_ForRange*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"name\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) forrange_node->name, .parent_file = file };
+					f->step = 1;
+					return true;
+				case 1:
+					EMIT_LITERAL(e, ",\"start\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) forrange_node->start, .parent_file = file };
+					f->step = 2;
+					return true;
+				case 2:
+					EMIT_LITERAL(e, ",\"end\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) forrange_node->end, .parent_file = file };
+					f->step = 3;
+					return true;
+				case 3:
+					EMIT_LITERAL(e, ",\"step\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) forrange_node->step, .parent_file = file };
+					f->step = 4;
+					return true;
+				case 4:
+					EMIT_LITERAL(e, ",\"is_inclusive\":");
+					emit_str(e, forrange_node->is_inclusive? "true" : "false");
+					break;
+			}
+		} break;
+		case NODE_FOR_SIMPLE: {
+			const AST_ForSimple* forsimple_node = (const AST_ForSimple*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"name\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) forsimple_node->name, .parent_file = file };
+					f->step = 1;
+					return true;
+				case 1:
+					EMIT_LITERAL(e, ",\"iterable\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) forsimple_node->iterable, .parent_file = file };
+					f->step = 2;
+					return true;
+				case 2:
+					break;
+			}
+		} break;
+		case NODE_FUNC_CALL: {
+			const AST_FuncCall* funccall_node = (const AST_FuncCall*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"func\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) funccall_node->func, .parent_file = file };
+					f->step = 1;
+					return true;
+				case 1:
+					EMIT_LITERAL(e, ",\"pos_args\":");
+					if (!funccall_node->pos_args) {
+						EMIT_LITERAL(e, "null");
+					}
+					else emit_char(e, '[');
+					f->index = 0;
+					// fallthrough
+				case 2:
+					if (f->index < arrlen(funccall_node->pos_args)) {
+						int i = f->index;
+						if (i) emit_char(e, ',');
+						*child = (EmitFrame) { .node = (const AST_Node*) funccall_node->pos_args[i], .parent_file = file };
+						f->step = 2;
+						f->index++;
+						return true;
+					}
+					if (funccall_node->pos_args) emit_char(e, ']');
+					EMIT_LITERAL(e, ",\"kw_args\":");
+					if (!funccall_node->kw_args) {
+						EMIT_LITERAL(e, "null");
+					}
+					else emit_char(e, '{');
+					f->index = 0;
+					// fallthrough
+				case 3:
+					if (f->index < shlen(funccall_node->kw_args)) {
+						int i = f->index;
+						if (i) emit_char(e, ',');
+						emit_json_string(e, funccall_node->kw_args[i].key);
+						emit_char(e, ':');
+						*child = (EmitFrame) { .node = (const AST_Node*) funccall_node->kw_args[i].value, .parent_file = file };
+						f->step = 3;
+						f->index++;
+						return true;
+					}
+					if (funccall_node->kw_args) emit_char(e, '}');
+					EMIT_LITERAL(e, ",\"is_word_op\":");
+					emit_str(e, funccall_node->is_word_op? "true" : "false");
+					break;
+			}
+		} break;
+		case NODE_FUNC_DEF: {
+			const AST_FuncDef* funcdef_node = (const AST_FuncDef*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"name\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) funcdef_node->name, .parent_file = file };
+					f->step = 1;
+					return true;
+				case 1:
+					EMIT_LITERAL(e, ",\"params\":");
+					if (!funcdef_node->params) {
+						EMIT_LITERAL(e, "null");
+					}
+					else emit_char(e, '{');
+					f->index = 0;
+					// fallthrough
+				case 2:
+					if (f->index < shlen(funcdef_node->params)) {
+						int i = f->index;
+						if (i) emit_char(e, ',');
+						emit_json_string(e, funcdef_node->params[i].key);
+						emit_char(e, ':');
+						*child = (EmitFrame) { .node = (const AST_Node*) funcdef_node->params[i].value, .parent_file = file };
+						f->step = 2;
+						f->index++;
+						return true;
+					}
+					if (funcdef_node->params) emit_char(e, '}');
+					EMIT_LITERAL(e, ",\"ret_type\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) funcdef_node->ret_type, .parent_file = file };
+					f->step = 3;
+					return true;
+				case 3:
+					EMIT_LITERAL(e, ",\"body\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) funcdef_node->body, .parent_file = file };
+					f->step = 4;
+					return true;
+				case 4:
+					EMIT_LITERAL(e, ",\"pub\":");
+					emit_str(e, funcdef_node->pub? "true" : "false");
+					break;
+			}
+		} break;
+		case NODE_FUNC_OVERLOAD: {
+			const AST_FuncOverload* funcoverload_node = (const AST_FuncOverload*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"name\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) funcoverload_node->name, .parent_file = file };
+					f->step = 1;
+					return true;
+				case 1:
+					EMIT_LITERAL(e, ",\"overloads\":");
+					if (!funcoverload_node->overloads) {
+						EMIT_LITERAL(e, "null");
+					}
+					else emit_char(e, '[');
+					f->index = 0;
+					// fallthrough
+				case 2:
+					if (f->index < arrlen(funcoverload_node->overloads)) {
+						int i = f->index;
+						if (i) emit_char(e, ',');
+						*child = (EmitFrame) { .node = (const AST_Node*) funcoverload_node->overloads[i], .parent_file = file };
+						f->step = 2;
+						f->index++;
+						return true;
+					}
+					if (funcoverload_node->overloads) emit_char(e, ']');
+					break;
+			}
+		} break;
+		case NODE_FUNC_TYPE: {
+			const AST_FuncType* functype_node = (const AST_FuncType*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"param_types\":");
+					if (!functype_node->param_types) {
+						EMIT_LITERAL(e, "null");
+					}
+					else emit_char(e, '[');
+					f->index = 0;
+					// fallthrough
+				case 1:
+					if (f->index < arrlen(functype_node->param_types)) {
+						int i = f->index;
+						if (i) emit_char(e, ',');
+						*child = (EmitFrame) { .node = (const AST_Node*) functype_node->param_types[i], .parent_file = file };
+						f->step = 1;
+						f->index++;
+						return true;
+					}
+					if (functype_node->param_types) emit_char(e, ']');
+					EMIT_LITERAL(e, ",\"return_type\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) functype_node->return_type, .parent_file = file };
+					f->step = 2;
+					return true;
+				case 2:
+					break;
+			}
+		} break;
+		case NODE_IF_STMT: {
+			const AST_IfStatement* ifstatement_node = (const AST_IfStatement*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"condition\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) ifstatement_node->condition, .parent_file = file };
+					f->step = 1;
+					return true;
+				case 1:
+					EMIT_LITERAL(e, ",\"body\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) ifstatement_node->body, .parent_file = file };
+					f->step = 2;
+					return true;
+				case 2:
+					EMIT_LITERAL(e, ",\"alternative\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) ifstatement_node->alternative, .parent_file = file };
+					f->step = 3;
+					return true;
+				case 3:
+					break;
+			}
+		} break;
+		case NODE_IMPORT: {
+			const AST_Import* import_node = (const AST_Import*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"local_name\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) import_node->local_name, .parent_file = file };
+					f->step = 1;
+					return true;
+				case 1:
+					EMIT_LITERAL(e, ",\"qualified_name\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) import_node->qualified_name, .parent_file = file };
+					f->step = 2;
+					return true;
+				case 2:
+					EMIT_LITERAL(e, ",\"imported_file\":");
+					emit_json_string(e, import_node->imported_file);
+					EMIT_LITERAL(e, ",\"is_using\":");
+					emit_str(e, import_node->is_using? "true" : "false");
+					break;
+			}
+		} break;
+		case NODE_INT: {
+			const AST_Int* int_node = (const AST_Int*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"value\":");
+					emit_int(e, int_node->value);
+					break;
+			}
+		} break;
+		case NODE_MACRO: {
+			const AST_Macro* macro_node = (const AST_Macro*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"name\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) macro_node->name, .parent_file = file };
+					f->step = 1;
+					return true;
+				case 1:
+					EMIT_LITERAL(e, ",\"params\":");
+					if (!macro_node->params) {
+						EMIT_LITERAL(e, "null");
+					}
+					else emit_char(e, '{');
+					f->index = 0;
+					// fallthrough
+				case 2:
+					if (f->index < shlen(macro_node->params)) {
+						int i = f->index;
+						if (i) emit_char(e, ',');
+						emit_json_string(e, macro_node->params[i].key);
+						emit_char(e, ':');
+						*child = (EmitFrame) { .node = (const AST_Node*) macro_node->params[i].value, .parent_file = file };
+						f->step = 2;
+						f->index++;
+						return true;
+					}
+					if (macro_node->params) emit_char(e, '}');
+					EMIT_LITERAL(e, ",\"expansion\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) macro_node->expansion, .parent_file = file };
+					f->step = 3;
+					return true;
+				case 3:
+					EMIT_LITERAL(e, ",\"pub\":");
+					emit_str(e, macro_node->pub? "true" : "false");
+					break;
+			}
+		} break;
+		case NODE_MATCH: {
+			const AST_Match* match_node = (const AST_Match*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"patterns\":");
+					if (!match_node->patterns) {
+						EMIT_LITERAL(e, "null");
+					}
+					else emit_char(e, '[');
+					f->index = 0;
+					// fallthrough
+				case 1:
+					if (f->index < arrlen(match_node->patterns)) {
+						int i = f->index;
+						if (i) emit_char(e, ',');
+						*child = (EmitFrame) { .node = (const AST_Node*) match_node->patterns[i], .parent_file = file };
+						f->step = 1;
+						f->index++;
+						return true;
+					}
+					if (match_node->patterns) emit_char(e, ']');
+					break;
+			}
+		} break;
+		case NODE_MATCH_CASE: {
+			const AST_MatchCase* matchcase_node = (const AST_MatchCase*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"patterns\":");
+					if (!matchcase_node->patterns) {
+						EMIT_LITERAL(e, "null");
+					}
+					else emit_char(e, '[');
+					f->index = 0;
+					// fallthrough
+				case 1:
+					if (f->index < arrlen(matchcase_node->patterns)) {
+						int i = f->index;
+						if (i) emit_char(e, ',');
+						*child = (EmitFrame) { .node = (const AST_Node*) matchcase_node->patterns[i], .parent_file = file };
+						f->step = 1;
+						f->index++;
+						return true;
+					}
+					if (matchcase_node->patterns) emit_char(e, ']');
+					EMIT_LITERAL(e, ",\"body\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) matchcase_node->body, .parent_file = file };
+					f->step = 2;
+					return true;
+				case 2:
+					break;
+			}
+		} break;
+		case NODE_MODULE: {
+			const AST_Module* module_node = (const AST_Module*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"scope\":");
+					if (!module_node->scope) {
+						EMIT_LITERAL(e, "null");
+					}
+					else emit_char(e, '{');
+					f->index = 0;
+					// fallthrough
+				case 1:
+					if (f->index < shlen(module_node->scope)) {
+						int i = f->index;
+						if (i) emit_char(e, ',');
+						emit_json_string(e, module_node->scope[i].key);
+						emit_char(e, ':');
+						*child = (EmitFrame) { .node = (const AST_Node*) module_node->scope[i].value, .parent_file = file };
+						f->step = 1;
+						f->index++;
+						return true;
+					}
+					if (module_node->scope) emit_char(e, '}');
+					EMIT_LITERAL(e, ",\"tests\":");
+					if (!module_node->tests) {
+						EMIT_LITERAL(e, "null");
+					}
+					else emit_char(e, '[');
+					f->index = 0;
+					// fallthrough
+				case 2:
+					if (f->index < arrlen(module_node->tests)) {
+						int i = f->index;
+						if (i) emit_char(e, ',');
+						*child = (EmitFrame) { .node = (const AST_Node*) module_node->tests[i], .parent_file = file };
+						f->step = 2;
+						f->index++;
+						return true;
+					}
+					if (module_node->tests) emit_char(e, ']');
+					break;
+			}
+		} break;
+		case NODE_MUTABLE_TYPE: {
+			const AST_MutableType* mutabletype_node = (const AST_MutableType*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"base\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) mutabletype_node->base, .parent_file = file };
+					f->step = 1;
+					return true;
+				case 1:
+					break;
+			}
+		} break;
+		case NODE_NAME: {
+			const AST_Name* name_node = (const AST_Name*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"name\":");
+					emit_json_string(e, name_node->name);
+					break;
+			}
+		} break;
+		case NODE_NOT: {
+			const AST_Not* not_node = (const AST_Not*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"expr\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) not_node->expr, .parent_file = file };
+					f->step = 1;
+					return true;
+				case 1:
+					break;
+			}
+		} break;
+		case NODE_OPTIONAL_TYPE: {
+			const AST_OptionalType* optionaltype_node = (const AST_OptionalType*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"base\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) optionaltype_node->base, .parent_file = file };
+					f->step = 1;
+					return true;
+				case 1:
+					break;
+			}
+		} break;
+		case NODE_OP_ASSIGN: {
+			const AST_OpAssign* opassign_node = (const AST_OpAssign*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"op\":");
+					emit_json_string(e, opassign_node->op);
+					EMIT_LITERAL(e, ",\"dest_expr\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) opassign_node->dest_expr, .parent_file = file };
+					f->step = 1;
+					return true;
+				case 1:
+					EMIT_LITERAL(e, ",\"src_expr\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) opassign_node->src_expr, .parent_file = file };
+					f->step = 2;
+					return true;
+				case 2:
+					break;
+			}
+		} break;
+		case NODE_OR: {
+			const AST_Or* or_node = (const AST_Or*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"lhs\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) or_node->lhs, .parent_file = file };
+					f->step = 1;
+					return true;
+				case 1:
+					EMIT_LITERAL(e, ",\"rhs\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) or_node->rhs, .parent_file = file };
+					f->step = 2;
+					return true;
+				case 2:
+					break;
+			}
+		} break;
+		case NODE_PACKED_ARRAY: {
+			const AST_PackedArray* packedarray_node = (const AST_PackedArray*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"kind\":");
+					emit_str(e, enum_packed_to_json(packedarray_node->kind));
+					EMIT_LITERAL(e, ",\"shape\":");
+					if (!packedarray_node->shape) {
+						EMIT_LITERAL(e, "null");
+					}
+					else emit_char(e, '[');
+					for (int i = 0; i < arrlen(packedarray_node->shape); i++) {
+						if (i) emit_char(e, ',');
+						emit_uint(e, packedarray_node->shape[i]);
+					}
+					if (packedarray_node->shape) emit_char(e, ']');
+					EMIT_LITERAL(e, ",\"ints\":");
+					if (!packedarray_node->ints) {
+						EMIT_LITERAL(e, "null");
+					}
+					else emit_char(e, '[');
+					for (int i = 0; i < arrlen(packedarray_node->ints); i++) {
+						if (i) emit_char(e, ',');
+						emit_int(e, packedarray_node->ints[i]);
+					}
+					if (packedarray_node->ints) emit_char(e, ']');
+					EMIT_LITERAL(e, ",\"floats\":");
+					if (!packedarray_node->floats) {
+						EMIT_LITERAL(e, "null");
+					}
+					else emit_char(e, '[');
+					for (int i = 0; i < arrlen(packedarray_node->floats); i++) {
+						if (i) emit_char(e, ',');
+						emit_float(e, packedarray_node->floats[i], true);
+					}
+					if (packedarray_node->floats) emit_char(e, ']');
+					break;
+			}
+		} break;
+		case NODE_PARAM: {
+			const AST_Param* param_node = (const AST_Param*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"name\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) param_node->name, .parent_file = file };
+					f->step = 1;
+					return true;
+				case 1:
+					EMIT_LITERAL(e, ",\"type\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) param_node->type, .parent_file = file };
+					f->step = 2;
+					return true;
+				case 2:
+					EMIT_LITERAL(e, ",\"default_value\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) param_node->default_value, .parent_file = file };
+					f->step = 3;
+					return true;
+				case 3:
+					EMIT_LITERAL(e, ",\"is_vararg\":");
+					emit_str(e, param_node->is_vararg? "true" : "false");
+					EMIT_LITERAL(e, ",\"is_kw_only\":");
+					emit_str(e, param_node->is_kw_only? "true" : "false");
+					EMIT_LITERAL(e, ",\"allow_alias\":");
+					emit_str(e, param_node->allow_alias? "true" : "false");
+					break;
+			}
+		} break;
+		case NODE_POINTER_TYPE: {
+			const AST_PointerType* pointertype_node = (const AST_PointerType*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"base\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) pointertype_node->base, .parent_file = file };
+					f->step = 1;
+					return true;
+				case 1:
+					break;
+			}
+		} break;
+		case NODE_QUALNAME: {
+			const AST_Qualname* qualname_node = (const AST_Qualname*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"parts\":");
+					if (!qualname_node->parts) {
+						EMIT_LITERAL(e, "null");
+					}
+					else emit_char(e, '[');
+					for (int i = 0; i < arrlen(qualname_node->parts); i++) {
+						if (i) emit_char(e, ',');
+						emit_json_string(e, qualname_node->parts[i]);
+					}
+					if (qualname_node->parts) emit_char(e, ']');
+					break;
+			}
+		} break;
+		case NODE_REREFERENCE: {
+			const AST_Reref* reref_node = (const AST_Reref*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"target\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) reref_node->target, .parent_file = file };
+					f->step = 1;
+					return true;
+				case 1:
+					EMIT_LITERAL(e, ",\"levels\":");
+					emit_int(e, reref_node->levels);
+					break;
+			}
+		} break;
+		case NODE_RETURN: {
+			const AST_Return* return_node = (const AST_Return*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"value\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) return_node->value, .parent_file = file };
+					f->step = 1;
+					return true;
+				case 1:
+					break;
+			}
+		} break;
+		case NODE_RUN: {
+			const AST_Run* run_node = (const AST_Run*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"statement\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) run_node->statement, .parent_file = file };
+					f->step = 1;
+					return true;
+				case 1:
+					break;
+			}
+		} break;
+		case NODE_SIMPLE_TYPE: {
+			const AST_SimpleType* simpletype_node = (const AST_SimpleType*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"base\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) simpletype_node->base, .parent_file = file };
+					f->step = 1;
+					return true;
+				case 1:
+					break;
+			}
+		} break;
+		case NODE_SKIP: {
+			const AST_Skip* skip_node = (const AST_Skip*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"label\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) skip_node->label, .parent_file = file };
+					f->step = 1;
+					return true;
+				case 1:
+					break;
+			}
+		} break;
+		case NODE_SLICE: {
+			const AST_Slice* slice_node = (const AST_Slice*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"start\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) slice_node->start, .parent_file = file };
+					f->step = 1;
+					return true;
+				case 1:
+					EMIT_LITERAL(e, ",\"end\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) slice_node->end, .parent_file = file };
+					f->step = 2;
+					return true;
+				case 2:
+					EMIT_LITERAL(e, ",\"step\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) slice_node->step, .parent_file = file };
+					f->step = 3;
+					return true;
+				case 3:
+					EMIT_LITERAL(e, ",\"is_inclusive\":");
+					emit_str(e, slice_node->is_inclusive? "true" : "false");
+					break;
+			}
+		} break;
+		case NODE_STRING: {
+			const AST_String* string_node = (const AST_String*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"value\":");
+					emit_json_string(e, string_node->value);
+					break;
+			}
+		} break;
+		case NODE_STRUCT: {
+			const AST_Struct* struct_node = (const AST_Struct*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"name\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) struct_node->name, .parent_file = file };
+					f->step = 1;
+					return true;
+				case 1:
+					EMIT_LITERAL(e, ",\"constraints\":");
+					if (!struct_node->constraints) {
+						EMIT_LITERAL(e, "null");
+					}
+					else emit_char(e, '[');
+					f->index = 0;
+					// fallthrough
+				case 2:
+					if (f->index < arrlen(struct_node->constraints)) {
+						int i = f->index;
+						if (i) emit_char(e, ',');
+						*child = (EmitFrame) { .node = (const AST_Node*) struct_node->constraints[i], .parent_file = file };
+						f->step = 2;
+						f->index++;
+						return true;
+					}
+					if (struct_node->constraints) emit_char(e, ']');
+					EMIT_LITERAL(e, ",\"fields\":");
+					if (!struct_node->fields) {
+						EMIT_LITERAL(e, "null");
+					}
+					else emit_char(e, '{');
+					f->index = 0;
+					// fallthrough
+				case 3:
+					if (f->index < shlen(struct_node->fields)) {
+						int i = f->index;
+						if (i) emit_char(e, ',');
+						emit_json_string(e, struct_node->fields[i].key);
+						emit_char(e, ':');
+						*child = (EmitFrame) { .node = (const AST_Node*) struct_node->fields[i].value, .parent_file = file };
+						f->step = 3;
+						f->index++;
+						return true;
+					}
+					if (struct_node->fields) emit_char(e, '}');
+					EMIT_LITERAL(e, ",\"pub\":");
+					emit_str(e, struct_node->pub? "true" : "false");
+					break;
+			}
+		} break;
+		case NODE_SUBSCRIPT: {
+			const AST_Subscript* subscript_node = (const AST_Subscript*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"array\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) subscript_node->array, .parent_file = file };
+					f->step = 1;
+					return true;
+				case 1:
+					EMIT_LITERAL(e, ",\"subscripts\":");
+					if (!subscript_node->subscripts) {
+						EMIT_LITERAL(e, "null");
+					}
+					else emit_char(e, '[');
+					f->index = 0;
+					// fallthrough
+				case 2:
+					if (f->index < arrlen(subscript_node->subscripts)) {
+						int i = f->index;
+						if (i) emit_char(e, ',');
+						*child = (EmitFrame) { .node = (const AST_Node*) subscript_node->subscripts[i], .parent_file = file };
+						f->step = 2;
+						f->index++;
+						return true;
+					}
+					if (subscript_node->subscripts) emit_char(e, ']');
+					break;
+			}
+		} break;
+		case NODE_TEMPLATE_TYPE: {
+			const AST_TemplateType* templatetype_node = (const AST_TemplateType*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"arguments\":");
+					if (!templatetype_node->arguments) {
+						EMIT_LITERAL(e, "null");
+					}
+					else emit_char(e, '[');
+					f->index = 0;
+					// fallthrough
+				case 1:
+					if (f->index < arrlen(templatetype_node->arguments)) {
+						int i = f->index;
+						if (i) emit_char(e, ',');
+						*child = (EmitFrame) { .node = (const AST_Node*) templatetype_node->arguments[i], .parent_file = file };
+						f->step = 1;
+						f->index++;
+						return true;
+					}
+					if (templatetype_node->arguments) emit_char(e, ']');
+					break;
+			}
+		} break;
+		case NODE_TERNARY: {
+			const AST_Ternary* ternary_node = (const AST_Ternary*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"condition\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) ternary_node->condition, .parent_file = file };
+					f->step = 1;
+					return true;
+				case 1:
+					EMIT_LITERAL(e, ",\"true_expr\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) ternary_node->true_expr, .parent_file = file };
+					f->step = 2;
+					return true;
+				case 2:
+					EMIT_LITERAL(e, ",\"false_expr\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) ternary_node->false_expr, .parent_file = file };
+					f->step = 3;
+					return true;
+				case 3:
+					break;
+			}
+		} break;
+		case NODE_TEST: {
+			const AST_Test* test_node = (const AST_Test*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"description\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) test_node->description, .parent_file = file };
+					f->step = 1;
+					return true;
+				case 1:
+					EMIT_LITERAL(e, ",\"body\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) test_node->body, .parent_file = file };
+					f->step = 2;
+					return true;
+				case 2:
+					break;
+			}
+		} break;
+		case NODE_UNARY: {
+			const AST_Unary* unary_node = (const AST_Unary*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"op\":");
+					emit_json_string(e, unary_node->op);
+					EMIT_LITERAL(e, ",\"expr\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) unary_node->expr, .parent_file = file };
+					f->step = 1;
+					return true;
+				case 1:
+					break;
+			}
+		} break;
+		case NODE_UNION: {
+			const AST_UnionType* uniontype_node = (const AST_UnionType*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"variants\":");
+					if (!uniontype_node->variants) {
+						EMIT_LITERAL(e, "null");
+					}
+					else emit_char(e, '[');
+					f->index = 0;
+					// fallthrough
+				case 1:
+					if (f->index < arrlen(uniontype_node->variants)) {
+						int i = f->index;
+						if (i) emit_char(e, ',');
+						*child = (EmitFrame) { .node = (const AST_Node*) uniontype_node->variants[i], .parent_file = file };
+						f->step = 1;
+						f->index++;
+						return true;
+					}
+					if (uniontype_node->variants) emit_char(e, ']');
+					break;
+			}
+		} break;
+		case NODE_VAR_DECL: {
+			const AST_VarDecl* vardecl_node = (const AST_VarDecl*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"name\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) vardecl_node->name, .parent_file = file };
+					f->step = 1;
+					return true;
+				case 1:
+					EMIT_LITERAL(e, ",\"type\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) vardecl_node->type, .parent_file = file };
+					f->step = 2;
+					return true;
+				case 2:
+					EMIT_LITERAL(e, ",\"value\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) vardecl_node->value, .parent_file = file };
+					f->step = 3;
+					return true;
+				case 3:
+					EMIT_LITERAL(e, ",\"init\":");
+					emit_str(e, enum_init_to_json(vardecl_node->init));
+					break;
+			}
+		} break;
+		case NODE_WARN: {
+			const AST_Warn* warn_node = (const AST_Warn*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"warning\":");
+					emit_json_string(e, warn_node->warning);
+					break;
+			}
+		} break;
+		case NODE_WHILE_LOOP: {
+			const AST_WhileLoop* whileloop_node = (const AST_WhileLoop*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"condition\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) whileloop_node->condition, .parent_file = file };
+					f->step = 1;
+					return true;
+				case 1:
+					EMIT_LITERAL(e, ",\"body\":");
+					*child = (EmitFrame) { .node = (const AST_Node*) whileloop_node->body, .parent_file = file };
+					f->step = 2;
+					return true;
+				case 2:
+					break;
+			}
+		} break;
+		case NODE_WITH: {
+			const AST_With* with_node = (const AST_With*) node;
+			switch (f->step) {
+				case 0:
+					EMIT_LITERAL(e, ",\"contexts\":");
+					if (!with_node->contexts) {
+						EMIT_LITERAL(e, "null");
+					}
+					else emit_char(e, '[');
+					f->index = 0;
+					// fallthrough
+				case 1:
+					if (f->index < arrlen(with_node->contexts)) {
+						int i = f->index;
+						if (i) emit_char(e, ',');
+						*child = (EmitFrame) { .node = (const AST_Node*) with_node->contexts[i], .parent_file = file };
+						f->step = 1;
+						f->index++;
+						return true;
+					}
+					if (with_node->contexts) emit_char(e, ']');
+					break;
+			}
+		} break;
+		default: break;
+	}
+	emit_char(e, '}');
+	return false;
+}
@@ -0,0 +1,72 @@
+XMAC(NODE_QUALNAME)
+XMAC(NODE_NAME)
+XMAC(NODE_INT)
+XMAC(NODE_FLOAT)
+XMAC(NODE_BOOL)
+XMAC(NODE_STRING)
+XMAC(NODE_CHAR)
+XMAC(NODE_NULL)
+XMAC(NODE_BLOCK)
+XMAC(NODE_IMPORT)
+XMAC(NODE_PARAM)
+XMAC(NODE_FUNC_DEF)
+XMAC(NODE_MACRO)
+XMAC(NODE_FUNC_OVERLOAD)
+XMAC(NODE_CONST)
+XMAC(NODE_FIELD)
+XMAC(NODE_STRUCT)
+XMAC(NODE_ENUM_VALUE)
+XMAC(NODE_ENUM)
+XMAC(NODE_TEST)
+XMAC(NODE_RUN)
+XMAC(NODE_WARN)
+XMAC(NODE_MODULE)
+XMAC(NODE_BINOP)
+XMAC(NODE_COMPARISON)
+XMAC(NODE_UNARY)
+XMAC(NODE_NOT)
+XMAC(NODE_AND)
+XMAC(NODE_OR)
+XMAC(NODE_TERNARY)
+XMAC(NODE_REREFERENCE)
+XMAC(NODE_BROADCAST)
+XMAC(NODE_ASYNC)
+XMAC(NODE_AWAIT)
+XMAC(NODE_ARRAY)
+XMAC(NODE_ARRAY_COMP)
+XMAC(NODE_ARRAY_RANGE)
+XMAC(NODE_PACKED_ARRAY)
+XMAC(NODE_FUNC_CALL)
+XMAC(NODE_SLICE)
+XMAC(NODE_SUBSCRIPT)
+XMAC(NODE_FIELD_ACCESS)
+XMAC(NODE_SIMPLE_TYPE)
+XMAC(NODE_POINTER_TYPE)
+XMAC(NODE_MUTABLE_TYPE)
+XMAC(NODE_OPTIONAL_TYPE)
+XMAC(NODE_ARRAY_TYPE)
+XMAC(NODE_FUNC_TYPE)
+XMAC(NODE_TEMPLATE_TYPE)
+XMAC(NODE_UNION)
+XMAC(NODE_VAR_DECL)
+XMAC(NODE_OP_ASSIGN)
+XMAC(NODE_ASSIGN)
+XMAC(NODE_ASSIGN_MANY)
+XMAC(NODE_IF_STMT)
+XMAC(NODE_WHILE_LOOP)
+XMAC(NODE_FOR_SIMPLE)
+XMAC(NODE_FOR_RANGE)
+XMAC(NODE_FOR_PARALLEL)
+XMAC(NODE_FOR_LOOP)
+XMAC(NODE_MATCH_CASE)
+XMAC(NODE_MATCH)
+XMAC(NODE_CONTEXT)
+XMAC(NODE_WITH)
+XMAC(NODE_RETURN)
+XMAC(NODE_BREAK)
+XMAC(NODE_SKIP)
+XMAC(NODE_FAIL)
+XMAC(NODE_ASSERT)
+XMAC(NODE_CONTRACT)
+XMAC(NODE_DEFER)
+XMAC(NODE_CANCEL)
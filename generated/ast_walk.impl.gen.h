@@ -0,0 +1,327 @@
+static const AST_ChildField FIELDS_NODE_QUALNAME[] = {
+	{ offsetof(AST_Qualname, parts), AST_CHILD_VALUE_ARRAY },
+};
+static const AST_ChildField FIELDS_NODE_BLOCK[] = {
+	{ offsetof(AST_Block, body), AST_CHILD_ARRAY },
+};
+static const AST_ChildField FIELDS_NODE_IMPORT[] = {
+	{ offsetof(AST_Import, local_name), AST_CHILD_NODE },
+	{ offsetof(AST_Import, qualified_name), AST_CHILD_NODE },
+};
+static const AST_ChildField FIELDS_NODE_PARAM[] = {
+	{ offsetof(AST_Param, name), AST_CHILD_NODE },
+	{ offsetof(AST_Param, type), AST_CHILD_NODE },
+	{ offsetof(AST_Param, default_value), AST_CHILD_NODE },
+};
+static const AST_ChildField FIELDS_NODE_FUNC_DEF[] = {
+	{ offsetof(AST_FuncDef, name), AST_CHILD_NODE },
+	{ offsetof(AST_FuncDef, params), AST_CHILD_MAP },
+	{ offsetof(AST_FuncDef, ret_type), AST_CHILD_NODE },
+	{ offsetof(AST_FuncDef, body), AST_CHILD_NODE },
+};
+static const AST_ChildField FIELDS_NODE_MACRO[] = {
+	{ offsetof(AST_Macro, name), AST_CHILD_NODE },
+	{ offsetof(AST_Macro, params), AST_CHILD_MAP },
+	{ offsetof(AST_Macro, expansion), AST_CHILD_NODE },
+};
+static const AST_ChildField FIELDS_NODE_FUNC_OVERLOAD[] = {
+	{ offsetof(AST_FuncOverload, name), AST_CHILD_NODE },
+	{ offsetof(AST_FuncOverload, overloads), AST_CHILD_ARRAY },
+};
+static const AST_ChildField FIELDS_NODE_CONST[] = {
+	{ offsetof(AST_Const, name), AST_CHILD_NODE },
+	{ offsetof(AST_Const, type), AST_CHILD_NODE },
+	{ offsetof(AST_Const, value), AST_CHILD_NODE },
+};
+static const AST_ChildField FIELDS_NODE_FIELD[] = {
+	{ offsetof(AST_Field, name), AST_CHILD_NODE },
+	{ offsetof(AST_Field, type), AST_CHILD_NODE },
+	{ offsetof(AST_Field, default_value), AST_CHILD_NODE },
+	{ offsetof(AST_Field, invariant), AST_CHILD_NODE },
+};
+static const AST_ChildField FIELDS_NODE_STRUCT[] = {
+	{ offsetof(AST_Struct, name), AST_CHILD_NODE },
+	{ offsetof(AST_Struct, constraints), AST_CHILD_ARRAY },
+	{ offsetof(AST_Struct, fields), AST_CHILD_MAP },
+};
+static const AST_ChildField FIELDS_NODE_ENUM_VALUE[] = {
+	{ offsetof(AST_EnumValue, name), AST_CHILD_NODE },
+	{ offsetof(AST_EnumValue, value), AST_CHILD_NODE },
+};
+static const AST_ChildField FIELDS_NODE_ENUM[] = {
+	{ offsetof(AST_Enum, name), AST_CHILD_NODE },
+	{ offsetof(AST_Enum, fields), AST_CHILD_MAP },
+};
+static const AST_ChildField FIELDS_NODE_TEST[] = {
+	{ offsetof(AST_Test, description), AST_CHILD_NODE },
+	{ offsetof(AST_Test, body), AST_CHILD_NODE },
+};
+static const AST_ChildField FIELDS_NODE_RUN[] = {
+	{ offsetof(AST_Run, statement), AST_CHILD_NODE },
+};
+static const AST_ChildField FIELDS_NODE_MODULE[] = {
+	{ offsetof(AST_Module, scope), AST_CHILD_MAP },
+	{ offsetof(AST_Module, tests), AST_CHILD_ARRAY },
+};
+static const AST_ChildField FIELDS_NODE_BINOP[] = {
+	{ offsetof(AST_Binop, lhs), AST_CHILD_NODE },
+	{ offsetof(AST_Binop, rhs), AST_CHILD_NODE },
+};
+static const AST_ChildField FIELDS_NODE_COMPARISON[] = {
+	{ offsetof(AST_ComparisonChain, comparisons), AST_CHILD_VALUE_ARRAY },
+	{ offsetof(AST_ComparisonChain, operands), AST_CHILD_ARRAY },
+};
+static const AST_ChildField FIELDS_NODE_UNARY[] = {
+	{ offsetof(AST_Unary, expr), AST_CHILD_NODE },
+};
+static const AST_ChildField FIELDS_NODE_NOT[] = {
+	{ offsetof(AST_Not, expr), AST_CHILD_NODE },
+};
+static const AST_ChildField FIELDS_NODE_AND[] = {
+	{ offsetof(AST_And, lhs), AST_CHILD_NODE },
+	{ offsetof(AST_And, rhs), AST_CHILD_NODE },
+};
+static const AST_ChildField FIELDS_NODE_OR[] = {
+	{ offsetof(AST_Or, lhs), AST_CHILD_NODE },
+	{ offsetof(AST_Or, rhs), AST_CHILD_NODE },
+};
+static const AST_ChildField FIELDS_NODE_TERNARY[] = {
+	{ offsetof(AST_Ternary, condition), AST_CHILD_NODE },
+	{ offsetof(AST_Ternary, true_expr), AST_CHILD_NODE },
+	{ offsetof(AST_Ternary, false_expr), AST_CHILD_NODE },
+};
+static const AST_ChildField FIELDS_NODE_REREFERENCE[] = {
+	{ offsetof(AST_Reref, target), AST_CHILD_NODE },
+};
+static const AST_ChildField FIELDS_NODE_BROADCAST[] = {
+	{ offsetof(AST_Broadcast, target), AST_CHILD_NODE },
+};
+static const AST_ChildField FIELDS_NODE_ASYNC[] = {
+	{ offsetof(AST_Async, target), AST_CHILD_NODE },
+};
+static const AST_ChildField FIELDS_NODE_AWAIT[] = {
+	{ offsetof(AST_Await, target), AST_CHILD_NODE },
+};
+static const AST_ChildField FIELDS_NODE_ARRAY[] = {
+	{ offsetof(AST_ArrayLiteral, elements), AST_CHILD_ARRAY },
+};
+static const AST_ChildField FIELDS_NODE_ARRAY_COMP[] = {
+	{ offsetof(AST_ArrayComprehension, element), AST_CHILD_NODE },
+	{ offsetof(AST_ArrayComprehension, range), AST_CHILD_NODE },
+	{ offsetof(AST_ArrayComprehension, filter), AST_CHILD_NODE },
+};
+static const AST_ChildField FIELDS_NODE_ARRAY_RANGE[] = {
+	{ offsetof(AST_ArrayRange, start), AST_CHILD_NODE },
+	{ offsetof(AST_ArrayRange, end), AST_CHILD_NODE },
+	{ offsetof(AST_ArrayRange, step), AST_CHILD_NODE },
+};
+static const AST_ChildField FIELDS_NODE_PACKED_ARRAY[] = {
+	{ offsetof(AST_PackedArray, shape), AST_CHILD_VALUE_ARRAY },
+	{ offsetof(AST_PackedArray, ints), AST_CHILD_VALUE_ARRAY },
+	{ offsetof(AST_PackedArray, floats), AST_CHILD_VALUE_ARRAY },
+};
+static const AST_ChildField FIELDS_NODE_FUNC_CALL[] = {
+	{ offsetof(AST_FuncCall, func), AST_CHILD_NODE },
+	{ offsetof(AST_FuncCall, pos_args), AST_CHILD_ARRAY },
+	{ offsetof(AST_FuncCall, kw_args), AST_CHILD_MAP },
+};
+static const AST_ChildField FIELDS_NODE_SLICE[] = {
+	{ offsetof(AST_Slice, start), AST_CHILD_NODE },
+	{ offsetof(AST_Slice, end), AST_CHILD_NODE },
+	{ offsetof(AST_Slice, step), AST_CHILD_NODE },
+};
+static const AST_ChildField FIELDS_NODE_SUBSCRIPT[] = {
+	{ offsetof(AST_Subscript, array), AST_CHILD_NODE },
+	{ offsetof(AST_Subscript, subscripts), AST_CHILD_ARRAY },
+};
+static const AST_ChildField FIELDS_NODE_FIELD_ACCESS[] = {
+	{ offsetof(AST_FieldAccess, base), AST_CHILD_NODE },
+	{ offsetof(AST_FieldAccess, field), AST_CHILD_NODE },
+};
+static const AST_ChildField FIELDS_NODE_SIMPLE_TYPE[] = {
+	{ offsetof(AST_SimpleType, base), AST_CHILD_NODE },
+};
+static const AST_ChildField FIELDS_NODE_POINTER_TYPE[] = {
+	{ offsetof(AST_PointerType, base), AST_CHILD_NODE },
+};
+static const AST_ChildField FIELDS_NODE_MUTABLE_TYPE[] = {
+	{ offsetof(AST_MutableType, base), AST_CHILD_NODE },
+};
+static const AST_ChildField FIELDS_NODE_OPTIONAL_TYPE[] = {
+	{ offsetof(AST_OptionalType, base), AST_CHILD_NODE },
+};
+static const AST_ChildField FIELDS_NODE_ARRAY_TYPE[] = {
+	{ offsetof(AST_ArrayType, element_type), AST_CHILD_NODE },
+	{ offsetof(AST_ArrayType, shape), AST_CHILD_ARRAY },
+};
+static const AST_ChildField FIELDS_NODE_FUNC_TYPE[] = {
+	{ offsetof(AST_FuncType, param_types), AST_CHILD_ARRAY },
+	{ offsetof(AST_FuncType, return_type), AST_CHILD_NODE },
+};
+static const AST_ChildField FIELDS_NODE_TEMPLATE_TYPE[] = {
+	{ offsetof(AST_TemplateType, arguments), AST_CHILD_ARRAY },
+};
+static const AST_ChildField FIELDS_NODE_UNION[] = {
+	{ offsetof(AST_UnionType, variants), AST_CHILD_ARRAY },
+};
+static const AST_ChildField FIELDS_NODE_VAR_DECL[] = {
+	{ offsetof(AST_VarDecl, name), AST_CHILD_NODE },
+	{ offsetof(AST_VarDecl, type), AST_CHILD_NODE },
+	{ offsetof(AST_VarDecl, value), AST_CHILD_NODE },
+};
+static const AST_ChildField FIELDS_NODE_OP_ASSIGN[] = {
+	{ offsetof(AST_OpAssign, dest_expr), AST_CHILD_NODE },
+	{ offsetof(AST_OpAssign, src_expr), AST_CHILD_NODE },
+};
+static const AST_ChildField FIELDS_NODE_ASSIGN[] = {
+	{ offsetof(AST_AssignChain, dest_exprs), AST_CHILD_ARRAY },
+	{ offsetof(AST_AssignChain, src_expr), AST_CHILD_NODE },
+};
+static const AST_ChildField FIELDS_NODE_ASSIGN_MANY[] = {
+	{ offsetof(AST_AssignParallel, dest_exprs), AST_CHILD_ARRAY },
+	{ offsetof(AST_AssignParallel, src_exprs), AST_CHILD_ARRAY },
+};
+static const AST_ChildField FIELDS_NODE_IF_STMT[] = {
+	{ offsetof(AST_IfStatement, condition), AST_CHILD_NODE },
+	{ offsetof(AST_IfStatement, body), AST_CHILD_NODE },
+	{ offsetof(AST_IfStatement, alternative), AST_CHILD_NODE },
+};
+static const AST_ChildField FIELDS_NODE_WHILE_LOOP[] = {
+	{ offsetof(AST_WhileLoop, condition), AST_CHILD_NODE },
+	{ offsetof(AST_WhileLoop, body), AST_CHILD_NODE },
+};
+static const AST_ChildField FIELDS_NODE_FOR_SIMPLE[] = {
+	{ offsetof(AST_ForSimple, name), AST_CHILD_NODE },
+	{ offsetof(AST_ForSimple, iterable), AST_CHILD_NODE },
+};
+static const AST_ChildField FIELDS_NODE_FOR_RANGE[] = {
+	{ offsetof(AST_ForRange, name), AST_CHILD_NODE },
+	{ offsetof(AST_ForRange, start), AST_CHILD_NODE },
+	{ offsetof(AST_ForRange, end), AST_CHILD_NODE },
+	{ offsetof(AST_ForRange, step), AST_CHILD_NODE },
+};
+static const AST_ChildField FIELDS_NODE_FOR_PARALLEL[] = {
+	{ offsetof(AST_ForParallel, names), AST_CHILD_ARRAY },
+	{ offsetof(AST_ForParallel, zips), AST_CHILD_MAP },
+};
+static const AST_ChildField FIELDS_NODE_FOR_LOOP[] = {
+	{ offsetof(AST_ForLoop, iterables), AST_CHILD_ARRAY },
+	{ offsetof(AST_ForLoop, label), AST_CHILD_NODE },
+	{ offsetof(AST_ForLoop, body), AST_CHILD_NODE },
+};
+static const AST_ChildField FIELDS_NODE_MATCH_CASE[] = {
+	{ offsetof(AST_MatchCase, patterns), AST_CHILD_ARRAY },
+	{ offsetof(AST_MatchCase, body), AST_CHILD_NODE },
+};
+static const AST_ChildField FIELDS_NODE_MATCH[] = {
+	{ offsetof(AST_Match, patterns), AST_CHILD_ARRAY },
+};
+static const AST_ChildField FIELDS_NODE_CONTEXT[] = {
+	{ offsetof(AST_Context, name), AST_CHILD_NODE },
+	{ offsetof(AST_Context, value), AST_CHILD_NODE },
+};
+static const AST_ChildField FIELDS_NODE_WITH[] = {
+	{ offsetof(AST_With, contexts), AST_CHILD_ARRAY },
+};
+static const AST_ChildField FIELDS_NODE_RETURN[] = {
+	{ offsetof(AST_Return, value), AST_CHILD_NODE },
+};
+static const AST_ChildField FIELDS_NODE_BREAK[] = {
+	{ offsetof(AST_Break, label), AST_CHILD_NODE },
+};
+static const AST_ChildField FIELDS_NODE_SKIP[] = {
+	{ offsetof(AST_Skip, label), AST_CHILD_NODE },
+};
+static const AST_ChildField FIELDS_NODE_FAIL[] = {
+	{ offsetof(AST_Fail, value), AST_CHILD_NODE },
+	{ offsetof(AST_Fail, message), AST_CHILD_NODE },
+};
+static const AST_ChildField FIELDS_NODE_ASSERT[] = {
+	{ offsetof(AST_Assert, value), AST_CHILD_NODE },
+	{ offsetof(AST_Assert, message), AST_CHILD_NODE },
+};
+static const AST_ChildField FIELDS_NODE_CONTRACT[] = {
+	{ offsetof(AST_Contract, condition), AST_CHILD_NODE },
+};
+static const AST_ChildField FIELDS_NODE_DEFER[] = {
+	{ offsetof(AST_Defer, code), AST_CHILD_NODE },
+};
+static const AST_ChildField FIELDS_NODE_CANCEL[] = {
+	{ offsetof(AST_Cancel, target), AST_CHILD_NODE },
+};
+
+const AST_NodeLayout AST_LAYOUT[NODE_MAX] = {
+	[NODE_EMPTY] = { sizeof(AST_Node), 0, NULL },
+	[NODE_QUALNAME] = { sizeof(AST_Qualname), 1, FIELDS_NODE_QUALNAME },
+	[NODE_NAME] = { sizeof(AST_Name), 0, NULL },
+	[NODE_INT] = { sizeof(AST_Int), 0, NULL },
+	[NODE_FLOAT] = { sizeof(AST_Float), 0, NULL },
+	[NODE_BOOL] = { sizeof(AST_Bool), 0, NULL },
+	[NODE_STRING] = { sizeof(AST_String), 0, NULL },
+	[NODE_CHAR] = { sizeof(AST_Char), 0, NULL },
+	[NODE_NULL] = { sizeof(AST_Null), 0, NULL },
+	[NODE_BLOCK] = { sizeof(AST_Block), 1, FIELDS_NODE_BLOCK },
+	[NODE_IMPORT] = { sizeof(AST_Import), 2, FIELDS_NODE_IMPORT },
+	[NODE_PARAM] = { sizeof(AST_Param), 3, FIELDS_NODE_PARAM },
+	[NODE_FUNC_DEF] = { sizeof(AST_FuncDef), 4, FIELDS_NODE_FUNC_DEF },
+	[NODE_MACRO] = { sizeof(AST_Macro), 3, FIELDS_NODE_MACRO },
+	[NODE_FUNC_OVERLOAD] = { sizeof(AST_FuncOverload), 2, FIELDS_NODE_FUNC_OVERLOAD },
+	[NODE_CONST] = { sizeof(AST_Const), 3, FIELDS_NODE_CONST },
+	[NODE_FIELD] = { sizeof(AST_Field), 4, FIELDS_NODE_FIELD },
+	[NODE_STRUCT] = { sizeof(AST_Struct), 3, FIELDS_NODE_STRUCT },
+	[NODE_ENUM_VALUE] = { sizeof(AST_EnumValue), 2, FIELDS_NODE_ENUM_VALUE },
+	[NODE_ENUM] = { sizeof(AST_Enum), 2, FIELDS_NODE_ENUM },
+	[NODE_TEST] = { sizeof(AST_Test), 2, FIELDS_NODE_TEST },
+	[NODE_RUN] = { sizeof(AST_Run), 1, FIELDS_NODE_RUN },
+	[NODE_WARN] = { sizeof(AST_Warn), 0, NULL },
+	[NODE_MODULE] = { sizeof(AST_Module), 2, FIELDS_NODE_MODULE },
+	[NODE_BINOP] = { sizeof(AST_Binop), 2, FIELDS_NODE_BINOP },
+	[NODE_COMPARISON] = { sizeof(AST_ComparisonChain), 2, FIELDS_NODE_COMPARISON },
+	[NODE_UNARY] = { sizeof(AST_Unary), 1, FIELDS_NODE_UNARY },
+	[NODE_NOT] = { sizeof(AST_Not), 1, FIELDS_NODE_NOT },
+	[NODE_AND] = { sizeof(AST_And), 2, FIELDS_NODE_AND },
+	[NODE_OR] = { sizeof(AST_Or), 2, FIELDS_NODE_OR },
+	[NODE_TERNARY] = { sizeof(AST_Ternary), 3, FIELDS_NODE_TERNARY },
+	[NODE_REREFERENCE] = { sizeof(AST_Reref), 1, FIELDS_NODE_REREFERENCE },
+	[NODE_BROADCAST] = { sizeof(AST_Broadcast), 1, FIELDS_NODE_BROADCAST },
+	[NODE_ASYNC] = { sizeof(AST_Async), 1, FIELDS_NODE_ASYNC },
+	[NODE_AWAIT] = { sizeof(AST_Await), 1, FIELDS_NODE_AWAIT },
+	[NODE_ARRAY] = { sizeof(AST_ArrayLiteral), 1, FIELDS_NODE_ARRAY },
+	[NODE_ARRAY_COMP] = { sizeof(AST_ArrayComprehension), 3, FIELDS_NODE_ARRAY_COMP },
+	[NODE_ARRAY_RANGE] = { sizeof(AST_ArrayRange), 3, FIELDS_NODE_ARRAY_RANGE },
+	[NODE_PACKED_ARRAY] = { sizeof(AST_PackedArray), 3, FIELDS_NODE_PACKED_ARRAY },
+	[NODE_FUNC_CALL] = { sizeof(AST_FuncCall), 3, FIELDS_NODE_FUNC_CALL },
+	[NODE_SLICE] = { sizeof(AST_Slice), 3, FIELDS_NODE_SLICE },
+	[NODE_SUBSCRIPT] = { sizeof(AST_Subscript), 2, FIELDS_NODE_SUBSCRIPT },
+	[NODE_FIELD_ACCESS] = { sizeof(AST_FieldAccess), 2, FIELDS_NODE_FIELD_ACCESS },
+	[NODE_SIMPLE_TYPE] = { sizeof(AST_SimpleType), 1, FIELDS_NODE_SIMPLE_TYPE },
+	[NODE_POINTER_TYPE] = { sizeof(AST_PointerType), 1, FIELDS_NODE_POINTER_TYPE },
+	[NODE_MUTABLE_TYPE] = { sizeof(AST_MutableType), 1, FIELDS_NODE_MUTABLE_TYPE },
+	[NODE_OPTIONAL_TYPE] = { sizeof(AST_OptionalType), 1, FIELDS_NODE_OPTIONAL_TYPE },
+	[NODE_ARRAY_TYPE] = { sizeof(AST_ArrayType), 2, FIELDS_NODE_ARRAY_TYPE },
+	[NODE_FUNC_TYPE] = { sizeof(AST_FuncType), 2, FIELDS_NODE_FUNC_TYPE },
+	[NODE_TEMPLATE_TYPE] = { sizeof(AST_TemplateType), 1, FIELDS_NODE_TEMPLATE_TYPE },
+	[NODE_UNION] = { sizeof(AST_UnionType), 1, FIELDS_NODE_UNION },
+	[NODE_VAR_DECL] = { sizeof(AST_VarDecl), 3, FIELDS_NODE_VAR_DECL },
+	[NODE_OP_ASSIGN] = { sizeof(AST_OpAssign), 2, FIELDS_NODE_OP_ASSIGN },
+	[NODE_ASSIGN] = { sizeof(AST_AssignChain), 2, FIELDS_NODE_ASSIGN },
+	[NODE_ASSIGN_MANY] = { sizeof(AST_AssignParallel), 2, FIELDS_NODE_ASSIGN_MANY },
+	[NODE_IF_STMT] = { sizeof(AST_IfStatement), 3, FIELDS_NODE_IF_STMT },
+	[NODE_WHILE_LOOP] = { sizeof(AST_WhileLoop), 2, FIELDS_NODE_WHILE_LOOP },
+	[NODE_FOR_SIMPLE] = { sizeof(AST_ForSimple), 2, FIELDS_NODE_FOR_SIMPLE },
+	[NODE_FOR_RANGE] = { sizeof(AST_ForRange), 4, FIELDS_NODE_FOR_RANGE },
+	[NODE_FOR_PARALLEL] = { sizeof(AST_ForParallel), 2, FIELDS_NODE_FOR_PARALLEL },
+	[NODE_FOR_LOOP] = { sizeof(AST_ForLoop), 3, FIELDS_NODE_FOR_LOOP },
+	[NODE_MATCH_CASE] = { sizeof(AST_MatchCase), 2, FIELDS_NODE_MATCH_CASE },
+	[NODE_MATCH] = { sizeof(AST_Match), 1, FIELDS_NODE_MATCH },
+	[NODE_CONTEXT] = { sizeof(AST_Context), 2, FIELDS_NODE_CONTEXT },
+	[NODE_WITH] = { sizeof(AST_With), 1, FIELDS_NODE_WITH },
+	[NODE_RETURN] = { sizeof(AST_Return), 1, FIELDS_NODE_RETURN },
+	[NODE_BREAK] = { sizeof(AST_Break), 1, FIELDS_NODE_BREAK },
+	[NODE_SKIP] = { sizeof(AST_Skip), 1, FIELDS_NODE_SKIP },
+	[NODE_FAIL] = { sizeof(AST_Fail), 2, FIELDS_NODE_FAIL },
+	[NODE_ASSERT] = { sizeof(AST_Assert), 2, FIELDS_NODE_ASSERT },
+	[NODE_CONTRACT] = { sizeof(AST_Contract), 1, FIELDS_NODE_CONTRACT },
+	[NODE_DEFER] = { sizeof(AST_Defer), 1, FIELDS_NODE_DEFER },
+	[NODE_CANCEL] = { sizeof(AST_Cancel), 1, FIELDS_NODE_CANCEL },
+};
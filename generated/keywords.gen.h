@@ -0,0 +1,79 @@
+#pragma once
+typedef enum {
+    KW_NONE = 0,
+	KW_IMPORT = 0x101,
+	KW_PUB = 0x102,
+	KW_STRUCT = 0x103,
+	KW_ENUM = 0x104,
+	KW_TABLE = 0x105,
+	KW_CONST = 0x106,
+	KW_TYPE = 0x107,
+	KW_MUT = 0x108,
+	KW_OPT = 0x109,
+	KW_FUNC = 0x10a,
+	KW_ASSERT = 0x10b,
+	KW_RETURN = 0x10c,
+	KW_YIELD = 0x10d,
+	KW_FAIL = 0x10e,
+	KW_ASYNC = 0x10f,
+	KW_AWAIT = 0x110,
+	KW_CANCEL = 0x111,
+	KW_DEFER = 0x112,
+	KW_GOTO = 0x113,
+	KW_IF = 0x114,
+	KW_ELSE = 0x115,
+	KW_MATCH = 0x116,
+	KW_FOR = 0x117,
+	KW_WHILE = 0x118,
+	KW_BREAK = 0x119,
+	KW_SKIP = 0x11a,
+	KW_WITH = 0x11b,
+	KW_USING = 0x11c,
+	KW_ALIAS = 0x11d,
+	KW_AND = 0x11e,
+	KW_OR = 0x11f,
+	KW_NOT = 0x120,
+} Keyword;
+Keyword str_to_kw(const char* str);
+const char* kw_to_str(Keyword kw);
+typedef enum {
+    DIR_NONE = 0,
+    DIR_UNKNOWN = 0x10000,
+	DIR_ALLOW_ALIAS = 0x10001,
+	DIR_ASSERT = 0x10002,
+	DIR_ASSUME = 0x10003,
+	DIR_AUTO = 0x10004,
+	DIR_CLOSURE = 0x10005,
+	DIR_CONSTRAINT = 0x10006,
+	DIR_DEFAULT = 0x10007,
+	DIR_DENSE = 0x10008,
+	DIR_ELIF = 0x10009,
+	DIR_ELSE = 0x1000a,
+	DIR_EVAL = 0x1000b,
+	DIR_FLAG = 0x1000c,
+	DIR_FOR = 0x1000d,
+	DIR_GPU = 0x1000e,
+	DIR_ID = 0x1000f,
+	DIR_IF = 0x10010,
+	DIR_INLINE = 0x10011,
+	DIR_INVARIANT = 0x10012,
+	DIR_LABEL = 0x10013,
+	DIR_MACRO = 0x10014,
+	DIR_NOINLINE = 0x10015,
+	DIR_OVERLOAD = 0x10016,
+	DIR_OWNED = 0x10017,
+	DIR_PARALLEL = 0x10018,
+	DIR_PATCH = 0x10019,
+	DIR_POST = 0x1001a,
+	DIR_PRE = 0x1001b,
+	DIR_READ = 0x1001c,
+	DIR_RUN = 0x1001d,
+	DIR_SPARSE = 0x1001e,
+	DIR_TEST = 0x1001f,
+	DIR_UNDEF = 0x10020,
+	DIR_WARN = 0x10021,
+	DIR_YIELD = 0x10022,
+	DIR_ZERO = 0x10023,
+} Directive;
+Directive str_to_dir(const char* str);
+const char* dir_to_str(Directive kw);
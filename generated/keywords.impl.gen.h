@@ -0,0 +1,246 @@
+#include <string.h>
+Keyword str_to_kw(const char* str) {
+	int import_check = strcmp(str, "import");
+	if (import_check < 0) {
+		int defer_check = strcmp(str, "defer");
+		if (defer_check < 0) {
+			int await_check = strcmp(str, "await");
+			if (await_check < 0) {
+				int assert_check = strcmp(str, "assert");
+				if (assert_check < 0) {
+					if (strcmp(str, "alias") == 0) return KW_ALIAS;
+					if (strcmp(str, "and") == 0) return KW_AND;
+				}
+				else if (assert_check == 0) return KW_ASSERT;
+				else {
+					if (strcmp(str, "async") == 0) return KW_ASYNC;
+				}
+			}
+			else if (await_check == 0) return KW_AWAIT;
+			else {
+				if (strcmp(str, "break") == 0) return KW_BREAK;
+				if (strcmp(str, "cancel") == 0) return KW_CANCEL;
+				if (strcmp(str, "const") == 0) return KW_CONST;
+			}
+		}
+		else if (defer_check == 0) return KW_DEFER;
+		else {
+			int for_check = strcmp(str, "for");
+			if (for_check < 0) {
+				if (strcmp(str, "else") == 0) return KW_ELSE;
+				if (strcmp(str, "enum") == 0) return KW_ENUM;
+				if (strcmp(str, "fail") == 0) return KW_FAIL;
+			}
+			else if (for_check == 0) return KW_FOR;
+			else {
+				if (strcmp(str, "func") == 0) return KW_FUNC;
+				if (strcmp(str, "goto") == 0) return KW_GOTO;
+				if (strcmp(str, "if") == 0) return KW_IF;
+			}
+		}
+	}
+	else if (import_check == 0) return KW_IMPORT;
+	else {
+		int skip_check = strcmp(str, "skip");
+		if (skip_check < 0) {
+			int opt_check = strcmp(str, "opt");
+			if (opt_check < 0) {
+				if (strcmp(str, "match") == 0) return KW_MATCH;
+				if (strcmp(str, "mut") == 0) return KW_MUT;
+				if (strcmp(str, "not") == 0) return KW_NOT;
+			}
+			else if (opt_check == 0) return KW_OPT;
+			else {
+				if (strcmp(str, "or") == 0) return KW_OR;
+				if (strcmp(str, "pub") == 0) return KW_PUB;
+				if (strcmp(str, "return") == 0) return KW_RETURN;
+			}
+		}
+		else if (skip_check == 0) return KW_SKIP;
+		else {
+			int using_check = strcmp(str, "using");
+			if (using_check < 0) {
+				if (strcmp(str, "struct") == 0) return KW_STRUCT;
+				if (strcmp(str, "table") == 0) return KW_TABLE;
+				if (strcmp(str, "type") == 0) return KW_TYPE;
+			}
+			else if (using_check == 0) return KW_USING;
+			else {
+				if (strcmp(str, "while") == 0) return KW_WHILE;
+				if (strcmp(str, "with") == 0) return KW_WITH;
+				if (strcmp(str, "yield") == 0) return KW_YIELD;
+			}
+		}
+	}
+	return KW_NONE;
+}
+const char* kw_to_str(Keyword kw) {
+	switch (kw) {
+		case KW_ALIAS: return "alias";
+		case KW_AND: return "and";
+		case KW_ASSERT: return "assert";
+		case KW_ASYNC: return "async";
+		case KW_AWAIT: return "await";
+		case KW_BREAK: return "break";
+		case KW_CANCEL: return "cancel";
+		case KW_CONST: return "const";
+		case KW_DEFER: return "defer";
+		case KW_ELSE: return "else";
+		case KW_ENUM: return "enum";
+		case KW_FAIL: return "fail";
+		case KW_FOR: return "for";
+		case KW_FUNC: return "func";
+		case KW_GOTO: return "goto";
+		case KW_IF: return "if";
+		case KW_IMPORT: return "import";
+		case KW_MATCH: return "match";
+		case KW_MUT: return "mut";
+		case KW_NOT: return "not";
+		case KW_OPT: return "opt";
+		case KW_OR: return "or";
+		case KW_PUB: return "pub";
+		case KW_RETURN: return "return";
+		case KW_SKIP: return "skip";
+		case KW_STRUCT: return "struct";
+		case KW_TABLE: return "table";
+		case KW_TYPE: return "type";
+		case KW_USING: return "using";
+		case KW_WHILE: return "while";
+		case KW_WITH: return "with";
+		case KW_YIELD: return "yield";
+		default: return "<ERROR>";
+	}
+}
+Directive str_to_dir(const char* str) {
+	int invariant_check = strcmp(str, "invariant");
+	if (invariant_check < 0) {
+		int elif_check = strcmp(str, "elif");
+		if (elif_check < 0) {
+			int closure_check = strcmp(str, "closure");
+			if (closure_check < 0) {
+				int assume_check = strcmp(str, "assume");
+				if (assume_check < 0) {
+					if (strcmp(str, "allow_alias") == 0) return DIR_ALLOW_ALIAS;
+					if (strcmp(str, "assert") == 0) return DIR_ASSERT;
+				}
+				else if (assume_check == 0) return DIR_ASSUME;
+				else {
+					if (strcmp(str, "auto") == 0) return DIR_AUTO;
+				}
+			}
+			else if (closure_check == 0) return DIR_CLOSURE;
+			else {
+				if (strcmp(str, "constraint") == 0) return DIR_CONSTRAINT;
+				if (strcmp(str, "default") == 0) return DIR_DEFAULT;
+				if (strcmp(str, "dense") == 0) return DIR_DENSE;
+			}
+		}
+		else if (elif_check == 0) return DIR_ELIF;
+		else {
+			int gpu_check = strcmp(str, "gpu");
+			if (gpu_check < 0) {
+				int flag_check = strcmp(str, "flag");
+				if (flag_check < 0) {
+					if (strcmp(str, "else") == 0) return DIR_ELSE;
+					if (strcmp(str, "eval") == 0) return DIR_EVAL;
+				}
+				else if (flag_check == 0) return DIR_FLAG;
+				else {
+					if (strcmp(str, "for") == 0) return DIR_FOR;
+				}
+			}
+			else if (gpu_check == 0) return DIR_GPU;
+			else {
+				if (strcmp(str, "id") == 0) return DIR_ID;
+				if (strcmp(str, "if") == 0) return DIR_IF;
+				if (strcmp(str, "inline") == 0) return DIR_INLINE;
+			}
+		}
+	}
+	else if (invariant_check == 0) return DIR_INVARIANT;
+	else {
+		int pre_check = strcmp(str, "pre");
+		if (pre_check < 0) {
+			int owned_check = strcmp(str, "owned");
+			if (owned_check < 0) {
+				int noinline_check = strcmp(str, "noinline");
+				if (noinline_check < 0) {
+					if (strcmp(str, "label") == 0) return DIR_LABEL;
+					if (strcmp(str, "macro") == 0) return DIR_MACRO;
+				}
+				else if (noinline_check == 0) return DIR_NOINLINE;
+				else {
+					if (strcmp(str, "overload") == 0) return DIR_OVERLOAD;
+				}
+			}
+			else if (owned_check == 0) return DIR_OWNED;
+			else {
+				if (strcmp(str, "parallel") == 0) return DIR_PARALLEL;
+				if (strcmp(str, "patch") == 0) return DIR_PATCH;
+				if (strcmp(str, "post") == 0) return DIR_POST;
+			}
+		}
+		else if (pre_check == 0) return DIR_PRE;
+		else {
+			int undef_check = strcmp(str, "undef");
+			if (undef_check < 0) {
+				int sparse_check = strcmp(str, "sparse");
+				if (sparse_check < 0) {
+					if (strcmp(str, "read") == 0) return DIR_READ;
+					if (strcmp(str, "run") == 0) return DIR_RUN;
+				}
+				else if (sparse_check == 0) return DIR_SPARSE;
+				else {
+					if (strcmp(str, "test") == 0) return DIR_TEST;
+				}
+			}
+			else if (undef_check == 0) return DIR_UNDEF;
+			else {
+				if (strcmp(str, "warn") == 0) return DIR_WARN;
+				if (strcmp(str, "yield") == 0) return DIR_YIELD;
+				if (strcmp(str, "zero") == 0) return DIR_ZERO;
+			}
+		}
+	}
+	return DIR_UNKNOWN;
+}
+const char* dir_to_str(Directive kw) {
+	switch (kw) {
+		case DIR_ALLOW_ALIAS: return "#allow_alias";
+		case DIR_ASSERT: return "#assert";
+		case DIR_ASSUME: return "#assume";
+		case DIR_AUTO: return "#auto";
+		case DIR_CLOSURE: return "#closure";
+		case DIR_CONSTRAINT: return "#constraint";
+		case DIR_DEFAULT: return "#default";
+		case DIR_DENSE: return "#dense";
+		case DIR_ELIF: return "#elif";
+		case DIR_ELSE: return "#else";
+		case DIR_EVAL: return "#eval";
+		case DIR_FLAG: return "#flag";
+		case DIR_FOR: return "#for";
+		case DIR_GPU: return "#gpu";
+		case DIR_ID: return "#id";
+		case DIR_IF: return "#if";
+		case DIR_INLINE: return "#inline";
+		case DIR_INVARIANT: return "#invariant";
+		case DIR_LABEL: return "#label";
+		case DIR_MACRO: return "#macro";
+		case DIR_NOINLINE: return "#noinline";
+		case DIR_OVERLOAD: return "#overload";
+		case DIR_OWNED: return "#owned";
+		case DIR_PARALLEL: return "#parallel";
+		case DIR_PATCH: return "#patch";
+		case DIR_POST: return "#post";
+		case DIR_PRE: return "#pre";
+		case DIR_READ: return "#read";
+		case DIR_RUN: return "#run";
+		case DIR_SPARSE: return "#sparse";
+		case DIR_TEST: return "#test";
+		case DIR_UNDEF: return "#undef";
+		case DIR_WARN: return "#warn";
+		case DIR_YIELD: return "#yield";
+		case DIR_ZERO: return "#zero";
+		default: return "<ERROR>";
+	}
+}
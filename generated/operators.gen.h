@@ -0,0 +1,125 @@
+#pragma once
+
+#define POSTFIX_PRECEDENCE 255
+#define REREF_PRECEDENCE 150
+#define EXP_PRECEDENCE 101
+#define UNARY_PRECEDENCE 99
+#define MULDIV_PRECEDENCE 80
+#define ADDSUB_PRECEDENCE 70
+#define WORD_PRECEDENCE 60
+#define ORELSE_PRECEDENCE 50
+#define TERNARY_PRECEDENCE 40
+#define BAR_PRECEDENCE 30
+#define AWAIT_PRECEDENCE 20
+#define CMP_PRECEDENCE 10
+#define NOT_PRECEDENCE 8
+#define AND_PRECEDENCE 6
+#define OR_PRECEDENCE 4
+#define SEMICOLON_PRECEDENCE 2
+
+typedef enum {
+	EXPR_PREFIX_NONE,
+	EXPR_PREFIX_ATOM,
+	EXPR_PREFIX_UNARY,
+	EXPR_PREFIX_REREF,
+	EXPR_PREFIX_NOT,
+	EXPR_PREFIX_ASYNC,
+	EXPR_PREFIX_AWAIT,
+	EXPR_PREFIX_TYPE,
+	EXPR_PREFIX_PAREN,
+	EXPR_PREFIX_ARRAY,
+	EXPR_PREFIX_BLOCK,
+	EXPR_PREFIX_READ,
+} ExprPrefix;
+
+typedef enum {
+	EXPR_INFIX_END,
+	EXPR_INFIX_NONE,
+	EXPR_INFIX_WORD_OP,
+	EXPR_INFIX_BINOP,
+	EXPR_INFIX_AND,
+	EXPR_INFIX_OR,
+	EXPR_INFIX_COMPARISON,
+	EXPR_INFIX_TERNARY,
+	EXPR_INFIX_CALL,
+	EXPR_INFIX_SUBSCRIPT,
+	EXPR_INFIX_FIELD_ACCESS,
+} ExprInfix;
+
+typedef struct {
+	uint8_t prefix;      // ExprPrefix
+	uint8_t infix;       // ExprInfix
+	uint8_t precedence;  // of the infix form; 0 = by the operator's first char
+	const char* misuse;  // error for the position without an action (NULL = generic)
+} ExprRule;
+
+#define EXPR_RULE_TABLE_SIZE 0x121
+static const ExprRule EXPR_RULES[EXPR_RULE_TABLE_SIZE] = {
+	[TOK_IDENT] = { EXPR_PREFIX_ATOM, EXPR_INFIX_NONE, 0, "Unexpected atom in expression" },
+	[TOK_INT] = { EXPR_PREFIX_ATOM, EXPR_INFIX_NONE, 0, "Unexpected atom in expression" },
+	[TOK_FLOAT] = { EXPR_PREFIX_ATOM, EXPR_INFIX_NONE, 0, "Unexpected atom in expression" },
+	[TOK_BOOL] = { EXPR_PREFIX_ATOM, EXPR_INFIX_NONE, 0, "Unexpected atom in expression" },
+	[TOK_STRING] = { EXPR_PREFIX_ATOM, EXPR_INFIX_NONE, 0, "Unexpected atom in expression" },
+	[TOK_CHAR] = { EXPR_PREFIX_ATOM, EXPR_INFIX_NONE, 0, "Unexpected atom in expression" },
+	[TOK_NULL] = { EXPR_PREFIX_ATOM, EXPR_INFIX_NONE, 0, "Unexpected atom in expression" },
+	[TOK_BACKSLASH] = { EXPR_PREFIX_NONE, EXPR_INFIX_WORD_OP, WORD_PRECEDENCE, "Unexpected backslash" },
+	[TOK_PLUS] = { EXPR_PREFIX_UNARY, EXPR_INFIX_BINOP, ADDSUB_PRECEDENCE, NULL },
+	[TOK_MINUS] = { EXPR_PREFIX_UNARY, EXPR_INFIX_BINOP, ADDSUB_PRECEDENCE, NULL },
+	[TOK_STAR] = { EXPR_PREFIX_UNARY, EXPR_INFIX_BINOP, MULDIV_PRECEDENCE, NULL },
+	[TOK_SLASH] = { EXPR_PREFIX_UNARY, EXPR_INFIX_BINOP, MULDIV_PRECEDENCE, NULL },
+	[TOK_TILDE] = { EXPR_PREFIX_UNARY, EXPR_INFIX_BINOP, ADDSUB_PRECEDENCE, NULL },
+	[TOK_PERCENT] = { EXPR_PREFIX_UNARY, EXPR_INFIX_BINOP, MULDIV_PRECEDENCE, NULL },
+	[TOK_CARET] = { EXPR_PREFIX_UNARY, EXPR_INFIX_BINOP, EXP_PRECEDENCE, NULL },
+	[TOK_AMP] = { EXPR_PREFIX_UNARY, EXPR_INFIX_BINOP, MULDIV_PRECEDENCE, NULL },
+	[TOK_BAR] = { EXPR_PREFIX_UNARY, EXPR_INFIX_BINOP, BAR_PRECEDENCE, NULL },
+	[TOK_QMARK] = { EXPR_PREFIX_UNARY, EXPR_INFIX_BINOP, ORELSE_PRECEDENCE, NULL },
+	[TOK_CUSTOM_OPERATOR] = { EXPR_PREFIX_UNARY, EXPR_INFIX_BINOP, 0, NULL },
+	[TOK_AT] = { EXPR_PREFIX_REREF, EXPR_INFIX_NONE, 0, "Re-referencing must occur before a value" },
+	[KW_NOT] = { EXPR_PREFIX_NOT, EXPR_INFIX_NONE, 0, "Boolean 'not' must precede a value" },
+	[KW_AND] = { EXPR_PREFIX_NONE, EXPR_INFIX_AND, AND_PRECEDENCE, "Boolean 'and' requires an expression to its left" },
+	[KW_OR] = { EXPR_PREFIX_NONE, EXPR_INFIX_OR, OR_PRECEDENCE, "Boolean 'or' requires an expression to its left" },
+	[TOK_EQ] = { EXPR_PREFIX_NONE, EXPR_INFIX_COMPARISON, CMP_PRECEDENCE, "Comparison operator is missing left side expression" },
+	[TOK_NE] = { EXPR_PREFIX_NONE, EXPR_INFIX_COMPARISON, CMP_PRECEDENCE, "Comparison operator is missing left side expression" },
+	[TOK_LT] = { EXPR_PREFIX_NONE, EXPR_INFIX_COMPARISON, CMP_PRECEDENCE, "Comparison operator is missing left side expression" },
+	[TOK_LE] = { EXPR_PREFIX_NONE, EXPR_INFIX_COMPARISON, CMP_PRECEDENCE, "Comparison operator is missing left side expression" },
+	[TOK_GT] = { EXPR_PREFIX_NONE, EXPR_INFIX_COMPARISON, CMP_PRECEDENCE, "Comparison operator is missing left side expression" },
+	[TOK_GE] = { EXPR_PREFIX_NONE, EXPR_INFIX_COMPARISON, CMP_PRECEDENCE, "Comparison operator is missing left side expression" },
+	[KW_IF] = { EXPR_PREFIX_NONE, EXPR_INFIX_TERNARY, TERNARY_PRECEDENCE, "'if' requires a preceding sub-expression in an expression context" },
+	[KW_ELSE] = { EXPR_PREFIX_NONE, EXPR_INFIX_END, 0, "Unexpected 'else' in expression" },
+	[KW_ASYNC] = { EXPR_PREFIX_ASYNC, EXPR_INFIX_NONE, 0, "'async' must come before an expression, not after" },
+	[KW_AWAIT] = { EXPR_PREFIX_AWAIT, EXPR_INFIX_NONE, 0, "'await' must come before an expression, not after" },
+	[KW_TYPE] = { EXPR_PREFIX_TYPE, EXPR_INFIX_NONE, 0, "'type' must precede a type" },
+	[TOK_LPAREN] = { EXPR_PREFIX_PAREN, EXPR_INFIX_CALL, POSTFIX_PRECEDENCE, NULL },
+	[TOK_LSQUARE] = { EXPR_PREFIX_ARRAY, EXPR_INFIX_SUBSCRIPT, POSTFIX_PRECEDENCE, NULL },
+	[TOK_LBRACE] = { EXPR_PREFIX_BLOCK, EXPR_INFIX_END, 0, NULL },
+	[TOK_DOT] = { EXPR_PREFIX_NONE, EXPR_INFIX_FIELD_ACCESS, POSTFIX_PRECEDENCE, "Expected value before field access" },
+};
+
+static const ExprRule EXPR_RULE_DIR_READ = { EXPR_PREFIX_READ, EXPR_INFIX_NONE, 0, "#read cannot be used in contexts where a string is not valid" };
+
+static inline const ExprRule* expr_rule(int token_type) {
+	if ((unsigned) token_type < EXPR_RULE_TABLE_SIZE) return &EXPR_RULES[token_type];
+	switch (token_type) {
+		case DIR_READ: return &EXPR_RULE_DIR_READ;
+		default: return &EXPR_RULES[TOK_EMPTY];
+	}
+}
+
+static const uint8_t OPERATOR_PRECEDENCE[256] = {
+	 60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,
+	 60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,
+	 60,  60,  60,  60,  60,  80,  80,  60,  60,  60,  80,  70,  60,  70,  60,  80,
+	 60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,   2,  10,  10,  10,  50,
+	 60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,
+	 60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60, 101,  60,
+	 60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,
+	 60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  30,  60,  70,  60,
+	 60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,
+	 60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,
+	 60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,
+	 60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,
+	 60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,
+	 60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,
+	 60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,
+	 60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,  60,
+};
@@ -0,0 +1,872 @@
+#define RHAST_LAYOUT_HASH 0xf938ddd2u
+
+static RhOff write_node(RhastWriter* w, const AST_Node* node) {
+	RhOff off = 0;
+	switch (node->node_type) {
+		case NODE_QUALNAME: {
+			const AST_Qualname* src = (const AST_Qualname*) node;
+			off = write_record(w, node, sizeof(AST_Qualname), _Alignof(AST_Qualname));
+			{ RhOff v = write_string_array(w, (const char* const*) src->parts); WRITER_AT(AST_Qualname, off)->parts = writer_pointer(w, v); }
+		} break;
+		case NODE_NAME: {
+			const AST_Name* src = (const AST_Name*) node;
+			off = write_record(w, node, sizeof(AST_Name), _Alignof(AST_Name));
+			{ RhOff v = write_string(w, src->name); WRITER_AT(AST_Name, off)->name = writer_pointer(w, v); }
+		} break;
+		case NODE_INT: {
+			const AST_Int* src = (const AST_Int*) node;
+			off = write_record(w, node, sizeof(AST_Int), _Alignof(AST_Int));
+			WRITER_AT(AST_Int, off)->value = src->value;
+		} break;
+		case NODE_FLOAT: {
+			const AST_Float* src = (const AST_Float*) node;
+			off = write_record(w, node, sizeof(AST_Float), _Alignof(AST_Float));
+			WRITER_AT(AST_Float, off)->value = src->value;
+		} break;
+		case NODE_BOOL: {
+			const AST_Bool* src = (const AST_Bool*) node;
+			off = write_record(w, node, sizeof(AST_Bool), _Alignof(AST_Bool));
+			WRITER_AT(AST_Bool, off)->value = src->value;
+		} break;
+		case NODE_STRING: {
+			const AST_String* src = (const AST_String*) node;
+			off = write_record(w, node, sizeof(AST_String), _Alignof(AST_String));
+			{ RhOff v = write_string(w, src->value); WRITER_AT(AST_String, off)->value = writer_pointer(w, v); }
+		} break;
+		case NODE_CHAR: {
+			const AST_Char* src = (const AST_Char*) node;
+			off = write_record(w, node, sizeof(AST_Char), _Alignof(AST_Char));
+			WRITER_AT(AST_Char, off)->value = src->value;
+		} break;
+		case NODE_NULL: {
+			off = write_record(w, node, sizeof(AST_Null), _Alignof(AST_Null));
+		} break;
+		case NODE_BLOCK: {
+			const AST_Block* src = (const AST_Block*) node;
+			off = write_record(w, node, sizeof(AST_Block), _Alignof(AST_Block));
+			write_node_array(w, off + offsetof(AST_Block, body), (const AST_Node* const*) src->body);
+		} break;
+		case NODE_IMPORT: {
+			const AST_Import* src = (const AST_Import*) node;
+			off = write_record(w, node, sizeof(AST_Import), _Alignof(AST_Import));
+			write_later(w, off + offsetof(AST_Import, local_name), (const AST_Node*) src->local_name);
+			write_later(w, off + offsetof(AST_Import, qualified_name), (const AST_Node*) src->qualified_name);
+			{ RhOff v = write_string(w, src->imported_file); WRITER_AT(AST_Import, off)->imported_file = writer_pointer(w, v); }
+			WRITER_AT(AST_Import, off)->is_using = src->is_using;
+		} break;
+		case NODE_PARAM: {
+			const AST_Param* src = (const AST_Param*) node;
+			off = write_record(w, node, sizeof(AST_Param), _Alignof(AST_Param));
+			write_later(w, off + offsetof(AST_Param, name), (const AST_Node*) src->name);
+			write_later(w, off + offsetof(AST_Param, type), (const AST_Node*) src->type);
+			write_later(w, off + offsetof(AST_Param, default_value), (const AST_Node*) src->default_value);
+			WRITER_AT(AST_Param, off)->is_vararg = src->is_vararg;
+			WRITER_AT(AST_Param, off)->is_kw_only = src->is_kw_only;
+			WRITER_AT(AST_Param, off)->allow_alias = src->allow_alias;
+		} break;
+		case NODE_FUNC_DEF: {
+			const AST_FuncDef* src = (const AST_FuncDef*) node;
+			off = write_record(w, node, sizeof(AST_FuncDef), _Alignof(AST_FuncDef));
+			write_later(w, off + offsetof(AST_FuncDef, name), (const AST_Node*) src->name);
+			write_node_map(w, off + offsetof(AST_FuncDef, params), (const ASTMAP_NodeEntry*) src->params);
+			write_later(w, off + offsetof(AST_FuncDef, ret_type), (const AST_Node*) src->ret_type);
+			write_later(w, off + offsetof(AST_FuncDef, body), (const AST_Node*) src->body);
+			WRITER_AT(AST_FuncDef, off)->pub = src->pub;
+		} break;
+		case NODE_MACRO: {
+			const AST_Macro* src = (const AST_Macro*) node;
+			off = write_record(w, node, sizeof(AST_Macro), _Alignof(AST_Macro));
+			write_later(w, off + offsetof(AST_Macro, name), (const AST_Node*) src->name);
+			write_node_map(w, off + offsetof(AST_Macro, params), (const ASTMAP_NodeEntry*) src->params);
+			write_later(w, off + offsetof(AST_Macro, expansion), (const AST_Node*) src->expansion);
+			WRITER_AT(AST_Macro, off)->pub = src->pub;
+		} break;
+		case NODE_FUNC_OVERLOAD: {
+			const AST_FuncOverload* src = (const AST_FuncOverload*) node;
+			off = write_record(w, node, sizeof(AST_FuncOverload), _Alignof(AST_FuncOverload));
+			write_later(w, off + offsetof(AST_FuncOverload, name), (const AST_Node*) src->name);
+			write_node_array(w, off + offsetof(AST_FuncOverload, overloads), (const AST_Node* const*) src->overloads);
+		} break;
+		case NODE_CONST: {
+			const AST_Const* src = (const AST_Const*) node;
+			off = write_record(w, node, sizeof(AST_Const), _Alignof(AST_Const));
+			write_later(w, off + offsetof(AST_Const, name), (const AST_Node*) src->name);
+			write_later(w, off + offsetof(AST_Const, type), (const AST_Node*) src->type);
+			write_later(w, off + offsetof(AST_Const, value), (const AST_Node*) src->value);
+			WRITER_AT(AST_Const, off)->pub = src->pub;
+		} break;
+		case NODE_FIELD: {
+			const AST_Field* src = (const AST_Field*) node;
+			off = write_record(w, node, sizeof(AST_Field), _Alignof(AST_Field));
+			write_later(w, off + offsetof(AST_Field, name), (const AST_Node*) src->name);
+			write_later(w, off + offsetof(AST_Field, type), (const AST_Node*) src->type);
+			write_later(w, off + offsetof(AST_Field, default_value), (const AST_Node*) src->default_value);
+			write_later(w, off + offsetof(AST_Field, invariant), (const AST_Node*) src->invariant);
+			WRITER_AT(AST_Field, off)->is_using = src->is_using;
+		} break;
+		case NODE_STRUCT: {
+			const AST_Struct* src = (const AST_Struct*) node;
+			off = write_record(w, node, sizeof(AST_Struct), _Alignof(AST_Struct));
+			write_later(w, off + offsetof(AST_Struct, name), (const AST_Node*) src->name);
+			write_node_array(w, off + offsetof(AST_Struct, constraints), (const AST_Node* const*) src->constraints);
+			write_node_map(w, off + offsetof(AST_Struct, fields), (const ASTMAP_NodeEntry*) src->fields);
+			WRITER_AT(AST_Struct, off)->pub = src->pub;
+		} break;
+		case NODE_ENUM_VALUE: {
+			const AST_EnumValue* src = (const AST_EnumValue*) node;
+			off = write_record(w, node, sizeof(AST_EnumValue), _Alignof(AST_EnumValue));
+			write_later(w, off + offsetof(AST_EnumValue, name), (const AST_Node*) src->name);
+			write_later(w, off + offsetof(AST_EnumValue, value), (const AST_Node*) src->value);
+		} break;
+		case NODE_ENUM: {
+			const AST_Enum* src = (const AST_Enum*) node;
+			off = write_record(w, node, sizeof(AST_Enum), _Alignof(AST_Enum));
+			write_later(w, off + offsetof(AST_Enum, name), (const AST_Node*) src->name);
+			write_node_map(w, off + offsetof(AST_Enum, fields), (const ASTMAP_NodeEntry*) src->fields);
+			WRITER_AT(AST_Enum, off)->pub = src->pub;
+			WRITER_AT(AST_Enum, off)->is_flags = src->is_flags;
+		} break;
+		case NODE_TEST: {
+			const AST_Test* src = (const AST_Test*) node;
+			off = write_record(w, node, sizeof(AST_Test), _Alignof(AST_Test));
+			write_later(w, off + offsetof(AST_Test, description), (const AST_Node*) src->description);
+			write_later(w, off + offsetof(AST_Test, body), (const AST_Node*) src->body);
+		} break;
+		case NODE_RUN: {
+			const AST_Run* src = (const AST_Run*) node;
+			off = write_record(w, node, sizeof(AST_Run), _Alignof(AST_Run));
+			write_later(w, off + offsetof(AST_Run, statement), (const AST_Node*) src->statement);
+		} break;
+		case NODE_WARN: {
+			const AST_Warn* src = (const AST_Warn*) node;
+			off = write_record(w, node, sizeof(AST_Warn), _Alignof(AST_Warn));
+			{ RhOff v = write_string(w, src->warning); WRITER_AT(AST_Warn, off)->warning = writer_pointer(w, v); }
+		} break;
+		case NODE_MODULE: {
+			const AST_Module* src = (const AST_Module*) node;
+			off = write_record(w, node, sizeof(AST_Module), _Alignof(AST_Module));
+			write_node_map(w, off + offsetof(AST_Module, scope), (const ASTMAP_NodeEntry*) src->scope);
+			write_node_array(w, off + offsetof(AST_Module, tests), (const AST_Node* const*) src->tests);
+		} break;
+		case NODE_BINOP: {
+			const AST_Binop* src = (const AST_Binop*) node;
+			off = write_record(w, node, sizeof(AST_Binop), _Alignof(AST_Binop));
+			write_later(w, off + offsetof(AST_Binop, lhs), (const AST_Node*) src->lhs);
+			{ RhOff v = write_string(w, src->op); WRITER_AT(AST_Binop, off)->op = writer_pointer(w, v); }
+			write_later(w, off + offsetof(AST_Binop, rhs), (const AST_Node*) src->rhs);
+		} break;
+		case NODE_COMPARISON: {
+			const AST_ComparisonChain* src = (const AST_ComparisonChain*) node;
+			off = write_record(w, node, sizeof(AST_ComparisonChain), _Alignof(AST_ComparisonChain));
+			{ RhOff v = write_string_array(w, (const char* const*) src->comparisons); WRITER_AT(AST_ComparisonChain, off)->comparisons = writer_pointer(w, v); }
+			write_node_array(w, off + offsetof(AST_ComparisonChain, operands), (const AST_Node* const*) src->operands);
+		} break;
+		case NODE_UNARY: {
+			const AST_Unary* src = (const AST_Unary*) node;
+			off = write_record(w, node, sizeof(AST_Unary), _Alignof(AST_Unary));
+			{ RhOff v = write_string(w, src->op); WRITER_AT(AST_Unary, off)->op = writer_pointer(w, v); }
+			write_later(w, off + offsetof(AST_Unary, expr), (const AST_Node*) src->expr);
+		} break;
+		case NODE_NOT: {
+			const AST_Not* src = (const AST_Not*) node;
+			off = write_record(w, node, sizeof(AST_Not), _Alignof(AST_Not));
+			write_later(w, off + offsetof(AST_Not, expr), (const AST_Node*) src->expr);
+		} break;
+		case NODE_AND: {
+			const AST_And* src = (const AST_And*) node;
+			off = write_record(w, node, sizeof(AST_And), _Alignof(AST_And));
+			write_later(w, off + offsetof(AST_And, lhs), (const AST_Node*) src->lhs);
+			write_later(w, off + offsetof(AST_And, rhs), (const AST_Node*) src->rhs);
+		} break;
+		case NODE_OR: {
+			const AST_Or* src = (const AST_Or*) node;
+			off = write_record(w, node, sizeof(AST_Or), _Alignof(AST_Or));
+			write_later(w, off + offsetof(AST_Or, lhs), (const AST_Node*) src->lhs);
+			write_later(w, off + offsetof(AST_Or, rhs), (const AST_Node*) src->rhs);
+		} break;
+		case NODE_TERNARY: {
+			const AST_Ternary* src = (const AST_Ternary*) node;
+			off = write_record(w, node, sizeof(AST_Ternary), _Alignof(AST_Ternary));
+			write_later(w, off + offsetof(AST_Ternary, condition), (const AST_Node*) src->condition);
+			write_later(w, off + offsetof(AST_Ternary, true_expr), (const AST_Node*) src->true_expr);
+			write_later(w, off + offsetof(AST_Ternary, false_expr), (const AST_Node*) src->false_expr);
+		} break;
+		case NODE_REREFERENCE: {
+			const AST_Reref* src = (const AST_Reref*) node;
+			off = write_record(w, node, sizeof(AST_Reref), _Alignof(AST_Reref));
+			write_later(w, off + offsetof(AST_Reref, target), (const AST_Node*) src->target);
+			WRITER_AT(AST_Reref, off)->levels = src->levels;
+		} break;
+		case NODE_BROADCAST: {
+			const AST_Broadcast* src = (const AST_Broadcast*) node;
+			off = write_record(w, node, sizeof(AST_Broadcast), _Alignof(AST_Broadcast));
+			write_later(w, off + offsetof(AST_Broadcast, target), (const AST_Node*) src->target);
+		} break;
+		case NODE_ASYNC: {
+			const AST_Async* src = (const AST_Async*) node;
+			off = write_record(w, node, sizeof(AST_Async), _Alignof(AST_Async));
+			write_later(w, off + offsetof(AST_Async, target), (const AST_Node*) src->target);
+		} break;
+		case NODE_AWAIT: {
+			const AST_Await* src = (const AST_Await*) node;
+			off = write_record(w, node, sizeof(AST_Await), _Alignof(AST_Await));
+			write_later(w, off + offsetof(AST_Await, target), (const AST_Node*) src->target);
+		} break;
+		case NODE_ARRAY: {
+			const AST_ArrayLiteral* src = (const AST_ArrayLiteral*) node;
+			off = write_record(w, node, sizeof(AST_ArrayLiteral), _Alignof(AST_ArrayLiteral));
+			write_node_array(w, off + offsetof(AST_ArrayLiteral, elements), (const AST_Node* const*) src->elements);
+		} break;
+		case NODE_ARRAY_COMP: {
+			const AST_ArrayComprehension* src = (const AST_ArrayComprehension*) node;
+			off = write_record(w, node, sizeof(AST_ArrayComprehension), _Alignof(AST_ArrayComprehension));
+			write_later(w, off + offsetof(AST_ArrayComprehension, element), (const AST_Node*) src->element);
+			write_later(w, off + offsetof(AST_ArrayComprehension, range), (const AST_Node*) src->range);
+			write_later(w, off + offsetof(AST_ArrayComprehension, filter), (const AST_Node*) src->filter);
+		} break;
+		case NODE_ARRAY_RANGE: {
+			const AST_ArrayRange* src = (const AST_ArrayRange*) node;
+			off = write_record(w, node, sizeof(AST_ArrayRange), _Alignof(AST_ArrayRange));
+			write_later(w, off + offsetof(AST_ArrayRange, start), (const AST_Node*) src->start);
+			write_later(w, off + offsetof(AST_ArrayRange, end), (const AST_Node*) src->end);
+			write_later(w, off + offsetof(AST_ArrayRange, step), (const AST_Node*) src->step);
+			WRITER_AT(AST_ArrayRange, off)->is_inclusive = src->is_inclusive;
+		} break;
+		case NODE_PACKED_ARRAY: {
+			const AST_PackedArray* src = (const AST_PackedArray*) node;
+			off = write_record(w, node, sizeof(AST_PackedArray), _Alignof(AST_PackedArray));
+			WRITER_AT(AST_PackedArray, off)->kind = src->kind;
+			{ RhOff v = write_value_array(w, src->shape, arrlen(src->shape), sizeof(*src->shape)); WRITER_AT(AST_PackedArray, off)->shape = writer_pointer(w, v); }
+			{ RhOff v = write_value_array(w, src->ints, arrlen(src->ints), sizeof(*src->ints)); WRITER_AT(AST_PackedArray, off)->ints = writer_pointer(w, v); }
+			{ RhOff v = write_value_array(w, src->floats, arrlen(src->floats), sizeof(*src->floats)); WRITER_AT(AST_PackedArray, off)->floats = writer_pointer(w, v); }
+		} break;
+		case NODE_FUNC_CALL: {
+			const AST_FuncCall* src = (const AST_FuncCall*) node;
+			off = write_record(w, node, sizeof(AST_FuncCall), _Alignof(AST_FuncCall));
+			write_later(w, off + offsetof(AST_FuncCall, func), (const AST_Node*) src->func);
+			write_node_array(w, off + offsetof(AST_FuncCall, pos_args), (const AST_Node* const*) src->pos_args);
+			write_node_map(w, off + offsetof(AST_FuncCall, kw_args), (const ASTMAP_NodeEntry*) src->kw_args);
+			WRITER_AT(AST_FuncCall, off)->is_word_op = src->is_word_op;
+		} break;
+		case NODE_SLICE: {
+			const AST_Slice* src = (const AST_Slice*) node;
+			off = write_record(w, node, sizeof(AST_Slice), _Alignof(AST_Slice));
+			write_later(w, off + offsetof(AST_Slice, start), (const AST_Node*) src->start);
+			write_later(w, off + offsetof(AST_Slice, end), (const AST_Node*) src->end);
+			write_later(w, off + offsetof(AST_Slice, step), (const AST_Node*) src->step);
+			WRITER_AT(AST_Slice, off)->is_inclusive = src->is_inclusive;
+		} break;
+		case NODE_SUBSCRIPT: {
+			const AST_Subscript* src = (const AST_Subscript*) node;
+			off = write_record(w, node, sizeof(AST_Subscript), _Alignof(AST_Subscript));
+			write_later(w, off + offsetof(AST_Subscript, array), (const AST_Node*) src->array);
+			write_node_array(w, off + offsetof(AST_Subscript, subscripts), (const AST_Node* const*) src->subscripts);
+		} break;
+		case NODE_FIELD_ACCESS: {
+			const AST_FieldAccess* src = (const AST_FieldAccess*) node;
+			off = write_record(w, node, sizeof(AST_FieldAccess), _Alignof(AST_FieldAccess));
+			write_later(w, off + offsetof(AST_FieldAccess, base), (const AST_Node*) src->base);
+			write_later(w, off + offsetof(AST_FieldAccess, field), (const AST_Node*) src->field);
+		} break;
+		case NODE_SIMPLE_TYPE: {
+			const AST_SimpleType* src = (const AST_SimpleType*) node;
+			off = write_record(w, node, sizeof(AST_SimpleType), _Alignof(AST_SimpleType));
+			write_later(w, off + offsetof(AST_SimpleType, base), (const AST_Node*) src->base);
+		} break;
+		case NODE_POINTER_TYPE: {
+			const AST_PointerType* src = (const AST_PointerType*) node;
+			off = write_record(w, node, sizeof(AST_PointerType), _Alignof(AST_PointerType));
+			write_later(w, off + offsetof(AST_PointerType, base), (const AST_Node*) src->base);
+		} break;
+		case NODE_MUTABLE_TYPE: {
+			const AST_MutableType* src = (const AST_MutableType*) node;
+			off = write_record(w, node, sizeof(AST_MutableType), _Alignof(AST_MutableType));
+			write_later(w, off + offsetof(AST_MutableType, base), (const AST_Node*) src->base);
+		} break;
+		case NODE_OPTIONAL_TYPE: {
+			const AST_OptionalType* src = (const AST_OptionalType*) node;
+			off = write_record(w, node, sizeof(AST_OptionalType), _Alignof(AST_OptionalType));
+			write_later(w, off + offsetof(AST_OptionalType, base), (const AST_Node*) src->base);
+		} break;
+		case NODE_ARRAY_TYPE: {
+			const AST_ArrayType* src = (const AST_ArrayType*) node;
+			off = write_record(w, node, sizeof(AST_ArrayType), _Alignof(AST_ArrayType));
+			write_later(w, off + offsetof(AST_ArrayType, element_type), (const AST_Node*) src->element_type);
+			write_node_array(w, off + offsetof(AST_ArrayType, shape), (const AST_Node* const*) src->shape);
+			WRITER_AT(AST_ArrayType, off)->is_dynamic = src->is_dynamic;
+		} break;
+		case NODE_FUNC_TYPE: {
+			const AST_FuncType* src = (const AST_FuncType*) node;
+			off = write_record(w, node, sizeof(AST_FuncType), _Alignof(AST_FuncType));
+			write_node_array(w, off + offsetof(AST_FuncType, param_types), (const AST_Node* const*) src->param_types);
+			write_later(w, off + offsetof(AST_FuncType, return_type), (const AST_Node*) src->return_type);
+		} break;
+		case NODE_TEMPLATE_TYPE: {
+			const AST_TemplateType* src = (const AST_TemplateType*) node;
+			off = write_record(w, node, sizeof(AST_TemplateType), _Alignof(AST_TemplateType));
+			write_node_array(w, off + offsetof(AST_TemplateType, arguments), (const AST_Node* const*) src->arguments);
+		} break;
+		case NODE_UNION: {
+			const AST_UnionType* src = (const AST_UnionType*) node;
+			off = write_record(w, node, sizeof(AST_UnionType), _Alignof(AST_UnionType));
+			write_node_array(w, off + offsetof(AST_UnionType, variants), (const AST_Node* const*) src->variants);
+		} break;
+		case NODE_VAR_DECL: {
+			const AST_VarDecl* src = (const AST_VarDecl*) node;
+			off = write_record(w, node, sizeof(AST_VarDecl), _Alignof(AST_VarDecl));
+			write_later(w, off + offsetof(AST_VarDecl, name), (const AST_Node*) src->name);
+			write_later(w, off + offsetof(AST_VarDecl, type), (const AST_Node*) src->type);
+			write_later(w, off + offsetof(AST_VarDecl, value), (const AST_Node*) src->value);
+			WRITER_AT(AST_VarDecl, off)->init = src->init;
+		} break;
+		case NODE_OP_ASSIGN: {
+			const AST_OpAssign* src = (const AST_OpAssign*) node;
+			off = write_record(w, node, sizeof(AST_OpAssign), _Alignof(AST_OpAssign));
+			{ RhOff v = write_string(w, src->op); WRITER_AT(AST_OpAssign, off)->op = writer_pointer(w, v); }
+			write_later(w, off + offsetof(AST_OpAssign, dest_expr), (const AST_Node*) src->dest_expr);
+			write_later(w, off + offsetof(AST_OpAssign, src_expr), (const AST_Node*) src->src_expr);
+		} break;
+		case NODE_ASSIGN: {
+			const AST_AssignChain* src = (const AST_AssignChain*) node;
+			off = write_record(w, node, sizeof(AST_AssignChain), _Alignof(AST_AssignChain));
+			write_node_array(w, off + offsetof(AST_AssignChain, dest_exprs), (const AST_Node* const*) src->dest_exprs);
+			write_later(w, off + offsetof(AST_AssignChain, src_expr), (const AST_Node*) src->src_expr);
+		} break;
+		case NODE_ASSIGN_MANY: {
+			const AST_AssignParallel* src = (const AST_AssignParallel*) node;
+			off = write_record(w, node, sizeof(AST_AssignParallel), _Alignof(AST_AssignParallel));
+			write_node_array(w, off + offsetof(AST_AssignParallel, dest_exprs), (const AST_Node* const*) src->dest_exprs);
+			write_node_array(w, off + offsetof(AST_AssignParallel, src_exprs), (const AST_Node* const*) src->src_exprs);
+		} break;
+		case NODE_IF_STMT: {
+			const AST_IfStatement* src = (const AST_IfStatement*) node;
+			off = write_record(w, node, sizeof(AST_IfStatement), _Alignof(AST_IfStatement));
+			write_later(w, off + offsetof(AST_IfStatement, condition), (const AST_Node*) src->condition);
+			write_later(w, off + offsetof(AST_IfStatement, body), (const AST_Node*) src->body);
+			write_later(w, off + offsetof(AST_IfStatement, alternative), (const AST_Node*) src->alternative);
+		} break;
+		case NODE_WHILE_LOOP: {
+			const AST_WhileLoop* src = (const AST_WhileLoop*) node;
+			off = write_record(w, node, sizeof(AST_WhileLoop), _Alignof(AST_WhileLoop));
+			write_later(w, off + offsetof(AST_WhileLoop, condition), (const AST_Node*) src->condition);
+			write_later(w, off + offsetof(AST_WhileLoop, body), (const AST_Node*) src->body);
+		} break;
+		case NODE_FOR_SIMPLE: {
+			const AST_ForSimple* src = (const AST_ForSimple*) node;
+			off = write_record(w, node, sizeof(AST_ForSimple), _Alignof(AST_ForSimple));
+			write_later(w, off + offsetof(AST_ForSimple, name), (const AST_Node*) src->name);
+			write_later(w, off + offsetof(AST_ForSimple, iterable), (const AST_Node*) src->iterable);
+		} break;
+		case NODE_FOR_RANGE: {
+			const AST_ForRange* src = (const AST_ForRange*) node;
+			off = write_record(w, node, sizeof(AST_ForRange), _Alignof(AST_ForRange));
+			write_later(w, off + offsetof(AST_ForRange, name), (const AST_Node*) src->name);
+			write_later(w, off + offsetof(AST_ForRange, start), (const AST_Node*) src->start);
+			write_later(w, off + offsetof(AST_ForRange, end), (const AST_Node*) src->end);
+			write_later(w, off + offsetof(AST_ForRange, step), (const AST_Node*) src->step);
+			WRITER_AT(AST_ForRange, off)->is_inclusive = src->is_inclusive;
+		} break;
+		case NODE_FOR_PARALLEL: {
+			const AST_ForParallel* src = (const AST_ForParallel*) node;
+			off = write_record(w, node, sizeof(AST_ForParallel), _Alignof(AST_ForParallel));
+			write_node_array(w, off + offsetof(AST_ForParallel, names), (const AST_Node* const*) src->names);
+			write_node_map(w, off + offsetof(AST_ForParallel, zips), (const ASTMAP_NodeEntry*) src->zips);
+		} break;
+		case NODE_FOR_LOOP: {
+			const AST_ForLoop* src = (const AST_ForLoop*) node;
+			off = write_record(w, node, sizeof(AST_ForLoop), _Alignof(AST_ForLoop));
+			write_node_array(w, off + offsetof(AST_ForLoop, iterables), (const AST_Node* const*) src->iterables);
+			write_later(w, off + offsetof(AST_ForLoop, label), (const AST_Node*) src->label);
+			write_later(w, off + offsetof(AST_ForLoop, body), (const AST_Node*) src->body);
+			WRITER_AT(AST_ForLoop, off)->mode = src->mode;
+		} break;
+		case NODE_MATCH_CASE: {
+			const AST_MatchCase* src = (const AST_MatchCase*) node;
+			off = write_record(w, node, sizeof(AST_MatchCase), _Alignof(AST_MatchCase));
+			write_node_array(w, off + offsetof(AST_MatchCase, patterns), (const AST_Node* const*) src->patterns);
+			write_later(w, off + offsetof(AST_MatchCase, body), (const AST_Node*) src->body);
+		} break;
+		case NODE_MATCH: {
+			const AST_Match* src = (const AST_Match*) node;
+			off = write_record(w, node, sizeof(AST_Match), _Alignof(AST_Match));
+			write_node_array(w, off + offsetof(AST_Match, patterns), (const AST_Node* const*) src->patterns);
+		} break;
+		case NODE_CONTEXT: {
+			const AST_Context* src = (const AST_Context*) node;
+			off = write_record(w, node, sizeof(AST_Context), _Alignof(AST_Context));
+			write_later(w, off + offsetof(AST_Context, name), (const AST_Node*) src->name);
+			write_later(w, off + offsetof(AST_Context, value), (const AST_Node*) src->value);
+		} break;
+		case NODE_WITH: {
+			const AST_With* src = (const AST_With*) node;
+			off = write_record(w, node, sizeof(AST_With), _Alignof(AST_With));
+			write_node_array(w, off + offsetof(AST_With, contexts), (const AST_Node* const*) src->contexts);
+		} break;
+		case NODE_RETURN: {
+			const AST_Return* src = (const AST_Return*) node;
+			off = write_record(w, node, sizeof(AST_Return), _Alignof(AST_Return));
+			write_later(w, off + offsetof(AST_Return, value), (const AST_Node*) src->value);
+		} break;
+		case NODE_BREAK: {
+			const AST_Break* src = (const AST_Break*) node;
+			off = write_record(w, node, sizeof(AST_Break), _Alignof(AST_Break));
+			write_later(w, off + offsetof(AST_Break, label), (const AST_Node*) src->label);
+		} break;
+		case NODE_SKIP: {
+			const AST_Skip* src = (const AST_Skip*) node;
+			off = write_record(w, node, sizeof(AST_Skip), _Alignof(AST_Skip));
+			write_later(w, off + offsetof(AST_Skip, label), (const AST_Node*) src->label);
+		} break;
+		case NODE_FAIL: {
+			const AST_Fail* src = (const AST_Fail*) node;
+			off = write_record(w, node, sizeof(AST_Fail), _Alignof(AST_Fail));
+			write_later(w, off + offsetof(AST_Fail, value), (const AST_Node*) src->value);
+			write_later(w, off + offsetof(AST_Fail, message), (const AST_Node*) src->message);
+		} break;
+		case NODE_ASSERT: {
+			const AST_Assert* src = (const AST_Assert*) node;
+			off = write_record(w, node, sizeof(AST_Assert), _Alignof(AST_Assert));
+			write_later(w, off + offsetof(AST_Assert, value), (const AST_Node*) src->value);
+			write_later(w, off + offsetof(AST_Assert, message), (const AST_Node*) src->message);
+		} break;
+		case NODE_CONTRACT: {
+			const AST_Contract* src = (const AST_Contract*) node;
+			off = write_record(w, node, sizeof(AST_Contract), _Alignof(AST_Contract));
+			WRITER_AT(AST_Contract, off)->kind = src->kind;
+			write_later(w, off + offsetof(AST_Contract, condition), (const AST_Node*) src->condition);
+		} break;
+		case NODE_DEFER: {
+			const AST_Defer* src = (const AST_Defer*) node;
+			off = write_record(w, node, sizeof(AST_Defer), _Alignof(AST_Defer));
+			write_later(w, off + offsetof(AST_Defer, code), (const AST_Node*) src->code);
+		} break;
+		case NODE_CANCEL: {
+			const AST_Cancel* src = (const AST_Cancel*) node;
+			off = write_record(w, node, sizeof(AST_Cancel), _Alignof(AST_Cancel));
+			write_later(w, off + offsetof(AST_Cancel, target), (const AST_Node*) src->target);
+		} break;
+		default: break;
+	}
+	return off;
+}
+
+static bool check_node(RhastCheck* k, AST_Node* node) {
+	if (node->tags || !check_string(k, node->src_file)) return false;
+	switch (node->node_type) {
+		case NODE_QUALNAME: {
+			AST_Qualname* n = (AST_Qualname*) node;
+			return claim(k, node, sizeof(AST_Qualname))
+				&& check_string_array(k, n, (const char* const*) n->parts);
+		}
+		case NODE_NAME: {
+			AST_Name* n = (AST_Name*) node;
+			return claim(k, node, sizeof(AST_Name))
+				&& check_string(k, n->name);
+		}
+		case NODE_INT: {
+			return claim(k, node, sizeof(AST_Int));
+		}
+		case NODE_FLOAT: {
+			return claim(k, node, sizeof(AST_Float));
+		}
+		case NODE_BOOL: {
+			return claim(k, node, sizeof(AST_Bool));
+		}
+		case NODE_STRING: {
+			AST_String* n = (AST_String*) node;
+			return claim(k, node, sizeof(AST_String))
+				&& check_string(k, n->value);
+		}
+		case NODE_CHAR: {
+			return claim(k, node, sizeof(AST_Char));
+		}
+		case NODE_NULL: {
+			return claim(k, node, sizeof(AST_Null));
+		}
+		case NODE_BLOCK: {
+			AST_Block* n = (AST_Block*) node;
+			return claim(k, node, sizeof(AST_Block))
+				&& check_node_array(k, n, (AST_Node* const*) n->body, NODE_EMPTY);
+		}
+		case NODE_IMPORT: {
+			AST_Import* n = (AST_Import*) node;
+			return claim(k, node, sizeof(AST_Import))
+				&& check_child(k, n, (const AST_Node*) n->local_name, NODE_NAME)
+				&& check_child(k, n, (const AST_Node*) n->qualified_name, NODE_QUALNAME)
+				&& check_string(k, n->imported_file)
+				&& !n->module_handle;
+		}
+		case NODE_PARAM: {
+			AST_Param* n = (AST_Param*) node;
+			return claim(k, node, sizeof(AST_Param))
+				&& check_child(k, n, (const AST_Node*) n->name, NODE_NAME)
+				&& check_child(k, n, (const AST_Node*) n->type, NODE_EMPTY)
+				&& check_child(k, n, (const AST_Node*) n->default_value, NODE_EMPTY);
+		}
+		case NODE_FUNC_DEF: {
+			AST_FuncDef* n = (AST_FuncDef*) node;
+			return claim(k, node, sizeof(AST_FuncDef))
+				&& check_child(k, n, (const AST_Node*) n->name, NODE_NAME)
+				&& check_map(k, n, (ASTMAP_NodeEntry**) &n->params, NODE_PARAM)
+				&& check_child(k, n, (const AST_Node*) n->ret_type, NODE_EMPTY)
+				&& check_child(k, n, (const AST_Node*) n->body, NODE_BLOCK);
+		}
+		case NODE_MACRO: {
+			AST_Macro* n = (AST_Macro*) node;
+			return claim(k, node, sizeof(AST_Macro))
+				&& check_child(k, n, (const AST_Node*) n->name, NODE_NAME)
+				&& check_map(k, n, (ASTMAP_NodeEntry**) &n->params, NODE_PARAM)
+				&& check_child(k, n, (const AST_Node*) n->expansion, NODE_EMPTY);
+		}
+		case NODE_FUNC_OVERLOAD: {
+			AST_FuncOverload* n = (AST_FuncOverload*) node;
+			return claim(k, node, sizeof(AST_FuncOverload))
+				&& check_child(k, n, (const AST_Node*) n->name, NODE_NAME)
+				&& check_node_array(k, n, (AST_Node* const*) n->overloads, NODE_NAME);
+		}
+		case NODE_CONST: {
+			AST_Const* n = (AST_Const*) node;
+			return claim(k, node, sizeof(AST_Const))
+				&& check_child(k, n, (const AST_Node*) n->name, NODE_NAME)
+				&& check_child(k, n, (const AST_Node*) n->type, NODE_EMPTY)
+				&& check_child(k, n, (const AST_Node*) n->value, NODE_EMPTY);
+		}
+		case NODE_FIELD: {
+			AST_Field* n = (AST_Field*) node;
+			return claim(k, node, sizeof(AST_Field))
+				&& check_child(k, n, (const AST_Node*) n->name, NODE_NAME)
+				&& check_child(k, n, (const AST_Node*) n->type, NODE_EMPTY)
+				&& check_child(k, n, (const AST_Node*) n->default_value, NODE_EMPTY)
+				&& check_child(k, n, (const AST_Node*) n->invariant, NODE_EMPTY);
+		}
+		case NODE_STRUCT: {
+			AST_Struct* n = (AST_Struct*) node;
+			return claim(k, node, sizeof(AST_Struct))
+				&& check_child(k, n, (const AST_Node*) n->name, NODE_NAME)
+				&& check_node_array(k, n, (AST_Node* const*) n->constraints, NODE_EMPTY)
+				&& check_map(k, n, (ASTMAP_NodeEntry**) &n->fields, NODE_FIELD);
+		}
+		case NODE_ENUM_VALUE: {
+			AST_EnumValue* n = (AST_EnumValue*) node;
+			return claim(k, node, sizeof(AST_EnumValue))
+				&& check_child(k, n, (const AST_Node*) n->name, NODE_NAME)
+				&& check_child(k, n, (const AST_Node*) n->value, NODE_EMPTY);
+		}
+		case NODE_ENUM: {
+			AST_Enum* n = (AST_Enum*) node;
+			return claim(k, node, sizeof(AST_Enum))
+				&& check_child(k, n, (const AST_Node*) n->name, NODE_NAME)
+				&& check_map(k, n, (ASTMAP_NodeEntry**) &n->fields, NODE_ENUM_VALUE);
+		}
+		case NODE_TEST: {
+			AST_Test* n = (AST_Test*) node;
+			return claim(k, node, sizeof(AST_Test))
+				&& check_child(k, n, (const AST_Node*) n->description, NODE_STRING)
+				&& check_child(k, n, (const AST_Node*) n->body, NODE_BLOCK);
+		}
+		case NODE_RUN: {
+			AST_Run* n = (AST_Run*) node;
+			return claim(k, node, sizeof(AST_Run))
+				&& check_child(k, n, (const AST_Node*) n->statement, NODE_EMPTY);
+		}
+		case NODE_WARN: {
+			AST_Warn* n = (AST_Warn*) node;
+			return claim(k, node, sizeof(AST_Warn))
+				&& check_string(k, n->warning);
+		}
+		case NODE_MODULE: {
+			AST_Module* n = (AST_Module*) node;
+			return claim(k, node, sizeof(AST_Module))
+				&& check_map(k, n, (ASTMAP_NodeEntry**) &n->scope, NODE_EMPTY)
+				&& check_node_array(k, n, (AST_Node* const*) n->tests, NODE_TEST);
+		}
+		case NODE_BINOP: {
+			AST_Binop* n = (AST_Binop*) node;
+			return claim(k, node, sizeof(AST_Binop))
+				&& check_child(k, n, (const AST_Node*) n->lhs, NODE_EMPTY)
+				&& check_string(k, n->op)
+				&& check_child(k, n, (const AST_Node*) n->rhs, NODE_EMPTY);
+		}
+		case NODE_COMPARISON: {
+			AST_ComparisonChain* n = (AST_ComparisonChain*) node;
+			return claim(k, node, sizeof(AST_ComparisonChain))
+				&& check_string_array(k, n, (const char* const*) n->comparisons)
+				&& check_node_array(k, n, (AST_Node* const*) n->operands, NODE_EMPTY);
+		}
+		case NODE_UNARY: {
+			AST_Unary* n = (AST_Unary*) node;
+			return claim(k, node, sizeof(AST_Unary))
+				&& check_string(k, n->op)
+				&& check_child(k, n, (const AST_Node*) n->expr, NODE_EMPTY);
+		}
+		case NODE_NOT: {
+			AST_Not* n = (AST_Not*) node;
+			return claim(k, node, sizeof(AST_Not))
+				&& check_child(k, n, (const AST_Node*) n->expr, NODE_EMPTY);
+		}
+		case NODE_AND: {
+			AST_And* n = (AST_And*) node;
+			return claim(k, node, sizeof(AST_And))
+				&& check_child(k, n, (const AST_Node*) n->lhs, NODE_EMPTY)
+				&& check_child(k, n, (const AST_Node*) n->rhs, NODE_EMPTY);
+		}
+		case NODE_OR: {
+			AST_Or* n = (AST_Or*) node;
+			return claim(k, node, sizeof(AST_Or))
+				&& check_child(k, n, (const AST_Node*) n->lhs, NODE_EMPTY)
+				&& check_child(k, n, (const AST_Node*) n->rhs, NODE_EMPTY);
+		}
+		case NODE_TERNARY: {
+			AST_Ternary* n = (AST_Ternary*) node;
+			return claim(k, node, sizeof(AST_Ternary))
+				&& check_child(k, n, (const AST_Node*) n->condition, NODE_EMPTY)
+				&& check_child(k, n, (const AST_Node*) n->true_expr, NODE_EMPTY)
+				&& check_child(k, n, (const AST_Node*) n->false_expr, NODE_EMPTY);
+		}
+		case NODE_REREFERENCE: {
+			AST_Reref* n = (AST_Reref*) node;
+			return claim(k, node, sizeof(AST_Reref))
+				&& check_child(k, n, (const AST_Node*) n->target, NODE_EMPTY);
+		}
+		case NODE_BROADCAST: {
+			AST_Broadcast* n = (AST_Broadcast*) node;
+			return claim(k, node, sizeof(AST_Broadcast))
+				&& check_child(k, n, (const AST_Node*) n->target, NODE_EMPTY);
+		}
+		case NODE_ASYNC: {
+			AST_Async* n = (AST_Async*) node;
+			return claim(k, node, sizeof(AST_Async))
+				&& check_child(k, n, (const AST_Node*) n->target, NODE_EMPTY);
+		}
+		case NODE_AWAIT: {
+			AST_Await* n = (AST_Await*) node;
+			return claim(k, node, sizeof(AST_Await))
+				&& check_child(k, n, (const AST_Node*) n->target, NODE_EMPTY);
+		}
+		case NODE_ARRAY: {
+			AST_ArrayLiteral* n = (AST_ArrayLiteral*) node;
+			return claim(k, node, sizeof(AST_ArrayLiteral))
+				&& check_node_array(k, n, (AST_Node* const*) n->elements, NODE_EMPTY);
+		}
+		case NODE_ARRAY_COMP: {
+			AST_ArrayComprehension* n = (AST_ArrayComprehension*) node;
+			return claim(k, node, sizeof(AST_ArrayComprehension))
+				&& check_child(k, n, (const AST_Node*) n->element, NODE_EMPTY)
+				&& check_child(k, n, (const AST_Node*) n->range, NODE_EMPTY)
+				&& check_child(k, n, (const AST_Node*) n->filter, NODE_EMPTY);
+		}
+		case NODE_ARRAY_RANGE: {
+			AST_ArrayRange* n = (AST_ArrayRange*) node;
+			return claim(k, node, sizeof(AST_ArrayRange))
+				&& check_child(k, n, (const AST_Node*) n->start, NODE_EMPTY)
+				&& check_child(k, n, (const AST_Node*) n->end, NODE_EMPTY)
+				&& check_child(k, n, (const AST_Node*) n->step, NODE_EMPTY);
+		}
+		case NODE_PACKED_ARRAY: {
+			AST_PackedArray* n = (AST_PackedArray*) node;
+			return claim(k, node, sizeof(AST_PackedArray))
+				&& check_array(k, n, n->shape, sizeof(*n->shape))
+				&& check_array(k, n, n->ints, sizeof(*n->ints))
+				&& check_array(k, n, n->floats, sizeof(*n->floats));
+		}
+		case NODE_FUNC_CALL: {
+			AST_FuncCall* n = (AST_FuncCall*) node;
+			return claim(k, node, sizeof(AST_FuncCall))
+				&& check_child(k, n, (const AST_Node*) n->func, NODE_EMPTY)
+				&& check_node_array(k, n, (AST_Node* const*) n->pos_args, NODE_EMPTY)
+				&& check_map(k, n, (ASTMAP_NodeEntry**) &n->kw_args, NODE_EMPTY);
+		}
+		case NODE_SLICE: {
+			AST_Slice* n = (AST_Slice*) node;
+			return claim(k, node, sizeof(AST_Slice))
+				&& check_child(k, n, (const AST_Node*) n->start, NODE_EMPTY)
+				&& check_child(k, n, (const AST_Node*) n->end, NODE_EMPTY)
+				&& check_child(k, n, (const AST_Node*) n->step, NODE_EMPTY);
+		}
+		case NODE_SUBSCRIPT: {
+			AST_Subscript* n = (AST_Subscript*) node;
+			return claim(k, node, sizeof(AST_Subscript))
+				&& check_child(k, n, (const AST_Node*) n->array, NODE_EMPTY)
+				&& check_node_array(k, n, (AST_Node* const*) n->subscripts, NODE_EMPTY);
+		}
+		case NODE_FIELD_ACCESS: {
+			AST_FieldAccess* n = (AST_FieldAccess*) node;
+			return claim(k, node, sizeof(AST_FieldAccess))
+				&& check_child(k, n, (const AST_Node*) n->base, NODE_EMPTY)
+				&& check_child(k, n, (const AST_Node*) n->field, NODE_QUALNAME);
+		}
+		case NODE_SIMPLE_TYPE: {
+			AST_SimpleType* n = (AST_SimpleType*) node;
+			return claim(k, node, sizeof(AST_SimpleType))
+				&& check_child(k, n, (const AST_Node*) n->base, NODE_QUALNAME);
+		}
+		case NODE_POINTER_TYPE: {
+			AST_PointerType* n = (AST_PointerType*) node;
+			return claim(k, node, sizeof(AST_PointerType))
+				&& check_child(k, n, (const AST_Node*) n->base, NODE_EMPTY);
+		}
+		case NODE_MUTABLE_TYPE: {
+			AST_MutableType* n = (AST_MutableType*) node;
+			return claim(k, node, sizeof(AST_MutableType))
+				&& check_child(k, n, (const AST_Node*) n->base, NODE_EMPTY);
+		}
+		case NODE_OPTIONAL_TYPE: {
+			AST_OptionalType* n = (AST_OptionalType*) node;
+			return claim(k, node, sizeof(AST_OptionalType))
+				&& check_child(k, n, (const AST_Node*) n->base, NODE_EMPTY);
+		}
+		case NODE_ARRAY_TYPE: {
+			AST_ArrayType* n = (AST_ArrayType*) node;
+			return claim(k, node, sizeof(AST_ArrayType))
+				&& check_child(k, n, (const AST_Node*) n->element_type, NODE_EMPTY)
+				&& check_node_array(k, n, (AST_Node* const*) n->shape, NODE_EMPTY);
+		}
+		case NODE_FUNC_TYPE: {
+			AST_FuncType* n = (AST_FuncType*) node;
+			return claim(k, node, sizeof(AST_FuncType))
+				&& check_node_array(k, n, (AST_Node* const*) n->param_types, NODE_EMPTY)
+				&& check_child(k, n, (const AST_Node*) n->return_type, NODE_EMPTY);
+		}
+		case NODE_TEMPLATE_TYPE: {
+			AST_TemplateType* n = (AST_TemplateType*) node;
+			return claim(k, node, sizeof(AST_TemplateType))
+				&& check_node_array(k, n, (AST_Node* const*) n->arguments, NODE_EMPTY);
+		}
+		case NODE_UNION: {
+			AST_UnionType* n = (AST_UnionType*) node;
+			return claim(k, node, sizeof(AST_UnionType))
+				&& check_node_array(k, n, (AST_Node* const*) n->variants, NODE_EMPTY);
+		}
+		case NODE_VAR_DECL: {
+			AST_VarDecl* n = (AST_VarDecl*) node;
+			return claim(k, node, sizeof(AST_VarDecl))
+				&& check_child(k, n, (const AST_Node*) n->name, NODE_NAME)
+				&& check_child(k, n, (const AST_Node*) n->type, NODE_EMPTY)
+				&& check_child(k, n, (const AST_Node*) n->value, NODE_EMPTY);
+		}
+		case NODE_OP_ASSIGN: {
+			AST_OpAssign* n = (AST_OpAssign*) node;
+			return claim(k, node, sizeof(AST_OpAssign))
+				&& check_string(k, n->op)
+				&& check_child(k, n, (const AST_Node*) n->dest_expr, NODE_EMPTY)
+				&& check_child(k, n, (const AST_Node*) n->src_expr, NODE_EMPTY);
+		}
+		case NODE_ASSIGN: {
+			AST_AssignChain* n = (AST_AssignChain*) node;
+			return claim(k, node, sizeof(AST_AssignChain))
+				&& check_node_array(k, n, (AST_Node* const*) n->dest_exprs, NODE_EMPTY)
+				&& check_child(k, n, (const AST_Node*) n->src_expr, NODE_EMPTY);
+		}
+		case NODE_ASSIGN_MANY: {
+			AST_AssignParallel* n = (AST_AssignParallel*) node;
+			return claim(k, node, sizeof(AST_AssignParallel))
+				&& check_node_array(k, n, (AST_Node* const*) n->dest_exprs, NODE_EMPTY)
+				&& check_node_array(k, n, (AST_Node* const*) n->src_exprs, NODE_EMPTY);
+		}
+		case NODE_IF_STMT: {
+			AST_IfStatement* n = (AST_IfStatement*) node;
+			return claim(k, node, sizeof(AST_IfStatement))
+				&& check_child(k, n, (const AST_Node*) n->condition, NODE_EMPTY)
+				&& check_child(k, n, (const AST_Node*) n->body, NODE_BLOCK)
+				&& check_child(k, n, (const AST_Node*) n->alternative, NODE_EMPTY);
+		}
+		case NODE_WHILE_LOOP: {
+			AST_WhileLoop* n = (AST_WhileLoop*) node;
+			return claim(k, node, sizeof(AST_WhileLoop))
+				&& check_child(k, n, (const AST_Node*) n->condition, NODE_EMPTY)
+				&& check_child(k, n, (const AST_Node*) n->body, NODE_BLOCK);
+		}
+		case NODE_FOR_SIMPLE: {
+			AST_ForSimple* n = (AST_ForSimple*) node;
+			return claim(k, node, sizeof(AST_ForSimple))
+				&& check_child(k, n, (const AST_Node*) n->name, NODE_NAME)
+				&& check_child(k, n, (const AST_Node*) n->iterable, NODE_EMPTY);
+		}
+		case NODE_FOR_RANGE: {
+			AST_ForRange* n = (AST_ForRange*) node;
+			return claim(k, node, sizeof(AST_ForRange))
+				&& check_child(k, n, (const AST_Node*) n->name, NODE_NAME)
+				&& check_child(k, n, (const AST_Node*) n->start, NODE_EMPTY)
+				&& check_child(k, n, (const AST_Node*) n->end, NODE_EMPTY)
+				&& check_child(k, n, (const AST_Node*) n->step, NODE_EMPTY);
+		}
+		case NODE_FOR_PARALLEL: {
+			AST_ForParallel* n = (AST_ForParallel*) node;
+			return claim(k, node, sizeof(AST_ForParallel))
+				&& check_node_array(k, n, (AST_Node* const*) n->names, NODE_NAME)
+				&& check_map(k, n, (ASTMAP_NodeEntry**) &n->zips, NODE_EMPTY);
+		}
+		case NODE_FOR_LOOP: {
+			AST_ForLoop* n = (AST_ForLoop*) node;
+			return claim(k, node, sizeof(AST_ForLoop))
+				&& check_node_array(k, n, (AST_Node* const*) n->iterables, NODE_EMPTY)
+				&& check_child(k, n, (const AST_Node*) n->label, NODE_NAME)
+				&& check_child(k, n, (const AST_Node*) n->body, NODE_BLOCK);
+		}
+		case NODE_MATCH_CASE: {
+			AST_MatchCase* n = (AST_MatchCase*) node;
+			return claim(k, node, sizeof(AST_MatchCase))
+				&& check_node_array(k, n, (AST_Node* const*) n->patterns, NODE_EMPTY)
+				&& check_child(k, n, (const AST_Node*) n->body, NODE_BLOCK);
+		}
+		case NODE_MATCH: {
+			AST_Match* n = (AST_Match*) node;
+			return claim(k, node, sizeof(AST_Match))
+				&& check_node_array(k, n, (AST_Node* const*) n->patterns, NODE_MATCH_CASE);
+		}
+		case NODE_CONTEXT: {
+			AST_Context* n = (AST_Context*) node;
+			return claim(k, node, sizeof(AST_Context))
+				&& check_child(k, n, (const AST_Node*) n->name, NODE_NAME)
+				&& check_child(k, n, (const AST_Node*) n->value, NODE_EMPTY);
+		}
+		case NODE_WITH: {
+			AST_With* n = (AST_With*) node;
+			return claim(k, node, sizeof(AST_With))
+				&& check_node_array(k, n, (AST_Node* const*) n->contexts, NODE_CONTEXT);
+		}
+		case NODE_RETURN: {
+			AST_Return* n = (AST_Return*) node;
+			return claim(k, node, sizeof(AST_Return))
+				&& check_child(k, n, (const AST_Node*) n->value, NODE_EMPTY);
+		}
+		case NODE_BREAK: {
+			AST_Break* n = (AST_Break*) node;
+			return claim(k, node, sizeof(AST_Break))
+				&& check_child(k, n, (const AST_Node*) n->label, NODE_NAME);
+		}
+		case NODE_SKIP: {
+			AST_Skip* n = (AST_Skip*) node;
+			return claim(k, node, sizeof(AST_Skip))
+				&& check_child(k, n, (const AST_Node*) n->label, NODE_NAME);
+		}
+		case NODE_FAIL: {
+			AST_Fail* n = (AST_Fail*) node;
+			return claim(k, node, sizeof(AST_Fail))
+				&& check_child(k, n, (const AST_Node*) n->value, NODE_EMPTY)
+				&& check_child(k, n, (const AST_Node*) n->message, NODE_EMPTY);
+		}
+		case NODE_ASSERT: {
+			AST_Assert* n = (AST_Assert*) node;
+			return claim(k, node, sizeof(AST_Assert))
+				&& check_child(k, n, (const AST_Node*) n->value, NODE_EMPTY)
+				&& check_child(k, n, (const AST_Node*) n->message, NODE_EMPTY);
+		}
+		case NODE_CONTRACT: {
+			AST_Contract* n = (AST_Contract*) node;
+			return claim(k, node, sizeof(AST_Contract))
+				&& check_child(k, n, (const AST_Node*) n->condition, NODE_EMPTY);
+		}
+		case NODE_DEFER: {
+			AST_Defer* n = (AST_Defer*) node;
+			return claim(k, node, sizeof(AST_Defer))
+				&& check_child(k, n, (const AST_Node*) n->code, NODE_EMPTY);
+		}
+		case NODE_CANCEL: {
+			AST_Cancel* n = (AST_Cancel*) node;
+			return claim(k, node, sizeof(AST_Cancel))
+				&& check_child(k, n, (const AST_Node*) n->target, NODE_EMPTY);
+		}
+		default: return false;
+	}
+}
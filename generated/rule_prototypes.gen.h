@@ -0,0 +1,107 @@
+static AST_Name* simple_name(Parser self);
+static AST_Qualname* qualname(Parser self);
+static AST_Int* null_literal(Parser self);
+static AST_Int* int_literal(Parser self);
+static AST_Float* float_literal(Parser self);
+static AST_Bool* bool_literal(Parser self);
+static AST_Char* char_literal(Parser self);
+static AST_String* string_literal(Parser self);
+static AST_Node* atom(Parser self);
+static AST_Node* expression(Parser self, int precedence_before);
+static AST_Node* statement(Parser self);
+static AST_VarDecl* declaration(Parser self);
+static AST_Block* block(Parser self);
+static AST_IfStatement* if_stmt(Parser self);
+static AST_WhileLoop* while_loop(Parser self);
+static AST_Node* for_range(Parser self);
+static AST_ForLoop* for_loop(Parser self);
+static AST_AssignChain* assignment(Parser self, AST_Node* lhs);
+static AST_AssignParallel* assign_many(Parser self, AST_Node* ARRAY lhs);
+static AST_OpAssign* op_assignment(Parser self, AST_Node* lhs);
+static AST_Node* type_match(Parser self);
+static AST_Node* pattern_match(Parser self);
+static AST_With* with_block(Parser self);
+static AST_Const* const_def(Parser self);
+static AST_Node* table_def(Parser self);
+static AST_Struct* struct_def(Parser self);
+static AST_Enum* enum_def(Parser self);
+static AST_Import* import(Parser self);
+static AST_FuncDef* func_def(Parser self);
+static AST_Test* test_def(Parser self);
+static AST_Node* type(Parser self, int precedence_before);
+static AST_ArrayType* array_type(Parser self);
+
+enum {
+	RULE_ID_simple_name,
+	RULE_ID_qualname,
+	RULE_ID_null_literal,
+	RULE_ID_int_literal,
+	RULE_ID_float_literal,
+	RULE_ID_bool_literal,
+	RULE_ID_char_literal,
+	RULE_ID_string_literal,
+	RULE_ID_atom,
+	RULE_ID_expression,
+	RULE_ID_statement,
+	RULE_ID_declaration,
+	RULE_ID_block,
+	RULE_ID_if_stmt,
+	RULE_ID_while_loop,
+	RULE_ID_for_range,
+	RULE_ID_for_loop,
+	RULE_ID_assignment,
+	RULE_ID_assign_many,
+	RULE_ID_op_assignment,
+	RULE_ID_type_match,
+	RULE_ID_pattern_match,
+	RULE_ID_with_block,
+	RULE_ID_toplevel_item,
+	RULE_ID_const_def,
+	RULE_ID_table_def,
+	RULE_ID_struct_def,
+	RULE_ID_enum_def,
+	RULE_ID_import,
+	RULE_ID_func_def,
+	RULE_ID_test_def,
+	RULE_ID_type,
+	RULE_ID_array_type,
+	RULE_COUNT
+};
+
+#ifdef PROFILE_PARSE
+static const char* const RULE_NAMES[RULE_COUNT] = {
+	"simple_name",
+	"qualname",
+	"null_literal",
+	"int_literal",
+	"float_literal",
+	"bool_literal",
+	"char_literal",
+	"string_literal",
+	"atom",
+	"expression",
+	"statement",
+	"declaration",
+	"block",
+	"if_stmt",
+	"while_loop",
+	"for_range",
+	"for_loop",
+	"assignment",
+	"assign_many",
+	"op_assignment",
+	"type_match",
+	"pattern_match",
+	"with_block",
+	"toplevel_item",
+	"const_def",
+	"table_def",
+	"struct_def",
+	"enum_def",
+	"import",
+	"func_def",
+	"test_def",
+	"type",
+	"array_type",
+};
+#endif
@@ -0,0 +1,681 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "alias.h"
+#include "ast_walk.h"
+#include "util.h"
+#include "stb_ds.h"
+
+// Deeper places are taken to overlap anything below the part that is kept
+#define PLACE_MAX_STEPS 8
+
+// What is known of a variable from how it is used
+#define VAR_FRESH   1  // declared with a pointer or array fresh from an allocator
+#define VAR_REBOUND 2  // assigned after its declaration
+#define VAR_SHARED  4  // its value or address may be held somewhere else
+
+typedef enum {
+	ROOT_NONE,      // not a place: a temporary value
+	ROOT_STORAGE,   // a variable holding its own storage
+	ROOT_FRESH,     // a variable holding a pointer or array that nothing else refers to
+	ROOT_RESTRICT,  // a restrict parameter of the function the call is in
+	ROOT_UNKNOWN,   // anything a pointer or array may refer to
+} RootKind;
+
+typedef struct {
+	const char* field;  // NULL for an index or slice
+	int64_t lo, hi;     // the indices it covers, from lo to before hi; lo is -1 if they aren't constant
+} Step;
+
+typedef struct {
+	RootKind kind;
+	SymbolId root;  // 0 for ROOT_UNKNOWN memory that no variable holds
+	int n_steps;
+	Step steps[PLACE_MAX_STEPS];
+	TypeId type;    // of what the place holds, or refers to
+} Place;
+
+typedef struct {
+	AST_FuncDef* def;
+	SymbolId id;
+	bool called_elsewhere;  // pub, or used as a value
+	int first_param;        // in the analysis' restrict_params
+	int first_pair;         // in the analysis' may_alias
+} Function;
+
+typedef struct {
+	const char* src_file;
+	int line, start_col, end_col;
+	char* message;
+} Diagnostic;
+
+struct _alias_analysis {
+	Resolution res;
+	TypeCheck check;
+	TypeTable table;
+	Lowering lower;
+	EscapeAnalysis esc;
+	Function ARRAY funcs;
+	int ARRAY func_of;             // by symbol id: the function's index, or -1
+	uint8_t ARRAY restrict_params; // of every function, one after the other
+	uint8_t ARRAY may_alias;       // of every function, n_params * n_params
+	uint8_t ARRAY vars;            // by symbol id
+	Diagnostic ARRAY errors;
+	int n_restrict, n_checked;
+};
+
+typedef struct {
+	AliasAnalysis alias;
+	const Function* func;  // that the calls walked are in, if any
+	AST_Node* const* callee;  // the slot of the function of the call being walked
+	struct { int param; Place place; } ARRAY args;
+} Walker;
+
+// === Types ===
+
+static inline const Type* get(AliasAnalysis alias, TypeId id) {
+	return type_get(alias->table, id);
+}
+
+static TypeId strip(AliasAnalysis alias, TypeId id) {
+	while (get(alias, id)->kind == TYPE_KIND_MUTABLE || get(alias, id)->kind == TYPE_KIND_OPTIONAL) id = get(alias, id)->base;
+	return id;
+}
+
+/// Whether a value of the type refers to memory: a pointer or an array. Unknown types may.
+static bool is_reference(AliasAnalysis alias, TypeId type) {
+	switch (get(alias, strip(alias, type))->kind) {
+		case TYPE_KIND_UNKNOWN:
+		case TYPE_KIND_POINTER:
+		case TYPE_KIND_RAWPTR:
+		case TYPE_KIND_ARRAY:
+			return true;
+		default:
+			return false;
+	}
+}
+
+/// Whether a value of the type can change the memory it refers to: @!T, ![T] or [!T]
+static bool is_mutable_reference(AliasAnalysis alias, TypeId type) {
+	while (get(alias, type)->kind == TYPE_KIND_OPTIONAL) type = get(alias, type)->base;
+	const Type* t = get(alias, type);
+	if (t->kind == TYPE_KIND_MUTABLE) {
+		TypeId base = strip(alias, type);
+		if (get(alias, base)->kind == TYPE_KIND_ARRAY) return true;
+		return get(alias, base)->kind == TYPE_KIND_POINTER && is_mutable_reference(alias, base);
+	}
+	if (t->kind == TYPE_KIND_POINTER || t->kind == TYPE_KIND_ARRAY) {
+		TypeId base = t->base;
+		while (get(alias, base)->kind == TYPE_KIND_OPTIONAL) base = get(alias, base)->base;
+		return get(alias, base)->kind == TYPE_KIND_MUTABLE;
+	}
+	return false;
+}
+
+/// What a value of the type refers to, or the type itself if it doesn't
+static TypeId referred_type(AliasAnalysis alias, TypeId type) {
+	TypeId value = strip(alias, type);
+	TypeKind kind = get(alias, value)->kind;
+	if (kind == TYPE_KIND_POINTER || kind == TYPE_KIND_ARRAY) value = strip(alias, get(alias, value)->base);
+	return value;
+}
+
+static inline bool is_scalar(AliasAnalysis alias, TypeId type) {
+	TypeKind kind = get(alias, type)->kind;
+	return kind >= TYPE_KIND_BOOL && kind <= TYPE_KIND_RUNE;
+}
+
+static TypeId param_type(AliasAnalysis alias, AST_Param* param) {
+	return typecheck_symbol_type(alias->check, resolution_lookup(alias->res, (AST_Node* const*) &param->name).symbol);
+}
+
+/// The type of a field of a struct, or of what a pointer to one points to; TYPE_UNKNOWN if
+/// there is no such field
+static TypeId field_type(AliasAnalysis alias, TypeId type, const char* name) {
+	type = strip(alias, type);
+	if (get(alias, type)->kind == TYPE_KIND_POINTER) type = strip(alias, get(alias, type)->base);
+	const Type* t = get(alias, type);
+	if (t->kind != TYPE_KIND_STRUCT) return TYPE_UNKNOWN;
+	AST_Struct* decl = (AST_Struct*) t->decl;
+	ptrdiff_t i = shgeti(decl->fields, name);
+	return i < 0? TYPE_UNKNOWN : typecheck_type_of(alias->check, decl->fields[i].value->type);
+}
+
+// === Places ===
+
+static bool is_slice(const AST_Subscript* subscript) {
+	for (int i = 0; i < arrlen(subscript->subscripts); i++) {
+		if (subscript->subscripts[i]->node_type == NODE_SLICE) return true;
+	}
+	return false;
+}
+
+/// The variable a name, its address or a slice of it is, or 0: what a pointer or array
+/// that is held somewhere else may have come from
+static SymbolId variable_of(AliasAnalysis alias, AST_Node* const* slot) {
+	while (true) {
+		AST_Node* node = *slot;
+		if (node->node_type == NODE_REREFERENCE) slot = (AST_Node* const*) &((AST_Reref*) node)->target;
+		else if (node->node_type == NODE_SUBSCRIPT && is_slice((AST_Subscript*) node)) slot = (AST_Node* const*) &((AST_Subscript*) node)->array;
+		else if (node->node_type == NODE_QUALNAME) {
+			ResolvedName found = resolution_lookup(alias->res, slot);
+			return found.n_parts == arrlen(((const AST_Qualname*) node)->parts)? found.symbol : 0;
+		}
+		else return 0;
+	}
+}
+
+static RootKind root_kind(Walker* w, SymbolId id) {
+	AliasAnalysis alias = w->alias;
+	const Symbol* symbol = resolution_symbol(alias->res, id);
+	bool reference = is_reference(alias, typecheck_symbol_type(alias->check, id));
+	switch (symbol->kind) {
+		case DECL_PARAM:
+			for (int p = 0; w->func && p < shlen(w->func->def->params); p++) {
+				if ((AST_Node*) w->func->def->params[p].value == symbol->decl) {
+					if (alias->restrict_params[w->func->first_param + p]) return ROOT_RESTRICT;
+				}
+			}
+			return reference? ROOT_UNKNOWN : ROOT_STORAGE;
+		case DECL_LOCAL:
+		case DECL_LOOP_VAR:
+			if (!reference) return ROOT_STORAGE;
+			return alias->vars[id] == VAR_FRESH? ROOT_FRESH : ROOT_UNKNOWN;
+		case DECL_CONTEXT:
+			return ROOT_UNKNOWN;
+		default:
+			return ROOT_STORAGE;
+	}
+}
+
+static void add_step(Place* place, Step step) {
+	if (place->n_steps < PLACE_MAX_STEPS) place->steps[place->n_steps++] = step;
+}
+
+static inline bool is_int(const AST_Node* node) {
+	return node && node->node_type == NODE_INT;
+}
+
+/// The indices a subscript covers in its dimension
+static Step index_step(const AST_Node* index) {
+	if (is_int(index)) {
+		int64_t i = (int64_t) ((const AST_Int*) index)->value;
+		return (Step) { NULL, i, i + 1 };
+	}
+	if (index->node_type != NODE_SLICE) return (Step) { NULL, -1, -1 };
+	const AST_Slice* slice = (const AST_Slice*) index;
+	if ((slice->start && !is_int(slice->start)) || (slice->end && !is_int(slice->end)) || slice->step) return (Step) { NULL, -1, -1 };
+	int64_t lo = slice->start? (int64_t) ((const AST_Int*) slice->start)->value : 0;
+	int64_t hi = slice->end? (int64_t) ((const AST_Int*) slice->end)->value + slice->is_inclusive : INT64_MAX;
+	return (Step) { NULL, lo, hi };
+}
+
+/// Whether *slot is a variable itself, rather than something in one
+static bool is_variable(AliasAnalysis alias, AST_Node* const* slot) {
+	if ((*slot)->node_type != NODE_QUALNAME) return false;
+	ResolvedName found = resolution_lookup(alias->res, slot);
+	return found.symbol && found.n_parts == arrlen(((const AST_Qualname*) *slot)->parts);
+}
+
+/// The memory an argument gives access to, as a variable and a path of fields and indices
+/// in it. A path that goes through a pointer or array held in a field or element could be
+/// anywhere, so it is ROOT_UNKNOWN.
+static Place place_of(Walker* w, AST_Node* const* slot) {
+	AliasAnalysis alias = w->alias;
+	TypeId type = typecheck_expr_type(alias->check, slot);
+	Place place = { .kind = is_reference(alias, type)? ROOT_UNKNOWN : ROOT_NONE, .type = referred_type(alias, type) };
+	while ((*slot)->node_type == NODE_REREFERENCE) slot = (AST_Node* const*) &((AST_Reref*) *slot)->target;
+	// An argument that is itself a pointer or array kept in a field or element
+	if (!is_variable(alias, slot) && is_reference(alias, typecheck_expr_type(alias->check, slot))) {
+		AST_Node* node = *slot;
+		bool in_place = node->node_type == NODE_SUBSCRIPT && is_slice((AST_Subscript*) node);
+		if (node->node_type == NODE_FUNC_CALL && escape_is_allocation(alias->res, node)) place.kind = ROOT_NONE;
+		if (!in_place) return place;
+	}
+	// Gathered from the outside in
+	Step steps[PLACE_MAX_STEPS];
+	int n_steps = 0;
+	while (true) {
+		AST_Node* node = *slot;
+		AST_Node* const* base;
+		if (node->node_type == NODE_FIELD_ACCESS) {
+			AST_FieldAccess* access = (AST_FieldAccess*) node;
+			for (int i = arrlen(access->field->parts) - 1; i >= 0; i--) {
+				if (n_steps < PLACE_MAX_STEPS) steps[n_steps++] = (Step) { access->field->parts[i], -1, -1 };
+			}
+			base = (AST_Node* const*) &access->base;
+		}
+		else if (node->node_type == NODE_SUBSCRIPT) {
+			AST_Subscript* subscript = (AST_Subscript*) node;
+			for (int i = arrlen(subscript->subscripts) - 1; i >= 0; i--) {
+				if (n_steps < PLACE_MAX_STEPS) steps[n_steps++] = index_step(subscript->subscripts[i]);
+			}
+			base = (AST_Node* const*) &subscript->array;
+		}
+		else if (node->node_type == NODE_QUALNAME) {
+			const AST_Qualname* qn = (const AST_Qualname*) node;
+			ResolvedName found = resolution_lookup(alias->res, slot);
+			if (!found.symbol) return place;
+			// The rest of the name is fields, which mustn't go through pointers either
+			TypeId container = typecheck_symbol_type(alias->check, found.symbol);
+			for (int i = found.n_parts; i < arrlen(qn->parts); i++) {
+				if (i > found.n_parts && is_reference(alias, container)) return place;
+				container = field_type(alias, container, qn->parts[i]);
+			}
+			place.kind = root_kind(w, found.symbol);
+			place.root = found.symbol;
+			for (int i = found.n_parts; i < arrlen(qn->parts); i++) add_step(&place, (Step) { qn->parts[i], -1, -1 });
+			for (int i = n_steps - 1; i >= 0; i--) add_step(&place, steps[i]);
+			return place;
+		}
+		else return place;
+		if (!is_variable(alias, base) && is_reference(alias, typecheck_expr_type(alias->check, base))) return place;
+		slot = base;
+	}
+}
+
+static bool paths_overlap(const Place* a, const Place* b) {
+	int n = a->n_steps < b->n_steps? a->n_steps : b->n_steps;
+	for (int i = 0; i < n; i++) {
+		const Step* x = &a->steps[i];
+		const Step* y = &b->steps[i];
+		if (x->field && y->field && strcmp(x->field, y->field) != 0) return false;
+		if (!x->field && !y->field && x->lo >= 0 && y->lo >= 0 && (x->hi <= y->lo || y->hi <= x->lo)) return false;
+	}
+	return true;
+}
+
+static bool may_overlap(AliasAnalysis alias, const Place* a, const Place* b) {
+	if (a->kind == ROOT_NONE || b->kind == ROOT_NONE) return false;
+	if (a->root && a->root == b->root) return paths_overlap(a, b);
+	if (a->type != b->type && is_scalar(alias, a->type) && is_scalar(alias, b->type)) return false;
+	if (a->kind == ROOT_FRESH || b->kind == ROOT_FRESH || a->kind == ROOT_RESTRICT || b->kind == ROOT_RESTRICT) return false;
+	if (a->kind == ROOT_STORAGE && b->kind == ROOT_STORAGE) return false;
+	// Pointers can only be to variables whose address was taken
+	if (a->kind == ROOT_STORAGE) return alias->vars[a->root] & VAR_SHARED;
+	if (b->kind == ROOT_STORAGE) return alias->vars[b->root] & VAR_SHARED;
+	return true;
+}
+
+// === Facts ===
+
+/// Marks the variable a value comes from as shared, if the value is a pointer or array, or
+/// becomes one: what is passed for a pointer parameter is the address of a variable
+static void share(Walker* w, AST_Node* const* slot, TypeId to) {
+	AliasAnalysis alias = w->alias;
+	if (!is_reference(alias, to) && !is_reference(alias, typecheck_expr_type(alias->check, slot))) return;
+	SymbolId variable = variable_of(alias, slot);
+	if (variable) alias->vars[variable] |= VAR_SHARED;
+}
+
+static void share_arguments(Walker* w, const LoweredCall* call) {
+	AliasAnalysis alias = w->alias;
+	AST_FuncDef* def = (AST_FuncDef*) resolution_symbol(alias->res, call->target)->decl;
+	for (int p = 0; p < call->n_args; p++) {
+		if (!escape_param_keeps(alias->esc, call->target, p)) continue;
+		TypeId type = param_type(alias, def->params[p].value);
+		if (p == call->vararg) {
+			for (int i = 0; i < call->n_varargs; i++) share(w, call->varargs[i], type);
+		}
+		else if (call->args[p]) share(w, call->args[p], type);
+	}
+}
+
+static WalkAction capture_pre(AST_Node** slot, void* ctx) {
+	Walker* w = ctx;
+	if ((*slot)->node_type != NODE_QUALNAME) return WALK_CONTINUE;
+	ResolvedName found = resolution_lookup(w->alias->res, slot);
+	if (found.symbol) w->alias->vars[found.symbol] |= VAR_SHARED;
+	return WALK_CONTINUE;
+}
+
+static void assign(Walker* w, AST_Node* const* dest, AST_Node* const* src) {
+	AliasAnalysis alias = w->alias;
+	share(w, src, typecheck_expr_type(alias->check, dest));
+	SymbolId variable = variable_of(alias, dest);
+	if (variable && (*dest)->node_type != NODE_SUBSCRIPT) alias->vars[variable] |= VAR_REBOUND;
+}
+
+static WalkAction facts_pre(AST_Node** slot, void* ctx) {
+	Walker* w = ctx;
+	AliasAnalysis alias = w->alias;
+	AST_Node* node = *slot;
+	switch (node->node_type) {
+		case NODE_RUN:
+			return WALK_SKIP;
+		case NODE_QUALNAME: {
+			// A function used as a value can be called from anywhere
+			if (slot == w->callee) break;
+			ResolvedName found = resolution_lookup(alias->res, slot);
+			int f = found.symbol? alias->func_of[found.symbol] : -1;
+			if (f >= 0) alias->funcs[f].called_elsewhere = true;
+		} break;
+		case NODE_FUNC_CALL: {
+			AST_FuncCall* call = (AST_FuncCall*) node;
+			w->callee = (AST_Node* const*) &call->func;
+			const LoweredCall* lowered = lowering_call(alias->lower, node);
+			if (lowered) share_arguments(w, lowered);
+			else if (!escape_keeps_nothing(alias->res, call)) {
+				for (int i = 0; i < arrlen(call->pos_args); i++) share(w, &call->pos_args[i], TYPE_UNKNOWN);
+				for (int i = 0; i < shlen(call->kw_args); i++) share(w, &call->kw_args[i].value, TYPE_UNKNOWN);
+			}
+		} break;
+		case NODE_BINOP:
+		case NODE_UNARY:
+		case NODE_OP_ASSIGN: {
+			const LoweredCall* lowered = lowering_call(alias->lower, node);
+			if (lowered) share_arguments(w, lowered);
+			if (node->node_type == NODE_BINOP && strcmp(((AST_Binop*) node)->op, "?") == 0) {
+				TypeId type = typecheck_expr_type(alias->check, slot);
+				share(w, &((AST_Binop*) node)->lhs, type);
+				share(w, &((AST_Binop*) node)->rhs, type);
+			}
+		} break;
+		case NODE_COMPARISON: {
+			AST_ComparisonChain* chain = (AST_ComparisonChain*) node;
+			for (int i = 0; i < arrlen(chain->comparisons); i++) {
+				const LoweredCall* lowered = lowering_comparison(alias->lower, chain, i);
+				if (lowered) share_arguments(w, lowered);
+			}
+		} break;
+		case NODE_VAR_DECL: {
+			AST_VarDecl* decl = (AST_VarDecl*) node;
+			SymbolId id = resolution_lookup(alias->res, (AST_Node* const*) &decl->name).symbol;
+			if (!id) break;
+			// Zeroed or default arrays are new, and pointers null
+			if (!decl->value) {
+				alias->vars[id] |= VAR_FRESH;
+				break;
+			}
+			share(w, &decl->value, typecheck_symbol_type(alias->check, id));
+			switch (decl->value->node_type) {
+				case NODE_ARRAY:
+				case NODE_ARRAY_COMP:
+				case NODE_ARRAY_RANGE:
+				case NODE_PACKED_ARRAY:
+					alias->vars[id] |= VAR_FRESH;
+					break;
+				default:
+					if (escape_is_allocation(alias->res, decl->value)) alias->vars[id] |= VAR_FRESH;
+					break;
+			}
+		} break;
+		case NODE_ASSIGN: {
+			AST_AssignChain* chain = (AST_AssignChain*) node;
+			for (int i = 0; i < arrlen(chain->dest_exprs); i++) assign(w, &chain->dest_exprs[i], &chain->src_expr);
+		} break;
+		case NODE_ASSIGN_MANY: {
+			AST_AssignParallel* parallel = (AST_AssignParallel*) node;
+			int n = arrlen(parallel->dest_exprs);
+			for (int i = 0; i < arrlen(parallel->src_exprs); i++) {
+				if (n == arrlen(parallel->src_exprs)) assign(w, &parallel->dest_exprs[i], &parallel->src_exprs[i]);
+				else share(w, &parallel->src_exprs[i], TYPE_UNKNOWN);
+			}
+			for (int i = 0; i < n && n != arrlen(parallel->src_exprs); i++) {
+				SymbolId variable = variable_of(alias, &parallel->dest_exprs[i]);
+				if (variable) alias->vars[variable] |= VAR_REBOUND;
+			}
+		} break;
+		case NODE_RETURN: {
+			AST_Return* ret = (AST_Return*) node;
+			if (ret->value) share(w, &ret->value, w->func? get(alias, typecheck_symbol_type(alias->check, w->func->id))->base : TYPE_UNKNOWN);
+		} break;
+		case NODE_FAIL: {
+			AST_Fail* fail = (AST_Fail*) node;
+			if (fail->value) share(w, &fail->value, TYPE_UNKNOWN);
+		} break;
+		case NODE_ARRAY: {
+			AST_ArrayLiteral* array = (AST_ArrayLiteral*) node;
+			TypeId element = get(alias, strip(alias, typecheck_expr_type(alias->check, slot)))->base;
+			for (int i = 0; i < arrlen(array->elements); i++) share(w, &array->elements[i], element);
+		} break;
+		case NODE_ARRAY_COMP:
+			share(w, &((AST_ArrayComprehension*) node)->element, TYPE_UNKNOWN);
+			break;
+		case NODE_TERNARY: {
+			AST_Ternary* ternary = (AST_Ternary*) node;
+			TypeId type = typecheck_expr_type(alias->check, slot);
+			share(w, &ternary->true_expr, type);
+			share(w, &ternary->false_expr, type);
+		} break;
+		case NODE_CONTEXT:
+			share(w, &((AST_Context*) node)->value, TYPE_UNKNOWN);
+			break;
+		// Async code may run alongside anything the function does afterwards
+		case NODE_ASYNC:
+			ast_walk_iterative(slot, &(AST_Visitor) { capture_pre, NULL, w });
+			break;
+		default: break;
+	}
+	return WALK_CONTINUE;
+}
+
+// === Checks ===
+
+static void error(AliasAnalysis alias, const AST_Node* at, const char* fmt, ...) {
+	va_list args;
+	va_start(args, fmt);
+	int length = vsnprintf(NULL, 0, fmt, args);
+	va_end(args);
+	char* message = malloc(length + 1);
+	va_start(args, fmt);
+	vsnprintf(message, length + 1, fmt, args);
+	va_end(args);
+	Diagnostic diagnostic = { at->src_file, at->start_line, at->start_col, at->end_line > at->start_line? -1 : (int) at->end_col, message };
+	arrput(alias->errors, diagnostic);
+}
+
+static void add_argument(Walker* w, int param, AST_Node* const* slot) {
+	Place place = place_of(w, slot);
+	if (place.kind == ROOT_NONE) return;
+	arrsetlen(w->args, arrlen(w->args) + 1);
+	arrlast(w->args).param = param;
+	arrlast(w->args).place = place;
+}
+
+/// Checks that what is passed for the restrict parameters of a call doesn't overlap what is
+/// passed for the others, and notes which other parameters were given overlapping arguments
+static void check_call(Walker* w, const AST_Node* at, const LoweredCall* call) {
+	AliasAnalysis alias = w->alias;
+	int f = alias->func_of[call->target];
+	if (f < 0) return;
+	const Function* callee = &alias->funcs[f];
+	const uint8_t* restricted = &alias->restrict_params[callee->first_param];
+	int n_params = shlen(callee->def->params);
+	if (w->args) stbds_header(w->args)->length = 0;
+	bool any_restrict = false;
+	for (int p = 0; p < call->n_args; p++) {
+		AST_Param* param = callee->def->params[p].value;
+		if (!is_reference(alias, param_type(alias, param))) continue;
+		any_restrict |= restricted[p];
+		if (p == call->vararg) {
+			for (int i = 0; i < call->n_varargs; i++) add_argument(w, p, call->varargs[i]);
+		}
+		// Defaults are the function's own constants
+		else if (call->args[p] && call->args[p] != (AST_Node* const*) &param->default_value) add_argument(w, p, call->args[p]);
+	}
+	if (any_restrict) alias->n_checked++;
+	for (int i = 0; i < arrlen(w->args); i++) {
+		for (int j = i + 1; j < arrlen(w->args); j++) {
+			int p = w->args[i].param, q = w->args[j].param;
+			if (p == q || !may_overlap(alias, &w->args[i].place, &w->args[j].place)) continue;
+			if (restricted[p] || restricted[q]) {
+				const char* name = resolution_symbol(alias->res, call->target)->name;
+				const char* p_name = callee->def->params[p].key;
+				const char* q_name = callee->def->params[q].key;
+				error(alias, at, "The arguments for '%s' and '%s' of '%s' may overlap, but '%s' is a mutable reference without '#allow_alias'",
+					p_name, q_name, name, restricted[p]? p_name : q_name);
+				return;
+			}
+			alias->may_alias[callee->first_pair + p * n_params + q] = 1;
+			alias->may_alias[callee->first_pair + q * n_params + p] = 1;
+		}
+	}
+}
+
+static WalkAction check_pre(AST_Node** slot, void* ctx) {
+	Walker* w = ctx;
+	AliasAnalysis alias = w->alias;
+	AST_Node* node = *slot;
+	switch (node->node_type) {
+		case NODE_RUN:
+			return WALK_SKIP;
+		case NODE_FUNC_CALL:
+		case NODE_BINOP:
+		case NODE_UNARY:
+		case NODE_OP_ASSIGN: {
+			const LoweredCall* call = lowering_call(alias->lower, node);
+			if (call) check_call(w, node, call);
+		} break;
+		case NODE_COMPARISON: {
+			AST_ComparisonChain* chain = (AST_ComparisonChain*) node;
+			for (int i = 0; i < arrlen(chain->comparisons); i++) {
+				const LoweredCall* call = lowering_comparison(alias->lower, chain, i);
+				if (call) check_call(w, node, call);
+			}
+		} break;
+		default: break;
+	}
+	return WALK_CONTINUE;
+}
+
+/// Walks the bodies of the module's functions, each with the function it is in, and the
+/// rest of its items with none
+static void walk_module(AST_Module* module, Walker* w, WalkAction (*pre)(AST_Node**, void*)) {
+	AliasAnalysis alias = w->alias;
+	for (int i = 0; i < shlen(module->scope); i++) {
+		AST_Node** item = &module->scope[i].value;
+		w->func = NULL;
+		w->callee = NULL;
+		if ((*item)->node_type == NODE_FUNC_DEF) {
+			AST_FuncDef* def = (AST_FuncDef*) *item;
+			SymbolId id = resolution_lookup(alias->res, (AST_Node* const*) &def->name).symbol;
+			if (!id || !def->body) continue;
+			w->func = &alias->funcs[alias->func_of[id]];
+			item = (AST_Node**) &def->body;
+		}
+		ast_walk_iterative(item, &(AST_Visitor) { pre, NULL, w });
+	}
+}
+
+// === Diagnostics ===
+
+static int compare_diagnostics(const void* a, const void* b) {
+	const Diagnostic* x = a;
+	const Diagnostic* y = b;
+	if (x->line != y->line) return x->line < y->line? -1 : 1;
+	return (x->start_col > y->start_col) - (x->start_col < y->start_col);
+}
+
+static void report_errors(Diagnostic* errors, int n) {
+	if (!n) return;
+	qsort(errors, n, sizeof(Diagnostic), compare_diagnostics);
+	char* source = (char*) read_entire_file(errors[0].src_file);
+	const char* ARRAY lines = NULL;
+	for (char* p = source; p && *p; p++) {
+		if (p == source) arrput(lines, p);
+		if (*p != '\n') continue;
+		*p = 0;
+		arrput(lines, p + 1);
+	}
+	for (int i = 0; i < n; i++) {
+		const Diagnostic* d = &errors[i];
+		fprintf(stderr, "In '%s' at line %d, column %d...\n  Alias error: %s\n", d->src_file, d->line, d->start_col, d->message);
+		if (d->line >= 1 && d->line <= arrlen(lines)) {
+			const char* line = lines[d->line - 1];
+			show_error_line(stderr, line, d->line, d->start_col, d->end_col < 0? (int) strlen(line) : d->end_col);
+		}
+	}
+	free(source);
+	arrfree(lines);
+}
+
+// === Analysis ===
+
+AliasAnalysis alias_analyze(AST_Module* module, Resolution res, TypeCheck check, TypeTable table, Lowering lower,
+		EscapeAnalysis esc) {
+	AliasAnalysis alias = calloc(1, sizeof(struct _alias_analysis));
+	alias->res = res;
+	alias->check = check;
+	alias->table = table;
+	alias->lower = lower;
+	alias->esc = esc;
+	int n_symbols = resolution_symbol_count(res) + 1;
+	arrsetlen(alias->func_of, n_symbols);
+	for (int i = 0; i < n_symbols; i++) alias->func_of[i] = -1;
+	arrsetlen(alias->vars, n_symbols);
+	memset(alias->vars, 0, n_symbols);
+	for (int i = 0; i < shlen(module->scope); i++) {
+		AST_Node* item = module->scope[i].value;
+		if (item->node_type != NODE_FUNC_DEF) continue;
+		AST_FuncDef* def = (AST_FuncDef*) item;
+		SymbolId id = resolution_lookup(res, (AST_Node* const*) &def->name).symbol;
+		if (!id) continue;
+		int n_params = shlen(def->params);
+		Function func = { def, id, def->pub, arrlen(alias->restrict_params), arrlen(alias->may_alias) };
+		alias->func_of[id] = arrlen(alias->funcs);
+		arrput(alias->funcs, func);
+		for (int p = 0; p < n_params; p++) {
+			AST_Param* param = def->params[p].value;
+			bool restricted = !param->allow_alias && is_mutable_reference(alias, param_type(alias, param));
+			arrput(alias->restrict_params, restricted);
+			alias->n_restrict += restricted;
+		}
+		if (!n_params) continue;
+		int first = arraddn(alias->may_alias, n_params * n_params);
+		memset(&alias->may_alias[first], 0, n_params * n_params);
+	}
+
+	Walker w = { .alias = alias };
+	walk_module(module, &w, facts_pre);
+	walk_module(module, &w, check_pre);
+	report_errors(alias->errors, arrlen(alias->errors));
+	arrfree(w.args);
+	return alias;
+}
+
+void alias_destroy(AliasAnalysis alias) {
+	if (!alias) return;
+	for (int i = 0; i < arrlen(alias->errors); i++) free(alias->errors[i].message);
+	arrfree(alias->errors);
+	arrfree(alias->funcs);
+	arrfree(alias->func_of);
+	arrfree(alias->restrict_params);
+	arrfree(alias->may_alias);
+	arrfree(alias->vars);
+	free(alias);
+}
+
+int alias_error_count(AliasAnalysis alias) {
+	return arrlen(alias->errors);
+}
+
+static const Function* find_function(AliasAnalysis alias, SymbolId func) {
+	int f = func > 0 && func < arrlen(alias->func_of)? alias->func_of[func] : -1;
+	return f < 0? NULL : &alias->funcs[f];
+}
+
+bool alias_is_restrict(AliasAnalysis alias, SymbolId func, int param) {
+	const Function* f = find_function(alias, func);
+	return f && alias->restrict_params[f->first_param + param];
+}
+
+bool alias_params_disjoint(AliasAnalysis alias, SymbolId func, int p, int q) {
+	const Function* f = find_function(alias, func);
+	if (!f) return false;
+	if (alias->restrict_params[f->first_param + p] || alias->restrict_params[f->first_param + q]) return true;
+	if (!is_reference(alias, param_type(alias, f->def->params[p].value))) return true;
+	if (!is_reference(alias, param_type(alias, f->def->params[q].value))) return true;
+	if (p == q || f->called_elsewhere) return false;
+	return !alias->may_alias[f->first_pair + p * shlen(f->def->params) + q];
+}
+
+int alias_restrict_count(AliasAnalysis alias) {
+	return alias->n_restrict;
+}
+
+int alias_checked_count(AliasAnalysis alias) {
+	return alias->n_checked;
+}
@@ -0,0 +1,41 @@
+#pragma once
+// Alias analysis: mutable references passed to a function are 'restrict' (design.md), so at
+// each call it must be proven that no other argument refers to the memory they do
+#include <stdbool.h>
+
+#include "ast.h"
+#include "resolve.h"
+#include "typecheck.h"
+#include "types.h"
+#include "lower.h"
+#include "escape.h"
+
+typedef struct _alias_analysis* AliasAnalysis;
+
+/// Checks the lowered calls of a module that type-checked without errors. An argument for
+/// a mutable reference parameter (@!T, ![T]...) without '#allow_alias' must not overlap any
+/// other argument that refers to memory (pointers, arrays, other mutable references).
+/// Arguments are places: a local, parameter or constant, then fields and indices of it.
+/// They are apart if they are rooted in different variables that hold their own storage,
+/// or hold pointers or arrays fresh from an allocator that weren't shared, or are
+/// parameters that are themselves restrict; or if they have different fields, or different
+/// constant indices, in the same place; or if they refer to different scalar types. Calls
+/// where that can't be shown are errors, reported to stderr in the order of the source.
+/// The handle keeps nodes of the tree, so the module must outlive it.
+AliasAnalysis alias_analyze(AST_Module* module, Resolution res, TypeCheck check, TypeTable table, Lowering lower,
+	EscapeAnalysis esc);
+void alias_destroy(AliasAnalysis alias);
+
+int alias_error_count(AliasAnalysis alias);
+/// Whether parameter `param` of a function may be taken not to alias anything else it can
+/// reach, as a C 'restrict' pointer
+bool alias_is_restrict(AliasAnalysis alias, SymbolId func, int param);
+/// Whether two parameters of a function are never the same memory: one of them is restrict,
+/// or the function can only be called from the module, and no call of it passes them
+/// arguments that may overlap
+bool alias_params_disjoint(AliasAnalysis alias, SymbolId func, int p, int q);
+
+/// Parameters that are restrict, over all the module's functions
+int alias_restrict_count(AliasAnalysis alias);
+/// Calls that pass something to a restrict parameter, which were checked
+int alias_checked_count(AliasAnalysis alias);
@@ -40,5 +40,16 @@ typedef struct {
 
 #include "ast_nodes.h"
 
+/// Functions named with an operator overload it, as in 'func + (a: V, b: V): V'
+static inline bool ast_is_operator_name(const char* name) {
+	switch (name[0]) {
+		case '+': case '-': case '*': case '/': case '%': case '^':
+		case '&': case '|': case '~': case '=': case '!': case '<': case '>':
+			return true;
+		default:
+			return false;
+	}
+}
+
 void print_ast(FILE* stream, const AST_Node* root);
 void ast_to_json(FILE* stream, const AST_Node* root);
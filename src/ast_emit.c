@@ -0,0 +1,316 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "ast.h"
+#include "utf8.h"
+#include "stb_ds.h"
+
+// Exact float comparisons are the point of the formatting code below
+#pragma GCC diagnostic ignored "-Wfloat-equal"
+
+// === Output buffer ===
+// Everything is written through one large buffer that is flushed straight to the stream,
+// so the output never exists in memory as a whole, and numbers are formatted by hand.
+
+#define EMIT_BUFFER_SIZE (256 * 1024)
+#define EMIT_MAX_NUMBER 64  // longest formatted number, written without further checks
+
+typedef struct {
+	FILE* stream;
+	char* pos;
+	char* end;
+	char buf[EMIT_BUFFER_SIZE];
+} Emitter;
+
+static Emitter* emitter_create(FILE* stream) {
+	Emitter* e = malloc(sizeof(Emitter));
+	e->stream = stream;
+	e->pos = e->buf;
+	e->end = e->buf + EMIT_BUFFER_SIZE;
+	return e;
+}
+
+static void emit_flush(Emitter* e) {
+	fwrite(e->buf, 1, e->pos - e->buf, e->stream);
+	e->pos = e->buf;
+}
+
+static void emitter_destroy(Emitter* e) {
+	emit_flush(e);
+	fflush(e->stream);
+	free(e);
+}
+
+static inline void emit_reserve(Emitter* e, size_t n_bytes) {
+	if ((size_t) (e->end - e->pos) < n_bytes) emit_flush(e);
+}
+
+static inline void emit_char(Emitter* e, char c) {
+	if (e->pos == e->end) emit_flush(e);
+	*e->pos++ = c;
+}
+
+static inline void emit_bytes(Emitter* e, const char* bytes, size_t n_bytes) {
+	if ((size_t) (e->end - e->pos) < n_bytes) {
+		emit_flush(e);
+		if (n_bytes > EMIT_BUFFER_SIZE) {
+			fwrite(bytes, 1, n_bytes, e->stream);
+			return;
+		}
+	}
+	memcpy(e->pos, bytes, n_bytes);
+	e->pos += n_bytes;
+}
+
+static inline void emit_str(Emitter* e, const char* str) {
+	emit_bytes(e, str, strlen(str));
+}
+
+#define EMIT_LITERAL(E, STR) emit_bytes((E), (STR), sizeof(STR) - 1)
+
+static void emit_indent(Emitter* e, int levels) {
+	static const char spaces[] = "                                                                ";
+	for (size_t n = 2 * (levels > 0? levels : 0); n > 0; ) {
+		size_t chunk = n < sizeof(spaces) - 1? n : sizeof(spaces) - 1;
+		emit_bytes(e, spaces, chunk);
+		n -= chunk;
+	}
+}
+
+// === Numbers ===
+
+static const char DIGIT_PAIRS[] =
+	"00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+	"40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+	"8081828384858687888990919293949596979899";
+
+// Writes the digits of `value` so that they end right before `end`, and returns their start
+static char* format_uint(char* end, uintmax_t value) {
+	while (value >= 100) {
+		const char* pair = DIGIT_PAIRS + 2 * (value % 100);
+		value /= 100;
+		*--end = pair[1];
+		*--end = pair[0];
+	}
+	if (value >= 10) {
+		*--end = DIGIT_PAIRS[2 * value + 1];
+		*--end = DIGIT_PAIRS[2 * value];
+	}
+	else {
+		*--end = '0' + value;
+	}
+	return end;
+}
+
+static void emit_uint(Emitter* e, uintmax_t value) {
+	char digits[24];
+	char* start = format_uint(digits + sizeof(digits), value);
+	emit_bytes(e, start, digits + sizeof(digits) - start);
+}
+
+static void emit_int(Emitter* e, intmax_t value) {
+	char digits[24];
+	char* end = digits + sizeof(digits);
+	char* start = format_uint(end, value < 0? -(uintmax_t) value : (uintmax_t) value);
+	if (value < 0) *--start = '-';
+	emit_bytes(e, start, end - start);
+}
+
+static void emit_hex(Emitter* e, uintmax_t value, int min_digits) {
+	char digits[24];
+	char* end = digits + sizeof(digits);
+	char* start = end;
+	do {
+		*--start = "0123456789abcdef"[value & 0xf];
+		value >>= 4;
+	} while (value || end - start < min_digits);
+	emit_bytes(e, start, end - start);
+}
+
+static void emit_pointer(Emitter* e, const void* pointer) {
+	// Same spelling as glibc's %p
+	if (!pointer) {
+		EMIT_LITERAL(e, "(nil)");
+		return;
+	}
+	EMIT_LITERAL(e, "0x");
+	emit_hex(e, (uintptr_t) pointer, 1);
+}
+
+static const double POW10[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+// Formats a positive finite `x` with `n_digits` significant digits in positional notation,
+// trailing zeros removed, which is what %.{n_digits}g prints when it does not switch to an
+// exponent. With `exact`, only succeeds if the printed number reads back as exactly `x`.
+// Returns the length written to `out`, or 0 when this fast path can't vouch for the result.
+static int format_positional(char* out, double x, int n_digits, bool exact) {
+	int exponent = (int) floor(log10(x));
+	if (exponent < -4 || exponent >= n_digits) return 0;
+	int shift = n_digits - 1 - exponent;
+	double scaled = x * POW10[shift];
+	double rounded = nearbyint(scaled);
+	if (exact) {
+		// Both operands are exact, so the division rounds the same way strtod would
+		if (rounded != scaled || rounded / POW10[shift] != x) return 0;
+	}
+	else if (fabs(scaled - rounded) > 0.5 - 1e-6) {
+		return 0;  // too close to a tie to be sure which way printf would round
+	}
+	// Also catches log10 landing on the wrong side of a power of ten
+	if (rounded < POW10[n_digits - 1] || rounded >= POW10[n_digits]) return 0;
+
+	char digits[24];
+	char* digits_end = digits + sizeof(digits);
+	format_uint(digits_end, (uint64_t) rounded);
+	char* digit = digits_end - n_digits;
+	char* p = out;
+	if (exponent >= 0) {
+		memcpy(p, digit, exponent + 1);
+		p += exponent + 1;
+		digit += exponent + 1;
+	}
+	else {
+		*p++ = '0';
+	}
+	while (digits_end > digit && digits_end[-1] == '0') digits_end--;
+	if (exponent < 0 || digit < digits_end) {
+		*p++ = '.';
+		for (int i = exponent + 1; i < 0; i++) *p++ = '0';
+		memcpy(p, digit, digits_end - digit);
+		p += digits_end - digit;
+	}
+	return p - out;
+}
+
+// Text output matches %Lg. JSON output is the nearest double, written so that it reads back
+// as exactly that double, since that is all a JSON reader can hold anyway.
+static void emit_float(Emitter* e, long double value, bool json) {
+	emit_reserve(e, EMIT_MAX_NUMBER);
+	char* out = e->pos;
+	double x = (double) value;
+	if (isnan(x) || isinf(x)) {
+		if (json) e->pos += sprintf(out, "null");
+		else e->pos += snprintf(out, EMIT_MAX_NUMBER, "%Lg", value);
+		return;
+	}
+	if (signbit(x)) *out++ = '-';
+	if (x == 0) {
+		*out++ = '0';
+		e->pos = out;
+		return;
+	}
+	int len = json
+		? format_positional(out, fabs(x), 15, true)
+		: format_positional(out, fabs(x), 6, false);
+	if (!len && json) len = format_positional(out, fabs(x), 17, true);
+	if (len) {
+		e->pos = out + len;
+		return;
+	}
+	if (json) e->pos += snprintf(e->pos, EMIT_MAX_NUMBER, "%.17g", x);
+	else e->pos += snprintf(e->pos, EMIT_MAX_NUMBER, "%Lg", value);
+}
+
+// === Strings ===
+
+static void emit_text_string(Emitter* e, const char* str) {
+	if (!str) {
+		EMIT_LITERAL(e, "<null>");
+		return;
+	}
+	emit_char(e, '"');
+	emit_str(e, str);
+	emit_char(e, '"');
+}
+
+static void emit_quoted_rune(Emitter* e, Rune rune) {
+	emit_reserve(e, 6);
+	*e->pos++ = '\'';
+	e->pos = utf8_write(e->pos, rune);
+	*e->pos++ = '\'';
+}
+
+static const char* const JSON_ESCAPES[0x20] = {
+	"\\u0000", "\\u0001", "\\u0002", "\\u0003", "\\u0004", "\\u0005", "\\u0006", "\\u0007",
+	"\\b",     "\\t",     "\\n",     "\\u000b", "\\f",     "\\r",     "\\u000e", "\\u000f",
+	"\\u0010", "\\u0011", "\\u0012", "\\u0013", "\\u0014", "\\u0015", "\\u0016", "\\u0017",
+	"\\u0018", "\\u0019", "\\u001a", "\\u001b", "\\u001c", "\\u001d", "\\u001e", "\\u001f",
+};
+
+static void emit_json_string(Emitter* e, const char* str) {
+	if (!str) {
+		EMIT_LITERAL(e, "null");
+		return;
+	}
+	emit_char(e, '"');
+	// Copy runs that need no escaping in one go
+	const char* run = str;
+	for (const char* p = str; *p; p++) {
+		unsigned char c = *p;
+		if (c >= 0x20 && c != '"' && c != '\\') continue;
+		emit_bytes(e, run, p - run);
+		if (c < 0x20) emit_str(e, JSON_ESCAPES[c]);
+		else {
+			emit_char(e, '\\');
+			emit_char(e, c);
+		}
+		run = p + 1;
+	}
+	emit_str(e, run);
+	emit_char(e, '"');
+}
+
+static void emit_json_rune(Emitter* e, Rune rune) {
+	char str[5] = {0};
+	utf8_write(str, rune);
+	emit_json_string(e, str);
+}
+
+// === AST ===
+// Nodes nest as deeply as the parser lets them, so they're written from an explicit stack
+// of frames rather than by recursing, each frame resumed after the child it stopped for.
+
+typedef struct {
+	const AST_Node* node;
+	int indent;               // for print_ast
+	const char* parent_file;  // for ast_to_json
+	int step;                 // where the node's writing stopped, 0 before it started
+	int index;                // of the child in the array or map being written
+} EmitFrame;
+
+typedef bool (*EmitStep)(Emitter* e, EmitFrame* f, EmitFrame* child);
+
+static void emit_tree(Emitter* e, EmitFrame root, EmitStep step) {
+	EmitFrame ARRAY stack = NULL;
+	arrput(stack, root);
+	while (arrlen(stack)) {
+		EmitFrame child;
+		if (step(e, &arrlast(stack), &child)) arrput(stack, child);
+		else (void) arrpop(stack);
+	}
+	arrfree(stack);
+}
+
+#include "ast_print.impl.gen.h"
+#include "ast_json.impl.gen.h"
+
+void print_ast(FILE* stream, const AST_Node* root) {
+	Emitter* e = emitter_create(stream);
+	EMIT_LITERAL(e, "From '");
+	emit_str(e, root->src_file? root->src_file : "(null)");
+	EMIT_LITERAL(e, "':\n  ");
+	emit_tree(e, (EmitFrame) { .node = root, .indent = 1 }, emit_ast_step);
+	emitter_destroy(e);
+}
+
+void ast_to_json(FILE* stream, const AST_Node* root) {
+	Emitter* e = emitter_create(stream);
+	emit_tree(e, (EmitFrame) { .node = root }, emit_json_step);
+	emit_char(e, '\n');
+	emitter_destroy(e);
+}
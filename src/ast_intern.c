@@ -0,0 +1,229 @@
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "ast_intern.h"
+#include "ast_walk.h"
+#include "stb_ds.h"
+
+#ifndef INTERN_ARENA_SIZE
+#define INTERN_ARENA_SIZE (16 * 1024)
+#endif
+
+#define INTERN_ALIGN 16  // for long double
+
+typedef struct {
+	uint64_t hash;
+	AST_Node* node;  // NULL = free slot
+} InternSlot;
+
+struct _node_interner {
+	void** arenas;
+	char* arena_current;
+	InternSlot* slots;  // open addressing
+	size_t mask, count;
+	struct { char* key; bool value; } MAP strings;  // copies of every string a shared node holds
+	size_t string_bytes, array_bytes;
+};
+
+static const bool SHAREABLE[NODE_MAX] = {
+	[NODE_QUALNAME] = true,
+	[NODE_INT] = true,
+	[NODE_FLOAT] = true,
+	[NODE_BOOL] = true,
+	[NODE_STRING] = true,
+	[NODE_CHAR] = true,
+	[NODE_NULL] = true,
+	[NODE_SIMPLE_TYPE] = true,
+	[NODE_POINTER_TYPE] = true,
+	[NODE_MUTABLE_TYPE] = true,
+	[NODE_OPTIONAL_TYPE] = true,
+	[NODE_ARRAY_TYPE] = true,
+	[NODE_FUNC_TYPE] = true,
+	[NODE_TEMPLATE_TYPE] = true,
+	[NODE_UNION] = true,
+};
+
+NodeInterner node_interner_create(void) {
+	NodeInterner self = calloc(1, sizeof(struct _node_interner));
+	sh_new_arena(self->strings);
+	return self;
+}
+
+void node_interner_destroy(NodeInterner self) {
+	if (!self) return;
+	for (size_t i = 0; self->count && i <= self->mask; i++) {
+		if (self->slots[i].node) ast_free_owned_shallow(self->slots[i].node);
+	}
+	free(self->slots);
+	for (int i = 0; i < arrlen(self->arenas); i++) free(self->arenas[i]);
+	arrfree(self->arenas);
+	shfree(self->strings);
+	free(self);
+}
+
+bool node_type_is_shareable(NodeType type) {
+	return (unsigned) type < NODE_MAX && SHAREABLE[type];
+}
+
+bool node_children_are_shared(const AST_Node* node) {
+	const AST_NodeLayout* layout = &AST_LAYOUT[node->node_type];
+	for (int i = 0; i < layout->n_fields; i++) {
+		const char* at = (const char*) node + layout->fields[i].offset;
+		switch (layout->fields[i].kind) {
+			case AST_CHILD_NODE: {
+				const AST_Node* child = *(AST_Node* const*) at;
+				if (child && !ast_is_shared(child)) return false;
+			} break;
+			case AST_CHILD_ARRAY: {
+				AST_Node* const* items = *(AST_Node* const* const*) at;
+				for (int j = 0; j < arrlen(items); j++) {
+					if (items[j] && !ast_is_shared(items[j])) return false;
+				}
+			} break;
+			case AST_CHILD_MAP:
+				if (shlen(*(ASTMAP_NodeEntry* const*) at)) return false;
+				break;
+			default: break;
+		}
+	}
+	return true;
+}
+
+static const char* intern_string(NodeInterner self, const char* str) {
+	if (!str) return NULL;
+	ptrdiff_t i = shgeti(self->strings, str);
+	if (i < 0) {
+		i = shputi(self->strings, str, true);
+		self->string_bytes += strlen(str) + 1;
+	}
+	return self->strings[i].key;
+}
+
+static bool is_array_field(const AST_ChildField* field) {
+	return field->kind == AST_CHILD_ARRAY || field->kind == AST_CHILD_VALUE_ARRAY;
+}
+
+// Everything after the common fields is compared byte for byte (nodes come zeroed, so
+// padding is too), except for arrays, whose items are compared instead. The arrays of
+// shareable nodes all hold pointers: to shared children, or to interned strings.
+
+static inline uint64_t hash_add(uint64_t hash, const void* data, size_t len) {
+	for (size_t i = 0; i < len; i++) {
+		hash ^= ((const unsigned char*) data)[i];
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+static uint64_t node_hash(const AST_Node* node) {
+	const AST_NodeLayout* layout = &AST_LAYOUT[node->node_type];
+	uint64_t hash = hash_add(0xcbf29ce484222325ull, &node->node_type, sizeof(node->node_type));
+	size_t pos = sizeof(AST_Node);
+	for (int i = 0; i < layout->n_fields; i++) {
+		const AST_ChildField* field = &layout->fields[i];
+		if (!is_array_field(field)) continue;
+		hash = hash_add(hash, (const char*) node + pos, field->offset - pos);
+		void* const* items = *(void* const* const*) ((const char*) node + field->offset);
+		size_t len = arrlen(items);
+		hash = hash_add(hash, &len, sizeof(len));
+		hash = hash_add(hash, items, len * sizeof(void*));
+		pos = field->offset + sizeof(void*);
+	}
+	return hash_add(hash, (const char*) node + pos, layout->size - pos);
+}
+
+static bool node_equal(const AST_Node* a, const AST_Node* b) {
+	if (a->node_type != b->node_type) return false;
+	const AST_NodeLayout* layout = &AST_LAYOUT[a->node_type];
+	size_t pos = sizeof(AST_Node);
+	for (int i = 0; i < layout->n_fields; i++) {
+		const AST_ChildField* field = &layout->fields[i];
+		if (!is_array_field(field)) continue;
+		if (memcmp((const char*) a + pos, (const char*) b + pos, field->offset - pos)) return false;
+		void* const* x = *(void* const* const*) ((const char*) a + field->offset);
+		void* const* y = *(void* const* const*) ((const char*) b + field->offset);
+		if (arrlen(x) != arrlen(y) || (arrlen(x) && memcmp(x, y, arrlen(x) * sizeof(void*)))) return false;
+		pos = field->offset + sizeof(void*);
+	}
+	return memcmp((const char*) a + pos, (const char*) b + pos, layout->size - pos) == 0;
+}
+
+static void* arena_alloc(NodeInterner self, size_t n_bytes) {
+	n_bytes = (n_bytes + INTERN_ALIGN - 1) & ~(size_t) (INTERN_ALIGN - 1);
+	if (!self->arena_current || self->arena_current - (char*) arrlast(self->arenas) + n_bytes > INTERN_ARENA_SIZE) {
+		self->arena_current = calloc(INTERN_ARENA_SIZE, 1);
+		assert(self->arena_current && "Unable to allocate next block of arena!!!");
+		arrpush(self->arenas, self->arena_current);
+	}
+	void* result = self->arena_current;
+	self->arena_current += n_bytes;
+	return result;
+}
+
+static void table_insert(NodeInterner self, uint64_t hash, AST_Node* node) {
+	if (2 * (self->count + 1) > self->mask) {
+		size_t old_mask = self->mask;
+		InternSlot* old = self->slots;
+		self->mask = 2 * self->mask + 1;
+		if (self->mask < 63) self->mask = 63;
+		self->slots = calloc(self->mask + 1, sizeof(InternSlot));
+		self->count = 0;
+		for (size_t i = 0; old && i <= old_mask; i++) {
+			if (old[i].node) table_insert(self, old[i].hash, old[i].node);
+		}
+		free(old);
+	}
+	size_t i = hash & self->mask;
+	while (self->slots[i].node) i = (i + 1) & self->mask;
+	self->slots[i] = (InternSlot) { hash, node };
+	self->count++;
+}
+
+AST_Node* node_interner_intern(NodeInterner self, AST_Node* node) {
+	switch (node->node_type) {
+		case NODE_QUALNAME: {
+			AST_Qualname* qn = (AST_Qualname*) node;
+			for (int i = 0; i < arrlen(qn->parts); i++) qn->parts[i] = intern_string(self, qn->parts[i]);
+		} break;
+		case NODE_STRING: {
+			AST_String* str = (AST_String*) node;
+			str->value = intern_string(self, str->value);
+		} break;
+		default: break;
+	}
+
+	uint64_t hash = node_hash(node);
+	for (size_t i = hash & self->mask; self->slots && self->slots[i].node; i = (i + 1) & self->mask) {
+		if (self->slots[i].hash == hash && node_equal(self->slots[i].node, node)) {
+			ast_free_owned_shallow(node);
+			return self->slots[i].node;
+		}
+	}
+
+	const AST_NodeLayout* layout = &AST_LAYOUT[node->node_type];
+	AST_Node* shared = arena_alloc(self, layout->size);
+	memcpy(shared, node, layout->size);
+	shared->src_file = NULL;
+	shared->tags = NULL;
+	shared->start_line = shared->start_col = shared->end_line = shared->end_col = 0;
+	for (int i = 0; i < layout->n_fields; i++) {
+		if (!is_array_field(&layout->fields[i])) continue;
+		void* items = *(void**) ((char*) shared + layout->fields[i].offset);
+		self->array_bytes += arrcap(items) * sizeof(void*);
+	}
+	table_insert(self, hash, shared);
+	return shared;
+}
+
+size_t node_interner_count(NodeInterner self) {
+	return self->count;
+}
+
+size_t node_interner_memory_usage(NodeInterner self) {
+	return sizeof(struct _node_interner)
+		+ arrlen(self->arenas) * INTERN_ARENA_SIZE
+		+ (self->slots? (self->mask + 1) * sizeof(InternSlot) : 0)
+		+ self->string_bytes + shlen(self->strings) * sizeof(*self->strings)
+		+ self->array_bytes;
+}
@@ -0,0 +1,37 @@
+#pragma once
+// Hash-consing of location-independent subtrees: types, literals and qualified names
+//
+// Each distinct subtree is kept once, so two of them are structurally equal exactly
+// when they are the same pointer. Shared nodes have no location (src_file is NULL and
+// the positions are 0); the parser records where each occurrence is (parser_node_location).
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "ast.h"
+
+typedef struct _node_interner* NodeInterner;
+
+NodeInterner node_interner_create(void);
+/// Frees every shared node, along with the arrays and strings they hold
+void node_interner_destroy(NodeInterner interner);
+
+/// Whether nodes of this type can be shared, given children that are shared themselves
+bool node_type_is_shareable(NodeType type);
+
+/// Whether every child of the node is shared (or null), so the node can be shared too
+bool node_children_are_shared(const AST_Node* node);
+
+/// Returns the shared node equal to the given one, which must be shareable with shared
+/// children. The node is left for its owner to discard: its arrays now belong to the
+/// shared node, or have been freed.
+AST_Node* node_interner_intern(NodeInterner interner, AST_Node* node);
+
+/// Distinct shared nodes so far
+size_t node_interner_count(NodeInterner interner);
+
+/// Bytes held by the shared nodes, their arrays and their strings
+size_t node_interner_memory_usage(NodeInterner interner);
+
+static inline bool ast_is_shared(const AST_Node* node) {
+	return !node->src_file;
+}
@@ -67,6 +67,7 @@ typedef struct NODE_PARAM {
 	AST_Node* default_value;
 	bool is_vararg;
 	bool is_kw_only;
+	bool allow_alias;  // '#allow_alias': other arguments may be the memory it refers to
 } AST_Param;
 
 typedef struct NODE_FUNC_DEF {
@@ -105,6 +106,7 @@ typedef struct NODE_FIELD {
 	AST_Name* name;
 	AST_Node* type;
 	AST_Node* default_value;
+	AST_Node* invariant;  // '#invariant': of the field's value, which is named by the field's name
 	bool is_using;
 } AST_Field;
 
@@ -136,6 +138,18 @@ typedef struct NODE_TEST {
 	AST_Block* body;
 } AST_Test;
 
+// '#run statement' at the top level, run at compile time
+typedef struct NODE_RUN {
+	AST_NODE_COMMON_FIELDS
+	AST_Node* statement;
+} AST_Run;
+
+// '#warn name' at the top level, which turns on an optional warning for the module
+typedef struct NODE_WARN {
+	AST_NODE_COMMON_FIELDS
+	const char* warning;
+} AST_Warn;
+
 typedef struct NODE_MODULE {
 	AST_NODE_COMMON_FIELDS
 	struct { const char* key; AST_Node* value; } MAP scope;
@@ -228,6 +242,21 @@ typedef struct NODE_ARRAY_RANGE {
 	bool is_inclusive;
 } AST_ArrayRange;
 
+typedef enum PACKED_ {
+	PACKED_INT   = 0,
+	PACKED_FLOAT = 1,
+} PackedKind;
+
+// A large rectangular array literal of numbers, stored as a flat buffer instead of one
+// node per element; the elements themselves have no locations.
+typedef struct NODE_PACKED_ARRAY {
+	AST_NODE_COMMON_FIELDS
+	PackedKind kind;
+	size_t ARRAY shape;   // outermost dimension first
+	intmax_t ARRAY ints;  // row-major, for PACKED_INT; negative literals are folded in
+	double ARRAY floats;  // row-major, for PACKED_FLOAT
+} AST_PackedArray;
+
 typedef union {
 	struct {
 		AST_NODE_COMMON_FIELDS
@@ -452,6 +481,18 @@ typedef struct NODE_ASSERT {
 	AST_Node* message;
 } AST_Assert;
 
+typedef enum CONTRACT_ {
+	CONTRACT_PRE    = 0,  // '#pre': holds on entry, for every call
+	CONTRACT_POST   = 1,  // '#post': holds on return
+	CONTRACT_ASSUME = 2,  // '#assume': taken to hold from where it is, unchecked
+} ContractKind;
+
+typedef struct NODE_CONTRACT {
+	AST_NODE_COMMON_FIELDS
+	ContractKind kind;
+	AST_Node* condition;
+} AST_Contract;
+
 typedef struct NODE_DEFER {
 	AST_NODE_COMMON_FIELDS
 	AST_Node* code;
@@ -0,0 +1,92 @@
+"""Shared reader for ast_nodes.h, used by the generators that need to know node layouts."""
+
+import os.path
+import re
+
+ast_nodes_h = os.path.join(os.path.dirname(__file__), 'ast_nodes.h')
+
+QUALIFIERS = ('const', 'ARRAY', 'MAP')
+
+node_start = re.compile(r"^\s*typedef\s+struct\s+(NODE_\w+)")
+node_field = re.compile(r"^\s*([\w\s\*]+)\s*\b(\w+);")
+node_map_field = re.compile(r"^\s*struct\s*{\s*(.+)\s*\bkey\s*;\s*(.+)\s*\bvalue\s*;\s*}\s*MAP\s*\b(\w+);")
+node_end = re.compile(r"^\s*}\s*AST_(\w+)\s*;")
+
+enum_start = re.compile(r"^\s*typedef\s+enum\s+(\w+)")
+enum_value = re.compile(r"^\s*(\w+)\s*=\s*((?:0x)?\d+|'.+')\s*,?\s*$")
+enum_end = re.compile(r"^\s*}\s*(\w+)\s*;")
+
+
+def split_type(c_type):
+    parts = tuple(c_type.replace('*', ' * ').split())
+    return parts, tuple(p for p in parts if p not in QUALIFIERS)
+
+
+class Field:
+    def __init__(self, name, c_type, key_type=None):
+        self.name = name
+        self.parts, self.type = split_type(c_type)
+        self.is_map = key_type is not None
+        self.key_type = split_type(key_type)[1] if key_type else None
+        # For arrays and maps, `type` describes a single element/value
+        self.is_array = not self.is_map and self.parts[-1] == 'ARRAY'
+        self.is_node = len(self.type) == 2 and self.type[0].startswith('AST_') and self.type[1] == '*'
+        self.is_string = self.type == ('char', '*')
+        self.is_pointer = self.type[-1] == '*'
+
+    def __repr__(self):
+        kind = 'map' if self.is_map else 'array' if self.is_array else 'scalar'
+        return f'Field({self.name}: {" ".join(self.type)} [{kind}])'
+
+
+class NodeType:
+    def __init__(self, tag):
+        self.tag = tag
+        self.name = None
+        self.fields = []
+
+    @property
+    def struct(self):
+        return 'AST_' + self.name
+
+
+def load(path=ast_nodes_h):
+    """Returns (node_types, enum_types), both keyed by name in declaration order."""
+    node_types = {}
+    enum_types = {}
+    with open(path) as f:
+        fs = iter(f)
+        for line in fs:
+            match_node_start = node_start.match(line)
+            if match_node_start:
+                node = NodeType(match_node_start.group(1))
+                for line in fs:
+                    match_end = node_end.match(line)
+                    if match_end:
+                        node.name = match_end.group(1)
+                        node_types[node.tag] = node
+                        break
+                    match_field = node_field.match(line)
+                    if match_field:
+                        node.fields.append(Field(match_field.group(2), match_field.group(1)))
+                        continue
+                    match_map_field = node_map_field.match(line)
+                    if match_map_field:
+                        node.fields.append(Field(
+                            match_map_field.group(3),
+                            match_map_field.group(2),
+                            key_type=match_map_field.group(1)))
+            match_enum_start = enum_start.match(line)
+            if match_enum_start:
+                prefix = match_enum_start.group(1)
+                enum = {'prefix': prefix, 'values': {}}
+                for line in fs:
+                    match_end = enum_end.match(line)
+                    if match_end:
+                        enum['name'] = match_end.group(1)
+                        enum_types[match_end.group(1)] = enum
+                        break
+                    match_value = enum_value.match(line)
+                    if match_value:
+                        enum['values'][match_value.group(1)] = match_value.group(2)
+    return node_types, enum_types
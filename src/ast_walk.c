@@ -0,0 +1,150 @@
+#include <stdlib.h>
+
+#include "ast_walk.h"
+#include "ast_intern.h"
+#include "rhast.h"
+#include "stb_ds.h"
+
+#include "ast_walk.impl.gen.h"
+
+// Position within one node's children; both walkers are driven by this
+typedef struct {
+	AST_Node** slot;
+	uint16_t field;
+	uint32_t index;  // within the current ARRAY or MAP field
+} WalkFrame;
+
+// Returns the next non-null child slot of the frame's node, or NULL when there are no more
+static AST_Node** next_child(WalkFrame* frame) {
+	AST_Node* node = *frame->slot;
+	if ((unsigned) node->node_type >= NODE_MAX) return NULL;
+	const AST_NodeLayout* layout = &AST_LAYOUT[node->node_type];
+	while (frame->field < layout->n_fields) {
+		const AST_ChildField* field = &layout->fields[frame->field];
+		char* at = (char*) node + field->offset;
+		AST_Node** child = NULL;
+		switch (field->kind) {
+			case AST_CHILD_NODE:
+				if (frame->index++ == 0) child = (AST_Node**) at;
+				break;
+			case AST_CHILD_ARRAY: {
+				AST_Node** items = *(AST_Node***) at;
+				if (frame->index < arrlenu(items)) child = &items[frame->index++];
+			} break;
+			case AST_CHILD_MAP: {
+				ASTMAP_NodeEntry* entries = *(ASTMAP_NodeEntry**) at;
+				if (frame->index < (size_t) shlenu(entries)) child = &entries[frame->index++].value;
+			} break;
+			default: break;
+		}
+		if (!child) {
+			frame->field++;
+			frame->index = 0;
+		}
+		else if (*child) {
+			return child;
+		}
+	}
+	return NULL;
+}
+
+static bool walk(AST_Node** slot, const AST_Visitor* visitor) {
+	WalkAction action = WALK_CONTINUE;
+	if (visitor->pre) {
+		action = visitor->pre(slot, visitor->ctx);
+		if (action == WALK_STOP) return false;
+	}
+	if (action != WALK_SKIP && *slot) {
+		WalkFrame frame = { slot, 0, 0 };
+		for (AST_Node** child; (child = next_child(&frame)); ) {
+			if (!walk(child, visitor)) return false;
+		}
+	}
+	if (visitor->post && *slot) {
+		if (visitor->post(slot, visitor->ctx) == WALK_STOP) return false;
+	}
+	return true;
+}
+
+bool ast_walk(AST_Node** root, const AST_Visitor* visitor) {
+	if (!*root) return true;
+	return walk(root, visitor);
+}
+
+// Runs `pre` for a newly reached node and pushes it if its children should be visited
+static bool enter(WalkFrame ARRAY* stack, AST_Node** slot, const AST_Visitor* visitor) {
+	WalkAction action = WALK_CONTINUE;
+	if (visitor->pre) {
+		action = visitor->pre(slot, visitor->ctx);
+		if (action == WALK_STOP) return false;
+	}
+	if (!*slot) return true;
+	// A skipped node still gets its post visit: push it with its children used up
+	WalkFrame frame = { slot, action == WALK_SKIP? UINT16_MAX : 0, 0 };
+	arrput(*stack, frame);
+	return true;
+}
+
+bool ast_walk_iterative(AST_Node** root, const AST_Visitor* visitor) {
+	if (!*root) return true;
+	WalkFrame ARRAY stack = NULL;
+	arrsetcap(stack, 64);
+	bool ok = enter(&stack, root, visitor);
+	while (ok && arrlen(stack) > 0) {
+		WalkFrame* top = &arrlast(stack);
+		AST_Node** child = next_child(top);
+		if (child) {
+			ok = enter(&stack, child, visitor);
+			continue;
+		}
+		AST_Node** slot = top->slot;
+		arrsetlen(stack, arrlen(stack) - 1);
+		if (visitor->post && *slot) {
+			ok = visitor->post(slot, visitor->ctx) != WALK_STOP;
+		}
+	}
+	arrfree(stack);
+	return ok;
+}
+
+// === Freeing ===
+
+void ast_free_owned_shallow(AST_Node* node) {
+	if ((unsigned) node->node_type >= NODE_MAX) return;
+	const AST_NodeLayout* layout = &AST_LAYOUT[node->node_type];
+	for (int i = 0; i < layout->n_fields; i++) {
+		char* at = (char*) node + layout->fields[i].offset;
+		switch (layout->fields[i].kind) {
+			case AST_CHILD_ARRAY:
+			case AST_CHILD_VALUE_ARRAY:
+				// Arrays and maps in a mapped .rhast file go with the file
+				if (rhast_maps(*(void**) at)) *(void**) at = NULL;
+				else arrfree(*(void**) at);
+				break;
+			case AST_CHILD_MAP:
+				if (rhast_maps(*(void**) at)) *(void**) at = NULL;
+				else shfree(*(ASTMAP_NodeEntry**) at);
+				break;
+			default: break;
+		}
+	}
+}
+
+// Shared nodes belong to their interner, and are left alone along with their children
+static WalkAction skip_shared(AST_Node** slot, void* ctx) {
+	(void) ctx;
+	return ast_is_shared(*slot)? WALK_SKIP : WALK_CONTINUE;
+}
+
+// Runs after the node's children, which still need its arrays to be reached. The fields
+// are cleared, so a node shared by several parents is freed once and then has no children.
+static WalkAction free_owned(AST_Node** slot, void* ctx) {
+	(void) ctx;
+	if (!ast_is_shared(*slot)) ast_free_owned_shallow(*slot);
+	return WALK_CONTINUE;
+}
+
+void ast_free_owned(AST_Node** root) {
+	AST_Visitor visitor = { skip_shared, free_owned, NULL };
+	ast_walk_iterative(root, &visitor);
+}
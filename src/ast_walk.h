@@ -0,0 +1,61 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "ast.h"
+
+// Where a node keeps its references, generated from ast_nodes.h
+
+typedef enum {
+	AST_CHILD_NODE,         // AST_X* field
+	AST_CHILD_ARRAY,        // AST_X* ARRAY field
+	AST_CHILD_MAP,          // string -> AST_X* MAP field (laid out like ASTMAP_NodeEntry)
+	AST_CHILD_VALUE_ARRAY,  // ARRAY of anything else; not visited, but owned by the node
+} AST_ChildKind;
+
+typedef struct {
+	uint16_t offset;
+	uint8_t kind;
+} AST_ChildField;
+
+typedef struct {
+	uint16_t size;      // sizeof the node's struct
+	uint16_t n_fields;
+	const AST_ChildField* fields;  // in declaration order
+} AST_NodeLayout;
+
+extern const AST_NodeLayout AST_LAYOUT[NODE_MAX];
+
+// === Walking ===
+
+typedef enum {
+	WALK_CONTINUE = 0,
+	WALK_SKIP,  // from pre: don't descend into this node's children (post still runs)
+	WALK_STOP,  // abandon the walk
+} WalkAction;
+
+/// Visitor callbacks get the slot the node is stored in, so they can replace it by
+/// assigning to *slot. A replacement made in `pre` is the node whose children get walked.
+/// Null children are not visited. Either callback may be NULL.
+typedef struct {
+	WalkAction (*pre)(AST_Node** slot, void* ctx);
+	WalkAction (*post)(AST_Node** slot, void* ctx);
+	void* ctx;
+} AST_Visitor;
+
+/// Walks the tree rooted at *root in depth-first order, children in declaration order.
+/// Returns false if a callback stopped the walk.
+bool ast_walk(AST_Node** root, const AST_Visitor* visitor);
+
+/// Same as ast_walk, but keeps its own stack on the heap instead of recursing,
+/// for trees deep enough to threaten the C stack.
+bool ast_walk_iterative(AST_Node** root, const AST_Visitor* visitor);
+
+/// Frees the arrays and maps held by every node of the tree. The nodes themselves belong
+/// to the arenas of the parser that created them, and are left in place. Shared nodes
+/// (see ast_intern.h) belong to their interner and are skipped.
+void ast_free_owned(AST_Node** root);
+
+/// Frees the arrays and maps held by the node itself, leaving its children alone
+void ast_free_owned_shallow(AST_Node* node);
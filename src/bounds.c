@@ -0,0 +1,866 @@
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bounds.h"
+#include "escape.h"
+#include "ast_walk.h"
+#include "util.h"
+#include "stb_ds.h"
+
+#define NO_BOUND INT64_MAX
+
+typedef enum {
+	TERM_ZERO,    // the constant 0, which constants are offsets from
+	TERM_VALUE,   // of an integer variable, or a field of one
+	TERM_LENGTH,  // of an array held by a variable, or a field of one
+} TermKind;
+
+typedef struct {
+	TermKind kind;
+	SymbolId root;
+	const char* field;  // of the root, or NULL
+} Term;
+
+/// A term plus a constant
+typedef struct {
+	int term;  // -1 if the expression isn't one
+	int64_t offset;
+} Linear;
+
+/// x - y <= c
+typedef struct {
+	int x, y;
+	int64_t c;
+} Fact;
+
+typedef struct {
+	const char* src_file;
+	int line, start_col, end_col;
+	const char* label;
+	char* message;
+} Diagnostic;
+
+typedef enum {
+	READ_HERE,    // where the walk is
+	READ_PRE,     // the '#pre' conditions of the function whose body is walked
+	READ_CALL,    // the '#pre' conditions of a function, for a call of it where the walk is
+	READ_STRUCT,  // the invariants of a struct, held by a variable
+} ReadMode;
+
+typedef struct {
+	ReadMode mode;
+	const AST_FuncDef* func;    // with '#pre' conditions
+	const LoweredCall* call;
+	SymbolId root;              // holding the struct
+	const AST_Struct* decl;
+} Reading;
+
+struct _bounds {
+	Resolution res;
+	TypeCheck check;
+	TypeTable table;
+	Lowering lower;
+	uint8_t ARRAY unstable;                            // by symbol id
+	struct { const void* key; AST_Node* const* ARRAY value; } MAP pres;  // '#pre' conditions, by function symbol
+	struct { const void* key; bool value; } MAP proven;  // subscripts that are in bounds
+	Diagnostic ARRAY diagnostics;
+	int n_subscripts, n_eliminated, n_loop_checks, n_errors;
+	// Of the function being walked
+	const AST_FuncDef* func;
+	Term ARRAY terms;
+	Fact ARRAY invariants;  // known everywhere in it
+	Fact ARRAY facts;       // known where the walk is
+	int ARRAY marks;        // where the facts of each enclosing block start
+	SymbolId ARRAY with_invariants;  // roots whose struct's invariants were added
+	int loop_depth;
+	Fact ARRAY scratch;
+	int64_t ARRAY dist;
+};
+
+// === Types ===
+
+static TypeId strip(Bounds b, TypeId id) {
+	while (true) {
+		const Type* type = type_get(b->table, id);
+		if (type->kind != TYPE_KIND_MUTABLE && type->kind != TYPE_KIND_OPTIONAL && type->kind != TYPE_KIND_POINTER) return id;
+		id = type->base;
+	}
+}
+
+static bool is_integer(Bounds b, TypeId type) {
+	TypeKind kind = type_get(b->table, strip(b, type))->kind;
+	return kind == TYPE_KIND_SINT || kind == TYPE_KIND_UINT;
+}
+
+static const AST_Struct* struct_of(Bounds b, TypeId type) {
+	const Type* t = type_get(b->table, strip(b, type));
+	return t->kind == TYPE_KIND_STRUCT? (const AST_Struct*) t->decl : NULL;
+}
+
+static const AST_Field* find_field(const AST_Struct* decl, const char* name) {
+	ptrdiff_t i = decl? shgeti(((AST_Struct*) decl)->fields, name) : -1;
+	return i < 0? NULL : decl->fields[i].value;
+}
+
+/// The type of a variable, or of a field of it
+static TypeId reference_type(Bounds b, SymbolId root, const char* field) {
+	TypeId type = typecheck_symbol_type(b->check, root);
+	if (!field) return type;
+	const AST_Field* f = find_field(struct_of(b, type), field);
+	return f? typecheck_type_of(b->check, f->type) : TYPE_UNKNOWN;
+}
+
+/// The extent of a dimension of an array type, or -1 if it isn't known before it runs
+static int64_t static_extent(Bounds b, TypeId type, int dim) {
+	int count;
+	const int64_t* extents = type_extents(b->table, strip(b, type), &count);
+	return dim < count? extents[dim] : -1;
+}
+
+// === Stability ===
+
+/// The variable an assignment to *slot changes, or 0 if it changes an element of an array
+/// (which doesn't change the array's length) or what it changes isn't a variable
+static SymbolId changed_variable(Bounds b, AST_Node* const* slot) {
+	while (true) {
+		AST_Node* node = *slot;
+		switch (node->node_type) {
+			case NODE_REREFERENCE: slot = (AST_Node* const*) &((AST_Reref*) node)->target; break;
+			case NODE_FIELD_ACCESS: slot = (AST_Node* const*) &((AST_FieldAccess*) node)->base; break;
+			case NODE_QUALNAME: return resolution_lookup(b->res, slot).symbol;
+			default: return 0;
+		}
+	}
+}
+
+static inline void unsettle(Bounds b, AST_Node* const* slot) {
+	SymbolId id = changed_variable(b, slot);
+	if (id) b->unstable[id] = true;
+}
+
+static bool is_mutable_reference(Bounds b, TypeId type) {
+	while (true) {
+		const Type* t = type_get(b->table, type);
+		if (t->kind == TYPE_KIND_MUTABLE) return true;
+		if (t->kind != TYPE_KIND_OPTIONAL && t->kind != TYPE_KIND_POINTER && t->kind != TYPE_KIND_ARRAY) return false;
+		type = t->base;
+	}
+}
+
+/// Arguments for parameters that may change what they refer to
+static void unsettle_arguments(Bounds b, const LoweredCall* call) {
+	AST_FuncDef* def = (AST_FuncDef*) resolution_symbol(b->res, call->target)->decl;
+	for (int p = 0; p < call->n_args; p++) {
+		AST_Param* param = def->params[p].value;
+		TypeId type = typecheck_symbol_type(b->check, resolution_lookup(b->res, (AST_Node* const*) &param->name).symbol);
+		if (!is_mutable_reference(b, type)) continue;
+		if (p == call->vararg) {
+			for (int i = 0; i < call->n_varargs; i++) unsettle(b, call->varargs[i]);
+		}
+		else if (call->args[p]) unsettle(b, call->args[p]);
+	}
+}
+
+static WalkAction stability_pre(AST_Node** slot, void* ctx) {
+	Bounds b = ctx;
+	AST_Node* node = *slot;
+	switch (node->node_type) {
+		case NODE_ASSIGN: {
+			AST_AssignChain* chain = (AST_AssignChain*) node;
+			for (int i = 0; i < arrlen(chain->dest_exprs); i++) unsettle(b, &chain->dest_exprs[i]);
+		} break;
+		case NODE_ASSIGN_MANY: {
+			AST_AssignParallel* parallel = (AST_AssignParallel*) node;
+			for (int i = 0; i < arrlen(parallel->dest_exprs); i++) unsettle(b, &parallel->dest_exprs[i]);
+		} break;
+		case NODE_OP_ASSIGN: {
+			unsettle(b, &((AST_OpAssign*) node)->dest_expr);
+			const LoweredCall* call = lowering_call(b->lower, node);
+			if (call) unsettle_arguments(b, call);
+		} break;
+		// What may be written through
+		case NODE_REREFERENCE:
+			unsettle(b, slot);
+			break;
+		case NODE_FUNC_CALL: {
+			AST_FuncCall* call = (AST_FuncCall*) node;
+			const LoweredCall* lowered = lowering_call(b->lower, node);
+			if (lowered) unsettle_arguments(b, lowered);
+			else if (!escape_keeps_nothing(b->res, call)) {
+				for (int i = 0; i < arrlen(call->pos_args); i++) unsettle(b, &call->pos_args[i]);
+				for (int i = 0; i < shlen(call->kw_args); i++) unsettle(b, &call->kw_args[i].value);
+				// 'a.push(x)'
+				if (call->func->node_type == NODE_QUALNAME) unsettle(b, &call->func);
+			}
+		} break;
+		case NODE_BINOP:
+		case NODE_UNARY: {
+			const LoweredCall* call = lowering_call(b->lower, node);
+			if (call) unsettle_arguments(b, call);
+		} break;
+		case NODE_COMPARISON: {
+			AST_ComparisonChain* chain = (AST_ComparisonChain*) node;
+			for (int i = 0; i < arrlen(chain->comparisons); i++) {
+				const LoweredCall* call = lowering_comparison(b->lower, chain, i);
+				if (call) unsettle_arguments(b, call);
+			}
+		} break;
+		// Async code may run alongside anything
+		case NODE_ASYNC:
+			ast_walk_iterative(slot, &(AST_Visitor) { stability_pre, NULL, b });
+			break;
+		default: break;
+	}
+	return WALK_CONTINUE;
+}
+
+// === Terms ===
+
+static void add_fact(Fact ARRAY* facts, int x, int y, int64_t c) {
+	// Always true; a fact that is never true is kept, as where it's known nothing runs
+	if (x == y && c >= 0) return;
+	Fact fact = { x, y, c };
+	arrput(*facts, fact);
+}
+
+static void add_struct_invariants(Bounds b, SymbolId root);
+
+static int term_of(Bounds b, TermKind kind, SymbolId root, const char* field) {
+	for (int i = 0; i < arrlen(b->terms); i++) {
+		const Term* t = &b->terms[i];
+		if (t->kind == kind && t->root == root && (t->field == field || (t->field && field && strcmp(t->field, field) == 0))) return i;
+	}
+	Term term = { kind, root, field };
+	int i = arrlen(b->terms);
+	arrput(b->terms, term);
+	// Lengths and unsigned values can't be below 0
+	if (kind == TERM_LENGTH) add_fact(&b->invariants, 0, i, 0);
+	if (kind == TERM_VALUE && type_get(b->table, strip(b, reference_type(b, root, field)))->kind == TYPE_KIND_UINT) {
+		add_fact(&b->invariants, 0, i, 0);
+	}
+	if (field) add_struct_invariants(b, root);
+	return i;
+}
+
+static inline Linear constant(int64_t value) {
+	return (Linear) { 0, value };
+}
+
+static const Linear NOT_LINEAR = { -1, 0 };
+
+/// The variable, or field of one, that *slot names, read as `r` says; false if it isn't one,
+/// or it may change
+static bool reference_of(Bounds b, const Reading* r, AST_Node* const* slot, SymbolId* root, const char** field) {
+	AST_Node* node = *slot;
+	*field = NULL;
+	if (node->node_type == NODE_FIELD_ACCESS) {
+		AST_FieldAccess* access = (AST_FieldAccess*) node;
+		const char* inner;
+		if (arrlen(access->field->parts) != 1 || !reference_of(b, r, (AST_Node* const*) &access->base, root, &inner) || inner) return false;
+		*field = access->field->parts[0];
+		return true;
+	}
+	if (node->node_type != NODE_QUALNAME) return false;
+	const AST_Qualname* qn = (const AST_Qualname*) node;
+	int n_parts = arrlen(qn->parts);
+	ResolvedName found = resolution_lookup(b->res, slot);
+	if (r && r->mode == READ_STRUCT) {
+		// Fields are named by themselves
+		if (found.symbol || n_parts != 1 || !find_field(r->decl, qn->parts[0])) return false;
+		*root = r->root;
+		*field = qn->parts[0];
+		return true;
+	}
+	if (!found.symbol || n_parts - found.n_parts > 1) return false;
+	if (n_parts > found.n_parts) *field = qn->parts[found.n_parts];
+	const Symbol* symbol = resolution_symbol(b->res, found.symbol);
+	if (r && (r->mode == READ_PRE || r->mode == READ_CALL)) {
+		int p = -1;
+		for (int i = 0; symbol->kind == DECL_PARAM && i < shlen(r->func->params); i++) {
+			if ((AST_Node*) r->func->params[i].value == symbol->decl) p = i;
+		}
+		if (p < 0 && symbol->kind != DECL_CONST) return false;
+		if (p >= 0 && r->mode == READ_CALL) {
+			// The argument, read where the call is
+			AST_Node* const* arg = r->call->args[p];
+			const char* inner;
+			if (!arg || !reference_of(b, NULL, arg, root, &inner) || (inner && *field)) return false;
+			if (inner) *field = inner;
+			return true;
+		}
+	}
+	if (b->unstable[found.symbol]) return false;
+	*root = found.symbol;
+	return true;
+}
+
+/// For a call, the argument a parameter of the function names, which is read where the
+/// call is; NULL for anything else
+static AST_Node* const* argument_of(Bounds b, const Reading* r, AST_Node* const* slot) {
+	if (!r || r->mode != READ_CALL || (*slot)->node_type != NODE_QUALNAME) return NULL;
+	ResolvedName found = resolution_lookup(b->res, slot);
+	if (!found.symbol || found.n_parts != arrlen(((AST_Qualname*) *slot)->parts)) return NULL;
+	const Symbol* symbol = resolution_symbol(b->res, found.symbol);
+	for (int i = 0; symbol->kind == DECL_PARAM && i < shlen(r->func->params); i++) {
+		if ((AST_Node*) r->func->params[i].value == symbol->decl) return r->call->args[i];
+	}
+	return NULL;
+}
+
+static Linear length_of(Bounds b, const Reading* r, AST_Node* const* slot, int dim) {
+	AST_Node* const* arg = argument_of(b, r, slot);
+	if (arg) return length_of(b, NULL, arg, dim);
+	SymbolId root;
+	const char* field;
+	if (reference_of(b, r, slot, &root, &field)) {
+		int64_t extent = static_extent(b, reference_type(b, root, field), dim);
+		if (extent >= 0) return constant(extent);
+		return dim == 0? (Linear) { term_of(b, TERM_LENGTH, root, field), 0 } : NOT_LINEAR;
+	}
+	if (r && r->mode != READ_HERE) return NOT_LINEAR;
+	int64_t extent = static_extent(b, typecheck_expr_type(b->check, slot), dim);
+	return extent >= 0? constant(extent) : NOT_LINEAR;
+}
+
+/// Whether a call is of the builtin 'len'
+static bool is_len(Bounds b, const AST_FuncCall* call) {
+	if (call->func->node_type != NODE_QUALNAME || resolution_lookup(b->res, &call->func).symbol) return false;
+	const AST_Qualname* qn = (const AST_Qualname*) call->func;
+	return arrlen(qn->parts) == 1 && strcmp(qn->parts[0], "len") == 0 && arrlen(call->pos_args) == 1 && !shlen(call->kw_args);
+}
+
+/// An integer expression as a term plus a constant
+static Linear linear(Bounds b, const Reading* r, AST_Node* const* slot) {
+	AST_Node* node = *slot;
+	switch (node->node_type) {
+		case NODE_INT:
+			return constant((int64_t) ((AST_Int*) node)->value);
+		case NODE_QUALNAME:
+		case NODE_FIELD_ACCESS: {
+			AST_Node* const* arg = argument_of(b, r, slot);
+			if (arg) return linear(b, NULL, arg);
+			SymbolId root;
+			const char* field;
+			if (!reference_of(b, r, slot, &root, &field) || !is_integer(b, reference_type(b, root, field))) return NOT_LINEAR;
+			return (Linear) { term_of(b, TERM_VALUE, root, field), 0 };
+		}
+		case NODE_FUNC_CALL: {
+			AST_FuncCall* call = (AST_FuncCall*) node;
+			return is_len(b, call)? length_of(b, r, &call->pos_args[0], 0) : NOT_LINEAR;
+		}
+		case NODE_UNARY: {
+			AST_Unary* unary = (AST_Unary*) node;
+			if (strcmp(unary->op, "-") != 0 || lowering_call(b->lower, node)) return NOT_LINEAR;
+			Linear value = linear(b, r, &unary->expr);
+			return value.term == 0? constant(-value.offset) : NOT_LINEAR;
+		}
+		case NODE_BINOP: {
+			AST_Binop* binop = (AST_Binop*) node;
+			bool plus = strcmp(binop->op, "+") == 0;
+			if ((!plus && strcmp(binop->op, "-") != 0) || lowering_call(b->lower, node)) return NOT_LINEAR;
+			Linear lhs = linear(b, r, &binop->lhs);
+			Linear rhs = linear(b, r, &binop->rhs);
+			if (lhs.term < 0 || rhs.term < 0) return NOT_LINEAR;
+			if (rhs.term == 0) return (Linear) { lhs.term, plus? lhs.offset + rhs.offset : lhs.offset - rhs.offset };
+			if (lhs.term == 0 && plus) return (Linear) { rhs.term, lhs.offset + rhs.offset };
+			return NOT_LINEAR;
+		}
+		default:
+			return NOT_LINEAR;
+	}
+}
+
+// === Conditions ===
+
+/// a - b <= c
+static void add_difference(Fact ARRAY* facts, Linear a, Linear b, int64_t c) {
+	add_fact(facts, a.term, b.term, c - a.offset + b.offset);
+}
+
+/// Adds what a comparison says, or its opposite; false if it says nothing that can be kept
+static bool read_comparison(Bounds b, const Reading* r, AST_Node* const* lhs, const char* op, AST_Node* const* rhs,
+		bool negate, Fact ARRAY* out) {
+	static const struct { const char* op; const char* opposite; } ops[] = {
+		{ "<", ">=" }, { "<=", ">" }, { ">", "<=" }, { ">=", "<" }, { "==", "!=" }, { "!=", "==" },
+	};
+	for (size_t i = 0; negate && i < sizeof(ops) / sizeof(*ops); i++) {
+		if (strcmp(op, ops[i].op) == 0) {
+			op = ops[i].opposite;
+			break;
+		}
+	}
+	if (strcmp(op, "!=") == 0) return false;
+	Linear a = linear(b, r, lhs);
+	Linear c = linear(b, r, rhs);
+	if (a.term < 0 || c.term < 0) return false;
+	if (strcmp(op, "<") == 0) add_difference(out, a, c, -1);
+	else if (strcmp(op, "<=") == 0) add_difference(out, a, c, 0);
+	else if (strcmp(op, ">") == 0) add_difference(out, c, a, -1);
+	else if (strcmp(op, ">=") == 0) add_difference(out, c, a, 0);
+	else if (strcmp(op, "==") == 0) {
+		add_difference(out, a, c, 0);
+		add_difference(out, c, a, 0);
+	}
+	else return false;
+	return true;
+}
+
+/// Adds what a condition says, or its opposite. Parts of it that can't be read are left out,
+/// unless `strict`; then reading fails, and nothing is added.
+static bool read_condition(Bounds b, const Reading* r, AST_Node* const* slot, bool negate, bool strict, Fact ARRAY* out) {
+	AST_Node* node = *slot;
+	int n_before = arrlen(*out);
+	bool ok = false;
+	switch (node->node_type) {
+		case NODE_AND:
+		case NODE_OR: {
+			AST_Node* const* lhs = node->node_type == NODE_AND? (AST_Node* const*) &((AST_And*) node)->lhs : (AST_Node* const*) &((AST_Or*) node)->lhs;
+			AST_Node* const* rhs = node->node_type == NODE_AND? (AST_Node* const*) &((AST_And*) node)->rhs : (AST_Node* const*) &((AST_Or*) node)->rhs;
+			// Only 'a and b', and 'not (a or b)', say both
+			if ((node->node_type == NODE_AND) == negate) break;
+			ok = read_condition(b, r, lhs, negate, strict, out);
+			ok = (read_condition(b, r, rhs, negate, strict, out) && ok) || (!strict && ok);
+			if (!strict) ok = arrlen(*out) > n_before;
+		} break;
+		case NODE_NOT:
+			ok = read_condition(b, r, &((AST_Not*) node)->expr, !negate, strict, out);
+			break;
+		case NODE_COMPARISON: {
+			AST_ComparisonChain* chain = (AST_ComparisonChain*) node;
+			int n = arrlen(chain->comparisons);
+			if (negate && n > 1) break;
+			ok = true;
+			for (int i = 0; i < n; i++) {
+				bool read = !typecheck_comparison_target(b->check, chain, i)
+					&& read_comparison(b, r, &chain->operands[i], chain->comparisons[i], &chain->operands[i + 1], negate, out);
+				ok &= read;
+			}
+			if (!strict) ok = arrlen(*out) > n_before;
+		} break;
+		default: break;
+	}
+	if (!ok && strict) arrsetlen(*out, n_before);
+	return ok;
+}
+
+static void add_struct_invariants(Bounds b, SymbolId root) {
+	for (int i = 0; i < arrlen(b->with_invariants); i++) {
+		if (b->with_invariants[i] == root) return;
+	}
+	arrput(b->with_invariants, root);
+	const AST_Struct* decl = struct_of(b, typecheck_symbol_type(b->check, root));
+	if (!decl) return;
+	Reading r = { .mode = READ_STRUCT, .root = root, .decl = decl };
+	for (int i = 0; i < arrlen(decl->constraints); i++) read_condition(b, &r, &decl->constraints[i], false, false, &b->invariants);
+	for (int i = 0; i < shlen(decl->fields); i++) {
+		AST_Field* field = decl->fields[i].value;
+		if (field->invariant) read_condition(b, &r, &field->invariant, false, false, &b->invariants);
+	}
+}
+
+// === Proofs ===
+
+static void relax(Bounds b, const Fact* facts, int n, bool* changed) {
+	for (int i = 0; i < n; i++) {
+		const Fact* f = &facts[i];
+		if (b->dist[f->y] == NO_BOUND) continue;
+		int64_t d = b->dist[f->y] + f->c;
+		if (d < b->dist[f->x]) {
+			b->dist[f->x] = d;
+			*changed = true;
+		}
+	}
+}
+
+/// Whether x - y <= c follows from what is known: the shortest path from y to x along the
+/// facts, each an edge from its y to its x, is at most c. Every path is a sum of facts, so
+/// what is found after any number of rounds holds.
+static bool prove(Bounds b, int x, int y, int64_t c) {
+	if (x == y) return c >= 0;
+	int n_terms = arrlen(b->terms);
+	arrsetlen(b->dist, n_terms);
+	for (int i = 0; i < n_terms; i++) b->dist[i] = NO_BOUND;
+	b->dist[y] = 0;
+	bool changed = true;
+	for (int round = 0; round < n_terms && changed; round++) {
+		changed = false;
+		relax(b, b->invariants, arrlen(b->invariants), &changed);
+		relax(b, b->facts, arrlen(b->facts), &changed);
+	}
+	return b->dist[x] != NO_BOUND && b->dist[x] <= c;
+}
+
+/// a - b <= c
+static inline bool prove_difference(Bounds b, Linear a, Linear d, int64_t c) {
+	return prove(b, a.term, d.term, c - a.offset + d.offset);
+}
+
+// === Diagnostics ===
+
+static void diagnose(Bounds b, const AST_Node* at, const char* label, const char* fmt, ...) {
+	va_list args;
+	va_start(args, fmt);
+	int length = vsnprintf(NULL, 0, fmt, args);
+	va_end(args);
+	char* message = malloc(length + 1);
+	va_start(args, fmt);
+	vsnprintf(message, length + 1, fmt, args);
+	va_end(args);
+	Diagnostic diagnostic = { at->src_file, at->start_line, at->start_col, at->end_line > at->start_line? -1 : (int) at->end_col, label, message };
+	arrput(b->diagnostics, diagnostic);
+}
+
+static int compare_diagnostics(const void* a, const void* b) {
+	const Diagnostic* x = a;
+	const Diagnostic* y = b;
+	if (x->line != y->line) return x->line < y->line? -1 : 1;
+	return (x->start_col > y->start_col) - (x->start_col < y->start_col);
+}
+
+static void report_diagnostics(Diagnostic* diagnostics, int n) {
+	if (!n) return;
+	qsort(diagnostics, n, sizeof(Diagnostic), compare_diagnostics);
+	char* source = (char*) read_entire_file(diagnostics[0].src_file);
+	const char* ARRAY lines = NULL;
+	for (char* p = source; p && *p; p++) {
+		if (p == source) arrput(lines, p);
+		if (*p != '\n') continue;
+		*p = 0;
+		arrput(lines, p + 1);
+	}
+	for (int i = 0; i < n; i++) {
+		const Diagnostic* d = &diagnostics[i];
+		fprintf(stderr, "In '%s' at line %d, column %d...\n  %s: %s\n", d->src_file, d->line, d->start_col, d->label, d->message);
+		if (d->line >= 1 && d->line <= arrlen(lines)) {
+			const char* line = lines[d->line - 1];
+			show_error_line(stderr, line, d->line, d->start_col, d->end_col < 0? (int) strlen(line) : d->end_col);
+		}
+	}
+	free(source);
+	arrfree(lines);
+}
+
+// === Subscripts ===
+
+/// Why an index of a subscript may be out of bounds, or NULL if it can't be
+static const char* check_index(Bounds b, AST_Subscript* subscript, int dim) {
+	AST_Node* const* slot = (AST_Node* const*) &subscript->subscripts[dim];
+	Linear length = length_of(b, NULL, (AST_Node* const*) &subscript->array, dim);
+	if (length.term < 0) return "its length may change";
+	if ((*slot)->node_type == NODE_SLICE) {
+		AST_Slice* slice = (AST_Slice*) *slot;
+		Linear start = slice->start? linear(b, NULL, &slice->start) : constant(0);
+		Linear end = slice->end? linear(b, NULL, &slice->end) : length;
+		if (start.term < 0 || end.term < 0) return "the slice's bounds may change";
+		// From 'start' to before 'end'
+		if (slice->end && slice->is_inclusive) end.offset++;
+		if (!prove_difference(b, constant(0), start, 0)) return "the slice may start before the array";
+		if (!prove_difference(b, end, length, 0)) return "the slice may end after the array";
+		if (!prove_difference(b, start, end, 0)) return "the slice may end before it starts";
+		return NULL;
+	}
+	Linear index = linear(b, NULL, slot);
+	if (index.term < 0) return "the index isn't a variable plus a constant that doesn't change";
+	if (!prove_difference(b, constant(0), index, 0)) return "the index may be negative";
+	if (!prove_difference(b, index, length, -1)) return "the index may be past the end";
+	return NULL;
+}
+
+static void check_subscript(Bounds b, AST_Subscript* subscript) {
+	TypeId type = strip(b, typecheck_expr_type(b->check, (AST_Node* const*) &subscript->array));
+	if (type_get(b->table, type)->kind != TYPE_KIND_ARRAY) return;
+	b->n_subscripts++;
+	const char* why = NULL;
+	for (int i = 0; i < arrlen(subscript->subscripts) && !why; i++) why = check_index(b, subscript, i);
+	if (!why) {
+		hmput(b->proven, subscript, true);
+		b->n_eliminated++;
+		return;
+	}
+	if (!b->loop_depth) return;
+	b->n_loop_checks++;
+	AST_Node* array = subscript->array;
+	const char* name = array->node_type == NODE_QUALNAME? arrlast(((AST_Qualname*) array)->parts) : "the array";
+	diagnose(b, (AST_Node*) subscript, "Bounds check", "The index of '%s' is checked on every iteration of this loop, as %s", name, why);
+}
+
+/// Checks that a call meets the '#pre' conditions of the function it calls
+static void check_call(Bounds b, const AST_Node* at, const LoweredCall* call) {
+	ptrdiff_t i = hmgeti(b->pres, (void*) (intptr_t) call->target);
+	if (i < 0) return;
+	const AST_FuncDef* func = (const AST_FuncDef*) resolution_symbol(b->res, call->target)->decl;
+	Reading r = { .mode = READ_CALL, .func = func, .call = call };
+	AST_Node* const* ARRAY conditions = b->pres[i].value;
+	for (int c = 0; c < arrlen(conditions); c++) {
+		if (b->scratch) stbds_header(b->scratch)->length = 0;
+		bool holds = read_condition(b, &r, conditions[c], false, true, &b->scratch);
+		for (int f = 0; holds && f < arrlen(b->scratch); f++) holds = prove(b, b->scratch[f].x, b->scratch[f].y, b->scratch[f].c);
+		if (holds) continue;
+		b->n_errors++;
+		diagnose(b, at, "Precondition error", "This call of '%s' may not meet its '#pre' condition at line %d",
+			resolution_symbol(b->res, call->target)->name, (*conditions[c])->start_line);
+		return;
+	}
+}
+
+// === Walk ===
+
+static WalkAction bounds_pre(AST_Node** slot, void* ctx);
+static WalkAction bounds_post(AST_Node** slot, void* ctx);
+
+static void walk(Bounds b, AST_Node** slot) {
+	if (*slot) ast_walk_iterative(slot, &(AST_Visitor) { bounds_pre, bounds_post, b });
+}
+
+static inline void open_block(Bounds b) {
+	arrput(b->marks, arrlen(b->facts));
+}
+
+static inline void close_block(Bounds b) {
+	int mark = arrpop(b->marks);
+	arrsetlen(b->facts, mark);
+}
+
+/// What the range of a for loop says of its variable
+static void add_range(Bounds b, AST_ForRange* range) {
+	if (!range->name) return;
+	SymbolId id = resolution_lookup(b->res, (AST_Node* const*) &range->name).symbol;
+	if (!id || b->unstable[id] || !is_integer(b, typecheck_symbol_type(b->check, id))) return;
+	// Going down from 'start' to 'end' for a negative step
+	bool down = false;
+	if (range->step) {
+		Linear step = linear(b, NULL, &range->step);
+		if (step.term != 0 || !step.offset) return;
+		down = step.offset < 0;
+	}
+	Linear var = { term_of(b, TERM_VALUE, id, NULL), 0 };
+	Linear start = linear(b, NULL, &range->start);
+	Linear end = range->end? linear(b, NULL, &range->end) : NOT_LINEAR;
+	Linear low = down? end : start;
+	Linear high = down? start : end;
+	if (down && !range->is_inclusive) low.offset++;
+	if (!down && !range->is_inclusive) high.offset--;
+	if (low.term >= 0) add_difference(&b->facts, low, var, 0);
+	if (high.term >= 0) add_difference(&b->facts, var, high, 0);
+}
+
+static bool exits_block(const AST_Block* block) {
+	if (!block || !arrlen(block->body)) return false;
+	switch (arrlast(block->body)->node_type) {
+		case NODE_RETURN:
+		case NODE_FAIL:
+		case NODE_BREAK:
+		case NODE_SKIP:
+			return true;
+		default:
+			return false;
+	}
+}
+
+static WalkAction bounds_pre(AST_Node** slot, void* ctx) {
+	Bounds b = ctx;
+	AST_Node* node = *slot;
+	switch (node->node_type) {
+		// Run at compile time, or analyzed by themselves
+		case NODE_RUN:
+		case NODE_FUNC_DEF:
+			return WALK_SKIP;
+		case NODE_BLOCK:
+			open_block(b);
+			break;
+		case NODE_CONTRACT: {
+			AST_Contract* contract = (AST_Contract*) node;
+			if (contract->kind == CONTRACT_ASSUME) read_condition(b, NULL, &contract->condition, false, true, &b->facts);
+		} return WALK_SKIP;
+		case NODE_IF_STMT: {
+			AST_IfStatement* cond = (AST_IfStatement*) node;
+			walk(b, &cond->condition);
+			open_block(b);
+			read_condition(b, NULL, &cond->condition, false, false, &b->facts);
+			walk(b, (AST_Node**) &cond->body);
+			close_block(b);
+			if (cond->alternative) {
+				open_block(b);
+				read_condition(b, NULL, &cond->condition, true, false, &b->facts);
+				walk(b, &cond->alternative);
+				close_block(b);
+			}
+			// 'if i >= len(a) { return }' guards what comes after it
+			else if (exits_block(cond->body)) read_condition(b, NULL, &cond->condition, true, false, &b->facts);
+		} return WALK_SKIP;
+		case NODE_WHILE_LOOP: {
+			AST_WhileLoop* loop = (AST_WhileLoop*) node;
+			walk(b, &loop->condition);
+			open_block(b);
+			read_condition(b, NULL, &loop->condition, false, false, &b->facts);
+			b->loop_depth++;
+			walk(b, (AST_Node**) &loop->body);
+			b->loop_depth--;
+			close_block(b);
+		} return WALK_SKIP;
+		case NODE_FOR_LOOP: {
+			AST_ForLoop* loop = (AST_ForLoop*) node;
+			for (int i = 0; i < arrlen(loop->iterables); i++) walk(b, &loop->iterables[i]);
+			open_block(b);
+			for (int i = 0; i < arrlen(loop->iterables); i++) {
+				if (loop->iterables[i]->node_type == NODE_FOR_RANGE) add_range(b, (AST_ForRange*) loop->iterables[i]);
+			}
+			b->loop_depth++;
+			walk(b, (AST_Node**) &loop->body);
+			b->loop_depth--;
+			close_block(b);
+		} return WALK_SKIP;
+		case NODE_SUBSCRIPT:
+			check_subscript(b, (AST_Subscript*) node);
+			break;
+		case NODE_FUNC_CALL:
+		case NODE_BINOP:
+		case NODE_UNARY:
+		case NODE_OP_ASSIGN: {
+			const LoweredCall* call = lowering_call(b->lower, node);
+			if (call) check_call(b, node, call);
+		} break;
+		case NODE_COMPARISON: {
+			AST_ComparisonChain* chain = (AST_ComparisonChain*) node;
+			for (int i = 0; i < arrlen(chain->comparisons); i++) {
+				const LoweredCall* call = lowering_comparison(b->lower, chain, i);
+				if (call) check_call(b, node, call);
+			}
+		} break;
+		default: break;
+	}
+	return WALK_CONTINUE;
+}
+
+static WalkAction bounds_post(AST_Node** slot, void* ctx) {
+	Bounds b = ctx;
+	AST_Node* node = *slot;
+	switch (node->node_type) {
+		case NODE_BLOCK:
+			close_block(b);
+			break;
+		// What a variable that doesn't change starts out as, it stays
+		case NODE_VAR_DECL: {
+			AST_VarDecl* decl = (AST_VarDecl*) node;
+			SymbolId id = resolution_lookup(b->res, (AST_Node* const*) &decl->name).symbol;
+			if (!id || !decl->value || b->unstable[id] || !is_integer(b, typecheck_symbol_type(b->check, id))) break;
+			Linear value = linear(b, NULL, &decl->value);
+			if (value.term < 0) break;
+			Linear var = { term_of(b, TERM_VALUE, id, NULL), 0 };
+			add_difference(&b->facts, var, value, 0);
+			add_difference(&b->facts, value, var, 0);
+		} break;
+		default: break;
+	}
+	return WALK_CONTINUE;
+}
+
+static WalkAction pres_pre(AST_Node** slot, void* ctx) {
+	AST_Node* const* ARRAY* conditions = ctx;
+	AST_Node* node = *slot;
+	if (node->node_type == NODE_FUNC_DEF || node->node_type == NODE_RUN) return WALK_SKIP;
+	if (node->node_type != NODE_CONTRACT) return WALK_CONTINUE;
+	if (((AST_Contract*) node)->kind == CONTRACT_PRE) arrput(*conditions, &((AST_Contract*) node)->condition);
+	return WALK_SKIP;
+}
+
+/// Starts on the body of a function, or on another item of the module
+static void reset(Bounds b, const AST_FuncDef* func) {
+	b->func = func;
+	if (b->terms) stbds_header(b->terms)->length = 0;
+	Term zero = { TERM_ZERO, 0, NULL };
+	arrput(b->terms, zero);
+	if (b->invariants) stbds_header(b->invariants)->length = 0;
+	if (b->facts) stbds_header(b->facts)->length = 0;
+	if (b->marks) stbds_header(b->marks)->length = 0;
+	if (b->with_invariants) stbds_header(b->with_invariants)->length = 0;
+	b->loop_depth = 0;
+}
+
+static void analyze_function(Bounds b, AST_FuncDef* def, SymbolId id) {
+	reset(b, def);
+	ptrdiff_t i = hmgeti(b->pres, (void*) (intptr_t) id);
+	Reading r = { .mode = READ_PRE, .func = def };
+	for (int c = 0; i >= 0 && c < arrlen(b->pres[i].value); c++) read_condition(b, &r, b->pres[i].value[c], false, true, &b->invariants);
+	walk(b, (AST_Node**) &def->body);
+}
+
+// === Analysis ===
+
+Bounds bounds_analyze(AST_Module* module, Resolution res, TypeCheck check, TypeTable table, Lowering lower) {
+	Bounds b = calloc(1, sizeof(struct _bounds));
+	b->res = res;
+	b->check = check;
+	b->table = table;
+	b->lower = lower;
+	int n_symbols = resolution_symbol_count(res) + 1;
+	arrsetlen(b->unstable, n_symbols);
+	memset(b->unstable, 0, n_symbols);
+	AST_Node* root = (AST_Node*) module;
+	ast_walk_iterative(&root, &(AST_Visitor) { stability_pre, NULL, b });
+	for (int i = 0; i < shlen(module->scope); i++) {
+		AST_Node* item = module->scope[i].value;
+		if (item->node_type != NODE_FUNC_DEF || !((AST_FuncDef*) item)->body) continue;
+		AST_FuncDef* def = (AST_FuncDef*) item;
+		SymbolId id = resolution_lookup(res, (AST_Node* const*) &def->name).symbol;
+		AST_Node* const* ARRAY conditions = NULL;
+		ast_walk_iterative((AST_Node**) &def->body, &(AST_Visitor) { pres_pre, NULL, &conditions });
+		if (id && conditions) hmput(b->pres, (void*) (intptr_t) id, conditions);
+		else arrfree(conditions);
+	}
+
+	for (int i = 0; i < shlen(module->scope); i++) {
+		AST_Node** item = &module->scope[i].value;
+		if ((*item)->node_type == NODE_FUNC_DEF) {
+			AST_FuncDef* def = (AST_FuncDef*) *item;
+			SymbolId id = resolution_lookup(res, (AST_Node* const*) &def->name).symbol;
+			if (id && def->body) analyze_function(b, def, id);
+			continue;
+		}
+		reset(b, NULL);
+		walk(b, item);
+	}
+	report_diagnostics(b->diagnostics, arrlen(b->diagnostics));
+	return b;
+}
+
+void bounds_destroy(Bounds b) {
+	if (!b) return;
+	for (int i = 0; i < hmlen(b->pres); i++) arrfree(b->pres[i].value);
+	hmfree(b->pres);
+	hmfree(b->proven);
+	for (int i = 0; i < arrlen(b->diagnostics); i++) free(b->diagnostics[i].message);
+	arrfree(b->diagnostics);
+	arrfree(b->unstable);
+	arrfree(b->terms);
+	arrfree(b->invariants);
+	arrfree(b->facts);
+	arrfree(b->marks);
+	arrfree(b->with_invariants);
+	arrfree(b->scratch);
+	arrfree(b->dist);
+	free(b);
+}
+
+bool bounds_is_checked(Bounds b, const AST_Node* subscript) {
+	return hmgeti(b->proven, subscript) < 0;
+}
+
+int bounds_subscript_count(Bounds b) {
+	return b->n_subscripts;
+}
+
+int bounds_eliminated_count(Bounds b) {
+	return b->n_eliminated;
+}
+
+int bounds_loop_check_count(Bounds b) {
+	return b->n_loop_checks;
+}
+
+int bounds_error_count(Bounds b) {
+	return b->n_errors;
+}
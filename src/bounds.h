@@ -0,0 +1,38 @@
+#pragma once
+// Bounds-check elimination: array subscripts that are proven to be in bounds, from the ranges
+// of for loops, the conditions of ifs and whiles, '#pre' and '#assume' conditions, and the
+// '#constraint's and '#invariant's of structs, don't need checking when the program runs
+#include <stdbool.h>
+
+#include "ast.h"
+#include "resolve.h"
+#include "typecheck.h"
+#include "types.h"
+#include "lower.h"
+
+typedef struct _bounds* Bounds;
+
+/// Analyzes the subscripts of arrays in a module that type-checked without errors, with its
+/// calls lowered. What is known is kept as bounds on differences of integer variables,
+/// fields of struct variables, and lengths of arrays held by either, which mustn't change:
+/// they are never assigned (but for elements of arrays), nor passed or rereferenced where
+/// they could be. Conditions are read where they are comparisons of such terms plus or minus
+/// constants, joined by 'and'.
+/// The '#pre' conditions of a function are known from the start of its body, and each call
+/// of it must show they hold for its arguments; calls where that can't be shown are errors.
+/// Those, and the checks that stay inside loops, are reported to stderr in the order of the
+/// source. The handle keeps nodes of the tree, so the module must outlive it.
+Bounds bounds_analyze(AST_Module* module, Resolution res, TypeCheck check, TypeTable table, Lowering lower);
+void bounds_destroy(Bounds bounds);
+
+/// Whether an AST_Subscript of an array has to check its indices when it runs: true unless
+/// they were all proven to be in bounds, and for anything that isn't a subscript of an array
+bool bounds_is_checked(Bounds bounds, const AST_Node* subscript);
+
+/// Subscripts of arrays, and how many of those were proven in bounds
+int bounds_subscript_count(Bounds bounds);
+int bounds_eliminated_count(Bounds bounds);
+/// Subscripts left checked inside a for or while loop
+int bounds_loop_check_count(Bounds bounds);
+/// Calls that couldn't be shown to meet a '#pre' condition of the function they call
+int bounds_error_count(Bounds bounds);
@@ -0,0 +1,2320 @@
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bytecode.h"
+#include "ast_walk.h"
+#include "util.h"
+#include "stb_ds.h"
+
+// Registers and immediate operands are 16 bits
+#define BYTECODE_MAX_REGISTERS 65536
+#define BYTECODE_MAX_IMMEDIATE 65535
+
+struct _program {
+	char* src_file;
+	Function ARRAY functions;
+	Slot ARRAY globals;
+	StringValue* ARRAY strings;
+	int ARRAY tests;
+	char* ARRAY test_names;
+	int main;
+};
+
+// === Compiler ===
+
+typedef struct {
+	const char* src_file;
+	int line, start_col, end_col;
+	char* message;
+} Diagnostic;
+
+typedef struct {
+	const char* label;  // or NULL
+	int ARRAY breaks;   // JMPs to past the end of the loop
+	int ARRAY skips;    // and to where it goes on to its next iteration
+} Loop;
+
+/// Where a value is kept: in a register of its own, or at a number of slots past the
+/// pointer in a register (and past the slots in another register, if `index` isn't -1)
+typedef struct {
+	TypeId type;
+	bool in_register;
+	int reg;
+	int index;
+	int64_t offset;
+} Place;
+
+typedef struct {
+	AST_Module* module;
+	Resolution res;
+	TypeCheck check;
+	TypeTable table;
+	Lowering lower;
+	EscapeAnalysis esc;
+	Bounds bounds;
+	Program program;
+	int* functions;         // by symbol: the function's index in the program + 1, once it is needed
+	int64_t* globals;       // by symbol: where a constant array is in the globals + 1
+	SymbolId ARRAY queue;   // functions to compile, with their index in the program
+	int ARRAY queued;
+	struct { TypeId key; int64_t value; } MAP sizes;  // slots, by type
+	Diagnostic ARRAY errors;
+	// Of the function being compiled
+	int func;                // its index in the program
+	TypeId ret_type;
+	int* regs;               // by symbol: the register of a local, parameter or loop variable
+	uint8_t ARRAY boxed;     // by symbol: a scalar whose address is taken, so kept in memory
+	uint8_t ARRAY rebound;   // by symbol: assigned as a whole
+	int top;                 // registers in use
+	int memory;              // slots of memory in use
+	int line;
+	Loop ARRAY loops;
+} Compiler;
+
+static void unsupported(Compiler* c, const AST_Node* at, const char* fmt, ...) {
+	va_list args;
+	va_start(args, fmt);
+	int length = vsnprintf(NULL, 0, fmt, args);
+	va_end(args);
+	char* message = malloc(length + 1);
+	va_start(args, fmt);
+	vsnprintf(message, length + 1, fmt, args);
+	va_end(args);
+	Diagnostic diagnostic = { at->src_file, at->start_line, at->start_col, at->end_line > at->start_line? -1 : (int) at->end_col, message };
+	arrput(c->errors, diagnostic);
+}
+
+static int compare_diagnostics(const void* a, const void* b) {
+	const Diagnostic* x = a;
+	const Diagnostic* y = b;
+	if (x->line != y->line) return x->line < y->line? -1 : 1;
+	return (x->start_col > y->start_col) - (x->start_col < y->start_col);
+}
+
+static void report_errors(Diagnostic* errors, int n) {
+	if (!n) return;
+	qsort(errors, n, sizeof(Diagnostic), compare_diagnostics);
+	char* source = (char*) read_entire_file(errors[0].src_file);
+	const char* ARRAY lines = NULL;
+	for (char* p = source; p && *p; p++) {
+		if (p == source) arrput(lines, p);
+		if (*p != '\n') continue;
+		*p = 0;
+		arrput(lines, p + 1);
+	}
+	for (int i = 0; i < n; i++) {
+		const Diagnostic* d = &errors[i];
+		fprintf(stderr, "In '%s' at line %d, column %d...\n  Bytecode error: %s\n", d->src_file, d->line, d->start_col, d->message);
+		if (d->line >= 1 && d->line <= arrlen(lines)) {
+			const char* line = lines[d->line - 1];
+			show_error_line(stderr, line, d->line, d->start_col, d->end_col < 0? (int) strlen(line) : d->end_col);
+		}
+	}
+	free(source);
+	arrfree(lines);
+}
+
+static inline Function* current(Compiler* c) {
+	return &c->program->functions[c->func];
+}
+
+static inline SymbolId declared(Compiler* c, AST_Name* const* name) {
+	return *name? resolution_lookup(c->res, (AST_Node* const*) name).symbol : 0;
+}
+
+// === Instructions ===
+
+static int emit(Compiler* c, Opcode op, int a, int b, int imm) {
+	Function* f = current(c);
+	Instr instr = { .op = (uint16_t) op, .a = (uint16_t) a, .b = (uint16_t) b, .c = (uint16_t) imm };
+	arrput(f->code, instr);
+	arrput(f->lines, c->line);
+	return (int) arrlen(f->code) - 1;
+}
+
+static int emit_x(Compiler* c, Opcode op, int a, int64_t x) {
+	Function* f = current(c);
+	Instr instr = { .op = (uint16_t) op, .a = (uint16_t) a, .sx = (int32_t) x };
+	arrput(f->code, instr);
+	arrput(f->lines, c->line);
+	return (int) arrlen(f->code) - 1;
+}
+
+static inline int here(Compiler* c) {
+	return (int) arrlen(current(c)->code);
+}
+
+/// Points the jump at `at` to `target`
+static void patch(Compiler* c, int at, int target) {
+	current(c)->code[at].sx = target - (at + 1);
+}
+
+static void patch_all(Compiler* c, int* jumps, int target) {
+	for (int i = 0; i < arrlen(jumps); i++) patch(c, jumps[i], target);
+}
+
+static int new_register(Compiler* c) {
+	Function* f = current(c);
+	if (c->top == BYTECODE_MAX_REGISTERS - 1) {
+		// Reported once; what follows reuses the last register, as the program isn't kept
+		if (f->n_registers < BYTECODE_MAX_REGISTERS) unsupported(c, (AST_Node*) c->module, "'%s' needs more than %d registers", f->name, BYTECODE_MAX_REGISTERS);
+		f->n_registers = BYTECODE_MAX_REGISTERS;
+		return c->top - 1;
+	}
+	int reg = c->top++;
+	if (c->top > f->n_registers) f->n_registers = c->top;
+	return reg;
+}
+
+/// Slots of the frame's memory
+static int64_t new_memory(Compiler* c, int64_t n) {
+	Function* f = current(c);
+	int64_t at = c->memory;
+	c->memory += n;
+	if (c->memory > f->n_memory) f->n_memory = (int) c->memory;
+	return at;
+}
+
+static int constant(Compiler* c, Slot value) {
+	Function* f = current(c);
+	for (int i = 0; i < arrlen(f->constants); i++) {
+		if (f->constants[i].u == value.u) return i;
+	}
+	arrput(f->constants, value);
+	return (int) arrlen(f->constants) - 1;
+}
+
+static void load_int(Compiler* c, int reg, int64_t value) {
+	if (value >= INT32_MIN && value <= INT32_MAX) emit_x(c, OP_LOADI, reg, value);
+	else emit_x(c, OP_LOADK, reg, constant(c, (Slot) { .i = value }));
+}
+
+static void load_float(Compiler* c, int reg, double value) {
+	emit_x(c, OP_LOADK, reg, constant(c, (Slot) { .f = value }));
+}
+
+static const StringValue* intern_string(Compiler* c, const char* text) {
+	Program program = c->program;
+	for (int i = 0; i < arrlen(program->strings); i++) {
+		if ((size_t) program->strings[i]->len == strlen(text) && memcmp(program->strings[i]->data, text, strlen(text)) == 0) return program->strings[i];
+	}
+	StringValue* value = malloc(sizeof(StringValue));
+	size_t length = strlen(text);
+	char* data = malloc(length + 1);
+	memcpy(data, text, length + 1);
+	*value = (StringValue) { data, (int64_t) length };
+	arrput(program->strings, value);
+	return value;
+}
+
+/// A register pointing `offset` slots past what `reg` points to
+static int offset_pointer(Compiler* c, int reg, int64_t offset) {
+	if (!offset) return reg;
+	int to = new_register(c);
+	if (offset <= BYTECODE_MAX_IMMEDIATE) emit(c, OP_LEA, to, reg, (int) offset);
+	else {
+		load_int(c, to, offset);
+		emit(c, OP_ADDR, to, reg, to);
+	}
+	return to;
+}
+
+static void copy_slots(Compiler* c, int to, int from, int64_t n) {
+	if (n <= 0) return;
+	if (n <= BYTECODE_MAX_IMMEDIATE) {
+		emit(c, OP_COPY, to, from, (int) n);
+		return;
+	}
+	int count = new_register(c);
+	load_int(c, count, n);
+	emit(c, OP_COPYN, to, from, count);
+}
+
+static void zero_slots(Compiler* c, int to, int64_t n) {
+	if (n <= 0) return;
+	if (n <= BYTECODE_MAX_IMMEDIATE) {
+		emit(c, OP_ZERO, to, (int) n, 0);
+		return;
+	}
+	int count = new_register(c);
+	load_int(c, count, n);
+	emit(c, OP_ZERON, to, count, 0);
+}
+
+// === Types ===
+
+static inline const Type* type_of(Compiler* c, TypeId type) {
+	return type_get(c->table, type);
+}
+
+static inline TypeId type_at(Compiler* c, AST_Node* const* slot) {
+	return typecheck_expr_type(c->check, slot);
+}
+
+static TypeId strip_mutable(Compiler* c, TypeId type) {
+	while (type_of(c, type)->kind == TYPE_KIND_MUTABLE) type = type_of(c, type)->base;
+	return type;
+}
+
+/// What a value of the type is, past its pointers
+static TypeId value_type(Compiler* c, TypeId type) {
+	while (true) {
+		const Type* t = type_of(c, type);
+		if (t->kind != TYPE_KIND_MUTABLE && t->kind != TYPE_KIND_POINTER && t->kind != TYPE_KIND_OPTIONAL) return type;
+		type = t->base;
+	}
+}
+
+/// The pointers on the way to that
+static int pointer_depth(Compiler* c, TypeId type) {
+	int depth = 0;
+	while (true) {
+		const Type* t = type_of(c, type);
+		if (t->kind == TYPE_KIND_POINTER) depth++;
+		else if (t->kind != TYPE_KIND_MUTABLE && t->kind != TYPE_KIND_OPTIONAL) return depth;
+		type = t->base;
+	}
+}
+
+/// The type a pointer type points to, through its mutability and whether it may be null
+static TypeId pointee(Compiler* c, TypeId type) {
+	type = strip_mutable(c, type);
+	if (type_of(c, type)->kind == TYPE_KIND_OPTIONAL) type = strip_mutable(c, type_of(c, type)->base);
+	return type_of(c, type)->base;
+}
+
+static inline TypeKind value_kind(Compiler* c, TypeId type) {
+	return type_of(c, value_type(c, type))->kind;
+}
+
+/// The number of elements of an array type whose extents are all known before it runs, or -1
+static int64_t static_size(Compiler* c, TypeId type) {
+	const Type* t = type_of(c, strip_mutable(c, type));
+	if (t->kind != TYPE_KIND_ARRAY || t->is_dynamic || t->count < 1) return -1;
+	int count;
+	const int64_t* extents = type_extents(c->table, strip_mutable(c, type), &count);
+	int64_t size = 1;
+	for (int i = 0; i < count; i++) {
+		if (extents[i] < 0) return -1;
+		size *= extents[i];
+	}
+	return size;
+}
+
+/// Structs and arrays, which are kept in memory
+static bool is_aggregate(Compiler* c, TypeId type) {
+	TypeKind kind = type_of(c, strip_mutable(c, type))->kind;
+	return kind == TYPE_KIND_STRUCT || kind == TYPE_KIND_ARRAY;
+}
+
+static TypeId field_type(Compiler* c, const AST_Field* field) {
+	return typecheck_type_of(c->check, field->type);
+}
+
+static int64_t slots_of(Compiler* c, TypeId type) {
+	type = strip_mutable(c, type);
+	ptrdiff_t i = hmgeti(c->sizes, type);
+	if (i >= 0) return c->sizes[i].value;
+	const Type* t = type_of(c, type);
+	int64_t n = 1;
+	if (t->kind == TYPE_KIND_VOID) n = 0;
+	else if (t->kind == TYPE_KIND_STRUCT) {
+		const AST_Struct* decl = (const AST_Struct*) t->decl;
+		n = 0;
+		for (int f = 0; f < shlen(decl->fields); f++) n += slots_of(c, field_type(c, decl->fields[f].value));
+	}
+	else if (t->kind == TYPE_KIND_ARRAY) {
+		int64_t size = static_size(c, type);
+		n = size >= 0? size * slots_of(c, t->base) : VIEW_SLOTS;
+	}
+	hmput(c->sizes, type, n);
+	return n;
+}
+
+/// Whether values of the type can be kept in slots; reports those that can't yet
+static bool supported(Compiler* c, TypeId type, const AST_Node* at) {
+	type = strip_mutable(c, type);
+	const Type* t = type_of(c, type);
+	switch (t->kind) {
+		case TYPE_KIND_VOID:
+		case TYPE_KIND_NULL:
+		case TYPE_KIND_BOOL:
+		case TYPE_KIND_SINT:
+		case TYPE_KIND_UINT:
+		case TYPE_KIND_FLOAT:
+		case TYPE_KIND_STRING:
+		case TYPE_KIND_RUNE:
+		case TYPE_KIND_RAWPTR:
+		case TYPE_KIND_ENUM:
+			return true;
+		case TYPE_KIND_POINTER: return supported(c, t->base, at);
+		case TYPE_KIND_OPTIONAL: {
+			// Pointers that may be null are pointers
+			TypeKind base = type_of(c, strip_mutable(c, t->base))->kind;
+			if (base == TYPE_KIND_POINTER || base == TYPE_KIND_RAWPTR) return supported(c, t->base, at);
+		} break;
+		case TYPE_KIND_ARRAY:
+			if (static_size(c, type) >= 0 || t->count == 1) return supported(c, t->base, at);
+			unsupported(c, at, "Arrays of type %s, of more than one dimension known only at run time, can't be compiled yet", type_name(c->table, type));
+			return false;
+		case TYPE_KIND_STRUCT: {
+			const AST_Struct* decl = (const AST_Struct*) t->decl;
+			for (int f = 0; f < shlen(decl->fields); f++) {
+				if (!supported(c, field_type(c, decl->fields[f].value), at)) return false;
+			}
+			return true;
+		}
+		case TYPE_KIND_UNKNOWN:
+			unsupported(c, at, "The type of this isn't known, so it can't be compiled");
+			return false;
+		default: break;
+	}
+	unsupported(c, at, "Values of type %s can't be compiled yet", type_name(c->table, type));
+	return false;
+}
+
+/// The field of a struct, and how many slots into the struct it is
+static const AST_Field* find_field(Compiler* c, TypeId type, const char* name, int64_t* offset) {
+	const Type* t = type_of(c, strip_mutable(c, type));
+	if (t->kind != TYPE_KIND_STRUCT) return NULL;
+	const AST_Struct* decl = (const AST_Struct*) t->decl;
+	*offset = 0;
+	for (int f = 0; f < shlen(decl->fields); f++) {
+		if (strcmp(decl->fields[f].key, name) == 0) return decl->fields[f].value;
+		*offset += slots_of(c, field_type(c, decl->fields[f].value));
+	}
+	return NULL;
+}
+
+/// Cuts what an integer operation left in a register down to its type, or rounds a float to F32
+static void wrap(Compiler* c, int reg, TypeId type) {
+	const Type* t = type_of(c, value_type(c, type));
+	if (t->kind == TYPE_KIND_SINT && t->bits < 64) emit(c, OP_SEXT, reg, reg, t->bits);
+	else if (t->kind == TYPE_KIND_UINT && t->bits < 64) emit(c, OP_ZEXT, reg, reg, t->bits);
+	else if (t->kind == TYPE_KIND_FLOAT && t->bits == 32) emit(c, OP_F32, reg, reg, 0);
+}
+
+// === Places ===
+
+static int expr(Compiler* c, AST_Node* const* slot);
+static int expr_as(Compiler* c, AST_Node* const* slot, TypeId want);
+static void expr_to(Compiler* c, AST_Node* const* slot, TypeId want, int to);
+static int need_function(Compiler* c, SymbolId id, const AST_Node* at);
+static bool global_constant(Compiler* c, SymbolId id, const AST_Node* at, int reg);
+
+static inline Place in_register(int reg, TypeId type) {
+	return (Place) { type, true, reg, -1, 0 };
+}
+
+static inline Place in_memory(int reg, TypeId type) {
+	return (Place) { type, false, reg, -1, 0 };
+}
+
+/// Where a value in a register is: the register itself, or for a struct or array, the memory it points to
+static inline Place value_place(Compiler* c, int reg, TypeId type) {
+	return is_aggregate(c, type)? in_memory(reg, type) : in_register(reg, type);
+}
+
+/// A register pointing at a place in memory
+static int address(Compiler* c, Place place) {
+	int reg = place.reg;
+	if (place.index >= 0) {
+		int to = new_register(c);
+		emit(c, OP_ADDR, to, reg, place.index);
+		reg = to;
+	}
+	return offset_pointer(c, reg, place.offset);
+}
+
+/// The value at a place: that of a scalar, or a pointer to a struct or array
+static int load(Compiler* c, Place place) {
+	if (place.in_register) return place.reg;
+	if (is_aggregate(c, place.type)) return address(c, place);
+	int to = new_register(c);
+	if (place.index >= 0 && !place.offset) emit(c, OP_LOADX, to, place.reg, place.index);
+	else if (place.offset <= BYTECODE_MAX_IMMEDIATE) emit(c, OP_LOAD, to, address(c, (Place) { place.type, false, place.reg, place.index, 0 }), (int) place.offset);
+	else emit(c, OP_LOAD, to, address(c, place), 0);
+	return to;
+}
+
+static void store(Compiler* c, Place place, int value) {
+	if (place.in_register) {
+		if (place.reg != value) emit(c, OP_MOVE, place.reg, value, 0);
+		return;
+	}
+	if (is_aggregate(c, place.type)) {
+		copy_slots(c, address(c, place), value, slots_of(c, place.type));
+		return;
+	}
+	if (place.index >= 0 && !place.offset) emit(c, OP_STOREX, place.reg, place.index, value);
+	else if (place.offset <= BYTECODE_MAX_IMMEDIATE) emit(c, OP_STORE, address(c, (Place) { place.type, false, place.reg, place.index, 0 }), value, (int) place.offset);
+	else emit(c, OP_STORE, address(c, place), value, 0);
+}
+
+/// The place a pointer held at a place points to
+static Place deref(Compiler* c, Place place) {
+	TypeId type = pointee(c, place.type);
+	return in_memory(load(c, place), type);
+}
+
+static Place follow_pointers(Compiler* c, Place place) {
+	while (true) {
+		TypeKind kind = type_of(c, strip_mutable(c, place.type))->kind;
+		if (kind == TYPE_KIND_OPTIONAL) kind = type_of(c, strip_mutable(c, type_of(c, strip_mutable(c, place.type))->base))->kind;
+		if (kind != TYPE_KIND_POINTER) return place;
+		place = deref(c, place);
+	}
+}
+
+static bool field_place(Compiler* c, Place* place, const char* name, const AST_Node* at) {
+	*place = follow_pointers(c, *place);
+	int64_t offset;
+	const AST_Field* field = find_field(c, place->type, name, &offset);
+	if (!field) {
+		unsupported(c, at, "'%s' of a value of type %s can't be compiled yet", name, type_name(c->table, place->type));
+		return false;
+	}
+	place->offset += offset;
+	place->type = field_type(c, field);
+	return true;
+}
+
+static void check_index(Compiler* c, int index, int64_t extent) {
+	if (extent <= INT32_MAX) {
+		emit_x(c, OP_CHECKI, index, extent);
+		return;
+	}
+	int n = new_register(c);
+	load_int(c, n, extent);
+	emit(c, OP_CHECK, index, n, 0);
+}
+
+/// Multiplies a register of an index by a number of slots, into a register of its own
+static int scale(Compiler* c, int index, int64_t by) {
+	int to = new_register(c);
+	if (by >= 0 && by <= BYTECODE_MAX_IMMEDIATE) emit(c, OP_MULK, to, index, (int) by);
+	else {
+		load_int(c, to, by);
+		emit(c, OP_MUL, to, index, to);
+	}
+	return to;
+}
+
+/// The element, or the subarray of the first dimensions, of an array at a place
+static bool element_place(Compiler* c, Place* place, AST_Subscript* sub) {
+	*place = follow_pointers(c, *place);
+	TypeId type = strip_mutable(c, place->type);
+	const Type* t = type_of(c, type);
+	int n = arrlen(sub->subscripts);
+	bool checked = !c->bounds || bounds_is_checked(c->bounds, (AST_Node*) sub);
+	int count;
+	const int64_t* extents = type_extents(c->table, type, &count);
+	TypeId element = strip_mutable(c, t->base);
+	int64_t element_slots = slots_of(c, element);
+	int64_t size = static_size(c, type);
+	if (size < 0 && n != 1) {
+		unsupported(c, (AST_Node*) sub, "Only arrays of one dimension, or whose extents are known, can be subscripted yet");
+		return false;
+	}
+	int base = place->reg;
+	if (place->index >= 0) base = address(c, (Place) { type, false, place->reg, place->index, 0 });
+	int64_t offset = place->offset;
+	int length = -1;
+	if (size < 0) {
+		// The elements of a view are elsewhere
+		int view = base;
+		base = new_register(c);
+		emit(c, OP_LOAD, base, offset_pointer(c, view, offset), VIEW_DATA);
+		if (checked) {
+			length = new_register(c);
+			emit(c, OP_LOAD, length, offset_pointer(c, view, offset), VIEW_LEN);
+		}
+		offset = 0;
+	}
+	// Static arrays of more dimensions are in row-major order
+	int64_t stride = size >= 0? size * element_slots : element_slots;
+	int linear = -1;
+	for (int i = 0; i < n; i++) {
+		if (size >= 0) stride /= extents[i]? extents[i] : 1;
+		int index = expr_as(c, &sub->subscripts[i], TYPE_INT);
+		if (checked && size >= 0) check_index(c, index, extents[i]);
+		else if (checked) emit(c, OP_CHECK, index, length, 0);
+		int scaled = stride == 1? index : scale(c, index, stride);
+		if (linear < 0) linear = scaled;
+		else {
+			int sum = new_register(c);
+			emit(c, OP_ADD, sum, linear, scaled);
+			linear = sum;
+		}
+	}
+	TypeId result = element;
+	if (size >= 0 && n < count) {
+		int64_t rest[16];
+		for (int i = n; i < count && i - n < 16; i++) rest[i - n] = extents[i];
+		result = type_array(c->table, element, count - n, rest, false);
+	}
+	*place = (Place) { result, false, base, linear, offset };
+	return true;
+}
+
+/// The place an expression is, if it is one: a variable, or a field or element of one, or
+/// what a pointer points to
+static bool place_of(Compiler* c, AST_Node* const* slot, Place* place) {
+	AST_Node* node = *slot;
+	switch (node->node_type) {
+		case NODE_QUALNAME: {
+			const AST_Qualname* qn = (const AST_Qualname*) node;
+			ResolvedName found = resolution_lookup(c->res, slot);
+			if (!found.symbol) return false;
+			const Symbol* symbol = resolution_symbol(c->res, found.symbol);
+			TypeId type = typecheck_symbol_type(c->check, found.symbol);
+			if (symbol->kind == DECL_CONST) {
+				if (!is_aggregate(c, type)) return false;
+				int reg = new_register(c);
+				if (!global_constant(c, found.symbol, node, reg)) return false;
+				*place = in_memory(reg, type);
+			}
+			else if (symbol->kind == DECL_LOCAL || symbol->kind == DECL_PARAM || symbol->kind == DECL_LOOP_VAR) {
+				int reg = c->regs[found.symbol];
+				if (reg < 0) return false;
+				*place = is_aggregate(c, type) || c->boxed[found.symbol]? in_memory(reg, type) : in_register(reg, type);
+			}
+			else return false;
+			for (int i = found.n_parts; i < arrlen(qn->parts); i++) {
+				if (!field_place(c, place, qn->parts[i], node)) return false;
+			}
+			return true;
+		}
+		case NODE_FIELD_ACCESS: {
+			AST_FieldAccess* access = (AST_FieldAccess*) node;
+			if (!place_of(c, &access->base, place)) *place = value_place(c, expr(c, &access->base), type_at(c, &access->base));
+			for (int i = 0; i < arrlen(access->field->parts); i++) {
+				if (!field_place(c, place, access->field->parts[i], node)) return false;
+			}
+			return true;
+		}
+		case NODE_SUBSCRIPT: {
+			AST_Subscript* sub = (AST_Subscript*) node;
+			for (int i = 0; i < arrlen(sub->subscripts); i++) {
+				if (sub->subscripts[i]->node_type == NODE_SLICE) return false;
+			}
+			if (value_kind(c, type_at(c, &sub->array)) != TYPE_KIND_ARRAY) return false;
+			if (!place_of(c, &sub->array, place)) *place = value_place(c, expr(c, &sub->array), type_at(c, &sub->array));
+			return element_place(c, place, sub);
+		}
+		case NODE_REREFERENCE: {
+			AST_Reref* reref = (AST_Reref*) node;
+			int depth = pointer_depth(c, type_at(c, &reref->target));
+			if (reref->levels > depth) return false;
+			if (!place_of(c, &reref->target, place)) *place = value_place(c, expr(c, &reref->target), type_at(c, &reref->target));
+			for (int i = 0; i < depth - reref->levels; i++) *place = deref(c, *place);
+			return true;
+		}
+		default:
+			return false;
+	}
+}
+
+/// The place an assignment stores to: through the pointers of what it names, but for
+/// pointers that are rereferenced to be rebound
+static bool destination(Compiler* c, AST_Node* const* slot, Place* place) {
+	if (!place_of(c, slot, place)) {
+		unsupported(c, *slot, "This can't be assigned to");
+		return false;
+	}
+	if ((*slot)->node_type != NODE_REREFERENCE) *place = follow_pointers(c, *place);
+	return true;
+}
+
+// === Expressions ===
+
+/// A register for a struct or array of its own, in the frame's memory
+static int new_aggregate(Compiler* c, TypeId type) {
+	int reg = new_register(c);
+	emit_x(c, OP_LOCAL, reg, new_memory(c, slots_of(c, type)));
+	return reg;
+}
+
+static void zero_value(Compiler* c, Place place);
+
+/// Copies a struct or array into memory of its own, for a value that must not change with
+/// what it came from
+static int own_copy(Compiler* c, int value, TypeId type) {
+	int reg = new_aggregate(c, type);
+	copy_slots(c, reg, value, slots_of(c, type));
+	return reg;
+}
+
+static int call_lowered(Compiler* c, const LoweredCall* call, const AST_Node* at) {
+	int index = need_function(c, call->target, at);
+	const AST_FuncDef* def = (const AST_FuncDef*) resolution_symbol(c->res, call->target)->decl;
+	int base = c->top;
+	for (int p = 0; p < call->n_args || p < 1; p++) new_register(c);
+	for (int p = 0; p < call->n_args; p++) {
+		TypeId param = typecheck_symbol_type(c->check, declared(c, &def->params[p].value->name));
+		if (p != call->vararg) {
+			expr_to(c, call->args[p], param, base + p);
+			continue;
+		}
+		// Varargs are an array of them, in the caller's memory
+		TypeId element = type_of(c, strip_mutable(c, param))->base;
+		int64_t element_slots = slots_of(c, element);
+		int view = new_aggregate(c, param);
+		int data = new_register(c);
+		emit_x(c, OP_LOCAL, data, new_memory(c, element_slots * call->n_varargs));
+		for (int i = 0; i < call->n_varargs; i++) {
+			int value = expr_as(c, call->varargs[i], element);
+			store(c, (Place) { element, false, data, -1, element_slots * i }, value);
+		}
+		emit(c, OP_STORE, view, data, VIEW_DATA);
+		int n = new_register(c);
+		load_int(c, n, call->n_varargs);
+		emit(c, OP_STORE, view, n, VIEW_LEN);
+		emit(c, OP_MOVE, base + p, view, 0);
+	}
+	if (index < 0) return base;
+	emit_x(c, OP_CALL, base, index);
+	c->top = base + 1;
+	// What is returned in the callee's frame is copied before anything else is called
+	TypeId ret = def->ret_type? typecheck_type_of(c->check, def->ret_type) : TYPE_VOID;
+	if (is_aggregate(c, ret)) return own_copy(c, base, ret);
+	return base;
+}
+
+static int binop(Compiler* c, AST_Node* const* slot) {
+	AST_Binop* node = (AST_Binop*) *slot;
+	const LoweredCall* call = lowering_call(c->lower, *slot);
+	if (call) return call_lowered(c, call, *slot);
+	TypeId type = value_type(c, type_at(c, slot));
+	const Type* t = type_of(c, type);
+	const char* op = node->op;
+	bool is_float = t->kind == TYPE_KIND_FLOAT;
+	if (op[1] || !strchr("+-*/%^", op[0]) || (t->kind != TYPE_KIND_SINT && t->kind != TYPE_KIND_UINT && !is_float)) {
+		unsupported(c, *slot, "Operator '%s' on values of type %s can't be compiled yet", op, type_name(c->table, type));
+		return new_register(c);
+	}
+	// true * x = x, false * x = the zero of its type
+	bool lhs_bool = value_kind(c, type_at(c, &node->lhs)) == TYPE_KIND_BOOL, rhs_bool = value_kind(c, type_at(c, &node->rhs)) == TYPE_KIND_BOOL;
+	int lhs, rhs;
+	if (op[0] == '*' && (lhs_bool || rhs_bool)) {
+		lhs = expr(c, lhs_bool? &node->lhs : &node->rhs);
+		rhs = expr_as(c, lhs_bool? &node->rhs : &node->lhs, type);
+		if (is_float) {
+			int f = new_register(c);
+			emit(c, OP_ITOF, f, lhs, 0);
+			lhs = f;
+		}
+	}
+	else {
+		lhs = expr_as(c, &node->lhs, type);
+		rhs = expr_as(c, &node->rhs, type);
+	}
+	bool is_unsigned = t->kind == TYPE_KIND_UINT;
+	Opcode opcode;
+	switch (op[0]) {
+		case '+': opcode = is_float? OP_FADD : OP_ADD; break;
+		case '-': opcode = is_float? OP_FSUB : OP_SUB; break;
+		case '*': opcode = is_float? OP_FMUL : OP_MUL; break;
+		case '/': opcode = is_float? OP_FDIV : is_unsigned? OP_UDIV : OP_DIV; break;
+		case '%': opcode = is_float? OP_FMOD : is_unsigned? OP_UMOD : OP_MOD; break;
+		default: opcode = is_float? OP_FPOW : is_unsigned? OP_UPOW : OP_POW; break;
+	}
+	int to = new_register(c);
+	emit(c, opcode, to, lhs, rhs);
+	wrap(c, to, type);
+	return to;
+}
+
+/// The opcode comparing two values of a type, and whether its operands are swapped
+static Opcode comparison_op(Compiler* c, const char* op, TypeId type, bool* swap, bool* negate) {
+	TypeKind kind = type_of(c, type)->kind;
+	*swap = op[0] == '>';
+	*negate = false;
+	bool equality = op[0] == '=' || op[0] == '!';
+	bool inclusive = op[1] == '=';
+	if (kind == TYPE_KIND_STRING) {
+		*negate = op[0] == '!';
+		return equality? OP_SEQ : inclusive? OP_SLE : OP_SLT;
+	}
+	if (kind == TYPE_KIND_FLOAT) return op[0] == '='? OP_FEQ : op[0] == '!'? OP_FNE : inclusive? OP_FLE : OP_FLT;
+	if (equality) return op[0] == '='? OP_EQ : OP_NE;
+	if (kind == TYPE_KIND_UINT) return inclusive? OP_ULE : OP_ULT;
+	return inclusive? OP_LE : OP_LT;
+}
+
+/// The type the operands of comparison i of a chain are compared as
+static TypeId compared_type(Compiler* c, AST_ComparisonChain* chain, int i) {
+	AST_Node* const* lhs = &chain->operands[i];
+	AST_Node* const* rhs = &chain->operands[i + 1];
+	if ((*lhs)->node_type == NODE_NULL) return type_at(c, rhs);
+	if ((*rhs)->node_type == NODE_NULL) return type_at(c, lhs);
+	TypeId a = type_unqualified(c->table, value_type(c, type_at(c, lhs))), b = type_unqualified(c->table, value_type(c, type_at(c, rhs)));
+	TypeId common;
+	return type_common(c->table, a, b, &common)? common : a;
+}
+
+/// Whether the operands compared are pointers, which are compared as they are
+static inline bool compares_pointers(AST_ComparisonChain* chain, int i) {
+	return chain->operands[i]->node_type == NODE_NULL || chain->operands[i + 1]->node_type == NODE_NULL;
+}
+
+static int compare(Compiler* c, AST_ComparisonChain* chain, int i) {
+	const LoweredCall* call = lowering_comparison(c->lower, chain, i);
+	if (call) return call_lowered(c, call, (AST_Node*) chain);
+	TypeId type = compared_type(c, chain, i);
+	bool pointers = compares_pointers(chain, i);
+	int lhs = pointers? expr(c, &chain->operands[i]) : expr_as(c, &chain->operands[i], type);
+	int rhs = pointers? expr(c, &chain->operands[i + 1]) : expr_as(c, &chain->operands[i + 1], type);
+	bool swap, negate;
+	Opcode op = comparison_op(c, chain->comparisons[i], pointers? TYPE_INT : type, &swap, &negate);
+	int to = new_register(c);
+	emit(c, op, to, swap? rhs : lhs, swap? lhs : rhs);
+	if (negate) emit(c, OP_NOT, to, to, 0);
+	return to;
+}
+
+static int comparison(Compiler* c, AST_ComparisonChain* chain) {
+	int n = arrlen(chain->comparisons);
+	if (n == 1) return compare(c, chain, 0);
+	// Each comparison after the first is only made if those before it held
+	int to = new_register(c);
+	int* done = NULL;
+	for (int i = 0; i < n; i++) {
+		int top = c->top;
+		emit(c, OP_MOVE, to, compare(c, chain, i), 0);
+		c->top = top;
+		if (i < n - 1) arrput(done, emit_x(c, OP_JF, to, 0));
+	}
+	patch_all(c, done, here(c));
+	arrfree(done);
+	return to;
+}
+
+/// Jumps when a condition is `when`, from JMPs added to `jumps` for patching
+static void branch(Compiler* c, AST_Node* const* slot, bool when, int** jumps) {
+	AST_Node* node = *slot;
+	int top = c->top;
+	if (node->node_type == NODE_NOT) {
+		branch(c, &((AST_Not*) node)->expr, !when, jumps);
+		return;
+	}
+	if ((node->node_type == NODE_AND || node->node_type == NODE_OR) && value_kind(c, type_at(c, slot)) == TYPE_KIND_BOOL) {
+		AST_And* logic = (AST_And*) node;
+		bool is_and = node->node_type == NODE_AND;
+		if (is_and != when) {
+			// Either side decides it
+			branch(c, &logic->lhs, when, jumps);
+			branch(c, &logic->rhs, when, jumps);
+			return;
+		}
+		int* past = NULL;
+		branch(c, &logic->lhs, !when, &past);
+		branch(c, &logic->rhs, when, jumps);
+		patch_all(c, past, here(c));
+		arrfree(past);
+		return;
+	}
+	if (node->node_type == NODE_COMPARISON && arrlen(((AST_ComparisonChain*) node)->comparisons) == 1) {
+		AST_ComparisonChain* chain = (AST_ComparisonChain*) node;
+		TypeId type = compared_type(c, chain, 0);
+		TypeKind kind = type_of(c, type)->kind;
+		const char* op = chain->comparisons[0];
+		bool integer = kind == TYPE_KIND_SINT || kind == TYPE_KIND_ENUM || kind == TYPE_KIND_RUNE || kind == TYPE_KIND_BOOL;
+		// Floats compare false with NaN either way, so only jump when they compare true
+		bool fused = !lowering_comparison(c->lower, chain, 0) && !compares_pointers(chain, 0)
+			&& (integer || (kind == TYPE_KIND_FLOAT && when && op[0] != '=' && op[0] != '!'));
+		if (fused) {
+			int lhs = expr_as(c, &chain->operands[0], type);
+			int rhs = expr_as(c, &chain->operands[1], type);
+			// By what holds when it jumps
+			char held[3] = { op[0], op[1], 0 };
+			if (!when) {
+				static const char* const opposite[][2] = { { "<", ">=" }, { "<=", ">" }, { ">", "<=" }, { ">=", "<" }, { "==", "!=" }, { "!=", "==" } };
+				for (size_t i = 0; i < sizeof(opposite) / sizeof(*opposite); i++) {
+					if (strcmp(op, opposite[i][0]) == 0) memcpy(held, opposite[i][1], strlen(opposite[i][1]) + 1);
+				}
+			}
+			bool is_float = kind == TYPE_KIND_FLOAT;
+			Opcode jump = held[0] == '='? OP_JEQ : held[0] == '!'? OP_JNE
+				: held[0] == '<'? (held[1]? (is_float? OP_JFLE : OP_JLE) : (is_float? OP_JFLT : OP_JLT))
+				: (held[1]? (is_float? OP_JFGE : OP_JGE) : (is_float? OP_JFGT : OP_JGT));
+			emit(c, jump, lhs, rhs, 0);
+			arrput(*jumps, emit_x(c, OP_JMP, 0, 0));
+			c->top = top;
+			return;
+		}
+	}
+	int value = expr(c, slot);
+	arrput(*jumps, emit_x(c, when? OP_JT : OP_JF, value, 0));
+	c->top = top;
+}
+
+static void branch_to(Compiler* c, AST_Node* const* slot, bool when, int target) {
+	int* jumps = NULL;
+	branch(c, slot, when, &jumps);
+	patch_all(c, jumps, target);
+	arrfree(jumps);
+}
+
+static int logic(Compiler* c, AST_Node* const* slot) {
+	AST_Node* node = *slot;
+	if (value_kind(c, type_at(c, slot)) != TYPE_KIND_BOOL) {
+		unsupported(c, node, "'and' and 'or' of values other than Bool can't be compiled yet");
+		return new_register(c);
+	}
+	int to = new_register(c);
+	int* no = NULL;
+	branch(c, slot, false, &no);
+	emit_x(c, OP_LOADI, to, 1);
+	int done = emit_x(c, OP_JMP, 0, 0);
+	patch_all(c, no, here(c));
+	emit_x(c, OP_LOADI, to, 0);
+	patch(c, done, here(c));
+	arrfree(no);
+	return to;
+}
+
+static int ternary(Compiler* c, AST_Node* const* slot) {
+	AST_Ternary* node = (AST_Ternary*) *slot;
+	TypeId type = type_at(c, slot);
+	int to = new_register(c);
+	int* no = NULL;
+	branch(c, &node->condition, false, &no);
+	expr_to(c, &node->true_expr, type, to);
+	int done = emit_x(c, OP_JMP, 0, 0);
+	patch_all(c, no, here(c));
+	expr_to(c, &node->false_expr, type, to);
+	patch(c, done, here(c));
+	arrfree(no);
+	// Each side has memory of its own, so a struct or array is in neither once they meet
+	return is_aggregate(c, type)? own_copy(c, to, type) : to;
+}
+
+static int unary(Compiler* c, AST_Node* const* slot) {
+	AST_Unary* node = (AST_Unary*) *slot;
+	const LoweredCall* call = lowering_call(c->lower, *slot);
+	if (call) return call_lowered(c, call, *slot);
+	TypeId type = value_type(c, type_at(c, slot));
+	TypeKind kind = type_of(c, type)->kind;
+	bool number = kind == TYPE_KIND_SINT || kind == TYPE_KIND_UINT || kind == TYPE_KIND_FLOAT;
+	if (strcmp(node->op, "+") == 0 && number) return expr_as(c, &node->expr, type);
+	if (strcmp(node->op, "-") != 0 || !number) {
+		unsupported(c, *slot, "Operator '%s' on a value of type %s can't be compiled yet", node->op, type_name(c->table, type));
+		return new_register(c);
+	}
+	int value = expr_as(c, &node->expr, type);
+	int to = new_register(c);
+	emit(c, kind == TYPE_KIND_FLOAT? OP_FNEG : OP_NEG, to, value, 0);
+	wrap(c, to, type);
+	return to;
+}
+
+/// The slot of the value of a field in a struct literal, or NULL if it isn't given one
+static AST_Node* const* field_value(AST_FuncCall* call, const AST_Struct* decl, int f) {
+	AST_Field* field = decl->fields[f].value;
+	ptrdiff_t kw = shgeti(call->kw_args, decl->fields[f].key);
+	return f < arrlen(call->pos_args)? &call->pos_args[f] : kw >= 0? &call->kw_args[kw].value
+		: field->default_value? &field->default_value : NULL;
+}
+
+static int struct_value(Compiler* c, AST_Node* const* slot, SymbolId id) {
+	AST_FuncCall* call = (AST_FuncCall*) *slot;
+	const AST_Struct* decl = (const AST_Struct*) resolution_symbol(c->res, id)->decl;
+	TypeId type = value_type(c, type_at(c, slot));
+	int reg = new_aggregate(c, type);
+	int64_t offset = 0;
+	for (int f = 0; f < shlen(decl->fields); f++) {
+		int top = c->top;
+		TypeId type = field_type(c, decl->fields[f].value);
+		AST_Node* const* value = field_value(call, decl, f);
+		Place place = { type, false, reg, -1, offset };
+		if (value) store(c, place, expr_as(c, value, type));
+		else zero_value(c, place);
+		offset += slots_of(c, type);
+		c->top = top;
+	}
+	return reg;
+}
+
+/// Whether an array literal's elements, and those of the literals nested in it, are all
+/// literal numbers, which can be kept with the program
+static bool is_literal_array(AST_Node* node, int dims) {
+	if (node->node_type == NODE_PACKED_ARRAY) return true;
+	if (dims == 0) {
+		if (node->node_type == NODE_UNARY && strcmp(((AST_Unary*) node)->op, "-") == 0) node = ((AST_Unary*) node)->expr;
+		return node->node_type == NODE_INT || node->node_type == NODE_FLOAT || node->node_type == NODE_BOOL || node->node_type == NODE_CHAR;
+	}
+	if (node->node_type != NODE_ARRAY) return false;
+	AST_ArrayLiteral* array = (AST_ArrayLiteral*) node;
+	for (int i = 0; i < arrlen(array->elements); i++) {
+		if (!is_literal_array(array->elements[i], dims - 1)) return false;
+	}
+	return true;
+}
+
+/// The slot of a literal number as an element of type `element`
+static Slot literal_slot(Compiler* c, AST_Node* node, TypeId element) {
+	bool negative = node->node_type == NODE_UNARY;
+	if (negative) node = ((AST_Unary*) node)->expr;
+	const Type* t = type_of(c, value_type(c, element));
+	bool is_float = t->kind == TYPE_KIND_FLOAT;
+	Slot value = { 0 };
+	switch (node->node_type) {
+		case NODE_INT:
+			if (is_float) value.f = (double) ((AST_Int*) node)->value;
+			else value.i = (int64_t) ((AST_Int*) node)->value;
+			break;
+		case NODE_FLOAT: value.f = (double) ((AST_Float*) node)->value; break;
+		case NODE_BOOL: value.i = ((AST_Bool*) node)->value; break;
+		case NODE_CHAR: value.i = ((AST_Char*) node)->value; break;
+		default: break;
+	}
+	if (negative && is_float) value.f = -value.f;
+	else if (negative) value.i = (int64_t) (0 - value.u);
+	if (is_float && t->bits == 32) value.f = (float) value.f;
+	return value;
+}
+
+/// Puts the elements of a literal array in slots, in row-major order
+static void literal_elements(Compiler* c, AST_Node* node, TypeId element, int dims, Slot ARRAY* out) {
+	if (node->node_type == NODE_PACKED_ARRAY) {
+		AST_PackedArray* packed = (AST_PackedArray*) node;
+		const Type* t = type_of(c, value_type(c, element));
+		bool is_float = t->kind == TYPE_KIND_FLOAT, single = is_float && t->bits == 32;
+		int n = packed->kind == PACKED_INT? arrlen(packed->ints) : arrlen(packed->floats);
+		for (int i = 0; i < n; i++) {
+			Slot value;
+			if (packed->kind == PACKED_FLOAT) value.f = packed->floats[i];
+			else if (is_float) value.f = (double) packed->ints[i];
+			else value.i = (int64_t) packed->ints[i];
+			if (single) value.f = (float) value.f;
+			arrput(*out, value);
+		}
+		return;
+	}
+	if (dims == 0) {
+		arrput(*out, literal_slot(c, node, element));
+		return;
+	}
+	AST_ArrayLiteral* array = (AST_ArrayLiteral*) node;
+	for (int i = 0; i < arrlen(array->elements); i++) literal_elements(c, array->elements[i], element, dims - 1, out);
+}
+
+/// Stores the elements of an array literal from `at` slots on
+static void store_elements(Compiler* c, AST_Node* const* slot, TypeId element, int dims, int reg, int64_t* at) {
+	AST_Node* node = *slot;
+	if (node->node_type != NODE_ARRAY || dims == 0) {
+		int top = c->top;
+		store(c, (Place) { element, false, reg, -1, *at }, expr_as(c, slot, element));
+		*at += slots_of(c, element);
+		c->top = top;
+		return;
+	}
+	AST_ArrayLiteral* array = (AST_ArrayLiteral*) node;
+	for (int i = 0; i < arrlen(array->elements); i++) store_elements(c, &array->elements[i], element, dims - 1, reg, at);
+}
+
+/// Keeps slots with the program, returning where they are in its globals
+static int64_t add_globals(Compiler* c, const Slot* slots, int64_t n) {
+	int64_t at = arrlen(c->program->globals);
+	for (int64_t i = 0; i < n; i++) arrput(c->program->globals, slots[i]);
+	return at;
+}
+
+static int array_literal(Compiler* c, AST_Node* const* slot) {
+	TypeId type = value_type(c, type_at(c, slot));
+	const Type* t = type_of(c, type);
+	if (static_size(c, type) < 0) {
+		unsupported(c, *slot, "Array literals of type %s can't be compiled yet", type_name(c->table, type));
+		return new_register(c);
+	}
+	TypeId element = strip_mutable(c, t->base);
+	int reg = new_aggregate(c, type);
+	if (!is_aggregate(c, element) && is_literal_array(*slot, t->count)) {
+		// Copied from the program, rather than stored one by one
+		Slot ARRAY slots = NULL;
+		literal_elements(c, *slot, element, t->count, &slots);
+		int64_t at = add_globals(c, slots, arrlen(slots));
+		int global = new_register(c);
+		emit_x(c, OP_GLOBAL, global, at);
+		copy_slots(c, reg, global, arrlen(slots));
+		arrfree(slots);
+		return reg;
+	}
+	int64_t at = 0;
+	store_elements(c, slot, element, t->count, reg, &at);
+	return reg;
+}
+
+/// Whether a constant's value is a literal (or a negated one), and so can be compiled
+static AST_Node* constant_value(Compiler* c, SymbolId id, const AST_Node* at) {
+	AST_Const* decl = (AST_Const*) resolution_symbol(c->res, id)->decl;
+	AST_Node* value = decl->value;
+	if (value->node_type == NODE_UNARY && strcmp(((AST_Unary*) value)->op, "-") == 0) value = ((AST_Unary*) value)->expr;
+	switch (value->node_type) {
+		case NODE_INT:
+		case NODE_FLOAT:
+		case NODE_BOOL:
+		case NODE_CHAR:
+		case NODE_STRING:
+		case NODE_ARRAY:
+		case NODE_PACKED_ARRAY:
+			return decl->value;
+		default:
+			unsupported(c, at, "The value of '%s' isn't known at compile time, so it can't be compiled yet", decl->name->name);
+			return NULL;
+	}
+}
+
+/// Points a register at an array constant, kept in the globals
+static bool global_constant(Compiler* c, SymbolId id, const AST_Node* at, int reg) {
+	if (!c->globals[id]) {
+		AST_Node* value = constant_value(c, id, at);
+		if (!value) return false;
+		TypeId type = typecheck_symbol_type(c->check, id);
+		const Type* t = type_of(c, strip_mutable(c, type));
+		if (t->kind != TYPE_KIND_ARRAY || static_size(c, type) < 0 || is_aggregate(c, t->base) || !is_literal_array(value, t->count)) {
+			unsupported(c, at, "Constants of type %s can't be compiled yet", type_name(c->table, type));
+			return false;
+		}
+		Slot ARRAY slots = NULL;
+		literal_elements(c, value, strip_mutable(c, t->base), t->count, &slots);
+		c->globals[id] = add_globals(c, slots, arrlen(slots)) + 1;
+		arrfree(slots);
+	}
+	emit_x(c, OP_GLOBAL, reg, c->globals[id] - 1);
+	return true;
+}
+
+static int qualname(Compiler* c, AST_Node* const* slot) {
+	const AST_Qualname* qn = (const AST_Qualname*) *slot;
+	int n = arrlen(qn->parts);
+	ResolvedName found = resolution_lookup(c->res, slot);
+	if (!found.symbol) {
+		unsupported(c, *slot, "'%s' isn't declared in the module, so it can't be compiled", qn->parts[0]);
+		return new_register(c);
+	}
+	const Symbol* symbol = resolution_symbol(c->res, found.symbol);
+	if (symbol->kind == DECL_ENUM && n == found.n_parts + 1) {
+		// Members are numbered after the one before, or are the next bit of flags
+		const AST_Enum* decl = (const AST_Enum*) symbol->decl;
+		int64_t value = 0;
+		for (int i = 0; i < shlen(decl->fields); i++) {
+			const AST_EnumValue* member = decl->fields[i].value;
+			if (member->value && member->value->node_type == NODE_INT) value = (int64_t) ((AST_Int*) member->value)->value;
+			else if (member->value) {
+				unsupported(c, *slot, "The value of '%s.%s' isn't known at compile time", symbol->name, decl->fields[i].key);
+				break;
+			}
+			else if (i) value = decl->is_flags? (value? value << 1 : 1) : value + 1;
+			else value = decl->is_flags? 1 : 0;
+			if (strcmp(decl->fields[i].key, qn->parts[found.n_parts]) == 0) break;
+		}
+		int reg = new_register(c);
+		load_int(c, reg, value);
+		return reg;
+	}
+	if (symbol->kind == DECL_CONST && n == found.n_parts && !is_aggregate(c, typecheck_symbol_type(c->check, found.symbol))) {
+		AST_Node* value = constant_value(c, found.symbol, *slot);
+		int reg = new_register(c);
+		if (!value) return reg;
+		TypeId type = typecheck_symbol_type(c->check, found.symbol);
+		if (value_kind(c, type) == TYPE_KIND_STRING) {
+			const StringValue* string = intern_string(c, ((AST_String*) value)->value);
+			emit_x(c, OP_LOADK, reg, constant(c, (Slot) { .p = (void*) string }));
+		}
+		else emit_x(c, OP_LOADK, reg, constant(c, literal_slot(c, value, type)));
+		return reg;
+	}
+	Place place;
+	if (!place_of(c, slot, &place)) {
+		unsupported(c, *slot, "'%s' can't be used as a value yet", symbol->name);
+		return new_register(c);
+	}
+	return load(c, place);
+}
+
+static int cast(Compiler* c, AST_FuncCall* call, TypeId to) {
+	const Type* t = type_of(c, to);
+	if (arrlen(call->pos_args) != 1 || t->kind == TYPE_KIND_VECTOR) {
+		unsupported(c, (AST_Node*) call, "Vectors can't be compiled yet");
+		return new_register(c);
+	}
+	TypeId from = value_type(c, type_at(c, &call->pos_args[0]));
+	TypeKind kind = type_of(c, from)->kind;
+	int value = expr(c, &call->pos_args[0]);
+	int reg = new_register(c);
+	bool from_float = kind == TYPE_KIND_FLOAT;
+	switch (t->kind) {
+		case TYPE_KIND_BOOL:
+			emit(c, from_float? OP_FBOOL : OP_BOOL, reg, value, 0);
+			break;
+		case TYPE_KIND_SINT:
+		case TYPE_KIND_UINT:
+		case TYPE_KIND_RUNE:
+			if (from_float) emit(c, t->kind == TYPE_KIND_UINT && t->bits == 64? OP_FTOU : OP_FTOI, reg, value, 0);
+			else emit(c, OP_MOVE, reg, value, 0);
+			wrap(c, reg, to);
+			break;
+		case TYPE_KIND_FLOAT:
+			if (!from_float) emit(c, kind == TYPE_KIND_UINT? OP_UTOF : OP_ITOF, reg, value, 0);
+			else emit(c, OP_MOVE, reg, value, 0);
+			wrap(c, reg, to);
+			break;
+		default:
+			unsupported(c, (AST_Node*) call, "Casts to %s can't be compiled yet", type_name(c->table, to));
+	}
+	return reg;
+}
+
+static int length(Compiler* c, AST_FuncCall* call) {
+	AST_Node* const* arg = &call->pos_args[0];
+	TypeId type = value_type(c, type_at(c, arg));
+	int reg;
+	if (type == TYPE_STRING) {
+		int string = expr(c, arg);
+		reg = new_register(c);
+		emit(c, OP_LEN, reg, string, 0);
+	}
+	else if (static_size(c, type) < 0) {
+		int view = expr_as(c, arg, type);
+		reg = new_register(c);
+		emit(c, OP_LOAD, reg, view, VIEW_LEN);
+	}
+	else {
+		int count;
+		const int64_t* extents = type_extents(c->table, strip_mutable(c, type), &count);
+		reg = new_register(c);
+		load_int(c, reg, extents[0]);
+	}
+	return reg;
+}
+
+static int math(Compiler* c, AST_Node* const* slot, const char* name) {
+	static const char* const functions[] = { "sqrt", "sin", "cos", "tan", "exp", "log", "floor", "ceil" };
+	static const struct { const char* name; Opcode sint, uint, flt; } binary[] = {
+		{ "min", OP_MIN, OP_UMIN, OP_FMIN }, { "max", OP_MAX, OP_UMAX, OP_FMAX },
+		{ "bit_and", OP_BAND, OP_BAND, OP_COUNT }, { "bit_or", OP_BOR, OP_BOR, OP_COUNT }, { "bit_xor", OP_BXOR, OP_BXOR, OP_COUNT },
+		{ "shift_left", OP_SHL, OP_SHL, OP_COUNT }, { "shift_right", OP_SHR, OP_USHR, OP_COUNT },
+	};
+	AST_FuncCall* call = (AST_FuncCall*) *slot;
+	TypeId type = value_type(c, type_at(c, slot));
+	const Type* t = type_of(c, type);
+	int n = arrlen(call->pos_args);
+	int reg;
+	for (size_t i = 0; i < sizeof(functions) / sizeof(*functions); i++) {
+		if (n != 1 || strcmp(name, functions[i]) != 0) continue;
+		int value = expr_as(c, &call->pos_args[0], type);
+		reg = new_register(c);
+		emit(c, OP_MATH, reg, value, (int) i);
+		wrap(c, reg, type);
+		return reg;
+	}
+	if (n == 1 && (strcmp(name, "abs") == 0 || strcmp(name, "bit_not") == 0)) {
+		int value = expr_as(c, &call->pos_args[0], type);
+		reg = new_register(c);
+		if (name[0] == 'b') emit(c, OP_BNOT, reg, value, 0);
+		else if (t->kind == TYPE_KIND_UINT) emit(c, OP_MOVE, reg, value, 0);
+		else emit(c, t->kind == TYPE_KIND_FLOAT? OP_FABS : OP_ABS, reg, value, 0);
+		wrap(c, reg, type);
+		return reg;
+	}
+	for (size_t i = 0; i < sizeof(binary) / sizeof(*binary); i++) {
+		if (n != 2 || strcmp(name, binary[i].name) != 0) continue;
+		bool shift = binary[i].name[0] == 's';
+		int lhs = expr_as(c, &call->pos_args[0], type);
+		int rhs = shift? expr(c, &call->pos_args[1]) : expr_as(c, &call->pos_args[1], type);
+		reg = new_register(c);
+		emit(c, t->kind == TYPE_KIND_FLOAT? binary[i].flt : t->kind == TYPE_KIND_UINT? binary[i].uint : binary[i].sint, reg, lhs, rhs);
+		wrap(c, reg, type);
+		return reg;
+	}
+	unsupported(c, *slot, "This call can't be compiled yet");
+	return new_register(c);
+}
+
+static bool is_builtin(Compiler* c, const AST_FuncCall* call, const char* name) {
+	if (call->func->node_type != NODE_QUALNAME || resolution_lookup(c->res, &call->func).symbol) return false;
+	const AST_Qualname* qn = (const AST_Qualname*) call->func;
+	return arrlen(qn->parts) == 1 && strcmp(qn->parts[0], name) == 0;
+}
+
+/// 'alloc(T)' and 'heapval(value)', made where escape analysis placed them, as a pointer of type `want`
+static int allocation(Compiler* c, AST_FuncCall* call, TypeId want) {
+	TypeId pointer = strip_mutable(c, want);
+	if (type_of(c, pointer)->kind == TYPE_KIND_OPTIONAL) pointer = strip_mutable(c, type_of(c, pointer)->base);
+	if (type_of(c, pointer)->kind != TYPE_KIND_POINTER || arrlen(call->pos_args) != 1) {
+		unsupported(c, (AST_Node*) call, "What this allocates must have a pointer type given, as in 'p: @Int = alloc(Int)'");
+		return new_register(c);
+	}
+	TypeId target = type_of(c, pointer)->base;
+	Placement placement = c->esc? escape_placement(c->esc, (AST_Node*) call) : PLACEMENT_HEAP;
+	int reg = new_register(c);
+	emit_x(c, placement == PLACEMENT_TEMPORARY? OP_TNEW : OP_NEW, reg, slots_of(c, target) > 0? slots_of(c, target) : 1);
+	if (is_builtin(c, call, "heapval")) store(c, in_memory(reg, target), expr_as(c, &call->pos_args[0], target));
+	return reg;
+}
+
+static int call(Compiler* c, AST_Node* const* slot) {
+	AST_FuncCall* node = (AST_FuncCall*) *slot;
+	const LoweredCall* lowered = lowering_call(c->lower, *slot);
+	if (lowered) return call_lowered(c, lowered, *slot);
+	if (node->func->node_type == NODE_QUALNAME) {
+		const AST_Qualname* qn = (const AST_Qualname*) node->func;
+		ResolvedName found = resolution_lookup(c->res, &node->func);
+		if (found.symbol && found.n_parts == arrlen(qn->parts) && resolution_symbol(c->res, found.symbol)->kind == DECL_STRUCT) {
+			return struct_value(c, slot, found.symbol);
+		}
+		if (!found.symbol && arrlen(qn->parts) == 1) {
+			TypeId to = type_builtin(c->table, qn->parts[0]);
+			if (to) return cast(c, node, to);
+			if (strcmp(qn->parts[0], "len") == 0 && arrlen(node->pos_args) == 1) return length(c, node);
+			if (type_at(c, slot) != TYPE_UNKNOWN && !shlen(node->kw_args)) return math(c, slot, qn->parts[0]);
+		}
+	}
+	unsupported(c, *slot, "This call can't be compiled yet");
+	return new_register(c);
+}
+
+/// A view of the elements of an array, or of a slice of them
+static int slice(Compiler* c, AST_Node* const* slot, AST_Subscript* sub, AST_Slice* range) {
+	TypeId type = value_type(c, type_at(c, &sub->array));
+	if (arrlen(sub->subscripts) != 1 || type_of(c, type)->count != 1 || range->step) {
+		unsupported(c, (AST_Node*) sub, "Only slices of one dimension, without a step, can be compiled yet");
+		return new_register(c);
+	}
+	bool checked = !c->bounds || bounds_is_checked(c->bounds, (AST_Node*) sub);
+	int array = expr_as(c, &sub->array, type);
+	int64_t size = static_size(c, type);
+	int data = array, length = new_register(c);
+	if (size >= 0) load_int(c, length, size);
+	else {
+		data = new_register(c);
+		emit(c, OP_LOAD, data, array, VIEW_DATA);
+		emit(c, OP_LOAD, length, array, VIEW_LEN);
+	}
+	int start = length, end = length;
+	if (range->start) start = expr_as(c, &range->start, TYPE_INT);
+	else {
+		start = new_register(c);
+		emit_x(c, OP_LOADI, start, 0);
+	}
+	if (range->end) {
+		end = expr_as(c, &range->end, TYPE_INT);
+		if (range->is_inclusive) {
+			int inclusive = new_register(c);
+			emit(c, OP_ADDK, inclusive, end, 1);
+			end = inclusive;
+		}
+	}
+	if (checked) emit(c, OP_CHECKSLICE, start, end, length);
+	TypeId view = type_at(c, slot);
+	int reg = new_aggregate(c, view);
+	int64_t element_slots = slots_of(c, type_of(c, type)->base);
+	int first = element_slots == 1? start : scale(c, start, element_slots);
+	int pointer = new_register(c);
+	emit(c, OP_ADDR, pointer, data, first);
+	emit(c, OP_STORE, reg, pointer, VIEW_DATA);
+	int count = new_register(c);
+	emit(c, OP_SUB, count, end, start);
+	emit(c, OP_STORE, reg, count, VIEW_LEN);
+	return reg;
+}
+
+/// Compiles an expression, and returns the register its value is in: one of its own, or
+/// that of a variable, which mustn't be written to. Structs and arrays are pointers to them.
+static int expr(Compiler* c, AST_Node* const* slot) {
+	AST_Node* node = *slot;
+	int reg;
+	switch (node->node_type) {
+		case NODE_INT:
+		case NODE_FLOAT:
+		case NODE_BOOL:
+		case NODE_CHAR:
+			reg = new_register(c);
+			if (node->node_type == NODE_FLOAT || value_kind(c, type_at(c, slot)) == TYPE_KIND_FLOAT) {
+				load_float(c, reg, literal_slot(c, node, value_type(c, type_at(c, slot))).f);
+			}
+			else load_int(c, reg, literal_slot(c, node, type_at(c, slot)).i);
+			return reg;
+		case NODE_STRING:
+			reg = new_register(c);
+			emit_x(c, OP_LOADK, reg, constant(c, (Slot) { .p = (void*) intern_string(c, ((AST_String*) node)->value) }));
+			return reg;
+		case NODE_NULL:
+			reg = new_register(c);
+			emit_x(c, OP_LOADI, reg, 0);
+			return reg;
+		case NODE_QUALNAME:
+			return qualname(c, slot);
+		case NODE_FIELD_ACCESS:
+		case NODE_REREFERENCE: {
+			Place place;
+			if (place_of(c, slot, &place)) return load(c, place);
+			if (node->node_type == NODE_FIELD_ACCESS) break;
+			// A value where a pointer to it is wanted
+			AST_Reref* reref = (AST_Reref*) node;
+			TypeId target = type_at(c, &reref->target);
+			if (reref->levels != pointer_depth(c, target) + 1) {
+				unsupported(c, node, "Only variables, fields and elements have an address");
+				return new_register(c);
+			}
+			int value = expr(c, &reref->target);
+			if (is_aggregate(c, target)) return value;
+			reg = new_register(c);
+			emit_x(c, OP_LOCAL, reg, new_memory(c, 1));
+			emit(c, OP_STORE, reg, value, 0);
+			return reg;
+		}
+		case NODE_SUBSCRIPT: {
+			AST_Subscript* sub = (AST_Subscript*) node;
+			for (int i = 0; i < arrlen(sub->subscripts); i++) {
+				if (sub->subscripts[i]->node_type == NODE_SLICE) return slice(c, slot, sub, (AST_Slice*) sub->subscripts[i]);
+			}
+			Place place;
+			if (place_of(c, slot, &place)) return load(c, place);
+			unsupported(c, node, "Subscripts of values of type %s can't be compiled yet", type_name(c->table, type_at(c, &sub->array)));
+			return new_register(c);
+		}
+		case NODE_BINOP:
+			return binop(c, slot);
+		case NODE_UNARY:
+			return unary(c, slot);
+		case NODE_COMPARISON:
+			return comparison(c, (AST_ComparisonChain*) node);
+		case NODE_NOT: {
+			int value = expr(c, &((AST_Not*) node)->expr);
+			reg = new_register(c);
+			emit(c, OP_NOT, reg, value, 0);
+			return reg;
+		}
+		case NODE_AND:
+		case NODE_OR:
+			return logic(c, slot);
+		case NODE_TERNARY:
+			return ternary(c, slot);
+		case NODE_FUNC_CALL:
+			if (escape_is_allocation(c->res, node)) {
+				unsupported(c, node, "What this allocates must have a pointer type given, as in 'p: @Int = alloc(Int)'");
+				return new_register(c);
+			}
+			return call(c, slot);
+		case NODE_ARRAY:
+		case NODE_PACKED_ARRAY:
+			return array_literal(c, slot);
+		default:
+			break;
+	}
+	unsupported(c, node, "This expression can't be compiled yet");
+	return new_register(c);
+}
+
+/// Compiles an expression as a value of another type: with pointers followed or taken where
+/// the types have different numbers of them, numbers converted, and arrays whose extents
+/// are known turned into ones whose extents aren't
+static int expr_as(Compiler* c, AST_Node* const* slot, TypeId want) {
+	AST_Node* node = *slot;
+	if (escape_is_allocation(c->res, node)) return allocation(c, (AST_FuncCall*) node, want);
+	TypeId have = type_at(c, slot);
+	if (want == TYPE_UNKNOWN || have == TYPE_UNKNOWN || node->node_type == NODE_NULL) return expr(c, slot);
+	int depth = pointer_depth(c, have), wanted = pointer_depth(c, want);
+	TypeId from = value_type(c, have), to = value_type(c, want);
+	const Type* f = type_of(c, from);
+	const Type* t = type_of(c, to);
+	// Number literals are loaded as what they are used as
+	bool literal = node->node_type == NODE_INT || (node->node_type == NODE_UNARY && ((AST_Unary*) node)->expr->node_type == NODE_INT
+		&& strcmp(((AST_Unary*) node)->op, "-") == 0 && !lowering_call(c->lower, node));
+	if (literal && !depth && !wanted && t->kind == TYPE_KIND_FLOAT) {
+		int reg = new_register(c);
+		load_float(c, reg, literal_slot(c, node, to).f);
+		return reg;
+	}
+	if (wanted > depth) {
+		// A value passed for a pointer
+		Place place;
+		if (wanted == depth + 1 && place_of(c, slot, &place)) {
+			if (place.in_register) {
+				unsupported(c, node, "This has no address");
+				return place.reg;
+			}
+			return address(c, place);
+		}
+		int value = expr(c, slot);
+		if (is_aggregate(c, have) && wanted == depth + 1) return value;
+		int reg = new_register(c);
+		emit_x(c, OP_LOCAL, reg, new_memory(c, 1));
+		emit(c, OP_STORE, reg, value, 0);
+		return reg;
+	}
+	int reg = expr(c, slot);
+	TypeId at = have;
+	for (int i = 0; i < depth - wanted; i++) {
+		TypeId next = pointee(c, at);
+		// Structs and arrays are pointers to them anyway
+		if (!is_aggregate(c, next)) {
+			int loaded = new_register(c);
+			emit(c, OP_LOAD, loaded, reg, 0);
+			reg = loaded;
+		}
+		at = next;
+	}
+	if (wanted) return reg;
+	bool from_float = f->kind == TYPE_KIND_FLOAT;
+	if (t->kind == TYPE_KIND_FLOAT && (f->kind == TYPE_KIND_SINT || f->kind == TYPE_KIND_UINT || f->kind == TYPE_KIND_BOOL)) {
+		int converted = new_register(c);
+		emit(c, f->kind == TYPE_KIND_UINT? OP_UTOF : OP_ITOF, converted, reg, 0);
+		wrap(c, converted, to);
+		return converted;
+	}
+	if (t->kind == TYPE_KIND_FLOAT && from_float && t->bits < f->bits) {
+		int converted = new_register(c);
+		emit(c, OP_F32, converted, reg, 0);
+		return converted;
+	}
+	int64_t size = static_size(c, from);
+	if (t->kind == TYPE_KIND_ARRAY && f->kind == TYPE_KIND_ARRAY && size >= 0 && static_size(c, to) < 0) {
+		if (f->count != 1) {
+			unsupported(c, node, "A value of type %s can't be used as %s yet", type_name(c->table, have), type_name(c->table, want));
+			return reg;
+		}
+		int view = new_aggregate(c, to);
+		emit(c, OP_STORE, view, reg, VIEW_DATA);
+		int n = new_register(c);
+		load_int(c, n, size);
+		emit(c, OP_STORE, view, n, VIEW_LEN);
+		return view;
+	}
+	return reg;
+}
+
+/// Whether an instruction only writes r[a]
+static bool writes_a(Opcode op) {
+	return (op >= OP_MOVE && op <= OP_MATH && op != OP_STORE && op != OP_STOREX && (op < OP_COPY || op > OP_ZERON)) || op == OP_LEN;
+}
+
+static void expr_to(Compiler* c, AST_Node* const* slot, TypeId want, int to) {
+	int top = c->top;
+	if (top <= to) c->top = to + 1;
+	int start = here(c);
+	int reg = expr_as(c, slot, want);
+	c->top = top > to? top : to + 1;
+	if (reg == to) return;
+	// A temporary the code just worked out, with no jumps, can be worked out where it goes instead
+	Function* f = current(c);
+	bool straight = here(c) > start && reg >= top;
+	for (int i = start; straight && i < here(c); i++) straight = f->code[i].op < OP_JMP || f->code[i].op > OP_JFGE;
+	Instr* last = straight? &f->code[here(c) - 1] : NULL;
+	if (last && last->a == reg && writes_a(last->op)) last->a = (uint16_t) to;
+	else emit(c, OP_MOVE, to, reg, 0);
+}
+
+// === Statements ===
+
+static void statement(Compiler* c, AST_Node** slot);
+
+static void block(Compiler* c, AST_Block* body) {
+	int top = c->top;
+	int64_t memory = c->memory;
+	for (int i = 0; i < arrlen(body->body); i++) statement(c, &body->body[i]);
+	c->top = top;
+	c->memory = memory;
+}
+
+/// The zero of a type at a place, with the defaults of struct fields
+static void zero_value(Compiler* c, Place place) {
+	TypeId type = strip_mutable(c, place.type);
+	const Type* t = type_of(c, type);
+	if (t->kind == TYPE_KIND_STRUCT) {
+		const AST_Struct* decl = (const AST_Struct*) t->decl;
+		int64_t offset = place.offset;
+		for (int f = 0; f < shlen(decl->fields); f++) {
+			AST_Field* field = decl->fields[f].value;
+			Place at = { field_type(c, field), false, place.reg, place.index, offset };
+			int top = c->top;
+			if (field->default_value) store(c, at, expr_as(c, &field->default_value, at.type));
+			else zero_value(c, at);
+			c->top = top;
+			offset += slots_of(c, at.type);
+		}
+		return;
+	}
+	if (is_aggregate(c, type)) {
+		zero_slots(c, address(c, place), slots_of(c, type));
+		return;
+	}
+	int zero = new_register(c);
+	emit_x(c, OP_LOADI, zero, 0);
+	store(c, place, zero);
+}
+
+/// A register for a variable, pointing at memory of its own if it needs it
+static Place new_variable(Compiler* c, SymbolId id, TypeId type) {
+	int reg = new_register(c);
+	c->regs[id] = reg;
+	if (!is_aggregate(c, type) && !c->boxed[id]) return in_register(reg, type);
+	emit_x(c, OP_LOCAL, reg, new_memory(c, slots_of(c, type)));
+	return in_memory(reg, type);
+}
+
+static void var_decl(Compiler* c, AST_VarDecl* var) {
+	SymbolId id = declared(c, &var->name);
+	TypeId type = typecheck_symbol_type(c->check, id);
+	if (!supported(c, type, (AST_Node*) var)) return;
+	Place place = new_variable(c, id, type);
+	int top = c->top;
+	int64_t memory = c->memory;
+	if (var->value && place.in_register) expr_to(c, &var->value, type, place.reg);
+	else if (var->value) store(c, place, expr_as(c, &var->value, type));
+	else if (var->init != INIT_UNINITIALIZED) zero_value(c, place);
+	c->top = top;
+	c->memory = memory;
+}
+
+static void assignment(Compiler* c, AST_Node* node) {
+	AST_Node** dests;
+	AST_Node** srcs;
+	int n_srcs;
+	if (node->node_type == NODE_ASSIGN) {
+		AST_AssignChain* chain = (AST_AssignChain*) node;
+		dests = chain->dest_exprs;
+		srcs = &chain->src_expr;
+		n_srcs = 1;
+	}
+	else {
+		AST_AssignParallel* parallel = (AST_AssignParallel*) node;
+		dests = parallel->dest_exprs;
+		srcs = parallel->src_exprs;
+		n_srcs = arrlen(parallel->src_exprs);
+	}
+	int n = arrlen(dests);
+	Place place;
+	if (n == 1 && n_srcs == 1) {
+		if (!destination(c, &dests[0], &place)) return;
+		if (place.in_register) expr_to(c, &srcs[0], place.type, place.reg);
+		else store(c, place, expr_as(c, &srcs[0], place.type));
+		return;
+	}
+	// Every value is worked out before any is assigned, so 'a, b = b, a' swaps
+	int values[64];
+	if (n > 64) {
+		unsupported(c, node, "Only up to 64 values can be assigned at once");
+		return;
+	}
+	for (int i = 0; i < n_srcs; i++) {
+		TypeId type = value_type(c, type_at(c, &dests[i]));
+		if (dests[i]->node_type == NODE_REREFERENCE) type = type_at(c, &dests[i]);
+		int value = expr_as(c, &srcs[i], type);
+		if (is_aggregate(c, type)) values[i] = own_copy(c, value, type);
+		else {
+			values[i] = new_register(c);
+			emit(c, OP_MOVE, values[i], value, 0);
+		}
+	}
+	for (int i = 0; i < n; i++) {
+		if (destination(c, &dests[i], &place)) store(c, place, values[n_srcs == 1? 0 : i]);
+	}
+}
+
+static void op_assign(Compiler* c, AST_OpAssign* node) {
+	const LoweredCall* call = lowering_call(c->lower, (AST_Node*) node);
+	Place place;
+	if (!destination(c, &node->dest_expr, &place)) return;
+	if (call) {
+		store(c, place, call_lowered(c, call, (AST_Node*) node));
+		return;
+	}
+	const char* op = node->op;
+	TypeId type = place.type;
+	const Type* t = type_of(c, value_type(c, type));
+	bool is_float = t->kind == TYPE_KIND_FLOAT, is_unsigned = t->kind == TYPE_KIND_UINT;
+	if (op[1] || !strchr("+-*/%^", op[0]) || (t->kind != TYPE_KIND_SINT && !is_unsigned && !is_float)) {
+		unsupported(c, (AST_Node*) node, "Operator '%s=' on values of type %s can't be compiled yet", op, type_name(c->table, type));
+		return;
+	}
+	int value = load(c, place);
+	int to = place.in_register? place.reg : value;
+	// Small constants are added in the instruction
+	AST_Node* src = node->src_expr;
+	if (!is_float && (op[0] == '+' || op[0] == '-') && src->node_type == NODE_INT && ((AST_Int*) src)->value <= INT16_MAX) {
+		int64_t k = (int64_t) ((AST_Int*) src)->value;
+		emit(c, OP_ADDK, to, value, (uint16_t) (int16_t) (op[0] == '+'? k : -k));
+	}
+	else {
+		int rhs = expr_as(c, &node->src_expr, type);
+		Opcode opcode;
+		switch (op[0]) {
+			case '+': opcode = is_float? OP_FADD : OP_ADD; break;
+			case '-': opcode = is_float? OP_FSUB : OP_SUB; break;
+			case '*': opcode = is_float? OP_FMUL : OP_MUL; break;
+			case '/': opcode = is_float? OP_FDIV : is_unsigned? OP_UDIV : OP_DIV; break;
+			case '%': opcode = is_float? OP_FMOD : is_unsigned? OP_UMOD : OP_MOD; break;
+			default: opcode = is_float? OP_FPOW : is_unsigned? OP_UPOW : OP_POW; break;
+		}
+		emit(c, opcode, to, value, rhs);
+	}
+	wrap(c, to, type);
+	if (!place.in_register) store(c, place, to);
+}
+
+static void if_statement(Compiler* c, AST_IfStatement* node) {
+	int* no = NULL;
+	branch(c, &node->condition, false, &no);
+	block(c, node->body);
+	if (node->alternative) {
+		int done = emit_x(c, OP_JMP, 0, 0);
+		patch_all(c, no, here(c));
+		statement(c, &node->alternative);
+		patch(c, done, here(c));
+	}
+	else patch_all(c, no, here(c));
+	arrfree(no);
+}
+
+/// The body of a loop, with 'skip' going to `next` once it is known
+/// The body of a loop, which gives back what each iteration took of the temporary allocator
+/// if escape analysis says it can: where its skips go on to the next iteration
+static int loop_body(Compiler* c, AST_Block* body, const AST_Name* label) {
+	Loop loop = { label? label->name : NULL, NULL, NULL };
+	arrput(c->loops, loop);
+	int mark = -1;
+	if (c->esc && escape_iteration_releases(c->esc, body)) {
+		mark = new_register(c);
+		new_register(c);
+		emit(c, OP_MARK, mark, 0, 0);
+	}
+	block(c, body);
+	int next = here(c);
+	if (mark >= 0) emit(c, OP_RELEASE, mark, 0, 0);
+	return next;
+}
+
+/// Ends the loop begun last, with its skips going to `next` and its breaks to here
+static void end_loop(Compiler* c, int next) {
+	Loop loop = arrpop(c->loops);
+	patch_all(c, loop.skips, next);
+	patch_all(c, loop.breaks, here(c));
+	arrfree(loop.skips);
+	arrfree(loop.breaks);
+}
+
+static void while_loop(Compiler* c, AST_WhileLoop* node) {
+	// The condition is at the bottom, so each iteration takes one jump
+	int enter = emit_x(c, OP_JMP, 0, 0);
+	int body = here(c);
+	int next = loop_body(c, node->body, NULL);
+	patch(c, enter, here(c));
+	c->line = node->start_line;
+	branch_to(c, &node->condition, true, body);
+	end_loop(c, next);
+}
+
+/// The step of a range, if it is a literal
+static bool literal_step(const AST_ForRange* range, int64_t* step) {
+	*step = 1;
+	if (!range->step) return true;
+	const AST_Node* node = range->step;
+	bool negative = node->node_type == NODE_UNARY && strcmp(((AST_Unary*) node)->op, "-") == 0;
+	if (negative) node = ((AST_Unary*) node)->expr;
+	if (node->node_type != NODE_INT) return false;
+	*step = negative? -(int64_t) ((AST_Int*) node)->value : (int64_t) ((AST_Int*) node)->value;
+	return *step != 0;
+}
+
+/// Jumps back to `target` if `counter` hasn't gone past `end`, going up or down
+static void loop_back(Compiler* c, int counter, int end, bool up, bool inclusive, int target) {
+	emit(c, up? (inclusive? OP_JLE : OP_JLT) : (inclusive? OP_JGE : OP_JGT), counter, end, 0);
+	patch(c, emit_x(c, OP_JMP, 0, 0), target);
+}
+
+static void for_range(Compiler* c, AST_ForLoop* loop, AST_ForRange* range) {
+	SymbolId id = declared(c, &range->name);
+	TypeId type = id? type_unqualified(c->table, typecheck_symbol_type(c->check, id)) : TYPE_INT;
+	TypeKind kind = type_of(c, type)->kind;
+	if (kind != TYPE_KIND_SINT && kind != TYPE_KIND_UINT) type = TYPE_INT;
+	// A variable the body assigns to is a copy of the counter, as each iteration starts from the next value
+	bool copied = !id || c->rebound[id] || c->boxed[id];
+	int counter = new_register(c);
+	expr_to(c, &range->start, type, counter);
+	int end = -1;
+	if (range->end) {
+		end = new_register(c);
+		expr_to(c, &range->end, type, end);
+	}
+	int64_t step;
+	bool literal = literal_step(range, &step);
+	int by = -1, zero = -1;
+	if (!literal || step < INT16_MIN || step > INT16_MAX) {
+		by = new_register(c);
+		expr_to(c, &range->step, TYPE_INT, by);
+		if (!literal) {
+			zero = new_register(c);
+			emit_x(c, OP_LOADI, zero, 0);
+		}
+	}
+	Place var = { 0 };
+	if (id && copied) var = new_variable(c, id, type);
+	else if (id) c->regs[id] = counter;
+	int enter = emit_x(c, OP_JMP, 0, 0);
+	int body = here(c);
+	if (id && copied) store(c, var, counter);
+	int next = loop_body(c, loop->body, loop->label);
+	c->line = loop->start_line;
+	if (by < 0) emit(c, OP_ADDK, counter, counter, (uint16_t) (int16_t) step);
+	else emit(c, OP_ADD, counter, counter, by);
+	wrap(c, counter, type);
+	patch(c, enter, here(c));
+	if (!range->end) patch(c, emit_x(c, OP_JMP, 0, 0), body);
+	else if (literal) loop_back(c, counter, end, step > 0, range->is_inclusive, body);
+	else {
+		// Which way it goes is only known when it runs
+		emit(c, OP_JLE, by, zero, 0);
+		int down = emit_x(c, OP_JMP, 0, 0);
+		loop_back(c, counter, end, true, range->is_inclusive, body);
+		int done = emit_x(c, OP_JMP, 0, 0);
+		patch(c, down, here(c));
+		loop_back(c, counter, end, false, range->is_inclusive, body);
+		patch(c, done, here(c));
+	}
+	end_loop(c, next);
+}
+
+static void for_simple(Compiler* c, AST_ForLoop* loop, AST_ForSimple* simple) {
+	SymbolId id = declared(c, &simple->name);
+	TypeId type = value_type(c, type_at(c, &simple->iterable));
+	const Type* t = type_of(c, type);
+	if (!id || t->kind != TYPE_KIND_ARRAY || t->count != 1) {
+		unsupported(c, (AST_Node*) simple, "Only named loops over arrays of one dimension can be compiled yet");
+		return;
+	}
+	TypeId element_type = typecheck_symbol_type(c->check, id);
+	if (!supported(c, element_type, (AST_Node*) simple)) return;
+	int array = expr_as(c, &simple->iterable, type);
+	int64_t size = static_size(c, type);
+	int data = array, length = new_register(c);
+	if (size >= 0) load_int(c, length, size);
+	else {
+		data = new_register(c);
+		emit(c, OP_LOAD, data, array, VIEW_DATA);
+		emit(c, OP_LOAD, length, array, VIEW_LEN);
+	}
+	int64_t element_slots = slots_of(c, t->base);
+	int index = new_register(c);
+	emit_x(c, OP_LOADI, index, 0);
+	Place var = new_variable(c, id, element_type);
+	int enter = emit_x(c, OP_JMP, 0, 0);
+	int body = here(c);
+	// The variable is a copy of the element
+	int top = c->top;
+	Place element = { t->base, false, data, element_slots == 1? index : scale(c, index, element_slots), 0 };
+	store(c, var, load(c, element));
+	c->top = top;
+	int next = loop_body(c, loop->body, loop->label);
+	c->line = loop->start_line;
+	emit(c, OP_ADDK, index, index, 1);
+	patch(c, enter, here(c));
+	loop_back(c, index, length, true, false, body);
+	end_loop(c, next);
+}
+
+static void for_loop(Compiler* c, AST_ForLoop* loop) {
+	// Parallel loops run one iteration after the other, which is one of the orders they may run in
+	if (arrlen(loop->iterables) != 1) {
+		unsupported(c, (AST_Node*) loop, "Loops over more than one range can't be compiled yet");
+		return;
+	}
+	AST_Node* iterable = loop->iterables[0];
+	int top = c->top;
+	int64_t memory = c->memory;
+	if (iterable->node_type == NODE_FOR_RANGE) for_range(c, loop, (AST_ForRange*) iterable);
+	else if (iterable->node_type == NODE_FOR_SIMPLE) for_simple(c, loop, (AST_ForSimple*) iterable);
+	else unsupported(c, iterable, "This loop can't be compiled yet");
+	c->top = top;
+	c->memory = memory;
+}
+
+static void jump(Compiler* c, AST_Node* node, const AST_Name* label, bool is_break) {
+	for (int i = arrlen(c->loops) - 1; i >= 0; i--) {
+		if (label && (!c->loops[i].label || strcmp(c->loops[i].label, label->name) != 0)) continue;
+		int at = emit_x(c, OP_JMP, 0, 0);
+		if (is_break) arrput(c->loops[i].breaks, at);
+		else arrput(c->loops[i].skips, at);
+		return;
+	}
+	if (label) unsupported(c, node, "There is no loop named '%s' around this", label->name);
+	else unsupported(c, node, "There is no loop around this");
+}
+
+/// Frees what escape analysis says is freed where the function is left
+static void exit_frees(Compiler* c, const AST_Node* exit) {
+	int n = 0;
+	const SymbolId* frees = c->esc? escape_frees(c->esc, exit, &n) : NULL;
+	for (int i = 0; i < n; i++) {
+		Place place = { typecheck_symbol_type(c->check, frees[i]), !c->boxed[frees[i]], c->regs[frees[i]], -1, 0 };
+		if (place.reg >= 0) emit(c, OP_FREE, load(c, place), 0, 0);
+	}
+}
+
+static void return_statement(Compiler* c, AST_Return* node) {
+	if (!node->value) {
+		exit_frees(c, (AST_Node*) node);
+		emit(c, OP_RETV, 0, 0, 0);
+		return;
+	}
+	// The value is worked out before anything it may use is freed
+	int value = expr_as(c, &node->value, c->ret_type);
+	exit_frees(c, (AST_Node*) node);
+	emit(c, OP_RET, value, 0, 0);
+}
+
+/// Stops the program with a failure, and its message if it has one
+static void failure(Compiler* c, AST_Node* const* message, Failure kind) {
+	int reg = 0;
+	if (*message && value_kind(c, type_at(c, message)) != TYPE_KIND_STRING) unsupported(c, *message, "Only strings can be messages yet");
+	else if (*message) reg = expr(c, message);
+	emit(c, OP_FAIL, reg, kind, *message != NULL);
+}
+
+static PrintKind print_kind(Compiler* c, TypeId type, const AST_Node* at) {
+	switch (type_of(c, value_type(c, type))->kind) {
+		case TYPE_KIND_SINT:
+		case TYPE_KIND_ENUM:
+			return PRINT_INT;
+		case TYPE_KIND_UINT: return PRINT_UINT;
+		case TYPE_KIND_FLOAT: return PRINT_FLOAT;
+		case TYPE_KIND_BOOL: return PRINT_BOOL;
+		case TYPE_KIND_STRING: return PRINT_STRING;
+		case TYPE_KIND_RUNE: return PRINT_RUNE;
+		default:
+			unsupported(c, at, "Values of type %s can't be printed yet", type_name(c->table, type));
+			return PRINT_INT;
+	}
+}
+
+static void print(Compiler* c, AST_FuncCall* call) {
+	int space = constant(c, (Slot) { .p = (void*) intern_string(c, " ") });
+	for (int i = 0; i < arrlen(call->pos_args); i++) {
+		AST_Node* const* arg = &call->pos_args[i];
+		TypeId type = value_type(c, type_at(c, arg));
+		const Type* t = type_of(c, type);
+		int top = c->top;
+		if (i) emit_x(c, OP_PRINTK, 0, space);
+		if (t->kind != TYPE_KIND_ARRAY) {
+			emit(c, OP_PRINT, expr_as(c, arg, type), 0, print_kind(c, type, *arg));
+			c->top = top;
+			continue;
+		}
+		if (t->count != 1 || is_aggregate(c, t->base)) {
+			unsupported(c, *arg, "Only arrays of one dimension, of numbers, strings and runes, can be printed yet");
+			continue;
+		}
+		int array = expr_as(c, arg, type);
+		int64_t size = static_size(c, type);
+		int data = array, length = new_register(c);
+		if (size >= 0) load_int(c, length, size);
+		else {
+			data = new_register(c);
+			emit(c, OP_LOAD, data, array, VIEW_DATA);
+			emit(c, OP_LOAD, length, array, VIEW_LEN);
+		}
+		emit(c, OP_PRINTA, data, length, print_kind(c, t->base, *arg));
+		c->top = top;
+	}
+	emit_x(c, OP_PRINTK, 0, constant(c, (Slot) { .p = (void*) intern_string(c, "\n") }));
+}
+
+static void statement(Compiler* c, AST_Node** slot) {
+	AST_Node* node = *slot;
+	int top = c->top;
+	int64_t memory = c->memory;
+	c->line = node->start_line;
+	switch (node->node_type) {
+		case NODE_BLOCK:
+			block(c, (AST_Block*) node);
+			break;
+		case NODE_VAR_DECL:
+			// What is declared stays until the end of the block
+			var_decl(c, (AST_VarDecl*) node);
+			return;
+		case NODE_ASSIGN:
+		case NODE_ASSIGN_MANY:
+			assignment(c, node);
+			break;
+		case NODE_OP_ASSIGN:
+			op_assign(c, (AST_OpAssign*) node);
+			break;
+		case NODE_IF_STMT:
+			if_statement(c, (AST_IfStatement*) node);
+			break;
+		case NODE_WHILE_LOOP:
+			while_loop(c, (AST_WhileLoop*) node);
+			break;
+		case NODE_FOR_LOOP:
+			for_loop(c, (AST_ForLoop*) node);
+			break;
+		case NODE_RETURN:
+			return_statement(c, (AST_Return*) node);
+			break;
+		case NODE_BREAK:
+			jump(c, node, ((AST_Break*) node)->label, true);
+			break;
+		case NODE_SKIP:
+			jump(c, node, ((AST_Skip*) node)->label, false);
+			break;
+		case NODE_FAIL:
+			failure(c, &((AST_Fail*) node)->message, FAILURE_FAIL);
+			break;
+		case NODE_ASSERT: {
+			AST_Assert* assert = (AST_Assert*) node;
+			int* held = NULL;
+			branch(c, &assert->value, true, &held);
+			failure(c, &assert->message, FAILURE_ASSERT);
+			patch_all(c, held, here(c));
+			arrfree(held);
+		} break;
+		case NODE_FUNC_CALL: {
+			AST_FuncCall* call = (AST_FuncCall*) node;
+			if (is_builtin(c, call, "print")) print(c, call);
+			else if (is_builtin(c, call, "free") && arrlen(call->pos_args) == 1) emit(c, OP_FREE, expr(c, &call->pos_args[0]), 0, 0);
+			else expr(c, slot);
+		} break;
+		// Contracts are what analyses know; '#run' and constants are done at compile time
+		case NODE_CONTRACT:
+		case NODE_RUN:
+		case NODE_CONST:
+			break;
+		default:
+			if (node->node_type >= NODE_BINOP && node->node_type <= NODE_FIELD_ACCESS) expr(c, slot);
+			else unsupported(c, node, "This statement can't be compiled yet");
+	}
+	c->top = top;
+	c->memory = memory;
+}
+
+// === Functions ===
+
+static WalkAction prescan_pre(AST_Node** slot, void* ctx) {
+	Compiler* c = ctx;
+	AST_Node* node = *slot;
+	AST_Node** dests = NULL;
+	int n = 0;
+	switch (node->node_type) {
+		case NODE_ASSIGN:
+			dests = ((AST_AssignChain*) node)->dest_exprs;
+			n = arrlen(dests);
+			break;
+		case NODE_ASSIGN_MANY:
+			dests = ((AST_AssignParallel*) node)->dest_exprs;
+			n = arrlen(dests);
+			break;
+		case NODE_OP_ASSIGN:
+			dests = &((AST_OpAssign*) node)->dest_expr;
+			n = 1;
+			break;
+		case NODE_REREFERENCE: {
+			// Scalars whose address is taken are kept in memory
+			AST_Reref* reref = (AST_Reref*) node;
+			if (reref->target->node_type != NODE_QUALNAME || reref->levels <= pointer_depth(c, type_at(c, &reref->target))) break;
+			ResolvedName found = resolution_lookup(c->res, &reref->target);
+			if (found.symbol && found.n_parts == arrlen(((AST_Qualname*) reref->target)->parts)) c->boxed[found.symbol] = true;
+		} break;
+		default: break;
+	}
+	for (int i = 0; i < n; i++) {
+		AST_Node* const* dest = &dests[i];
+		if ((*dest)->node_type == NODE_REREFERENCE) dest = (AST_Node* const*) &((AST_Reref*) *dest)->target;
+		if ((*dest)->node_type != NODE_QUALNAME) continue;
+		ResolvedName found = resolution_lookup(c->res, dest);
+		if (found.symbol && found.n_parts == arrlen(((AST_Qualname*) *dest)->parts)) c->rebound[found.symbol] = true;
+	}
+	return WALK_CONTINUE;
+}
+
+static int add_function(Compiler* c, const char* name) {
+	Function f = { 0 };
+	size_t length = strlen(name);
+	char* copy = malloc(length + 1);
+	memcpy(copy, name, length + 1);
+	f.name = copy;
+	arrput(c->program->functions, f);
+	return (int) arrlen(c->program->functions) - 1;
+}
+
+static int need_function(Compiler* c, SymbolId id, const AST_Node* at) {
+	if (c->functions[id]) return c->functions[id] - 1;
+	const AST_FuncDef* def = (const AST_FuncDef*) resolution_symbol(c->res, id)->decl;
+	if (!def->body) {
+		unsupported(c, at, "'%s' has no body to compile", def->name->name);
+		c->functions[id] = -1 + 1;
+		return -1;
+	}
+	int index = add_function(c, def->name->name);
+	c->functions[id] = index + 1;
+	arrput(c->queue, id);
+	arrput(c->queued, index);
+	return index;
+}
+
+/// Compiles the body of a function, or of a test (with `id` 0)
+static void compile_function(Compiler* c, SymbolId id, int index, AST_Block* body) {
+	const AST_FuncDef* def = id? (const AST_FuncDef*) resolution_symbol(c->res, id)->decl : NULL;
+	c->func = index;
+	c->top = 0;
+	c->memory = 0;
+	c->ret_type = def && def->ret_type? typecheck_type_of(c->check, def->ret_type) : TYPE_VOID;
+	c->line = body->start_line;
+	int n_symbols = resolution_symbol_count(c->res) + 1;
+	memset(c->boxed, 0, n_symbols);
+	memset(c->rebound, 0, n_symbols);
+	ast_walk_iterative((AST_Node**) &body, &(AST_Visitor) { prescan_pre, NULL, c });
+	Function* f = current(c);
+	f->returns_value = c->ret_type != TYPE_VOID;
+	if (def) c->line = def->start_line;
+	if (f->returns_value) supported(c, c->ret_type, (AST_Node*) def);
+	// Arguments come in the first registers
+	int n_params = def? shlen(def->params) : 0;
+	f->n_params = n_params;
+	for (int p = 0; p < n_params; p++) {
+		SymbolId param = declared(c, &def->params[p].value->name);
+		c->regs[param] = new_register(c);
+	}
+	for (int p = 0; p < n_params; p++) {
+		SymbolId param = declared(c, &def->params[p].value->name);
+		TypeId type = typecheck_symbol_type(c->check, param);
+		if (!supported(c, type, (AST_Node*) def->params[p].value)) continue;
+		// Structs and arrays that may change are copied, as they are passed by value
+		bool copied = is_aggregate(c, type) && (type_of(c, type)->kind == TYPE_KIND_MUTABLE || c->rebound[param]);
+		if (!copied && !(c->boxed[param] && !is_aggregate(c, type))) continue;
+		int argument = c->regs[param];
+		store(c, new_variable(c, param, type), argument);
+	}
+	block(c, body);
+	int n = arrlen(body->body);
+	if (!n || body->body[n - 1]->node_type != NODE_RETURN) {
+		exit_frees(c, (AST_Node*) body);
+		emit(c, OP_RETV, 0, 0, 0);
+	}
+}
+
+// === Program ===
+
+Program bytecode_compile(AST_Module* module, Resolution res, TypeCheck check, TypeTable table, Lowering lower,
+		EscapeAnalysis esc, Bounds bounds) {
+	Program program = calloc(1, sizeof(struct _program));
+	size_t length = strlen(module->src_file);
+	program->src_file = malloc(length + 1);
+	memcpy(program->src_file, module->src_file, length + 1);
+	program->main = -1;
+	Compiler c = {
+		.module = module, .res = res, .check = check, .table = table, .lower = lower, .esc = esc, .bounds = bounds,
+		.program = program,
+	};
+	int n_symbols = resolution_symbol_count(res) + 1;
+	c.functions = calloc(n_symbols, sizeof(int));
+	c.globals = calloc(n_symbols, sizeof(int64_t));
+	c.regs = malloc(n_symbols * sizeof(int));
+	for (int i = 0; i < n_symbols; i++) c.regs[i] = -1;
+	arrsetlen(c.boxed, n_symbols);
+	arrsetlen(c.rebound, n_symbols);
+
+	for (int i = 0; i < shlen(module->scope); i++) {
+		AST_Node* item = module->scope[i].value;
+		if (item->node_type != NODE_FUNC_DEF || strcmp(((AST_FuncDef*) item)->name->name, "main") != 0) continue;
+		SymbolId id = declared(&c, &((AST_FuncDef*) item)->name);
+		if (id) program->main = need_function(&c, id, item);
+		if (shlen(((AST_FuncDef*) item)->params)) unsupported(&c, item, "'main' can't take parameters yet");
+	}
+	for (int i = 0; i < arrlen(module->tests); i++) {
+		AST_Test* test = module->tests[i];
+		const char* description = test->description? test->description->value : "";
+		int index = add_function(&c, "test");
+		arrput(program->tests, index);
+		size_t n = strlen(description);
+		char* copy = malloc(n + 1);
+		memcpy(copy, description, n + 1);
+		arrput(program->test_names, copy);
+		compile_function(&c, 0, index, test->body);
+	}
+	for (int i = 0; i < arrlen(c.queue); i++) {
+		const AST_FuncDef* def = (const AST_FuncDef*) resolution_symbol(res, c.queue[i])->decl;
+		compile_function(&c, c.queue[i], c.queued[i], def->body);
+	}
+
+	int n_errors = arrlen(c.errors);
+	report_errors(c.errors, n_errors);
+	for (int i = 0; i < n_errors; i++) free(c.errors[i].message);
+	arrfree(c.errors);
+	free(c.functions);
+	free(c.globals);
+	free(c.regs);
+	arrfree(c.boxed);
+	arrfree(c.rebound);
+	arrfree(c.queue);
+	arrfree(c.queued);
+	arrfree(c.loops);
+	hmfree(c.sizes);
+	if (n_errors) {
+		program_destroy(program);
+		return NULL;
+	}
+	return program;
+}
+
+void program_destroy(Program program) {
+	for (int i = 0; i < arrlen(program->functions); i++) {
+		Function* f = &program->functions[i];
+		free((char*) f->name);
+		arrfree(f->code);
+		arrfree(f->lines);
+		arrfree(f->constants);
+	}
+	arrfree(program->functions);
+	for (int i = 0; i < arrlen(program->strings); i++) {
+		free((char*) program->strings[i]->data);
+		free(program->strings[i]);
+	}
+	arrfree(program->strings);
+	for (int i = 0; i < arrlen(program->test_names); i++) free(program->test_names[i]);
+	arrfree(program->test_names);
+	arrfree(program->tests);
+	arrfree(program->globals);
+	free(program->src_file);
+	free(program);
+}
+
+const char* program_src_file(Program program) {
+	return program->src_file;
+}
+
+int program_function_count(Program program) {
+	return arrlen(program->functions);
+}
+
+const Function* program_function(Program program, int i) {
+	return &program->functions[i];
+}
+
+int program_main(Program program) {
+	return program->main;
+}
+
+Slot* program_globals(Program program) {
+	return program->globals;
+}
+
+int program_test_count(Program program) {
+	return arrlen(program->tests);
+}
+
+int program_test(Program program, int i, const char** description) {
+	if (description) *description = program->test_names[i];
+	return program->tests[i];
+}
+
+int program_instruction_count(Program program) {
+	int n = 0;
+	for (int i = 0; i < arrlen(program->functions); i++) n += arrlen(program->functions[i].code);
+	return n;
+}
+
+const char* opcode_name(Opcode op) {
+	static const char* const names[] = {
+#define OPCODE_NAME(name) #name,
+		OPCODES(OPCODE_NAME)
+#undef OPCODE_NAME
+	};
+	return op < OP_COUNT? names[op] : "?";
+}
+
+void program_disassemble(FILE* out, Program program) {
+	for (int i = 0; i < arrlen(program->functions); i++) {
+		const Function* f = &program->functions[i];
+		fprintf(out, "%s#%d: %d params, %d registers, %d slots of memory, %d constants\n", f->name, i, f->n_params,
+			f->n_registers, f->n_memory, (int) arrlen(f->constants));
+		for (int j = 0; j < arrlen(f->code); j++) {
+			Instr instr = f->code[j];
+			fprintf(out, "%5d  %4d  %-10s", j, f->lines[j], opcode_name(instr.op));
+			switch (instr.op) {
+				case OP_LOADK:
+				case OP_LOADI:
+				case OP_LOCAL:
+				case OP_GLOBAL:
+				case OP_CHECKI:
+				case OP_NEW:
+				case OP_TNEW:
+				case OP_PRINTK:
+					fprintf(out, " r%d %d", instr.a, instr.sx);
+					break;
+				case OP_CALL:
+					fprintf(out, " r%d %s#%d", instr.a, instr.ux < (uint32_t) arrlen(program->functions)? program->functions[instr.ux].name : "?", instr.sx);
+					break;
+				case OP_JMP:
+					fprintf(out, " -> %d", j + 1 + instr.sx);
+					break;
+				case OP_JT:
+				case OP_JF:
+					fprintf(out, " r%d -> %d", instr.a, j + 1 + instr.sx);
+					break;
+				case OP_LOAD:
+				case OP_STORE:
+				case OP_LEA:
+				case OP_COPY:
+				case OP_ADDK:
+				case OP_MULK:
+				case OP_SEXT:
+				case OP_ZEXT:
+				case OP_MATH:
+				case OP_PRINT:
+				case OP_PRINTA:
+				case OP_FAIL:
+					fprintf(out, " r%d r%d %d", instr.a, instr.b, instr.op == OP_ADDK? (int16_t) instr.c : instr.c);
+					break;
+				case OP_ZERO:
+					fprintf(out, " r%d %d", instr.a, instr.b);
+					break;
+				case OP_MOVE:
+				case OP_NEG:
+				case OP_FNEG:
+				case OP_F32:
+				case OP_ITOF:
+				case OP_UTOF:
+				case OP_FTOI:
+				case OP_FTOU:
+				case OP_BOOL:
+				case OP_FBOOL:
+				case OP_NOT:
+				case OP_BNOT:
+				case OP_ABS:
+				case OP_FABS:
+				case OP_LEN:
+				case OP_ZERON:
+				case OP_JLT:
+				case OP_JLE:
+				case OP_JGT:
+				case OP_JGE:
+				case OP_JEQ:
+				case OP_JNE:
+				case OP_JFLT:
+				case OP_JFLE:
+				case OP_JFGT:
+				case OP_JFGE:
+				case OP_CHECK:
+					fprintf(out, " r%d r%d", instr.a, instr.b);
+					break;
+				case OP_RET:
+				case OP_FREE:
+				case OP_MARK:
+				case OP_RELEASE:
+					fprintf(out, " r%d", instr.a);
+					break;
+				case OP_RETV:
+					break;
+				default:
+					fprintf(out, " r%d r%d r%d", instr.a, instr.b, instr.c);
+			}
+			fputc('\n', out);
+		}
+	}
+}
@@ -0,0 +1,164 @@
+#pragma once
+// The bytecode: a module that passed every check, compiled for the VM (vm.h) to run without
+// a C compiler. Each function is an array of fixed-width instructions over its own
+// registers, with a pool of the constants they load.
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "ast.h"
+#include "resolve.h"
+#include "typecheck.h"
+#include "types.h"
+#include "lower.h"
+#include "escape.h"
+#include "bounds.h"
+
+/// Registers, fields, elements and constants are all one slot. Structs and arrays are slots
+/// in a row in memory, and a register holding one holds a pointer to it. Integers narrower
+/// than 64 bits are kept sign- or zero-extended to 64, and F32s are F64s rounded to F32.
+typedef union {
+	int64_t i;
+	uint64_t u;
+	double f;
+	void* p;
+} Slot;
+
+/// Strings are a pointer to one of these
+typedef struct {
+	const char* data;
+	int64_t len;
+} StringValue;
+
+/// An array whose length is only known when it runs is two slots: a pointer to its
+/// elements, and how many of them there are
+enum { VIEW_DATA, VIEW_LEN, VIEW_SLOTS };
+
+/// In the comments, r is the registers, k the constants of the function, and m[x] the slots
+/// that x points to. sx is the signed 32 bits after a, and ux the same unsigned. Offsets of
+/// jumps are from the next instruction. A comparison that branches (JLT...) is followed by
+/// the JMP it takes, or steps over.
+#define OPCODES(X) \
+	X(MOVE)    /* r[a] = r[b] */ \
+	X(LOADK)   /* r[a] = k[ux] */ \
+	X(LOADI)   /* r[a].i = sx */ \
+	X(LOCAL)   /* r[a].p = the frame's memory + ux */ \
+	X(GLOBAL)  /* r[a].p = the program's globals + ux */ \
+	X(LOAD)    /* r[a] = m[r[b]][c] */ \
+	X(STORE)   /* m[r[a]][c] = r[b] */ \
+	X(LOADX)   /* r[a] = m[r[b]][r[c].i] */ \
+	X(STOREX)  /* m[r[a]][r[b].i] = r[c] */ \
+	X(LEA)     /* r[a].p = r[b].p + c slots */ \
+	X(ADDR)    /* r[a].p = r[b].p + r[c].i slots */ \
+	X(COPY)    /* c slots from m[r[b]] to m[r[a]] */ \
+	X(COPYN)   /* r[c].i slots from m[r[b]] to m[r[a]] */ \
+	X(ZERO)    /* b slots of m[r[a]] = 0 */ \
+	X(ZERON)   /* r[b].i slots of m[r[a]] = 0 */ \
+	X(ADD) X(SUB) X(MUL) X(DIV) X(MOD) X(UDIV) X(UMOD) X(POW) X(UPOW)  /* r[a].i = r[b].i op r[c].i, wrapping */ \
+	X(NEG)     /* r[a].i = -r[b].i */ \
+	X(ADDK)    /* r[a].i = r[b].i + (int16_t) c */ \
+	X(MULK)    /* r[a].i = r[b].i * c */ \
+	X(FADD) X(FSUB) X(FMUL) X(FDIV) X(FMOD) X(FPOW)  /* r[a].f = r[b].f op r[c].f */ \
+	X(FNEG)    /* r[a].f = -r[b].f */ \
+	X(F32)     /* r[a].f = (float) r[b].f */ \
+	X(SEXT)    /* r[a].i = the low c bits of r[b], sign-extended */ \
+	X(ZEXT)    /* r[a].i = the low c bits of r[b], zero-extended */ \
+	X(ITOF) X(UTOF) X(FTOI) X(FTOU)  /* r[a] = r[b] converted */ \
+	X(BOOL)    /* r[a].i = r[b].i != 0 */ \
+	X(FBOOL)   /* r[a].i = r[b].f != 0 */ \
+	X(NOT)     /* r[a].i = !r[b].i */ \
+	X(BAND) X(BOR) X(BXOR) X(SHL) X(SHR) X(USHR)  /* r[a].i = r[b].i op r[c].i */ \
+	X(BNOT)    /* r[a].i = ~r[b].i */ \
+	X(EQ) X(NE) X(LT) X(LE) X(ULT) X(ULE)  /* r[a].i = r[b].i op r[c].i */ \
+	X(FEQ) X(FNE) X(FLT) X(FLE)  /* r[a].i = r[b].f op r[c].f */ \
+	X(SEQ) X(SLT) X(SLE)  /* r[a].i = the strings r[b] op r[c] */ \
+	X(MIN) X(MAX) X(UMIN) X(UMAX) X(FMIN) X(FMAX)  /* r[a] = op(r[b], r[c]) */ \
+	X(ABS) X(FABS)  /* r[a] = |r[b]| */ \
+	X(MATH)    /* r[a].f = the Math function c of r[b].f */ \
+	X(JMP)     /* jump by sx */ \
+	X(JT) X(JF)  /* jump by sx if r[a].i is true, or false */ \
+	X(JLT) X(JLE) X(JGT) X(JGE) X(JEQ) X(JNE)  /* take the next JMP if r[a].i op r[b].i */ \
+	X(JFLT) X(JFLE) X(JFGT) X(JFGE)  /* take the next JMP if r[a].f op r[b].f */ \
+	X(CALL)    /* call function ux with the registers from r[a] for arguments; the result is put in r[a] */ \
+	X(RET)     /* return r[a] */ \
+	X(RETV)    /* return nothing */ \
+	X(CHECK)   /* fail unless 0 <= r[a].i < r[b].i */ \
+	X(CHECKI)  /* fail unless 0 <= r[a].i < ux */ \
+	X(CHECKSLICE)  /* fail unless 0 <= r[a].i <= r[b].i <= r[c].i */ \
+	X(NEW)     /* r[a].p = ux slots from the primary allocator */ \
+	X(TNEW)    /* r[a].p = ux slots from the temporary allocator, given back when the function returns */ \
+	X(FREE)    /* gives r[a].p back to the primary allocator */ \
+	X(MARK)    /* r[a], r[a + 1] = how much of the temporary allocator is taken */ \
+	X(RELEASE) /* gives back what the temporary allocator gave since the MARK of r[a], r[a + 1] */ \
+	X(LEN)     /* r[a].i = the length of the string r[b] */ \
+	X(PRINT)   /* prints r[a] as a Print kind c */ \
+	X(PRINTA)  /* prints the r[b].i elements at r[a] as a Print kind c, in brackets */ \
+	X(PRINTK)  /* prints the string k[ux] */ \
+	X(FAIL)    /* stops with the Failure b, and the message string r[a] if c */
+
+typedef enum {
+#define OPCODE_ENUM(name) OP_##name,
+	OPCODES(OPCODE_ENUM)
+#undef OPCODE_ENUM
+	OP_COUNT,
+} Opcode;
+
+typedef enum { MATH_SQRT, MATH_SIN, MATH_COS, MATH_TAN, MATH_EXP, MATH_LOG, MATH_FLOOR, MATH_CEIL } MathFunc;
+typedef enum { PRINT_INT, PRINT_UINT, PRINT_FLOAT, PRINT_BOOL, PRINT_STRING, PRINT_RUNE } PrintKind;
+typedef enum { FAILURE_FAIL, FAILURE_ASSERT } Failure;
+
+/// 8 bytes, whatever the opcode
+typedef struct {
+	uint16_t op;
+	uint16_t a;
+	union {
+		struct {
+			uint16_t b, c;
+		};
+		int32_t sx;
+		uint32_t ux;
+	};
+} Instr;
+
+typedef struct {
+	const char* name;
+	Instr ARRAY code;
+	int ARRAY lines;      // of the source, by instruction
+	Slot ARRAY constants;
+	int n_params;         // in the first registers
+	int n_registers;
+	int n_memory;         // slots for its structs and arrays, after the registers in its frame
+	bool returns_value;
+} Function;
+
+typedef struct _program* Program;
+
+/// Compiles a module that type-checked without errors, with its calls lowered: the
+/// functions reachable from 'main' and its tests, and the structs, enums and constants they
+/// use. Allocations are made where escape analysis placed them, with its implicit frees,
+/// and subscripts that bounds analysis proved in bounds aren't checked; without one of the
+/// analyses (NULL), allocations are made on the heap, or every subscript is checked.
+/// What can't be compiled yet is reported to stderr, in the order of the source, and NULL
+/// is returned. The program doesn't keep the tree.
+Program bytecode_compile(AST_Module* module, Resolution res, TypeCheck check, TypeTable table, Lowering lower,
+	EscapeAnalysis esc, Bounds bounds);
+void program_destroy(Program program);
+
+const char* program_src_file(Program program);
+int program_function_count(Program program);
+const Function* program_function(Program program, int i);
+/// The function compiled from 'main', or -1
+int program_main(Program program);
+/// The slots constants of structs and arrays are kept in, which GLOBAL points into
+Slot* program_globals(Program program);
+
+/// The functions compiled from the module's tests, in order, with their descriptions
+int program_test_count(Program program);
+int program_test(Program program, int i, const char** description);
+
+/// Instructions, over all of the functions
+int program_instruction_count(Program program);
+
+const char* opcode_name(Opcode op);
+/// Writes the functions out as text, an instruction a line
+void program_disassemble(FILE* out, Program program);
@@ -0,0 +1,175 @@
+#include <string.h>
+#include <math.h>
+
+#include "constant.h"
+
+const Constant CONSTANT_UNKNOWN = { .type = TYPE_UNKNOWN };
+
+static inline TypeKind kind_of(TypeTable table, TypeId type) {
+	return type_get(table, type)->kind;
+}
+
+static inline bool is_integer(TypeTable table, TypeId type) {
+	TypeKind kind = kind_of(table, type);
+	return kind == TYPE_KIND_SINT || kind == TYPE_KIND_UINT;
+}
+
+int64_t constant_wrap(TypeTable table, TypeId type, uint64_t bits) {
+	const Type* t = type_get(table, type);
+	if (t->bits >= 64) return (int64_t) bits;
+	uint64_t mask = ((uint64_t) 1 << t->bits) - 1;
+	bits &= mask;
+	if (t->kind == TYPE_KIND_SINT && bits >> (t->bits - 1)) bits |= ~mask;
+	return (int64_t) bits;
+}
+
+double constant_to_double(TypeTable table, const Constant* c) {
+	if (kind_of(table, c->type) == TYPE_KIND_UINT) return (double) (uint64_t) c->i;
+	if (is_integer(table, c->type)) return (double) c->i;
+	return c->f;
+}
+
+bool constant_fits(TypeTable table, const Constant* c, TypeId to) {
+	if (!c->literal) return false;
+	const Type* t = type_get(table, to);
+	if (kind_of(table, c->type) == TYPE_KIND_FLOAT) return t->kind == TYPE_KIND_FLOAT;
+	if (!is_integer(table, c->type)) return false;
+	int64_t v = c->i;
+	switch (t->kind) {
+		case TYPE_KIND_SINT: return t->bits >= 64 || (v >= -((int64_t) 1 << (t->bits - 1)) && v < (int64_t) 1 << (t->bits - 1));
+		case TYPE_KIND_UINT: return v >= 0 && (t->bits >= 64 || v < (int64_t) 1 << t->bits);
+		case TYPE_KIND_FLOAT: return true;
+		default: return false;
+	}
+}
+
+Constant constant_convert(TypeTable table, Constant c, TypeId to) {
+	if (c.type == to) return c;
+	Constant result = { .type = to, .literal = c.literal };
+	TypeKind from = kind_of(table, c.type);
+	switch (kind_of(table, to)) {
+		case TYPE_KIND_SINT:
+		case TYPE_KIND_UINT:
+			if (from != TYPE_KIND_SINT && from != TYPE_KIND_UINT) return CONSTANT_UNKNOWN;
+			result.i = constant_wrap(table, to, (uint64_t) c.i);
+			break;
+		case TYPE_KIND_FLOAT:
+			if (from != TYPE_KIND_SINT && from != TYPE_KIND_UINT && from != TYPE_KIND_FLOAT) return CONSTANT_UNKNOWN;
+			result.f = constant_to_double(table, &c);
+			if (type_get(table, to)->bits == 32) result.f = (float) result.f;
+			break;
+		case TYPE_KIND_BOOL:
+			if (from == TYPE_KIND_SINT || from == TYPE_KIND_UINT) result.b = c.i != 0;
+			else if (from == TYPE_KIND_FLOAT) result.b = c.f < 0 || c.f > 0;
+			else return CONSTANT_UNKNOWN;
+			break;
+		default:
+			return CONSTANT_UNKNOWN;
+	}
+	return result;
+}
+
+bool constant_common_type(TypeTable table, Constant* a, Constant* b) {
+	TypeId common;
+	if (constant_fits(table, a, b->type)) common = b->type;
+	else if (constant_fits(table, b, a->type)) common = a->type;
+	else if (!type_common(table, a->type, b->type, &common)) return false;
+	*a = constant_convert(table, *a, common);
+	*b = constant_convert(table, *b, common);
+	return constant_is_known(a) && constant_is_known(b);
+}
+
+static Constant zero_of(TypeId type) {
+	Constant zero = { .type = type };
+	if (type == TYPE_STRING) zero.s = "";
+	return zero;
+}
+
+Constant constant_arithmetic(TypeTable table, char op, Constant a, Constant b) {
+	// true * x = x, false * x = the zero of its type
+	if (op == '*' && a.type == TYPE_BOOL) return a.b? b : zero_of(b.type);
+	if (op == '*' && b.type == TYPE_BOOL) return b.b? a : zero_of(a.type);
+	if (!constant_common_type(table, &a, &b)) return CONSTANT_UNKNOWN;
+	TypeId type = a.type;
+	Constant result = { .type = type };
+	TypeKind kind = kind_of(table, type);
+	if (kind == TYPE_KIND_FLOAT) {
+		switch (op) {
+			case '+': result.f = a.f + b.f; break;
+			case '-': result.f = a.f - b.f; break;
+			case '*': result.f = a.f * b.f; break;
+			case '/': result.f = a.f / b.f; break;
+			case '%': result.f = fmod(a.f, b.f); break;
+			case '^': result.f = pow(a.f, b.f); break;
+			default: return CONSTANT_UNKNOWN;
+		}
+		if (!isfinite(result.f)) return CONSTANT_UNKNOWN;
+		if (type_get(table, type)->bits == 32) result.f = (float) result.f;
+		return result;
+	}
+	if (kind != TYPE_KIND_SINT && kind != TYPE_KIND_UINT) return CONSTANT_UNKNOWN;
+
+	// On the bits, so that overflow wraps rather than being undefined
+	uint64_t x = (uint64_t) a.i, y = (uint64_t) b.i, bits;
+	bool is_signed = kind == TYPE_KIND_SINT;
+	switch (op) {
+		case '+': bits = x + y; break;
+		case '-': bits = x - y; break;
+		case '*': bits = x * y; break;
+		case '/':
+		case '%':
+			if (!y) return CONSTANT_UNKNOWN;
+			if (!is_signed) bits = op == '/'? x / y : x % y;
+			else if (b.i == -1) bits = op == '/'? 0 - x : 0;  // INT64_MIN / -1 wraps
+			else bits = (uint64_t) (op == '/'? a.i / b.i : a.i % b.i);
+			break;
+		case '^':
+			if (is_signed && b.i < 0) return CONSTANT_UNKNOWN;
+			bits = 1;
+			for (uint64_t base = x; y; y >>= 1, base *= base) {
+				if (y & 1) bits *= base;
+			}
+			break;
+		default: return CONSTANT_UNKNOWN;
+	}
+	result.i = constant_wrap(table, type, bits);
+	return result;
+}
+
+Constant constant_negate(TypeTable table, Constant c) {
+	if (kind_of(table, c.type) == TYPE_KIND_FLOAT) c.f = -c.f;
+	else if (is_integer(table, c.type)) c.i = constant_wrap(table, c.type, 0 - (uint64_t) c.i);
+	else return CONSTANT_UNKNOWN;
+	return c;
+}
+
+int constant_compare(TypeTable table, const char* op, Constant a, Constant b) {
+	if (kind_of(table, a.type) == TYPE_KIND_ENUM || kind_of(table, b.type) == TYPE_KIND_ENUM) {
+		return a.type == b.type? (a.i > b.i) - (a.i < b.i) : 2;
+	}
+	if (!constant_common_type(table, &a, &b)) return 2;
+	bool equality = op[0] == '=' || op[0] == '!';
+	switch (kind_of(table, a.type)) {
+		case TYPE_KIND_SINT: return (a.i > b.i) - (a.i < b.i);
+		case TYPE_KIND_UINT: return ((uint64_t) a.i > (uint64_t) b.i) - ((uint64_t) a.i < (uint64_t) b.i);
+		case TYPE_KIND_FLOAT: return equality? 2 : (a.f > b.f) - (a.f < b.f);  // floats can't be compared for equality
+		case TYPE_KIND_BOOL: return equality? a.b - b.b : 2;
+		case TYPE_KIND_STRING: {
+			int order = strcmp(a.s, b.s);
+			return (order > 0) - (order < 0);
+		}
+		default: return 2;
+	}
+}
+
+bool constant_order_holds(const char* op, int order, bool* known) {
+	*known = true;
+	if (strcmp(op, "==") == 0) return order == 0;
+	if (strcmp(op, "!=") == 0) return order != 0;
+	if (strcmp(op, "<") == 0) return order < 0;
+	if (strcmp(op, "<=") == 0) return order <= 0;
+	if (strcmp(op, ">") == 0) return order > 0;
+	if (strcmp(op, ">=") == 0) return order >= 0;
+	*known = false;
+	return false;
+}
@@ -0,0 +1,48 @@
+#pragma once
+// Values of scalar types known at compile time, and the operators of the language on them:
+// integers wrap at the width of their type, and literals take the type of what they are
+// used with where they fit, as in the type check
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "types.h"
+
+typedef struct {
+	TypeId type;   // TYPE_UNKNOWN when the value isn't known
+	bool literal;  // adapts to the type it is used as
+	union {
+		int64_t i;  // sign- or zero-extended from the type's width; the value of an enum
+		double f;
+		bool b;
+		const char* s;
+	};
+} Constant;
+
+extern const Constant CONSTANT_UNKNOWN;
+
+static inline bool constant_is_known(const Constant* c) {
+	return c->type != TYPE_UNKNOWN;
+}
+
+/// Wraps the bits of an integer to the width of its type
+int64_t constant_wrap(TypeTable table, TypeId type, uint64_t bits);
+double constant_to_double(TypeTable table, const Constant* c);
+
+/// Whether a literal can be used as the type without changing its value
+bool constant_fits(TypeTable table, const Constant* c, TypeId to);
+/// The constant as a value of a type it coerces to: a wider number, a float, or a Bool.
+/// Integers are wrapped to narrower types.
+Constant constant_convert(TypeTable table, Constant c, TypeId to);
+/// Brings the operands of a binary operator to one type. False if they have none.
+bool constant_common_type(TypeTable table, Constant* a, Constant* b);
+
+/// One of + - * / % ^ on numbers, or Bool * x. Unknown for anything else (String * Int is
+/// left to the caller, which has the memory for the result), for division by zero and
+/// negative integer exponents, and for float results that aren't finite.
+Constant constant_arithmetic(TypeTable table, char op, Constant a, Constant b);
+Constant constant_negate(TypeTable table, Constant c);
+/// -1 if a < b, 0 if they are equal and 1 if a > b, for the comparison operator `op`; 2 if
+/// they can't be compared with it (floats for equality, bools for order)
+int constant_compare(TypeTable table, const char* op, Constant a, Constant b);
+/// Whether a comparison with the given order holds. False for an unknown operator, in *known.
+bool constant_order_holds(const char* op, int order, bool* known);
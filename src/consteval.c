@@ -0,0 +1,1848 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+
+#include "consteval.h"
+#include "constant.h"
+#include "ast_walk.h"
+#include "ast_intern.h"
+#include "util.h"
+#include "stb_ds.h"
+
+#define EVAL_BLOCK_SIZE (1 << 20)
+// Evaluations that go past these are given up on, as they probably never end
+#define EVAL_MAX_STEPS 100000000
+#define EVAL_MAX_DEPTH 500
+#define EVAL_MAX_MEMORY ((size_t) 256 << 20)
+// Of what is assigned to, as in a[i].b[j, k].c
+#define EVAL_MAX_PATH 16
+
+// === Memory ===
+
+typedef struct {
+	char* ARRAY blocks;
+	size_t left;  // in the last block
+	size_t used;  // in all of them
+} Arena;
+
+static void* arena_alloc(Arena* arena, size_t size) {
+	size = (size + 15) & ~(size_t) 15;
+	arena->used += size;
+	if (size > EVAL_BLOCK_SIZE / 4) {
+		// Kept behind the current block, which stays in use
+		char* big = calloc(1, size);
+		if (arrlen(arena->blocks)) {
+			char* current = arrlast(arena->blocks);
+			arena->blocks[arrlen(arena->blocks) - 1] = big;
+			arrput(arena->blocks, current);
+		}
+		else arrput(arena->blocks, big);  // with nothing left in it
+		return big;
+	}
+	if (!arrlen(arena->blocks) || arena->left < size) {
+		arrput(arena->blocks, calloc(1, EVAL_BLOCK_SIZE));
+		arena->left = EVAL_BLOCK_SIZE;
+	}
+	char* at = arrlast(arena->blocks) + (EVAL_BLOCK_SIZE - arena->left);
+	arena->left -= size;
+	return at;
+}
+
+static void arena_free(Arena* arena) {
+	for (int i = 0; i < arrlen(arena->blocks); i++) free(arena->blocks[i]);
+	arrfree(arena->blocks);
+	arena->left = arena->used = 0;
+}
+
+// === State ===
+
+typedef struct _aggregate Aggregate;
+
+/// A scalar, or an array or struct, whose elements or fields are values themselves.
+/// Values are copied where they are stored, so each variable has its own.
+typedef struct {
+	Constant c;      // of an array or struct, only the type
+	Aggregate* agg;  // NULL for a scalar
+} Value;
+
+struct _aggregate {
+	int64_t n;
+	Value items[];  // the elements of an array (arrays of one dimension less for more); the fields of a struct
+};
+
+typedef enum {
+	FLOW_NEXT,
+	FLOW_BREAK,
+	FLOW_SKIP,
+	FLOW_RETURN,
+	FLOW_ERROR,
+} Flow;
+
+typedef struct {
+	SymbolId id;
+	Value value;
+} Local;
+
+typedef struct {
+	const char* src_file;
+	int line, start_col, end_col;
+	int order;
+	char* message;
+} Diagnostic;
+
+// What each thread evaluating has to itself
+typedef struct {
+	struct _const_eval* eval;
+	Arena scratch;          // what is made while evaluating one constant or statement
+	Arena kept;             // the values of the constants it evaluated
+	Local ARRAY locals;
+	int frame;              // where the locals of the function being run start
+	int depth;              // of calls
+	int64_t steps;
+	const char* label;      // of the loop being broken out of or skipped; NULL for the innermost
+	Value returned;
+	const AST_Node* where;  // the last node with a location, for errors in shared ones
+	const char* evaluating; // the constant being evaluated; NULL for a '#run'
+	char* error;            // what stopped the evaluation
+	const AST_Node* error_at;
+	bool unsupported;       // the error is something that can't be done at compile time
+	Diagnostic ARRAY diagnostics;
+} Evaluator;
+
+typedef struct {
+	const AST_FuncDef* func;  // NULL for a free entry
+	uint64_t hash;
+	int n_args;
+	Constant* args;
+	Value result;
+} MemoEntry;
+
+typedef enum {
+	CONST_PENDING = 0,  // not evaluated (yet), or left for run time
+	CONST_DONE,
+	CONST_FAILED,
+} ConstState;
+
+struct _const_eval {
+	Resolution res;
+	TypeCheck check;
+	TypeTable table;
+	bool has_using_imports;  // so undeclared names may be functions from elsewhere
+	Value ARRAY values;      // of constants, by symbol id
+	uint8_t ARRAY states;    // ConstState, by symbol id
+	SymbolId ARRAY batch;    // constants evaluated together, as none depends on another
+	Evaluator* evaluators;   // one per thread
+	int n_evaluators;
+	// Results of calls with scalar arguments, shared by the threads
+	pthread_mutex_t memo_lock;
+	MemoEntry* memo;         // open addressing
+	size_t memo_mask, memo_count;
+	Arena memo_arena;
+	Arena nodes;             // the literals put in the tree
+	int n_errors, n_constants, n_baked, n_runs;
+};
+
+static bool eval_expr(Evaluator* ev, AST_Node* const* slot, Value* out);
+static Flow exec(Evaluator* ev, AST_Node* const* slot);
+
+// === Errors ===
+
+static char* format_message(const char* fmt, va_list args) {
+	va_list copy;
+	va_copy(copy, args);
+	int length = vsnprintf(NULL, 0, fmt, copy);
+	va_end(copy);
+	char* message = malloc(length + 1);
+	vsnprintf(message, length + 1, fmt, args);
+	return message;
+}
+
+static bool stop(Evaluator* ev, const AST_Node* at, bool unsupported, const char* fmt, va_list args) {
+	if (ev->error) return false;
+	ev->error = format_message(fmt, args);
+	ev->error_at = at && !ast_is_shared(at)? at : ev->where;
+	ev->unsupported = unsupported;
+	return false;
+}
+
+/// Stops the evaluation with an error. Always returns false.
+static bool eval_error(Evaluator* ev, const AST_Node* at, const char* fmt, ...) {
+	va_list args;
+	va_start(args, fmt);
+	stop(ev, at, false, fmt, args);
+	va_end(args);
+	return false;
+}
+
+/// Stops the evaluation at something that can only be done at run time. Constants that
+/// need it are left for then, so it is only an error in '#run'. Always returns false.
+static bool not_at_compile_time(Evaluator* ev, const AST_Node* at, const char* fmt, ...) {
+	va_list args;
+	va_start(args, fmt);
+	stop(ev, at, true, fmt, args);
+	va_end(args);
+	return false;
+}
+
+static int compare_diagnostics(const void* a, const void* b) {
+	const Diagnostic* x = a;
+	const Diagnostic* y = b;
+	if (x->line != y->line) return x->line < y->line? -1 : 1;
+	if (x->start_col != y->start_col) return x->start_col < y->start_col? -1 : 1;
+	return (x->order > y->order) - (x->order < y->order);
+}
+
+static void report_diagnostics(Diagnostic* diagnostics, int n) {
+	if (!n) return;
+	qsort(diagnostics, n, sizeof(Diagnostic), compare_diagnostics);
+	char* source = NULL;
+	const char* ARRAY lines = NULL;
+	for (int i = 0; i < n; i++) {
+		const Diagnostic* d = &diagnostics[i];
+		if (!source) {
+			source = (char*) read_entire_file(d->src_file);
+			for (char* p = source; p && *p; p++) {
+				if (p == source) arrput(lines, p);
+				if (*p != '\n') continue;
+				*p = 0;
+				arrput(lines, p + 1);
+			}
+		}
+		fprintf(stderr, "In '%s' at line %d, column %d...\n  Evaluation error: %s\n", d->src_file, d->line, d->start_col, d->message);
+		if (d->line >= 1 && d->line <= arrlen(lines)) {
+			const char* line = lines[d->line - 1];
+			show_error_line(stderr, line, d->line, d->start_col, d->end_col < 0? (int) strlen(line) : d->end_col);
+		}
+	}
+	free(source);
+	arrfree(lines);
+}
+
+static void add_diagnostic(Evaluator* ev, const AST_Node* at, char* message) {
+	Diagnostic diagnostic = {
+		at->src_file, at->start_line, at->start_col, at->end_line > at->start_line? -1 : (int) at->end_col,
+		arrlen(ev->diagnostics), message,
+	};
+	arrput(ev->diagnostics, diagnostic);
+}
+
+static void begin_evaluation(Evaluator* ev, const AST_Node* at, const char* name) {
+	if (ev->locals) stbds_header(ev->locals)->length = 0;
+	ev->frame = ev->depth = 0;
+	ev->steps = 0;
+	ev->label = NULL;
+	ev->where = at;
+	ev->evaluating = name;
+}
+
+static void end_evaluation(Evaluator* ev) {
+	if (ev->error) {
+		// Constants that can't be evaluated are left for run time
+		if (ev->unsupported && ev->evaluating) free(ev->error);
+		else if (ev->evaluating) {
+			size_t length = strlen(ev->error) + strlen(ev->evaluating) + 32;
+			char* message = malloc(length);
+			snprintf(message, length, "%s (evaluating '%s')", ev->error, ev->evaluating);
+			free(ev->error);
+			add_diagnostic(ev, ev->error_at, message);
+		}
+		else add_diagnostic(ev, ev->error_at, ev->error);
+		ev->error = NULL;
+		ev->unsupported = false;
+	}
+	if (ev->locals) stbds_header(ev->locals)->length = 0;
+	arena_free(&ev->scratch);
+}
+
+// === Values ===
+
+static inline Value scalar(Constant c) {
+	return (Value) { .c = c };
+}
+
+static inline TypeKind kind_of(Evaluator* ev, TypeId type) {
+	return type_get(ev->eval->table, type)->kind;
+}
+
+static inline bool is_integer_kind(TypeKind kind) {
+	return kind == TYPE_KIND_SINT || kind == TYPE_KIND_UINT;
+}
+
+static inline bool is_number_kind(TypeKind kind) {
+	return is_integer_kind(kind) || kind == TYPE_KIND_FLOAT;
+}
+
+static inline Value bool_value(bool b) {
+	return scalar((Constant) { .type = TYPE_BOOL, .b = b });
+}
+
+static Aggregate* new_aggregate(Arena* arena, int64_t n) {
+	Aggregate* agg = arena_alloc(arena, sizeof(Aggregate) + n * sizeof(Value));
+	agg->n = n;
+	return agg;
+}
+
+// stb_ds lookups write to the map, and other threads may be reading the same declarations
+#define FIND_KEY(map, name) find_key(&(map)->key, sizeof(*(map)), shlen(map), (name))
+
+static ptrdiff_t find_key(const char* const* first_key, size_t stride, ptrdiff_t n, const char* name) {
+	for (ptrdiff_t i = 0; i < n; i++) {
+		const char* key = *(const char* const*) ((const char*) first_key + i * stride);
+		if (strcmp(key, name) == 0) return i;
+	}
+	return -1;
+}
+
+/// What an array of the type holds: its elements, or arrays of one dimension less
+static TypeId element_of(TypeTable table, TypeId type) {
+	const Type* t = type_get(table, type);
+	if (t->kind != TYPE_KIND_ARRAY || t->count < 1) return TYPE_UNKNOWN;
+	if (t->count == 1) return t->base;
+	int n_extents;
+	const int64_t* extents = type_extents(table, type, &n_extents);
+	return type_array(table, t->base, t->count - 1, extents + 1, false);
+}
+
+static TypeId field_type(Evaluator* ev, AST_Field* field) {
+	ConstEval eval = ev->eval;
+	if (field->type) return typecheck_type_of(eval->check, field->type);
+	return field->default_value? type_unqualified(eval->table, typecheck_expr_type(eval->check, &field->default_value)) : TYPE_UNKNOWN;
+}
+
+/// The scalar as a value of another type, as a cast makes it: integers wrap, floats are
+/// truncated, and numbers are true when they aren't zero
+static bool cast_scalar(Evaluator* ev, Constant c, TypeId to, const AST_Node* at, Constant* out) {
+	TypeTable table = ev->eval->table;
+	to = type_unqualified(table, to);
+	TypeKind from = kind_of(ev, c.type), kind = kind_of(ev, to);
+	c.literal = false;
+	if (c.type == to || kind == TYPE_KIND_UNKNOWN) {
+		*out = c;
+		return true;
+	}
+	bool from_number = is_number_kind(from) || from == TYPE_KIND_BOOL || from == TYPE_KIND_RUNE;
+	bool to_number = is_number_kind(kind) || kind == TYPE_KIND_BOOL || kind == TYPE_KIND_RUNE;
+	if (!from_number || !to_number) {
+		return not_at_compile_time(ev, at, "A %s can't be made a %s at compile time", type_name(table, c.type), type_name(table, to));
+	}
+	if (from == TYPE_KIND_BOOL) c = (Constant) { .type = TYPE_INT, .i = c.b };
+	else if (from == TYPE_KIND_RUNE) c.type = TYPE_INT;
+	else if (from == TYPE_KIND_FLOAT && kind != TYPE_KIND_FLOAT && kind != TYPE_KIND_BOOL) {
+		double truncated = trunc(c.f);
+		double limit = kind == TYPE_KIND_UINT? 0x1p64 : 0x1p63;
+		if (!(truncated >= -0x1p63 && truncated < limit)) return eval_error(ev, at, "%g doesn't fit in %s", c.f, type_name(table, to));
+		c = kind == TYPE_KIND_UINT && truncated >= 0x1p63? (Constant) { .type = TYPE_U64, .i = (int64_t) (uint64_t) truncated } : (Constant) { .type = TYPE_INT, .i = (int64_t) truncated };
+	}
+	Constant result = { .type = to };
+	if (kind == TYPE_KIND_BOOL) result.b = kind_of(ev, c.type) == TYPE_KIND_FLOAT? c.f < 0 || c.f > 0 : c.i != 0;
+	else if (kind == TYPE_KIND_FLOAT) {
+		result.f = constant_to_double(table, &c);
+		if (type_get(table, to)->bits == 32) result.f = (float) result.f;
+	}
+	else if (kind == TYPE_KIND_RUNE) result.i = (int32_t) c.i;
+	else result.i = constant_wrap(table, to, (uint64_t) c.i);
+	*out = result;
+	return true;
+}
+
+/// A copy of the value, made in the scratch, as a value of the type it is stored as
+static bool store(Evaluator* ev, Value v, TypeId to, const AST_Node* at, Value* out) {
+	TypeTable table = ev->eval->table;
+	to = type_unqualified(table, to);
+	if (!v.agg) {
+		out->agg = NULL;
+		return cast_scalar(ev, v.c, to, at, &out->c);
+	}
+	if (to == TYPE_UNKNOWN) to = v.c.type;
+	const Type* t = type_get(table, to);
+	TypeKind kind = kind_of(ev, v.c.type);
+	if (t->kind != kind || (kind == TYPE_KIND_STRUCT && to != v.c.type)) {
+		return not_at_compile_time(ev, at, "A %s can't be made a %s at compile time", type_name(table, v.c.type), type_name(table, to));
+	}
+	int64_t n = v.agg->n;
+	Aggregate* copy = new_aggregate(&ev->scratch, n);
+	if (kind == TYPE_KIND_ARRAY) {
+		int n_extents;
+		const int64_t* extents = type_extents(table, to, &n_extents);
+		if (!t->is_dynamic && n_extents && extents[0] >= 0 && extents[0] != n) {
+			return eval_error(ev, at, "An array of %lld elements can't be stored as %s", (long long) n, type_name(table, to));
+		}
+		TypeId element = element_of(table, to);
+		for (int64_t i = 0; i < n; i++) {
+			if (!store(ev, v.agg->items[i], element, at, &copy->items[i])) return false;
+		}
+	}
+	else {
+		AST_Struct* decl = (AST_Struct*) t->decl;
+		for (int64_t i = 0; i < n; i++) {
+			if (!store(ev, v.agg->items[i], field_type(ev, decl->fields[i].value), at, &copy->items[i])) return false;
+		}
+	}
+	*out = (Value) { .c = { .type = to }, .agg = copy };
+	return true;
+}
+
+/// A copy of the value, strings and all, to keep once the scratch is cleared
+static Value persist(Arena* arena, Value v) {
+	if (!v.agg) {
+		if (v.c.type == TYPE_STRING) {
+			size_t size = strlen(v.c.s) + 1;
+			char* s = arena_alloc(arena, size);
+			memcpy(s, v.c.s, size);
+			v.c.s = s;
+		}
+		return v;
+	}
+	Aggregate* copy = new_aggregate(arena, v.agg->n);
+	for (int64_t i = 0; i < v.agg->n; i++) copy->items[i] = persist(arena, v.agg->items[i]);
+	v.agg = copy;
+	return v;
+}
+
+/// The value of the enum's member number `index`: the one it is given, or the one after
+/// that of the member before it (the next bit, for flags)
+static bool enum_value(Evaluator* ev, AST_Enum* decl, ptrdiff_t index, TypeId type, const AST_Node* at, Constant* out) {
+	int64_t value = decl->is_flags? 1 : 0;
+	for (ptrdiff_t i = 0; i <= index; i++) {
+		AST_EnumValue* member = decl->fields[i].value;
+		if (member->value) {
+			Value given;
+			if (!eval_expr(ev, &member->value, &given)) return false;
+			if (given.agg || !is_integer_kind(kind_of(ev, given.c.type))) {
+				return not_at_compile_time(ev, at, "The value of '%s' isn't an integer known at compile time", decl->fields[i].key);
+			}
+			value = given.c.i;
+		}
+		if (i < index) value = decl->is_flags? (value? (int64_t) ((uint64_t) value << 1) : 1) : (int64_t) ((uint64_t) value + 1);
+	}
+	*out = (Constant) { .type = type, .i = value };
+	return true;
+}
+
+static bool zero_value(Evaluator* ev, TypeId type, const AST_Node* at, Value* out);
+
+/// Fields that weren't given take their defaults, or the zero of their type
+static bool fill_fields(Evaluator* ev, AST_Struct* decl, Aggregate* agg, const bool* given, const AST_Node* at) {
+	if (ev->depth >= EVAL_MAX_DEPTH) return eval_error(ev, at, "Structs are nested more than %d deep", EVAL_MAX_DEPTH);
+	ev->depth++;
+	bool ok = true;
+	for (int64_t i = 0; i < agg->n && ok; i++) {
+		if (given && given[i]) continue;
+		AST_Field* field = decl->fields[i].value;
+		TypeId type = field_type(ev, field);
+		Value value;
+		if (field->default_value) ok = eval_expr(ev, &field->default_value, &value) && store(ev, value, type, at, &agg->items[i]);
+		else ok = zero_value(ev, type, at, &agg->items[i]);
+	}
+	ev->depth--;
+	return ok;
+}
+
+/// What a variable of the type holds if it isn't given a value
+static bool zero_value(Evaluator* ev, TypeId type, const AST_Node* at, Value* out) {
+	TypeTable table = ev->eval->table;
+	type = type_unqualified(table, type);
+	const Type* t = type_get(table, type);
+	*out = (Value) { .c = { .type = type } };
+	switch (t->kind) {
+		case TYPE_KIND_SINT:
+		case TYPE_KIND_UINT:
+		case TYPE_KIND_FLOAT:
+		case TYPE_KIND_BOOL:
+		case TYPE_KIND_RUNE:
+			return true;
+		case TYPE_KIND_STRING:
+			out->c.s = "";
+			return true;
+		case TYPE_KIND_ENUM:
+			if (!shlen(((AST_Enum*) t->decl)->fields)) break;
+			return enum_value(ev, (AST_Enum*) t->decl, 0, type, at, &out->c);
+		case TYPE_KIND_ARRAY: {
+			int64_t n = 0;
+			if (!t->is_dynamic) {
+				int n_extents;
+				const int64_t* extents = type_extents(table, type, &n_extents);
+				if (t->count < 1 || extents[0] < 0) return not_at_compile_time(ev, at, "The size of %s is only known at run time", type_name(table, type));
+				n = extents[0];
+			}
+			if ((uint64_t) n > EVAL_MAX_MEMORY / sizeof(Value)) return eval_error(ev, at, "%s is too large to be made at compile time", type_name(table, type));
+			out->agg = new_aggregate(&ev->scratch, n);
+			TypeId element = element_of(table, type);
+			for (int64_t i = 0; i < n; i++) {
+				if (!zero_value(ev, element, at, &out->agg->items[i])) return false;
+			}
+			return true;
+		}
+		case TYPE_KIND_STRUCT: {
+			AST_Struct* decl = (AST_Struct*) t->decl;
+			out->agg = new_aggregate(&ev->scratch, shlen(decl->fields));
+			return fill_fields(ev, decl, out->agg, NULL, at);
+		}
+		default: break;
+	}
+	return not_at_compile_time(ev, at, "A %s can't be made at compile time", type_name(table, type));
+}
+
+// === Names ===
+
+static ptrdiff_t find_local(Evaluator* ev, SymbolId id) {
+	for (ptrdiff_t i = arrlen(ev->locals) - 1; i >= ev->frame; i--) {
+		if (ev->locals[i].id == id) return i;
+	}
+	return -1;
+}
+
+static SymbolId declared_symbol(Evaluator* ev, AST_Name* const* name) {
+	return resolution_lookup(ev->eval->res, (AST_Node* const*) name).symbol;
+}
+
+static bool field_of(Evaluator* ev, Value* base, const char* name, const AST_Node* at, Value** out) {
+	TypeTable table = ev->eval->table;
+	if (!base->agg || kind_of(ev, base->c.type) != TYPE_KIND_STRUCT) {
+		return not_at_compile_time(ev, at, "'%s' of %s can't be evaluated at compile time", name, type_name(table, base->c.type));
+	}
+	AST_Struct* decl = (AST_Struct*) type_get(table, base->c.type)->decl;
+	ptrdiff_t i = FIND_KEY(decl->fields, name);
+	if (i < 0 || i >= base->agg->n) return eval_error(ev, at, "%s has no field '%s'", type_name(table, base->c.type), name);
+	*out = &base->agg->items[i];
+	return true;
+}
+
+static bool element(Evaluator* ev, Value* array, Value index, const AST_Node* at, Value** out) {
+	if (!array->agg || kind_of(ev, array->c.type) != TYPE_KIND_ARRAY) {
+		return not_at_compile_time(ev, at, "Only arrays can be subscripted at compile time");
+	}
+	if (index.agg || !is_integer_kind(kind_of(ev, index.c.type))) return not_at_compile_time(ev, at, "Indices must be integers");
+	bool negative = kind_of(ev, index.c.type) == TYPE_KIND_SINT && index.c.i < 0;
+	if (negative || (uint64_t) index.c.i >= (uint64_t) array->agg->n) {
+		return eval_error(ev, at, "Index %lld is out of bounds for an array of %lld elements", (long long) index.c.i, (long long) array->agg->n);
+	}
+	*out = &array->agg->items[index.c.i];
+	return true;
+}
+
+static bool eval_name(Evaluator* ev, AST_Node* const* slot, Value* out) {
+	ConstEval eval = ev->eval;
+	const AST_Qualname* qn = (const AST_Qualname*) *slot;
+	int n = arrlen(qn->parts);
+	ResolvedName found = resolution_lookup(eval->res, slot);
+	if (!found.symbol) return not_at_compile_time(ev, *slot, "'%s' isn't declared in the module, so it has no value at compile time", qn->parts[0]);
+	const Symbol* symbol = resolution_symbol(eval->res, found.symbol);
+	Value value;
+	int i = found.n_parts;
+	switch (symbol->kind) {
+		case DECL_LOCAL:
+		case DECL_PARAM:
+		case DECL_LOOP_VAR: {
+			ptrdiff_t local = find_local(ev, found.symbol);
+			if (local < 0) return not_at_compile_time(ev, *slot, "'%s' has no value here at compile time", symbol->name);
+			value = ev->locals[local].value;
+		} break;
+		case DECL_CONST:
+			if (eval->states[found.symbol] != CONST_DONE) return not_at_compile_time(ev, *slot, "'%s' has no value at compile time", symbol->name);
+			value = eval->values[found.symbol];
+			break;
+		case DECL_ENUM: {
+			AST_Enum* decl = (AST_Enum*) symbol->decl;
+			ptrdiff_t index = i < n? FIND_KEY(decl->fields, qn->parts[i]) : -1;
+			if (index < 0) return not_at_compile_time(ev, *slot, "'%s' isn't a value", symbol->name);
+			TypeId type = type_nominal(eval->table, TYPE_KIND_ENUM, symbol->decl, symbol->name);
+			value.agg = NULL;
+			if (!enum_value(ev, decl, index, type, *slot, &value.c)) return false;
+			i++;
+		} break;
+		default:
+			return not_at_compile_time(ev, *slot, "'%s' can't be used as a value at compile time", symbol->name);
+	}
+	Value* at = &value;
+	for (; i < n; i++) {
+		if (!field_of(ev, at, qn->parts[i], *slot, &at)) return false;
+	}
+	*out = *at;
+	return true;
+}
+
+// === Operators ===
+
+static bool repeat(Evaluator* ev, const AST_Node* at, const char* s, Constant n, Constant* out) {
+	if (kind_of(ev, n.type) == TYPE_KIND_SINT && n.i < 0) return eval_error(ev, at, "A string can't be repeated %lld times", (long long) n.i);
+	size_t length = strlen(s);
+	uint64_t times = (uint64_t) n.i;
+	if (length && times > EVAL_MAX_MEMORY / 4 / length) return eval_error(ev, at, "The repeated string is too long to be made at compile time");
+	char* text = arena_alloc(&ev->scratch, length * times + 1);
+	for (uint64_t i = 0; i < times; i++) memcpy(text + length * i, s, length);
+	text[length * times] = 0;
+	*out = (Constant) { .type = TYPE_STRING, .s = text };
+	return true;
+}
+
+static bool arithmetic(Evaluator* ev, const AST_Node* at, char op, Value a, Value b, Value* out) {
+	TypeTable table = ev->eval->table;
+	if (a.agg || b.agg) return not_at_compile_time(ev, at, "Operator '%c' of arrays or structs can't be evaluated at compile time", op);
+	out->agg = NULL;
+	// A string times n is it repeated
+	if (op == '*' && a.c.type == TYPE_STRING && is_integer_kind(kind_of(ev, b.c.type))) return repeat(ev, at, a.c.s, b.c, &out->c);
+	out->c = constant_arithmetic(table, op, a.c, b.c);
+	if (constant_is_known(&out->c)) return true;
+	// Why it has no value
+	Constant x = a.c, y = b.c;
+	if (constant_common_type(table, &x, &y)) {
+		TypeKind kind = kind_of(ev, x.type);
+		if (is_integer_kind(kind) && (op == '/' || op == '%') && !y.i) return eval_error(ev, at, "Division by zero");
+		if (kind == TYPE_KIND_SINT && op == '^' && y.i < 0) return eval_error(ev, at, "Integers can't be raised to negative powers");
+		if (kind == TYPE_KIND_FLOAT) return eval_error(ev, at, "The result of '%c' isn't a finite number", op);
+	}
+	return not_at_compile_time(ev, at, "Operator '%c' of %s and %s can't be evaluated at compile time", op, type_name(table, a.c.type), type_name(table, b.c.type));
+}
+
+static bool eval_condition(Evaluator* ev, AST_Node* const* slot, bool* out) {
+	Value value;
+	Constant b;
+	if (!eval_expr(ev, slot, &value)) return false;
+	if (value.agg) return not_at_compile_time(ev, *slot, "A condition must be a Bool");
+	if (!cast_scalar(ev, value.c, TYPE_BOOL, *slot, &b)) return false;
+	*out = b.b;
+	return true;
+}
+
+static bool eval_comparison(Evaluator* ev, AST_ComparisonChain* chain, Value* out) {
+	TypeTable table = ev->eval->table;
+	Value a, b;
+	*out = bool_value(true);
+	if (!eval_expr(ev, &chain->operands[0], &a)) return false;
+	for (int i = 0; i < arrlen(chain->comparisons); i++) {
+		if (!eval_expr(ev, &chain->operands[i + 1], &b)) return false;
+		const char* op = chain->comparisons[i];
+		int order = a.agg || b.agg? 2 : constant_compare(table, op, a.c, b.c);
+		bool known, holds = constant_order_holds(op, order, &known);
+		if (order == 2 || !known) {
+			return not_at_compile_time(ev, (AST_Node*) chain, "%s and %s can't be compared with '%s' at compile time", type_name(table, a.c.type), type_name(table, b.c.type), op);
+		}
+		// The rest isn't evaluated once one is false
+		if (!holds) {
+			out->c.b = false;
+			return true;
+		}
+		a = b;
+	}
+	return true;
+}
+
+// === Calls ===
+
+static uint64_t hash_constant(uint64_t hash, const Constant* c, TypeKind kind) {
+	uint64_t bits;
+	if (kind == TYPE_KIND_STRING) {
+		for (const char* p = c->s; *p; p++) hash = (hash ^ (uint8_t) *p) * 0x100000001b3;
+		bits = 0;
+	}
+	else if (kind == TYPE_KIND_FLOAT) memcpy(&bits, &c->f, sizeof(bits));
+	else if (kind == TYPE_KIND_BOOL) bits = c->b;
+	else bits = (uint64_t) c->i;
+	hash = (hash ^ c->type) * 0x100000001b3;
+	return (hash ^ bits) * 0x100000001b3;
+}
+
+static bool same_constant(const Constant* a, const Constant* b, TypeKind kind) {
+	if (a->type != b->type) return false;
+	if (kind == TYPE_KIND_STRING) return strcmp(a->s, b->s) == 0;
+	if (kind == TYPE_KIND_FLOAT) return memcmp(&a->f, &b->f, sizeof(double)) == 0;
+	if (kind == TYPE_KIND_BOOL) return a->b == b->b;
+	return a->i == b->i;
+}
+
+static uint64_t hash_call(Evaluator* ev, const AST_FuncDef* func, const Value* args, int n) {
+	uint64_t hash = (0xcbf29ce484222325 ^ (uintptr_t) func) * 0x100000001b3;
+	for (int i = 0; i < n; i++) hash = hash_constant(hash, &args[i].c, kind_of(ev, args[i].c.type));
+	return hash;
+}
+
+/// Where the call's entry is in the memo, or the free slot it would go in
+static MemoEntry* memo_slot(Evaluator* ev, const AST_FuncDef* func, uint64_t hash, const Value* args, int n) {
+	ConstEval eval = ev->eval;
+	for (size_t i = hash & eval->memo_mask; ; i = (i + 1) & eval->memo_mask) {
+		MemoEntry* entry = &eval->memo[i];
+		if (!entry->func) return entry;
+		if (entry->func != func || entry->hash != hash || entry->n_args != n) continue;
+		bool same = true;
+		for (int j = 0; j < n && same; j++) same = same_constant(&entry->args[j], &args[j].c, kind_of(ev, args[j].c.type));
+		if (same) return entry;
+	}
+}
+
+static bool memo_find(Evaluator* ev, const AST_FuncDef* func, uint64_t hash, const Value* args, int n, Value* out) {
+	ConstEval eval = ev->eval;
+	pthread_mutex_lock(&eval->memo_lock);
+	MemoEntry* entry = eval->memo? memo_slot(ev, func, hash, args, n) : NULL;
+	bool found = entry && entry->func;
+	if (found) *out = entry->result;
+	pthread_mutex_unlock(&eval->memo_lock);
+	return found;
+}
+
+static void memo_insert(Evaluator* ev, const AST_FuncDef* func, uint64_t hash, const Value* args, int n, Value result) {
+	ConstEval eval = ev->eval;
+	pthread_mutex_lock(&eval->memo_lock);
+	if ((eval->memo_count + 1) * 2 > (eval->memo? eval->memo_mask + 1 : 0)) {
+		size_t capacity = eval->memo? (eval->memo_mask + 1) * 2 : 256;
+		MemoEntry* old = eval->memo;
+		size_t n_old = old? eval->memo_mask + 1 : 0;
+		eval->memo = calloc(capacity, sizeof(MemoEntry));
+		eval->memo_mask = capacity - 1;
+		for (size_t i = 0; i < n_old; i++) {
+			if (!old[i].func) continue;
+			size_t j = old[i].hash & eval->memo_mask;
+			while (eval->memo[j].func) j = (j + 1) & eval->memo_mask;
+			eval->memo[j] = old[i];
+		}
+		free(old);
+	}
+	MemoEntry* entry = memo_slot(ev, func, hash, args, n);
+	// Another thread may have made the same call
+	if (!entry->func) {
+		Constant* kept = arena_alloc(&eval->memo_arena, (n + 1) * sizeof(Constant));
+		for (int i = 0; i < n; i++) kept[i] = persist(&eval->memo_arena, args[i]).c;
+		*entry = (MemoEntry) { func, hash, n, kept, persist(&eval->memo_arena, result) };
+		eval->memo_count++;
+	}
+	pthread_mutex_unlock(&eval->memo_lock);
+}
+
+static TypeId param_type(Evaluator* ev, AST_Param* param) {
+	return typecheck_symbol_type(ev->eval->check, declared_symbol(ev, &param->name));
+}
+
+/// Runs a function of the module. Functions can only compute their result from their
+/// arguments, so those that only take scalars are run once for each set of them.
+static bool call_function(Evaluator* ev, AST_FuncCall* call, SymbolId id, Value* out) {
+	ConstEval eval = ev->eval;
+	TypeTable table = eval->table;
+	AST_FuncDef* func = (AST_FuncDef*) resolution_symbol(eval->res, id)->decl;
+	const char* name = func->name->name;
+	if (!func->body) return not_at_compile_time(ev, (AST_Node*) call, "'%s' has no body to run at compile time", name);
+	if (ev->depth >= EVAL_MAX_DEPTH) return eval_error(ev, (AST_Node*) call, "Calls go more than %d deep", EVAL_MAX_DEPTH);
+	int n_params = shlen(func->params), n_positional = arrlen(call->pos_args);
+	int vararg = -1;
+	for (int i = 0; i < n_params && vararg < 0; i++) {
+		if (func->params[i].value->is_vararg) vararg = i;
+	}
+	Value* args = arena_alloc(&ev->scratch, (n_params + 1) * sizeof(Value));
+	bool* given = arena_alloc(&ev->scratch, n_params + 1);
+	if (vararg >= 0) {
+		// The rest of the positional arguments, as an array
+		int64_t n = n_positional > vararg? n_positional - vararg : 0;
+		args[vararg] = (Value) { .c = { .type = type_unqualified(table, param_type(ev, func->params[vararg].value)) }, .agg = new_aggregate(&ev->scratch, n) };
+		given[vararg] = true;
+	}
+	for (int i = 0; i < n_positional; i++) {
+		int p = vararg >= 0 && i >= vararg? vararg : i;
+		if (p >= n_params) return eval_error(ev, (AST_Node*) call, "'%s' takes %d arguments, not %d", name, n_params, n_positional);
+		Value value;
+		if (!eval_expr(ev, &call->pos_args[i], &value)) return false;
+		if (p == vararg) {
+			if (!store(ev, value, element_of(table, args[p].c.type), (AST_Node*) call, &args[p].agg->items[i - vararg])) return false;
+			continue;
+		}
+		if (!store(ev, value, param_type(ev, func->params[p].value), (AST_Node*) call, &args[p])) return false;
+		given[p] = true;
+	}
+	for (int i = 0; i < shlen(call->kw_args); i++) {
+		ptrdiff_t p = FIND_KEY(func->params, call->kw_args[i].key);
+		if (p < 0) return eval_error(ev, (AST_Node*) call, "'%s' has no parameter '%s'", name, call->kw_args[i].key);
+		Value value;
+		if (!eval_expr(ev, &call->kw_args[i].value, &value)) return false;
+		if (!store(ev, value, param_type(ev, func->params[p].value), (AST_Node*) call, &args[p])) return false;
+		given[p] = true;
+	}
+
+	// Defaults may use the parameters before them
+	int caller_frame = ev->frame;
+	ev->frame = arrlen(ev->locals);
+	ev->depth++;
+	bool ok = true, memoized = true;
+	for (int p = 0; p < n_params && ok; p++) {
+		AST_Param* param = func->params[p].value;
+		if (!given[p]) {
+			Value value;
+			if (!param->default_value) ok = eval_error(ev, (AST_Node*) call, "Missing an argument for '%s' of '%s'", param->name->name, name);
+			else ok = eval_expr(ev, &param->default_value, &value) && store(ev, value, param_type(ev, param), (AST_Node*) call, &args[p]);
+			if (!ok) break;
+		}
+		memoized = memoized && !args[p].agg;
+		arrput(ev->locals, ((Local) { declared_symbol(ev, &param->name), args[p] }));
+	}
+
+	uint64_t hash = ok && memoized? hash_call(ev, func, args, n_params) : 0;
+	if (ok && memoized && memo_find(ev, func, hash, args, n_params, out)) ev->steps++;
+	else if (ok) {
+		Flow flow = exec(ev, (AST_Node* const*) &func->body);
+		TypeId func_type = typecheck_symbol_type(eval->check, id);
+		TypeId ret = func->ret_type? (func_type? type_get(table, func_type)->base : TYPE_UNKNOWN) : TYPE_VOID;
+		if (flow == FLOW_ERROR) ok = false;
+		else if (flow == FLOW_BREAK || flow == FLOW_SKIP) ok = eval_error(ev, (AST_Node*) call, "'%s' left a loop it isn't in", name);
+		else if (ret == TYPE_VOID) *out = scalar((Constant) { .type = TYPE_VOID });
+		else if (flow != FLOW_RETURN) ok = eval_error(ev, (AST_Node*) call, "'%s' ended without returning a value", name);
+		else ok = store(ev, ev->returned, ret, (AST_Node*) call, out);
+		if (ok && memoized) memo_insert(ev, func, hash, args, n_params, *out);
+	}
+	arrsetlen(ev->locals, ev->frame);
+	ev->frame = caller_frame;
+	ev->depth--;
+	return ok;
+}
+
+/// Struct values are made by calling the struct with its fields, in order or by name
+static bool make_struct(Evaluator* ev, AST_FuncCall* call, const Symbol* symbol, Value* out) {
+	AST_Struct* decl = (AST_Struct*) symbol->decl;
+	int n_fields = shlen(decl->fields), n_positional = arrlen(call->pos_args);
+	if (n_positional > n_fields) return eval_error(ev, (AST_Node*) call, "%s has %d fields, not %d", symbol->name, n_fields, n_positional);
+	Aggregate* agg = new_aggregate(&ev->scratch, n_fields);
+	bool* given = arena_alloc(&ev->scratch, n_fields + 1);
+	for (int i = 0; i < n_positional; i++) {
+		Value value;
+		if (!eval_expr(ev, &call->pos_args[i], &value)) return false;
+		if (!store(ev, value, field_type(ev, decl->fields[i].value), (AST_Node*) call, &agg->items[i])) return false;
+		given[i] = true;
+	}
+	for (int i = 0; i < shlen(call->kw_args); i++) {
+		ptrdiff_t f = FIND_KEY(decl->fields, call->kw_args[i].key);
+		if (f < 0) return eval_error(ev, (AST_Node*) call, "%s has no field '%s'", symbol->name, call->kw_args[i].key);
+		Value value;
+		if (!eval_expr(ev, &call->kw_args[i].value, &value)) return false;
+		if (!store(ev, value, field_type(ev, decl->fields[f].value), (AST_Node*) call, &agg->items[f])) return false;
+		given[f] = true;
+	}
+	if (!fill_fields(ev, decl, agg, given, (AST_Node*) call)) return false;
+	*out = (Value) { .c = { .type = type_nominal(ev->eval->table, TYPE_KIND_STRUCT, symbol->decl, symbol->name) }, .agg = agg };
+	return true;
+}
+
+static bool eval_cast(Evaluator* ev, AST_FuncCall* call, TypeId to, Value* out) {
+	TypeTable table = ev->eval->table;
+	if (kind_of(ev, to) == TYPE_KIND_VECTOR) return not_at_compile_time(ev, (AST_Node*) call, "Vectors can't be made at compile time");
+	if (arrlen(call->pos_args) != 1 || shlen(call->kw_args)) return eval_error(ev, (AST_Node*) call, "A cast to %s takes one value", type_name(table, to));
+	Value value;
+	if (!eval_expr(ev, &call->pos_args[0], &value)) return false;
+	if (value.agg) return not_at_compile_time(ev, (AST_Node*) call, "A %s can't be cast at compile time", type_name(table, value.c.type));
+	out->agg = NULL;
+	return cast_scalar(ev, value.c, to, (AST_Node*) call, &out->c);
+}
+
+// === Intrinsics ===
+
+// Functions on numbers the evaluator runs itself, where they aren't declared in the module
+typedef enum {
+	INTRINSIC_BIT_AND,
+	INTRINSIC_BIT_OR,
+	INTRINSIC_BIT_XOR,
+	INTRINSIC_BIT_NOT,
+	INTRINSIC_SHIFT_LEFT,
+	INTRINSIC_SHIFT_RIGHT,
+	INTRINSIC_ABS,
+	INTRINSIC_MIN,
+	INTRINSIC_MAX,
+	INTRINSIC_SQRT,
+	INTRINSIC_SIN,
+	INTRINSIC_COS,
+	INTRINSIC_TAN,
+	INTRINSIC_EXP,
+	INTRINSIC_LOG,
+	INTRINSIC_FLOOR,
+	INTRINSIC_CEIL,
+	INTRINSIC_LEN,
+	INTRINSIC_COUNT,
+} Intrinsic;
+
+static const struct {
+	const char* name;
+	int n_args;
+} INTRINSICS[INTRINSIC_COUNT] = {
+	[INTRINSIC_BIT_AND] = { "bit_and", 2 },
+	[INTRINSIC_BIT_OR] = { "bit_or", 2 },
+	[INTRINSIC_BIT_XOR] = { "bit_xor", 2 },
+	[INTRINSIC_BIT_NOT] = { "bit_not", 1 },
+	[INTRINSIC_SHIFT_LEFT] = { "shift_left", 2 },
+	[INTRINSIC_SHIFT_RIGHT] = { "shift_right", 2 },
+	[INTRINSIC_ABS] = { "abs", 1 },
+	[INTRINSIC_MIN] = { "min", 2 },
+	[INTRINSIC_MAX] = { "max", 2 },
+	[INTRINSIC_SQRT] = { "sqrt", 1 },
+	[INTRINSIC_SIN] = { "sin", 1 },
+	[INTRINSIC_COS] = { "cos", 1 },
+	[INTRINSIC_TAN] = { "tan", 1 },
+	[INTRINSIC_EXP] = { "exp", 1 },
+	[INTRINSIC_LOG] = { "log", 1 },
+	[INTRINSIC_FLOOR] = { "floor", 1 },
+	[INTRINSIC_CEIL] = { "ceil", 1 },
+	[INTRINSIC_LEN] = { "len", 1 },
+};
+
+static int find_intrinsic(const char* name) {
+	for (int i = 0; i < INTRINSIC_COUNT; i++) {
+		if (strcmp(INTRINSICS[i].name, name) == 0) return i;
+	}
+	return -1;
+}
+
+static bool call_intrinsic(Evaluator* ev, AST_FuncCall* call, Intrinsic intrinsic, Value* out) {
+	TypeTable table = ev->eval->table;
+	const AST_Node* at = (AST_Node*) call;
+	const char* name = INTRINSICS[intrinsic].name;
+	if (arrlen(call->pos_args) != INTRINSICS[intrinsic].n_args || shlen(call->kw_args)) {
+		return not_at_compile_time(ev, at, "'%s' takes %d arguments at compile time", name, INTRINSICS[intrinsic].n_args);
+	}
+	Value args[2];
+	for (int i = 0; i < INTRINSICS[intrinsic].n_args; i++) {
+		if (!eval_expr(ev, &call->pos_args[i], &args[i])) return false;
+	}
+	if (intrinsic == INTRINSIC_LEN) {
+		if (!args[0].agg || kind_of(ev, args[0].c.type) != TYPE_KIND_ARRAY) return not_at_compile_time(ev, at, "'len' of %s can't be evaluated at compile time", type_name(table, args[0].c.type));
+		*out = scalar((Constant) { .type = TYPE_INT, .i = args[0].agg->n });
+		return true;
+	}
+	Constant a = args[0].c, b = args[1].c;
+	bool binary = INTRINSICS[intrinsic].n_args == 2;
+	if (args[0].agg || (binary && args[1].agg)) return not_at_compile_time(ev, at, "'%s' of arrays or structs can't be evaluated at compile time", name);
+	if (binary && intrinsic != INTRINSIC_SHIFT_LEFT && intrinsic != INTRINSIC_SHIFT_RIGHT && !constant_common_type(table, &a, &b)) {
+		return not_at_compile_time(ev, at, "'%s' of %s and %s can't be evaluated at compile time", name, type_name(table, a.type), type_name(table, b.type));
+	}
+	TypeKind kind = kind_of(ev, a.type);
+	Constant result = { .type = a.type };
+	out->agg = NULL;
+	switch (intrinsic) {
+		case INTRINSIC_BIT_AND:
+		case INTRINSIC_BIT_OR:
+		case INTRINSIC_BIT_XOR:
+		case INTRINSIC_BIT_NOT: {
+			if (!is_integer_kind(kind)) break;
+			uint64_t x = (uint64_t) a.i, y = (uint64_t) b.i;
+			uint64_t bits = intrinsic == INTRINSIC_BIT_AND? x & y : intrinsic == INTRINSIC_BIT_OR? x | y : intrinsic == INTRINSIC_BIT_XOR? x ^ y : ~x;
+			result.i = constant_wrap(table, a.type, bits);
+			out->c = result;
+			return true;
+		}
+		case INTRINSIC_SHIFT_LEFT:
+		case INTRINSIC_SHIFT_RIGHT: {
+			if (!is_integer_kind(kind) || !is_integer_kind(kind_of(ev, b.type))) break;
+			if (kind_of(ev, b.type) == TYPE_KIND_SINT && b.i < 0) return eval_error(ev, at, "Values can't be shifted by %lld bits", (long long) b.i);
+			uint64_t by = (uint64_t) b.i, x = (uint64_t) a.i;
+			int bits = type_get(table, a.type)->bits;
+			if (intrinsic == INTRINSIC_SHIFT_LEFT) result.i = constant_wrap(table, a.type, by >= 64? 0 : x << by);
+			// Signed values keep their sign
+			else if (kind == TYPE_KIND_SINT && a.i < 0) result.i = by >= (uint64_t) bits? -1 : (int64_t) ~(~x >> by);
+			else result.i = by >= 64? 0 : (int64_t) (x >> by);
+			out->c = result;
+			return true;
+		}
+		case INTRINSIC_ABS:
+			if (kind == TYPE_KIND_FLOAT) result.f = fabs(a.f);
+			else if (kind == TYPE_KIND_SINT) result.i = a.i < 0? constant_wrap(table, a.type, 0 - (uint64_t) a.i) : a.i;
+			else if (kind == TYPE_KIND_UINT) result.i = a.i;
+			else break;
+			out->c = result;
+			return true;
+		case INTRINSIC_MIN:
+		case INTRINSIC_MAX: {
+			if (!is_number_kind(kind)) break;
+			int order = kind == TYPE_KIND_FLOAT? (a.f > b.f) - (a.f < b.f) : constant_compare(table, "<", a, b);
+			bool first = intrinsic == INTRINSIC_MIN? order <= 0 : order >= 0;
+			out->c = first? a : b;
+			out->c.literal = false;
+			return true;
+		}
+		default: {
+			if (!is_number_kind(kind)) break;
+			double x = constant_to_double(table, &a), y;
+			switch (intrinsic) {
+				case INTRINSIC_SQRT: y = sqrt(x); break;
+				case INTRINSIC_SIN: y = sin(x); break;
+				case INTRINSIC_COS: y = cos(x); break;
+				case INTRINSIC_TAN: y = tan(x); break;
+				case INTRINSIC_EXP: y = exp(x); break;
+				case INTRINSIC_LOG: y = log(x); break;
+				case INTRINSIC_FLOOR: y = floor(x); break;
+				default: y = ceil(x); break;
+			}
+			if (!isfinite(y)) return eval_error(ev, at, "'%s' of %g isn't a finite number", name, x);
+			// F32 stays F32; anything else is worked out as F64
+			result.type = a.type == TYPE_F32? TYPE_F32 : TYPE_FLOAT;
+			result.f = result.type == TYPE_F32? (float) y : y;
+			out->c = result;
+			return true;
+		}
+	}
+	return not_at_compile_time(ev, at, "'%s' of %s can't be evaluated at compile time", name, type_name(table, a.type));
+}
+
+static bool eval_call(Evaluator* ev, AST_Node* const* slot, Value* out) {
+	ConstEval eval = ev->eval;
+	AST_FuncCall* call = (AST_FuncCall*) *slot;
+	if (call->func->node_type == NODE_QUALNAME) {
+		const AST_Qualname* qn = (const AST_Qualname*) call->func;
+		ResolvedName found = resolution_lookup(eval->res, &call->func);
+		if (found.symbol && found.n_parts == arrlen(qn->parts)) {
+			const Symbol* symbol = resolution_symbol(eval->res, found.symbol);
+			if (symbol->kind == DECL_FUNCTION) return call_function(ev, call, found.symbol, out);
+			// Resolved statically by the check
+			SymbolId target = symbol->kind == DECL_OVERLOAD? typecheck_call_target(eval->check, (AST_Node*) call) : 0;
+			if (target) return call_function(ev, call, target, out);
+			if (symbol->kind == DECL_STRUCT) return make_struct(ev, call, symbol, out);
+		}
+		else if (!found.symbol && arrlen(qn->parts) == 1) {
+			TypeId cast = type_builtin(eval->table, qn->parts[0]);
+			if (cast) return eval_cast(ev, call, cast, out);
+			int intrinsic = eval->has_using_imports? -1 : find_intrinsic(qn->parts[0]);
+			if (intrinsic >= 0) return call_intrinsic(ev, call, intrinsic, out);
+		}
+	}
+	return not_at_compile_time(ev, *slot, "Only the module's functions and structs, casts and intrinsics can be called at compile time");
+}
+
+// === Expressions ===
+
+static bool eval_subscript(Evaluator* ev, AST_Subscript* sub, Value* out) {
+	Value array;
+	if (!eval_expr(ev, &sub->array, &array)) return false;
+	Value* at = &array;
+	for (int i = 0; i < arrlen(sub->subscripts); i++) {
+		Value index;
+		if (sub->subscripts[i]->node_type == NODE_SLICE) return not_at_compile_time(ev, (AST_Node*) sub, "Slices can't be made at compile time");
+		if (!eval_expr(ev, &sub->subscripts[i], &index) || !element(ev, at, index, (AST_Node*) sub, &at)) return false;
+	}
+	*out = *at;
+	return true;
+}
+
+static bool eval_array(Evaluator* ev, AST_Node* const* slot, Value* out) {
+	ConstEval eval = ev->eval;
+	AST_ArrayLiteral* array = (AST_ArrayLiteral*) *slot;
+	TypeId type = type_unqualified(eval->table, typecheck_expr_type(eval->check, slot));
+	if (kind_of(ev, type) != TYPE_KIND_ARRAY) return not_at_compile_time(ev, *slot, "The type of this array isn't known");
+	TypeId element = element_of(eval->table, type);
+	int n = arrlen(array->elements);
+	Aggregate* agg = new_aggregate(&ev->scratch, n);
+	for (int i = 0; i < n; i++) {
+		Value value;
+		if (!eval_expr(ev, &array->elements[i], &value) || !store(ev, value, element, *slot, &agg->items[i])) return false;
+	}
+	*out = (Value) { .c = { .type = type }, .agg = agg };
+	return true;
+}
+
+static Value packed_rows(Evaluator* ev, const AST_PackedArray* packed, int dim, TypeId type, size_t* next) {
+	size_t n = packed->shape[dim];
+	Aggregate* agg = new_aggregate(&ev->scratch, n);
+	TypeId element = element_of(ev->eval->table, type);
+	for (size_t i = 0; i < n; i++) {
+		if (dim + 1 < arrlen(packed->shape)) agg->items[i] = packed_rows(ev, packed, dim + 1, element, next);
+		else if (packed->kind == PACKED_INT) agg->items[i] = scalar((Constant) { .type = TYPE_INT, .literal = true, .i = packed->ints[(*next)++] });
+		else agg->items[i] = scalar((Constant) { .type = TYPE_FLOAT, .literal = true, .f = packed->floats[(*next)++] });
+	}
+	return (Value) { .c = { .type = type }, .agg = agg };
+}
+
+static bool eval_packed(Evaluator* ev, AST_Node* const* slot, Value* out) {
+	const AST_PackedArray* packed = (const AST_PackedArray*) *slot;
+	size_t total = 1;
+	for (int i = 0; i < arrlen(packed->shape); i++) total *= packed->shape[i];
+	if (!arrlen(packed->shape) || total > EVAL_MAX_MEMORY / sizeof(Value)) return not_at_compile_time(ev, *slot, "This array can't be made at compile time");
+	size_t next = 0;
+	*out = packed_rows(ev, packed, 0, type_unqualified(ev->eval->table, typecheck_expr_type(ev->eval->check, slot)), &next);
+	return true;
+}
+
+static bool eval_expr(Evaluator* ev, AST_Node* const* slot, Value* out) {
+	AST_Node* node = *slot;
+	if (!ast_is_shared(node)) ev->where = node;
+	*out = (Value) {0};
+	switch (node->node_type) {
+		case NODE_INT: out->c = (Constant) { .type = TYPE_INT, .literal = true, .i = ((AST_Int*) node)->value }; return true;
+		case NODE_FLOAT: out->c = (Constant) { .type = TYPE_FLOAT, .literal = true, .f = (double) ((AST_Float*) node)->value }; return true;
+		case NODE_BOOL: out->c = (Constant) { .type = TYPE_BOOL, .literal = true, .b = ((AST_Bool*) node)->value }; return true;
+		case NODE_STRING: out->c = (Constant) { .type = TYPE_STRING, .literal = true, .s = ((AST_String*) node)->value }; return true;
+		case NODE_CHAR: out->c = (Constant) { .type = TYPE_RUNE, .i = ((AST_Char*) node)->value }; return true;
+		case NODE_QUALNAME: return eval_name(ev, slot, out);
+		case NODE_BINOP: {
+			AST_Binop* binop = (AST_Binop*) node;
+			// Custom operators are overloads
+			if (binop->op[1] || !strchr("+-*/%^", binop->op[0])) return not_at_compile_time(ev, node, "Operator '%s' can't be evaluated at compile time", binop->op);
+			Value a, b;
+			if (!eval_expr(ev, &binop->lhs, &a) || !eval_expr(ev, &binop->rhs, &b)) return false;
+			return arithmetic(ev, node, binop->op[0], a, b, out);
+		}
+		case NODE_UNARY: {
+			AST_Unary* unary = (AST_Unary*) node;
+			Value value;
+			if (!eval_expr(ev, &unary->expr, &value)) return false;
+			Constant negated = value.agg? CONSTANT_UNKNOWN : constant_negate(ev->eval->table, value.c);
+			if ((strcmp(unary->op, "-") && strcmp(unary->op, "+")) || !constant_is_known(&negated)) {
+				return not_at_compile_time(ev, node, "Operator '%s' can't be evaluated at compile time", unary->op);
+			}
+			out->c = unary->op[0] == '-'? negated : value.c;
+			return true;
+		}
+		case NODE_COMPARISON: return eval_comparison(ev, (AST_ComparisonChain*) node, out);
+		case NODE_NOT: {
+			bool b;
+			if (!eval_condition(ev, &((AST_Not*) node)->expr, &b)) return false;
+			*out = bool_value(!b);
+			return true;
+		}
+		case NODE_AND:
+		case NODE_OR: {
+			AST_And* logic = (AST_And*) node;
+			bool a, b;
+			if (!eval_condition(ev, &logic->lhs, &a)) return false;
+			// The right side isn't evaluated if the left one decides
+			if (a == (node->node_type == NODE_OR)) *out = bool_value(a);
+			else if (!eval_condition(ev, &logic->rhs, &b)) return false;
+			else *out = bool_value(b);
+			return true;
+		}
+		case NODE_TERNARY: {
+			AST_Ternary* ternary = (AST_Ternary*) node;
+			bool condition;
+			Value value;
+			if (!eval_condition(ev, &ternary->condition, &condition)) return false;
+			if (!eval_expr(ev, condition? &ternary->true_expr : &ternary->false_expr, &value)) return false;
+			return store(ev, value, typecheck_expr_type(ev->eval->check, slot), node, out);
+		}
+		case NODE_FUNC_CALL: return eval_call(ev, slot, out);
+		case NODE_SUBSCRIPT: return eval_subscript(ev, (AST_Subscript*) node, out);
+		case NODE_FIELD_ACCESS: {
+			AST_FieldAccess* access = (AST_FieldAccess*) node;
+			Value base;
+			if (!eval_expr(ev, &access->base, &base)) return false;
+			Value* at = &base;
+			for (int i = 0; i < arrlen(access->field->parts); i++) {
+				if (!field_of(ev, at, access->field->parts[i], node, &at)) return false;
+			}
+			*out = *at;
+			return true;
+		}
+		case NODE_ARRAY: return eval_array(ev, slot, out);
+		case NODE_PACKED_ARRAY: return eval_packed(ev, slot, out);
+		default:
+			return not_at_compile_time(ev, node, "This can't be evaluated at compile time");
+	}
+}
+
+// === Statements ===
+
+typedef struct {
+	const char* field;  // NULL for an element
+	Value index;
+} PlaceStep;
+
+/// Where the value a variable, or a field or element of one, is held
+static bool place_of(Evaluator* ev, AST_Node* const* slot, Value** out) {
+	// From the outside in, working out the indices first, as running them may move the locals
+	PlaceStep steps[EVAL_MAX_PATH];
+	int n = 0;
+	AST_Node* const* at = slot;
+	while ((*at)->node_type == NODE_SUBSCRIPT || (*at)->node_type == NODE_FIELD_ACCESS) {
+		if ((*at)->node_type == NODE_SUBSCRIPT) {
+			AST_Subscript* sub = (AST_Subscript*) *at;
+			for (int i = arrlen(sub->subscripts) - 1; i >= 0; i--) {
+				if (n == EVAL_MAX_PATH) return not_at_compile_time(ev, *slot, "This is nested too deep to be assigned to at compile time");
+				if (sub->subscripts[i]->node_type == NODE_SLICE) return not_at_compile_time(ev, *slot, "Slices can't be assigned to at compile time");
+				steps[n].field = NULL;
+				if (!eval_expr(ev, &sub->subscripts[i], &steps[n++].index)) return false;
+			}
+			at = &sub->array;
+		}
+		else {
+			AST_FieldAccess* access = (AST_FieldAccess*) *at;
+			for (int i = arrlen(access->field->parts) - 1; i >= 0; i--) {
+				if (n == EVAL_MAX_PATH) return not_at_compile_time(ev, *slot, "This is nested too deep to be assigned to at compile time");
+				steps[n++].field = access->field->parts[i];
+			}
+			at = &access->base;
+		}
+	}
+	if ((*at)->node_type != NODE_QUALNAME) return not_at_compile_time(ev, *slot, "Only variables, fields and elements can be assigned to at compile time");
+	const AST_Qualname* qn = (const AST_Qualname*) *at;
+	ResolvedName found = resolution_lookup(ev->eval->res, at);
+	for (int i = arrlen(qn->parts) - 1; i >= found.n_parts && found.symbol; i--) {
+		if (n == EVAL_MAX_PATH) return not_at_compile_time(ev, *slot, "This is nested too deep to be assigned to at compile time");
+		steps[n++].field = qn->parts[i];
+	}
+	ptrdiff_t local = found.symbol? find_local(ev, found.symbol) : -1;
+	if (local < 0) return not_at_compile_time(ev, *slot, "Only local variables can be assigned to at compile time");
+	Value* place = &ev->locals[local].value;
+	for (int i = n - 1; i >= 0; i--) {
+		bool ok = steps[i].field? field_of(ev, place, steps[i].field, *slot, &place) : element(ev, place, steps[i].index, *slot, &place);
+		if (!ok) return false;
+	}
+	*out = place;
+	return true;
+}
+
+/// Stores a value where it is assigned, as the type of what was there
+static bool assign(Evaluator* ev, AST_Node* const* dest, Value value, const AST_Node* at) {
+	Value* place;
+	Value stored;
+	if (!place_of(ev, dest, &place) || !store(ev, value, place->c.type, at, &stored)) return false;
+	*place = stored;
+	return true;
+}
+
+/// Whether a loop goes on once its body has run. A break or skip of an outer loop is left in `flow`.
+static bool loop_continues(Evaluator* ev, Flow* flow, const AST_Name* label) {
+	if (*flow == FLOW_BREAK || *flow == FLOW_SKIP) {
+		if (ev->label && (!label || strcmp(ev->label, label->name))) return false;
+		ev->label = NULL;
+		bool skip = *flow == FLOW_SKIP;
+		*flow = FLOW_NEXT;
+		return skip;
+	}
+	return *flow == FLOW_NEXT;
+}
+
+static Flow exec_block(Evaluator* ev, AST_Block* block) {
+	ptrdiff_t n_locals = arrlen(ev->locals);
+	Flow flow = FLOW_NEXT;
+	for (int i = 0; i < arrlen(block->body) && flow == FLOW_NEXT; i++) flow = exec(ev, &block->body[i]);
+	arrsetlen(ev->locals, n_locals);
+	return flow;
+}
+
+static bool integer_bound(Evaluator* ev, AST_Node* const* slot, TypeId type, int64_t* out) {
+	Value value;
+	Constant c;
+	if (!eval_expr(ev, slot, &value)) return false;
+	if (value.agg || !is_integer_kind(kind_of(ev, value.c.type))) return not_at_compile_time(ev, *slot, "Bounds must be integers");
+	if (!cast_scalar(ev, value.c, type, *slot, &c)) return false;
+	*out = c.i;
+	return true;
+}
+
+static Flow exec_for_range(Evaluator* ev, AST_ForLoop* loop, AST_ForRange* range) {
+	TypeTable table = ev->eval->table;
+	SymbolId id = declared_symbol(ev, &range->name);
+	TypeId type = type_unqualified(table, typecheck_symbol_type(ev->eval->check, id));
+	if (!is_integer_kind(kind_of(ev, type))) type = TYPE_INT;
+	int64_t start = 0, end, step = 1;
+	if (range->start && !integer_bound(ev, &range->start, type, &start)) return FLOW_ERROR;
+	if (!range->end) return not_at_compile_time(ev, (AST_Node*) range, "Ranges without an end can't be run at compile time"), FLOW_ERROR;
+	if (!integer_bound(ev, &range->end, type, &end)) return FLOW_ERROR;
+	// The step may go down, whatever the type
+	if (range->step && !integer_bound(ev, &range->step, TYPE_INT, &step)) return FLOW_ERROR;
+	if (!step) return eval_error(ev, (AST_Node*) range, "A range with a step of 0 never ends"), FLOW_ERROR;
+	arrput(ev->locals, ((Local) { id, scalar((Constant) { .type = type, .i = start }) }));
+	ptrdiff_t var = arrlen(ev->locals) - 1;
+	Flow flow = FLOW_NEXT;
+	for (int64_t i = start; ; ) {
+		bool more = step > 0? (range->is_inclusive? i <= end : i < end) : (range->is_inclusive? i >= end : i > end);
+		if (!more) break;
+		ev->locals[var].value = scalar((Constant) { .type = type, .i = i });
+		flow = exec(ev, (AST_Node* const*) &loop->body);
+		if (!loop_continues(ev, &flow, loop->label)) break;
+		if (step > 0? i > INT64_MAX - step : i < INT64_MIN - step) break;
+		i += step;
+	}
+	return flow;
+}
+
+static Flow exec_for(Evaluator* ev, AST_ForLoop* loop) {
+	// Parallel loops are run one iteration after the other, which is one of the orders they may run in
+	if (arrlen(loop->iterables) != 1) return not_at_compile_time(ev, (AST_Node*) loop, "Loops over more than one range can't be run at compile time"), FLOW_ERROR;
+	AST_Node* iterable = loop->iterables[0];
+	ptrdiff_t n_locals = arrlen(ev->locals);
+	Flow flow = FLOW_NEXT;
+	if (iterable->node_type == NODE_FOR_RANGE) flow = exec_for_range(ev, loop, (AST_ForRange*) iterable);
+	else if (iterable->node_type == NODE_FOR_SIMPLE) {
+		AST_ForSimple* simple = (AST_ForSimple*) iterable;
+		Value array;
+		if (!eval_expr(ev, &simple->iterable, &array)) return FLOW_ERROR;
+		if (!array.agg || kind_of(ev, array.c.type) != TYPE_KIND_ARRAY) {
+			return not_at_compile_time(ev, iterable, "Only arrays can be looped over at compile time"), FLOW_ERROR;
+		}
+		SymbolId id = simple->name? declared_symbol(ev, &simple->name) : 0;
+		TypeId type = typecheck_symbol_type(ev->eval->check, id);
+		arrput(ev->locals, ((Local) { .id = id }));
+		ptrdiff_t var = arrlen(ev->locals) - 1;
+		for (int64_t i = 0; i < array.agg->n; i++) {
+			Value item;
+			if (!store(ev, array.agg->items[i], type, iterable, &item)) return FLOW_ERROR;
+			ev->locals[var].value = item;
+			flow = exec(ev, (AST_Node* const*) &loop->body);
+			if (!loop_continues(ev, &flow, loop->label)) break;
+		}
+	}
+	else return not_at_compile_time(ev, iterable, "This loop can't be run at compile time"), FLOW_ERROR;
+	arrsetlen(ev->locals, n_locals);
+	return flow;
+}
+
+static Flow exec_var_decl(Evaluator* ev, AST_VarDecl* var) {
+	SymbolId id = declared_symbol(ev, &var->name);
+	TypeId type = type_unqualified(ev->eval->table, typecheck_symbol_type(ev->eval->check, id));
+	Value value;
+	bool ok = var->value? eval_expr(ev, &var->value, &value) && store(ev, value, type, (AST_Node*) var, &value) : zero_value(ev, type, (AST_Node*) var, &value);
+	if (!ok) return FLOW_ERROR;
+	arrput(ev->locals, ((Local) { id, value }));
+	return FLOW_NEXT;
+}
+
+/// The message of an assertion or failure, if it has one that is a string
+static const char* message_of(Evaluator* ev, AST_Node* const* slot) {
+	Value message;
+	if (!*slot || !eval_expr(ev, slot, &message)) return NULL;
+	return !message.agg && message.c.type == TYPE_STRING? message.c.s : NULL;
+}
+
+static Flow exec(Evaluator* ev, AST_Node* const* slot) {
+	AST_Node* node = *slot;
+	if (!ast_is_shared(node)) ev->where = node;
+	if (++ev->steps > EVAL_MAX_STEPS) return eval_error(ev, node, "Gave up after %d steps, as it may never end", EVAL_MAX_STEPS), FLOW_ERROR;
+	if (ev->scratch.used > EVAL_MAX_MEMORY) return eval_error(ev, node, "Uses more than %d MB", (int) (EVAL_MAX_MEMORY >> 20)), FLOW_ERROR;
+	switch (node->node_type) {
+		case NODE_BLOCK: return exec_block(ev, (AST_Block*) node);
+		case NODE_VAR_DECL: return exec_var_decl(ev, (AST_VarDecl*) node);
+		case NODE_ASSIGN: {
+			AST_AssignChain* chain = (AST_AssignChain*) node;
+			Value value;
+			if (!eval_expr(ev, &chain->src_expr, &value)) return FLOW_ERROR;
+			for (int i = 0; i < arrlen(chain->dest_exprs); i++) {
+				if (!assign(ev, &chain->dest_exprs[i], value, node)) return FLOW_ERROR;
+			}
+			return FLOW_NEXT;
+		}
+		case NODE_ASSIGN_MANY: {
+			AST_AssignParallel* parallel = (AST_AssignParallel*) node;
+			int n = arrlen(parallel->dest_exprs);
+			if (n != arrlen(parallel->src_exprs)) return eval_error(ev, node, "%d values are assigned to %d destinations", (int) arrlen(parallel->src_exprs), n), FLOW_ERROR;
+			// All of them are worked out before any is assigned, so a, b = b, a swaps
+			Value* values = arena_alloc(&ev->scratch, (n + 1) * sizeof(Value));
+			for (int i = 0; i < n; i++) {
+				if (!eval_expr(ev, &parallel->src_exprs[i], &values[i]) || !store(ev, values[i], TYPE_UNKNOWN, node, &values[i])) return FLOW_ERROR;
+			}
+			for (int i = 0; i < n; i++) {
+				if (!assign(ev, &parallel->dest_exprs[i], values[i], node)) return FLOW_ERROR;
+			}
+			return FLOW_NEXT;
+		}
+		case NODE_OP_ASSIGN: {
+			AST_OpAssign* op_assign = (AST_OpAssign*) node;
+			const char* op = op_assign->op;
+			if (op[1] || !strchr("+-*/%^", op[0])) return not_at_compile_time(ev, node, "Operator '%s=' can't be evaluated at compile time", op), FLOW_ERROR;
+			Value value, result, stored;
+			Value* place;
+			if (!eval_expr(ev, &op_assign->src_expr, &value) || !place_of(ev, &op_assign->dest_expr, &place)) return FLOW_ERROR;
+			if (!arithmetic(ev, node, op[0], *place, value, &result) || !store(ev, result, place->c.type, node, &stored)) return FLOW_ERROR;
+			*place = stored;
+			return FLOW_NEXT;
+		}
+		case NODE_IF_STMT: {
+			AST_IfStatement* stmt = (AST_IfStatement*) node;
+			bool condition;
+			if (!eval_condition(ev, &stmt->condition, &condition)) return FLOW_ERROR;
+			if (condition) return exec(ev, (AST_Node* const*) &stmt->body);
+			return stmt->alternative? exec(ev, &stmt->alternative) : FLOW_NEXT;
+		}
+		case NODE_WHILE_LOOP: {
+			AST_WhileLoop* loop = (AST_WhileLoop*) node;
+			Flow flow = FLOW_NEXT;
+			while (1) {
+				bool condition;
+				if (!eval_condition(ev, &loop->condition, &condition)) return FLOW_ERROR;
+				if (!condition) return FLOW_NEXT;
+				flow = exec(ev, (AST_Node* const*) &loop->body);
+				if (!loop_continues(ev, &flow, NULL)) return flow;
+			}
+		}
+		case NODE_FOR_LOOP: return exec_for(ev, (AST_ForLoop*) node);
+		case NODE_RETURN: {
+			AST_Return* ret = (AST_Return*) node;
+			ev->returned = scalar((Constant) { .type = TYPE_VOID });
+			if (ret->value && !eval_expr(ev, &ret->value, &ev->returned)) return FLOW_ERROR;
+			return FLOW_RETURN;
+		}
+		case NODE_BREAK:
+		case NODE_SKIP: {
+			AST_Name* label = node->node_type == NODE_BREAK? ((AST_Break*) node)->label : ((AST_Skip*) node)->label;
+			ev->label = label? label->name : NULL;
+			return node->node_type == NODE_BREAK? FLOW_BREAK : FLOW_SKIP;
+		}
+		case NODE_ASSERT: {
+			AST_Assert* assert = (AST_Assert*) node;
+			bool holds;
+			if (!eval_condition(ev, &assert->value, &holds)) return FLOW_ERROR;
+			if (holds) return FLOW_NEXT;
+			const char* message = message_of(ev, &assert->message);
+			if (ev->error) return FLOW_ERROR;
+			return eval_error(ev, node, message? "Assertion failed: %s" : "Assertion failed", message), FLOW_ERROR;
+		}
+		case NODE_FAIL: {
+			const char* message = message_of(ev, &((AST_Fail*) node)->message);
+			if (ev->error) return FLOW_ERROR;
+			return eval_error(ev, node, message? "Failed: %s" : "Failed", message), FLOW_ERROR;
+		}
+		// Conditions are for the analysis of the code, not checks of it
+		case NODE_CONTRACT:
+			return FLOW_NEXT;
+		// Declarations do nothing where they are
+		case NODE_CONST:
+		case NODE_FUNC_DEF:
+		case NODE_STRUCT:
+		case NODE_ENUM:
+		case NODE_MACRO:
+		case NODE_FUNC_OVERLOAD:
+		case NODE_IMPORT:
+			return FLOW_NEXT;
+		default: {
+			Value ignored;
+			return eval_expr(ev, slot, &ignored)? FLOW_NEXT : FLOW_ERROR;
+		}
+	}
+}
+
+// === Order ===
+
+static bool is_ordered(const Symbol* symbol) {
+	return symbol->kind == DECL_CONST || symbol->kind == DECL_FUNCTION || symbol->kind == DECL_STRUCT || symbol->kind == DECL_ENUM;
+}
+
+typedef struct {
+	Resolution res;
+	TypeCheck check;
+	SymbolId ARRAY* uses;  // of the declaration being walked
+} UseWalk;
+
+static WalkAction collect_uses(AST_Node** slot, void* ctx) {
+	UseWalk* walk = ctx;
+	// Calls of overloads, and operators of the module's types, go to the functions they resolve to
+	SymbolId target = typecheck_call_target(walk->check, *slot);
+	if (target) arrput(*walk->uses, target);
+	if ((*slot)->node_type != NODE_QUALNAME) return WALK_CONTINUE;
+	SymbolId id = resolution_lookup(walk->res, slot).symbol;
+	if (id && is_ordered(resolution_symbol(walk->res, id))) arrput(*walk->uses, id);
+	return WALK_CONTINUE;
+}
+
+typedef struct {
+	SymbolId id;
+	int next;  // of its uses, the one to look at next
+} TarjanFrame;
+
+/// Gives each constant the level it is evaluated at: one more than the highest of those it
+/// depends on, through the functions it calls and the structs and enums it uses. Constants
+/// that depend on themselves are errors; they and those that depend on them get -1.
+static int* order_constants(ConstEval eval, int n_symbols) {
+	Resolution res = eval->res;
+	SymbolId ARRAY* uses = calloc(n_symbols, sizeof(SymbolId ARRAY));
+	UseWalk walk = { res, eval->check, NULL };
+	AST_Visitor visitor = { collect_uses, NULL, &walk };
+	for (SymbolId id = 1; id < n_symbols; id++) {
+		const Symbol* symbol = resolution_symbol(res, id);
+		if (!is_ordered(symbol)) continue;
+		walk.uses = &uses[id];
+		AST_Node* decl = symbol->decl;
+		AST_Node** root = symbol->kind == DECL_CONST? &((AST_Const*) decl)->value : &decl;
+		if (*root) ast_walk_iterative(root, &visitor);
+	}
+
+	// Tarjan's strongly connected components, which it finds after those they depend on
+	int* index = malloc(n_symbols * sizeof(int));
+	int* low = malloc(n_symbols * sizeof(int));
+	int* component = malloc(n_symbols * sizeof(int));
+	bool* on_stack = calloc(n_symbols, sizeof(bool));
+	for (int i = 0; i < n_symbols; i++) index[i] = -1;
+	SymbolId ARRAY stack = NULL;
+	SymbolId ARRAY members = NULL;  // by component
+	int ARRAY first_member = NULL;
+	TarjanFrame ARRAY calls = NULL;
+	int next_index = 0;
+	for (SymbolId root = 1; root < n_symbols; root++) {
+		if (index[root] >= 0 || !is_ordered(resolution_symbol(res, root))) continue;
+		arrput(calls, ((TarjanFrame) { root, 0 }));
+		index[root] = low[root] = next_index++;
+		arrput(stack, root);
+		on_stack[root] = true;
+		while (arrlen(calls)) {
+			TarjanFrame* top = &arrlast(calls);
+			SymbolId v = top->id;
+			if (top->next < arrlen(uses[v])) {
+				SymbolId w = uses[v][top->next++];
+				if (index[w] < 0) {
+					index[w] = low[w] = next_index++;
+					arrput(stack, w);
+					on_stack[w] = true;
+					arrput(calls, ((TarjanFrame) { w, 0 }));
+				}
+				else if (on_stack[w] && index[w] < low[v]) low[v] = index[w];
+				continue;
+			}
+			if (low[v] == index[v]) {
+				arrput(first_member, arrlen(members));
+				SymbolId w;
+				do {
+					w = arrpop(stack);
+					on_stack[w] = false;
+					component[w] = arrlen(first_member) - 1;
+					arrput(members, w);
+				} while (w != v);
+			}
+			(void) arrpop(calls);
+			if (arrlen(calls) && low[v] < low[arrlast(calls).id]) low[arrlast(calls).id] = low[v];
+		}
+	}
+
+	// Components come after those they depend on, so one pass gives the levels
+	int n_components = arrlen(first_member);
+	arrput(first_member, arrlen(members));
+	int* reach = malloc((n_components + 1) * sizeof(int));      // the highest level of a constant it depends on
+	int* level = malloc((n_components + 1) * sizeof(int));      // of its constant, if it is one
+	bool* failed = calloc(n_components + 1, sizeof(bool));
+	int* levels = malloc(n_symbols * sizeof(int));
+	for (int i = 0; i < n_symbols; i++) levels[i] = -1;
+	for (int c = 0; c < n_components; c++) {
+		reach[c] = level[c] = -1;
+		bool cyclic = first_member[c + 1] - first_member[c] > 1;
+		for (int m = first_member[c]; m < first_member[c + 1]; m++) {
+			SymbolId v = members[m];
+			for (int i = 0; i < arrlen(uses[v]); i++) {
+				int d = component[uses[v][i]];
+				if (d == c) {
+					cyclic = true;
+					continue;
+				}
+				failed[c] = failed[c] || failed[d];
+				if (reach[d] > reach[c]) reach[c] = reach[d];
+				if (level[d] > reach[c]) reach[c] = level[d];
+			}
+		}
+		for (int m = first_member[c]; m < first_member[c + 1]; m++) {
+			const Symbol* symbol = resolution_symbol(res, members[m]);
+			if (symbol->kind != DECL_CONST) continue;
+			if (cyclic) {
+				Evaluator* ev = &eval->evaluators[0];
+				size_t length = strlen(symbol->name) + 64;
+				char* message = malloc(length);
+				snprintf(message, length, "The value of '%s' depends on itself", symbol->name);
+				add_diagnostic(ev, (AST_Node*) symbol->name_node, message);
+				failed[c] = true;
+			}
+			else if (!failed[c]) level[c] = levels[members[m]] = reach[c] + 1;
+		}
+	}
+
+	for (int i = 0; i < n_symbols; i++) arrfree(uses[i]);
+	free(uses);
+	free(index);
+	free(low);
+	free(component);
+	free(on_stack);
+	arrfree(stack);
+	arrfree(members);
+	arrfree(first_member);
+	arrfree(calls);
+	free(reach);
+	free(level);
+	free(failed);
+	return levels;
+}
+
+// === Evaluation ===
+
+static void eval_const(void* ctx, int task, int worker) {
+	ConstEval eval = ctx;
+	Evaluator* ev = &eval->evaluators[worker];
+	SymbolId id = eval->batch[task];
+	const Symbol* symbol = resolution_symbol(eval->res, id);
+	AST_Const* constant = (AST_Const*) symbol->decl;
+	begin_evaluation(ev, (AST_Node*) constant, symbol->name);
+	Value value;
+	if (eval_expr(ev, &constant->value, &value) && store(ev, value, typecheck_symbol_type(eval->check, id), (AST_Node*) constant, &value)) {
+		eval->values[id] = persist(&ev->kept, value);
+		eval->states[id] = CONST_DONE;
+	}
+	else eval->states[id] = CONST_FAILED;
+	end_evaluation(ev);
+}
+
+static void run_statement(ConstEval eval, AST_Run* run) {
+	Evaluator* ev = &eval->evaluators[0];
+	begin_evaluation(ev, (AST_Node*) run, NULL);
+	Flow flow = exec(ev, &run->statement);
+	if (flow == FLOW_BREAK || flow == FLOW_SKIP) eval_error(ev, run->statement, "'%s' outside of a loop", flow == FLOW_BREAK? "break" : "skip");
+	if (!ev->error) eval->n_runs++;
+	end_evaluation(ev);
+}
+
+// === Baking ===
+
+static AST_Node* new_node(ConstEval eval, NodeType type, const AST_Node* at) {
+	AST_Node* node = arena_alloc(&eval->nodes, AST_LAYOUT[type].size);
+	node->node_type = type;
+	node->src_file = at->src_file;
+	node->start_line = at->start_line;
+	node->start_col = at->start_col;
+	node->end_line = at->end_line;
+	node->end_col = at->end_col;
+	return node;
+}
+
+/// The type a literal of the scalar would have, or TYPE_UNKNOWN if it has none
+static TypeId literal_type(ConstEval eval, const Constant* c) {
+	switch (type_get(eval->table, c->type)->kind) {
+		case TYPE_KIND_SINT: return TYPE_INT;
+		case TYPE_KIND_UINT: return c->i >= 0? TYPE_INT : TYPE_UNKNOWN;
+		case TYPE_KIND_FLOAT: return TYPE_FLOAT;
+		case TYPE_KIND_BOOL: return TYPE_BOOL;
+		case TYPE_KIND_STRING: return TYPE_STRING;
+		default: return TYPE_UNKNOWN;
+	}
+}
+
+static AST_Node* scalar_literal(ConstEval eval, const Constant* c, const AST_Node* at) {
+	switch (literal_type(eval, c)) {
+		case TYPE_INT: {
+			AST_Int* lit = (AST_Int*) new_node(eval, NODE_INT, at);
+			lit->value = c->i;
+			return (AST_Node*) lit;
+		}
+		case TYPE_FLOAT: {
+			AST_Float* lit = (AST_Float*) new_node(eval, NODE_FLOAT, at);
+			lit->value = c->f;
+			return (AST_Node*) lit;
+		}
+		case TYPE_BOOL: {
+			AST_Bool* lit = (AST_Bool*) new_node(eval, NODE_BOOL, at);
+			lit->value = c->b;
+			return (AST_Node*) lit;
+		}
+		default: {
+			AST_String* lit = (AST_String*) new_node(eval, NODE_STRING, at);
+			lit->value = c->s;
+			return (AST_Node*) lit;
+		}
+	}
+}
+
+/// The elements of a rectangular array, in row-major order, if they are all scalars of one type
+static bool collect_leaves(Value v, const int64_t* shape, int n_dims, int dim, Constant ARRAY* leaves) {
+	if (dim == n_dims) {
+		if (v.agg || (arrlen(*leaves) && v.c.type != (*leaves)[0].type)) return false;
+		arrput(*leaves, v.c);
+		return true;
+	}
+	if (!v.agg || v.agg->n != shape[dim]) return false;
+	for (int64_t i = 0; i < v.agg->n; i++) {
+		if (!collect_leaves(v.agg->items[i], shape, n_dims, dim + 1, leaves)) return false;
+	}
+	return true;
+}
+
+static AST_Node* nested_literal(ConstEval eval, const int64_t* shape, int n_dims, int dim, const Constant* leaves, size_t* next, const AST_Node* at) {
+	if (dim == n_dims) return scalar_literal(eval, &leaves[(*next)++], at);
+	AST_ArrayLiteral* array = (AST_ArrayLiteral*) new_node(eval, NODE_ARRAY, at);
+	for (int64_t i = 0; i < shape[dim]; i++) arrput(array->elements, nested_literal(eval, shape, n_dims, dim + 1, leaves, next, at));
+	return (AST_Node*) array;
+}
+
+/// A node for the type, for constants whose literals would have another
+static AST_Node* type_node(ConstEval eval, TypeId type, const AST_Node* at) {
+	const Type* t = type_get(eval->table, type);
+	switch (t->kind) {
+		case TYPE_KIND_SINT:
+		case TYPE_KIND_UINT:
+		case TYPE_KIND_FLOAT:
+		case TYPE_KIND_BOOL:
+		case TYPE_KIND_STRING: {
+			// The table may be gone before the tree
+			const char* spelling = type_name(eval->table, type);
+			char* name = arena_alloc(&eval->nodes, strlen(spelling) + 1);
+			strcpy(name, spelling);
+			AST_Qualname* qn = (AST_Qualname*) new_node(eval, NODE_QUALNAME, at);
+			arrput(qn->parts, name);
+			AST_SimpleType* simple = (AST_SimpleType*) new_node(eval, NODE_SIMPLE_TYPE, at);
+			simple->base = qn;
+			return (AST_Node*) simple;
+		}
+		case TYPE_KIND_ARRAY: {
+			AST_Node* element = type_node(eval, t->base, at);
+			if (!element) return NULL;
+			AST_ArrayType* array = (AST_ArrayType*) new_node(eval, NODE_ARRAY_TYPE, at);
+			array->element_type = element;
+			array->is_dynamic = t->is_dynamic;
+			int n_extents;
+			const int64_t* extents = type_extents(eval->table, type, &n_extents);
+			for (int i = 0; i < n_extents && !t->is_dynamic; i++) {
+				AST_Int* extent = extents[i] >= 0? (AST_Int*) new_node(eval, NODE_INT, at) : NULL;
+				if (extent) extent->value = extents[i];
+				arrput(array->shape, (AST_Node*) extent);
+			}
+			return (AST_Node*) array;
+		}
+		default:
+			return NULL;
+	}
+}
+
+/// Puts the literal of a constant's value in place of the expression it is defined by:
+/// a literal for a scalar, and a packed array (or array literals, of Bools and Strings) for
+/// a rectangular array. The constant gets a type if the literal would have another.
+static void bake(ConstEval eval, SymbolId id) {
+	AST_Const* constant = (AST_Const*) resolution_symbol(eval->res, id)->decl;
+	switch (constant->value->node_type) {
+		case NODE_INT:
+		case NODE_FLOAT:
+		case NODE_BOOL:
+		case NODE_STRING:
+		case NODE_PACKED_ARRAY:
+			return;
+		default: break;
+	}
+	Value value = eval->values[id];
+	const AST_Node* at = ast_is_shared(constant->value)? (AST_Node*) constant : constant->value;
+	AST_Node* literal;
+	TypeId type;
+	if (!value.agg) {
+		type = literal_type(eval, &value.c);
+		if (type == TYPE_UNKNOWN) return;
+		literal = scalar_literal(eval, &value.c, at);
+	}
+	else {
+		if (type_get(eval->table, value.c.type)->kind != TYPE_KIND_ARRAY) return;
+		int64_t ARRAY shape = NULL;
+		for (Value v = value; v.agg && type_get(eval->table, v.c.type)->kind == TYPE_KIND_ARRAY && v.agg->n; v = v.agg->items[0]) arrput(shape, v.agg->n);
+		Constant ARRAY leaves = NULL;
+		int n_dims = arrlen(shape);
+		TypeId element = n_dims && collect_leaves(value, shape, n_dims, 0, &leaves)? literal_type(eval, &leaves[0]) : TYPE_UNKNOWN;
+		for (int i = 0; i < arrlen(leaves) && element == TYPE_INT; i++) {
+			if (literal_type(eval, &leaves[i]) != TYPE_INT) element = TYPE_UNKNOWN;
+		}
+		if (element == TYPE_UNKNOWN) {
+			arrfree(shape);
+			arrfree(leaves);
+			return;
+		}
+		if (element == TYPE_INT || element == TYPE_FLOAT) {
+			AST_PackedArray* packed = (AST_PackedArray*) new_node(eval, NODE_PACKED_ARRAY, at);
+			packed->kind = element == TYPE_INT? PACKED_INT : PACKED_FLOAT;
+			for (int i = 0; i < n_dims; i++) arrput(packed->shape, (size_t) shape[i]);
+			for (int i = 0; i < arrlen(leaves); i++) {
+				if (element == TYPE_INT) arrput(packed->ints, leaves[i].i);
+				else arrput(packed->floats, leaves[i].f);
+			}
+			literal = (AST_Node*) packed;
+		}
+		else {
+			size_t next = 0;
+			literal = nested_literal(eval, shape, n_dims, 0, leaves, &next, at);
+		}
+		type = type_array(eval->table, element, n_dims, shape, false);
+		arrfree(shape);
+		arrfree(leaves);
+	}
+	if (!constant->type && type != value.c.type) {
+		constant->type = type_node(eval, value.c.type, at);
+		if (!constant->type) {
+			ast_free_owned_shallow(literal);
+			return;
+		}
+	}
+	AST_Node* old = constant->value;
+	constant->value = literal;
+	// The nodes stay in their parser's arenas, but the arrays of the subtree are no longer reachable
+	ast_free_owned(&old);
+	eval->n_baked++;
+}
+
+ConstEval consteval_module(AST_Module* module, Resolution res, TypeCheck check, TypeTable table, TaskPool pool) {
+	ConstEval eval = calloc(1, sizeof(struct _const_eval));
+	eval->res = res;
+	eval->check = check;
+	eval->table = table;
+	for (int i = 0; i < shlen(module->scope); i++) {
+		AST_Node* item = module->scope[i].value;
+		if (item->node_type == NODE_IMPORT && ((AST_Import*) item)->is_using) eval->has_using_imports = true;
+	}
+	int n_symbols = resolution_symbol_count(res) + 1;
+	arrsetlen(eval->values, n_symbols);
+	arrsetlen(eval->states, n_symbols);
+	memset(eval->states, CONST_PENDING, n_symbols);
+	pthread_mutex_init(&eval->memo_lock, NULL);
+	eval->n_evaluators = pool? task_pool_size(pool) : 1;
+	eval->evaluators = calloc(eval->n_evaluators, sizeof(Evaluator));
+	for (int i = 0; i < eval->n_evaluators; i++) eval->evaluators[i].eval = eval;
+
+	// Level by level, the constants of each evaluated in parallel
+	int* levels = order_constants(eval, n_symbols);
+	for (int level = 0; ; level++) {
+		if (eval->batch) stbds_header(eval->batch)->length = 0;
+		bool deeper = false;
+		for (SymbolId id = 1; id < n_symbols; id++) {
+			if (levels[id] == level && ((AST_Const*) resolution_symbol(res, id)->decl)->value) arrput(eval->batch, id);
+			deeper = deeper || levels[id] > level;
+		}
+		if (pool) task_pool_run(pool, arrlen(eval->batch), eval_const, eval);
+		else {
+			for (int i = 0; i < arrlen(eval->batch); i++) eval_const(eval, i, 0);
+		}
+		if (!deeper) break;
+	}
+	free(levels);
+	arrfree(eval->batch);
+
+	for (int i = 0; i < shlen(module->scope); i++) {
+		AST_Node* item = module->scope[i].value;
+		if (item->node_type == NODE_RUN) run_statement(eval, (AST_Run*) item);
+	}
+
+	Diagnostic ARRAY diagnostics = NULL;
+	for (int i = 0; i < eval->n_evaluators; i++) {
+		Evaluator* ev = &eval->evaluators[i];
+		for (int j = 0; j < arrlen(ev->diagnostics); j++) {
+			ev->diagnostics[j].order = arrlen(diagnostics);
+			arrput(diagnostics, ev->diagnostics[j]);
+		}
+		arrfree(ev->diagnostics);
+		arrfree(ev->locals);
+	}
+	eval->n_errors = arrlen(diagnostics);
+	report_diagnostics(diagnostics, arrlen(diagnostics));
+	for (int i = 0; i < arrlen(diagnostics); i++) free(diagnostics[i].message);
+	arrfree(diagnostics);
+
+	for (SymbolId id = 1; id < n_symbols; id++) {
+		if (eval->states[id] != CONST_DONE) continue;
+		eval->n_constants++;
+		if (!eval->n_errors) bake(eval, id);
+	}
+	return eval;
+}
+
+void consteval_destroy(ConstEval eval) {
+	if (!eval) return;
+	for (int i = 0; i < eval->n_evaluators; i++) arena_free(&eval->evaluators[i].kept);
+	free(eval->evaluators);
+	pthread_mutex_destroy(&eval->memo_lock);
+	free(eval->memo);
+	arena_free(&eval->memo_arena);
+	arena_free(&eval->nodes);
+	arrfree(eval->values);
+	arrfree(eval->states);
+	free(eval);
+}
+
+int consteval_error_count(ConstEval eval) {
+	return eval->n_errors;
+}
+
+int consteval_constant_count(ConstEval eval) {
+	return eval->n_constants;
+}
+
+int consteval_baked_count(ConstEval eval) {
+	return eval->n_baked;
+}
+
+int consteval_run_count(ConstEval eval) {
+	return eval->n_runs;
+}
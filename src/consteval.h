@@ -0,0 +1,32 @@
+#pragma once
+// Compile-time evaluation: the values of constants are worked out by running the code they
+// are defined with, and '#run' statements are run, once a module has type-checked
+#include "ast.h"
+#include "resolve.h"
+#include "typecheck.h"
+#include "types.h"
+#include "pool.h"
+
+typedef struct _const_eval* ConstEval;
+
+/// Evaluates the constants of a module that type-checked without errors, then runs its
+/// '#run' statements in order. Constants may call the module's functions, which are run with
+/// value semantics and without side effects, so calls with the same scalar arguments are
+/// only run once. Constants that don't depend on each other are evaluated in parallel on
+/// the pool's threads (on this one with NULL), and ones that depend on themselves are errors.
+/// Constants that use what can't be run at compile time (imports, pointers, overloads...)
+/// are left for run time; failed assertions, bad indices and the like are errors, which
+/// are reported to stderr in the order of the source.
+/// Values of numbers, Bool and String, and rectangular arrays of them, are put in the tree
+/// as literals in place of the expressions they came from. The handle owns those, so it
+/// must outlive the module.
+ConstEval consteval_module(AST_Module* module, Resolution res, TypeCheck check, TypeTable table, TaskPool pool);
+void consteval_destroy(ConstEval eval);
+
+int consteval_error_count(ConstEval eval);
+/// Constants whose values were worked out
+int consteval_constant_count(ConstEval eval);
+/// Of those, the ones now defined by a literal
+int consteval_baked_count(ConstEval eval);
+/// '#run' statements run to completion
+int consteval_run_count(ConstEval eval);
@@ -0,0 +1,2084 @@
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "emit_c.h"
+#include "ast_walk.h"
+#include "util.h"
+#include "stb_ds.h"
+
+// === Runtime ===
+// Written at the top of every translation unit, all of it inline so what goes unused is
+// dropped quietly. Generated code only calls rh_ names, so locals named after the C library
+// (pow, free...) can't hide what it calls.
+
+static const char RUNTIME[] =
+	"#include <inttypes.h>\n"
+	"#include <math.h>\n"
+	"#include <stdbool.h>\n"
+	"#include <stddef.h>\n"
+	"#include <stdint.h>\n"
+	"#include <stdio.h>\n"
+	"#include <stdlib.h>\n"
+	"#include <string.h>\n"
+	"\n"
+	"#ifdef __GNUC__\n"
+	"#define RH_ASSUME(c) do { if (!(c)) __builtin_unreachable(); } while (0)\n"
+	"#define RH_UNLIKELY(c) __builtin_expect(!!(c), 0)\n"
+	"#define RH_UNUSED __attribute__((unused))\n"
+	"#else\n"
+	"#define RH_ASSUME(c) ((void) 0)\n"
+	"#define RH_UNLIKELY(c) (c)\n"
+	"#define RH_UNUSED\n"
+	"#endif\n"
+	"\n"
+	"typedef struct { const char* data; int64_t len; } rh_string;\n"
+	"#define RH_STR(s) ((rh_string) { (s), sizeof(s) - 1 })\n"
+	"#define RH_STR_INIT(s) { (s), sizeof(s) - 1 }\n"
+	"\n"
+	"static inline _Noreturn void rh_fail(const char* file, int line, const char* what, rh_string message) {\n"
+	"\tfflush(stdout);\n"
+	"\tfprintf(stderr, \"%s:%d: %s%s%.*s\\n\", file, line, what, message.len? \": \" : \"\", (int) message.len, message.data? message.data : \"\");\n"
+	"\texit(1);\n"
+	"}\n"
+	"\n"
+	"static inline _Noreturn void rh_index_error(int64_t start, int64_t end, int64_t n, const char* file, int line) {\n"
+	"\tfflush(stdout);\n"
+	"\tif (end < 0) fprintf(stderr, \"%s:%d: Index %\" PRId64 \" is out of bounds for length %\" PRId64 \"\\n\", file, line, start, n);\n"
+	"\telse fprintf(stderr, \"%s:%d: Slice %\" PRId64 \"..<%\" PRId64 \" is out of bounds for length %\" PRId64 \"\\n\", file, line, start, end, n);\n"
+	"\texit(1);\n"
+	"}\n"
+	"\n"
+	"static inline int64_t rh_check(int64_t i, int64_t n, const char* file, int line) {\n"
+	"\tif (RH_UNLIKELY((uint64_t) i >= (uint64_t) n)) rh_index_error(i, -1, n, file, line);\n"
+	"\treturn i;\n"
+	"}\n"
+	"\n"
+	"// The start of a slice from start to before end\n"
+	"static inline int64_t rh_check_slice(int64_t start, int64_t end, int64_t n, const char* file, int line) {\n"
+	"\tif (RH_UNLIKELY(start < 0 || end < start || end > n)) rh_index_error(start, end, n, file, line);\n"
+	"\treturn start;\n"
+	"}\n"
+	"\n"
+	"static inline int rh_string_cmp(rh_string a, rh_string b) {\n"
+	"\tint order = a.len && b.len? memcmp(a.data, b.data, a.len < b.len? a.len : b.len) : 0;\n"
+	"\treturn order? order : (a.len > b.len) - (a.len < b.len);\n"
+	"}\n"
+	"\n"
+	"static inline bool rh_string_eq(rh_string a, rh_string b) {\n"
+	"\treturn a.len == b.len && rh_string_cmp(a, b) == 0;\n"
+	"}\n"
+	"\n"
+	"// Integers wrap, as they do at compile time\n"
+	"static inline uint64_t rh_upow(uint64_t base, uint64_t e) {\n"
+	"\tuint64_t result = 1;\n"
+	"\tfor (; e; e >>= 1, base *= base) {\n"
+	"\t\tif (e & 1) result *= base;\n"
+	"\t}\n"
+	"\treturn result;\n"
+	"}\n"
+	"\n"
+	"static inline int64_t rh_ipow(int64_t base, int64_t e) {\n"
+	"\treturn (int64_t) rh_upow((uint64_t) base, (uint64_t) e);\n"
+	"}\n"
+	"\n"
+	"static inline double rh_pow(double a, double b) { return pow(a, b); }\n"
+	"static inline float rh_powf(float a, float b) { return powf(a, b); }\n"
+	"static inline double rh_fmod(double a, double b) { return fmod(a, b); }\n"
+	"static inline float rh_fmodf(float a, float b) { return fmodf(a, b); }\n"
+	"\n"
+	"// The builtins min, max, abs and the shifts; shifts by 64 or more leave 0, or the sign\n"
+	"static inline int64_t rh_min(int64_t a, int64_t b) { return a < b? a : b; }\n"
+	"static inline int64_t rh_max(int64_t a, int64_t b) { return a > b? a : b; }\n"
+	"static inline uint64_t rh_umin(uint64_t a, uint64_t b) { return a < b? a : b; }\n"
+	"static inline uint64_t rh_umax(uint64_t a, uint64_t b) { return a > b? a : b; }\n"
+	"static inline int64_t rh_abs(int64_t a) { return a < 0? (int64_t) (0 - (uint64_t) a) : a; }\n"
+	"static inline uint64_t rh_shl(uint64_t a, uint64_t n) { return n < 64? a << n : 0; }\n"
+	"static inline int64_t rh_shr(int64_t a, uint64_t n) { return n < 64? a >> n : a >> 63; }\n"
+	"static inline uint64_t rh_ushr(uint64_t a, uint64_t n) { return n < 64? a >> n : 0; }\n"
+	"\n"
+	"// The primary allocator\n"
+	"static inline void* rh_alloc(size_t size) {\n"
+	"\tvoid* p = calloc(1, size? size : 1);\n"
+	"\tif (!p) {\n"
+	"\t\tfputs(\"Out of memory\\n\", stderr);\n"
+	"\t\texit(1);\n"
+	"\t}\n"
+	"\treturn p;\n"
+	"}\n"
+	"\n"
+	"static inline void* rh_copy(void* to, const void* from, size_t size) {\n"
+	"\treturn memcpy(to, from, size);\n"
+	"}\n"
+	"\n"
+	"static inline void rh_free(void* p) { free(p); }\n"
+	"\n"
+	"// The temporary allocator of the thread, a stack: functions give back what they took of it when\n"
+	"// they return. What doesn't fit is taken from the primary allocator, and never given back.\n"
+	"#define RH_TEMP_SIZE ((size_t) 64 << 20)\n"
+	"static _Thread_local char* rh_temp_base;\n"
+	"static _Thread_local size_t rh_temp_used;\n"
+	"\n"
+	"static inline size_t rh_temp_mark(void) { return rh_temp_used; }\n"
+	"static inline void rh_temp_release(size_t mark) { rh_temp_used = mark; }\n"
+	"\n"
+	"static inline void* rh_temp_alloc(size_t size) {\n"
+	"\tif (!rh_temp_base) rh_temp_base = rh_alloc(RH_TEMP_SIZE);\n"
+	"\tsize = (size + 15) & ~(size_t) 15;\n"
+	"\tif (size > RH_TEMP_SIZE - rh_temp_used) return rh_alloc(size);\n"
+	"\tvoid* p = rh_temp_base + rh_temp_used;\n"
+	"\trh_temp_used += size;\n"
+	"\treturn memset(p, 0, size);\n"
+	"}\n"
+	"\n"
+	"static inline void rh_print_text(const char* text) { fputs(text, stdout); }\n"
+	"static inline void rh_print_int(int64_t x) { printf(\"%\" PRId64, x); }\n"
+	"static inline void rh_print_uint(uint64_t x) { printf(\"%\" PRIu64, x); }\n"
+	"static inline void rh_print_float(double x) { printf(\"%g\", x); }\n"
+	"static inline void rh_print_bool(bool x) { fputs(x? \"true\" : \"false\", stdout); }\n"
+	"static inline void rh_print_string(rh_string s) { fwrite(s.data, 1, (size_t) s.len, stdout); }\n"
+	"\n"
+	"static inline void rh_print_rune(int32_t r) {\n"
+	"\tchar utf8[4];\n"
+	"\tint n = 0;\n"
+	"\tif (r < 0x80) utf8[n++] = (char) r;\n"
+	"\telse if (r < 0x800) {\n"
+	"\t\tutf8[n++] = (char) (0xC0 | r >> 6);\n"
+	"\t\tutf8[n++] = (char) (0x80 | (r & 0x3F));\n"
+	"\t}\n"
+	"\telse if (r < 0x10000) {\n"
+	"\t\tutf8[n++] = (char) (0xE0 | r >> 12);\n"
+	"\t\tutf8[n++] = (char) (0x80 | (r >> 6 & 0x3F));\n"
+	"\t\tutf8[n++] = (char) (0x80 | (r & 0x3F));\n"
+	"\t}\n"
+	"\telse {\n"
+	"\t\tutf8[n++] = (char) (0xF0 | r >> 18);\n"
+	"\t\tutf8[n++] = (char) (0x80 | (r >> 12 & 0x3F));\n"
+	"\t\tutf8[n++] = (char) (0x80 | (r >> 6 & 0x3F));\n"
+	"\t\tutf8[n++] = (char) (0x80 | (r & 0x3F));\n"
+	"\t}\n"
+	"\tfwrite(utf8, 1, n, stdout);\n"
+	"}\n";
+
+// === Generator ===
+
+typedef struct {
+	const char* src_file;
+	int line, start_col, end_col;
+	char* message;
+} Diagnostic;
+
+/// C text, and the line of the source the C compiler takes its next line to be; 0 until a
+/// '#line' directive is written
+typedef struct {
+	char ARRAY text;
+	int line;
+} Output;
+
+typedef struct {
+	const char* label;  // or NULL
+	int id;
+	bool releases;      // gives back what each iteration took of the temporary allocator
+} Loop;
+
+typedef struct {
+	AST_Module* module;
+	Resolution res;
+	TypeCheck check;
+	TypeTable table;
+	Lowering lower;
+	EscapeAnalysis esc;
+	AliasAnalysis alias;
+	Bounds bounds;
+	char* line_file;  // the source file, as a C string literal
+	Output forward, types, decls, code;
+	Output* out;      // where expressions and statements are written
+	struct { TypeId key; char* value; } MAP type_names;
+	struct { const char* key; char* value; } MAP idents;  // C identifiers for names of the source
+	char** names;          // C names of symbols, by id
+	uint8_t ARRAY emitted;  // by symbol: functions queued and declared, constants defined
+	SymbolId ARRAY queue;   // functions to define, in the order they were first used
+	Diagnostic ARRAY errors;
+	int indent;
+	int n_temps;
+	bool initializer;  // writing the value of a constant, which C wants constant
+	// Of the function being written
+	SymbolId func;
+	TypeId ret_type;
+	bool has_mark;                // took a mark of the temporary allocator
+	uint8_t ARRAY rebound;        // by symbol: assigned as a whole, or had its address taken
+	uint8_t ARRAY restrict_data;  // by symbol: an array parameter read through a restrict pointer
+	Loop ARRAY loops;
+} Generator;
+
+static char* format(const char* fmt, ...) {
+	va_list args;
+	va_start(args, fmt);
+	int length = vsnprintf(NULL, 0, fmt, args);
+	va_end(args);
+	char* text = malloc(length + 1);
+	va_start(args, fmt);
+	vsnprintf(text, length + 1, fmt, args);
+	va_end(args);
+	return text;
+}
+
+static void output_vprintf(Output* o, const char* fmt, va_list args) {
+	va_list copy;
+	va_copy(copy, args);
+	int length = vsnprintf(NULL, 0, fmt, copy);
+	va_end(copy);
+	ptrdiff_t at = arrlen(o->text), size = at + length + 1;
+	arrsetlen(o->text, size);
+	vsnprintf(o->text + at, length + 1, fmt, args);
+	arrsetlen(o->text, size - 1);
+	for (int i = 0; o->line && i < length; i++) {
+		if (o->text[at + i] == '\n') o->line++;
+	}
+}
+
+static void output_printf(Output* o, const char* fmt, ...) {
+	va_list args;
+	va_start(args, fmt);
+	output_vprintf(o, fmt, args);
+	va_end(args);
+}
+
+static void emit(Generator* g, const char* fmt, ...) {
+	va_list args;
+	va_start(args, fmt);
+	output_vprintf(g->out, fmt, args);
+	va_end(args);
+}
+
+/// Starts a line of code for a node, with a '#line' directive where the C compiler would
+/// otherwise take it to be on another line of the source
+static void begin(Generator* g, const AST_Node* at) {
+	if (at && at->start_line && (int) at->start_line != g->out->line) {
+		emit(g, "#line %d %s\n", (int) at->start_line, g->line_file);
+		g->out->line = at->start_line;
+	}
+	for (int i = 0; i < g->indent; i++) emit(g, "\t");
+}
+
+static void unsupported(Generator* g, const AST_Node* at, const char* fmt, ...) {
+	va_list args;
+	va_start(args, fmt);
+	int length = vsnprintf(NULL, 0, fmt, args);
+	va_end(args);
+	char* message = malloc(length + 1);
+	va_start(args, fmt);
+	vsnprintf(message, length + 1, fmt, args);
+	va_end(args);
+	Diagnostic diagnostic = { at->src_file, at->start_line, at->start_col, at->end_line > at->start_line? -1 : (int) at->end_col, message };
+	arrput(g->errors, diagnostic);
+}
+
+static int compare_diagnostics(const void* a, const void* b) {
+	const Diagnostic* x = a;
+	const Diagnostic* y = b;
+	if (x->line != y->line) return x->line < y->line? -1 : 1;
+	return (x->start_col > y->start_col) - (x->start_col < y->start_col);
+}
+
+static void report_errors(Diagnostic* errors, int n) {
+	if (!n) return;
+	qsort(errors, n, sizeof(Diagnostic), compare_diagnostics);
+	char* source = (char*) read_entire_file(errors[0].src_file);
+	const char* ARRAY lines = NULL;
+	for (char* p = source; p && *p; p++) {
+		if (p == source) arrput(lines, p);
+		if (*p != '\n') continue;
+		*p = 0;
+		arrput(lines, p + 1);
+	}
+	for (int i = 0; i < n; i++) {
+		const Diagnostic* d = &errors[i];
+		fprintf(stderr, "In '%s' at line %d, column %d...\n  Codegen error: %s\n", d->src_file, d->line, d->start_col, d->message);
+		if (d->line >= 1 && d->line <= arrlen(lines)) {
+			const char* line = lines[d->line - 1];
+			show_error_line(stderr, line, d->line, d->start_col, d->end_col < 0? (int) strlen(line) : d->end_col);
+		}
+	}
+	free(source);
+	arrfree(lines);
+}
+
+// === Names ===
+
+static bool is_reserved(const char* name) {
+	static const char* const reserved[] = {
+		"auto", "break", "case", "char", "const", "continue", "default", "do", "double", "else", "enum", "extern",
+		"float", "for", "goto", "if", "inline", "int", "long", "register", "restrict", "return", "short", "signed",
+		"sizeof", "static", "struct", "switch", "typedef", "union", "unsigned", "void", "volatile", "while",
+		"bool", "true", "false", "NULL", "main", "assert", "errno", "stdin", "stdout", "stderr", "EOF", "offsetof",
+		"alignas", "alignof", "noreturn", "static_assert", "thread_local", "complex", "imaginary", "I",
+		"INFINITY", "NAN", "HUGE_VAL",
+	};
+	for (size_t i = 0; i < sizeof(reserved) / sizeof(*reserved); i++) {
+		if (strcmp(name, reserved[i]) == 0) return true;
+	}
+	size_t length = strlen(name);
+	// Typedefs of the C library, the runtime's names, and what C keeps for itself
+	return (length > 2 && strcmp(name + length - 2, "_t") == 0) || strncmp(name, "rh_", 3) == 0 || strncmp(name, "RH_", 3) == 0
+		|| (name[0] == '_' && (name[1] == '_' || (name[1] >= 'A' && name[1] <= 'Z')));
+}
+
+/// The C identifier for a name of the source
+static const char* c_ident(Generator* g, const char* name) {
+	ptrdiff_t i = shgeti(g->idents, name);
+	if (i >= 0) return g->idents[i].value;
+	char* ident = name[0] == '_' && is_reserved(name)? format("u%s", name) : is_reserved(name)? format("%s_", name) : format("%s", name);
+	shput(g->idents, name, ident);
+	return ident;
+}
+
+static const char* symbol_name(Generator* g, SymbolId id) {
+	if (g->names[id]) return g->names[id];
+	const Symbol* symbol = resolution_symbol(g->res, id);
+	switch (symbol->kind) {
+		case DECL_FUNCTION:
+			// Operators are named by their symbol
+			g->names[id] = ast_is_operator_name(symbol->name)? format("rh_op%d", (int) id) : format("rh_%s", symbol->name);
+			break;
+		case DECL_CONST:
+			g->names[id] = symbol->scope? format("rh_%s_%d", symbol->name, (int) id) : format("rh_%s", symbol->name);
+			break;
+		default:
+			g->names[id] = format("%s", c_ident(g, symbol->name));
+	}
+	return g->names[id];
+}
+
+static inline SymbolId declared(Generator* g, AST_Name* const* name) {
+	return *name? resolution_lookup(g->res, (AST_Node* const*) name).symbol : 0;
+}
+
+// === Types ===
+
+static inline const Type* type_of(Generator* g, TypeId type) {
+	return type_get(g->table, type);
+}
+
+static inline TypeId type_at(Generator* g, AST_Node* const* slot) {
+	return typecheck_expr_type(g->check, slot);
+}
+
+static TypeId strip_mutable(Generator* g, TypeId type) {
+	while (type_of(g, type)->kind == TYPE_KIND_MUTABLE) type = type_of(g, type)->base;
+	return type;
+}
+
+/// What a value of the type is, past its pointers
+static TypeId value_type(Generator* g, TypeId type) {
+	while (true) {
+		const Type* t = type_of(g, type);
+		if (t->kind != TYPE_KIND_MUTABLE && t->kind != TYPE_KIND_POINTER && t->kind != TYPE_KIND_OPTIONAL) return type;
+		type = t->base;
+	}
+}
+
+/// The pointers on the way to that
+static int pointer_depth(Generator* g, TypeId type) {
+	int depth = 0;
+	while (true) {
+		const Type* t = type_of(g, type);
+		if (t->kind == TYPE_KIND_POINTER) depth++;
+		else if (t->kind != TYPE_KIND_MUTABLE && t->kind != TYPE_KIND_OPTIONAL) return depth;
+		type = t->base;
+	}
+}
+
+static inline TypeKind value_kind(Generator* g, TypeId type) {
+	return type_of(g, value_type(g, type))->kind;
+}
+
+/// The number of elements of an array type whose extents are all known before it runs, or -1
+static int64_t static_size(Generator* g, TypeId type) {
+	const Type* t = type_of(g, type);
+	if (t->kind != TYPE_KIND_ARRAY || t->is_dynamic || t->count < 1) return -1;
+	int count;
+	const int64_t* extents = type_extents(g->table, type, &count);
+	int64_t size = 1;
+	for (int i = 0; i < count; i++) {
+		if (extents[i] < 0) return -1;
+		size *= extents[i];
+	}
+	return size;
+}
+
+static const char* c_type(Generator* g, TypeId type, const AST_Node* at);
+
+static TypeId field_type(Generator* g, const AST_Field* field) {
+	return typecheck_type_of(g->check, field->type);
+}
+
+static const AST_Field* find_field(const AST_Struct* decl, const char* name) {
+	ptrdiff_t i = shgeti(((AST_Struct*) decl)->fields, name);
+	return i < 0? NULL : decl->fields[i].value;
+}
+
+static char* struct_type(Generator* g, TypeId type, const Type* t, const AST_Node* at) {
+	char* name = format("rh_%s", t->name);
+	// Named before its fields are, which may point back to it
+	hmput(g->type_names, type, name);
+	output_printf(&g->forward, "typedef struct %s %s;\n", name, name);
+	const AST_Struct* decl = (const AST_Struct*) t->decl;
+	Output definition = { 0 };
+	output_printf(&definition, "struct %s {\n", name);
+	for (int i = 0; i < shlen(decl->fields); i++) {
+		const AST_Field* field = decl->fields[i].value;
+		output_printf(&definition, "\t%s %s;\n", c_type(g, field_type(g, field), at), c_ident(g, decl->fields[i].key));
+	}
+	if (!shlen(decl->fields)) output_printf(&definition, "\tchar rh_empty;\n");
+	output_printf(&definition, "};\n");
+	arrput(definition.text, 0);
+	output_printf(&g->types, "%s", definition.text);
+	arrfree(definition.text);
+	return name;
+}
+
+static void emit_expr(Generator* g, AST_Node* const* slot);
+
+static char* enum_type(Generator* g, TypeId type, const Type* t) {
+	char* name = format("rh_%s", t->name);
+	hmput(g->type_names, type, name);
+	output_printf(&g->types, "typedef int64_t %s;\n", name);
+	AST_Enum* decl = (AST_Enum*) t->decl;
+	Output* out = g->out;
+	g->out = &g->types;
+	for (int i = 0; i < shlen(decl->fields); i++) {
+		AST_EnumValue* member = decl->fields[i].value;
+		emit(g, "#define %s_%s ((%s) ", name, decl->fields[i].key, name);
+		// The one after the member before, or the next bit of flags
+		if (member->value) emit_expr(g, &member->value);
+		else if (!i) emit(g, decl->is_flags? "1" : "0");
+		else if (decl->is_flags) emit(g, "(%s_%s? %s_%s << 1 : 1)", name, decl->fields[i - 1].key, name, decl->fields[i - 1].key);
+		else emit(g, "(%s_%s + 1)", name, decl->fields[i - 1].key);
+		emit(g, ")\n");
+	}
+	g->out = out;
+	return name;
+}
+
+static char* array_type(Generator* g, TypeId type, const Type* t, const AST_Node* at) {
+	TypeId element = strip_mutable(g, t->base);
+	int count;
+	const int64_t* extents = type_extents(g->table, type, &count);
+	int64_t size = static_size(g, type);
+	// Arrays of the same shape and elements are one C type, however mutable they are
+	int64_t runtime = -1;
+	TypeId same = size >= 0? type_array(g->table, element, count, extents, false) : type_array(g->table, element, 1, &runtime, false);
+	if (size < 0 && t->count != 1) {
+		unsupported(g, at, "Arrays of type %s, of more than one dimension known only at run time, can't be written as C yet", type_name(g->table, type));
+		return NULL;
+	}
+	if (same != type) return format("%s", c_type(g, same, at));
+	const char* of = c_type(g, element, at);
+	char* name = format(size >= 0? "rh_array%d" : "rh_slice%d", (int) type);
+	if (size >= 0) output_printf(&g->types, "typedef struct { %s e[%lld]; } %s;\n", of, (long long) (size? size : 1), name);
+	else output_printf(&g->types, "typedef struct { %s* data; int64_t len; int64_t cap; } %s;\n", of, name);
+	return name;
+}
+
+/// The C type of values of a type; reports types that have none yet
+static const char* c_type(Generator* g, TypeId type, const AST_Node* at) {
+	type = strip_mutable(g, type);
+	ptrdiff_t i = hmgeti(g->type_names, type);
+	if (i >= 0) return g->type_names[i].value;
+	const Type* t = type_of(g, type);
+	char* name = NULL;
+	switch (t->kind) {
+		case TYPE_KIND_VOID: return "void";
+		case TYPE_KIND_BOOL: return "bool";
+		case TYPE_KIND_SINT: return t->bits == 8? "int8_t" : t->bits == 16? "int16_t" : t->bits == 32? "int32_t" : "int64_t";
+		case TYPE_KIND_UINT: return t->bits == 8? "uint8_t" : t->bits == 16? "uint16_t" : t->bits == 32? "uint32_t" : "uint64_t";
+		case TYPE_KIND_FLOAT: return t->bits == 32? "float" : "double";
+		case TYPE_KIND_STRING: return "rh_string";
+		case TYPE_KIND_RUNE: return "int32_t";
+		case TYPE_KIND_NULL:
+		case TYPE_KIND_RAWPTR:
+			return "void*";
+		case TYPE_KIND_POINTER:
+			name = format("%s*", c_type(g, t->base, at));
+			break;
+		case TYPE_KIND_OPTIONAL: {
+			// Pointers that may be null are pointers
+			TypeKind base = type_of(g, strip_mutable(g, t->base))->kind;
+			if (base == TYPE_KIND_POINTER || base == TYPE_KIND_RAWPTR) return c_type(g, t->base, at);
+			unsupported(g, at, "Values of type %s, which may be null, can't be written as C yet", type_name(g->table, type));
+			return "int";
+		}
+		case TYPE_KIND_ARRAY:
+			name = array_type(g, type, t, at);
+			if (!name) return "int";
+			break;
+		case TYPE_KIND_STRUCT: return struct_type(g, type, t, at);
+		case TYPE_KIND_ENUM: return enum_type(g, type, t);
+		case TYPE_KIND_UNKNOWN:
+			unsupported(g, at, "The type of this isn't known, so it can't be written as C");
+			return "int";
+		default:
+			unsupported(g, at, "Values of type %s can't be written as C yet", type_name(g->table, type));
+			return "int";
+	}
+	hmput(g->type_names, type, name);
+	return name;
+}
+
+// === Expressions ===
+
+static void emit_as(Generator* g, AST_Node* const* slot, TypeId want);
+static void need_function(Generator* g, SymbolId id);
+static void need_constant(Generator* g, SymbolId id, const AST_Node* at);
+
+static inline void emit_value(Generator* g, AST_Node* const* slot) {
+	emit_as(g, slot, value_type(g, type_at(g, slot)));
+}
+
+/// Whether an expression can be written twice without doing anything twice
+static bool is_pure(Generator* g, AST_Node* const* slot) {
+	AST_Node* node = *slot;
+	switch (node->node_type) {
+		case NODE_QUALNAME:
+		case NODE_INT:
+		case NODE_FLOAT:
+		case NODE_BOOL:
+		case NODE_CHAR:
+		case NODE_STRING:
+		case NODE_NULL:
+			return true;
+		case NODE_FIELD_ACCESS: return is_pure(g, &((AST_FieldAccess*) node)->base);
+		case NODE_REREFERENCE: return is_pure(g, &((AST_Reref*) node)->target);
+		case NODE_SUBSCRIPT: {
+			AST_Subscript* sub = (AST_Subscript*) node;
+			for (int i = 0; i < arrlen(sub->subscripts); i++) {
+				if (sub->subscripts[i]->node_type == NODE_SLICE || !is_pure(g, &sub->subscripts[i])) return false;
+			}
+			return is_pure(g, &sub->array);
+		}
+		case NODE_BINOP:
+			return !lowering_call(g->lower, node) && is_pure(g, &((AST_Binop*) node)->lhs) && is_pure(g, &((AST_Binop*) node)->rhs);
+		case NODE_UNARY:
+			return !lowering_call(g->lower, node) && is_pure(g, &((AST_Unary*) node)->expr);
+		default:
+			return false;
+	}
+}
+
+static bool require_pure(Generator* g, AST_Node* const* slot, const char* what) {
+	if (is_pure(g, slot)) return true;
+	unsupported(g, *slot, "%s is written twice in C, so it can't have side effects; put it in a variable first", what);
+	return false;
+}
+
+/// Whether an expression is a place in memory, which has an address
+static bool is_addressable(Generator* g, AST_Node* const* slot) {
+	AST_Node* node = *slot;
+	if (node->node_type == NODE_FIELD_ACCESS || node->node_type == NODE_SUBSCRIPT) return true;
+	if (node->node_type == NODE_REREFERENCE) return is_addressable(g, &((AST_Reref*) node)->target);
+	if (node->node_type != NODE_QUALNAME) return false;
+	SymbolId id = resolution_lookup(g->res, slot).symbol;
+	DeclKind kind = id? resolution_symbol(g->res, id)->kind : DECL_IMPORT;
+	return kind == DECL_LOCAL || kind == DECL_PARAM || kind == DECL_LOOP_VAR;
+}
+
+static void emit_string(Generator* g, const char* value) {
+	emit(g, g->initializer? "RH_STR_INIT(\"" : "RH_STR(\"");
+	for (const unsigned char* p = (const unsigned char*) value; *p; p++) {
+		switch (*p) {
+			case '\\': emit(g, "\\\\"); break;
+			case '"': emit(g, "\\\""); break;
+			case '?': emit(g, "\\?"); break;  // not a trigraph
+			case '\n': emit(g, "\\n"); break;
+			case '\t': emit(g, "\\t"); break;
+			case '\r': emit(g, "\\r"); break;
+			default:
+				if (*p < 0x20 || *p == 0x7F) emit(g, "\\%03o", *p);
+				else emit(g, "%c", *p);
+		}
+	}
+	emit(g, "\")");
+}
+
+static void emit_int(Generator* g, intmax_t value) {
+	if (value >= INT32_MIN && value <= INT32_MAX) emit(g, "%jd", value);
+	else if (value == INTMAX_MIN) emit(g, "INT64_MIN");
+	else emit(g, "INT64_C(%jd)", value);
+}
+
+static void emit_float(Generator* g, long double value, bool single) {
+	char text[64];
+	snprintf(text, sizeof(text), "%.17Lg", value);
+	bool exact = strpbrk(text, ".eni") != NULL;
+	emit(g, "%s%s%s", text, exact? "" : ".0", single? "f" : "");
+}
+
+/// Writes `base`, the C of a value of the type, then the fields after it, through the pointers on the way
+static void emit_fields(Generator* g, const char* base, TypeId type, const char* const* fields, int n, const AST_Node* at) {
+	char* text = format("%s", base);
+	for (int i = 0; i < n; i++) {
+		int depth = pointer_depth(g, type);
+		const Type* t = type_of(g, value_type(g, type));
+		const AST_Field* field = t->kind == TYPE_KIND_STRUCT? find_field((const AST_Struct*) t->decl, fields[i]) : NULL;
+		if (!field) {
+			unsupported(g, at, "'%s' of a value of type %s can't be written as C yet", fields[i], type_name(g->table, type));
+			break;
+		}
+		char* next = depth? format("(%.*s%s).%s", depth, "****************", text, c_ident(g, fields[i])) : format("%s.%s", text, c_ident(g, fields[i]));
+		free(text);
+		text = next;
+		type = field_type(g, field);
+	}
+	emit(g, "%s", text);
+	free(text);
+}
+
+/// Writes what an expression writes to another output, and returns that
+static char* capture(Generator* g, AST_Node* const* slot, bool value) {
+	Output* out = g->out;
+	Output captured = { 0 };
+	g->out = &captured;
+	if (value) emit_value(g, slot);
+	else emit_expr(g, slot);
+	g->out = out;
+	arrput(captured.text, 0);
+	char* text = format("%s", captured.text);
+	arrfree(captured.text);
+	return text;
+}
+
+static void emit_qualname(Generator* g, AST_Node* const* slot) {
+	const AST_Qualname* qn = (const AST_Qualname*) *slot;
+	int n = arrlen(qn->parts);
+	ResolvedName found = resolution_lookup(g->res, slot);
+	if (!found.symbol) {
+		unsupported(g, *slot, "'%s' isn't declared in the module, so it can't be written as C", qn->parts[0]);
+		return;
+	}
+	const Symbol* symbol = resolution_symbol(g->res, found.symbol);
+	switch (symbol->kind) {
+		case DECL_CONST:
+			need_constant(g, found.symbol, *slot);
+			// fallthrough
+		case DECL_LOCAL:
+		case DECL_PARAM:
+		case DECL_LOOP_VAR:
+			emit_fields(g, symbol_name(g, found.symbol), typecheck_symbol_type(g->check, found.symbol), qn->parts + found.n_parts,
+				n - found.n_parts, *slot);
+			return;
+		case DECL_ENUM:
+			if (n == found.n_parts + 1) {
+				emit(g, "%s_%s", c_type(g, type_at(g, slot), *slot), qn->parts[found.n_parts]);
+				return;
+			}
+			break;
+		default: break;
+	}
+	unsupported(g, *slot, "'%s' can't be used as a value in C yet", symbol->name);
+}
+
+static void emit_lowered(Generator* g, const LoweredCall* call) {
+	need_function(g, call->target);
+	const AST_FuncDef* def = (const AST_FuncDef*) resolution_symbol(g->res, call->target)->decl;
+	emit(g, "%s(", symbol_name(g, call->target));
+	for (int p = 0; p < call->n_args; p++) {
+		if (p) emit(g, ", ");
+		TypeId param = typecheck_symbol_type(g->check, declared(g, &def->params[p].value->name));
+		if (p != call->vararg) {
+			emit_as(g, call->args[p], param);
+			continue;
+		}
+		// Varargs are an array of them
+		const char* array = c_type(g, param, (AST_Node*) def);
+		if (!call->n_varargs) {
+			emit(g, "((%s) { NULL, 0, 0 })", array);
+			continue;
+		}
+		TypeId element = type_of(g, strip_mutable(g, param))->base;
+		emit(g, "((%s) { (%s[]) { ", array, c_type(g, element, (AST_Node*) def));
+		for (int i = 0; i < call->n_varargs; i++) {
+			if (i) emit(g, ", ");
+			emit_as(g, call->varargs[i], element);
+		}
+		emit(g, " }, %d, 0 })", call->n_varargs);
+	}
+	emit(g, ")");
+}
+
+/// Where an integer operation must be cut down to its type, as C works on int at least
+static bool is_narrow(Generator* g, TypeId type) {
+	const Type* t = type_of(g, value_type(g, type));
+	return (t->kind == TYPE_KIND_SINT || t->kind == TYPE_KIND_UINT) && t->bits < 64;
+}
+
+static void emit_binop(Generator* g, AST_Node* const* slot) {
+	AST_Binop* binop = (AST_Binop*) *slot;
+	const LoweredCall* call = lowering_call(g->lower, *slot);
+	if (call) {
+		emit_lowered(g, call);
+		return;
+	}
+	TypeId type = value_type(g, type_at(g, slot));
+	const Type* t = type_of(g, type);
+	const char* op = binop->op;
+	bool is_float = t->kind == TYPE_KIND_FLOAT, single = is_float && t->bits == 32;
+	bool lhs_bool = value_kind(g, type_at(g, &binop->lhs)) == TYPE_KIND_BOOL, rhs_bool = value_kind(g, type_at(g, &binop->rhs)) == TYPE_KIND_BOOL;
+	if (op[1] || !strchr("+-*/%^", op[0]) || (t->kind != TYPE_KIND_SINT && t->kind != TYPE_KIND_UINT && !is_float)) {
+		unsupported(g, *slot, "Operator '%s' on values of type %s can't be written as C yet", op, type_name(g->table, type));
+		return;
+	}
+	// true * x = x, false * x = the zero of its type
+	if (op[0] == '*' && (lhs_bool || rhs_bool)) {
+		emit(g, "(");
+		emit_value(g, lhs_bool? &binop->lhs : &binop->rhs);
+		emit(g, "? ");
+		emit_as(g, lhs_bool? &binop->rhs : &binop->lhs, type);
+		emit(g, " : 0)");
+		return;
+	}
+	bool narrow = is_narrow(g, type);
+	if (narrow) emit(g, "((%s) ", c_type(g, type, *slot));
+	if (op[0] == '^' || (op[0] == '%' && is_float)) {
+		const char* function = op[0] == '%'? (single? "rh_fmodf" : "rh_fmod") : is_float? (single? "rh_powf" : "rh_pow")
+			: t->kind == TYPE_KIND_UINT? "rh_upow" : "rh_ipow";
+		emit(g, "%s(", function);
+		emit_as(g, &binop->lhs, type);
+		emit(g, ", ");
+		emit_as(g, &binop->rhs, type);
+		emit(g, ")");
+	}
+	else {
+		emit(g, "(");
+		emit_as(g, &binop->lhs, type);
+		emit(g, " %s ", op);
+		emit_as(g, &binop->rhs, type);
+		emit(g, ")");
+	}
+	if (narrow) emit(g, ")");
+}
+
+static void emit_comparison(Generator* g, AST_ComparisonChain* chain) {
+	int n = arrlen(chain->comparisons);
+	if (n > 1) emit(g, "(");
+	for (int i = 0; i < n; i++) {
+		if (i) emit(g, " && ");
+		const LoweredCall* call = lowering_comparison(g->lower, chain, i);
+		if (call) {
+			emit_lowered(g, call);
+			continue;
+		}
+		AST_Node* const* lhs = &chain->operands[i];
+		AST_Node* const* rhs = &chain->operands[i + 1];
+		if (i) require_pure(g, lhs, "The middle of a chain of comparisons");
+		const char* op = chain->comparisons[i];
+		// Pointers are compared with null as they are
+		if ((*lhs)->node_type == NODE_NULL || (*rhs)->node_type == NODE_NULL) {
+			emit(g, "(");
+			emit_expr(g, lhs);
+			emit(g, " %s ", op);
+			emit_expr(g, rhs);
+			emit(g, ")");
+			continue;
+		}
+		if (value_kind(g, type_at(g, lhs)) == TYPE_KIND_STRING) {
+			bool equality = strcmp(op, "==") == 0 || strcmp(op, "!=") == 0;
+			emit(g, equality? "(%srh_string_eq(" : "(rh_string_cmp(", op[0] == '!'? "!" : "");
+			emit_value(g, lhs);
+			emit(g, ", ");
+			emit_value(g, rhs);
+			if (equality) emit(g, "))");
+			else emit(g, ") %s 0)", op);
+			continue;
+		}
+		emit(g, "(");
+		emit_value(g, lhs);
+		emit(g, " %s ", op);
+		emit_value(g, rhs);
+		emit(g, ")");
+	}
+	if (n > 1) emit(g, ")");
+}
+
+static void emit_reref(Generator* g, AST_Reref* reref) {
+	int depth = pointer_depth(g, type_at(g, &reref->target));
+	if (reref->levels <= depth) {
+		int peel = depth - reref->levels;
+		emit(g, "(%.*s", peel, "****************");
+		emit_expr(g, &reref->target);
+		emit(g, ")");
+		return;
+	}
+	if (!is_addressable(g, &reref->target)) unsupported(g, (AST_Node*) reref, "Only variables, fields and elements have an address in C");
+	emit(g, "(&");
+	emit_expr(g, &reref->target);
+	emit(g, ")");
+}
+
+/// The data and the length of an array held by a value of type `type`, written `array`
+static void array_parts(Generator* g, AST_Node* const* array_slot, const char* array, TypeId type, char** data, char** length) {
+	int64_t size = static_size(g, type);
+	if (size >= 0) {
+		int count;
+		const int64_t* extents = type_extents(g->table, type, &count);
+		*data = format("(%s).e", array);
+		*length = format("INT64_C(%lld)", (long long) extents[0]);
+		return;
+	}
+	// Array parameters proven restrict are read through a restrict copy of their data pointer
+	SymbolId id = (*array_slot)->node_type == NODE_QUALNAME? resolution_lookup(g->res, array_slot).symbol : 0;
+	if (id && g->restrict_data[id] && arrlen(((AST_Qualname*) *array_slot)->parts) == 1) *data = format("rh_%s_data", symbol_name(g, id));
+	else *data = format("(%s).data", array);
+	*length = format("(%s).len", array);
+}
+
+static void emit_slice(Generator* g, AST_Node* const* slot, AST_Subscript* sub, AST_Slice* slice, bool checked) {
+	TypeId type = value_type(g, type_at(g, &sub->array));
+	if (arrlen(sub->subscripts) != 1 || type_of(g, type)->count != 1 || slice->step) {
+		unsupported(g, (AST_Node*) sub, "Only slices of one dimension, without a step, can be written as C yet");
+		return;
+	}
+	require_pure(g, &sub->array, "The sliced array");
+	if (slice->start) require_pure(g, &slice->start, "The start of a slice");
+	char* array = capture(g, &sub->array, true);
+	char *data, *length;
+	array_parts(g, &sub->array, array, type, &data, &length);
+	char* start = slice->start? capture(g, &slice->start, true) : format("0");
+	char* end;
+	if (!slice->end) end = format("%s", length);
+	else {
+		char* given = capture(g, &slice->end, true);
+		end = format(slice->is_inclusive? "(%s) + 1" : "(%s)", given);
+		free(given);
+	}
+	emit(g, "((%s) { %s + ", c_type(g, type_at(g, slot), *slot), data);
+	if (checked) emit(g, "rh_check_slice(%s, %s, %s, rh_src, %d)", start, end, length, (int) sub->start_line);
+	else emit(g, "(%s)", start);
+	emit(g, ", %s - (%s), 0 })", end, start);
+	free(array);
+	free(data);
+	free(length);
+	free(start);
+	free(end);
+}
+
+static void emit_subscript(Generator* g, AST_Node* const* slot) {
+	AST_Subscript* sub = (AST_Subscript*) *slot;
+	TypeId type = value_type(g, type_at(g, &sub->array));
+	const Type* t = type_of(g, type);
+	if (t->kind != TYPE_KIND_ARRAY) {
+		unsupported(g, (AST_Node*) sub, "Subscripts of values of type %s can't be written as C yet", type_name(g->table, type));
+		return;
+	}
+	bool checked = !g->bounds || bounds_is_checked(g->bounds, (AST_Node*) sub);
+	int n = arrlen(sub->subscripts);
+	for (int i = 0; i < n; i++) {
+		if (sub->subscripts[i]->node_type == NODE_SLICE) {
+			emit_slice(g, slot, sub, (AST_Slice*) sub->subscripts[i], checked);
+			return;
+		}
+	}
+	int64_t size = static_size(g, type);
+	if (size < 0 && n != 1) {
+		unsupported(g, (AST_Node*) sub, "Only arrays of one dimension, or whose extents are known, can be subscripted in C yet");
+		return;
+	}
+	if (size < 0 && checked) require_pure(g, &sub->array, "An array whose bounds are checked");
+	char* array = capture(g, &sub->array, true);
+	char *data, *length;
+	array_parts(g, &sub->array, array, type, &data, &length);
+	int count;
+	const int64_t* extents = type_extents(g->table, type, &count);
+	// Static arrays of more dimensions are one C array, in row-major order
+	bool partial = size >= 0 && n < count;
+	int64_t stride = size;
+	if (partial) {
+		int64_t sub_extents[16];
+		int rest = count - n;
+		for (int i = 0; i < rest && i < 16; i++) sub_extents[i] = extents[n + i];
+		TypeId part = type_array(g->table, strip_mutable(g, t->base), rest, sub_extents, false);
+		emit(g, "(*(%s*) &", c_type(g, part, *slot));
+	}
+	emit(g, "%s[", data);
+	for (int i = 0; i < n; i++) {
+		if (i) emit(g, " + ");
+		if (size >= 0) stride /= extents[i]? extents[i] : 1;
+		if (checked) {
+			emit(g, "rh_check(");
+			emit_value(g, &sub->subscripts[i]);
+			if (size >= 0) emit(g, ", %lld, rh_src, %d)", (long long) extents[i], (int) sub->start_line);
+			else emit(g, ", %s, rh_src, %d)", length, (int) sub->start_line);
+		}
+		else {
+			emit(g, "(");
+			emit_value(g, &sub->subscripts[i]);
+			emit(g, ")");
+		}
+		if (size >= 0 && stride != 1) emit(g, " * %lld", (long long) stride);
+	}
+	emit(g, "]");
+	if (partial) emit(g, ")");
+	free(array);
+	free(data);
+	free(length);
+}
+
+/// Writes the elements of an array literal, and of the literals nested in it, in row-major order
+static void emit_elements(Generator* g, AST_Node* const* slot, TypeId element, int dims) {
+	AST_Node* node = *slot;
+	if (node->node_type == NODE_PACKED_ARRAY) {
+		AST_PackedArray* packed = (AST_PackedArray*) node;
+		bool single = type_of(g, element)->kind == TYPE_KIND_FLOAT && type_of(g, element)->bits == 32;
+		int n = packed->kind == PACKED_INT? arrlen(packed->ints) : arrlen(packed->floats);
+		for (int i = 0; i < n; i++) {
+			if (i) emit(g, ", ");
+			if (packed->kind == PACKED_INT) emit_int(g, packed->ints[i]);
+			else emit_float(g, packed->floats[i], single);
+		}
+		return;
+	}
+	if (node->node_type != NODE_ARRAY || dims == 0) {
+		emit_as(g, slot, element);
+		return;
+	}
+	AST_ArrayLiteral* array = (AST_ArrayLiteral*) node;
+	for (int i = 0; i < arrlen(array->elements); i++) {
+		if (i) emit(g, ", ");
+		emit_elements(g, &array->elements[i], element, dims - 1);
+	}
+}
+
+static void emit_array_literal(Generator* g, AST_Node* const* slot) {
+	TypeId type = value_type(g, type_at(g, slot));
+	if (static_size(g, type) < 0) {
+		unsupported(g, *slot, "Array literals of type %s can't be written as C yet", type_name(g->table, type));
+		return;
+	}
+	const Type* t = type_of(g, type);
+	if (g->initializer) emit(g, "{ { ");
+	else emit(g, "((%s) { { ", c_type(g, type, *slot));
+	emit_elements(g, slot, t->base, t->count);
+	emit(g, g->initializer? " } }" : " } })");
+}
+
+static void emit_struct_value(Generator* g, AST_Node* const* slot, SymbolId id) {
+	AST_FuncCall* call = (AST_FuncCall*) *slot;
+	AST_Struct* decl = (AST_Struct*) resolution_symbol(g->res, id)->decl;
+	TypeId type = value_type(g, type_at(g, slot));
+	emit(g, "((%s) { ", c_type(g, type, (AST_Node*) call));
+	bool first = true;
+	for (int i = 0; i < shlen(decl->fields); i++) {
+		AST_Field* field = decl->fields[i].value;
+		ptrdiff_t kw = shgeti(call->kw_args, decl->fields[i].key);
+		AST_Node* const* value = i < arrlen(call->pos_args)? &call->pos_args[i] : kw >= 0? &call->kw_args[kw].value
+			: field->default_value? &field->default_value : NULL;
+		if (!value) continue;
+		emit(g, first? ".%s = " : ", .%s = ", c_ident(g, decl->fields[i].key));
+		emit_as(g, value, field_type(g, field));
+		first = false;
+	}
+	emit(g, first? "0 })" : " })");
+}
+
+static void emit_cast(Generator* g, AST_FuncCall* call, TypeId to) {
+	if (arrlen(call->pos_args) != 1 || type_of(g, to)->kind == TYPE_KIND_VECTOR) {
+		unsupported(g, (AST_Node*) call, "Vectors can't be written as C yet");
+		return;
+	}
+	if (to == TYPE_BOOL) {
+		emit(g, "(");
+		emit_value(g, &call->pos_args[0]);
+		emit(g, " != 0)");
+		return;
+	}
+	emit(g, "((%s) ", c_type(g, to, (AST_Node*) call));
+	emit_value(g, &call->pos_args[0]);
+	emit(g, ")");
+}
+
+static bool is_builtin(Generator* g, const AST_FuncCall* call, const char* name) {
+	if (call->func->node_type != NODE_QUALNAME || resolution_lookup(g->res, &call->func).symbol) return false;
+	const AST_Qualname* qn = (const AST_Qualname*) call->func;
+	return arrlen(qn->parts) == 1 && strcmp(qn->parts[0], name) == 0;
+}
+
+static void emit_len(Generator* g, AST_FuncCall* call) {
+	AST_Node* const* arg = &call->pos_args[0];
+	TypeId type = value_type(g, type_at(g, arg));
+	if (type == TYPE_STRING || (type_of(g, type)->kind == TYPE_KIND_ARRAY && static_size(g, type) < 0)) {
+		emit(g, "(");
+		emit_value(g, arg);
+		emit(g, ").len");
+		return;
+	}
+	int count;
+	const int64_t* extents = type_extents(g->table, type, &count);
+	if (count) emit(g, "INT64_C(%lld)", (long long) extents[0]);
+	else unsupported(g, (AST_Node*) call, "'len' of a value of type %s can't be written as C yet", type_name(g->table, type));
+}
+
+/// The builtin functions of Math and the bit operations, or false if the call isn't one
+static bool emit_math(Generator* g, AST_Node* const* slot, const char* name) {
+	static const char* const functions[] = { "sqrt", "sin", "cos", "tan", "exp", "log", "floor", "ceil" };
+	static const struct { const char* name; const char *sint, *uint, *flt; } binary[] = {
+		{ "min", "rh_min", "rh_umin", "fmin" }, { "max", "rh_max", "rh_umax", "fmax" },
+		{ "bit_and", "&", "&", NULL }, { "bit_or", "|", "|", NULL }, { "bit_xor", "^", "^", NULL },
+		{ "shift_left", "rh_shl", "rh_shl", NULL }, { "shift_right", "rh_shr", "rh_ushr", NULL },
+	};
+	AST_FuncCall* call = (AST_FuncCall*) *slot;
+	TypeId type = value_type(g, type_at(g, slot));
+	const Type* t = type_of(g, type);
+	bool single = t->kind == TYPE_KIND_FLOAT && t->bits == 32;
+	int n = arrlen(call->pos_args);
+	for (size_t i = 0; i < sizeof(functions) / sizeof(*functions); i++) {
+		if (n != 1 || strcmp(name, functions[i]) != 0) continue;
+		emit(g, "%s%s(", functions[i], single? "f" : "");
+		emit_as(g, &call->pos_args[0], type);
+		emit(g, ")");
+		return true;
+	}
+	const char* type_c = c_type(g, type, *slot);
+	if (n == 1 && (strcmp(name, "abs") == 0 || strcmp(name, "bit_not") == 0)) {
+		if (name[0] == 'b') emit(g, "((%s) ~(", type_c);
+		else if (t->kind == TYPE_KIND_FLOAT) emit(g, single? "fabsf(" : "fabs(");
+		else emit(g, t->kind == TYPE_KIND_UINT? "((%s) (" : "((%s) rh_abs(", type_c);
+		emit_as(g, &call->pos_args[0], type);
+		emit(g, t->kind == TYPE_KIND_FLOAT? ")" : "))");
+		return true;
+	}
+	for (size_t i = 0; i < sizeof(binary) / sizeof(*binary); i++) {
+		if (n != 2 || strcmp(name, binary[i].name) != 0) continue;
+		const char* op = t->kind == TYPE_KIND_FLOAT? binary[i].flt : t->kind == TYPE_KIND_UINT? binary[i].uint : binary[i].sint;
+		bool shift = binary[i].name[0] == 's';
+		if (t->kind == TYPE_KIND_FLOAT) emit(g, "%s%s(", op, single? "f" : "");
+		else if (op[1]) emit(g, "((%s) %s(", type_c, op);
+		else emit(g, "((%s) (", type_c);
+		emit_as(g, &call->pos_args[0], type);
+		emit(g, op[1]? ", " : " %s ", op);
+		// The count of a shift is taken as it is, so a negative one is a large one
+		if (shift) {
+			emit(g, "(uint64_t) ");
+			emit_value(g, &call->pos_args[1]);
+		}
+		else emit_as(g, &call->pos_args[1], type);
+		emit(g, t->kind == TYPE_KIND_FLOAT? ")" : "))");
+		return true;
+	}
+	return false;
+}
+
+/// 'alloc(T)' and 'heapval(value)', made where escape analysis placed them, as a pointer of type `want`
+static void emit_allocation(Generator* g, AST_FuncCall* call, TypeId want) {
+	TypeId pointer = strip_mutable(g, want);
+	if (type_of(g, pointer)->kind == TYPE_KIND_OPTIONAL) pointer = strip_mutable(g, type_of(g, pointer)->base);
+	if (type_of(g, pointer)->kind != TYPE_KIND_POINTER || arrlen(call->pos_args) != 1) {
+		unsupported(g, (AST_Node*) call, "What this allocates must have a pointer type given, as in 'p: @Int = alloc(Int)'");
+		return;
+	}
+	TypeId target = type_of(g, pointer)->base;
+	const char* type = c_type(g, target, (AST_Node*) call);
+	Placement placement = g->esc? escape_placement(g->esc, (AST_Node*) call) : PLACEMENT_HEAP;
+	const char* allocator = placement == PLACEMENT_TEMPORARY? "rh_temp_alloc" : "rh_alloc";
+	if (is_builtin(g, call, "alloc")) {
+		emit(g, "((%s*) %s(sizeof(%s)))", type, allocator, type);
+		return;
+	}
+	emit(g, "((%s*) rh_copy(%s(sizeof(%s)), &(%s) { ", type, allocator, type, type);
+	emit_as(g, &call->pos_args[0], target);
+	emit(g, " }, sizeof(%s)))", type);
+}
+
+static void emit_call(Generator* g, AST_Node* const* slot) {
+	AST_FuncCall* call = (AST_FuncCall*) *slot;
+	const LoweredCall* lowered = lowering_call(g->lower, *slot);
+	if (lowered) {
+		emit_lowered(g, lowered);
+		return;
+	}
+	if (call->func->node_type == NODE_QUALNAME) {
+		const AST_Qualname* qn = (const AST_Qualname*) call->func;
+		ResolvedName found = resolution_lookup(g->res, &call->func);
+		if (found.symbol && found.n_parts == arrlen(qn->parts) && resolution_symbol(g->res, found.symbol)->kind == DECL_STRUCT) {
+			emit_struct_value(g, slot, found.symbol);
+			return;
+		}
+		if (!found.symbol && arrlen(qn->parts) == 1) {
+			TypeId cast = type_builtin(g->table, qn->parts[0]);
+			if (cast) {
+				emit_cast(g, call, cast);
+				return;
+			}
+			if (strcmp(qn->parts[0], "len") == 0 && arrlen(call->pos_args) == 1) {
+				emit_len(g, call);
+				return;
+			}
+			if (emit_math(g, slot, qn->parts[0])) return;
+		}
+	}
+	unsupported(g, *slot, "This call can't be written as C yet");
+}
+
+/// Writes an expression as C, of the C type of the expression's type
+static void emit_expr(Generator* g, AST_Node* const* slot) {
+	AST_Node* node = *slot;
+	switch (node->node_type) {
+		case NODE_INT:
+			emit_int(g, ((AST_Int*) node)->value);
+			break;
+		case NODE_FLOAT: {
+			TypeId type = value_type(g, type_at(g, slot));
+			emit_float(g, ((AST_Float*) node)->value, type_of(g, type)->kind == TYPE_KIND_FLOAT && type_of(g, type)->bits == 32);
+		} break;
+		case NODE_BOOL:
+			emit(g, ((AST_Bool*) node)->value? "true" : "false");
+			break;
+		case NODE_CHAR:
+			emit(g, "%d", (int) ((AST_Char*) node)->value);
+			break;
+		case NODE_STRING:
+			emit_string(g, ((AST_String*) node)->value);
+			break;
+		case NODE_NULL:
+			emit(g, "NULL");
+			break;
+		case NODE_QUALNAME:
+			emit_qualname(g, slot);
+			break;
+		case NODE_FIELD_ACCESS: {
+			AST_FieldAccess* access = (AST_FieldAccess*) node;
+			char* base = capture(g, &access->base, false);
+			emit_fields(g, base, type_at(g, &access->base), access->field->parts, arrlen(access->field->parts), node);
+			free(base);
+		} break;
+		case NODE_BINOP:
+			emit_binop(g, slot);
+			break;
+		case NODE_UNARY: {
+			AST_Unary* unary = (AST_Unary*) node;
+			const LoweredCall* call = lowering_call(g->lower, node);
+			if (call) {
+				emit_lowered(g, call);
+				break;
+			}
+			TypeId type = value_type(g, type_at(g, slot));
+			bool narrow = is_narrow(g, type);
+			if (narrow) emit(g, "((%s) ", c_type(g, type, node));
+			emit(g, "(%s(", unary->op);
+			emit_as(g, &unary->expr, type);
+			emit(g, "))");
+			if (narrow) emit(g, ")");
+		} break;
+		case NODE_COMPARISON:
+			emit_comparison(g, (AST_ComparisonChain*) node);
+			break;
+		case NODE_NOT:
+			emit(g, "(!");
+			emit_value(g, &((AST_Not*) node)->expr);
+			emit(g, ")");
+			break;
+		case NODE_AND:
+		case NODE_OR: {
+			AST_And* logic = (AST_And*) node;
+			if (value_kind(g, type_at(g, slot)) != TYPE_KIND_BOOL) {
+				unsupported(g, node, "'and' and 'or' of values other than Bool can't be written as C yet");
+				break;
+			}
+			emit(g, "(");
+			emit_value(g, &logic->lhs);
+			emit(g, node->node_type == NODE_AND? " && " : " || ");
+			emit_value(g, &logic->rhs);
+			emit(g, ")");
+		} break;
+		case NODE_TERNARY: {
+			AST_Ternary* ternary = (AST_Ternary*) node;
+			TypeId type = type_at(g, slot);
+			emit(g, "(");
+			emit_value(g, &ternary->condition);
+			emit(g, "? ");
+			emit_as(g, &ternary->true_expr, type);
+			emit(g, " : ");
+			emit_as(g, &ternary->false_expr, type);
+			emit(g, ")");
+		} break;
+		case NODE_REREFERENCE:
+			emit_reref(g, (AST_Reref*) node);
+			break;
+		case NODE_FUNC_CALL:
+			if (escape_is_allocation(g->res, node)) unsupported(g, node, "What this allocates must have a pointer type given, as in 'p: @Int = alloc(Int)'");
+			else emit_call(g, slot);
+			break;
+		case NODE_SUBSCRIPT:
+			emit_subscript(g, slot);
+			break;
+		case NODE_ARRAY:
+		case NODE_PACKED_ARRAY:
+			emit_array_literal(g, slot);
+			break;
+		default:
+			unsupported(g, node, "This expression can't be written as C yet");
+	}
+}
+
+/// Writes an expression as a value of another type: with pointers followed or taken where
+/// the types have different numbers of them, and arrays whose extents are known turned into
+/// ones whose extents aren't
+static void emit_as(Generator* g, AST_Node* const* slot, TypeId want) {
+	AST_Node* node = *slot;
+	if (node->node_type == NODE_NULL) {
+		emit(g, "NULL");
+		return;
+	}
+	if (escape_is_allocation(g->res, node)) {
+		emit_allocation(g, (AST_FuncCall*) node, want);
+		return;
+	}
+	TypeId have = type_at(g, slot);
+	if (want == TYPE_UNKNOWN || have == TYPE_UNKNOWN) {
+		emit_expr(g, slot);
+		return;
+	}
+	int depth = pointer_depth(g, have), wanted = pointer_depth(g, want);
+	if (depth > wanted + 16 || wanted > depth + 1) {
+		unsupported(g, node, "A value of type %s can't be used as %s in C yet", type_name(g->table, have), type_name(g->table, want));
+		return;
+	}
+	if (wanted > depth) {
+		// A value passed for a pointer
+		if (is_addressable(g, slot)) emit(g, "(&");
+		else emit(g, "(&(%s) { ", c_type(g, have, node));
+		emit_expr(g, slot);
+		emit(g, is_addressable(g, slot)? ")" : " })");
+		return;
+	}
+	TypeId from = value_type(g, have), to = value_type(g, want);
+	int64_t size = static_size(g, from);
+	bool to_slice = !wanted && from != to && size >= 0 && type_of(g, to)->kind == TYPE_KIND_ARRAY && static_size(g, to) < 0;
+	if (to_slice) {
+		if (type_of(g, from)->count != 1) {
+			unsupported(g, node, "A value of type %s can't be used as %s in C yet", type_name(g->table, have), type_name(g->table, want));
+			return;
+		}
+		emit(g, "((%s) { (", c_type(g, to, node));
+	}
+	if (depth > wanted) emit(g, "(%.*s", depth - wanted, "****************");
+	emit_expr(g, slot);
+	if (depth > wanted) emit(g, ")");
+	if (to_slice) emit(g, ").e, %lld, 0 })", (long long) size);
+}
+
+/// Writes an expression that is assigned to, and returns the type of what is stored there
+static TypeId emit_place(Generator* g, AST_Node* const* slot) {
+	AST_Node* node = *slot;
+	if (node->node_type == NODE_REREFERENCE) {
+		// Pointers themselves are rebound
+		emit_reref(g, (AST_Reref*) node);
+		return type_at(g, slot);
+	}
+	emit_value(g, slot);
+	return value_type(g, type_at(g, slot));
+}
+
+static void emit_condition(Generator* g, AST_Node* const* slot) {
+	TypeId type = strip_mutable(g, type_at(g, slot));
+	if (type_of(g, type)->kind == TYPE_KIND_OPTIONAL) {
+		emit(g, "(");
+		emit_expr(g, slot);
+		emit(g, " != NULL)");
+	}
+	else emit_value(g, slot);
+}
+
+// === Statements ===
+
+static void emit_statement(Generator* g, AST_Node** slot);
+
+static void emit_body(Generator* g, AST_Block* block) {
+	g->indent++;
+	for (int i = 0; i < arrlen(block->body); i++) emit_statement(g, &block->body[i]);
+	g->indent--;
+}
+
+/// Writes a block that goes on from a line already started
+static void emit_block(Generator* g, AST_Block* block) {
+	emit(g, "{\n");
+	emit_body(g, block);
+	begin(g, NULL);
+	emit(g, "}\n");
+}
+
+/// Frees what escape analysis says is freed where the function is left, and gives back
+/// what it took of the temporary allocator
+static void emit_exit(Generator* g, const AST_Node* exit) {
+	int n = 0;
+	const SymbolId* frees = g->esc? escape_frees(g->esc, exit, &n) : NULL;
+	for (int i = 0; i < n; i++) {
+		begin(g, NULL);
+		emit(g, "rh_free(%s);\n", symbol_name(g, frees[i]));
+	}
+	if (g->has_mark) {
+		begin(g, NULL);
+		emit(g, "rh_temp_release(rh_mark);\n");
+	}
+}
+
+static void emit_return(Generator* g, AST_Return* ret) {
+	int n_frees = 0;
+	if (g->esc) escape_frees(g->esc, (AST_Node*) ret, &n_frees);
+	begin(g, (AST_Node*) ret);
+	if (!ret->value) {
+		if (n_frees || g->has_mark) {
+			emit(g, "{\n");
+			g->indent++;
+			emit_exit(g, (AST_Node*) ret);
+			begin(g, NULL);
+			emit(g, "return;\n");
+			g->indent--;
+			begin(g, NULL);
+			emit(g, "}\n");
+		}
+		else emit(g, "return;\n");
+		return;
+	}
+	if (!n_frees && !g->has_mark) {
+		emit(g, "return ");
+		emit_as(g, &ret->value, g->ret_type);
+		emit(g, ";\n");
+		return;
+	}
+	// The value is worked out before anything it may use is freed
+	emit(g, "{\n");
+	g->indent++;
+	begin(g, NULL);
+	emit(g, "%s rh_ret = ", c_type(g, g->ret_type, (AST_Node*) ret));
+	emit_as(g, &ret->value, g->ret_type);
+	emit(g, ";\n");
+	emit_exit(g, (AST_Node*) ret);
+	begin(g, NULL);
+	emit(g, "return rh_ret;\n");
+	g->indent--;
+	begin(g, NULL);
+	emit(g, "}\n");
+}
+
+static void emit_zero(Generator* g, TypeId type, const AST_Node* at) {
+	type = strip_mutable(g, type);
+	const Type* t = type_of(g, type);
+	switch (t->kind) {
+		case TYPE_KIND_POINTER:
+		case TYPE_KIND_OPTIONAL:
+		case TYPE_KIND_RAWPTR:
+			emit(g, "NULL");
+			break;
+		case TYPE_KIND_BOOL:
+			emit(g, "false");
+			break;
+		case TYPE_KIND_STRUCT: {
+			// Fields take their defaults
+			const AST_Struct* decl = (const AST_Struct*) t->decl;
+			emit(g, "((%s) { ", c_type(g, type, at));
+			for (int i = 0; i < shlen(decl->fields); i++) {
+				AST_Field* field = decl->fields[i].value;
+				emit(g, i? ", .%s = " : ".%s = ", c_ident(g, decl->fields[i].key));
+				if (field->default_value) emit_as(g, &field->default_value, field_type(g, field));
+				else emit_zero(g, field_type(g, field), at);
+			}
+			emit(g, shlen(decl->fields)? " })" : "0 })");
+		} break;
+		case TYPE_KIND_ARRAY:
+		case TYPE_KIND_STRING:
+			emit(g, "((%s) { 0 })", c_type(g, type, at));
+			break;
+		default:
+			c_type(g, type, at);
+			emit(g, "0");
+	}
+}
+
+static void emit_var_decl(Generator* g, AST_VarDecl* var) {
+	SymbolId id = declared(g, &var->name);
+	TypeId type = typecheck_symbol_type(g->check, id);
+	begin(g, (AST_Node*) var);
+	emit(g, "%s %s", c_type(g, type, (AST_Node*) var), symbol_name(g, id));
+	if (var->value) {
+		emit(g, " = ");
+		emit_as(g, &var->value, type);
+	}
+	else if (var->init != INIT_UNINITIALIZED) {
+		emit(g, " = ");
+		emit_zero(g, type, (AST_Node*) var);
+	}
+	emit(g, ";\n");
+}
+
+static void emit_assignment(Generator* g, AST_Node* node) {
+	AST_Node** dests;
+	AST_Node** srcs;
+	int n_srcs;
+	if (node->node_type == NODE_ASSIGN) {
+		AST_AssignChain* chain = (AST_AssignChain*) node;
+		dests = chain->dest_exprs;
+		srcs = &chain->src_expr;
+		n_srcs = 1;
+	}
+	else {
+		AST_AssignParallel* parallel = (AST_AssignParallel*) node;
+		dests = parallel->dest_exprs;
+		srcs = parallel->src_exprs;
+		n_srcs = arrlen(parallel->src_exprs);
+	}
+	int n = arrlen(dests);
+	begin(g, node);
+	if (n == 1 && n_srcs == 1) {
+		TypeId type = emit_place(g, &dests[0]);
+		emit(g, " = ");
+		emit_as(g, &srcs[0], type);
+		emit(g, ";\n");
+		return;
+	}
+	// Every value is worked out before any is assigned, so 'a, b = b, a' swaps
+	int first = g->n_temps;
+	g->n_temps += n;
+	emit(g, "{\n");
+	g->indent++;
+	for (int i = 0; i < n; i++) {
+		AST_Node* const* src = &srcs[n_srcs == 1? 0 : i];
+		if (n_srcs == 1 && i) break;
+		Output* out = g->out;
+		Output discard = { 0 };
+		g->out = &discard;
+		TypeId type = emit_place(g, &dests[i]);
+		g->out = out;
+		arrfree(discard.text);
+		begin(g, NULL);
+		emit(g, "%s rh_t%d = ", c_type(g, type, node), first + i);
+		emit_as(g, src, type);
+		emit(g, ";\n");
+	}
+	for (int i = 0; i < n; i++) {
+		begin(g, NULL);
+		emit_place(g, &dests[i]);
+		emit(g, " = rh_t%d;\n", first + (n_srcs == 1? 0 : i));
+	}
+	g->indent--;
+	begin(g, NULL);
+	emit(g, "}\n");
+}
+
+static void emit_op_assign(Generator* g, AST_OpAssign* op_assign) {
+	AST_Node* node = (AST_Node*) op_assign;
+	const LoweredCall* call = lowering_call(g->lower, node);
+	const char* op = op_assign->op;
+	TypeId type = value_type(g, type_at(g, &op_assign->dest_expr));
+	TypeKind kind = type_of(g, type)->kind;
+	bool is_float = kind == TYPE_KIND_FLOAT, single = is_float && type_of(g, type)->bits == 32;
+	begin(g, node);
+	if (call) {
+		require_pure(g, &op_assign->dest_expr, "The destination of an overloaded op-assignment");
+		emit_place(g, &op_assign->dest_expr);
+		emit(g, " = ");
+		emit_lowered(g, call);
+		emit(g, ";\n");
+		return;
+	}
+	if (op[1] || !strchr("+-*/%^", op[0]) || (kind != TYPE_KIND_SINT && kind != TYPE_KIND_UINT && !is_float)) {
+		unsupported(g, node, "Operator '%s=' on values of type %s can't be written as C yet", op, type_name(g->table, type));
+		return;
+	}
+	if (op[0] == '^' || (op[0] == '%' && is_float)) {
+		require_pure(g, &op_assign->dest_expr, "The destination of this op-assignment");
+		const char* function = op[0] == '%'? (single? "rh_fmodf" : "rh_fmod") : is_float? (single? "rh_powf" : "rh_pow")
+			: kind == TYPE_KIND_UINT? "rh_upow" : "rh_ipow";
+		emit_place(g, &op_assign->dest_expr);
+		emit(g, " = %s(", function);
+		emit_place(g, &op_assign->dest_expr);
+		emit(g, ", ");
+		emit_as(g, &op_assign->src_expr, type);
+		emit(g, ");\n");
+		return;
+	}
+	emit_place(g, &op_assign->dest_expr);
+	emit(g, " %s= ", op);
+	emit_as(g, &op_assign->src_expr, type);
+	emit(g, ";\n");
+}
+
+static void emit_if(Generator* g, AST_IfStatement* stmt) {
+	emit(g, "if (");
+	emit_condition(g, &stmt->condition);
+	emit(g, ") ");
+	emit_block(g, stmt->body);
+	if (!stmt->alternative) return;
+	begin(g, NULL);
+	emit(g, "else ");
+	if (stmt->alternative->node_type == NODE_IF_STMT) emit_if(g, (AST_IfStatement*) stmt->alternative);
+	else if (stmt->alternative->node_type == NODE_BLOCK) emit_block(g, (AST_Block*) stmt->alternative);
+	else {
+		emit(g, "{\n");
+		g->indent++;
+		emit_statement(g, &stmt->alternative);
+		g->indent--;
+		begin(g, NULL);
+		emit(g, "}\n");
+	}
+}
+
+/// The body of a loop, which 'skip' with the loop's label goes to the end of
+static void emit_loop_body(Generator* g, AST_Block* body, const AST_Name* label, const char* prelude) {
+	int id = ++g->n_temps;
+	Loop loop = { label? label->name : NULL, id, g->esc && escape_iteration_releases(g->esc, body) };
+	arrput(g->loops, loop);
+	emit(g, "{\n");
+	g->indent++;
+	if (loop.releases) {
+		begin(g, NULL);
+		emit(g, "size_t rh_mark%d = rh_temp_mark();\n", id);
+	}
+	if (prelude) {
+		begin(g, NULL);
+		emit(g, "%s\n", prelude);
+	}
+	g->indent--;
+	emit_body(g, body);
+	g->indent++;
+	if (label) {
+		begin(g, NULL);
+		emit(g, "rh_skip%d: ;\n", id);
+	}
+	if (loop.releases) {
+		begin(g, NULL);
+		emit(g, "rh_temp_release(rh_mark%d);\n", id);
+	}
+	g->indent--;
+	begin(g, NULL);
+	emit(g, "}\n");
+	(void) arrpop(g->loops);
+	if (label) {
+		begin(g, NULL);
+		emit(g, "rh_break%d: ;\n", id);
+	}
+}
+
+/// The step of a range, if it is a literal
+static bool literal_step(const AST_ForRange* range, int64_t* step) {
+	*step = 1;
+	if (!range->step) return true;
+	const AST_Node* node = range->step;
+	bool negative = node->node_type == NODE_UNARY && strcmp(((AST_Unary*) node)->op, "-") == 0;
+	if (negative) node = ((AST_Unary*) node)->expr;
+	if (node->node_type != NODE_INT) return false;
+	*step = negative? -(int64_t) ((AST_Int*) node)->value : (int64_t) ((AST_Int*) node)->value;
+	return *step != 0;
+}
+
+static void emit_for_range(Generator* g, AST_ForLoop* loop, AST_ForRange* range) {
+	SymbolId id = declared(g, &range->name);
+	TypeId type = id? type_unqualified(g->table, typecheck_symbol_type(g->check, id)) : TYPE_INT;
+	TypeKind kind = type_of(g, type)->kind;
+	if (kind != TYPE_KIND_SINT && kind != TYPE_KIND_UINT) type = TYPE_INT;
+	const char* c = c_type(g, type, (AST_Node*) range);
+	int k = ++g->n_temps;
+	// A variable the body assigns to is a copy of the counter, as each iteration starts from the next value
+	bool copied = !id || g->rebound[id];
+	char* var = copied? format("rh_i%d", k) : format("%s", symbol_name(g, id));
+	char* prelude = copied && id? format("%s %s = %s;", c, symbol_name(g, id), var) : NULL;
+	int64_t step;
+	bool literal = literal_step(range, &step);
+	begin(g, (AST_Node*) loop);
+	emit(g, "{\n");
+	g->indent++;
+	if (range->end) {
+		begin(g, NULL);
+		emit(g, "%s rh_end%d = ", c, k);
+		emit_as(g, &range->end, type);
+		emit(g, ";\n");
+	}
+	if (!literal) {
+		begin(g, NULL);
+		emit(g, "int64_t rh_step%d = ", k);
+		emit_value(g, &range->step);
+		emit(g, ";\n");
+	}
+	begin(g, NULL);
+	emit(g, "for (%s %s = ", c, var);
+	emit_as(g, &range->start, type);
+	emit(g, "; ");
+	const char* up = range->is_inclusive? "<=" : "<";
+	const char* down = range->is_inclusive? ">=" : ">";
+	if (!range->end) {}
+	else if (!literal) emit(g, "rh_step%d > 0? %s %s rh_end%d : %s %s rh_end%d", k, var, up, k, var, down, k);
+	else emit(g, "%s %s rh_end%d", var, step > 0? up : down, k);
+	if (!literal) emit(g, "; %s += (%s) rh_step%d) ", var, c, k);
+	else if (step == 1 || step == -1) emit(g, "; %s%s) ", var, step > 0? "++" : "--");
+	else emit(g, "; %s += (%s) %lld) ", var, c, (long long) step);
+	emit_loop_body(g, loop->body, loop->label, prelude);
+	g->indent--;
+	begin(g, NULL);
+	emit(g, "}\n");
+	free(var);
+	free(prelude);
+}
+
+static void emit_for_simple(Generator* g, AST_ForLoop* loop, AST_ForSimple* simple) {
+	SymbolId id = declared(g, &simple->name);
+	TypeId type = value_type(g, type_at(g, &simple->iterable));
+	const Type* t = type_of(g, type);
+	if (!id || t->kind != TYPE_KIND_ARRAY || t->count != 1) {
+		unsupported(g, (AST_Node*) simple, "Only named loops over arrays of one dimension can be written as C yet");
+		return;
+	}
+	int k = ++g->n_temps;
+	begin(g, (AST_Node*) loop);
+	emit(g, "{\n");
+	g->indent++;
+	begin(g, NULL);
+	emit(g, "%s rh_it%d = ", c_type(g, type, (AST_Node*) simple), k);
+	emit_value(g, &simple->iterable);
+	emit(g, ";\n");
+	int64_t size = static_size(g, type);
+	begin(g, NULL);
+	if (size >= 0) emit(g, "for (int64_t rh_i%d = 0; rh_i%d < %lld; rh_i%d++) ", k, k, (long long) size, k);
+	else emit(g, "for (int64_t rh_i%d = 0; rh_i%d < rh_it%d.len; rh_i%d++) ", k, k, k, k);
+	char* prelude = format("%s %s = rh_it%d.%s[rh_i%d];", c_type(g, typecheck_symbol_type(g->check, id), (AST_Node*) simple),
+		symbol_name(g, id), k, size >= 0? "e" : "data", k);
+	emit_loop_body(g, loop->body, loop->label, prelude);
+	free(prelude);
+	g->indent--;
+	begin(g, NULL);
+	emit(g, "}\n");
+}
+
+static void emit_for(Generator* g, AST_ForLoop* loop) {
+	// Parallel loops run one iteration after the other, which is one of the orders they may run in
+	if (arrlen(loop->iterables) != 1) {
+		unsupported(g, (AST_Node*) loop, "Loops over more than one range can't be written as C yet");
+		return;
+	}
+	AST_Node* iterable = loop->iterables[0];
+	if (iterable->node_type == NODE_FOR_RANGE) emit_for_range(g, loop, (AST_ForRange*) iterable);
+	else if (iterable->node_type == NODE_FOR_SIMPLE) emit_for_simple(g, loop, (AST_ForSimple*) iterable);
+	else unsupported(g, iterable, "This loop can't be written as C yet");
+}
+
+static void emit_jump(Generator* g, AST_Node* node, const AST_Name* label, bool is_break) {
+	begin(g, node);
+	if (!label) {
+		// Labeled skips go to the end of the body, where the iteration's temporaries are given back
+		if (!is_break && arrlen(g->loops) && arrlast(g->loops).releases) {
+			emit(g, "rh_temp_release(rh_mark%d);\n", arrlast(g->loops).id);
+			begin(g, NULL);
+		}
+		emit(g, is_break? "break;\n" : "continue;\n");
+		return;
+	}
+	for (int i = arrlen(g->loops) - 1; i >= 0; i--) {
+		if (g->loops[i].label && strcmp(g->loops[i].label, label->name) == 0) {
+			emit(g, "goto rh_%s%d;\n", is_break? "break" : "skip", g->loops[i].id);
+			return;
+		}
+	}
+	unsupported(g, node, "There is no loop named '%s' around this", label->name);
+}
+
+/// A message of a failure or an assertion, as an rh_string
+static void emit_message(Generator* g, AST_Node* const* slot) {
+	if (!*slot) emit(g, "((rh_string) { 0 })");
+	else if (value_kind(g, type_at(g, slot)) != TYPE_KIND_STRING) unsupported(g, *slot, "Only strings can be messages in C yet");
+	else emit_value(g, slot);
+}
+
+static void emit_print(Generator* g, AST_FuncCall* call) {
+	begin(g, (AST_Node*) call);
+	emit(g, "{\n");
+	g->indent++;
+	for (int i = 0; i < arrlen(call->pos_args); i++) {
+		AST_Node* const* arg = &call->pos_args[i];
+		TypeId type = value_type(g, type_at(g, arg));
+		const Type* t = type_of(g, type);
+		bool array = t->kind == TYPE_KIND_ARRAY;
+		int k = 0;
+		if (i) {
+			begin(g, NULL);
+			emit(g, "rh_print_text(\" \");\n");
+		}
+		if (array) {
+			if (t->count != 1) {
+				unsupported(g, *arg, "Only arrays of one dimension can be printed in C yet");
+				continue;
+			}
+			k = ++g->n_temps;
+			begin(g, NULL);
+			emit(g, "%s rh_it%d = ", c_type(g, type, *arg), k);
+			emit_value(g, arg);
+			emit(g, ";\n");
+			begin(g, NULL);
+			emit(g, "rh_print_text(\"[\");\n");
+			begin(g, NULL);
+			int64_t size = static_size(g, type);
+			if (size >= 0) emit(g, "for (int64_t rh_i%d = 0; rh_i%d < %lld; rh_i%d++) {\n", k, k, (long long) size, k);
+			else emit(g, "for (int64_t rh_i%d = 0; rh_i%d < rh_it%d.len; rh_i%d++) {\n", k, k, k, k);
+			g->indent++;
+			begin(g, NULL);
+			emit(g, "if (rh_i%d) rh_print_text(\", \");\n", k);
+			type = t->base;
+			t = type_of(g, value_type(g, type));
+		}
+		const char* print;
+		switch (t->kind) {
+			case TYPE_KIND_SINT:
+			case TYPE_KIND_ENUM:
+				print = "rh_print_int";
+				break;
+			case TYPE_KIND_UINT: print = "rh_print_uint"; break;
+			case TYPE_KIND_FLOAT: print = "rh_print_float"; break;
+			case TYPE_KIND_BOOL: print = "rh_print_bool"; break;
+			case TYPE_KIND_STRING: print = "rh_print_string"; break;
+			case TYPE_KIND_RUNE: print = "rh_print_rune"; break;
+			default:
+				unsupported(g, *arg, "Values of type %s can't be printed in C yet", type_name(g->table, type));
+				print = "rh_print_int";
+		}
+		begin(g, NULL);
+		if (array) {
+			emit(g, "%s(rh_it%d.%s[rh_i%d]);\n", print, k, static_size(g, value_type(g, type_at(g, arg))) >= 0? "e" : "data", k);
+			g->indent--;
+			begin(g, NULL);
+			emit(g, "}\n");
+			begin(g, NULL);
+			emit(g, "rh_print_text(\"]\");\n");
+		}
+		else {
+			emit(g, "%s(", print);
+			emit_value(g, arg);
+			emit(g, ");\n");
+		}
+	}
+	begin(g, NULL);
+	emit(g, "rh_print_text(\"\\n\");\n");
+	g->indent--;
+	begin(g, NULL);
+	emit(g, "}\n");
+}
+
+static void emit_statement(Generator* g, AST_Node** slot) {
+	AST_Node* node = *slot;
+	switch (node->node_type) {
+		case NODE_BLOCK:
+			begin(g, node);
+			emit_block(g, (AST_Block*) node);
+			break;
+		case NODE_VAR_DECL:
+			emit_var_decl(g, (AST_VarDecl*) node);
+			break;
+		case NODE_ASSIGN:
+		case NODE_ASSIGN_MANY:
+			emit_assignment(g, node);
+			break;
+		case NODE_OP_ASSIGN:
+			emit_op_assign(g, (AST_OpAssign*) node);
+			break;
+		case NODE_IF_STMT:
+			begin(g, node);
+			emit_if(g, (AST_IfStatement*) node);
+			break;
+		case NODE_WHILE_LOOP: {
+			AST_WhileLoop* loop = (AST_WhileLoop*) node;
+			begin(g, node);
+			emit(g, "while (");
+			emit_condition(g, &loop->condition);
+			emit(g, ") ");
+			emit_loop_body(g, loop->body, NULL, NULL);
+		} break;
+		case NODE_FOR_LOOP:
+			emit_for(g, (AST_ForLoop*) node);
+			break;
+		case NODE_RETURN:
+			emit_return(g, (AST_Return*) node);
+			break;
+		case NODE_BREAK:
+			emit_jump(g, node, ((AST_Break*) node)->label, true);
+			break;
+		case NODE_SKIP:
+			emit_jump(g, node, ((AST_Skip*) node)->label, false);
+			break;
+		case NODE_FAIL:
+			begin(g, node);
+			emit(g, "rh_fail(rh_src, %d, \"Failed\", ", (int) node->start_line);
+			emit_message(g, &((AST_Fail*) node)->message);
+			emit(g, ");\n");
+			break;
+		case NODE_ASSERT: {
+			AST_Assert* assert = (AST_Assert*) node;
+			begin(g, node);
+			emit(g, "if (!");
+			emit_condition(g, &assert->value);
+			emit(g, ") rh_fail(rh_src, %d, \"Assertion failed\", ", (int) node->start_line);
+			emit_message(g, &assert->message);
+			emit(g, ");\n");
+		} break;
+		case NODE_CONTRACT: {
+			// What is assumed, and preconditions that every call was shown to meet, tell the C compiler about values
+			AST_Contract* contract = (AST_Contract*) node;
+			if (contract->kind == CONTRACT_POST || (contract->kind == CONTRACT_PRE && !g->bounds)) break;
+			begin(g, node);
+			emit(g, "RH_ASSUME(");
+			emit_condition(g, &contract->condition);
+			emit(g, ");\n");
+		} break;
+		case NODE_FUNC_CALL: {
+			AST_FuncCall* call = (AST_FuncCall*) node;
+			if (is_builtin(g, call, "print")) {
+				emit_print(g, call);
+				break;
+			}
+			begin(g, node);
+			if (is_builtin(g, call, "free") && arrlen(call->pos_args) == 1) {
+				emit(g, "rh_free(");
+				emit_expr(g, &call->pos_args[0]);
+				emit(g, ");\n");
+				break;
+			}
+			emit_expr(g, slot);
+			emit(g, ";\n");
+		} break;
+		// Done at compile time
+		case NODE_RUN:
+		case NODE_CONST:
+			break;
+		default:
+			if (node->node_type >= NODE_BINOP && node->node_type <= NODE_FIELD_ACCESS) {
+				begin(g, node);
+				emit(g, "(void) ");
+				emit_expr(g, slot);
+				emit(g, ";\n");
+			}
+			else unsupported(g, node, "This statement can't be written as C yet");
+	}
+}
+
+// === Functions ===
+
+typedef struct {
+	Generator* g;
+	bool temporaries;
+} Prescan;
+
+/// The variable an assignment rebinds, if it assigns to the variable itself
+static SymbolId rebinds(Generator* g, AST_Node* const* slot) {
+	if ((*slot)->node_type == NODE_REREFERENCE) slot = (AST_Node* const*) &((AST_Reref*) *slot)->target;
+	if ((*slot)->node_type != NODE_QUALNAME) return 0;
+	ResolvedName found = resolution_lookup(g->res, slot);
+	return found.n_parts == arrlen(((AST_Qualname*) *slot)->parts)? found.symbol : 0;
+}
+
+static WalkAction prescan_pre(AST_Node** slot, void* ctx) {
+	Prescan* scan = ctx;
+	Generator* g = scan->g;
+	AST_Node* node = *slot;
+	switch (node->node_type) {
+		case NODE_ASSIGN: {
+			AST_AssignChain* chain = (AST_AssignChain*) node;
+			for (int i = 0; i < arrlen(chain->dest_exprs); i++) g->rebound[rebinds(g, &chain->dest_exprs[i])] = true;
+		} break;
+		case NODE_ASSIGN_MANY: {
+			AST_AssignParallel* parallel = (AST_AssignParallel*) node;
+			for (int i = 0; i < arrlen(parallel->dest_exprs); i++) g->rebound[rebinds(g, &parallel->dest_exprs[i])] = true;
+		} break;
+		case NODE_OP_ASSIGN:
+			g->rebound[rebinds(g, &((AST_OpAssign*) node)->dest_expr)] = true;
+			break;
+		case NODE_REREFERENCE:
+			g->rebound[rebinds(g, slot)] = true;
+			break;
+		case NODE_FUNC_CALL:
+			if (g->esc && escape_is_allocation(g->res, node) && escape_placement(g->esc, node) == PLACEMENT_TEMPORARY) scan->temporaries = true;
+			break;
+		default: break;
+	}
+	return WALK_CONTINUE;
+}
+
+static void emit_signature(Generator* g, Output* out, SymbolId id) {
+	const AST_FuncDef* def = (const AST_FuncDef*) resolution_symbol(g->res, id)->decl;
+	Output* saved = g->out;
+	g->out = out;
+	TypeId ret = def->ret_type? typecheck_type_of(g->check, def->ret_type) : TYPE_VOID;
+	const char* linkage = def->pub? "" : lowering_is_inline_candidate(g->lower, id)? "static inline " : "static ";
+	emit(g, "%s%s %s(", linkage, c_type(g, ret, (AST_Node*) def), symbol_name(g, id));
+	for (int p = 0; p < shlen(def->params); p++) {
+		SymbolId param = declared(g, &def->params[p].value->name);
+		TypeId type = typecheck_symbol_type(g->check, param);
+		const char* c = c_type(g, type, (AST_Node*) def->params[p].value);
+		bool restricted = g->alias && alias_is_restrict(g->alias, id, p) && type_of(g, strip_mutable(g, type))->kind == TYPE_KIND_POINTER;
+		emit(g, "%s%s%s %s", p? ", " : "", c, restricted? " restrict" : "", symbol_name(g, param));
+	}
+	emit(g, shlen(def->params)? ")" : "void)");
+	g->out = saved;
+}
+
+static void need_function(Generator* g, SymbolId id) {
+	if (g->emitted[id]) return;
+	g->emitted[id] = true;
+	const AST_FuncDef* def = (const AST_FuncDef*) resolution_symbol(g->res, id)->decl;
+	if (!def->body) {
+		unsupported(g, (AST_Node*) def, "'%s' has no body to write as C", def->name->name);
+		return;
+	}
+	arrput(g->queue, id);
+	emit_signature(g, &g->decls, id);
+	output_printf(&g->decls, ";\n");
+}
+
+static void need_constant(Generator* g, SymbolId id, const AST_Node* at) {
+	if (g->emitted[id]) return;
+	g->emitted[id] = true;
+	AST_Const* decl = (AST_Const*) resolution_symbol(g->res, id)->decl;
+	TypeId type = typecheck_symbol_type(g->check, id);
+	AST_Node* value = decl->value;
+	bool negative = value->node_type == NODE_UNARY && strcmp(((AST_Unary*) value)->op, "-") == 0;
+	if (negative) value = ((AST_Unary*) value)->expr;
+	switch (value->node_type) {
+		case NODE_INT:
+		case NODE_FLOAT:
+		case NODE_BOOL:
+		case NODE_CHAR:
+		case NODE_STRING:
+		case NODE_ARRAY:
+		case NODE_PACKED_ARRAY:
+			break;
+		default:
+			unsupported(g, at, "The value of '%s' isn't known at compile time, so it can't be written as C yet", decl->name->name);
+			return;
+	}
+	Output* out = g->out;
+	g->out = &g->decls;
+	emit(g, "static const %s %s = ", c_type(g, type, (AST_Node*) decl), symbol_name(g, id));
+	g->initializer = true;
+	emit_as(g, &decl->value, type);
+	g->initializer = false;
+	emit(g, ";\n");
+	g->out = out;
+}
+
+static void emit_function(Generator* g, SymbolId id) {
+	AST_FuncDef* def = (AST_FuncDef*) resolution_symbol(g->res, id)->decl;
+	g->func = id;
+	g->ret_type = def->ret_type? typecheck_type_of(g->check, def->ret_type) : TYPE_VOID;
+	int n_symbols = resolution_symbol_count(g->res) + 1;
+	memset(g->rebound, 0, n_symbols);
+	memset(g->restrict_data, 0, n_symbols);
+	Prescan scan = { g, false };
+	ast_walk_iterative((AST_Node**) &def->body, &(AST_Visitor) { prescan_pre, NULL, &scan });
+	g->has_mark = scan.temporaries;
+
+	g->out = &g->code;
+	emit(g, "\n");
+	begin(g, (AST_Node*) def);
+	emit_signature(g, &g->code, id);
+	emit(g, " {\n");
+	g->indent = 1;
+	// Elements of restrict arrays are read through a restrict pointer, so the C compiler knows
+	// stores to them don't change anything else
+	for (int p = 0; p < shlen(def->params); p++) {
+		SymbolId param = declared(g, &def->params[p].value->name);
+		TypeId type = value_type(g, typecheck_symbol_type(g->check, param));
+		const Type* t = type_of(g, type);
+		bool is_slice = t->kind == TYPE_KIND_ARRAY && static_size(g, type) < 0 && pointer_depth(g, typecheck_symbol_type(g->check, param)) == 0;
+		if (!g->alias || !alias_is_restrict(g->alias, id, p) || !is_slice || g->rebound[param]) continue;
+		g->restrict_data[param] = true;
+		begin(g, NULL);
+		emit(g, "%s* restrict rh_%s_data = %s.data;\n", c_type(g, t->base, (AST_Node*) def), symbol_name(g, param), symbol_name(g, param));
+	}
+	if (g->has_mark) {
+		begin(g, NULL);
+		emit(g, "size_t rh_mark = rh_temp_mark();\n");
+	}
+	g->indent = 0;
+	emit_body(g, def->body);
+	g->indent = 1;
+	int n = arrlen(def->body->body);
+	if (!n || def->body->body[n - 1]->node_type != NODE_RETURN) emit_exit(g, (AST_Node*) def->body);
+	g->indent = 0;
+	emit(g, "}\n");
+}
+
+// === Module ===
+
+int emit_c(FILE* out, AST_Module* module, Resolution res, TypeCheck check, TypeTable table, Lowering lower,
+		EscapeAnalysis esc, AliasAnalysis alias, Bounds bounds) {
+	Generator g = {
+		.module = module, .res = res, .check = check, .table = table, .lower = lower, .esc = esc, .alias = alias, .bounds = bounds,
+	};
+	Output file = { 0 };
+	output_printf(&file, "\"");
+	for (const char* p = module->src_file; p && *p; p++) output_printf(&file, *p == '"' || *p == '\\'? "\\%c" : "%c", *p);
+	output_printf(&file, "\"");
+	arrput(file.text, 0);
+	g.line_file = file.text;
+	int n_symbols = resolution_symbol_count(res) + 1;
+	g.names = calloc(n_symbols, sizeof(char*));
+	arrsetlen(g.emitted, n_symbols);
+	arrsetlen(g.rebound, n_symbols);
+	arrsetlen(g.restrict_data, n_symbols);
+	memset(g.emitted, 0, n_symbols);
+
+	// From 'main' and what is public, or everything there is
+	SymbolId main_id = 0;
+	for (int i = 0; i < shlen(module->scope); i++) {
+		AST_Node* item = module->scope[i].value;
+		if (item->node_type != NODE_FUNC_DEF) continue;
+		AST_FuncDef* def = (AST_FuncDef*) item;
+		SymbolId id = declared(&g, &def->name);
+		if (strcmp(def->name->name, "main") == 0) main_id = id;
+		if (id && (def->pub || id == main_id)) need_function(&g, id);
+	}
+	for (int i = 0; !arrlen(g.queue) && i < shlen(module->scope); i++) {
+		AST_Node* item = module->scope[i].value;
+		if (item->node_type == NODE_FUNC_DEF && ((AST_FuncDef*) item)->body) need_function(&g, declared(&g, &((AST_FuncDef*) item)->name));
+	}
+	for (int i = 0; i < arrlen(g.queue); i++) emit_function(&g, g.queue[i]);
+	if (main_id) {
+		const AST_FuncDef* def = (const AST_FuncDef*) resolution_symbol(res, main_id)->decl;
+		TypeKind ret = def->ret_type? type_of(&g, typecheck_type_of(check, def->ret_type))->kind : TYPE_KIND_VOID;
+		if (shlen(def->params)) unsupported(&g, (AST_Node*) def, "'main' can't take parameters in C yet");
+		output_printf(&g.code, "\nint main(void) {\n");
+		if (ret == TYPE_KIND_SINT || ret == TYPE_KIND_UINT) output_printf(&g.code, "\treturn (int) %s();\n}\n", symbol_name(&g, main_id));
+		else output_printf(&g.code, "\t%s();\n\treturn 0;\n}\n", symbol_name(&g, main_id));
+	}
+
+	int n_errors = arrlen(g.errors);
+	if (!n_errors) {
+		fprintf(out, "// Generated from %s. Integers wrap, so build with -fwrapv.\n\n", module->src_file);
+		fputs(RUNTIME, out);
+		fprintf(out, "\nRH_UNUSED static const char rh_src[] = %s;\n\n", g.line_file);
+		Output* sections[] = { &g.forward, &g.types, &g.decls, &g.code };
+		for (size_t i = 0; i < sizeof(sections) / sizeof(*sections); i++) {
+			if (!arrlen(sections[i]->text)) continue;
+			fwrite(sections[i]->text, 1, arrlen(sections[i]->text), out);
+			fputc('\n', out);
+		}
+		fflush(out);
+	}
+	report_errors(g.errors, n_errors);
+
+	for (int i = 0; i < n_errors; i++) free(g.errors[i].message);
+	arrfree(g.errors);
+	for (int i = 0; i < hmlen(g.type_names); i++) free(g.type_names[i].value);
+	hmfree(g.type_names);
+	for (int i = 0; i < shlen(g.idents); i++) free(g.idents[i].value);
+	shfree(g.idents);
+	for (int i = 0; i < n_symbols; i++) free(g.names[i]);
+	free(g.names);
+	arrfree(g.emitted);
+	arrfree(g.queue);
+	arrfree(g.rebound);
+	arrfree(g.restrict_data);
+	arrfree(g.loops);
+	arrfree(g.forward.text);
+	arrfree(g.types.text);
+	arrfree(g.decls.text);
+	arrfree(g.code.text);
+	arrfree(file.text);
+	return n_errors;
+}
@@ -0,0 +1,27 @@
+#pragma once
+// The C backend: a module that passed every check is written out as one C11 translation
+// unit, which builds with any C11 compiler (gcc -O3 -march=native -fwrapv for speed)
+#include <stdio.h>
+
+#include "ast.h"
+#include "resolve.h"
+#include "typecheck.h"
+#include "types.h"
+#include "lower.h"
+#include "escape.h"
+#include "alias.h"
+#include "bounds.h"
+
+/// Writes the module as C to `out`: the functions reachable from 'main' and the 'pub' ones
+/// (all of them if there are neither), with the structs, enums and constants they use. A
+/// 'main' that returns an Int gives the exit status. Statements are marked with '#line'
+/// directives for the source, so debuggers and profilers show it rather than the C.
+/// Calls are emitted as they were lowered, allocations where escape analysis placed them,
+/// with its implicit frees; mutable references that alias analysis proved restrict are
+/// 'restrict', and subscripts that bounds analysis proved in bounds aren't checked. Without
+/// one of the analyses (NULL), allocations are made on the heap, no parameter is restrict,
+/// or every subscript is checked.
+/// What can't be written as C yet is reported to stderr, in the order of the source, and
+/// nothing is written. Returns the number of those errors.
+int emit_c(FILE* out, AST_Module* module, Resolution res, TypeCheck check, TypeTable table, Lowering lower,
+	EscapeAnalysis esc, AliasAnalysis alias, Bounds bounds);
@@ -0,0 +1,684 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "escape.h"
+#include "ast_walk.h"
+#include "util.h"
+#include "stb_ds.h"
+
+// What a function does with the argument of a parameter
+#define PARAM_ESCAPES  1
+#define PARAM_RETURNED 2
+
+typedef struct {
+	AST_FuncDef* def;
+	SymbolId id;
+	int first_param;  // in the analysis' param_flags
+} Function;
+
+typedef struct {
+	const char* src_file;
+	int line, start_col, end_col;
+	char* message;
+} Warning;
+
+struct _escape_analysis {
+	Resolution res;
+	TypeCheck check;
+	Lowering lower;
+	bool warn_implicit_free;
+	Function ARRAY funcs;
+	int ARRAY func_of;          // by symbol id: the function's index, or -1
+	uint8_t ARRAY param_flags;  // of every function, one after the other
+	struct { const void* key; Placement value; } MAP placements;  // of the allocations not on the heap
+	struct { const void* key; SymbolId ARRAY value; } MAP frees;  // by exit
+	struct { const void* key; bool value; } MAP releases;  // the bodies of loops that give back each iteration
+	EscapeStats ARRAY stats;
+	Warning ARRAY warnings;
+};
+
+/// The state of the function being analyzed. Values are sets of what a pointer may have come
+/// from: one bit for each allocation in the function, then one for each parameter.
+typedef struct {
+	EscapeAnalysis esc;
+	const Function* func;
+	AST_Node* ARRAY sites;   // the allocating calls
+	int n_words;
+	int ARRAY set_of;        // by symbol id: the set of the local, or -1
+	SymbolId ARRAY locals;   // by set
+	int ARRAY assignments;   // by set, besides the declaration
+	uint64_t ARRAY sets;     // n_words for each local
+	uint64_t ARRAY escaped;  // what escapes
+	uint64_t ARRAY returned; // what is returned
+	AST_Node* ARRAY exits;   // scratch
+	AST_Block* ARRAY bodies; // scratch: of the function's loops
+	uint64_t ARRAY within;   // scratch: the temporary allocations in a loop's body
+	bool ARRAY declared;     // scratch: by set, whether the local is declared in it
+	bool has_async;
+	bool changed, counting;
+} Escaper;
+
+// === Sets ===
+
+static inline uint64_t* local_set(Escaper* e, int set) {
+	return &e->sets[set * e->n_words];
+}
+
+static inline bool has_bit(const uint64_t* set, int bit) {
+	return set[bit / 64] >> (bit % 64) & 1;
+}
+
+static inline void set_bit(Escaper* e, uint64_t* set, int bit) {
+	uint64_t mask = (uint64_t) 1 << (bit % 64);
+	if (set[bit / 64] & mask) return;
+	set[bit / 64] |= mask;
+	e->changed = true;
+}
+
+static void add_set(Escaper* e, uint64_t* into, const uint64_t* set) {
+	for (int i = 0; i < e->n_words; i++) {
+		if ((into[i] | set[i]) == into[i]) continue;
+		into[i] |= set[i];
+		e->changed = true;
+	}
+}
+
+static bool is_empty(Escaper* e, const uint64_t* set) {
+	for (int i = 0; i < e->n_words; i++) {
+		if (set[i]) return false;
+	}
+	return true;
+}
+
+// === Values ===
+
+bool escape_is_allocation(Resolution res, const AST_Node* node) {
+	if (node->node_type != NODE_FUNC_CALL) return false;
+	const AST_FuncCall* call = (const AST_FuncCall*) node;
+	if (call->func->node_type != NODE_QUALNAME || resolution_lookup(res, &call->func).symbol) return false;
+	const AST_Qualname* qn = (const AST_Qualname*) call->func;
+	return arrlen(qn->parts) == 1 && (strcmp(qn->parts[0], "alloc") == 0 || strcmp(qn->parts[0], "heapval") == 0);
+}
+
+bool escape_keeps_nothing(Resolution res, const AST_FuncCall* call) {
+	static const char* const builtins[] = { "print", "len", "free" };
+	if (call->func->node_type != NODE_QUALNAME || resolution_lookup(res, &call->func).symbol) return false;
+	const AST_Qualname* qn = (const AST_Qualname*) call->func;
+	for (size_t i = 0; arrlen(qn->parts) == 1 && i < sizeof(builtins) / sizeof(*builtins); i++) {
+		if (strcmp(qn->parts[0], builtins[i]) == 0) return true;
+	}
+	return false;
+}
+
+static int site_of(Escaper* e, const AST_Node* node) {
+	for (int i = 0; i < arrlen(e->sites); i++) {
+		if (e->sites[i] == node) return i;
+	}
+	return -1;
+}
+
+/// The set of the local a name held in *slot is, or -1 if it isn't one (or names a member of one)
+static int set_of_name(Escaper* e, AST_Node* const* slot) {
+	if ((*slot)->node_type != NODE_QUALNAME) return -1;
+	ResolvedName found = resolution_lookup(e->esc->res, slot);
+	if (!found.symbol || found.n_parts != arrlen(((const AST_Qualname*) *slot)->parts)) return -1;
+	return e->set_of[found.symbol];
+}
+
+static void add_sources(Escaper* e, AST_Node* const* slot, uint64_t* into);
+
+/// Adds what the arguments of a lowered call may have come from, for the parameters that have
+/// one of the flags
+static void add_arguments(Escaper* e, const LoweredCall* call, uint8_t flags, uint64_t* into) {
+	int f = e->esc->func_of[call->target];
+	if (f < 0) return;
+	const uint8_t* params = &e->esc->param_flags[e->esc->funcs[f].first_param];
+	for (int p = 0; p < call->n_args; p++) {
+		if (!(params[p] & flags)) continue;
+		if (p == call->vararg) {
+			for (int i = 0; i < call->n_varargs; i++) add_sources(e, call->varargs[i], into);
+		}
+		else if (call->args[p]) add_sources(e, call->args[p], into);
+	}
+}
+
+/// Adds what the value of an expression may have come from. Values that are made from
+/// others (fields, elements, arithmetic) aren't the pointers they are made from.
+static void add_sources(Escaper* e, AST_Node* const* slot, uint64_t* into) {
+	AST_Node* node = *slot;
+	switch (node->node_type) {
+		case NODE_QUALNAME: {
+			int set = set_of_name(e, slot);
+			if (set >= 0) add_set(e, into, local_set(e, set));
+		} break;
+		case NODE_FUNC_CALL: {
+			int site = site_of(e, node);
+			if (site >= 0) set_bit(e, into, site);
+			const LoweredCall* call = lowering_call(e->esc->lower, node);
+			if (call) add_arguments(e, call, PARAM_RETURNED, into);
+		} break;
+		case NODE_BINOP: {
+			AST_Binop* binop = (AST_Binop*) node;
+			const LoweredCall* call = lowering_call(e->esc->lower, node);
+			if (call) add_arguments(e, call, PARAM_RETURNED, into);
+			else if (strcmp(binop->op, "?") == 0) {
+				add_sources(e, &binop->lhs, into);
+				add_sources(e, &binop->rhs, into);
+			}
+		} break;
+		case NODE_UNARY: {
+			const LoweredCall* call = lowering_call(e->esc->lower, node);
+			if (call) add_arguments(e, call, PARAM_RETURNED, into);
+		} break;
+		case NODE_REREFERENCE:
+			add_sources(e, &((AST_Reref*) node)->target, into);
+			break;
+		case NODE_TERNARY: {
+			AST_Ternary* ternary = (AST_Ternary*) node;
+			add_sources(e, &ternary->true_expr, into);
+			add_sources(e, &ternary->false_expr, into);
+		} break;
+		default: break;
+	}
+}
+
+// === Escapes ===
+
+static WalkAction capture_pre(AST_Node** slot, void* ctx) {
+	Escaper* e = ctx;
+	if ((*slot)->node_type != NODE_QUALNAME) return WALK_CONTINUE;
+	ResolvedName found = resolution_lookup(e->esc->res, slot);
+	if (found.symbol && e->set_of[found.symbol] >= 0) add_set(e, e->escaped, local_set(e, e->set_of[found.symbol]));
+	return WALK_CONTINUE;
+}
+
+static void assign(Escaper* e, AST_Node* const* dest, AST_Node* const* src) {
+	AST_Node* target = *dest;
+	// '@p = q' points p somewhere else; 'p = q' stores q where p points, if it is a pointer
+	bool rebind = target->node_type == NODE_REREFERENCE;
+	if (rebind) dest = (AST_Node* const*) &((AST_Reref*) target)->target;
+	int set = set_of_name(e, dest);
+	if (set < 0) {
+		add_sources(e, src, e->escaped);
+		return;
+	}
+	if (e->counting) e->assignments[set]++;
+	if (!rebind && !is_empty(e, local_set(e, set))) add_sources(e, src, e->escaped);
+	else add_sources(e, src, local_set(e, set));
+}
+
+static void pass_arguments(Escaper* e, AST_Node* node) {
+	const LoweredCall* call = lowering_call(e->esc->lower, node);
+	if (call) add_arguments(e, call, PARAM_ESCAPES, e->escaped);
+}
+
+static WalkAction escape_pre(AST_Node** slot, void* ctx) {
+	Escaper* e = ctx;
+	AST_Node* node = *slot;
+	switch (node->node_type) {
+		case NODE_FUNC_CALL: {
+			AST_FuncCall* call = (AST_FuncCall*) node;
+			if (lowering_call(e->esc->lower, node)) pass_arguments(e, node);
+			// 'heapval' puts its argument on the heap, where it escapes to
+			else if (site_of(e, node) >= 0 || !escape_keeps_nothing(e->esc->res, call)) {
+				for (int i = 0; i < arrlen(call->pos_args); i++) add_sources(e, &call->pos_args[i], e->escaped);
+				for (int i = 0; i < shlen(call->kw_args); i++) add_sources(e, &call->kw_args[i].value, e->escaped);
+			}
+		} break;
+		case NODE_BINOP:
+		case NODE_UNARY:
+			pass_arguments(e, node);
+			break;
+		case NODE_OP_ASSIGN: {
+			AST_OpAssign* assignment = (AST_OpAssign*) node;
+			pass_arguments(e, node);
+			int set = set_of_name(e, &assignment->dest_expr);
+			if (set >= 0 && e->counting) e->assignments[set]++;
+		} break;
+		case NODE_COMPARISON: {
+			AST_ComparisonChain* chain = (AST_ComparisonChain*) node;
+			for (int i = 0; i < arrlen(chain->comparisons); i++) {
+				const LoweredCall* call = lowering_comparison(e->esc->lower, chain, i);
+				if (call) add_arguments(e, call, PARAM_ESCAPES, e->escaped);
+			}
+		} break;
+		case NODE_VAR_DECL: {
+			AST_VarDecl* decl = (AST_VarDecl*) node;
+			int set = e->set_of[resolution_lookup(e->esc->res, (AST_Node* const*) &decl->name).symbol];
+			if (decl->value && set >= 0) add_sources(e, &decl->value, local_set(e, set));
+		} break;
+		case NODE_ASSIGN: {
+			AST_AssignChain* chain = (AST_AssignChain*) node;
+			for (int i = 0; i < arrlen(chain->dest_exprs); i++) assign(e, &chain->dest_exprs[i], &chain->src_expr);
+		} break;
+		case NODE_ASSIGN_MANY: {
+			AST_AssignParallel* parallel = (AST_AssignParallel*) node;
+			int n = arrlen(parallel->dest_exprs);
+			for (int i = 0; i < arrlen(parallel->src_exprs); i++) {
+				if (n == arrlen(parallel->src_exprs)) assign(e, &parallel->dest_exprs[i], &parallel->src_exprs[i]);
+				else add_sources(e, &parallel->src_exprs[i], e->escaped);
+			}
+		} break;
+		case NODE_RETURN: {
+			AST_Return* ret = (AST_Return*) node;
+			if (ret->value) add_sources(e, &ret->value, e->returned);
+		} break;
+		case NODE_FAIL: {
+			AST_Fail* fail = (AST_Fail*) node;
+			if (fail->value) add_sources(e, &fail->value, e->escaped);
+		} break;
+		case NODE_ARRAY: {
+			AST_ArrayLiteral* array = (AST_ArrayLiteral*) node;
+			for (int i = 0; i < arrlen(array->elements); i++) add_sources(e, &array->elements[i], e->escaped);
+		} break;
+		case NODE_ARRAY_COMP:
+			add_sources(e, &((AST_ArrayComprehension*) node)->element, e->escaped);
+			break;
+		// Contexts outlive what they are set in
+		case NODE_CONTEXT:
+			add_sources(e, &((AST_Context*) node)->value, e->escaped);
+			break;
+		// Locals used by async code may be used after the function returns
+		case NODE_ASYNC:
+			ast_walk_iterative(slot, &(AST_Visitor) { capture_pre, NULL, e });
+			break;
+		default: break;
+	}
+	return WALK_CONTINUE;
+}
+
+// === Functions ===
+
+static void add_local(Escaper* e, SymbolId id) {
+	if (!id || e->set_of[id] >= 0) return;
+	e->set_of[id] = arrlen(e->locals);
+	arrput(e->locals, id);
+	arrput(e->assignments, 0);
+}
+
+static WalkAction collect_pre(AST_Node** slot, void* ctx) {
+	Escaper* e = ctx;
+	AST_Node* node = *slot;
+	Resolution res = e->esc->res;
+	switch (node->node_type) {
+		case NODE_FUNC_CALL:
+			if (escape_is_allocation(res, node)) arrput(e->sites, node);
+			break;
+		case NODE_VAR_DECL:
+			add_local(e, resolution_lookup(res, (AST_Node* const*) &((AST_VarDecl*) node)->name).symbol);
+			break;
+		case NODE_FOR_SIMPLE:
+			add_local(e, resolution_lookup(res, (AST_Node* const*) &((AST_ForSimple*) node)->name).symbol);
+			break;
+		default: break;
+	}
+	return WALK_CONTINUE;
+}
+
+static void reset(Escaper* e, const Function* func) {
+	for (int i = 0; i < arrlen(e->locals); i++) e->set_of[e->locals[i]] = -1;
+	e->func = func;
+	if (e->sites) stbds_header(e->sites)->length = 0;
+	if (e->locals) stbds_header(e->locals)->length = 0;
+	if (e->assignments) stbds_header(e->assignments)->length = 0;
+}
+
+/// Works out what escapes from a function, and what its parameters do with their arguments.
+/// Whether the latter changed.
+static bool analyze_function(Escaper* e, const Function* func) {
+	reset(e, func);
+	int n_params = shlen(func->def->params);
+	for (int p = 0; p < n_params; p++) {
+		add_local(e, resolution_lookup(e->esc->res, (AST_Node* const*) &func->def->params[p].value->name).symbol);
+	}
+	ast_walk_iterative((AST_Node**) &func->def->body, &(AST_Visitor) { collect_pre, NULL, e });
+	int n_sites = arrlen(e->sites);
+	e->n_words = (n_sites + n_params + 63) / 64;
+	if (!e->n_words) e->n_words = 1;
+	arrsetlen(e->sets, arrlen(e->locals) * e->n_words);
+	arrsetlen(e->escaped, e->n_words);
+	arrsetlen(e->returned, e->n_words);
+	memset(e->sets, 0, arrlen(e->sets) * sizeof(uint64_t));
+	memset(e->escaped, 0, e->n_words * sizeof(uint64_t));
+	memset(e->returned, 0, e->n_words * sizeof(uint64_t));
+	for (int p = 0; p < n_params; p++) {
+		SymbolId id = resolution_lookup(e->esc->res, (AST_Node* const*) &func->def->params[p].value->name).symbol;
+		if (id) set_bit(e, local_set(e, e->set_of[id]), n_sites + p);
+	}
+	// What goes where doesn't depend on the order, so this goes on until nothing new is found
+	e->counting = true;
+	do {
+		e->changed = false;
+		ast_walk_iterative((AST_Node**) &func->def->body, &(AST_Visitor) { escape_pre, NULL, e });
+		e->counting = false;
+	} while (e->changed);
+	bool changed = false;
+	uint8_t* flags = &e->esc->param_flags[func->first_param];
+	for (int p = 0; p < n_params; p++) {
+		uint8_t now = (has_bit(e->escaped, n_sites + p)? PARAM_ESCAPES : 0) | (has_bit(e->returned, n_sites + p)? PARAM_RETURNED : 0);
+		changed |= now != flags[p];
+		flags[p] = now;
+	}
+	return changed;
+}
+
+// === Implicit frees ===
+
+static WalkAction exits_pre(AST_Node** slot, void* ctx) {
+	Escaper* e = ctx;
+	switch ((*slot)->node_type) {
+		case NODE_RETURN:
+		case NODE_FAIL:
+			arrput(e->exits, *slot);
+			break;
+		case NODE_ASYNC:
+			return WALK_SKIP;
+		default: break;
+	}
+	return WALK_CONTINUE;
+}
+
+typedef struct {
+	Resolution res;
+	SymbolId local;
+	bool found;
+} Mention;
+
+static WalkAction mention_pre(AST_Node** slot, void* ctx) {
+	Mention* m = ctx;
+	if ((*slot)->node_type == NODE_QUALNAME && resolution_lookup(m->res, slot).symbol == m->local) {
+		m->found = true;
+		return WALK_STOP;
+	}
+	return WALK_CONTINUE;
+}
+
+static bool mentions(Resolution res, AST_Node** slot, SymbolId local) {
+	Mention m = { res, local, false };
+	if (*slot) ast_walk_iterative(slot, &(AST_Visitor) { mention_pre, NULL, &m });
+	return m.found;
+}
+
+static void add_free(EscapeAnalysis esc, const AST_Node* exit, SymbolId local) {
+	ptrdiff_t i = hmgeti(esc->frees, exit);
+	if (i < 0) {
+		hmput(esc->frees, exit, NULL);
+		i = hmgeti(esc->frees, exit);
+	}
+	arrput(esc->frees[i].value, local);
+}
+
+static void warn(EscapeAnalysis esc, const AST_Node* at, const char* fmt, ...) {
+	va_list args;
+	va_start(args, fmt);
+	int length = vsnprintf(NULL, 0, fmt, args);
+	va_end(args);
+	char* message = malloc(length + 1);
+	va_start(args, fmt);
+	vsnprintf(message, length + 1, fmt, args);
+	va_end(args);
+	Warning warning = { at->src_file, at->start_line, at->start_col, at->end_line > at->start_line? -1 : (int) at->end_col, message };
+	arrput(esc->warnings, warning);
+}
+
+/// A pointer that is returned on some paths can be freed on the others, if it is put in a
+/// local by a statement of the function's body, and stays there. Then the exits after that
+/// statement that don't return the local free it, and so does falling off the end.
+static bool free_where_not_returned(Escaper* e, int site) {
+	AST_Block* body = e->func->def->body;
+	int decl_at = -1;
+	for (int i = 0; i < arrlen(body->body) && decl_at < 0; i++) {
+		if (body->body[i]->node_type == NODE_VAR_DECL && ((AST_VarDecl*) body->body[i])->value == e->sites[site]) decl_at = i;
+	}
+	if (decl_at < 0) return false;
+	AST_VarDecl* decl = (AST_VarDecl*) body->body[decl_at];
+	SymbolId local = resolution_lookup(e->esc->res, (AST_Node* const*) &decl->name).symbol;
+	if (!local || e->assignments[e->set_of[local]]) return false;
+	for (int i = 0; i < arrlen(e->locals); i++) {
+		if (e->locals[i] != local && has_bit(local_set(e, i), site)) return false;
+	}
+	if (e->exits) stbds_header(e->exits)->length = 0;
+	for (int i = decl_at + 1; i < arrlen(body->body); i++) {
+		ast_walk_iterative(&body->body[i], &(AST_Visitor) { exits_pre, NULL, e });
+	}
+	int n_freeing = 0;
+	for (int i = 0; i < arrlen(e->exits); i++) {
+		AST_Node** value = e->exits[i]->node_type == NODE_RETURN? &((AST_Return*) e->exits[i])->value : &((AST_Fail*) e->exits[i])->value;
+		bool returns_it = e->exits[i]->node_type == NODE_RETURN && *value && set_of_name(e, value) == e->set_of[local];
+		if (returns_it) {
+			e->exits[i] = NULL;
+			continue;
+		}
+		// It would be freed before it is used
+		if (mentions(e->esc->res, value, local)) return false;
+		if (e->exits[i]->node_type == NODE_FAIL && mentions(e->esc->res, &((AST_Fail*) e->exits[i])->message, local)) return false;
+		n_freeing++;
+	}
+	AST_Node* last = arrlast(body->body);
+	bool falls_off = last->node_type != NODE_RETURN && last->node_type != NODE_FAIL;
+	if (!n_freeing && !falls_off) return false;
+	for (int i = 0; i < arrlen(e->exits); i++) {
+		if (e->exits[i]) add_free(e->esc, e->exits[i], local);
+	}
+	if (falls_off) add_free(e->esc, (AST_Node*) body, local);
+	if (e->esc->warn_implicit_free) {
+		warn(e->esc, (AST_Node*) decl->name, "'%s' is freed implicitly where '%s' doesn't return it",
+			decl->name->name, resolution_symbol(e->esc->res, e->func->id)->name);
+	}
+	return true;
+}
+
+static void place_allocations(Escaper* e, EscapeStats* stats) {
+	stats->n_allocations = arrlen(e->sites);
+	for (int i = 0; i < arrlen(e->sites); i++) {
+		Placement placement;
+		if (has_bit(e->escaped, i)) placement = PLACEMENT_HEAP;
+		else if (!has_bit(e->returned, i)) placement = PLACEMENT_TEMPORARY;
+		else placement = free_where_not_returned(e, i)? PLACEMENT_FREED : PLACEMENT_HEAP;
+		if (placement == PLACEMENT_HEAP) continue;
+		hmput(e->esc->placements, e->sites[i], placement);
+		if (placement == PLACEMENT_TEMPORARY) stats->n_temporary++;
+		else stats->n_freed++;
+	}
+}
+
+// === Iterations ===
+
+static WalkAction loops_pre(AST_Node** slot, void* ctx) {
+	Escaper* e = ctx;
+	switch ((*slot)->node_type) {
+		case NODE_WHILE_LOOP:
+			arrput(e->bodies, ((AST_WhileLoop*) *slot)->body);
+			break;
+		case NODE_FOR_LOOP:
+			arrput(e->bodies, ((AST_ForLoop*) *slot)->body);
+			break;
+		case NODE_ASYNC:
+			return WALK_SKIP;
+		default: break;
+	}
+	return WALK_CONTINUE;
+}
+
+static WalkAction within_pre(AST_Node** slot, void* ctx) {
+	Escaper* e = ctx;
+	AST_Node* node = *slot;
+	Resolution res = e->esc->res;
+	SymbolId id = 0;
+	switch (node->node_type) {
+		case NODE_FUNC_CALL: {
+			int site = site_of(e, node);
+			if (site >= 0 && escape_placement(e->esc, node) == PLACEMENT_TEMPORARY) e->within[site / 64] |= (uint64_t) 1 << (site % 64);
+		} break;
+		case NODE_VAR_DECL:
+			id = resolution_lookup(res, (AST_Node* const*) &((AST_VarDecl*) node)->name).symbol;
+			break;
+		case NODE_FOR_SIMPLE:
+			id = resolution_lookup(res, (AST_Node* const*) &((AST_ForSimple*) node)->name).symbol;
+			break;
+		case NODE_ASYNC:
+			e->has_async = true;
+			return WALK_STOP;
+		default: break;
+	}
+	if (id && e->set_of[id] >= 0) e->declared[e->set_of[id]] = true;
+	return WALK_CONTINUE;
+}
+
+/// The temporary allocations made in an iteration of a loop can be given back when it ends
+/// if only locals declared in the body may hold them, as those are gone by then
+static void find_releases(Escaper* e) {
+	if (e->bodies) stbds_header(e->bodies)->length = 0;
+	ast_walk_iterative((AST_Node**) &e->func->def->body, &(AST_Visitor) { loops_pre, NULL, e });
+	arrsetlen(e->within, e->n_words);
+	arrsetlen(e->declared, arrlen(e->locals));
+	for (int i = 0; i < arrlen(e->bodies); i++) {
+		memset(e->within, 0, e->n_words * sizeof(uint64_t));
+		memset(e->declared, 0, arrlen(e->declared) * sizeof(bool));
+		e->has_async = false;
+		ast_walk_iterative((AST_Node**) &e->bodies[i], &(AST_Visitor) { within_pre, NULL, e });
+		if (e->has_async || is_empty(e, e->within)) continue;
+		bool kept = false;
+		for (int set = 0; set < arrlen(e->locals) && !kept; set++) {
+			for (int w = 0; w < e->n_words && !e->declared[set]; w++) kept |= (local_set(e, set)[w] & e->within[w]) != 0;
+		}
+		if (!kept) hmput(e->esc->releases, e->bodies[i], true);
+	}
+}
+
+// === Diagnostics ===
+
+static int compare_warnings(const void* a, const void* b) {
+	const Warning* x = a;
+	const Warning* y = b;
+	if (x->line != y->line) return x->line < y->line? -1 : 1;
+	return (x->start_col > y->start_col) - (x->start_col < y->start_col);
+}
+
+static void report_warnings(Warning* warnings, int n) {
+	if (!n) return;
+	qsort(warnings, n, sizeof(Warning), compare_warnings);
+	char* source = (char*) read_entire_file(warnings[0].src_file);
+	const char* ARRAY lines = NULL;
+	for (char* p = source; p && *p; p++) {
+		if (p == source) arrput(lines, p);
+		if (*p != '\n') continue;
+		*p = 0;
+		arrput(lines, p + 1);
+	}
+	for (int i = 0; i < n; i++) {
+		const Warning* w = &warnings[i];
+		fprintf(stderr, "In '%s' at line %d, column %d...\n  Warning: %s\n", w->src_file, w->line, w->start_col, w->message);
+		if (w->line >= 1 && w->line <= arrlen(lines)) {
+			const char* line = lines[w->line - 1];
+			show_error_line(stderr, line, w->line, w->start_col, w->end_col < 0? (int) strlen(line) : w->end_col);
+		}
+	}
+	free(source);
+	arrfree(lines);
+}
+
+// === Analysis ===
+
+EscapeAnalysis escape_analyze(AST_Module* module, Resolution res, TypeCheck check, Lowering lower) {
+	EscapeAnalysis esc = calloc(1, sizeof(struct _escape_analysis));
+	esc->res = res;
+	esc->check = check;
+	esc->lower = lower;
+	int n_symbols = resolution_symbol_count(res) + 1;
+	arrsetlen(esc->func_of, n_symbols);
+	for (int i = 0; i < n_symbols; i++) esc->func_of[i] = -1;
+	for (int i = 0; i < shlen(module->scope); i++) {
+		AST_Node* item = module->scope[i].value;
+		if (item->node_type == NODE_WARN && strcmp(((AST_Warn*) item)->warning, "implicit_free") == 0) esc->warn_implicit_free = true;
+		if (item->node_type != NODE_FUNC_DEF || !((AST_FuncDef*) item)->body) continue;
+		AST_FuncDef* def = (AST_FuncDef*) item;
+		SymbolId id = resolution_lookup(res, (AST_Node* const*) &def->name).symbol;
+		if (!id) continue;
+		Function func = { def, id, arrlen(esc->param_flags) };
+		esc->func_of[id] = arrlen(esc->funcs);
+		arrput(esc->funcs, func);
+		for (int p = 0; p < shlen(def->params); p++) arrput(esc->param_flags, 0);
+	}
+
+	Escaper e = { .esc = esc };
+	arrsetlen(e.set_of, n_symbols);
+	for (int i = 0; i < n_symbols; i++) e.set_of[i] = -1;
+	// What parameters do with their arguments starts out as nothing, and only grows, until
+	// no function's calls find more
+	bool changed;
+	do {
+		changed = false;
+		for (int i = 0; i < arrlen(esc->funcs); i++) changed |= analyze_function(&e, &esc->funcs[i]);
+	} while (changed);
+	for (int i = 0; i < arrlen(esc->funcs); i++) {
+		analyze_function(&e, &esc->funcs[i]);
+		EscapeStats stats = { .func = esc->funcs[i].id };
+		place_allocations(&e, &stats);
+		if (stats.n_temporary) find_releases(&e);
+		arrput(esc->stats, stats);
+	}
+	report_warnings(esc->warnings, arrlen(esc->warnings));
+
+	arrfree(e.sites);
+	arrfree(e.set_of);
+	arrfree(e.locals);
+	arrfree(e.assignments);
+	arrfree(e.sets);
+	arrfree(e.escaped);
+	arrfree(e.returned);
+	arrfree(e.exits);
+	arrfree(e.bodies);
+	arrfree(e.within);
+	arrfree(e.declared);
+	return esc;
+}
+
+void escape_destroy(EscapeAnalysis esc) {
+	if (!esc) return;
+	for (int i = 0; i < hmlen(esc->frees); i++) arrfree(esc->frees[i].value);
+	hmfree(esc->frees);
+	hmfree(esc->placements);
+	hmfree(esc->releases);
+	for (int i = 0; i < arrlen(esc->warnings); i++) free(esc->warnings[i].message);
+	arrfree(esc->warnings);
+	arrfree(esc->funcs);
+	arrfree(esc->func_of);
+	arrfree(esc->param_flags);
+	arrfree(esc->stats);
+	free(esc);
+}
+
+Placement escape_placement(EscapeAnalysis esc, const AST_Node* alloc) {
+	ptrdiff_t i = hmgeti(esc->placements, alloc);
+	return i < 0? PLACEMENT_HEAP : esc->placements[i].value;
+}
+
+const SymbolId* escape_frees(EscapeAnalysis esc, const AST_Node* exit, int* count) {
+	ptrdiff_t i = hmgeti(esc->frees, exit);
+	*count = i < 0? 0 : arrlen(esc->frees[i].value);
+	return i < 0? NULL : esc->frees[i].value;
+}
+
+bool escape_iteration_releases(EscapeAnalysis esc, const AST_Block* body) {
+	return hmgeti(esc->releases, body) >= 0;
+}
+
+bool escape_param_keeps(EscapeAnalysis esc, SymbolId func, int param) {
+	int f = func > 0 && func < arrlen(esc->func_of)? esc->func_of[func] : -1;
+	return f < 0 || esc->param_flags[esc->funcs[f].first_param + param] != 0;
+}
+
+int escape_function_count(EscapeAnalysis esc) {
+	return arrlen(esc->stats);
+}
+
+const EscapeStats* escape_function_stats(EscapeAnalysis esc, int i) {
+	return &esc->stats[i];
+}
+
+int escape_warning_count(EscapeAnalysis esc) {
+	return arrlen(esc->warnings);
+}
@@ -0,0 +1,60 @@
+#pragma once
+// Escape analysis: where the pointers that 'alloc' and 'heapval' make in a function can end
+// up, which decides what allocates them, and where they are freed
+#include "ast.h"
+#include "resolve.h"
+#include "typecheck.h"
+#include "lower.h"
+
+typedef struct _escape_analysis* EscapeAnalysis;
+
+typedef enum {
+	PLACEMENT_HEAP,       // may escape: made by the primary allocator, as written
+	PLACEMENT_TEMPORARY,  // never leaves the function: made by the thread's temporary allocator
+	PLACEMENT_FREED,      // returned on some paths: freed implicitly on the others
+} Placement;
+
+typedef struct {
+	SymbolId func;
+	int n_allocations;  // all of them on the primary allocator, as written
+	int n_temporary;
+	int n_freed;
+} EscapeStats;
+
+/// Analyzes the functions of a module that type-checked without errors, with its calls
+/// lowered. A pointer escapes if it is stored anywhere but in a local, passed where it
+/// escapes, or returned; what each parameter of a function does with its argument is
+/// worked out for all of the module's functions together, so pointers can be passed down
+/// without escaping. Calls of anything else (imports, function values, struct
+/// constructors) are taken to keep their arguments.
+/// A pointer that is only returned, by the local it is first put in, is freed before the
+/// other returns of the function, and before the end of its body; modules with
+/// '#warn implicit_free' get a warning for each of those, on stderr.
+/// The handle keeps nodes of the tree, so the module must outlive it.
+EscapeAnalysis escape_analyze(AST_Module* module, Resolution res, TypeCheck check, Lowering lower);
+void escape_destroy(EscapeAnalysis esc);
+
+/// What allocates the value of an allocating AST_FuncCall; PLACEMENT_HEAP for any other node
+Placement escape_placement(EscapeAnalysis esc, const AST_Node* alloc);
+/// The locals to free before an AST_Return or AST_Fail, or at the end of the body block of
+/// a function, in the order they were declared
+const SymbolId* escape_frees(EscapeAnalysis esc, const AST_Node* exit, int* count);
+
+/// Whether what the temporary allocator gives in an iteration of a loop, whose body this is,
+/// can be given back when the iteration ends, or skips to the next: the body makes
+/// temporary allocations, and no local declared outside of it may hold one of them
+bool escape_iteration_releases(EscapeAnalysis esc, const AST_Block* body);
+
+/// Whether a function may keep what is passed for a parameter, by storing it or returning it.
+/// True for what isn't a function of the module with a body.
+bool escape_param_keeps(EscapeAnalysis esc, SymbolId func, int param);
+
+/// Whether a call is of the builtin 'alloc' or 'heapval'
+bool escape_is_allocation(Resolution res, const AST_Node* node);
+/// Whether a call is of a builtin that doesn't keep what it is given (print, len, free)
+bool escape_keeps_nothing(Resolution res, const AST_FuncCall* call);
+
+/// Functions, in the order of the module's scope
+int escape_function_count(EscapeAnalysis esc);
+const EscapeStats* escape_function_stats(EscapeAnalysis esc, int i);
+int escape_warning_count(EscapeAnalysis esc);
@@ -0,0 +1,371 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "fold.h"
+#include "constant.h"
+#include "ast_walk.h"
+#include "ast_intern.h"
+#include "stb_ds.h"
+
+#define FOLD_BLOCK_SIZE (64 << 10)
+// Longer repetitions of strings are left to be made at run time
+#define FOLD_MAX_STRING (1 << 20)
+
+typedef enum {
+	CONST_PENDING = 0,
+	CONST_IN_PROGRESS,
+	CONST_DONE,
+} ConstState;
+
+struct _const_fold {
+	Resolution res;
+	TypeTable table;
+	struct { AST_Node* const* key; Constant value; } MAP values;  // of the operators folded so far
+	Constant ARRAY constants;  // by symbol id
+	uint8_t ARRAY const_states;
+	AST_Node** ARRAY pending;    // slots to look for folded operators in; see replace_folded
+	char* ARRAY blocks;          // the literals and strings made
+	size_t block_left;
+	int n_folded;
+};
+
+static void* fold_alloc(ConstFold fold, size_t size) {
+	size = (size + 15) & ~(size_t) 15;
+	if (size > FOLD_BLOCK_SIZE / 4) {
+		// Kept behind the current block, which stays in use
+		char* big = calloc(1, size);
+		if (arrlen(fold->blocks)) {
+			char* current = arrlast(fold->blocks);
+			fold->blocks[arrlen(fold->blocks) - 1] = big;
+			arrput(fold->blocks, current);
+		}
+		else arrput(fold->blocks, big);  // with nothing left in it
+		return big;
+	}
+	if (!arrlen(fold->blocks) || fold->block_left < size) {
+		arrput(fold->blocks, calloc(1, FOLD_BLOCK_SIZE));
+		fold->block_left = FOLD_BLOCK_SIZE;
+	}
+	char* at = arrlast(fold->blocks) + (FOLD_BLOCK_SIZE - fold->block_left);
+	fold->block_left -= size;
+	return at;
+}
+
+// === Values ===
+
+#define UNKNOWN CONSTANT_UNKNOWN
+
+/// The types folded expressions are literals of
+static inline bool is_literal_type(TypeId type) {
+	return type == TYPE_INT || type == TYPE_FLOAT || type == TYPE_BOOL || type == TYPE_STRING;
+}
+
+/// The value of the expression held in *slot, if it is a literal or has been folded. The
+/// operators folded are literals too, if they are of a literal type, unless their parents
+/// are folded with them.
+static Constant value_of(ConstFold fold, AST_Node* const* slot) {
+	const AST_Node* node = *slot;
+	switch (node->node_type) {
+		case NODE_INT: return (Constant) { .type = TYPE_INT, .literal = true, .i = ((const AST_Int*) node)->value };
+		case NODE_FLOAT: return (Constant) { .type = TYPE_FLOAT, .literal = true, .f = (double) ((const AST_Float*) node)->value };
+		case NODE_BOOL: return (Constant) { .type = TYPE_BOOL, .literal = true, .b = ((const AST_Bool*) node)->value };
+		case NODE_STRING: return (Constant) { .type = TYPE_STRING, .literal = true, .s = ((const AST_String*) node)->value };
+		default: break;
+	}
+	ptrdiff_t i = hmgeti(fold->values, slot);
+	return i < 0? UNKNOWN : fold->values[i].value;
+}
+
+// === Operators ===
+
+static Constant repeat(ConstFold fold, const char* s, int64_t n) {
+	size_t len = strlen(s);
+	if (n < 0 || (len && (uint64_t) n > FOLD_MAX_STRING / len)) return UNKNOWN;
+	char* out = fold_alloc(fold, len * n + 1);
+	for (int64_t i = 0; i < n; i++) memcpy(out + len * i, s, len);
+	return (Constant) { .type = TYPE_STRING, .s = out };
+}
+
+static Constant arithmetic(ConstFold fold, char op, Constant a, Constant b) {
+	// A string times n is it repeated
+	if (op == '*' && a.type == TYPE_STRING && b.type != TYPE_BOOL) {
+		TypeKind kind = type_get(fold->table, b.type)->kind;
+		if (kind == TYPE_KIND_UINT && b.i < 0) return UNKNOWN;
+		return kind == TYPE_KIND_SINT || kind == TYPE_KIND_UINT? repeat(fold, a.s, b.i) : UNKNOWN;
+	}
+	return constant_arithmetic(fold->table, op, a, b);
+}
+
+static Constant comparison(ConstFold fold, AST_ComparisonChain* chain) {
+	bool result = true;
+	for (int i = 0; i < arrlen(chain->comparisons); i++) {
+		Constant a = value_of(fold, &chain->operands[i]), b = value_of(fold, &chain->operands[i + 1]);
+		if (a.type == TYPE_UNKNOWN || b.type == TYPE_UNKNOWN) return UNKNOWN;
+		const char* op = chain->comparisons[i];
+		int order = constant_compare(fold->table, op, a, b);
+		bool known, holds = constant_order_holds(op, order, &known);
+		if (order == 2 || !known) return UNKNOWN;
+		result = result && holds;
+	}
+	return (Constant) { .type = TYPE_BOOL, .b = result };
+}
+
+static Constant conditional(ConstFold fold, AST_Ternary* ternary) {
+	Constant condition = value_of(fold, &ternary->condition);
+	Constant yes = value_of(fold, &ternary->true_expr), no = value_of(fold, &ternary->false_expr);
+	if (condition.type != TYPE_BOOL || yes.type == TYPE_UNKNOWN || no.type == TYPE_UNKNOWN) return UNKNOWN;
+	if (!constant_common_type(fold->table, &yes, &no)) return UNKNOWN;
+	return condition.b? yes : no;
+}
+
+/// The value of the operator node held in *slot, from those of its operands
+static Constant operator_value(ConstFold fold, AST_Node* const* slot) {
+	AST_Node* node = *slot;
+	switch (node->node_type) {
+		case NODE_BINOP: {
+			AST_Binop* binop = (AST_Binop*) node;
+			// Custom operators are overloads
+			if (binop->op[1] || !strchr("+-*/%^", binop->op[0])) return UNKNOWN;
+			Constant a = value_of(fold, &binop->lhs), b = value_of(fold, &binop->rhs);
+			if (a.type == TYPE_UNKNOWN || b.type == TYPE_UNKNOWN) return UNKNOWN;
+			return arithmetic(fold, binop->op[0], a, b);
+		}
+		case NODE_UNARY: {
+			AST_Unary* unary = (AST_Unary*) node;
+			Constant value = value_of(fold, &unary->expr);
+			Constant negated = constant_negate(fold->table, value);
+			if (strcmp(unary->op, "-") == 0) return negated;
+			// Plus is for the same numbers as minus
+			return strcmp(unary->op, "+") == 0 && constant_is_known(&negated)? value : UNKNOWN;
+		}
+		case NODE_COMPARISON: return comparison(fold, (AST_ComparisonChain*) node);
+		case NODE_NOT: {
+			Constant value = value_of(fold, &((AST_Not*) node)->expr);
+			if (value.type != TYPE_BOOL) return UNKNOWN;
+			value.b = !value.b;
+			return value;
+		}
+		case NODE_AND:
+		case NODE_OR: {
+			AST_And* logic = (AST_And*) node;
+			Constant a = value_of(fold, &logic->lhs), b = value_of(fold, &logic->rhs);
+			if (a.type != TYPE_BOOL || b.type != TYPE_BOOL) return UNKNOWN;
+			a.b = node->node_type == NODE_AND? a.b && b.b : a.b || b.b;
+			return a;
+		}
+		case NODE_TERNARY: return conditional(fold, (AST_Ternary*) node);
+		default: return UNKNOWN;
+	}
+}
+
+static inline bool is_operator(const AST_Node* node) {
+	switch (node->node_type) {
+		case NODE_BINOP:
+		case NODE_UNARY:
+		case NODE_COMPARISON:
+		case NODE_NOT:
+		case NODE_AND:
+		case NODE_OR:
+		case NODE_TERNARY:
+			return true;
+		default:
+			return false;
+	}
+}
+
+// === Replacing ===
+
+static AST_Node* make_literal(ConstFold fold, const Constant* value, const AST_Node* at) {
+	AST_Node* node;
+	switch (value->type) {
+		case TYPE_INT: {
+			AST_Int* lit = fold_alloc(fold, sizeof(AST_Int));
+			lit->value = value->i;
+			node = (AST_Node*) lit;
+			node->node_type = NODE_INT;
+		} break;
+		case TYPE_FLOAT: {
+			AST_Float* lit = fold_alloc(fold, sizeof(AST_Float));
+			lit->value = value->f;
+			node = (AST_Node*) lit;
+			node->node_type = NODE_FLOAT;
+		} break;
+		case TYPE_BOOL: {
+			AST_Bool* lit = fold_alloc(fold, sizeof(AST_Bool));
+			lit->value = value->b;
+			node = (AST_Node*) lit;
+			node->node_type = NODE_BOOL;
+		} break;
+		default: {
+			AST_String* lit = fold_alloc(fold, sizeof(AST_String));
+			lit->value = value->s;
+			node = (AST_Node*) lit;
+			node->node_type = NODE_STRING;
+		} break;
+	}
+	node->src_file = at->src_file;
+	node->start_line = at->start_line;
+	node->start_col = at->start_col;
+	node->end_line = at->end_line;
+	node->end_col = at->end_col;
+	return node;
+}
+
+static void push_children(ConstFold fold, AST_Node* node) {
+	const AST_NodeLayout* layout = &AST_LAYOUT[node->node_type];
+	for (int i = 0; i < layout->n_fields; i++) {
+		char* at = (char*) node + layout->fields[i].offset;
+		if (layout->fields[i].kind == AST_CHILD_NODE) {
+			if (*(AST_Node**) at) arrput(fold->pending, (AST_Node**) at);
+		}
+		else if (layout->fields[i].kind == AST_CHILD_ARRAY) {
+			AST_Node** items = *(AST_Node***) at;
+			for (int j = 0; j < arrlen(items); j++) {
+				if (items[j]) arrput(fold->pending, &items[j]);
+			}
+		}
+	}
+}
+
+/// Puts literals in place of the largest folded operators under a node that wasn't folded
+/// itself. Operators of other types than the literals' have their operands looked at instead.
+static void replace_folded(ConstFold fold, AST_Node* parent) {
+	push_children(fold, parent);
+	while (arrlen(fold->pending)) {
+		AST_Node** slot = arrpop(fold->pending);
+		AST_Node* node = *slot;
+		if (!is_operator(node)) continue;
+		ptrdiff_t i = hmgeti(fold->values, slot);
+		if (i < 0) continue;
+		if (!is_literal_type(fold->values[i].value.type)) {
+			push_children(fold, node);
+			continue;
+		}
+		*slot = make_literal(fold, &fold->values[i].value, node);
+		fold->n_folded++;
+		// The nodes stay in their parser's arenas, but the arrays of the subtree are no longer reachable
+		ast_free_owned(&node);
+	}
+}
+
+// === Walk ===
+
+static Constant const_value(ConstFold fold, SymbolId id);
+static void finish_const(ConstFold fold, SymbolId id);
+
+static SymbolId const_symbol(ConstFold fold, AST_Const* constant) {
+	return resolution_lookup(fold->res, (AST_Node**) &constant->name).symbol;
+}
+
+static WalkAction fold_pre(AST_Node** slot, void* ctx) {
+	ConstFold fold = ctx;
+	// Shared nodes belong to every tree they are in
+	if (ast_is_shared(*slot)) return WALK_SKIP;
+	if ((*slot)->node_type == NODE_CONST) {
+		SymbolId id = const_symbol(fold, (AST_Const*) *slot);
+		if (!id) return WALK_CONTINUE;
+		// Folded already where it was used; post still makes a literal of its value
+		if (fold->const_states[id] == CONST_DONE) return WALK_SKIP;
+		fold->const_states[id] = CONST_IN_PROGRESS;
+	}
+	return WALK_CONTINUE;
+}
+
+static WalkAction fold_post(AST_Node** slot, void* ctx) {
+	ConstFold fold = ctx;
+	AST_Node* node = *slot;
+	if (node->node_type == NODE_QUALNAME) {
+		AST_Qualname* qn = (AST_Qualname*) node;
+		ResolvedName found = resolution_lookup(fold->res, slot);
+		if (!found.symbol || found.n_parts != arrlen(qn->parts)) return WALK_CONTINUE;
+		if (resolution_symbol(fold->res, found.symbol)->kind != DECL_CONST) return WALK_CONTINUE;
+		Constant value = const_value(fold, found.symbol);
+		if (value.type != TYPE_UNKNOWN) hmput(fold->values, slot, value);
+		return WALK_CONTINUE;
+	}
+	if (node->node_type == NODE_CONST) {
+		SymbolId id = const_symbol(fold, (AST_Const*) node);
+		if (id && fold->const_states[id] == CONST_IN_PROGRESS) finish_const(fold, id);
+	}
+	if (is_operator(node) && !arrlen(node->tags)) {
+		Constant value = operator_value(fold, slot);
+		if (value.type != TYPE_UNKNOWN) {
+			// Its parent may be folded too, in which case it is never made a literal
+			value.literal = is_literal_type(value.type);
+			hmput(fold->values, slot, value);
+			return WALK_CONTINUE;
+		}
+	}
+	replace_folded(fold, node);
+	return WALK_CONTINUE;
+}
+
+/// The type a constant is declared with: a builtin number, Bool or String
+static TypeId declared_type(ConstFold fold, AST_Node** slot) {
+	if ((*slot)->node_type != NODE_SIMPLE_TYPE) return TYPE_UNKNOWN;
+	AST_Qualname** base = &((AST_SimpleType*) *slot)->base;
+	if (arrlen((*base)->parts) != 1 || resolution_lookup(fold->res, (AST_Node**) base).symbol) return TYPE_UNKNOWN;
+	TypeId type = type_builtin(fold->table, (*base)->parts[0]);
+	TypeKind kind = type_get(fold->table, type)->kind;
+	bool scalar = kind == TYPE_KIND_SINT || kind == TYPE_KIND_UINT || kind == TYPE_KIND_FLOAT || kind == TYPE_KIND_BOOL || kind == TYPE_KIND_STRING;
+	return scalar? type : TYPE_UNKNOWN;
+}
+
+/// Takes the value of a constant from its folded declaration
+static void finish_const(ConstFold fold, SymbolId id) {
+	AST_Const* constant = (AST_Const*) resolution_symbol(fold->res, id)->decl;
+	Constant value = constant->value? value_of(fold, &constant->value) : UNKNOWN;
+	if (value.type != TYPE_UNKNOWN && constant->type) {
+		TypeId type = declared_type(fold, &constant->type);
+		if (type == TYPE_UNKNOWN) value = UNKNOWN;
+		else if (constant_fits(fold->table, &value, type) || type_coercion(fold->table, value.type, type) == COERCE_NUMERIC) value = constant_convert(fold->table, value, type);
+		else if (value.type != type) value = UNKNOWN;
+	}
+	// A constant's name is not a literal, wherever it is used on its own
+	value.literal = false;
+	fold->constants[id] = value;
+	fold->const_states[id] = CONST_DONE;
+}
+
+/// The value of a constant, folding its declaration first if the walk hasn't reached it
+static Constant const_value(ConstFold fold, SymbolId id) {
+	switch (fold->const_states[id]) {
+		case CONST_IN_PROGRESS: return UNKNOWN;  // depends on itself, which the type check reports
+		case CONST_DONE: return fold->constants[id];
+		default: break;
+	}
+	fold->const_states[id] = CONST_IN_PROGRESS;
+	AST_Const* constant = (AST_Const*) resolution_symbol(fold->res, id)->decl;
+	if (constant->value) ast_walk_iterative(&constant->value, &(AST_Visitor) { fold_pre, fold_post, fold });
+	finish_const(fold, id);
+	return fold->constants[id];
+}
+
+ConstFold fold_constants(AST_Module* module, Resolution res, TypeTable table) {
+	ConstFold fold = calloc(1, sizeof(struct _const_fold));
+	fold->res = res;
+	fold->table = table;
+	int n_symbols = resolution_symbol_count(res) + 1;
+	arrsetlen(fold->constants, n_symbols);
+	arrsetlen(fold->const_states, n_symbols);
+	memset(fold->const_states, CONST_PENDING, n_symbols);
+	AST_Node* root = (AST_Node*) module;
+	ast_walk_iterative(&root, &(AST_Visitor) { fold_pre, fold_post, fold });
+	hmfree(fold->values);
+	arrfree(fold->constants);
+	arrfree(fold->const_states);
+	arrfree(fold->pending);
+	return fold;
+}
+
+void const_fold_destroy(ConstFold fold) {
+	if (!fold) return;
+	for (int i = 0; i < arrlen(fold->blocks); i++) free(fold->blocks[i]);
+	arrfree(fold->blocks);
+	free(fold);
+}
+
+int const_fold_count(ConstFold fold) {
+	return fold->n_folded;
+}
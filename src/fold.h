@@ -0,0 +1,24 @@
+#pragma once
+// Constant folding: operators whose operands are all literals or references to constants
+// are worked out at compile time and replaced by the literal of their value
+#include "ast.h"
+#include "resolve.h"
+#include "types.h"
+
+typedef struct _const_fold* ConstFold;
+
+/// Folds the module's arithmetic (+ - * / % ^), unary minus, comparison chains, 'and', 'or',
+/// 'not' and conditionals, with the semantics of their operand types: integers wrap at their
+/// width, Bool * x is x or its zero, and String * Int repeats the string. A folded
+/// expression of type Int, Float, Bool or String becomes a literal, and so adapts to the
+/// type it is used as, as a literal does; ones of other types (of constants declared U8,
+/// say) are left as they are. Division by zero, negative exponents and results that aren't
+/// finite are left for run time.
+/// `res` is the module's name resolution, and the types of the operands are interned in
+/// `table`. The handle owns the literals put in the tree, so it must outlive
+/// the module.
+ConstFold fold_constants(AST_Module* module, Resolution res, TypeTable table);
+void const_fold_destroy(ConstFold fold);
+
+/// Expressions replaced by literals
+int const_fold_count(ConstFold fold);
@@ -0,0 +1,668 @@
+#define _DEFAULT_SOURCE
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "jit.h"
+#include "stb_ds.h"
+
+#if defined(__x86_64__) && defined(__linux__)
+#define JIT_X86_64 1
+#include <sys/mman.h>
+#include <unistd.h>
+#else
+#define JIT_X86_64 0
+#endif
+
+struct _native {
+	uint8_t* code;
+	const uint8_t* entry;  // instruction 0's machine code, where calls go in
+	size_t size;
+	size_t mapped;
+	uint32_t* offsets;  // of each instruction's machine code, and then of the end
+};
+
+bool jit_supported(void) {
+	return JIT_X86_64;
+}
+
+size_t jit_code_size(Native native) {
+	return native->size;
+}
+
+void jit_destroy(Native native) {
+#if JIT_X86_64
+	munmap(native->code, native->mapped);
+#endif
+	free(native->offsets);
+	free(native);
+}
+
+/// What the machine code returns, in rax and rdx
+typedef struct {
+	int64_t at;
+	Slot result;
+} Exit;
+
+int jit_enter(Native native, Slot* r, int at, Slot* result) {
+	Exit (*code)(Slot*, const uint8_t*) = (Exit (*)(Slot*, const uint8_t*)) (void*) native->code;
+	Exit exit = code(r, native->code + native->offsets[at]);
+	*result = exit.result;
+	return (int) exit.at;
+}
+
+#if JIT_X86_64
+
+// === Assembler ===
+
+// The frame's registers are at [rbx], its memory at [r12]. Templates work in rax, rcx, rdx
+// and xmm0-1, which calls to C are free to change. The code returns the instruction to exit
+// to the VM at in rax, or JIT_RETURNED with the result in rdx.
+enum { RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI };
+enum { XMM0, XMM1 };
+// The low 4 bits of jcc, setcc and cmovcc
+enum { CC_B = 0x2, CC_AE, CC_E, CC_NE, CC_BE, CC_A, CC_S, CC_NS, CC_P, CC_NP, CC_L, CC_GE, CC_LE, CC_G };
+
+typedef struct {
+	int at;      // of the rel32
+	int target;  // instruction
+} Fixup;
+
+typedef struct {
+	uint8_t ARRAY code;
+	Fixup ARRAY fixups;
+	int epilogue;
+} Assembler;
+
+#define EMIT(as, ...) bytes(as, (const uint8_t[]) { __VA_ARGS__ }, sizeof((const uint8_t[]) { __VA_ARGS__ }))
+
+static void bytes(Assembler* as, const uint8_t* b, int n) {
+	for (int i = 0; i < n; i++) arrput(as->code, b[i]);
+}
+
+static void imm32(Assembler* as, int64_t x) {
+	uint32_t u = (uint32_t) x;
+	EMIT(as, u & 0xFF, u >> 8 & 0xFF, u >> 16 & 0xFF, u >> 24);
+}
+
+static void imm64(Assembler* as, uint64_t x) {
+	imm32(as, (int64_t) (x & 0xFFFFFFFF));
+	imm32(as, (int64_t) (x >> 32));
+}
+
+/// The ModRM of [rbx + 8 * slot], with `reg` in its reg field
+static void frame_slot(Assembler* as, int reg, int slot) {
+	EMIT(as, 0x80 | (reg & 7) << 3 | RBX);
+	imm32(as, (int64_t) slot * 8);
+}
+
+/// mov reg, [rbx + 8 * slot]
+static void load(Assembler* as, int reg, int slot) {
+	EMIT(as, 0x48, 0x8B);
+	frame_slot(as, reg, slot);
+}
+
+/// mov [rbx + 8 * slot], reg
+static void store(Assembler* as, int slot, int reg) {
+	EMIT(as, 0x48, 0x89);
+	frame_slot(as, reg, slot);
+}
+
+/// An ALU opcode (add 03, sub 2B, and 23, or 0B, xor 33, cmp 3B) of rax and a slot
+static void alu(Assembler* as, uint8_t op, int slot) {
+	EMIT(as, 0x48, op);
+	frame_slot(as, RAX, slot);
+}
+
+/// An SSE opcode of an xmm register and a slot, after its prefix (F2 for sd, 66 for ucomisd)
+static void sse(Assembler* as, uint8_t prefix, uint8_t op, int xmm, int slot) {
+	EMIT(as, prefix, 0x0F, op);
+	frame_slot(as, xmm, slot);
+}
+
+static inline void movsd_load(Assembler* as, int xmm, int slot) {
+	sse(as, 0xF2, 0x10, xmm, slot);
+}
+
+static inline void movsd_store(Assembler* as, int slot, int xmm) {
+	sse(as, 0xF2, 0x11, xmm, slot);
+}
+
+/// movzx eax, setcc al; then the result to a slot
+static void set_flag(Assembler* as, int cc, int slot) {
+	EMIT(as, 0x0F, 0x90 | cc, 0xC0, 0x0F, 0xB6, 0xC0);
+	store(as, slot, RAX);
+}
+
+static void call(Assembler* as, const void* function) {
+	EMIT(as, 0x48, 0xB8);
+	imm64(as, (uint64_t) (uintptr_t) function);
+	EMIT(as, 0xFF, 0xD0);
+}
+
+/// The rel32 of a jump to the epilogue, which returns from the machine code
+static void jump_epilogue(Assembler* as) {
+	imm32(as, as->epilogue - ((int) arrlen(as->code) + 4));
+}
+
+/// Back to the VM, at instruction `i`: 10 bytes
+static void exit_at(Assembler* as, int i) {
+	EMIT(as, 0xB8);
+	imm32(as, i);
+	EMIT(as, 0xE9);
+	jump_epilogue(as);
+}
+
+/// Back to the VM at instruction `i` if the condition holds, as when a check fails
+static void exit_if(Assembler* as, int cc, int i) {
+	EMIT(as, 0x70 | (cc ^ 1), 10);
+	exit_at(as, i);
+}
+
+static void jump_if(Assembler* as, int cc, int target) {
+	EMIT(as, 0x0F, 0x80 | cc);
+	Fixup fixup = { (int) arrlen(as->code), target };
+	arrput(as->fixups, fixup);
+	imm32(as, 0);
+}
+
+static void jump(Assembler* as, int target) {
+	EMIT(as, 0xE9);
+	Fixup fixup = { (int) arrlen(as->code), target };
+	arrput(as->fixups, fixup);
+	imm32(as, 0);
+}
+
+// === Helpers ===
+
+// What the templates call, for what x86-64 has no one instruction for
+
+static uint64_t upow(uint64_t base, uint64_t e) {
+	uint64_t result = 1;
+	for (; e; e >>= 1, base *= base) {
+		if (e & 1) result *= base;
+	}
+	return result;
+}
+
+static double utof(uint64_t x) {
+	return (double) x;
+}
+
+static uint64_t ftou(double x) {
+	return (uint64_t) x;
+}
+
+static const void* math_function(MathFunc func) {
+	switch (func) {
+		case MATH_SQRT: return (const void*) &sqrt;
+		case MATH_SIN: return (const void*) &sin;
+		case MATH_COS: return (const void*) &cos;
+		case MATH_TAN: return (const void*) &tan;
+		case MATH_EXP: return (const void*) &exp;
+		case MATH_LOG: return (const void*) &log;
+		case MATH_FLOOR: return (const void*) &floor;
+		case MATH_CEIL: return (const void*) &ceil;
+	}
+	return NULL;
+}
+
+// === Templates ===
+
+static void compile_instruction(Assembler* as, const Function* f, int i, Slot* globals, const JitHooks* hooks) {
+	Instr in = f->code[i];
+	int a = in.a, b = in.b, c = in.c;
+	switch ((Opcode) in.op) {
+		case OP_MOVE:
+			load(as, RAX, b);
+			store(as, a, RAX);
+			break;
+		case OP_LOADK:
+			EMIT(as, 0x48, 0xB8);
+			imm64(as, f->constants[in.ux].u);
+			store(as, a, RAX);
+			break;
+		case OP_LOADI:
+			EMIT(as, 0x48, 0xC7);
+			frame_slot(as, 0, a);
+			imm32(as, in.sx);
+			break;
+		case OP_LOCAL:
+			// lea rax, [r12 + disp32]
+			EMIT(as, 0x49, 0x8D, 0x84, 0x24);
+			imm32(as, (int64_t) in.ux * 8);
+			store(as, a, RAX);
+			break;
+		case OP_GLOBAL:
+			EMIT(as, 0x48, 0xB8);
+			imm64(as, (uint64_t) (uintptr_t) (globals + in.ux));
+			store(as, a, RAX);
+			break;
+		case OP_LOAD:
+			load(as, RAX, b);
+			EMIT(as, 0x48, 0x8B, 0x80);  // mov rax, [rax + disp32]
+			imm32(as, c * 8);
+			store(as, a, RAX);
+			break;
+		case OP_STORE:
+			load(as, RAX, a);
+			load(as, RCX, b);
+			EMIT(as, 0x48, 0x89, 0x88);  // mov [rax + disp32], rcx
+			imm32(as, c * 8);
+			break;
+		case OP_LOADX:
+			load(as, RAX, b);
+			load(as, RCX, c);
+			EMIT(as, 0x48, 0x8B, 0x04, 0xC8);  // mov rax, [rax + rcx * 8]
+			store(as, a, RAX);
+			break;
+		case OP_STOREX:
+			load(as, RAX, a);
+			load(as, RCX, b);
+			load(as, RDX, c);
+			EMIT(as, 0x48, 0x89, 0x14, 0xC8);  // mov [rax + rcx * 8], rdx
+			break;
+		case OP_LEA:
+			load(as, RAX, b);
+			EMIT(as, 0x48, 0x05);  // add rax, imm32
+			imm32(as, c * 8);
+			store(as, a, RAX);
+			break;
+		case OP_ADDR:
+			load(as, RAX, b);
+			load(as, RCX, c);
+			EMIT(as, 0x48, 0x8D, 0x04, 0xC8);  // lea rax, [rax + rcx * 8]
+			store(as, a, RAX);
+			break;
+		case OP_COPY:
+		case OP_COPYN:
+			load(as, RDI, a);
+			load(as, RSI, b);
+			if (in.op == OP_COPY) {
+				EMIT(as, 0xBA);  // mov edx, imm32
+				imm32(as, c * 8);
+			}
+			else {
+				load(as, RDX, c);
+				EMIT(as, 0x48, 0xC1, 0xE2, 0x03);  // shl rdx, 3
+			}
+			call(as, (const void*) &memmove);
+			break;
+		case OP_ZERO:
+		case OP_ZERON:
+			load(as, RDI, a);
+			EMIT(as, 0x31, 0xF6);  // xor esi, esi
+			if (in.op == OP_ZERO) {
+				EMIT(as, 0xBA);
+				imm32(as, b * 8);
+			}
+			else {
+				load(as, RDX, b);
+				EMIT(as, 0x48, 0xC1, 0xE2, 0x03);
+			}
+			call(as, (const void*) &memset);
+			break;
+
+		case OP_ADD:
+		case OP_SUB:
+		case OP_BAND:
+		case OP_BOR:
+		case OP_BXOR: {
+			static const uint8_t ops[] = { [OP_ADD] = 0x03, [OP_SUB] = 0x2B, [OP_BAND] = 0x23, [OP_BOR] = 0x0B, [OP_BXOR] = 0x33 };
+			load(as, RAX, b);
+			alu(as, ops[in.op], c);
+			store(as, a, RAX);
+		} break;
+		case OP_MUL:
+			load(as, RAX, b);
+			EMIT(as, 0x48, 0x0F, 0xAF);  // imul rax, [slot]
+			frame_slot(as, RAX, c);
+			store(as, a, RAX);
+			break;
+		case OP_DIV:
+		case OP_MOD: {
+			// Division by zero is reported by the VM; by -1 wraps, where idiv would trap
+			bool div = in.op == OP_DIV;
+			load(as, RAX, b);
+			load(as, RCX, c);
+			EMIT(as, 0x48, 0x85, 0xC9);  // test rcx, rcx
+			exit_if(as, CC_E, i);
+			EMIT(as, 0x48, 0x83, 0xF9, 0xFF);  // cmp rcx, -1
+			if (div) EMIT(as, 0x75, 5, 0x48, 0xF7, 0xD8, 0xEB, 5);  // jne; neg rax; jmp
+			else EMIT(as, 0x75, 4, 0x31, 0xC0, 0xEB, 8);           // jne; xor eax, eax; jmp
+			EMIT(as, 0x48, 0x99, 0x48, 0xF7, 0xF9);  // cqo; idiv rcx
+			if (!div) EMIT(as, 0x48, 0x89, 0xD0);     // mov rax, rdx
+			store(as, a, RAX);
+		} break;
+		case OP_UDIV:
+		case OP_UMOD:
+			load(as, RAX, b);
+			load(as, RCX, c);
+			EMIT(as, 0x48, 0x85, 0xC9);
+			exit_if(as, CC_E, i);
+			EMIT(as, 0x31, 0xD2, 0x48, 0xF7, 0xF1);  // xor edx, edx; div rcx
+			if (in.op == OP_UMOD) EMIT(as, 0x48, 0x89, 0xD0);
+			store(as, a, RAX);
+			break;
+		case OP_POW:
+		case OP_UPOW:
+			load(as, RDI, b);
+			load(as, RSI, c);
+			call(as, (const void*) &upow);
+			store(as, a, RAX);
+			break;
+		case OP_NEG:
+		case OP_BNOT:
+			load(as, RAX, b);
+			EMIT(as, 0x48, 0xF7, in.op == OP_NEG? 0xD8 : 0xD0);  // neg rax, or not rax
+			store(as, a, RAX);
+			break;
+		case OP_ADDK:
+			load(as, RAX, b);
+			EMIT(as, 0x48, 0x05);
+			imm32(as, (int16_t) c);
+			store(as, a, RAX);
+			break;
+		case OP_MULK:
+			load(as, RAX, b);
+			EMIT(as, 0x48, 0x69, 0xC0);  // imul rax, rax, imm32
+			imm32(as, c);
+			store(as, a, RAX);
+			break;
+
+		case OP_FADD:
+		case OP_FSUB:
+		case OP_FMUL:
+		case OP_FDIV: {
+			static const uint8_t ops[] = { [OP_FADD] = 0x58, [OP_FSUB] = 0x5C, [OP_FMUL] = 0x59, [OP_FDIV] = 0x5E };
+			movsd_load(as, XMM0, b);
+			sse(as, 0xF2, ops[in.op], XMM0, c);
+			movsd_store(as, a, XMM0);
+		} break;
+		case OP_FMOD:
+		case OP_FPOW:
+		case OP_FMIN:
+		case OP_FMAX: {
+			const void* function = in.op == OP_FMOD? (const void*) &fmod : in.op == OP_FPOW? (const void*) &pow
+				: in.op == OP_FMIN? (const void*) &fmin : (const void*) &fmax;
+			movsd_load(as, XMM0, b);
+			movsd_load(as, XMM1, c);
+			call(as, function);
+			movsd_store(as, a, XMM0);
+		} break;
+		case OP_FNEG:
+		case OP_FABS:
+			load(as, RAX, b);
+			EMIT(as, 0x48, 0x0F, 0xBA, in.op == OP_FNEG? 0xF8 : 0xF0, 63);  // btc or btr rax, 63
+			store(as, a, RAX);
+			break;
+		case OP_F32:
+			sse(as, 0xF2, 0x5A, XMM0, b);        // cvtsd2ss xmm0, [slot]
+			EMIT(as, 0xF3, 0x0F, 0x5A, 0xC0);   // cvtss2sd xmm0, xmm0
+			movsd_store(as, a, XMM0);
+			break;
+
+		case OP_SEXT:
+		case OP_ZEXT:
+			load(as, RAX, b);
+			EMIT(as, 0x48, 0xC1, 0xE0, 64 - c);  // shl rax, 64 - c
+			EMIT(as, 0x48, 0xC1, in.op == OP_SEXT? 0xF8 : 0xE8, 64 - c);  // sar or shr
+			store(as, a, RAX);
+			break;
+		case OP_ITOF:
+			EMIT(as, 0xF2, 0x48, 0x0F, 0x2A);  // cvtsi2sd xmm0, qword [slot]
+			frame_slot(as, XMM0, b);
+			movsd_store(as, a, XMM0);
+			break;
+		case OP_UTOF:
+			load(as, RDI, b);
+			call(as, (const void*) &utof);
+			movsd_store(as, a, XMM0);
+			break;
+		case OP_FTOI:
+			EMIT(as, 0xF2, 0x48, 0x0F, 0x2C);  // cvttsd2si rax, [slot]
+			frame_slot(as, RAX, b);
+			store(as, a, RAX);
+			break;
+		case OP_FTOU:
+			movsd_load(as, XMM0, b);
+			call(as, (const void*) &ftou);
+			store(as, a, RAX);
+			break;
+		case OP_BOOL:
+		case OP_NOT:
+			EMIT(as, 0x48, 0x83);  // cmp qword [slot], 0
+			frame_slot(as, 7, b);
+			EMIT(as, 0);
+			set_flag(as, in.op == OP_BOOL? CC_NE : CC_E, a);
+			break;
+		case OP_FBOOL:
+			// NaN is true, as it isn't 0
+			movsd_load(as, XMM0, b);
+			EMIT(as, 0x66, 0x0F, 0x57, 0xC9, 0x66, 0x0F, 0x2E, 0xC1);  // xorpd xmm1, xmm1; ucomisd xmm0, xmm1
+			EMIT(as, 0x0F, 0x95, 0xC0, 0x0F, 0x9A, 0xC1, 0x08, 0xC8);  // setne al; setp cl; or al, cl
+			EMIT(as, 0x0F, 0xB6, 0xC0);
+			store(as, a, RAX);
+			break;
+
+		case OP_SHL:
+		case OP_SHR:
+		case OP_USHR: {
+			// Shifts by 64 or more leave nothing, or the sign
+			static const uint8_t shifts[] = { [OP_SHL] = 0xE0, [OP_SHR] = 0xF8, [OP_USHR] = 0xE8 };
+			load(as, RAX, b);
+			load(as, RCX, c);
+			EMIT(as, 0x48, 0x83, 0xF9, 63, 0x77, 5);  // cmp rcx, 63; ja
+			EMIT(as, 0x48, 0xD3, shifts[in.op]);      // shift rax, cl
+			if (in.op == OP_SHR) EMIT(as, 0xEB, 4, 0x48, 0xC1, 0xF8, 63);  // jmp; sar rax, 63
+			else EMIT(as, 0xEB, 2, 0x31, 0xC0);                             // jmp; xor eax, eax
+			store(as, a, RAX);
+		} break;
+
+		case OP_EQ:
+		case OP_NE:
+		case OP_LT:
+		case OP_LE:
+		case OP_ULT:
+		case OP_ULE: {
+			static const uint8_t cc[] = { [OP_EQ] = CC_E, [OP_NE] = CC_NE, [OP_LT] = CC_L, [OP_LE] = CC_LE, [OP_ULT] = CC_B, [OP_ULE] = CC_BE };
+			load(as, RAX, b);
+			alu(as, 0x3B, c);
+			set_flag(as, cc[in.op], a);
+		} break;
+		case OP_FEQ:
+		case OP_FNE:
+			movsd_load(as, XMM0, b);
+			sse(as, 0x66, 0x2E, XMM0, c);  // ucomisd xmm0, [slot]
+			// Unordered (NaN) sets the parity flag
+			if (in.op == OP_FEQ) EMIT(as, 0x0F, 0x94, 0xC0, 0x0F, 0x9B, 0xC1, 0x20, 0xC8);  // sete al; setnp cl; and al, cl
+			else EMIT(as, 0x0F, 0x95, 0xC0, 0x0F, 0x9A, 0xC1, 0x08, 0xC8);                  // setne al; setp cl; or al, cl
+			EMIT(as, 0x0F, 0xB6, 0xC0);
+			store(as, a, RAX);
+			break;
+		case OP_FLT:
+		case OP_FLE:
+			// b < c as c > b, which is false when unordered
+			movsd_load(as, XMM0, c);
+			sse(as, 0x66, 0x2E, XMM0, b);
+			set_flag(as, in.op == OP_FLT? CC_A : CC_AE, a);
+			break;
+
+		case OP_MIN:
+		case OP_MAX:
+		case OP_UMIN:
+		case OP_UMAX: {
+			static const uint8_t cc[] = { [OP_MIN] = CC_G, [OP_MAX] = CC_L, [OP_UMIN] = CC_A, [OP_UMAX] = CC_B };
+			load(as, RAX, b);
+			load(as, RCX, c);
+			EMIT(as, 0x48, 0x39, 0xC8);                  // cmp rax, rcx
+			EMIT(as, 0x48, 0x0F, 0x40 | cc[in.op], 0xC1);  // cmovcc rax, rcx
+			store(as, a, RAX);
+		} break;
+		case OP_ABS:
+			load(as, RAX, b);
+			EMIT(as, 0x48, 0x89, 0xC1, 0x48, 0xF7, 0xD9, 0x48, 0x0F, 0x48, 0xC8);  // mov rcx, rax; neg rcx; cmovs rcx, rax
+			store(as, a, RCX);
+			break;
+		case OP_MATH:
+			if (c == MATH_SQRT) sse(as, 0xF2, 0x51, XMM0, b);  // sqrtsd xmm0, [slot]
+			else {
+				movsd_load(as, XMM0, b);
+				call(as, math_function((MathFunc) c));
+			}
+			movsd_store(as, a, XMM0);
+			break;
+		case OP_LEN:
+			// Strings that are zero are empty
+			load(as, RAX, b);
+			EMIT(as, 0x48, 0x85, 0xC0, 0x74, 4, 0x48, 0x8B, 0x40, (uint8_t) offsetof(StringValue, len));  // test; jz; mov rax, [rax + len]
+			store(as, a, RAX);
+			break;
+
+		case OP_JMP:
+			jump(as, i + 1 + in.sx);
+			break;
+		case OP_JT:
+		case OP_JF:
+			EMIT(as, 0x48, 0x83);
+			frame_slot(as, 7, a);
+			EMIT(as, 0);
+			jump_if(as, in.op == OP_JT? CC_NE : CC_E, i + 1 + in.sx);
+			break;
+		case OP_JLT:
+		case OP_JLE:
+		case OP_JGT:
+		case OP_JGE:
+		case OP_JEQ:
+		case OP_JNE: {
+			// Steps over the JMP after it when it doesn't hold, else goes on into it
+			static const uint8_t otherwise[] = { [OP_JLT] = CC_GE, [OP_JLE] = CC_G, [OP_JGT] = CC_LE, [OP_JGE] = CC_L, [OP_JEQ] = CC_NE, [OP_JNE] = CC_E };
+			load(as, RAX, a);
+			alu(as, 0x3B, b);
+			jump_if(as, otherwise[in.op], i + 2);
+		} break;
+		case OP_JFLT:
+		case OP_JFLE:
+		case OP_JFGT:
+		case OP_JFGE: {
+			// a < b as b > a, and unordered steps over the JMP
+			bool less = in.op == OP_JFLT || in.op == OP_JFLE;
+			movsd_load(as, XMM0, less? b : a);
+			sse(as, 0x66, 0x2E, XMM0, less? a : b);
+			jump_if(as, in.op == OP_JFLT || in.op == OP_JFGT? CC_BE : CC_B, i + 2);
+		} break;
+
+		case OP_CHECK:
+			load(as, RAX, a);
+			alu(as, 0x3B, b);
+			exit_if(as, CC_AE, i);
+			break;
+		case OP_CHECKI:
+			load(as, RAX, a);
+			EMIT(as, 0x48, 0x3D);  // cmp rax, imm32
+			imm32(as, in.ux);
+			exit_if(as, CC_AE, i);
+			break;
+		case OP_CHECKSLICE:
+			load(as, RAX, a);
+			load(as, RCX, b);
+			load(as, RDX, c);
+			EMIT(as, 0x48, 0x85, 0xC0);  // test rax, rax
+			exit_if(as, CC_S, i);
+			EMIT(as, 0x48, 0x39, 0xC1);  // cmp rcx, rax
+			exit_if(as, CC_L, i);
+			EMIT(as, 0x48, 0x39, 0xD1);  // cmp rcx, rdx
+			exit_if(as, CC_G, i);
+			break;
+
+		case OP_CALL:
+			// The VM takes the frame, then the callee's machine code is called. Where it exits
+			// to the VM, in a call of its own or not, this exits too, and the VM goes on there.
+			EMIT(as, 0x48, 0xBF);  // mov rdi, imm64
+			imm64(as, (uint64_t) (uintptr_t) hooks->vm);
+			EMIT(as, 0xBE);        // mov esi, imm32
+			imm32(as, i);
+			call(as, (const void*) hooks->call);
+			EMIT(as, 0x48, 0x85, 0xC0);  // test rax, rax
+			exit_if(as, CC_E, i);
+			EMIT(as, 0x48, 0x89, 0xC7);  // mov rdi, rax
+			EMIT(as, 0x48, 0x8B, 0x72, (uint8_t) offsetof(struct _native, entry));  // mov rsi, [rdx + entry]
+			EMIT(as, 0xFF, 0x52, (uint8_t) offsetof(struct _native, code));         // call [rdx + code]
+			EMIT(as, 0x48, 0x85, 0xC0, 0x0F, 0x89);  // test rax, rax; jns epilogue
+			jump_epilogue(as);
+			store(as, a, RDX);
+			EMIT(as, 0x48, 0xBF);
+			imm64(as, (uint64_t) (uintptr_t) hooks->vm);
+			call(as, (const void*) hooks->ret);
+			break;
+		case OP_RET:
+		case OP_RETV:
+			if (in.op == OP_RET) load(as, RDX, a);
+			else EMIT(as, 0x31, 0xD2);  // xor edx, edx
+			EMIT(as, 0x48, 0xC7, 0xC0);  // mov rax, imm32
+			imm32(as, JIT_RETURNED);
+			EMIT(as, 0xE9);
+			jump_epilogue(as);
+			break;
+
+		// What the VM does: allocation (from its arena), output and failures, and strings'
+		// comparisons
+		default:
+			exit_at(as, i);
+	}
+}
+
+Native jit_compile(const Function* f, Slot* globals, const JitHooks* hooks) {
+	int n = (int) arrlen(f->code);
+	Assembler as = { 0 };
+	uint32_t* offsets = malloc((n + 1) * sizeof(uint32_t));
+	// int (Slot* r, const uint8_t* at): registers in rbx, memory in r12, then to the instruction
+	EMIT(&as, 0x53, 0x41, 0x54, 0x48, 0x83, 0xEC, 0x08);  // push rbx; push r12; sub rsp, 8
+	EMIT(&as, 0x48, 0x89, 0xFB, 0x4C, 0x8D, 0xA3);         // mov rbx, rdi; lea r12, [rbx + disp32]
+	imm32(&as, (int64_t) f->n_registers * 8);
+	EMIT(&as, 0xFF, 0xE6);                                 // jmp rsi
+	as.epilogue = (int) arrlen(as.code);
+	EMIT(&as, 0x48, 0x83, 0xC4, 0x08, 0x41, 0x5C, 0x5B, 0xC3);  // add rsp, 8; pop r12; pop rbx; ret
+	for (int i = 0; i < n; i++) {
+		offsets[i] = (uint32_t) arrlen(as.code);
+		compile_instruction(&as, f, i, globals, hooks);
+	}
+	offsets[n] = (uint32_t) arrlen(as.code);
+	exit_at(&as, n);
+	for (int i = 0; i < arrlen(as.fixups); i++) {
+		Fixup fixup = as.fixups[i];
+		int32_t rel = (int32_t) offsets[fixup.target] - (fixup.at + 4);
+		memcpy(&as.code[fixup.at], &rel, 4);
+	}
+
+	// Written, then made executable
+	size_t size = arrlen(as.code), page = (size_t) sysconf(_SC_PAGESIZE);
+	size_t mapped = (size + page - 1) / page * page;
+	void* code = mmap(NULL, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	Native native = NULL;
+	if (code != MAP_FAILED) {
+		memcpy(code, as.code, size);
+		if (mprotect(code, mapped, PROT_READ | PROT_EXEC) == 0) {
+			native = malloc(sizeof(struct _native));
+			*native = (struct _native) { code, (uint8_t*) code + offsets[0], size, mapped, offsets };
+		}
+		else munmap(code, mapped);
+	}
+	if (!native) free(offsets);
+	arrfree(as.code);
+	arrfree(as.fixups);
+	return native;
+}
+
+#else
+
+Native jit_compile(const Function* f, Slot* globals, const JitHooks* hooks) {
+	(void) f;
+	(void) globals;
+	(void) hooks;
+	return NULL;
+}
+
+#endif
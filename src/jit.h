@@ -0,0 +1,47 @@
+#pragma once
+// The baseline JIT: bytecode functions (bytecode.h) the VM finds hot are compiled to x86-64 by
+// stitching together a template of machine code for each instruction. The registers stay in
+// the frame, so the VM can go in and out of the machine code at any instruction. Compiled
+// functions call and return to each other directly, in frames the VM takes for them.
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "bytecode.h"
+
+typedef struct _native* Native;
+
+typedef struct {
+	Slot* r;        // the callee's registers, with its arguments
+	Native native;
+} JitFrame;
+
+/// What the machine code calls the VM back for
+typedef struct {
+	void* vm;
+	/// Takes and pushes the frame for the CALL at instruction `at` of the innermost frame, as
+	/// the VM would, if the callee is compiled. A NULL frame leaves the call to the VM.
+	JitFrame (*call)(void* vm, int at);
+	/// Pops the frame of a compiled function that returned to its compiled caller
+	void (*ret)(void* vm);
+} JitHooks;
+
+/// What jit_enter returns when the function returned, rather than exiting to the VM
+#define JIT_RETURNED (-1)
+
+/// Whether this platform (Linux on x86-64) can run what the JIT compiles
+bool jit_supported(void);
+
+/// Compiles a function of the program, into memory that is mapped writable to be written and
+/// then executable to be run, never both. Instructions without a template (printing,
+/// allocation...), calls of functions that aren't compiled, and checks that fail, exit to the
+/// VM. NULL if the platform isn't supported or the memory can't be mapped.
+Native jit_compile(const Function* f, Slot* globals, const JitHooks* hooks);
+void jit_destroy(Native native);
+
+/// Runs the machine code from instruction `at`, with the frame's registers `r`, until an
+/// instruction that exits to the VM: returns its index, for the VM to run it in the innermost
+/// frame, which may be one a call took. Or JIT_RETURNED, with the function's `result`.
+int jit_enter(Native native, Slot* r, int at, Slot* result);
+
+/// Bytes of machine code
+size_t jit_code_size(Native native);
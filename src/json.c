@@ -0,0 +1,339 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+
+#include "json.h"
+#include "utf8.h"
+#include "stb_ds.h"
+
+#define JSON_MAX_DEPTH 512
+
+// === Reading ===
+
+typedef struct {
+	const char* at;
+	const char* end;
+	int depth;
+} JsonReader;
+
+static bool parse_value(JsonReader* r, JsonValue* out);
+
+static void skip_space(JsonReader* r) {
+	while (r->at < r->end && (*r->at == ' ' || *r->at == '\t' || *r->at == '\n' || *r->at == '\r')) r->at++;
+}
+
+static bool accept(JsonReader* r, char c) {
+	skip_space(r);
+	if (r->at < r->end && *r->at == c) {
+		r->at++;
+		return true;
+	}
+	return false;
+}
+
+static bool accept_word(JsonReader* r, const char* word) {
+	size_t len = strlen(word);
+	if ((size_t) (r->end - r->at) < len || memcmp(r->at, word, len) != 0) return false;
+	r->at += len;
+	return true;
+}
+
+static int hex_digit(char c) {
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	return -1;
+}
+
+static int read_hex4(JsonReader* r) {
+	if (r->end - r->at < 4) return -1;
+	int result = 0;
+	for (int i = 0; i < 4; i++) {
+		int digit = hex_digit(*r->at++);
+		if (digit < 0) return -1;
+		result = result << 4 | digit;
+	}
+	return result;
+}
+
+/// Reads a string whose opening quote is next, decoding escapes to UTF-8
+static bool parse_string(JsonReader* r, char** chars, size_t* length) {
+	if (!accept(r, '"')) return false;
+	char ARRAY buf = NULL;
+	while (r->at < r->end && *r->at != '"') {
+		// Copy runs that need no decoding in one go
+		const char* run = r->at;
+		while (r->at < r->end && *r->at != '"' && *r->at != '\\') r->at++;
+		if (r->at > run) memcpy(json_extend(&buf, r->at - run), run, r->at - run);
+		if (r->at == r->end || *r->at == '"') break;
+
+		r->at++;  // '\\'
+		if (r->at == r->end) break;
+		char c = *r->at++;
+		switch (c) {
+			case '"': case '\\': case '/': arrput(buf, c); break;
+			case 'b': arrput(buf, '\b'); break;
+			case 'f': arrput(buf, '\f'); break;
+			case 'n': arrput(buf, '\n'); break;
+			case 'r': arrput(buf, '\r'); break;
+			case 't': arrput(buf, '\t'); break;
+			case 'u': {
+				int code = read_hex4(r);
+				if (code >= 0xd800 && code < 0xdc00 && r->end - r->at >= 6 && r->at[0] == '\\' && r->at[1] == 'u') {
+					r->at += 2;
+					int low = read_hex4(r);
+					if (low >= 0xdc00 && low < 0xe000) code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+					else code = -1;
+				}
+				if (code < 0) goto fail;
+				char utf8[4];
+				size_t n = utf8_write(utf8, code) - utf8;
+				memcpy(json_extend(&buf, n), utf8, n);
+			} break;
+			default: goto fail;
+		}
+	}
+	if (r->at == r->end) goto fail;
+	r->at++;  // '"'
+	*length = arrlen(buf);
+	*chars = malloc(*length + 1);
+	if (*length) memcpy(*chars, buf, *length);
+	(*chars)[*length] = 0;
+	arrfree(buf);
+	return true;
+
+fail:
+	arrfree(buf);
+	return false;
+}
+
+static bool parse_number(JsonReader* r, double* number) {
+	char buf[64];
+	size_t len = 0;
+	while (r->at + len < r->end && len < sizeof(buf) - 1 && strchr("+-0123456789.eE", r->at[len])) len++;
+	if (!len) return false;
+	memcpy(buf, r->at, len);
+	buf[len] = 0;
+	char* end;
+	*number = strtod(buf, &end);
+	if (end != buf + len) return false;
+	r->at += len;
+	return true;
+}
+
+static bool parse_value(JsonReader* r, JsonValue* out) {
+	*out = (JsonValue) { JSON_NULL };
+	skip_space(r);
+	if (r->at == r->end || ++r->depth > JSON_MAX_DEPTH) return false;
+	bool ok = true;
+	switch (*r->at) {
+		case '{':
+			out->type = JSON_OBJECT;
+			r->at++;
+			if (accept(r, '}')) break;
+			do {
+				JsonMember member = {0};
+				size_t key_length;
+				skip_space(r);
+				if (!parse_string(r, &member.key, &key_length)) {
+					ok = false;
+					break;
+				}
+				ok = accept(r, ':') && parse_value(r, &member.value);
+				arrput(out->members, member);
+			} while (ok && accept(r, ','));
+			ok = ok && accept(r, '}');
+			break;
+		case '[':
+			out->type = JSON_ARRAY;
+			r->at++;
+			if (accept(r, ']')) break;
+			do {
+				size_t at = arraddn(out->items, 1);
+				ok = parse_value(r, &out->items[at]);
+			} while (ok && accept(r, ','));
+			ok = ok && accept(r, ']');
+			break;
+		case '"':
+			out->type = JSON_STRING;
+			ok = parse_string(r, &out->string.chars, &out->string.length);
+			break;
+		case 't':
+			out->type = JSON_BOOL;
+			out->boolean = true;
+			ok = accept_word(r, "true");
+			break;
+		case 'f':
+			out->type = JSON_BOOL;
+			ok = accept_word(r, "false");
+			break;
+		case 'n':
+			ok = accept_word(r, "null");
+			break;
+		default:
+			out->type = JSON_NUMBER;
+			ok = parse_number(r, &out->number);
+	}
+	r->depth--;
+	return ok;
+}
+
+static void free_contents(JsonValue* value) {
+	switch (value->type) {
+		case JSON_STRING:
+			free(value->string.chars);
+			break;
+		case JSON_ARRAY:
+			for (int i = 0; i < arrlen(value->items); i++) free_contents(&value->items[i]);
+			arrfree(value->items);
+			break;
+		case JSON_OBJECT:
+			for (int i = 0; i < arrlen(value->members); i++) {
+				free(value->members[i].key);
+				free_contents(&value->members[i].value);
+			}
+			arrfree(value->members);
+			break;
+		default: break;
+	}
+}
+
+JsonValue* json_parse(const char* text, size_t length) {
+	JsonReader r = { text, text + length, 0 };
+	JsonValue* value = malloc(sizeof(JsonValue));
+	bool ok = parse_value(&r, value);
+	skip_space(&r);
+	if (!ok || r.at != r.end) {
+		free_contents(value);
+		free(value);
+		return NULL;
+	}
+	return value;
+}
+
+void json_free(JsonValue* value) {
+	if (!value) return;
+	free_contents(value);
+	free(value);
+}
+
+const JsonValue* json_get(const JsonValue* object, const char* key) {
+	if (!object || object->type != JSON_OBJECT) return NULL;
+	for (int i = 0; i < arrlen(object->members); i++) {
+		if (strcmp(object->members[i].key, key) == 0) return &object->members[i].value;
+	}
+	return NULL;
+}
+
+const JsonValue* json_get_path(const JsonValue* object, const char* path) {
+	while (object && *path) {
+		const char* dot = strchr(path, '.');
+		size_t len = dot? (size_t) (dot - path) : strlen(path);
+		const JsonValue* found = NULL;
+		for (int i = 0; object->type == JSON_OBJECT && i < arrlen(object->members); i++) {
+			const char* key = object->members[i].key;
+			if (strncmp(key, path, len) == 0 && key[len] == 0) {
+				found = &object->members[i].value;
+				break;
+			}
+		}
+		object = found;
+		path += dot? len + 1 : len;
+	}
+	return object;
+}
+
+const char* json_string(const JsonValue* value) {
+	return value && value->type == JSON_STRING? value->string.chars : NULL;
+}
+
+double json_number(const JsonValue* value, double fallback) {
+	return value && value->type == JSON_NUMBER? value->number : fallback;
+}
+
+bool json_bool(const JsonValue* value, bool fallback) {
+	return value && value->type == JSON_BOOL? value->boolean : fallback;
+}
+
+// === Writing ===
+
+char* json_extend(char ARRAY* out, size_t n) {
+	size_t at = arraddn(*out, n);
+	return *out + at;
+}
+
+void json_printf(char ARRAY* out, const char* fmt, ...) {
+	va_list args;
+	va_start(args, fmt);
+	size_t room = arrcap(*out) - arrlen(*out);
+	int n = vsnprintf(*out? *out + arrlen(*out) : NULL, *out? room : 0, fmt, args);
+	va_end(args);
+	if (n < 0) return;
+	if ((size_t) n >= room) {
+		arrsetcap(*out, arrlen(*out) + n + 1);
+		va_start(args, fmt);
+		vsnprintf(*out + arrlen(*out), n + 1, fmt, args);
+		va_end(args);
+	}
+	arrsetlen(*out, arrlen(*out) + n);
+}
+
+void json_write_string(char ARRAY* out, const char* str, size_t length) {
+	static const char HEX[] = "0123456789abcdef";
+	arrput(*out, '"');
+	const char* run = str;
+	for (const char* p = str; p < str + length; p++) {
+		unsigned char c = *p;
+		if (c >= 0x20 && c != '"' && c != '\\') continue;
+		if (p > run) memcpy(json_extend(out, p - run), run, p - run);
+		run = p + 1;
+		arrput(*out, '\\');
+		switch (c) {
+			case '"': case '\\': arrput(*out, c); break;
+			case '\n': arrput(*out, 'n'); break;
+			case '\r': arrput(*out, 'r'); break;
+			case '\t': arrput(*out, 't'); break;
+			default: {
+				char* hex = json_extend(out, 5);
+				hex[0] = 'u';
+				hex[1] = hex[2] = '0';
+				hex[3] = HEX[c >> 4];
+				hex[4] = HEX[c & 15];
+			}
+		}
+	}
+	if (str + length > run) memcpy(json_extend(out, str + length - run), run, str + length - run);
+	arrput(*out, '"');
+}
+
+void json_write(char ARRAY* out, const JsonValue* value) {
+	switch (value->type) {
+		case JSON_NULL: json_printf(out, "null"); break;
+		case JSON_BOOL: json_printf(out, value->boolean? "true" : "false"); break;
+		case JSON_NUMBER:
+			if (!isfinite(value->number)) json_printf(out, "null");
+			else json_printf(out, "%.17g", value->number);
+			break;
+		case JSON_STRING: json_write_string(out, value->string.chars, value->string.length); break;
+		case JSON_ARRAY:
+			arrput(*out, '[');
+			for (int i = 0; i < arrlen(value->items); i++) {
+				if (i) arrput(*out, ',');
+				json_write(out, &value->items[i]);
+			}
+			arrput(*out, ']');
+			break;
+		case JSON_OBJECT:
+			arrput(*out, '{');
+			for (int i = 0; i < arrlen(value->members); i++) {
+				if (i) arrput(*out, ',');
+				json_write_string(out, value->members[i].key, strlen(value->members[i].key));
+				arrput(*out, ':');
+				json_write(out, &value->members[i].value);
+			}
+			arrput(*out, '}');
+			break;
+	}
+}
@@ -0,0 +1,63 @@
+#pragma once
+// A small JSON reader and writer, for protocols that speak JSON (see lsp.h)
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "ast.h"
+
+typedef enum {
+	JSON_NULL,
+	JSON_BOOL,
+	JSON_NUMBER,
+	JSON_STRING,
+	JSON_ARRAY,
+	JSON_OBJECT,
+} JsonType;
+
+typedef struct _json_member JsonMember;
+
+typedef struct _json_value {
+	JsonType type;
+	union {
+		bool boolean;
+		double number;
+		struct {
+			char* chars;  // NUL-terminated; may also hold NULs of its own
+			size_t length;
+		} string;
+		struct _json_value ARRAY items;
+		JsonMember ARRAY members;  // in document order
+	};
+} JsonValue;
+
+struct _json_member {
+	char* key;
+	JsonValue value;
+};
+
+/// Parses a whole JSON document. Returns NULL if it isn't one.
+JsonValue* json_parse(const char* text, size_t length);
+void json_free(JsonValue* value);
+
+/// The member of an object with the given key; NULL if the value isn't an object or has no such member
+const JsonValue* json_get(const JsonValue* object, const char* key);
+
+/// Follows a path of keys separated by dots, as in "params.textDocument.uri"
+const JsonValue* json_get_path(const JsonValue* object, const char* path);
+
+/// The string held by the value, or NULL if it holds something else
+const char* json_string(const JsonValue* value);
+/// The number held by the value, or the fallback if it holds something else
+double json_number(const JsonValue* value, double fallback);
+bool json_bool(const JsonValue* value, bool fallback);
+
+/// Makes room for n more bytes at the end of out, and returns where they start
+char* json_extend(char ARRAY* out, size_t n);
+
+/// Appends the value as JSON text to out
+void json_write(char ARRAY* out, const JsonValue* value);
+/// Appends a string in quotes, escaped as JSON needs
+void json_write_string(char ARRAY* out, const char* str, size_t length);
+/// Appends printf-style text to out
+__attribute__((format(printf, 2, 3)))
+void json_printf(char ARRAY* out, const char* fmt, ...);
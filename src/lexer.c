@@ -1,6 +1,9 @@
 
+#define _XOPEN_SOURCE 700
+
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <stdint.h>
 #include <ctype.h>
 #include <wctype.h>
@@ -33,6 +36,7 @@ struct _lex_state {
 	int next_tok, tokens_buffered, total_tokens_emitted;
 	unsigned int line_no, column;
 	void* arena_block; // The arena used for literal text for tokens, raw lines, and strings
+	size_t arena_size;
 	// NOTE: these must be unsigned to make UTF-8 work correctly
 	unsigned char* next_literal;  // Rolling pointer used for storing literal tokens as strings
 	unsigned char* string_buffer; // The rolling pointer where strings and identifiers get allocated
@@ -42,8 +46,42 @@ struct _lex_state {
 	int line_offset;
 	int line_length;
 	bool is_last_line;
+	// Sources given to lexer_create_from_memory are read from a copy instead of src
+	char* text;
+	size_t text_length, text_offset;
+	// See lexer_fingerprint_reset
+	bool fingerprinting;
+	unsigned int fingerprint_base_line;
+	uint64_t fingerprint;
 };
 
+static Lexer lexer_init(Lexer self, size_t src_size) {
+	(void) arraddn(self->token_buf, BASE_LOOKAHEAD_MAX);
+	self->arena_size = src_size * 5 + 1;
+	self->next_literal = self->arena_block = malloc(self->arena_size);
+	self->string_buffer = ((unsigned char*) self->arena_block) + src_size * 2;
+	self->line_buffer = ((unsigned char*) self->arena_block) + src_size * 4; // size = src_size + 1 byte (for the null at the end)
+	self->line_length = -1;
+	self->line_no = 1;
+	self->column = 1;
+	// All other fields are zero, and that is fine.
+	return self;
+}
+
+Lexer lexer_create_from_memory(const char* text, size_t length) {
+	char* copy = malloc(length + 1);
+	if (!copy) return NULL;
+	memcpy(copy, text, length);
+	Lexer self = calloc(1, sizeof(struct _lex_state));
+	if (!self) {
+		free(copy);
+		return NULL;
+	}
+	self->text = copy;
+	self->text_length = length;
+	return lexer_init(self, length);
+}
+
 Lexer lexer_create(const char* filename) {
 	FILE* src;
 	size_t src_size;
@@ -53,65 +91,93 @@ Lexer lexer_create(const char* filename) {
 	}
 	else {
 		src = fopen(filename, "r");
+		if (!src) {
+			return NULL;
+		}
 		fseek(src, 0, SEEK_END);
 		src_size = ftell(src);
 		rewind(src);
 	}
-	if (!src) {
-		return NULL;
-	}
 	Lexer self = calloc(1, sizeof(struct _lex_state));
 	if (!self) {
 		fclose(src);
 		return NULL;
 	}
-	arraddn(self->token_buf, BASE_LOOKAHEAD_MAX);
 	self->src = src;
-	self->next_literal = self->arena_block = malloc(src_size * 5 + 1);
-	self->string_buffer = ((unsigned char*) self->arena_block) + src_size * 2;
-	self->line_buffer = ((unsigned char*) self->arena_block) + src_size * 4; // size = src_size + 1 byte (for the null at the end)
-	self->line_length = -1;
-	self->line_no = 1;
-	self->column = 1;
-	// All other fields are zero, and that is fine.
-	return self;
+	return lexer_init(self, src_size);
 }
 
 void lexer_destroy(Lexer self) {
-	if (self->src != stdin)	fclose(self->src);
+	if (self->src && self->src != stdin) fclose(self->src);
+	arrfree(self->token_buf);
+	arrfree(self->paren_stack);
+	arrfree(self->lines);
+	free(self->arena_block);
+	free(self->text);
 	free(self);
 }
 
+size_t lexer_memory_usage(Lexer self) {
+	return sizeof(struct _lex_state) + self->arena_size + self->text_length
+		+ arrcap(self->token_buf) * sizeof(Token) + arrcap(self->lines) * sizeof(char*);
+}
+
 const unsigned char** lexer_get_lines(Lexer self, int* len) {
 	if (len) *len = arrlen(self->lines);
 	return self->lines;
 }
 
-static int lexer_fwdc(Lexer self) {
-	if (self->line_offset > self->line_length) {
-		// Completely read the next line, storing it in the line buffer
-		self->line_offset = 0;
-		self->line_length = 0;
-		arrpush(self->lines, self->line_buffer);
-		self->current_line = self->line_buffer;
-
-		while (1) {
-			int c;
-			switch (c = fgetc(self->src)) {
-				case 0: break;  // ignore null bytes
-				case EOF:
-					self->is_last_line = true; // NOTE: possibly fragile implementation here
-					// drop through is intentional
-				case '\n':
-					*self->line_buffer++ = 0;
-					goto emit_char;
-				default:
-					*self->line_buffer++ = c;
-					self->line_length++;
-			}
+const char* lexer_get_text(Lexer self, size_t* length) {
+	if (length) *length = self->text_length;
+	return self->text;
+}
+
+// Completely reads the next line, storing it in the line buffer
+static void lexer_read_line(Lexer self) {
+	self->line_offset = 0;
+	self->line_length = 0;
+	arrpush(self->lines, self->line_buffer);
+	self->current_line = self->line_buffer;
+
+	if (self->text) {
+		const char* next = self->text + self->text_offset;
+		const char* end = self->text + self->text_length;
+		const char* eol = memchr(next, '\n', end - next);
+		if (!eol) {
+			eol = end;
+			self->is_last_line = true;
+		}
+		if (!memchr(next, 0, eol - next)) {
+			memcpy(self->line_buffer, next, eol - next);
+			self->line_buffer += eol - next;
+		}
+		else for (; next < eol; next++) {
+			if (*next) *self->line_buffer++ = *next;  // ignore null bytes
+		}
+		self->line_length = self->line_buffer - self->current_line;
+		*self->line_buffer++ = 0;
+		self->text_offset = eol - self->text + 1;
+		return;
+	}
+	while (1) {
+		int c;
+		switch (c = getc_unlocked(self->src)) {
+			case 0: break;  // ignore null bytes
+			case EOF:
+				self->is_last_line = true; // NOTE: possibly fragile implementation here
+				// drop through is intentional
+			case '\n':
+				*self->line_buffer++ = 0;
+				return;
+			default:
+				*self->line_buffer++ = c;
+				self->line_length++;
 		}
 	}
-	emit_char:
+}
+
+static int lexer_fwdc(Lexer self) {
+	if (self->line_offset > self->line_length) lexer_read_line(self);
 	if (self->line_offset < 0) {
 		self->line_offset = 0;
 		return '\n';
@@ -221,7 +287,7 @@ static Token* lexer_emit_token(Lexer self) {
 		case ')':
 		case ']':
 		case '}':
-			arrpop(self->paren_stack);
+			(void) arrpop(self->paren_stack);
 			EMIT(cur_ch);
 
 		case '\\':
@@ -495,7 +561,10 @@ static Token* lexer_emit_token(Lexer self) {
 							default: EMIT(TOK_ERROR);
 						}
 						break;
-					case '\n': if (!triple_quote) EMIT(TOK_ERROR);
+					case '\n':
+						if (!triple_quote) EMIT(TOK_ERROR);
+						current->end_line = ++self->line_no;  // keep line numbers in step with the lines read
+						self->column = 1;
 					str_normal_char:
 					default:
 						*self->string_buffer++ = cur_ch;
@@ -650,23 +719,74 @@ const Token* lexer_peek_token(Lexer self, int offset) {
 	return &self->token_buf[(self->next_tok + offset) % lah_max];
 }
 
+static void lexer_fingerprint_add(Lexer self, const void* data, size_t len) {
+	// FNV-1a
+	for (size_t i = 0; i < len; i++) {
+		self->fingerprint ^= ((const unsigned char*) data)[i];
+		self->fingerprint *= 0x100000001b3ull;
+	}
+}
+
 const Token* lexer_pop_token(Lexer self) {
 	if (!self->tokens_buffered) lexer_emit_token(self);
 	Token* result = &self->token_buf[self->next_tok];
 	self->next_tok = (self->next_tok + 1) % arrlen(self->token_buf);
 	self->tokens_buffered--;
 	self->total_tokens_emitted++;
+	if (self->fingerprinting) {
+		// Lines are relative, so that a token range hashes the same wherever it moves
+		unsigned int position[5] = {
+			result->type,
+			result->start_line - self->fingerprint_base_line, result->start_col,
+			result->end_line - self->fingerprint_base_line, result->end_col,
+		};
+		lexer_fingerprint_add(self, position, sizeof(position));
+		lexer_fingerprint_add(self, result->literal_text, strlen(result->literal_text) + 1);
+	}
 	return result;
 }
 
+void lexer_fingerprint_reset(Lexer self, unsigned int base_line) {
+	self->fingerprinting = true;
+	self->fingerprint_base_line = base_line;
+	self->fingerprint = 0xcbf29ce484222325ull;
+}
+
+uint64_t lexer_fingerprint(Lexer self) {
+	return self->fingerprint;
+}
+
+bool lexer_skip_to_line(Lexer self, unsigned int line) {
+	if ((unsigned int) arrlen(self->lines) >= line) return false;  // already reading it, or past it
+	self->next_tok = (self->next_tok + self->tokens_buffered) % arrlen(self->token_buf);
+	self->tokens_buffered = 0;
+	if (self->paren_stack) stbds_header(self->paren_stack)->length = 0;
+	// The skipped lines still go into the lines array, so that line numbers keep indexing it
+	while ((unsigned int) arrlen(self->lines) < line - 1 && !self->is_last_line) lexer_read_line(self);
+	self->line_no = arrlen(self->lines) + 1;
+	self->column = 1;
+	self->line_offset = self->line_length + 1;  // the next character comes from a fresh line
+	if (self->is_last_line) {
+		// Ran into the end of the input: the next character is EOF
+		self->line_no--;
+		self->line_offset = self->line_length;
+	}
+	return self->line_no == line;
+}
+
 void lexer_seek_toplevel(Lexer self) {
-	while (arrlen(self->paren_stack)) lexer_pop_token(self);
+	// Brackets left open at the end of the file would have this wait for EOF forever
+	while (arrlen(self->paren_stack) && lexer_peek_token(self, 0)->type != TOK_EOF) lexer_pop_token(self);
 	Token* tok;
 	do {
 		tok = lexer_pop_token(self);
 	} while (tok->type != TOK_EOL && tok->type != TOK_EOF && tok->type != TOK_ERROR);
 }
 
+int lexer_tokens_consumed(Lexer self) {
+	return self->total_tokens_emitted;
+}
+
 #define REPR_SIZE 80
 
 const char* token_repr(const Token* tok) {
@@ -80,18 +80,37 @@ typedef struct Token {
 } Token;
 
 Lexer lexer_create(const char* filename);
+/// Lexes a copy of the given text
+Lexer lexer_create_from_memory(const char* text, size_t length);
 void lexer_destroy(Lexer);
+/// Bytes allocated by the lexer, including the text of every line and token
+size_t lexer_memory_usage(Lexer);
 
 /// Provides the pointer to the memory block that holds this lexer's string data
 void* lexer_get_arena(Lexer);
 
 /// Returns the array of lines in the file.
 const unsigned char** lexer_get_lines(Lexer, int* len);
+/// The text of a lexer created from memory; NULL for one that reads a file
+const char* lexer_get_text(Lexer, size_t* length);
 
 const Token* lexer_peek_token(Lexer, int offset);
 const Token* lexer_pop_token(Lexer);
 
 void lexer_seek_toplevel(Lexer);
 
+/// Number of tokens popped so far
+int lexer_tokens_consumed(Lexer);
+
+/// Starts hashing every token popped from here on (type, text and position, with lines
+/// relative to base_line), so that equal token ranges can be recognised after they move.
+void lexer_fingerprint_reset(Lexer, unsigned int base_line);
+uint64_t lexer_fingerprint(Lexer);
+
+/// Drops any tokens peeked so far and continues lexing at the start of the given line,
+/// without tokenizing the lines in between. Must be called between top-level items.
+/// Returns false if that line has been read already or lies past the end of the input.
+bool lexer_skip_to_line(Lexer, unsigned int line);
+
 const char* token_repr(const Token*);
 const char* token_to_string(const Token*);
@@ -0,0 +1,242 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "lower.h"
+#include "ast_walk.h"
+#include "stb_ds.h"
+
+// Bigger functions aren't worth copying into every call
+#define LOWER_INLINE_MAX_NODES 48
+
+typedef enum {
+	INLINE_UNKNOWN = 0,
+	INLINE_YES,
+	INLINE_NO,
+} InlineState;
+
+typedef struct {
+	LoweredCall call;
+	int first_arg, first_vararg;  // in the lowering's slots, until they stop moving
+} Lowered;
+
+struct _lowering {
+	Resolution res;
+	TypeCheck check;
+	Lowered ARRAY calls;
+	struct { const void* key; int value; } MAP index;  // of the calls, by node or comparison
+	AST_Node* const* ARRAY slots;                      // the arguments of every call, one after the other
+	uint8_t ARRAY inline_states;                       // by symbol id
+	AST_Node* const* ARRAY positional;                 // scratch
+	int n_word_ops, n_operators, n_defaults, n_inline;
+};
+
+// === Arguments ===
+
+static inline void add_slot(Lowering lower, AST_Node* const* slot) {
+	arrput(lower->slots, slot);
+}
+
+/// Binds the arguments given to the parameters of `func`: positional ones in order, until
+/// the vararg parameter takes the rest, then named ones, then the defaults of the rest.
+/// Type checking made sure they fit.
+static void bind_arguments(Lowering lower, Lowered* lowered, AST_FuncDef* func, AST_Node* const* const* positional,
+		int n_positional, const AST_FuncCall* call) {
+	LoweredCall* out = &lowered->call;
+	int n_params = shlen(func->params);
+	out->n_args = n_params;
+	out->vararg = -1;
+	for (int p = 0; p < n_params && out->vararg < 0; p++) {
+		if (func->params[p].value->is_vararg) out->vararg = p;
+	}
+	lowered->first_arg = arrlen(lower->slots);
+	for (int p = 0; p < n_params; p++) add_slot(lower, NULL);
+	lowered->first_vararg = arrlen(lower->slots);
+	for (int i = 0; i < n_positional; i++) {
+		if (out->vararg >= 0 && i >= out->vararg) {
+			add_slot(lower, positional[i]);
+			out->n_varargs++;
+		}
+		else if (i < n_params) lower->slots[lowered->first_arg + i] = positional[i];
+	}
+	for (int i = 0; call && i < shlen(call->kw_args); i++) {
+		ptrdiff_t p = shgeti(func->params, call->kw_args[i].key);
+		if (p >= 0) lower->slots[lowered->first_arg + p] = &call->kw_args[i].value;
+	}
+	for (int p = 0; p < n_params; p++) {
+		AST_Param* param = func->params[p].value;
+		if (lower->slots[lowered->first_arg + p] || p == out->vararg || !param->default_value) continue;
+		lower->slots[lowered->first_arg + p] = (AST_Node* const*) &param->default_value;
+		out->n_defaults++;
+	}
+	lower->n_defaults += out->n_defaults;
+}
+
+// === Inlining ===
+
+typedef struct {
+	Lowering lower;
+	SymbolId func;
+	int n_nodes;
+	bool recursive;
+} InlineWalk;
+
+static WalkAction count_pre(AST_Node** slot, void* ctx) {
+	InlineWalk* walk = ctx;
+	AST_Node* node = *slot;
+	if (++walk->n_nodes > LOWER_INLINE_MAX_NODES) return WALK_STOP;
+	if (node->node_type == NODE_FUNC_CALL || node->node_type == NODE_BINOP || node->node_type == NODE_UNARY
+			|| node->node_type == NODE_OP_ASSIGN) {
+		walk->recursive |= typecheck_call_target(walk->lower->check, node) == walk->func;
+	}
+	else if (node->node_type == NODE_COMPARISON) {
+		const AST_ComparisonChain* chain = (const AST_ComparisonChain*) node;
+		for (int i = 0; i < arrlen(chain->comparisons); i++) {
+			walk->recursive |= typecheck_comparison_target(walk->lower->check, chain, i) == walk->func;
+		}
+	}
+	return walk->recursive? WALK_STOP : WALK_CONTINUE;
+}
+
+/// Functions are inlined if their body is small and doesn't call them again. Ones with
+/// varargs are left alone, as their arguments are made into an array anyway.
+static void mark_inline(Lowering lower, SymbolId func) {
+	if (lower->inline_states[func] != INLINE_UNKNOWN) return;
+	AST_FuncDef* def = (AST_FuncDef*) resolution_symbol(lower->res, func)->decl;
+	bool ok = def->body != NULL;
+	for (int p = 0; ok && p < shlen(def->params); p++) ok = !def->params[p].value->is_vararg;
+	if (ok) {
+		InlineWalk walk = { lower, func, 0, false };
+		ok = ast_walk_iterative((AST_Node**) &def->body, &(AST_Visitor) { count_pre, NULL, &walk });
+	}
+	lower->inline_states[func] = ok? INLINE_YES : INLINE_NO;
+	if (ok) lower->n_inline++;
+}
+
+// === Calls ===
+
+static void lower_call(Lowering lower, const void* key, SymbolId target, LoweredKind kind,
+		AST_Node* const* const* positional, int n_positional, const AST_FuncCall* call) {
+	const Symbol* symbol = resolution_symbol(lower->res, target);
+	if (symbol->kind != DECL_FUNCTION) return;
+	Lowered lowered = { .call = { .target = target, .kind = kind } };
+	bind_arguments(lower, &lowered, (AST_FuncDef*) symbol->decl, positional, n_positional, call);
+	hmput(lower->index, key, arrlen(lower->calls));
+	arrput(lower->calls, lowered);
+	if (kind == LOWERED_WORD_OP) lower->n_word_ops++;
+	if (kind == LOWERED_OPERATOR) lower->n_operators++;
+	if (kind != LOWERED_CALL) mark_inline(lower, target);
+}
+
+static WalkAction lower_pre(AST_Node** slot, void* ctx) {
+	Lowering lower = ctx;
+	AST_Node* node = *slot;
+	switch (node->node_type) {
+		// Run at compile time, so never emitted
+		case NODE_RUN:
+			return WALK_SKIP;
+		case NODE_FUNC_CALL: {
+			AST_FuncCall* call = (AST_FuncCall*) node;
+			SymbolId target = typecheck_call_target(lower->check, node);
+			if (!target) break;
+			if (lower->positional) stbds_header(lower->positional)->length = 0;
+			for (int i = 0; i < arrlen(call->pos_args); i++) arrput(lower->positional, &call->pos_args[i]);
+			lower_call(lower, node, target, call->is_word_op? LOWERED_WORD_OP : LOWERED_CALL, lower->positional, arrlen(lower->positional), call);
+			break;
+		}
+		case NODE_BINOP: {
+			AST_Binop* binop = (AST_Binop*) node;
+			SymbolId target = typecheck_call_target(lower->check, node);
+			AST_Node* const* operands[2] = { &binop->lhs, &binop->rhs };
+			if (target) lower_call(lower, node, target, LOWERED_OPERATOR, operands, 2, NULL);
+			break;
+		}
+		case NODE_UNARY: {
+			AST_Unary* unary = (AST_Unary*) node;
+			SymbolId target = typecheck_call_target(lower->check, node);
+			AST_Node* const* operands[1] = { &unary->expr };
+			if (target) lower_call(lower, node, target, LOWERED_OPERATOR, operands, 1, NULL);
+			break;
+		}
+		case NODE_OP_ASSIGN: {
+			AST_OpAssign* assign = (AST_OpAssign*) node;
+			SymbolId target = typecheck_call_target(lower->check, node);
+			AST_Node* const* operands[2] = { &assign->dest_expr, &assign->src_expr };
+			if (target) lower_call(lower, node, target, LOWERED_OPERATOR, operands, 2, NULL);
+			break;
+		}
+		case NODE_COMPARISON: {
+			AST_ComparisonChain* chain = (AST_ComparisonChain*) node;
+			for (int i = 0; i < arrlen(chain->comparisons); i++) {
+				SymbolId target = typecheck_comparison_target(lower->check, chain, i);
+				AST_Node* const* operands[2] = { &chain->operands[i], &chain->operands[i + 1] };
+				if (target) lower_call(lower, &chain->comparisons[i], target, LOWERED_OPERATOR, operands, 2, NULL);
+			}
+			break;
+		}
+		default: break;
+	}
+	return WALK_CONTINUE;
+}
+
+Lowering lower_module(AST_Module* module, Resolution res, TypeCheck check) {
+	Lowering lower = calloc(1, sizeof(struct _lowering));
+	lower->res = res;
+	lower->check = check;
+	int n_symbols = resolution_symbol_count(res) + 1;
+	arrsetlen(lower->inline_states, n_symbols);
+	memset(lower->inline_states, INLINE_UNKNOWN, n_symbols);
+	ast_walk_iterative((AST_Node**) &module, &(AST_Visitor) { lower_pre, NULL, lower });
+	for (int i = 0; i < arrlen(lower->calls); i++) {
+		Lowered* lowered = &lower->calls[i];
+		lowered->call.args = &lower->slots[lowered->first_arg];
+		lowered->call.varargs = &lower->slots[lowered->first_vararg];
+	}
+	return lower;
+}
+
+void lowering_destroy(Lowering lower) {
+	if (!lower) return;
+	arrfree(lower->calls);
+	hmfree(lower->index);
+	arrfree(lower->slots);
+	arrfree(lower->inline_states);
+	arrfree(lower->positional);
+	free(lower);
+}
+
+static const LoweredCall* find_call(Lowering lower, const void* key) {
+	ptrdiff_t i = hmgeti(lower->index, key);
+	return i < 0? NULL : &lower->calls[lower->index[i].value].call;
+}
+
+const LoweredCall* lowering_call(Lowering lower, const AST_Node* node) {
+	return find_call(lower, node);
+}
+
+const LoweredCall* lowering_comparison(Lowering lower, const AST_ComparisonChain* chain, int i) {
+	return find_call(lower, &chain->comparisons[i]);
+}
+
+bool lowering_is_inline_candidate(Lowering lower, SymbolId func) {
+	return func > 0 && func < arrlen(lower->inline_states) && lower->inline_states[func] == INLINE_YES;
+}
+
+int lowering_call_count(Lowering lower) {
+	return arrlen(lower->calls);
+}
+
+int lowering_word_op_count(Lowering lower) {
+	return lower->n_word_ops;
+}
+
+int lowering_operator_count(Lowering lower) {
+	return lower->n_operators;
+}
+
+int lowering_default_count(Lowering lower) {
+	return lower->n_defaults;
+}
+
+int lowering_inline_count(Lowering lower) {
+	return lower->n_inline;
+}
@@ -0,0 +1,56 @@
+#pragma once
+// Lowering of calls: every call of a function of the module, and every word operator
+// ('a \dot b') and overloaded operator, is bound to the function it resolves to, with one
+// argument for each of its parameters in order, which is how a backend emits it
+#include <stdbool.h>
+
+#include "ast.h"
+#include "resolve.h"
+#include "typecheck.h"
+
+typedef struct _lowering* Lowering;
+
+typedef enum {
+	LOWERED_CALL,
+	LOWERED_WORD_OP,
+	LOWERED_OPERATOR,  // a binop, unary op, op-assignment or comparison
+} LoweredKind;
+
+typedef struct {
+	SymbolId target;
+	LoweredKind kind;
+	/// By parameter: the slot of its argument, or of the parameter's default_value where none
+	/// was given. Defaults are expressions of the function's scope; a backend evaluates them
+	/// there as it would for the function's own code. NULL for the vararg parameter.
+	AST_Node* const* const* args;
+	int n_args;
+	int n_defaults;
+	/// The vararg parameter, or -1, and the slots of the arguments that it takes
+	int vararg;
+	AST_Node* const* const* varargs;
+	int n_varargs;
+} LoweredCall;
+
+/// Lowers the calls of a module that type-checked without errors, after its constants are
+/// evaluated, so the calls left are the ones made at run time. Targets of word operators and
+/// operators that are small and don't call themselves are marked to be inlined, so vector
+/// math written with them costs what it would written out by hand. The handle keeps slots of
+/// the tree, so the module must outlive it.
+Lowering lower_module(AST_Module* module, Resolution res, TypeCheck check);
+void lowering_destroy(Lowering lower);
+
+/// The lowered call of an AST_FuncCall, AST_Binop, AST_Unary or AST_OpAssign, or NULL if it
+/// isn't a call of a function of the module (a builtin operator, a cast, an import...)
+const LoweredCall* lowering_call(Lowering lower, const AST_Node* node);
+/// The same for comparison i of a chain
+const LoweredCall* lowering_comparison(Lowering lower, const AST_ComparisonChain* chain, int i);
+/// Whether calls of the function should be replaced by its body
+bool lowering_is_inline_candidate(Lowering lower, SymbolId func);
+
+int lowering_call_count(Lowering lower);
+/// Of those, the calls of word operators and of operators
+int lowering_word_op_count(Lowering lower);
+int lowering_operator_count(Lowering lower);
+/// Arguments filled in with the defaults of their parameters
+int lowering_default_count(Lowering lower);
+int lowering_inline_count(Lowering lower);
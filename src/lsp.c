@@ -0,0 +1,937 @@
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "lsp.h"
+#include "parser.h"
+#include "ast_walk.h"
+#include "json.h"
+#include "stb_ds.h"
+
+#define MAX_HEADER_LENGTH 4096
+
+// JSON-RPC error codes
+#define PARSE_ERROR -32700
+#define INVALID_REQUEST -32600
+#define METHOD_NOT_FOUND -32601
+#define INVALID_PARAMS -32602
+#define SERVER_NOT_INITIALIZED -32002
+
+static long long now_us(void) {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec * 1000000ll + t.tv_nsec / 1000;
+}
+
+static bool write_all(int fd, const char* data, size_t length) {
+	while (length) {
+		ssize_t n = write(fd, data, length);
+		if (n < 0) {
+			if (errno == EINTR) continue;
+			return false;
+		}
+		data += n;
+		length -= n;
+	}
+	return true;
+}
+
+// === Latency ===
+// Log-linear buckets: exact below 16 µs, then 16 buckets per power of two, so a
+// percentile is off by at most 1/16 of its value.
+
+#define LATENCY_SUB_BITS 4
+#define LATENCY_BUCKETS ((64 - LATENCY_SUB_BITS + 1) << LATENCY_SUB_BITS)
+
+typedef struct {
+	uint64_t count, total_us, max_us;
+	uint32_t buckets[LATENCY_BUCKETS];
+} LatencyHistogram;
+
+static int latency_bucket(uint64_t us) {
+	if (us < (1u << LATENCY_SUB_BITS)) return (int) us;
+	int exponent = 63 - __builtin_clzll(us);
+	int sub = (us >> (exponent - LATENCY_SUB_BITS)) & ((1u << LATENCY_SUB_BITS) - 1);
+	return ((exponent - LATENCY_SUB_BITS + 1) << LATENCY_SUB_BITS) + sub;
+}
+
+/// The largest value that falls in the bucket
+static uint64_t latency_bucket_limit(int bucket) {
+	if (bucket < (1 << LATENCY_SUB_BITS)) return bucket;
+	int exponent = (bucket >> LATENCY_SUB_BITS) + LATENCY_SUB_BITS - 1;
+	uint64_t sub = bucket & ((1u << LATENCY_SUB_BITS) - 1);
+	uint64_t low = ((1ull << LATENCY_SUB_BITS) + sub) << (exponent - LATENCY_SUB_BITS);
+	return low + (1ull << (exponent - LATENCY_SUB_BITS)) - 1;
+}
+
+static void latency_record(LatencyHistogram* h, uint64_t us) {
+	h->count++;
+	h->total_us += us;
+	if (us > h->max_us) h->max_us = us;
+	h->buckets[latency_bucket(us)]++;
+}
+
+static uint64_t latency_percentile(const LatencyHistogram* h, double fraction) {
+	uint64_t rank = (uint64_t) (fraction * h->count + 0.999999), seen = 0;
+	if (rank < 1) rank = 1;
+	for (int i = 0; i < LATENCY_BUCKETS; i++) {
+		seen += h->buckets[i];
+		if (seen >= rank) {
+			uint64_t limit = latency_bucket_limit(i);
+			return limit < h->max_us? limit : h->max_us;
+		}
+	}
+	return h->max_us;
+}
+
+// === Documents ===
+
+typedef struct {
+	char ARRAY chars;
+	size_t ARRAY lines;  // where each line starts in chars
+} DocText;
+
+typedef enum {
+	TOKEN_NAMESPACE,
+	TOKEN_TYPE,
+	TOKEN_STRUCT,
+	TOKEN_ENUM,
+	TOKEN_ENUM_MEMBER,
+	TOKEN_FUNCTION,
+	TOKEN_MACRO,
+	TOKEN_PARAMETER,
+	TOKEN_VARIABLE,
+	TOKEN_PROPERTY,
+	TOKEN_NUMBER,
+	TOKEN_STRING,
+} TokenType;
+
+static const char* const TOKEN_TYPE_NAMES[] = {
+	"namespace", "type", "struct", "enum", "enumMember", "function", "macro",
+	"parameter", "variable", "property", "number", "string",
+};
+
+#define TOKEN_DECLARATION 1
+#define TOKEN_READONLY 2
+static const char* const TOKEN_MODIFIER_NAMES[] = { "declaration", "readonly" };
+
+typedef struct {
+	unsigned int line, character, length;  // as the client counts them
+	uint16_t type, modifiers;
+	uint32_t order;  // of being found; the first token found at a position wins
+} SemanticToken;
+
+typedef struct {
+	char* uri;
+	int version;
+	DocText text;
+	Parser parser;
+	AST_Module* module;  // from the last parse that succeeded; NULL if none has
+	DocText module_text;  // what module was parsed from
+	SemanticToken ARRAY tokens;  // of module, in order; built when first asked for
+	bool have_tokens;
+} Document;
+
+typedef struct {
+	int in, out;
+	char ARRAY pending;  // what has been read past the last complete message
+	bool utf32;  // columns are counted in code points rather than UTF-16 code units
+	bool initialized, shutdown, exit;
+	struct { char* key; Document* value; } MAP documents;
+	struct { char* key; LatencyHistogram* value; } MAP latency;
+} Lsp;
+
+static void index_lines(DocText* text) {
+	if (text->lines) stbds_header(text->lines)->length = 0;
+	arrput(text->lines, 0);
+	const char* chars = text->chars, *end = chars + arrlen(text->chars);
+	for (const char* p = chars; (p = memchr(p, '\n', end - p)); p++) arrput(text->lines, p + 1 - chars);
+}
+
+static void copy_text(DocText* to, const DocText* from) {
+	arrsetlen(to->chars, arrlen(from->chars));
+	if (arrlen(from->chars)) memcpy(to->chars, from->chars, arrlen(from->chars));
+	arrsetlen(to->lines, arrlen(from->lines));
+	memcpy(to->lines, from->lines, arrlen(from->lines) * sizeof(size_t));
+}
+
+static void free_text(DocText* text) {
+	arrfree(text->chars);
+	arrfree(text->lines);
+}
+
+/// Bytes of a line, without its line break
+static const char* line_bounds(const DocText* text, int line, const char** end) {
+	if (line < 0) line = 0;
+	if (line >= arrlen(text->lines)) line = arrlen(text->lines) - 1;
+	const char* start = text->chars + text->lines[line];
+	*end = line + 1 < arrlen(text->lines)? text->chars + text->lines[line + 1] - 1 : text->chars + arrlen(text->chars);
+	return start;
+}
+
+static int utf8_length(unsigned char lead) {
+	return lead < 0xc0? 1 : lead < 0xe0? 2 : lead < 0xf0? 3 : 4;
+}
+
+/// The client's column for a column of the parser's (0-based, in code points)
+static unsigned int client_column(const Lsp* self, const DocText* text, int line, unsigned int code_points) {
+	if (self->utf32) return code_points;
+	const char* end;
+	const char* p = line_bounds(text, line, &end);
+	unsigned int units = 0, i = 0;
+	for (; i < code_points && p < end; i++) {
+		int length = utf8_length(*p);
+		units += length == 4? 2 : 1;
+		p += length;
+	}
+	// Past the end of the line, as end-of-line tokens are, every column counts as one
+	return units + (code_points - i);
+}
+
+/// Where a client's position is in the text; positions past the end of a line are at its end
+static size_t text_offset(const Lsp* self, const DocText* text, int line, unsigned int character) {
+	if (line >= arrlen(text->lines)) return arrlen(text->chars);
+	const char* end;
+	const char* p = line_bounds(text, line, &end);
+	for (unsigned int units = 0; units < character && p < end; ) {
+		int length = utf8_length(*p);
+		units += length == 4 && !self->utf32? 2 : 1;
+		p += length;
+	}
+	return (p < end? p : end) - text->chars;
+}
+
+/// Replaces bytes [start, end) of the text, and updates where its lines start
+static void splice_text(DocText* text, size_t start, size_t end, const char* with, size_t length) {
+	size_t removed = end - start;
+	if (length > removed) {
+		size_t grow = length - removed;
+		(void) arraddn(text->chars, grow);
+		memmove(text->chars + end + grow, text->chars + end, arrlen(text->chars) - grow - end);
+	}
+	else if (length < removed) arrdeln(text->chars, start + length, removed - length);
+	if (length) memcpy(text->chars + start, with, length);
+
+	// The lines that started in (start, end] give way to those that start in the new bytes
+	int first = 1, last = arrlen(text->lines);
+	while (first < last) {
+		int mid = (first + last) / 2;
+		if (text->lines[mid] <= start) first = mid + 1;
+		else last = mid;
+	}
+	for (last = first; last < arrlen(text->lines) && text->lines[last] <= end; last++) {}
+	int added = 0;
+	for (const char* p = with; (p = memchr(p, '\n', with + length - p)); p++) added++;
+	if (added > last - first) {
+		int grow = added - (last - first);
+		(void) arraddn(text->lines, grow);
+		memmove(&text->lines[last + grow], &text->lines[last], (arrlen(text->lines) - grow - last) * sizeof(*text->lines));
+	}
+	else if (added < last - first) arrdeln(text->lines, first + added, (last - first) - added);
+	int line = first;
+	for (const char* p = with; (p = memchr(p, '\n', with + length - p)); p++) text->lines[line++] = start + (p - with) + 1;
+	// and the ones after move
+	for (; line < arrlen(text->lines); line++) text->lines[line] = text->lines[line] - removed + length;
+}
+
+static char* uri_to_path(const char* uri) {
+	if (strncmp(uri, "file://", 7) != 0) return strdup(uri);
+	const char* in = uri + 7;
+	char* path = malloc(strlen(in) + 1);
+	char* out = path;
+	while (*in) {
+		int high, low;
+		if (in[0] == '%' && in[1] && in[2] && sscanf(in + 1, "%1x%1x", &high, &low) == 2) {
+			*out++ = (char) (high << 4 | low);
+			in += 3;
+		}
+		else *out++ = *in++;
+	}
+	*out = 0;
+	return path;
+}
+
+static void document_destroy(Document* doc) {
+	free(doc->uri);
+	free_text(&doc->text);
+	free_text(&doc->module_text);
+	parser_destroy(doc->parser);
+	arrfree(doc->tokens);
+	free(doc);
+}
+
+// === Messages ===
+
+static void send_message(Lsp* self, char ARRAY* body) {
+	char header[64];
+	int header_length = snprintf(header, sizeof(header), "Content-Length: %d\r\n\r\n", (int) arrlen(*body));
+	if (!write_all(self->out, header, header_length) || !write_all(self->out, *body, arrlen(*body))) {
+		fprintf(stderr, "Unable to write to the client: %s\n", strerror(errno));
+		self->exit = true;
+	}
+}
+
+static void send_result(Lsp* self, const JsonValue* id, const char* result, size_t length) {
+	char ARRAY body = NULL;
+	json_printf(&body, "{\"jsonrpc\":\"2.0\",\"id\":");
+	json_write(&body, id);
+	json_printf(&body, ",\"result\":");
+	memcpy(json_extend(&body, length), result, length);
+	arrput(body, '}');
+	send_message(self, &body);
+	arrfree(body);
+}
+
+static void send_error(Lsp* self, const JsonValue* id, int code, const char* message) {
+	char ARRAY body = NULL;
+	json_printf(&body, "{\"jsonrpc\":\"2.0\",\"id\":");
+	if (id) json_write(&body, id);
+	else json_printf(&body, "null");
+	json_printf(&body, ",\"error\":{\"code\":%d,\"message\":", code);
+	json_write_string(&body, message, strlen(message));
+	json_printf(&body, "}}");
+	send_message(self, &body);
+	arrfree(body);
+}
+
+static void write_position(char ARRAY* out, unsigned int line, unsigned int character) {
+	json_printf(out, "{\"line\":%u,\"character\":%u}", line, character);
+}
+
+/// Writes the range of a span of the parser's (1-based lines and columns, inclusive end)
+static void write_range(Lsp* self, char ARRAY* out, const DocText* text,
+		unsigned int start_line, unsigned int start_col, unsigned int end_line, unsigned int end_col) {
+	if (!start_line) start_line = 1;
+	if (!start_col) start_col = 1;
+	unsigned int start = client_column(self, text, start_line - 1, start_col - 1);
+	if (!end_line) end_line = start_line;
+	unsigned int end = client_column(self, text, end_line - 1, end_col);
+	if (end_line < start_line || (end_line == start_line && end <= start)) {
+		end_line = start_line;
+		end = client_column(self, text, start_line - 1, start_col);
+	}
+	json_printf(out, "{\"start\":");
+	write_position(out, start_line - 1, start);
+	json_printf(out, ",\"end\":");
+	write_position(out, end_line - 1, end);
+	json_printf(out, "}");
+}
+
+static void publish_diagnostics(Lsp* self, Document* doc) {
+	static const int SEVERITIES[] = { [DIAGNOSTIC_ERROR] = 1, [DIAGNOSTIC_WARNING] = 2, [DIAGNOSTIC_NOTE] = 3 };
+	int count;
+	const ParserDiagnostic* diagnostics = parser_diagnostics(doc->parser, &count);
+	char ARRAY body = NULL;
+	json_printf(&body, "{\"jsonrpc\":\"2.0\",\"method\":\"textDocument/publishDiagnostics\",\"params\":{\"uri\":");
+	json_write_string(&body, doc->uri, strlen(doc->uri));
+	json_printf(&body, ",\"version\":%d,\"diagnostics\":[", doc->version);
+	for (int i = 0; i < count; i++) {
+		const ParserDiagnostic* d = &diagnostics[i];
+		if (i) arrput(body, ',');
+		json_printf(&body, "{\"range\":");
+		write_range(self, &body, &doc->text, d->start_line, d->start_col, d->end_line, d->end_col);
+		json_printf(&body, ",\"severity\":%d,\"source\":\"rhombus\",\"message\":", SEVERITIES[d->severity]);
+		json_write_string(&body, d->message, strlen(d->message));
+		arrput(body, '}');
+	}
+	json_printf(&body, "]}}");
+	send_message(self, &body);
+	arrfree(body);
+}
+
+/// Parses the document's text again, and tells the client what's wrong with it
+static void update_document(Lsp* self, Document* doc, bool first) {
+	long long start = now_us();
+	AST_Module* module;
+	if (first) {
+		module = (AST_Module*) parser_execute(doc->parser);
+	}
+	else {
+		// The parser finds the lines that changed by itself
+		ParserEdit edit = { 1, 0, doc->text.chars, arrlen(doc->text.chars) };
+		module = (AST_Module*) parser_reparse(doc->parser, &edit, NULL);
+	}
+	LatencyHistogram* parse_latency = shget(self->latency, "(parse)");
+	if (!parse_latency) {
+		parse_latency = calloc(1, sizeof(LatencyHistogram));
+		shput(self->latency, "(parse)", parse_latency);
+	}
+	latency_record(parse_latency, now_us() - start);
+	if (module) {
+		doc->module = module;
+		copy_text(&doc->module_text, &doc->text);
+		doc->have_tokens = false;
+	}
+	publish_diagnostics(self, doc);
+}
+
+static Document* find_document(Lsp* self, const JsonValue* params) {
+	const char* uri = json_string(json_get_path(params, "textDocument.uri"));
+	return uri? shget(self->documents, uri) : NULL;
+}
+
+// === Document symbols ===
+
+typedef enum {
+	SYMBOL_MODULE = 2,
+	SYMBOL_FIELD = 8,
+	SYMBOL_ENUM = 10,
+	SYMBOL_FUNCTION = 12,
+	SYMBOL_VARIABLE = 13,
+	SYMBOL_CONSTANT = 14,
+	SYMBOL_KEY = 20,
+	SYMBOL_ENUM_MEMBER = 22,
+	SYMBOL_STRUCT = 23,
+	SYMBOL_OPERATOR = 25,
+	SYMBOL_METHOD = 6,
+} SymbolKind;
+
+static void write_symbol(Lsp* self, char ARRAY* out, const DocText* text, const char* name, size_t name_length,
+		SymbolKind kind, const AST_Node* node, const AST_Node* name_node) {
+	if (!name_node || !name_node->start_line) name_node = node;
+	json_printf(out, "{\"name\":");
+	json_write_string(out, name, name_length);
+	json_printf(out, ",\"kind\":%d,\"range\":", kind);
+	write_range(self, out, text, node->start_line, node->start_col, node->end_line, node->end_col);
+	json_printf(out, ",\"selectionRange\":");
+	write_range(self, out, text, name_node->start_line, name_node->start_col, name_node->end_line, name_node->end_col);
+}
+
+static bool handle_document_symbol(Lsp* self, const JsonValue* params, char ARRAY* result) {
+	Document* doc = find_document(self, params);
+	if (!doc) return false;
+	json_printf(result, "[");
+	AST_Module* module = doc->module;
+	if (module) parser_settle_lines(doc->parser);
+	const DocText* text = &doc->module_text;
+	bool first = true;
+	for (int i = 0; module && i < shlen(module->scope); i++) {
+		const char* key = module->scope[i].key;
+		AST_Node* node = module->scope[i].value;
+		if (!first) arrput(*result, ',');
+		first = false;
+		switch (node->node_type) {
+			case NODE_IMPORT: {
+				AST_Import* imp = (AST_Import*) node;
+				const char* name = imp->local_name? imp->local_name->name : imp->imported_file? imp->imported_file : key;
+				write_symbol(self, result, text, name, strlen(name), SYMBOL_MODULE, node, (AST_Node*) imp->qualified_name);
+			} break;
+			case NODE_STRUCT: {
+				AST_Struct* s = (AST_Struct*) node;
+				write_symbol(self, result, text, key, strlen(key), SYMBOL_STRUCT, node, (AST_Node*) s->name);
+				json_printf(result, ",\"children\":[");
+				for (int j = 0; j < shlen(s->fields); j++) {
+					AST_Field* field = s->fields[j].value;
+					if (j) arrput(*result, ',');
+					write_symbol(self, result, text, s->fields[j].key, strlen(s->fields[j].key), SYMBOL_FIELD,
+						(AST_Node*) field, (AST_Node*) field->name);
+					arrput(*result, '}');
+				}
+				arrput(*result, ']');
+			} break;
+			case NODE_ENUM: {
+				AST_Enum* e = (AST_Enum*) node;
+				write_symbol(self, result, text, key, strlen(key), SYMBOL_ENUM, node, (AST_Node*) e->name);
+				json_printf(result, ",\"children\":[");
+				for (int j = 0; j < shlen(e->fields); j++) {
+					AST_EnumValue* value = e->fields[j].value;
+					if (j) arrput(*result, ',');
+					write_symbol(self, result, text, e->fields[j].key, strlen(e->fields[j].key), SYMBOL_ENUM_MEMBER,
+						(AST_Node*) value, (AST_Node*) value->name);
+					arrput(*result, '}');
+				}
+				arrput(*result, ']');
+			} break;
+			case NODE_FUNC_DEF: {
+				AST_Name* name = ((AST_FuncDef*) node)->name;  // operators are under generated keys
+				write_symbol(self, result, text, name->name, strlen(name->name),
+					ast_is_operator_name(name->name)? SYMBOL_OPERATOR : SYMBOL_FUNCTION, node, (AST_Node*) name);
+			} break;
+			case NODE_MACRO:
+				write_symbol(self, result, text, key, strlen(key), SYMBOL_FUNCTION, node, (AST_Node*) ((AST_Macro*) node)->name);
+				break;
+			case NODE_FUNC_OVERLOAD:
+				write_symbol(self, result, text, key, strlen(key), SYMBOL_FUNCTION, node, (AST_Node*) ((AST_FuncOverload*) node)->name);
+				break;
+			case NODE_CONST:
+				write_symbol(self, result, text, key, strlen(key), SYMBOL_CONSTANT, node, (AST_Node*) ((AST_Const*) node)->name);
+				break;
+			case NODE_RUN:
+				write_symbol(self, result, text, "#run", 4, SYMBOL_FUNCTION, node, NULL);
+				break;
+			case NODE_WARN:
+				write_symbol(self, result, text, "#warn", 5, SYMBOL_KEY, node, NULL);
+				break;
+			default:
+				write_symbol(self, result, text, key, strlen(key), SYMBOL_VARIABLE, node, NULL);
+		}
+		arrput(*result, '}');
+	}
+	for (int i = 0; module && i < arrlen(module->tests); i++) {
+		AST_Test* test = module->tests[i];
+		if (!first) arrput(*result, ',');
+		first = false;
+		char ARRAY name = NULL;
+		json_printf(&name, "test %s", test->description && test->description->value? test->description->value : "");
+		write_symbol(self, result, text, name, arrlen(name), SYMBOL_METHOD, (AST_Node*) test, (AST_Node*) test->description);
+		arrput(*result, '}');
+		arrfree(name);
+	}
+	json_printf(result, "]");
+	return true;
+}
+
+// === Semantic tokens ===
+
+typedef struct {
+	Lsp* lsp;
+	const DocText* text;
+	SemanticToken ARRAY tokens;
+} TokenCollector;
+
+/// Adds a token of `length` code points at a position of the parser's (1-based)
+static void add_token(TokenCollector* c, unsigned int line, unsigned int col, unsigned int length, TokenType type, int modifiers) {
+	if (!line || !col || !length || line > (unsigned int) arrlen(c->text->lines)) return;
+	unsigned int start = client_column(c->lsp, c->text, line - 1, col - 1);
+	unsigned int end = client_column(c->lsp, c->text, line - 1, col - 1 + length);
+	if (end <= start) return;
+	SemanticToken token = { line - 1, start, end - start, type, modifiers, arrlen(c->tokens) };
+	arrput(c->tokens, token);
+}
+
+static unsigned int code_points(const char* str) {
+	unsigned int n = 0;
+	for (; *str; str++) n += ((unsigned char) *str & 0xc0) != 0x80;
+	return n;
+}
+
+static void add_name(TokenCollector* c, const AST_Name* name, TokenType type, int modifiers) {
+	if (name && name->name) add_token(c, name->start_line, name->start_col, code_points(name->name), type, modifiers);
+}
+
+/// Adds a token for each part of a qualified name, found in the text; all but the last are namespaces
+static void add_qualname(TokenCollector* c, const AST_Qualname* qn, TokenType type) {
+	if (!qn || !qn->start_line || qn->start_line > (unsigned int) arrlen(c->text->lines)) return;
+	const char* end;
+	const char* p = line_bounds(c->text, qn->start_line - 1, &end);
+	unsigned int col = 1;
+	while (col < qn->start_col && p < end) {
+		p += utf8_length(*p);
+		col++;
+	}
+	for (int i = 0; i < arrlen(qn->parts); i++) {
+		while (p < end && (*p == ' ' || *p == '\t' || *p == '.')) {
+			p++;
+			col++;
+		}
+		size_t len = strlen(qn->parts[i]);
+		if ((size_t) (end - p) < len || memcmp(p, qn->parts[i], len) != 0) return;
+		unsigned int n = code_points(qn->parts[i]);
+		add_token(c, qn->start_line, col, n, i + 1 < arrlen(qn->parts)? TOKEN_NAMESPACE : type, 0);
+		p += len;
+		col += n;
+	}
+}
+
+static void add_span(TokenCollector* c, const AST_Node* node, TokenType type) {
+	if (node->end_line != node->start_line || node->end_col < node->start_col) return;
+	add_token(c, node->start_line, node->start_col, node->end_col - node->start_col + 1, type, 0);
+}
+
+// Declarations name their names; names reached on their own are variables
+static WalkAction collect_token(AST_Node** slot, void* ctx) {
+	TokenCollector* c = ctx;
+	AST_Node* node = *slot;
+	switch (node->node_type) {
+		case NODE_FUNC_DEF: add_name(c, ((AST_FuncDef*) node)->name, TOKEN_FUNCTION, TOKEN_DECLARATION); break;
+		case NODE_MACRO: add_name(c, ((AST_Macro*) node)->name, TOKEN_MACRO, TOKEN_DECLARATION); break;
+		case NODE_PARAM: add_name(c, ((AST_Param*) node)->name, TOKEN_PARAMETER, TOKEN_DECLARATION); break;
+		case NODE_CONST: add_name(c, ((AST_Const*) node)->name, TOKEN_VARIABLE, TOKEN_DECLARATION | TOKEN_READONLY); break;
+		case NODE_STRUCT: add_name(c, ((AST_Struct*) node)->name, TOKEN_STRUCT, TOKEN_DECLARATION); break;
+		case NODE_FIELD: add_name(c, ((AST_Field*) node)->name, TOKEN_PROPERTY, TOKEN_DECLARATION); break;
+		case NODE_ENUM: add_name(c, ((AST_Enum*) node)->name, TOKEN_ENUM, TOKEN_DECLARATION); break;
+		case NODE_ENUM_VALUE: add_name(c, ((AST_EnumValue*) node)->name, TOKEN_ENUM_MEMBER, TOKEN_DECLARATION); break;
+		case NODE_VAR_DECL: add_name(c, ((AST_VarDecl*) node)->name, TOKEN_VARIABLE, TOKEN_DECLARATION); break;
+		case NODE_FOR_SIMPLE: add_name(c, ((AST_ForSimple*) node)->name, TOKEN_VARIABLE, TOKEN_DECLARATION); break;
+		case NODE_FOR_RANGE: add_name(c, ((AST_ForRange*) node)->name, TOKEN_VARIABLE, TOKEN_DECLARATION); break;
+		case NODE_FOR_PARALLEL: {
+			AST_ForParallel* loop = (AST_ForParallel*) node;
+			for (int i = 0; i < arrlen(loop->names); i++) add_name(c, loop->names[i], TOKEN_VARIABLE, TOKEN_DECLARATION);
+		} break;
+		case NODE_FUNC_OVERLOAD: {
+			AST_FuncOverload* overload = (AST_FuncOverload*) node;
+			add_name(c, overload->name, TOKEN_FUNCTION, TOKEN_DECLARATION);
+			for (int i = 0; i < arrlen(overload->overloads); i++) add_name(c, overload->overloads[i], TOKEN_FUNCTION, 0);
+		} break;
+		case NODE_IMPORT: {
+			AST_Import* imp = (AST_Import*) node;
+			add_qualname(c, imp->qualified_name, TOKEN_NAMESPACE);
+			// An import without 'as' is named after what it imports, and at the same place
+			add_name(c, imp->local_name, TOKEN_NAMESPACE, TOKEN_DECLARATION);
+		} break;
+		case NODE_SIMPLE_TYPE: add_qualname(c, ((AST_SimpleType*) node)->base, TOKEN_TYPE); break;
+		case NODE_FIELD_ACCESS: add_qualname(c, ((AST_FieldAccess*) node)->field, TOKEN_PROPERTY); break;
+		case NODE_FUNC_CALL: {
+			AST_Node* func = ((AST_FuncCall*) node)->func;
+			if (func && func->node_type == NODE_QUALNAME) add_qualname(c, (AST_Qualname*) func, TOKEN_FUNCTION);
+		} break;
+		case NODE_QUALNAME: add_qualname(c, (AST_Qualname*) node, TOKEN_VARIABLE); break;
+		case NODE_NAME: add_name(c, (AST_Name*) node, TOKEN_VARIABLE, 0); break;
+		case NODE_INT:
+		case NODE_FLOAT: add_span(c, node, TOKEN_NUMBER); break;
+		case NODE_STRING:
+		case NODE_CHAR: add_span(c, node, TOKEN_STRING); break;
+		default: break;
+	}
+	return WALK_CONTINUE;
+}
+
+static int compare_tokens(const void* a, const void* b) {
+	const SemanticToken* x = a, *y = b;
+	if (x->line != y->line) return x->line < y->line? -1 : 1;
+	if (x->character != y->character) return x->character < y->character? -1 : 1;
+	return x->order < y->order? -1 : x->order > y->order;
+}
+
+static void build_tokens(Lsp* self, Document* doc) {
+	parser_settle_lines(doc->parser);
+	TokenCollector c = { self, &doc->module_text, doc->tokens };
+	if (c.tokens) stbds_header(c.tokens)->length = 0;
+	AST_Visitor visitor = { collect_token, NULL, &c };
+	for (int i = 0; i < shlen(doc->module->scope); i++) ast_walk_iterative(&doc->module->scope[i].value, &visitor);
+	for (int i = 0; i < arrlen(doc->module->tests); i++) ast_walk_iterative((AST_Node**) &doc->module->tests[i], &visitor);
+	qsort(c.tokens, arrlen(c.tokens), sizeof(SemanticToken), compare_tokens);
+	// Keep the first token at each position, and drop those that overlap the one before
+	int kept = 0;
+	for (int i = 0; i < arrlen(c.tokens); i++) {
+		if (kept) {
+			const SemanticToken* last = &c.tokens[kept - 1];
+			if (last->line == c.tokens[i].line && last->character + last->length > c.tokens[i].character) continue;
+		}
+		c.tokens[kept++] = c.tokens[i];
+	}
+	arrsetlen(c.tokens, kept);
+	doc->tokens = c.tokens;
+	doc->have_tokens = true;
+}
+
+/// Writes the tokens within lines [start_line, end_line) in the relative encoding the protocol uses
+static void write_tokens(char ARRAY* out, const SemanticToken* tokens, int count, unsigned int start_line, unsigned int end_line) {
+	json_printf(out, "{\"data\":[");
+	unsigned int line = 0, character = 0;
+	bool first = true;
+	for (int i = 0; i < count; i++) {
+		const SemanticToken* t = &tokens[i];
+		if (t->line < start_line || t->line >= end_line) continue;
+		unsigned int delta_line = t->line - line;
+		unsigned int delta_start = delta_line? t->character : t->character - character;
+		json_printf(out, first? "%u,%u,%u,%u,%u" : ",%u,%u,%u,%u,%u", delta_line, delta_start, t->length, t->type, t->modifiers);
+		first = false;
+		line = t->line;
+		character = t->character;
+	}
+	json_printf(out, "]}");
+}
+
+static bool handle_semantic_tokens(Lsp* self, const JsonValue* params, char ARRAY* result) {
+	Document* doc = find_document(self, params);
+	if (!doc) return false;
+	if (doc->module && !doc->have_tokens) build_tokens(self, doc);
+	unsigned int start_line = 0, end_line = UINT32_MAX;
+	const JsonValue* range = json_get(params, "range");
+	if (range) {
+		start_line = json_number(json_get_path(range, "start.line"), 0);
+		end_line = json_number(json_get_path(range, "end.line"), UINT32_MAX - 1) + 1;
+	}
+	write_tokens(result, doc->tokens, arrlen(doc->tokens), start_line, end_line);
+	return true;
+}
+
+// === Lifecycle and synchronization ===
+
+static bool handle_initialize(Lsp* self, const JsonValue* params, char ARRAY* result) {
+	// Columns are code points to the parser, so UTF-32 is the cheaper encoding when it's offered
+	const JsonValue* encodings = json_get_path(params, "capabilities.general.positionEncodings");
+	for (int i = 0; encodings && encodings->type == JSON_ARRAY && i < arrlen(encodings->items); i++) {
+		const char* encoding = json_string(&encodings->items[i]);
+		if (encoding && strcmp(encoding, "utf-32") == 0) self->utf32 = true;
+	}
+	self->initialized = true;
+	json_printf(result, "{\"capabilities\":{\"positionEncoding\":\"%s\","
+		"\"textDocumentSync\":{\"openClose\":true,\"change\":2},"
+		"\"documentSymbolProvider\":true,"
+		"\"semanticTokensProvider\":{\"legend\":{\"tokenTypes\":[", self->utf32? "utf-32" : "utf-16");
+	for (size_t i = 0; i < sizeof(TOKEN_TYPE_NAMES) / sizeof(*TOKEN_TYPE_NAMES); i++) {
+		json_printf(result, i? ",\"%s\"" : "\"%s\"", TOKEN_TYPE_NAMES[i]);
+	}
+	json_printf(result, "],\"tokenModifiers\":[");
+	for (size_t i = 0; i < sizeof(TOKEN_MODIFIER_NAMES) / sizeof(*TOKEN_MODIFIER_NAMES); i++) {
+		json_printf(result, i? ",\"%s\"" : "\"%s\"", TOKEN_MODIFIER_NAMES[i]);
+	}
+	json_printf(result, "]},\"full\":true,\"range\":true}},\"serverInfo\":{\"name\":\"rhombus\"}}");
+	return true;
+}
+
+static bool handle_initialized(Lsp* self, const JsonValue* params, char ARRAY* result) {
+	(void) self, (void) params, (void) result;
+	return true;
+}
+
+static bool handle_shutdown(Lsp* self, const JsonValue* params, char ARRAY* result) {
+	(void) params;
+	self->shutdown = true;
+	json_printf(result, "null");
+	return true;
+}
+
+static bool handle_exit(Lsp* self, const JsonValue* params, char ARRAY* result) {
+	(void) params, (void) result;
+	self->exit = true;
+	return true;
+}
+
+static bool handle_did_open(Lsp* self, const JsonValue* params, char ARRAY* result) {
+	(void) result;
+	const char* uri = json_string(json_get_path(params, "textDocument.uri"));
+	const JsonValue* text = json_get_path(params, "textDocument.text");
+	if (!uri || !text || text->type != JSON_STRING) return false;
+	Document* old = shget(self->documents, uri);
+	if (old) {
+		(void) shdel(self->documents, uri);
+		document_destroy(old);
+	}
+
+	Document* doc = calloc(1, sizeof(Document));
+	doc->uri = strdup(uri);
+	doc->version = json_number(json_get_path(params, "textDocument.version"), 0);
+	arrsetlen(doc->text.chars, text->string.length);
+	if (text->string.length) memcpy(doc->text.chars, text->string.chars, text->string.length);
+	char* path = uri_to_path(uri);
+	doc->parser = parser_create_from_memory(path, text->string.chars, text->string.length);
+	free(path);
+	if (!doc->parser) {
+		free(doc->uri);
+		free_text(&doc->text);
+		free(doc);
+		return false;
+	}
+	parser_collect_diagnostics(doc->parser, true);
+	index_lines(&doc->text);
+	shput(self->documents, uri, doc);
+	update_document(self, doc, true);
+	return true;
+}
+
+static bool handle_did_change(Lsp* self, const JsonValue* params, char ARRAY* result) {
+	(void) result;
+	Document* doc = find_document(self, params);
+	const JsonValue* changes = json_get(params, "contentChanges");
+	if (!doc || !changes || changes->type != JSON_ARRAY) return false;
+	doc->version = json_number(json_get_path(params, "textDocument.version"), doc->version + 1);
+	for (int i = 0; i < arrlen(changes->items); i++) {
+		const JsonValue* change = &changes->items[i];
+		const JsonValue* text = json_get(change, "text");
+		const JsonValue* range = json_get(change, "range");
+		if (!text || text->type != JSON_STRING) continue;
+		size_t start = 0, end = arrlen(doc->text.chars);
+		if (range) {
+			// Each change is relative to the text the one before left
+			start = text_offset(self, &doc->text, json_number(json_get_path(range, "start.line"), 0),
+				json_number(json_get_path(range, "start.character"), 0));
+			end = text_offset(self, &doc->text, json_number(json_get_path(range, "end.line"), 0),
+				json_number(json_get_path(range, "end.character"), 0));
+			if (end < start) end = start;
+		}
+		splice_text(&doc->text, start, end, text->string.chars, text->string.length);
+	}
+	update_document(self, doc, false);
+	return true;
+}
+
+static bool handle_did_close(Lsp* self, const JsonValue* params, char ARRAY* result) {
+	(void) result;
+	Document* doc = find_document(self, params);
+	if (!doc) return false;
+	// Diagnostics of a closed file are stale as far as the client goes
+	char ARRAY body = NULL;
+	json_printf(&body, "{\"jsonrpc\":\"2.0\",\"method\":\"textDocument/publishDiagnostics\",\"params\":{\"uri\":");
+	json_write_string(&body, doc->uri, strlen(doc->uri));
+	json_printf(&body, ",\"diagnostics\":[]}}");
+	send_message(self, &body);
+	arrfree(body);
+	(void) shdel(self->documents, doc->uri);
+	document_destroy(doc);
+	return true;
+}
+
+static void write_latency(Lsp* self, char ARRAY* out) {
+	json_printf(out, "{");
+	for (int i = 0; i < shlen(self->latency); i++) {
+		const LatencyHistogram* h = self->latency[i].value;
+		if (i) arrput(*out, ',');
+		json_write_string(out, self->latency[i].key, strlen(self->latency[i].key));
+		json_printf(out, ":{\"count\":%llu,\"mean\":%llu,\"p50\":%llu,\"p90\":%llu,\"p99\":%llu,\"max\":%llu}",
+			(unsigned long long) h->count, (unsigned long long) (h->count? h->total_us / h->count : 0),
+			(unsigned long long) latency_percentile(h, 0.5), (unsigned long long) latency_percentile(h, 0.9),
+			(unsigned long long) latency_percentile(h, 0.99), (unsigned long long) h->max_us);
+	}
+	json_printf(out, "}");
+}
+
+static bool handle_latency(Lsp* self, const JsonValue* params, char ARRAY* result) {
+	write_latency(self, result);
+	if (json_bool(json_get(params, "reset"), false)) {
+		for (int i = 0; i < shlen(self->latency); i++) memset(self->latency[i].value, 0, sizeof(LatencyHistogram));
+	}
+	return true;
+}
+
+typedef bool (*MessageHandler)(Lsp* self, const JsonValue* params, char ARRAY* result);
+
+static const struct {
+	const char* method;
+	MessageHandler handler;
+} HANDLERS[] = {
+	{ "initialize", handle_initialize },
+	{ "initialized", handle_initialized },
+	{ "shutdown", handle_shutdown },
+	{ "exit", handle_exit },
+	{ "textDocument/didOpen", handle_did_open },
+	{ "textDocument/didChange", handle_did_change },
+	{ "textDocument/didClose", handle_did_close },
+	{ "textDocument/documentSymbol", handle_document_symbol },
+	{ "textDocument/semanticTokens/full", handle_semantic_tokens },
+	{ "textDocument/semanticTokens/range", handle_semantic_tokens },
+	{ "rhombus/latency", handle_latency },
+};
+
+static void handle_message(Lsp* self, const char* body, size_t length, long long start) {
+	JsonValue* message = json_parse(body, length);
+	if (!message) {
+		send_error(self, NULL, PARSE_ERROR, "Parse error");
+		return;
+	}
+	const char* method = json_string(json_get(message, "method"));
+	const JsonValue* id = json_get(message, "id");
+	const JsonValue* params = json_get(message, "params");
+	if (!method) {
+		json_free(message);  // a response to a request of ours; there are none
+		return;
+	}
+
+	MessageHandler handler = NULL;
+	for (size_t i = 0; i < sizeof(HANDLERS) / sizeof(*HANDLERS); i++) {
+		if (strcmp(HANDLERS[i].method, method) == 0) handler = HANDLERS[i].handler;
+	}
+	char ARRAY result = NULL;
+	if (!handler) {
+		if (id) send_error(self, id, METHOD_NOT_FOUND, "Unknown method");
+	}
+	else if (!self->initialized && handler != handle_initialize && handler != handle_exit) {
+		if (id) send_error(self, id, SERVER_NOT_INITIALIZED, "The server hasn't been initialized");
+	}
+	else if (self->shutdown && handler != handle_exit) {
+		if (id) send_error(self, id, INVALID_REQUEST, "The server is shutting down");
+	}
+	else if (!handler(self, params, &result)) {
+		if (id) send_error(self, id, INVALID_PARAMS, "Missing or unknown document");
+	}
+	else if (id) {
+		send_result(self, id, result, arrlen(result));
+	}
+	arrfree(result);
+
+	LatencyHistogram* h = shget(self->latency, method);
+	if (!h) {
+		h = calloc(1, sizeof(LatencyHistogram));
+		shput(self->latency, method, h);
+	}
+	latency_record(h, now_us() - start);
+	json_free(message);
+}
+
+// === Transport ===
+
+/// Length of the body that follows a header block, or -1 if it doesn't say
+static long content_length(const char* headers, size_t length) {
+	const char* end = headers + length;
+	for (const char* line = headers; line < end; ) {
+		const char* eol = memchr(line, '\n', end - line);
+		if (!eol) eol = end;
+		if (eol - line > 15 && strncasecmp(line, "Content-Length:", 15) == 0) return strtol(line + 15, NULL, 10);
+		line = eol + 1;
+	}
+	return -1;
+}
+
+/// Handles every complete message received so far. Returns false if the stream can't be made sense of.
+static bool handle_pending(Lsp* self) {
+	while (!self->exit) {
+		char* pending = self->pending;
+		size_t available = arrlen(self->pending);
+		const char* blank = NULL;
+		for (size_t i = 0; i + 3 < available; i++) {
+			if (memcmp(pending + i, "\r\n\r\n", 4) == 0) {
+				blank = pending + i;
+				break;
+			}
+		}
+		if (!blank) return available <= MAX_HEADER_LENGTH;
+		long length = content_length(pending, blank - pending);
+		if (length < 0) {
+			fprintf(stderr, "A message has no Content-Length\n");
+			return false;
+		}
+		size_t header_length = blank + 4 - pending;
+		if (available < header_length + length) return true;
+		handle_message(self, pending + header_length, length, now_us());
+		arrdeln(self->pending, 0, header_length + length);
+	}
+	return true;
+}
+
+static void print_latency(Lsp* self) {
+	if (!shlen(self->latency)) return;
+	fprintf(stderr, "%-36s %8s %8s %8s %8s %8s %8s\n", "latency (us)", "count", "mean", "p50", "p90", "p99", "max");
+	for (int i = 0; i < shlen(self->latency); i++) {
+		const LatencyHistogram* h = self->latency[i].value;
+		if (!h->count) continue;
+		fprintf(stderr, "%-36s %8llu %8llu %8llu %8llu %8llu %8llu\n", self->latency[i].key,
+			(unsigned long long) h->count, (unsigned long long) (h->total_us / h->count),
+			(unsigned long long) latency_percentile(h, 0.5), (unsigned long long) latency_percentile(h, 0.9),
+			(unsigned long long) latency_percentile(h, 0.99), (unsigned long long) h->max_us);
+	}
+}
+
+int lsp_run(void) {
+	// Messages get the real stdout; anything else printed there goes to stderr
+	Lsp self = { .in = STDIN_FILENO, .out = dup(STDOUT_FILENO) };
+	dup2(STDERR_FILENO, STDOUT_FILENO);
+	sh_new_strdup(self.documents);
+	sh_new_strdup(self.latency);
+
+	char buf[64 * 1024];
+	while (!self.exit) {
+		ssize_t n = read(self.in, buf, sizeof(buf));
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) break;
+		memcpy(json_extend(&self.pending, n), buf, n);
+		if (!handle_pending(&self)) break;
+	}
+
+	print_latency(&self);
+	for (int i = 0; i < shlen(self.documents); i++) document_destroy(self.documents[i].value);
+	shfree(self.documents);
+	for (int i = 0; i < shlen(self.latency); i++) free(self.latency[i].value);
+	shfree(self.latency);
+	arrfree(self.pending);
+	close(self.out);
+	// Exiting without a shutdown request first is an error, as the protocol has it
+	return self.exit && self.shutdown? 0 : 1;
+}
@@ -0,0 +1,19 @@
+#pragma once
+// A language server: answers Language Server Protocol messages on stdin and stdout
+//
+// Documents are kept in memory, and parsed again on every change; only the top-level
+// items that an edit touches are lexed and parsed again (see parser_reparse). Handles:
+//   initialize, initialized, shutdown, exit
+//   textDocument/didOpen, didChange, didClose   incremental sync; syntax errors and warnings
+//                                               are sent back with publishDiagnostics
+//   textDocument/documentSymbol                 the declarations in module->scope, with the
+//                                               fields of structs and enums, and the tests
+//   textDocument/semanticTokens/full, /range    names by role, numbers and strings
+//   rhombus/latency                             time taken by each kind of message so far, in
+//                                               microseconds: count, mean, p50, p90, p99, max.
+//                                               With params { "reset": true }, starts over.
+// A message is timed from having been read to having been answered, diagnostics included.
+// The same figures are printed to stderr on exit.
+
+/// Answers messages until an exit notification, or the end of stdin. Returns the exit status.
+int lsp_run(void);
@@ -3,10 +3,25 @@
 #include <stdlib.h>
 #include <locale.h>
 #include <string.h>
+#include <time.h>
 
 #include "lexer.h"
 #include "parser.h"
+#include "modules.h"
 #include "colors.h"
+#include "server.h"
+#include "lsp.h"
+#include "resolve.h"
+#include "typecheck.h"
+#include "fold.h"
+#include "consteval.h"
+#include "lower.h"
+#include "escape.h"
+#include "alias.h"
+#include "bounds.h"
+#include "emit_c.h"
+#include "bytecode.h"
+#include "vm.h"
 
 #if defined(WIN32) || defined(_WIN32) || defined(__WIN32__) || defined(__NT__)
 	#define color_is_supported() 0
@@ -16,25 +31,384 @@
 	#define color_is_supported() 0
 #endif
 
+#define DEFAULT_MEMORY_LIMIT_MB 1024
+
+static void usage(const char* program) {
+	fprintf(stderr, "Usage: %s [--ast-cache DIR] [--share-nodes] [--json | --quiet] [--profile-parse] [--resolve] [--fold] [--check] [--eval] [--lower] [--escape] [--alias] [--bounds] [--emit-c | --bytecode | --run | --test] [--no-jit] [--jobs N] FILE\n", program);
+	fprintf(stderr, "       %s --serve [--socket PATH] [--memory-limit MB] [--ast-cache DIR] [--share-nodes]\n", program);
+	fprintf(stderr, "       %s --lsp\n", program);
+}
+
+static void report_resolution(ModuleGraph modules) {
+	for (int i = 0; i < module_graph_count(modules); i++) {
+		LoadedModule* module = module_graph_module(modules, i);
+		if (!module->ast) continue;
+		struct timespec start, end;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		Resolution res = resolve_module(module->ast);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		double ms = (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6;
+		fprintf(stderr, "%s: %d symbols in %d scopes, %d names not declared in the module (%.2f ms)\n",
+			module->path, resolution_symbol_count(res), resolution_scope_count(res),
+			resolution_unresolved_count(res), ms);
+		resolution_destroy(res);
+	}
+}
+
+/// Folds the constant expressions of every module. The handles own the literals put in
+/// the trees, so they are kept until the modules are freed.
+static ConstFold* fold_modules(ModuleGraph modules) {
+	TypeTable table = type_table_create();
+	int n_modules = module_graph_count(modules);
+	ConstFold* folds = calloc(n_modules, sizeof(ConstFold));
+	for (int i = 0; i < n_modules; i++) {
+		LoadedModule* module = module_graph_module(modules, i);
+		if (!module->ast) continue;
+		struct timespec start, end;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		Resolution res = resolve_module(module->ast);
+		folds[i] = fold_constants(module->ast, res, table);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		double ms = (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6;
+		fprintf(stderr, "%s: %d constant expressions folded (%.2f ms)\n", module->path, const_fold_count(folds[i]), ms);
+		resolution_destroy(res);
+	}
+	type_table_destroy(table);
+	return folds;
+}
+
+/// Places the allocations of a module, and reports how many are left on the heap
+static EscapeAnalysis report_escapes(LoadedModule* module, Resolution res, TypeCheck check, Lowering lowering) {
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	EscapeAnalysis esc = escape_analyze(module->ast, res, check, lowering);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	double ms = (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6;
+	int n_allocations = 0, n_heap = 0;
+	for (int i = 0; i < escape_function_count(esc); i++) {
+		const EscapeStats* stats = escape_function_stats(esc, i);
+		if (!stats->n_allocations) continue;
+		int heap = stats->n_allocations - stats->n_temporary;
+		fprintf(stderr, "  %s: %d heap allocations, %d after escape analysis (%d temporary, %d freed implicitly)\n",
+			resolution_symbol(res, stats->func)->name, stats->n_allocations, heap, stats->n_temporary, stats->n_freed);
+		n_allocations += stats->n_allocations;
+		n_heap += heap;
+	}
+	fprintf(stderr, "%s: %d heap allocations, %d after escape analysis (%.2f ms)\n", module->path, n_allocations, n_heap, ms);
+	return esc;
+}
+
+/// Checks that the arguments of a module's calls don't alias its restrict parameters.
+static AliasAnalysis report_aliases(LoadedModule* module, Resolution res, TypeCheck check, TypeTable table, Lowering lowering,
+		EscapeAnalysis esc) {
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	AliasAnalysis alias = alias_analyze(module->ast, res, check, table, lowering, esc);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	double ms = (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6;
+	fprintf(stderr, "%s: %d restrict parameters, %d calls checked, %d alias errors (%.2f ms)\n", module->path,
+		alias_restrict_count(alias), alias_checked_count(alias), alias_error_count(alias), ms);
+	return alias;
+}
+
+/// Proves what array subscripts of a module it can in bounds, and checks the calls of
+/// functions with '#pre' conditions.
+static Bounds report_bounds(LoadedModule* module, Resolution res, TypeCheck check, TypeTable table, Lowering lowering) {
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	Bounds bounds = bounds_analyze(module->ast, res, check, table, lowering);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	double ms = (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6;
+	int n_left = bounds_subscript_count(bounds) - bounds_eliminated_count(bounds);
+	fprintf(stderr, "%s: %d array subscripts, %d bounds checks eliminated, %d left (%d in loops), %d precondition errors (%.2f ms)\n",
+		module->path, bounds_subscript_count(bounds), bounds_eliminated_count(bounds), n_left, bounds_loop_check_count(bounds),
+		bounds_error_count(bounds), ms);
+	return bounds;
+}
+
+/// What is done with the input module once every pass is run on it
+typedef enum {
+	BACKEND_NONE,
+	BACKEND_C,         // written to stdout as C
+	BACKEND_BYTECODE,  // compiled to bytecode, which is written to stdout
+	BACKEND_RUN,       // compiled to bytecode, and its 'main' run
+	BACKEND_TEST,      // compiled to bytecode, and its tests run
+} Backend;
+
+/// Compiles a module to bytecode, and runs it for `backend`, with hot functions compiled to
+/// machine code if `jit`. Returns the number of errors: those compiling it, and the tests or
+/// 'main' that failed. An Int that 'main' returns is put in `exit_status`.
+static int run_bytecode(LoadedModule* module, Resolution res, TypeCheck check, TypeTable table, Lowering lowering,
+		EscapeAnalysis esc, Bounds proven, Backend backend, bool jit, int* exit_status) {
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	Program program = bytecode_compile(module->ast, res, check, table, lowering, esc, proven);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	double ms = (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6;
+	if (!program) {
+		fprintf(stderr, "%s: not compiled to bytecode\n", module->path);
+		return 1;
+	}
+	fprintf(stderr, "%s: compiled to %d bytecode instructions in %d functions (%.2f ms)\n", module->path,
+		program_instruction_count(program), program_function_count(program), ms);
+	int n_failed = 0;
+	VM vm = vm_create(program);
+	if (!jit) vm_set_jit(vm, -1);
+	VMStats stats;
+	if (backend == BACKEND_BYTECODE) program_disassemble(stdout, program);
+	else if (backend == BACKEND_RUN && program_main(program) < 0) {
+		fprintf(stderr, "%s: there is no 'main' to run\n", module->path);
+		n_failed++;
+	}
+	else if (backend == BACKEND_RUN) {
+		const Function* main = program_function(program, program_main(program));
+		if (!vm_run(vm, program_main(program), &stats)) n_failed++;
+		else if (main->returns_value) *exit_status = (int) stats.result.i;
+		fprintf(stderr, "%s: %lld instructions in %.2f ms (%.1f M instructions/s), %d calls deep\n", module->path,
+			(long long) stats.instructions, stats.ms, stats.ms > 0? stats.instructions / stats.ms / 1e3 : 0.0, stats.max_depth);
+		if (stats.jit_functions) {
+			fprintf(stderr, "%s: %d functions compiled to %zu bytes of machine code\n", module->path,
+				stats.jit_functions, stats.jit_bytes);
+		}
+	}
+	else if (backend == BACKEND_TEST) {
+		int64_t instructions = 0;
+		ms = 0;
+		for (int i = 0; i < program_test_count(program); i++) {
+			const char* description;
+			bool passed = vm_run(vm, program_test(program, i, &description), &stats);
+			instructions += stats.instructions;
+			ms += stats.ms;
+			if (passed) color_fprintf(stderr, TERM_FG_GREEN, "Passed: %s\n", description);
+			else color_fprintf(stderr, TERM_FG_RED, "Failed: %s\n", description);
+			n_failed += !passed;
+		}
+		fprintf(stderr, "%s: %d of %d tests passed, %lld instructions in %.2f ms\n", module->path,
+			program_test_count(program) - n_failed, program_test_count(program), (long long) instructions, ms);
+		if (program_test_count(program) && stats.jit_functions) {
+			fprintf(stderr, "%s: %d functions compiled to %zu bytes of machine code\n", module->path,
+				stats.jit_functions, stats.jit_bytes);
+		}
+	}
+	vm_destroy(vm);
+	program_destroy(program);
+	return n_failed;
+}
+
+/// Type-checks every module, with their types in one table. False if there are errors.
+/// With `evals`, modules without type errors then have their constants evaluated and
+/// '#run' statements run; the handles own the literals put in the trees, like folds'. With
+/// `lower` as well, their calls are then lowered, with `escape` their allocations placed,
+/// with `alias` the arguments of their restrict parameters checked, and with `bounds` their
+/// subscripts' bounds checks eliminated where they can be. If nothing had errors by then,
+/// `root` (with every pass) then goes to the `backend`, which runs it with the JIT if `jit`.
+static bool check_types(ModuleGraph modules, int n_jobs, ConstEval** evals, bool lower, bool escape, bool alias,
+		bool bounds, LoadedModule* root, Backend backend, bool jit, int* exit_status) {
+	TypeTable table = type_table_create();
+	TaskPool pool = task_pool_create(n_jobs);
+	int n_errors = 0;
+	if (evals) *evals = calloc(module_graph_count(modules), sizeof(ConstEval));
+	for (int i = 0; i < module_graph_count(modules); i++) {
+		LoadedModule* module = module_graph_module(modules, i);
+		if (!module->ast) continue;
+		struct timespec start, end;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		Resolution res = resolve_module(module->ast);
+		TypeCheck check = typecheck_module(module->ast, res, table, pool);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		double ms = (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6;
+		fprintf(stderr, "%s: %d type errors (%.2f ms)\n", module->path, typecheck_error_count(check), ms);
+		if (typecheck_dispatch_count(check)) {
+			fprintf(stderr, "%s: %d calls and operators resolved to overloads, %d by a cache lookup\n", module->path,
+				typecheck_dispatch_count(check), typecheck_dispatch_cache_hits(check));
+		}
+		n_errors += typecheck_error_count(check);
+		if (evals && !typecheck_error_count(check)) {
+			clock_gettime(CLOCK_MONOTONIC, &start);
+			ConstEval eval = (*evals)[i] = consteval_module(module->ast, res, check, table, pool);
+			clock_gettime(CLOCK_MONOTONIC, &end);
+			ms = (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6;
+			fprintf(stderr, "%s: %d constants evaluated, %d baked into literals, %d #run statements (%.2f ms)\n", module->path,
+				consteval_constant_count(eval), consteval_baked_count(eval), consteval_run_count(eval), ms);
+			n_errors += consteval_error_count(eval);
+			if (lower && !consteval_error_count(eval)) {
+				Lowering lowering = lower_module(module->ast, res, check);
+				fprintf(stderr, "%s: %d calls lowered (%d word operators, %d operators), %d default arguments filled in, %d functions to inline\n",
+					module->path, lowering_call_count(lowering), lowering_word_op_count(lowering), lowering_operator_count(lowering),
+					lowering_default_count(lowering), lowering_inline_count(lowering));
+				EscapeAnalysis esc = escape? report_escapes(module, res, check, lowering) : NULL;
+				AliasAnalysis aliases = esc && alias? report_aliases(module, res, check, table, lowering, esc) : NULL;
+				Bounds proven = bounds? report_bounds(module, res, check, table, lowering) : NULL;
+				if (aliases) n_errors += alias_error_count(aliases);
+				if (proven) n_errors += bounds_error_count(proven);
+				if (module == root && backend == BACKEND_C && !n_errors) {
+					clock_gettime(CLOCK_MONOTONIC, &start);
+					int n_codegen_errors = emit_c(stdout, module->ast, res, check, table, lowering, esc, aliases, proven);
+					clock_gettime(CLOCK_MONOTONIC, &end);
+					ms = (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6;
+					fprintf(stderr, "%s: written as C, %d codegen errors (%.2f ms)\n", module->path, n_codegen_errors, ms);
+					n_errors += n_codegen_errors;
+				}
+				else if (module == root && backend != BACKEND_NONE && !n_errors) {
+					n_errors += run_bytecode(module, res, check, table, lowering, esc, proven, backend, jit, exit_status);
+				}
+				if (proven) bounds_destroy(proven);
+				if (aliases) alias_destroy(aliases);
+				if (esc) escape_destroy(esc);
+				lowering_destroy(lowering);
+			}
+		}
+		typecheck_destroy(check);
+		resolution_destroy(res);
+	}
+	fprintf(stderr, "%d types interned, %d threads\n", type_count(table), task_pool_size(pool));
+	task_pool_destroy(pool);
+	type_table_destroy(table);
+	return n_errors == 0;
+}
+
 int main(int argc, char *argv[]) {
 	int status = 0;
 	setlocale(LC_ALL, "en_US.utf8");
-	if (color_is_supported()) color_enable();
-	if (argc >= 2) {
-		Parser parser = parser_create(argv[1]);
-		if (!parser) {
-			perror("Unable to open file");
+
+	const char* input = NULL;
+	const char* cache_dir = NULL;
+	bool json = false;
+	bool quiet = false;  // parse only; no AST dump
+	bool profile_parse = false;
+	bool share_nodes = false;  // hash-cons types, literals and qualified names
+	bool resolve = false;  // resolve the names of every module and report on it
+	bool fold = false;  // fold constant expressions into literals, before anything else looks at them
+	bool check = false;  // type-check every module
+	bool evaluate = false;  // and then evaluate their constants and run their '#run' statements
+	bool lower = false;  // and then lower their calls
+	bool escape = false;  // and then place their allocations by escape analysis
+	bool alias = false;  // and then check the arguments of their restrict parameters
+	bool bounds = false;  // lower, then eliminate the bounds checks of subscripts that are proven in bounds
+	Backend backend = BACKEND_NONE;  // run every pass, then what is done with the input module
+	bool jit = true;  // compile the functions the VM finds hot to machine code
+	int n_jobs = 0;  // threads to parse and check with; 0 for one per processor
+	bool serve = false;
+	ServerOptions server = { .memory_limit = (size_t) DEFAULT_MEMORY_LIMIT_MB << 20 };
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--ast-cache") == 0 && i + 1 < argc) {
+			cache_dir = argv[++i];
+		}
+		else if (strcmp(argv[i], "--serve") == 0) {
+			serve = true;
+		}
+		else if (strcmp(argv[i], "--lsp") == 0) {
+			return lsp_run();
+		}
+		else if (strcmp(argv[i], "--socket") == 0 && i + 1 < argc) {
+			server.socket_path = argv[++i];
+		}
+		else if (strcmp(argv[i], "--memory-limit") == 0 && i + 1 < argc) {
+			server.memory_limit = (size_t) strtoull(argv[++i], NULL, 10) << 20;
+		}
+		else if (strcmp(argv[i], "--share-nodes") == 0) {
+			share_nodes = true;
+		}
+		else if (strcmp(argv[i], "--json") == 0) {
+			json = true;
+		}
+		else if (strcmp(argv[i], "--quiet") == 0) {
+			quiet = true;
+		}
+		else if (strcmp(argv[i], "--profile-parse") == 0) {
+			profile_parse = true;
+		}
+		else if (strcmp(argv[i], "--resolve") == 0) {
+			resolve = true;
+		}
+		else if (strcmp(argv[i], "--fold") == 0) {
+			fold = true;
+		}
+		else if (strcmp(argv[i], "--check") == 0) {
+			check = true;
+		}
+		else if (strcmp(argv[i], "--eval") == 0) {
+			check = evaluate = true;
+		}
+		else if (strcmp(argv[i], "--lower") == 0) {
+			check = evaluate = lower = true;
+		}
+		else if (strcmp(argv[i], "--escape") == 0) {
+			check = evaluate = lower = escape = true;
+		}
+		else if (strcmp(argv[i], "--alias") == 0) {
+			check = evaluate = lower = escape = alias = true;
 		}
-		AST_Node* root = parser_execute(parser);
+		else if (strcmp(argv[i], "--bounds") == 0) {
+			check = evaluate = lower = bounds = true;
+		}
+		else if (strcmp(argv[i], "--emit-c") == 0) {
+			fold = check = evaluate = lower = escape = alias = bounds = true;
+			backend = BACKEND_C;
+		}
+		else if (strcmp(argv[i], "--bytecode") == 0 || strcmp(argv[i], "--run") == 0 || strcmp(argv[i], "--test") == 0) {
+			fold = check = evaluate = lower = escape = alias = bounds = true;
+			backend = argv[i][2] == 'b'? BACKEND_BYTECODE : argv[i][2] == 'r'? BACKEND_RUN : BACKEND_TEST;
+		}
+		else if (strcmp(argv[i], "--no-jit") == 0) {
+			jit = false;
+		}
+		else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+			n_jobs = atoi(argv[++i]);
+		}
+		else if (argv[i][0] == '-' && argv[i][1] == '-') {
+			usage(argv[0]);
+			return 1;
+		}
+		else if (!input) {
+			input = argv[i];
+		}
+	}
+
+	if (serve) {
+		// Diagnostics go to clients, which may not be terminals
+		server.cache_dir = cache_dir;
+		server.share_nodes = share_nodes;
+		return server_run(&server);
+	}
+	if (color_is_supported()) color_enable();
+
+	if (input) {
+		ModuleGraph modules = module_graph_create();
+		if (cache_dir) module_graph_set_cache_dir(modules, cache_dir);
+		module_graph_set_share_nodes(modules, share_nodes);
+		module_graph_set_threads(modules, n_jobs);
+		LoadedModule* root = module_graph_load(modules, input);
+		ConstFold* folds = NULL;
+		ConstEval* evals = NULL;
 		if (root) {
 			color_fprintf(stderr, TERM_FG_GREEN, "Parsing success!\n");
-			print_ast(stdout, root);
+			if (fold) folds = fold_modules(modules);
+			if (resolve) report_resolution(modules);
+			int exit_status = 0;
+			if (check && !check_types(modules, n_jobs, evaluate? &evals : NULL, lower, escape, alias, bounds, root, backend, jit, &exit_status)) status = 1;
+			else if (backend == BACKEND_RUN) status = exit_status;
+			if (backend != BACKEND_NONE) {}  // the C, the bytecode or what runs is the output
+			else if (json) ast_to_json(stdout, (AST_Node*) root->ast);
+			else if (!quiet) print_ast(stdout, (AST_Node*) root->ast);
 		}
 		else {
 			color_fprintf(stderr, TERM_FG_RED, "Parsing failed.\n");
 			status = 1;
 		}
-		parser_destroy(parser);
+		int n_modules = module_graph_count(modules);
+		module_graph_destroy(modules);
+		if (folds) {
+			for (int i = 0; i < n_modules; i++) const_fold_destroy(folds[i]);
+			free(folds);
+		}
+		if (evals) {
+			for (int i = 0; i < n_modules; i++) consteval_destroy(evals[i]);
+			free(evals);
+		}
+		if (profile_parse && !parser_profile_report(stderr)) {
+			fprintf(stderr, "--profile-parse: this build has no profiling; rebuild with 'make clean; make PROFILE_PARSE=1'\n");
+		}
 	}
 	return status;
 }
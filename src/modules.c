@@ -0,0 +1,471 @@
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "modules.h"
+#include "stb_ds.h"
+#include "colors.h"
+
+#define MODULE_EXTENSION ".rh"
+
+struct _module_graph {
+	struct { char* key; LoadedModule* value; } MAP modules;
+	const char* cache_dir;
+	int n_threads;
+	int generation;
+	bool watched;
+	bool share_nodes;
+};
+
+ModuleGraph module_graph_create(void) {
+	ModuleGraph self = calloc(1, sizeof(struct _module_graph));
+	if (!self) return NULL;
+	sh_new_strdup(self->modules);
+	return self;
+}
+
+static void module_unload(LoadedModule* mod) {
+	if (mod->parser) parser_destroy(mod->parser);
+	if (mod->cached) rhast_close(mod->cached);
+	mod->parser = NULL;
+	mod->cached = NULL;
+	mod->ast = NULL;
+}
+
+void module_graph_destroy(ModuleGraph self) {
+	int len = shlen(self->modules);
+	for (int i = 0; i < len; i++) {
+		LoadedModule* mod = self->modules[i].value;
+		module_unload(mod);
+		arrfree(mod->imports);
+		free(mod);
+	}
+	shfree(self->modules);
+	free(self);
+}
+
+void module_graph_set_threads(ModuleGraph self, int n_threads) {
+	self->n_threads = n_threads;
+}
+
+void module_graph_set_cache_dir(ModuleGraph self, const char* dir) {
+	self->cache_dir = dir;
+}
+
+void module_graph_set_share_nodes(ModuleGraph self, bool share) {
+	self->share_nodes = share;
+}
+
+static int default_thread_count(void) {
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	return n > 0? (int) n : 1;
+}
+
+static bool is_stdin(const char* path) {
+	return strcmp(path, "-") == 0;
+}
+
+static LoadedModule* get_or_add_module(ModuleGraph self, const char* canonical_path) {
+	LoadedModule* mod = shget(self->modules, canonical_path);
+	if (mod) return mod;
+	mod = calloc(1, sizeof(LoadedModule));
+	shput(self->modules, canonical_path, mod);
+	// The key is owned by the map (sh_new_strdup), so it outlives the caller's buffer
+	mod->path = self->modules[shgeti(self->modules, canonical_path)].key;
+	return mod;
+}
+
+LoadedModule* module_graph_find(ModuleGraph self, const char* path) {
+	if (is_stdin(path)) return shget(self->modules, path);
+	char* canonical = realpath(path, NULL);
+	if (!canonical) return NULL;
+	LoadedModule* mod = shget(self->modules, canonical);
+	free(canonical);
+	return mod;
+}
+
+int module_graph_count(ModuleGraph self) {
+	return shlen(self->modules);
+}
+
+LoadedModule* module_graph_module(ModuleGraph self, int index) {
+	return self->modules[index].value;
+}
+
+void module_graph_set_watched(ModuleGraph self, bool watched) {
+	self->watched = watched;
+}
+
+void module_graph_invalidate(ModuleGraph self, const char* canonical_path) {
+	if (!canonical_path) {
+		for (int i = 0; i < shlen(self->modules); i++) self->modules[i].value->changed = true;
+		return;
+	}
+	LoadedModule* mod = shget(self->modules, canonical_path);
+	if (mod) mod->changed = true;
+}
+
+// === Cache validation ===
+
+static uint64_t hash_bytes(const char* data, size_t len) {
+	// FNV-1a
+	uint64_t hash = 0xcbf29ce484222325ull;
+	for (size_t i = 0; i < len; i++) {
+		hash ^= (unsigned char) data[i];
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+/// Timestamps of files are only as fine as this on some filesystems, and on others only
+/// advance with the kernel's clock tick
+#define MTIME_GRANULARITY_S 1
+
+/// Whether the module's file may have been edited since it was checked without its mtime
+/// changing: it was modified within the granularity of timestamps of being checked
+static bool mtime_is_racy(const LoadedModule* mod) {
+	return mod->checked - mod->mtime.tv_sec <= MTIME_GRANULARITY_S;
+}
+
+/// Returns true if the module has to be (re-)parsed.
+/// mtime (to the nanosecond) and size are checked first; the contents are only hashed when
+/// those differ, or when the mtime is too recent to tell, so touching a file without changing
+/// it does not invalidate its AST.
+/// In a watched graph, files are only checked once they are reported to have changed, and
+/// those are always hashed: the report is surer than the mtime.
+static bool module_is_stale(ModuleGraph self, LoadedModule* mod) {
+	if (is_stdin(mod->path)) return !mod->ast;  // stdin can only be read once
+	if (self->watched && mod->ast && !mod->changed) return false;
+	bool reported = mod->changed;
+	mod->changed = false;
+	time_t now = time(NULL);
+	struct stat st;
+	if (stat(mod->path, &st) != 0) return true;  // the parser will report the problem
+	bool same_stamp = st.st_mtim.tv_sec == mod->mtime.tv_sec && st.st_mtim.tv_nsec == mod->mtime.tv_nsec
+		&& st.st_size == mod->size;
+	if (mod->ast && same_stamp && !reported && !mtime_is_racy(mod)) return false;
+
+	uint64_t hash = 0;
+	FILE* fp = fopen(mod->path, "rb");
+	if (fp) {
+		char* contents = malloc(st.st_size + 1);
+		size_t len = fread(contents, 1, st.st_size, fp);
+		hash = hash_bytes(contents, len);
+		free(contents);
+		fclose(fp);
+	}
+	bool stale = !mod->ast || hash != mod->hash;
+	mod->mtime = st.st_mtim;
+	mod->checked = now;
+	mod->size = st.st_size;
+	mod->hash = hash;
+	return stale;
+}
+
+// === Parallel parsing ===
+
+typedef struct {
+	ModuleGraph graph;
+	LoadedModule* ARRAY jobs;
+	atomic_int next_job;
+} ParseBatch;
+
+static void cache_path(ModuleGraph self, const LoadedModule* mod, char* buf, size_t size) {
+	snprintf(buf, size, "%s/%016llx" RHAST_EXTENSION, self->cache_dir,
+		(unsigned long long) hash_bytes(mod->path, strlen(mod->path)));
+}
+
+static bool load_cached(ModuleGraph self, LoadedModule* mod) {
+	char path[PATH_MAX];
+	cache_path(self, mod, path, sizeof(path));
+	RhastFile file = rhast_open(path);
+	if (!file) return false;
+	const RhastHeader* h = rhast_header(file);
+	if (h->source_hash != mod->hash || h->source_size != mod->size) {
+		rhast_close(file);
+		return false;
+	}
+	mod->ast = rhast_module(file);
+	mod->cached = file;
+	return true;
+}
+
+static void parse_module(ModuleGraph self, LoadedModule* mod) {
+	bool use_cache = self->cache_dir && !is_stdin(mod->path);
+	if (mod->parser && !is_stdin(mod->path)) {
+		// Parsed before: only the top-level items that changed are parsed again
+		mod->ast = (AST_Module*) parser_reparse(mod->parser, NULL, NULL);
+		if (mod->ast) parser_settle_lines(mod->parser);
+	}
+	else {
+		module_unload(mod);
+		if (use_cache && load_cached(self, mod)) {
+			mod->failed = false;
+			return;
+		}
+		mod->parser = parser_create(mod->path);
+		if (!mod->parser) {
+			color_fprintf(stderr, TERM_FG_RED, "Unable to open '%s'\n", mod->path);
+			mod->failed = true;
+			return;
+		}
+		parser_share_nodes(mod->parser, self->share_nodes);
+		mod->ast = (AST_Module*) parser_execute(mod->parser);
+	}
+	mod->failed = !mod->ast;
+	// The locations of shared nodes are kept by the parser, and .rhast files have no place for them
+	if (use_cache && mod->ast && !self->share_nodes) {
+		char path[PATH_MAX];
+		cache_path(self, mod, path, sizeof(path));
+		rhast_write(path, mod->ast, mod->mtime.tv_sec, mod->size, mod->hash);
+	}
+}
+
+static void* parse_worker(void* arg) {
+	ParseBatch* batch = arg;
+	int n_jobs = arrlen(batch->jobs);
+	int i;
+	while ((i = atomic_fetch_add(&batch->next_job, 1)) < n_jobs) {
+		parse_module(batch->graph, batch->jobs[i]);
+	}
+	return NULL;
+}
+
+/// Parses every module in the batch, spreading them across worker threads.
+/// Modules in a batch never depend on each other's ASTs, so no locking is needed.
+static void parse_batch(ModuleGraph self, ParseBatch* batch) {
+	int n_jobs = arrlen(batch->jobs);
+	int n_threads = self->n_threads > 0? self->n_threads : default_thread_count();
+	if (n_threads > n_jobs) n_threads = n_jobs;
+	atomic_init(&batch->next_job, 0);
+	if (n_threads <= 1) {
+		parse_worker(batch);
+		return;
+	}
+	pthread_t* threads = malloc(sizeof(pthread_t) * n_threads);
+	int started = 0;
+	for (; started < n_threads; started++) {
+		if (pthread_create(&threads[started], NULL, parse_worker, batch) != 0) break;
+	}
+	if (!started) parse_worker(batch);  // couldn't spawn anything; do it ourselves
+	for (int t = 0; t < started; t++) {
+		pthread_join(threads[t], NULL);
+	}
+	free(threads);
+}
+
+// === Import resolution ===
+
+/// Returns the canonical path of an import's target, or NULL if it does not exist.
+/// Paths are relative to the directory of the importing module.
+/// Qualified names map onto directories, so `import foo.bar` looks for foo/bar.rh
+static char* resolve_import_path(const LoadedModule* importer, const AST_Import* imp) {
+	char candidate[PATH_MAX];
+	const char* dir_end = strrchr(importer->path, '/');
+	int dir_len = dir_end? (int) (dir_end - importer->path) + 1 : 0;
+	if (imp->imported_file) {
+		if (imp->imported_file[0] == '/') dir_len = 0;
+		snprintf(candidate, sizeof(candidate), "%.*s%s", dir_len, importer->path, imp->imported_file);
+	}
+	else if (imp->qualified_name) {
+		int len = snprintf(candidate, sizeof(candidate), "%.*s", dir_len, importer->path);
+		int n_parts = arrlen(imp->qualified_name->parts);
+		for (int i = 0; i < n_parts && len < (int) sizeof(candidate); i++) {
+			len += snprintf(candidate + len, sizeof(candidate) - len, "%s%s",
+				imp->qualified_name->parts[i], (i + 1 < n_parts)? "/" : MODULE_EXTENSION);
+		}
+		if (len >= (int) sizeof(candidate)) return NULL;
+	}
+	else return NULL;
+	return realpath(candidate, NULL);
+}
+
+static void import_error(const LoadedModule* importer, const AST_Import* imp, const char* message, const char* target) {
+	flockfile(stderr);
+	fprintf(stderr, "In '%s' at line %d, column %d...\n  ", importer->path, imp->start_line, imp->start_col);
+	color_fprintf(stderr, TERM_FG_RED, "Import error: ");
+	fprintf(stderr, "%s '%s'\n", message, target);
+	funlockfile(stderr);
+}
+
+/// Links the imports of a freshly-(re)loaded module and queues any module not yet
+/// reached during this load. Returns the number of errors encountered.
+static int link_imports(ModuleGraph self, LoadedModule* mod, LoadedModule* ARRAY* frontier) {
+	int errors = 0;
+	if (mod->imports) stbds_header(mod->imports)->length = 0;
+	int len = shlen(mod->ast->scope);
+	for (int i = 0; i < len; i++) {
+		AST_Import* imp = (AST_Import*) mod->ast->scope[i].value;
+		if (imp->node_type != NODE_IMPORT) continue;
+		char* path = resolve_import_path(mod, imp);
+		if (!path) {
+			imp->module_handle = NULL;
+			// Qualified names that don't map to a file may refer to libraries,
+			// which are resolved later. Explicit paths must exist.
+			if (imp->imported_file) {
+				import_error(mod, imp, "Unable to find", imp->imported_file);
+				errors++;
+			}
+			continue;
+		}
+		LoadedModule* dep = get_or_add_module(self, path);
+		free(path);
+		imp->module_handle = dep;
+		arrpush(mod->imports, dep);
+		if (dep->visit_gen != self->generation) {
+			dep->visit_gen = self->generation;
+			dep->depth = mod->depth + 1;
+			arrpush(*frontier, dep);
+		}
+	}
+	return errors;
+}
+
+// === Cycle detection ===
+
+enum { MARK_NEW = 0, MARK_ACTIVE, MARK_DONE };
+
+typedef struct {
+	LoadedModule* mod;
+	int next_import;
+} CycleFrame;
+
+static void report_cycle(CycleFrame* stack, int top, LoadedModule* repeated) {
+	flockfile(stderr);
+	color_fprintf(stderr, TERM_FG_RED, "Import error: ");
+	fprintf(stderr, "import cycle detected:\n");
+	int start = 0;
+	while (stack[start].mod != repeated) start++;
+	for (int i = start; i <= top; i++) {
+		fprintf(stderr, "    %s imports\n", stack[i].mod->path);
+	}
+	fprintf(stderr, "    %s\n", repeated->path);
+	funlockfile(stderr);
+}
+
+/// Iterative DFS over the reachable graph. Every module and edge is visited once,
+/// so this is linear no matter how many paths lead to a module.
+static int check_cycles(ModuleGraph self, LoadedModule* root) {
+	int len = shlen(self->modules);
+	for (int i = 0; i < len; i++) self->modules[i].value->cycle_mark = MARK_NEW;
+
+	int cycles = 0;
+	CycleFrame* stack = NULL;
+	arrpush(stack, ((CycleFrame) { root, 0 }));
+	root->cycle_mark = MARK_ACTIVE;
+	while (arrlen(stack)) {
+		CycleFrame* frame = &arrlast(stack);
+		if (frame->next_import >= arrlen(frame->mod->imports)) {
+			frame->mod->cycle_mark = MARK_DONE;
+			(void) arrpop(stack);
+			continue;
+		}
+		LoadedModule* dep = frame->mod->imports[frame->next_import++];
+		switch (dep->cycle_mark) {
+			case MARK_NEW:
+				dep->cycle_mark = MARK_ACTIVE;
+				arrpush(stack, ((CycleFrame) { dep, 0 }));
+				break;
+			case MARK_ACTIVE:
+				report_cycle(stack, arrlen(stack) - 1, dep);
+				cycles++;
+				break;
+			case MARK_DONE:
+				break;
+		}
+	}
+	arrfree(stack);
+	return cycles;
+}
+
+// === Loading ===
+
+LoadedModule* module_graph_load(ModuleGraph self, const char* root_file) {
+	char* canonical = is_stdin(root_file)? strdup(root_file) : realpath(root_file, NULL);
+	if (!canonical) {
+		color_fprintf(stderr, TERM_FG_RED, "Unable to open '%s'\n", root_file);
+		return NULL;
+	}
+	LoadedModule* root = get_or_add_module(self, canonical);
+	free(canonical);
+
+	self->generation++;
+	root->visit_gen = self->generation;
+	root->depth = 0;
+
+	int errors = 0;
+	LoadedModule* ARRAY frontier = NULL;
+	LoadedModule* ARRAY next = NULL;
+	ParseBatch batch = { .graph = self };
+	arrpush(frontier, root);
+
+	// Breadth-first: every module in a layer is known before any of it is parsed
+	while (arrlen(frontier)) {
+		if (batch.jobs) stbds_header(batch.jobs)->length = 0;
+		for (int i = 0; i < arrlen(frontier); i++) {
+			if (module_is_stale(self, frontier[i])) arrpush(batch.jobs, frontier[i]);
+		}
+		if (arrlen(batch.jobs)) parse_batch(self, &batch);
+
+		if (next) stbds_header(next)->length = 0;
+		for (int i = 0; i < arrlen(frontier); i++) {
+			LoadedModule* mod = frontier[i];
+			if (mod->failed) errors++;
+			else errors += link_imports(self, mod, &next);
+		}
+		LoadedModule** swap = frontier;
+		frontier = next;
+		next = swap;
+	}
+	arrfree(frontier);
+	arrfree(next);
+	arrfree(batch.jobs);
+
+	if (errors) return NULL;
+	if (check_cycles(self, root)) return NULL;
+	return root;
+}
+
+// === Eviction ===
+
+static size_t module_memory_usage(const LoadedModule* mod) {
+	if (mod->parser) return parser_memory_usage(mod->parser);
+	if (mod->cached) return rhast_header(mod->cached)->file_size;
+	return 0;
+}
+
+size_t module_graph_memory_usage(ModuleGraph self) {
+	size_t total = 0;
+	for (int i = 0; i < shlen(self->modules); i++) total += module_memory_usage(self->modules[i].value);
+	return total;
+}
+
+static int compare_last_load(const void* a, const void* b) {
+	const LoadedModule* x = *(LoadedModule* const*) a;
+	const LoadedModule* y = *(LoadedModule* const*) b;
+	return (x->visit_gen > y->visit_gen) - (x->visit_gen < y->visit_gen);
+}
+
+size_t module_graph_evict(ModuleGraph self, size_t budget) {
+	size_t total = module_graph_memory_usage(self);
+	if (total <= budget) return total;
+	LoadedModule* ARRAY candidates = NULL;
+	for (int i = 0; i < shlen(self->modules); i++) {
+		LoadedModule* mod = self->modules[i].value;
+		if (mod->visit_gen != self->generation && module_memory_usage(mod)) arrpush(candidates, mod);
+	}
+	if (candidates) qsort(candidates, arrlen(candidates), sizeof(LoadedModule*), compare_last_load);
+	for (int i = 0; i < arrlen(candidates) && total > budget; i++) {
+		total -= module_memory_usage(candidates[i]);
+		module_unload(candidates[i]);
+	}
+	arrfree(candidates);
+	return total;
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "ast.h"
+#include "parser.h"
+#include "rhast.h"
+
+typedef struct _module_graph* ModuleGraph;
+
+typedef struct LoadedModule {
+	const char* path;  // canonical path; also the key of the module in its graph
+	AST_Module* ast;
+	Parser parser;     // NULL when the AST is from the on-disk cache
+	RhastFile cached;  // the AST is used in place, from the mapped file
+	struct LoadedModule* ARRAY imports;  // direct dependencies, in declaration order
+	// Cache validation: a module is only re-parsed when both of these checks fail
+	struct timespec mtime;
+	time_t checked;  // when mtime was read; edits within a second of it may keep the same mtime
+	int64_t size;
+	uint64_t hash;
+	int depth;       // layer in which the module was first reached from the root
+	int visit_gen;   // last load generation that reached this module
+	int cycle_mark;  // scratch space for cycle detection
+	bool failed;
+	bool changed;    // reported by module_graph_invalidate since the module was last checked
+} LoadedModule;
+
+ModuleGraph module_graph_create(void);
+void module_graph_destroy(ModuleGraph graph);
+
+/// Number of threads used to parse modules within a dependency layer (0 = one per CPU)
+void module_graph_set_threads(ModuleGraph graph, int n_threads);
+
+/// Directory for .rhast files. When set, unchanged modules are loaded from
+/// there instead of being parsed, and freshly parsed modules are saved there.
+void module_graph_set_cache_dir(ModuleGraph graph, const char* dir);
+
+/// Parses modules with hash-consed types, literals and qualified names (parser_share_nodes).
+/// Such modules are read from the cache, but never written to it. Off by default.
+void module_graph_set_share_nodes(ModuleGraph graph, bool share);
+
+/// Loads the root file and everything it imports, transitively.
+/// Each module is parsed at most once per change to its contents, and every
+/// resolved AST_Import gets its module_handle pointed at the LoadedModule it refers to.
+/// Returns NULL if any module failed to parse or the imports contain a cycle.
+LoadedModule* module_graph_load(ModuleGraph graph, const char* root_file);
+
+/// Looks up an already-loaded module by path (canonicalized first)
+LoadedModule* module_graph_find(ModuleGraph graph, const char* path);
+
+/// Every module the graph knows of, loaded or not, by index
+int module_graph_count(ModuleGraph graph);
+LoadedModule* module_graph_module(ModuleGraph graph, int index);
+
+/// When set, the caller promises to report every change to a source file through
+/// module_graph_invalidate (e.g. from a file watcher), and loads stop checking the files
+/// of modules that weren't reported. Off by default.
+void module_graph_set_watched(ModuleGraph graph, bool watched);
+
+/// Marks the module with the given canonical path as possibly changed; NULL marks all of them
+void module_graph_invalidate(ModuleGraph graph, const char* canonical_path);
+
+/// Bytes held by the parsed or mapped ASTs of the graph's modules
+size_t module_graph_memory_usage(ModuleGraph graph);
+
+/// Unloads the least recently loaded modules until the graph holds at most `budget` bytes.
+/// Modules reached by the last load are never unloaded. Unloaded modules are parsed again
+/// when next reached. Returns the bytes still held.
+size_t module_graph_evict(ModuleGraph graph, size_t budget);
@@ -0,0 +1,186 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "overload.h"
+#include "stb_ds.h"
+
+typedef struct {
+	const char* name;
+	bool is_operator;
+	SymbolId ARRAY candidates;
+} OverloadSet;
+
+struct _overloads {
+	OverloadSet ARRAY sets;
+	int ARRAY set_of;  // by symbol id, for '#overload's; -1 for anything else
+};
+
+// === Sets ===
+
+static int operator_set(Overloads overloads, const char* op) {
+	for (int i = 0; i < arrlen(overloads->sets); i++) {
+		if (overloads->sets[i].is_operator && strcmp(overloads->sets[i].name, op) == 0) return i;
+	}
+	OverloadSet set = { op, true, NULL };
+	arrput(overloads->sets, set);
+	return arrlen(overloads->sets) - 1;
+}
+
+static void add_candidate(OverloadSet* set, SymbolId id) {
+	for (int i = 0; i < arrlen(set->candidates); i++) {
+		if (set->candidates[i] == id) return;
+	}
+	arrput(set->candidates, id);
+}
+
+Overloads overloads_create(Resolution res) {
+	Overloads overloads = calloc(1, sizeof(struct _overloads));
+	int n_symbols = resolution_symbol_count(res) + 1;
+	arrsetlen(overloads->set_of, n_symbols);
+	for (int i = 0; i < n_symbols; i++) overloads->set_of[i] = -1;
+	for (SymbolId id = 1; id < n_symbols; id++) {
+		const Symbol* symbol = resolution_symbol(res, id);
+		if (symbol->kind == DECL_FUNCTION && symbol->name_node && ast_is_operator_name(symbol->name_node->name)) {
+			// Found first, as finding it may move the sets
+			int set = operator_set(overloads, symbol->name_node->name);
+			add_candidate(&overloads->sets[set], id);
+		}
+		if (symbol->kind != DECL_OVERLOAD) continue;
+		AST_FuncOverload* overload = (AST_FuncOverload*) symbol->decl;
+		int set;
+		if (ast_is_operator_name(symbol->name)) set = operator_set(overloads, symbol->name);
+		else {
+			OverloadSet named = { symbol->name, false, NULL };
+			arrput(overloads->sets, named);
+			set = arrlen(overloads->sets) - 1;
+		}
+		overloads->set_of[id] = set;
+		// Names that aren't the module's functions may be imported ones, which can't be resolved here
+		for (int i = 0; i < arrlen(overload->overloads); i++) {
+			SymbolId member = resolution_lookup(res, (AST_Node* const*) &overload->overloads[i]).symbol;
+			if (member && resolution_symbol(res, member)->kind == DECL_FUNCTION) add_candidate(&overloads->sets[set], member);
+		}
+	}
+	return overloads;
+}
+
+void overloads_destroy(Overloads overloads) {
+	if (!overloads) return;
+	for (int i = 0; i < arrlen(overloads->sets); i++) arrfree(overloads->sets[i].candidates);
+	arrfree(overloads->sets);
+	arrfree(overloads->set_of);
+	free(overloads);
+}
+
+int overloads_count(Overloads overloads) {
+	return arrlen(overloads->sets);
+}
+
+int overloads_of_symbol(Overloads overloads, SymbolId overload) {
+	return overload > 0 && overload < arrlen(overloads->set_of)? overloads->set_of[overload] : -1;
+}
+
+int overloads_of_operator(Overloads overloads, const char* op) {
+	for (int i = 0; i < arrlen(overloads->sets); i++) {
+		if (overloads->sets[i].is_operator && strcmp(overloads->sets[i].name, op) == 0) return i;
+	}
+	return -1;
+}
+
+const char* overloads_name(Overloads overloads, int set) {
+	return overloads->sets[set].name;
+}
+
+const SymbolId* overloads_candidates(Overloads overloads, int set, int* count) {
+	*count = arrlen(overloads->sets[set].candidates);
+	return overloads->sets[set].candidates;
+}
+
+// === Dispatch ===
+
+typedef struct {
+	uint64_t hash;
+	int set;           // -1 = free
+	int n_args;
+	int first_arg;     // in the cache's args
+	SymbolId chosen;
+} DispatchEntry;
+
+struct _dispatch_cache {
+	DispatchEntry* entries;  // open addressing
+	size_t mask, count;
+	TypeId ARRAY args;       // of every entry, one after the other
+	int hits;
+};
+
+static uint64_t hash_signature(int set, const TypeId* args, int n_args) {
+	uint64_t hash = (0xcbf29ce484222325 ^ (uint64_t) set) * 0x100000001b3;
+	for (int i = 0; i < n_args; i++) hash = (hash ^ args[i]) * 0x100000001b3;
+	return (hash ^ (uint64_t) n_args) * 0x100000001b3;
+}
+
+/// Where the signature's entry is, or the free one it would go in
+static DispatchEntry* find_entry(DispatchCache cache, uint64_t hash, int set, const TypeId* args, int n_args) {
+	for (size_t i = hash & cache->mask; ; i = (i + 1) & cache->mask) {
+		DispatchEntry* entry = &cache->entries[i];
+		if (entry->set < 0) return entry;
+		if (entry->hash == hash && entry->set == set && entry->n_args == n_args
+				&& (!n_args || memcmp(&cache->args[entry->first_arg], args, n_args * sizeof(TypeId)) == 0)) {
+			return entry;
+		}
+	}
+}
+
+static void allocate_entries(DispatchCache cache, size_t capacity) {
+	cache->entries = malloc(capacity * sizeof(DispatchEntry));
+	cache->mask = capacity - 1;
+	for (size_t i = 0; i < capacity; i++) cache->entries[i].set = -1;
+}
+
+DispatchCache dispatch_cache_create(void) {
+	DispatchCache cache = calloc(1, sizeof(struct _dispatch_cache));
+	allocate_entries(cache, 64);
+	return cache;
+}
+
+void dispatch_cache_destroy(DispatchCache cache) {
+	if (!cache) return;
+	free(cache->entries);
+	arrfree(cache->args);
+	free(cache);
+}
+
+bool dispatch_cache_get(DispatchCache cache, int set, const TypeId* args, int n_args, SymbolId* chosen) {
+	DispatchEntry* entry = find_entry(cache, hash_signature(set, args, n_args), set, args, n_args);
+	if (entry->set < 0) return false;
+	*chosen = entry->chosen;
+	cache->hits++;
+	return true;
+}
+
+void dispatch_cache_put(DispatchCache cache, int set, const TypeId* args, int n_args, SymbolId chosen) {
+	if ((cache->count + 1) * 2 > cache->mask + 1) {
+		DispatchEntry* old = cache->entries;
+		size_t n_old = cache->mask + 1;
+		allocate_entries(cache, n_old * 2);
+		for (size_t i = 0; i < n_old; i++) {
+			if (old[i].set < 0) continue;
+			size_t j = old[i].hash & cache->mask;
+			while (cache->entries[j].set >= 0) j = (j + 1) & cache->mask;
+			cache->entries[j] = old[i];
+		}
+		free(old);
+	}
+	uint64_t hash = hash_signature(set, args, n_args);
+	DispatchEntry* entry = find_entry(cache, hash, set, args, n_args);
+	if (entry->set < 0) {
+		*entry = (DispatchEntry) { hash, set, n_args, arrlen(cache->args), chosen };
+		if (n_args) memcpy(&cache->args[arraddn(cache->args, n_args)], args, n_args * sizeof(TypeId));
+		cache->count++;
+	}
+	else entry->chosen = chosen;
+}
+
+int dispatch_cache_hits(DispatchCache cache) {
+	return cache->hits;
+}
@@ -0,0 +1,41 @@
+#pragma once
+// Overload sets, and the cache of which of their functions a call with given argument
+// types resolves to
+#include <stdbool.h>
+
+#include "ast.h"
+#include "resolve.h"
+#include "types.h"
+
+typedef struct _overloads* Overloads;
+typedef struct _dispatch_cache* DispatchCache;
+
+/// Set on the argument type of a number literal, which can be passed as any number type it fits
+#define DISPATCH_LITERAL ((TypeId) 1 << 31)
+
+/// Collects the overload sets of a module: one for each '#overload', of the functions it
+/// lists, and one for each operator that functions are named after ('func + (a: V, b: V)'),
+/// which an '#overload' of the operator adds its functions to. Read-only once made.
+Overloads overloads_create(Resolution res);
+void overloads_destroy(Overloads overloads);
+
+int overloads_count(Overloads overloads);
+/// The set of an '#overload', or -1
+int overloads_of_symbol(Overloads overloads, SymbolId overload);
+/// The set of an operator, or -1 if no function overloads it
+int overloads_of_operator(Overloads overloads, const char* op);
+/// The name or operator of a set
+const char* overloads_name(Overloads overloads, int set);
+/// The functions of a set, in the order they are declared
+const SymbolId* overloads_candidates(Overloads overloads, int set, int* count);
+
+/// Not thread safe: each thread that resolves calls keeps its own
+DispatchCache dispatch_cache_create(void);
+void dispatch_cache_destroy(DispatchCache cache);
+
+/// What a call of the set with arguments of these types resolved to: a function, 0 for
+/// none, or -1 if it was ambiguous. False if it hasn't been resolved yet.
+bool dispatch_cache_get(DispatchCache cache, int set, const TypeId* args, int n_args, SymbolId* chosen);
+void dispatch_cache_put(DispatchCache cache, int set, const TypeId* args, int n_args, SymbolId chosen);
+/// Lookups that found what was put
+int dispatch_cache_hits(DispatchCache cache);
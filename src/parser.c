@@ -1,18 +1,35 @@
+#define _XOPEN_SOURCE 700
 
 #include <string.h>
 #include <stdio.h>
+#include <stdarg.h>
 #include <assert.h>
 
 #include "lexer.h"
 #include "parser.h"
+#include "ast_walk.h"
+#include "ast_intern.h"
 #include "stb_ds.h"
 #include "util.h"
 #include "colors.h"
 
+#ifdef PROFILE_PARSE
+#include <pthread.h>
+#endif
+
 #ifndef ARENA_SIZE
 #define ARENA_SIZE (16 * 1024)
 #endif
 
+// expression() and type() keep their nesting on explicit stacks, but a few rules still
+// re-enter each other through the C stack (blocks in expressions, expressions in types...)
+// Beyond this many, the items of one earlier parse are parsed again so that it can be freed
+#define MAX_RETIRED_GENERATIONS 8
+
+#ifndef MAX_RULE_DEPTH
+#define MAX_RULE_DEPTH 4096
+#endif
+
 bool RULE_DEBUG = 1;
 
 struct _parse_state {
@@ -21,27 +38,83 @@ struct _parse_state {
 	Lexer lex;
 	void** arenas;
 	void* arena_current;
+	// With node sharing: shareable nodes of the item being parsed stay in the scratch
+	// arenas until they are interned, and the slots they end up in get a location here
+	NodeInterner interner;
+	void** scratch_arenas;
+	void* scratch_current;
+	struct _location_table* locations;
 	int error_count;
 	int warning_count;
+	bool collect_diagnostics;
+	ParserDiagnostic* diagnostics;  // of the last parse, when collected instead of printed
+	struct _expr_frame* expr_stack;  // see rules/expr.h
+	struct _type_frame* type_stack;  // see rules/type.h
+	struct _packed_literal* packed;  // see rules/expr.h
+	int rule_depth;
+	// For parser_reparse: what each top-level item of the last good parse declared, and
+	// the lexers and arenas of earlier parses whose nodes are still in use
+	struct _parsed_item* items;
+	struct _parsed_decl* decls;  // of all the items, in order
+	struct _parser_generation* retired;
+	int generation, module_generation;
+	int stale_generation;  // whose items aren't reused, or -1
+	AST_Module* module;
+	bool item_reads_files;  // set by #read, whose result can't be reused
+#ifdef PROFILE_PARSE
+	struct _parse_profile* profile;
+	uint64_t nodes_created, bytes_allocated;
+#endif
 };
 
-Parser parser_create(const char* filename) {
+#ifdef PROFILE_PARSE
+static struct _parse_profile* profile_create(void);
+static void profile_merge(struct _parse_profile* profile);
+#endif
+
+static Parser parser_init(const char* filename, Lexer lex) {
 	char* src = malloc(strlen(filename) + 1);
 	strcpy(src, filename);
-	Lexer lex = lexer_create(src);
-	if (!lex) {
-		free(src);
-		return 0;
-	}
 	Parser self = calloc(1, sizeof(struct _parse_state));
-	self->filename = filename;
+	self->filename = src;
 	self->src = src;
 	self->lex = lex;
+#ifdef PROFILE_PARSE
+	self->profile = profile_create();
+#endif
 	return self;
 }
 
-void parser_destroy(Parser self) {
+Parser parser_create(const char* filename) {
+	Lexer lex = lexer_create(filename);
+	return lex? parser_init(filename, lex) : 0;
+}
+
+Parser parser_create_from_memory(const char* name, const char* text, size_t length) {
+	Lexer lex = lexer_create_from_memory(text, length);
+	return lex? parser_init(name, lex) : 0;
+}
+
+static void free_parse_results(Parser self);
+static void clear_diagnostics(Parser self);
+static void packed_literal_destroy(struct _packed_literal* packed);
 
+void parser_destroy(Parser self) {
+	arrfree(self->expr_stack);
+	arrfree(self->type_stack);
+	packed_literal_destroy(self->packed);
+	clear_diagnostics(self);
+	arrfree(self->diagnostics);
+	free_parse_results(self);
+	for (int i = 0; i < arrlen(self->scratch_arenas); i++) free(self->scratch_arenas[i]);
+	arrfree(self->scratch_arenas);
+	node_interner_destroy(self->interner);
+#ifdef PROFILE_PARSE
+	profile_merge(self->profile);
+	self->profile = NULL;
+#endif
+	free((char*) self->src);
+	free(self);
 }
 
 static size_t size_table[] = {
@@ -54,24 +127,38 @@ static size_t size_table[] = {
     0
 };
 
-static inline void* arena_alloc(Parser self, size_t n_bytes) {
-	if (!self->arena_current || self->arena_current - arrlast(self->arenas) + n_bytes > ARENA_SIZE) {
-		self->arena_current = calloc(ARENA_SIZE, 1);  // ensure all nodes from this arena are zeroed out
-		assert(self->arena_current && "Unable to allocate next block of arena!!!");
-		arrpush(self->arenas, self->arena_current);
-	}
-	void* result = self->arena_current;
-	self->arena_current = (void*) (
-		((char*) self->arena_current)
+static inline void* arena_alloc_from(Parser self, void*** arenas, void** current, size_t n_bytes) {
+	if (!*current || *current - arrlast(*arenas) + n_bytes > ARENA_SIZE) {
+		*current = calloc(ARENA_SIZE, 1);  // ensure all nodes from this arena are zeroed out
+		assert(*current && "Unable to allocate next block of arena!!!");
+		arrpush(*arenas, *current);
+	}
+	void* result = *current;
+#ifdef PROFILE_PARSE
+	self->bytes_allocated += n_bytes;
+#else
+	(void) self;
+#endif
+	*current = (void*) (
+		((char*) *current)
 		// align the next node for pointers (assuming pointers have 2^n size)
 		+ ((n_bytes & (sizeof(void*) - 1))? (n_bytes | (sizeof(void*) - 1)) + 1 : n_bytes)
 	);
 	return result;
 }
 
+static inline void* arena_alloc(Parser self, size_t n_bytes) {
+	return arena_alloc_from(self, &self->arenas, &self->arena_current, n_bytes);
+}
+
 static AST_Node* node_create(Parser self, NodeType type) {
 	if (type >= NODE_MAX || type <= NODE_EMPTY) return 0;
-	AST_Node* node = arena_alloc(self, size_table[type]);
+	AST_Node* node = self->interner && node_type_is_shareable(type)
+		? arena_alloc_from(self, &self->scratch_arenas, &self->scratch_current, size_table[type])
+		: arena_alloc(self, size_table[type]);
+#ifdef PROFILE_PARSE
+	self->nodes_created++;
+#endif
 	node->node_type = type;
 	node->src_file = self->src;
 	return node;
@@ -102,14 +189,51 @@ static AST_Node* node_create(Parser self, NodeType type) {
 		N->start_col = (B)->start_col; \
 	} while (0)
 
+void parser_collect_diagnostics(Parser self, bool collect) {
+	self->collect_diagnostics = collect;
+}
+
+const ParserDiagnostic* parser_diagnostics(Parser self, int* count) {
+	*count = arrlen(self->diagnostics);
+	return self->diagnostics;
+}
+
+static void clear_diagnostics(Parser self) {
+	for (int i = 0; i < arrlen(self->diagnostics); i++) free(self->diagnostics[i].message);
+	if (self->diagnostics) stbds_header(self->diagnostics)->length = 0;
+}
+
+static void collect_diagnostic(Parser self, unsigned int l0, unsigned int c0, unsigned int l1, unsigned int c1,
+		const char* kind, const char* fmt, ...) {
+	va_list args;
+	va_start(args, fmt);
+	int length = vsnprintf(NULL, 0, fmt, args);
+	va_end(args);
+	char* message = malloc(length + 1);
+	va_start(args, fmt);
+	vsnprintf(message, length + 1, fmt, args);
+	va_end(args);
+	ParserDiagnostic diagnostic = {
+		strstr(kind, "warning")? DIAGNOSTIC_WARNING : strstr(kind, "note")? DIAGNOSTIC_NOTE : DIAGNOSTIC_ERROR,
+		l0, c0, l1, c1, kind, message,
+	};
+	arrpush(self->diagnostics, diagnostic);
+}
+
 #define OUTPUT_ERROR(l0, c0, l1, c1, err_type, fmt, ...) do { \
+	if (self->collect_diagnostics) { \
+		collect_diagnostic(self, (l0), (c0), (l1), (c1), err_type, fmt, ##__VA_ARGS__); \
+		break; \
+	} \
 	const char* _line_ = lexer_get_lines(self->lex, 0)[(l0) - 1]; \
+	flockfile(stderr);  /* modules may be parsed in parallel */ \
 	if (RULE_DEBUG) fprintf(stderr, "(Emitted from rule '%s' @ %s:%d)\n", __func__, strrchr(__FILE__, '/') + 1, __LINE__); \
 	fprintf(stderr, "In '%s' at line %d, column %d...\n  ", self->src, (l0), (c0)); \
 	fprintf(stderr, err_type ": " fmt "\n", ##__VA_ARGS__);\
 	show_error_line(stderr, \
 		_line_, (l0), (c0), \
 		((l1) > (l0))? strlen(_line_) : (c1)); \
+	funlockfile(stderr); \
 } while (0)
 
 #define SYNTAX_WARNING(fmt, ...) do { \
@@ -187,35 +311,1030 @@ static AST_Node* node_create(Parser self, NodeType type) {
 	return N; \
 } while (0)
 
+// For rules that can reach themselves again through other rules; the depth is given back on return
+static inline void leave_nested(Parser* parser) {
+	(*parser)->rule_depth--;
+}
+
+#define ENTER_NESTED() \
+	if (self->rule_depth >= MAX_RULE_DEPTH) SYNTAX_ERROR("Nesting is too deep here (limit is %d)", MAX_RULE_DEPTH); \
+	Parser _nested_ __attribute__((cleanup(leave_nested))) = (self->rule_depth++, self)
+
 // Disable warnings about switches using values from other enums
 #pragma GCC diagnostic ignored "-Wswitch"
 
 #include "rule_prototypes.gen.h"
 
+// === Rule profiling ===
+// With PROFILE_PARSE defined, every rule records how often it ran and what it cost.
+// Everything a rule spends outside of nested rules is its "self" cost; inclusive
+// cycles only count the outermost activation, so recursion isn't counted twice.
+// Without PROFILE_PARSE, PROFILE_RULE expands to nothing.
+
+#ifdef PROFILE_PARSE
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PROFILE_CLOCK() __rdtsc()
+#define PROFILE_CLOCK_UNIT "cycles"
+#else
+#include <time.h>
+static uint64_t profile_clock(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+#define PROFILE_CLOCK() profile_clock()
+#define PROFILE_CLOCK_UNIT "ns"
+#endif
+
+typedef struct {
+	uint64_t cycles, tokens, nodes, bytes;
+} ProfileCounters;
+
+typedef struct {
+	uint64_t calls;
+	uint64_t inclusive_cycles;
+	ProfileCounters self;
+	int active;  // activations currently on the stack
+} RuleStats;
+
+struct _parse_profile {
+	RuleStats rules[RULE_COUNT];
+	ProfileCounters nested;  // spent in rules nested inside the current one so far
+};
+
+typedef struct {
+	Parser parser;
+	int rule;
+	ProfileCounters start;
+	ProfileCounters outer_nested;
+} RuleFrame;
+
+static struct _parse_profile profile_totals;
+static pthread_mutex_t profile_totals_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static struct _parse_profile* profile_create(void) {
+	return calloc(1, sizeof(struct _parse_profile));
+}
+
+static void profile_merge(struct _parse_profile* profile) {
+	if (!profile) return;
+	pthread_mutex_lock(&profile_totals_lock);
+	for (int i = 0; i < RULE_COUNT; i++) {
+		RuleStats* total = &profile_totals.rules[i];
+		const RuleStats* rule = &profile->rules[i];
+		total->calls += rule->calls;
+		total->inclusive_cycles += rule->inclusive_cycles;
+		total->self.cycles += rule->self.cycles;
+		total->self.tokens += rule->self.tokens;
+		total->self.nodes += rule->self.nodes;
+		total->self.bytes += rule->self.bytes;
+	}
+	pthread_mutex_unlock(&profile_totals_lock);
+	free(profile);
+}
+
+static inline ProfileCounters profile_now(Parser self) {
+	return (ProfileCounters) {
+		.cycles = PROFILE_CLOCK(),
+		.tokens = lexer_tokens_consumed(self->lex),
+		.nodes = self->nodes_created,
+		.bytes = self->bytes_allocated,
+	};
+}
+
+static inline RuleFrame profile_rule_enter(Parser self, int rule) {
+	struct _parse_profile* profile = self->profile;
+	RuleFrame frame = { self, rule, {0}, profile->nested };
+	profile->rules[rule].calls++;
+	profile->rules[rule].active++;
+	profile->nested = (ProfileCounters) {0};
+	frame.start = profile_now(self);
+	return frame;
+}
+
+static inline void profile_rule_exit(RuleFrame* frame) {
+	Parser self = frame->parser;
+	ProfileCounters now = profile_now(self);
+	struct _parse_profile* profile = self->profile;
+	RuleStats* stats = &profile->rules[frame->rule];
+	ProfileCounters spent = {
+		now.cycles - frame->start.cycles,
+		now.tokens - frame->start.tokens,
+		now.nodes - frame->start.nodes,
+		now.bytes - frame->start.bytes,
+	};
+	stats->self.cycles += spent.cycles - profile->nested.cycles;
+	stats->self.tokens += spent.tokens - profile->nested.tokens;
+	stats->self.nodes += spent.nodes - profile->nested.nodes;
+	stats->self.bytes += spent.bytes - profile->nested.bytes;
+	if (--stats->active == 0) stats->inclusive_cycles += spent.cycles;
+	profile->nested = (ProfileCounters) {
+		frame->outer_nested.cycles + spent.cycles,
+		frame->outer_nested.tokens + spent.tokens,
+		frame->outer_nested.nodes + spent.nodes,
+		frame->outer_nested.bytes + spent.bytes,
+	};
+}
+
+#define PROFILE_RULE(NAME) \
+	RuleFrame _rule_frame_ __attribute__((cleanup(profile_rule_exit))) = profile_rule_enter(self, RULE_ID_##NAME)
+
+static int compare_self_cycles(const void* a, const void* b) {
+	uint64_t x = profile_totals.rules[*(const int*) a].self.cycles;
+	uint64_t y = profile_totals.rules[*(const int*) b].self.cycles;
+	return (x < y) - (x > y);
+}
+
+bool parser_profile_report(FILE* stream) {
+	pthread_mutex_lock(&profile_totals_lock);
+	int order[RULE_COUNT];
+	ProfileCounters total = {0};
+	for (int i = 0; i < RULE_COUNT; i++) {
+		order[i] = i;
+		total.cycles += profile_totals.rules[i].self.cycles;
+		total.tokens += profile_totals.rules[i].self.tokens;
+		total.nodes += profile_totals.rules[i].self.nodes;
+		total.bytes += profile_totals.rules[i].self.bytes;
+	}
+	qsort(order, RULE_COUNT, sizeof(int), compare_self_cycles);
+
+	fprintf(stream, "%-20s %10s %14s %14s %6s %10s %10s %12s\n",
+		"rule", "calls", "incl " PROFILE_CLOCK_UNIT, "self " PROFILE_CLOCK_UNIT, "self%",
+		"tokens", "nodes", "bytes");
+	for (int i = 0; i < RULE_COUNT; i++) {
+		const RuleStats* rule = &profile_totals.rules[order[i]];
+		if (!rule->calls) continue;
+		fprintf(stream, "%-20s %10llu %14llu %14llu %5.1f%% %10llu %10llu %12llu\n",
+			RULE_NAMES[order[i]],
+			(unsigned long long) rule->calls,
+			(unsigned long long) rule->inclusive_cycles,
+			(unsigned long long) rule->self.cycles,
+			total.cycles? 100.0 * rule->self.cycles / total.cycles : 0.0,
+			(unsigned long long) rule->self.tokens,
+			(unsigned long long) rule->self.nodes,
+			(unsigned long long) rule->self.bytes);
+	}
+	fprintf(stream, "%-20s %10s %14s %14llu %6s %10llu %10llu %12llu\n",
+		"total", "", "",
+		(unsigned long long) total.cycles, "",
+		(unsigned long long) total.tokens,
+		(unsigned long long) total.nodes,
+		(unsigned long long) total.bytes);
+	pthread_mutex_unlock(&profile_totals_lock);
+	return true;
+}
+
+#else
+
+#define PROFILE_RULE(NAME) ((void) 0)
+
+bool parser_profile_report(FILE* stream) {
+	(void) stream;
+	return false;
+}
+
+#endif
+
 #include "rules/atoms.h"
 #include "rules/expr.h"
 #include "rules/type.h"
 #include "rules/statements.h"
 #include "rules/toplevel.h"
 
-AST_Node* parser_execute(Parser self) {
+// === Shared nodes ===
+// With sharing on, nodes of shareable types are created in the scratch arenas. Once an
+// item has parsed, its tree is walked bottom-up: scratch nodes with shared children are
+// replaced by their shared equivalent, the others by a copy in the regular arenas, and
+// the scratch arenas are rewound for the next item. Duplicates therefore never take
+// up space, and nothing outside of the interner points into the scratch arenas for long.
+
+typedef struct {
+	AST_Node** slot;  // holding a shared node
+	NodeLocation location;
+	uint32_t order;   // ties between entries for the same slot go to the one recorded last
+} LocationEntry;
+
+// One per generation, for the slots in its nodes. Entries are appended while parsing, and
+// only sorted by slot once something looks one up, which a plain compile never does.
+typedef struct _location_table {
+	LocationEntry ARRAY entries;
+	int n_sorted;
+} LocationTable;
+
+void parser_share_nodes(Parser self, bool share) {
+	if (share && !self->interner) self->interner = node_interner_create();
+}
+
+static void scratch_rewind(Parser self) {
+	int n = arrlen(self->scratch_arenas);
+	if (!n) return;
+	for (int i = 1; i < n; i++) free(self->scratch_arenas[i]);
+	char* first = self->scratch_arenas[0];
+	size_t used = n > 1? ARENA_SIZE : (size_t) ((char*) self->scratch_current - first);
+	memset(first, 0, used);
+	arrsetlen(self->scratch_arenas, 1);
+	self->scratch_current = first;
+}
+
+static bool in_scratch(Parser self, const AST_Node* node) {
+	for (int i = 0; i < arrlen(self->scratch_arenas); i++) {
+		const char* arena = self->scratch_arenas[i];
+		if ((const char*) node >= arena && (const char*) node < arena + ARENA_SIZE) return true;
+	}
+	return false;
+}
+
+static void put_location(LocationTable** table, AST_Node** slot, NodeLocation location) {
+	if (!*table) *table = calloc(1, sizeof(LocationTable));
+	LocationEntry entry = { slot, location, arrlen((*table)->entries) };
+	arrpush((*table)->entries, entry);
+}
+
+static int compare_locations(const void* a, const void* b) {
+	const LocationEntry* x = a;
+	const LocationEntry* y = b;
+	if (x->slot != y->slot) return (uintptr_t) x->slot < (uintptr_t) y->slot? -1 : 1;
+	return (x->order > y->order) - (x->order < y->order);
+}
+
+static LocationEntry* find_location(LocationTable* table, AST_Node* const* slot) {
+	if (!table) return NULL;
+	int n = arrlen(table->entries);
+	if (table->n_sorted != n) {
+		for (int i = 0; i < n; i++) table->entries[i].order = i;
+		qsort(table->entries, n, sizeof(LocationEntry), compare_locations);
+		int kept = 0;
+		for (int i = 0; i < n; i++) {
+			if (i + 1 < n && table->entries[i + 1].slot == table->entries[i].slot) continue;
+			table->entries[kept++] = table->entries[i];
+		}
+		arrsetlen(table->entries, kept);
+		table->n_sorted = n = kept;
+	}
+	int lo = 0, hi = n;
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		if ((uintptr_t) table->entries[mid].slot < (uintptr_t) slot) lo = mid + 1;
+		else hi = mid;
+	}
+	return lo < n && table->entries[lo].slot == slot? &table->entries[lo] : NULL;
+}
+
+static void free_locations(LocationTable* table) {
+	if (!table) return;
+	arrfree(table->entries);
+	free(table);
+}
+
+// Once replaced, a scratch node becomes a forwarding record for the slots still holding it
+// (the fields of a field list share their type). It keeps its location fields.
+typedef struct {
+	NodeType node_type;  // NODE_EMPTY
+	AST_Node* moved_to;  // over src_file
+} MovedNode;
+
+typedef struct {
+	AST_Node** slot;
+	NodeLocation location;
+} PendingLocation;
+
+// A shared node's location is only worth keeping when its parent isn't shared as well,
+// which isn't known until the parent is done: until then it waits in `pending`
+typedef struct {
+	Parser parser;
+	int ARRAY marks;  // per node being walked: length of `pending` when a scratch node was entered, or -1
+	PendingLocation ARRAY pending;
+} ShareState;
+
+static void record_location(ShareState* state, AST_Node** slot, const AST_Node* node) {
+	NodeLocation location = { node->start_line, node->start_col, node->end_line, node->end_col };
+	if (arrlen(state->marks) && arrlast(state->marks) >= 0) {
+		arrpush(state->pending, ((PendingLocation) { slot, location }));
+	}
+	else put_location(&state->parser->locations, slot, location);
+}
+
+static WalkAction share_pre(AST_Node** slot, void* ctx) {
+	ShareState* state = ctx;
+	AST_Node* node = *slot;
+	if (ast_is_shared(node) || !in_scratch(state->parser, node)) {
+		arrpush(state->marks, -1);
+		return ast_is_shared(node)? WALK_SKIP : WALK_CONTINUE;
+	}
+	if (node->node_type == NODE_EMPTY) {
+		AST_Node* moved_to = ((MovedNode*) node)->moved_to;
+		if (ast_is_shared(moved_to)) record_location(state, slot, node);
+		*slot = moved_to;
+		arrpush(state->marks, -1);
+		return WALK_SKIP;
+	}
+	arrpush(state->marks, arrlen(state->pending));
+	return WALK_CONTINUE;
+}
+
+static WalkAction share_post(AST_Node** slot, void* ctx) {
+	ShareState* state = ctx;
+	Parser self = state->parser;
+	AST_Node* node = *slot;
+	int mark = arrpop(state->marks);
+	if (mark < 0) return WALK_CONTINUE;
+	// Whatever is pending past the mark belongs to the node's direct children
+	AST_Node* moved;
+	if (node_children_are_shared(node)) {
+		arrsetlen(state->pending, mark);
+		moved = node_interner_intern(self->interner, node);
+		record_location(state, slot, node);
+	}
+	else {
+		// Depends on something location-dependent, like the expression in `[n]Int`
+		size_t size = size_table[node->node_type];
+		moved = arena_alloc(self, size);
+		memcpy(moved, node, size);
+		for (int i = mark; i < arrlen(state->pending); i++) {
+			char* child_slot = (char*) state->pending[i].slot;
+			if (child_slot >= (char*) node && child_slot < (char*) node + size) {
+				child_slot = (char*) moved + (child_slot - (char*) node);
+			}
+			put_location(&self->locations, (AST_Node**) child_slot, state->pending[i].location);
+		}
+		arrsetlen(state->pending, mark);
+	}
+	node->node_type = NODE_EMPTY;
+	((MovedNode*) node)->moved_to = moved;
+	*slot = moved;
+	return WALK_CONTINUE;
+}
+
+/// Moves the nodes of the item just parsed out of the scratch arenas
+static void share_item_nodes(Parser self, AST_Module* module, int first_decl, int first_test) {
+	ShareState state = { self, NULL, NULL };
+	AST_Visitor visitor = { share_pre, share_post, &state };
+	for (int i = first_decl; i < shlen(module->scope); i++) {
+		ast_walk_iterative(&module->scope[i].value, &visitor);
+	}
+	for (int i = first_test; i < arrlen(module->tests); i++) {
+		ast_walk_iterative((AST_Node**) &module->tests[i], &visitor);
+	}
+	arrfree(state.marks);
+	arrfree(state.pending);
+	scratch_rewind(self);
+}
+
+// === Top-level items ===
+// Every parse records, for each top-level item that parsed cleanly, where it is, a
+// fingerprint of its tokens, and what it declared. parser_reparse compares the new text
+// with the old one line by line; items outside of the lines that changed are spliced in
+// without being lexed, and items inside them are parsed, but keep their old nodes if
+// their tokens turn out to be the same as those of an old item.
+
+typedef struct _parsed_decl {
+	const char* key;  // NULL for tests; points into the module's scope
+	AST_Node* value;
+} ParsedDecl;
+
+typedef struct _parsed_item {
+	uint64_t fingerprint;  // 0 = never the same as another item
+	unsigned int start_line, start_col;
+	unsigned int end_line;  // of the end-of-line that ends the item; 0 if it ended otherwise
+	int generation;  // of the lexer and arenas that hold the item's nodes
+	int line_shift;  // how far the item moved since its nodes' lines were brought up to date (parser_settle_lines)
+	int first_decl, n_decls;  // in the decls of the parse, which are kept together to be read in order
+	int scope_index, test_index;  // for items parsed in this parse: where their decls start in the module
+} ParsedItem;
+
+// Names declared by the items parsed (rather than reused) in a parse; the names of reused
+// items are all different, being those of a parse that succeeded, so only these can clash
+typedef struct {
+	const char* key;  // points into the module's scope
+	bool value;
+} ParsedName;
+
+typedef struct _parser_generation {
+	int id;
+	Lexer lex;
+	void** arenas;
+	LocationTable* locations;
+} ParserGeneration;
+
+// Lines [start, old_end) of the old text are lines [start, new_end) of the new one;
+// the lines before are the same, and so are the lines after, moved by new_end - old_end
+typedef struct {
+	unsigned int start, old_end, new_end, new_lines;
+} ChangedLines;
+
+static void free_generation(ParserGeneration* gen) {
+	lexer_destroy(gen->lex);
+	for (int i = 0; i < arrlen(gen->arenas); i++) free(gen->arenas[i]);
+	arrfree(gen->arenas);
+	free_locations(gen->locations);
+}
+
+/// Frees what the nodes of an item own; only for items whose nodes are used by nothing else
+static void free_item_nodes(const ParsedItem* item, ParsedDecl ARRAY decls) {
+	for (int i = 0; i < item->n_decls; i++) ast_free_owned(&decls[item->first_decl + i].value);
+}
+
+static void free_parse_results(Parser self) {
+	if (self->module) ast_free_owned((AST_Node**) &self->module);
+	arrfree(self->items);
+	arrfree(self->decls);
+	for (int i = 0; i < arrlen(self->retired); i++) free_generation(&self->retired[i]);
+	arrfree(self->retired);
+	ParserGeneration current = { self->generation, self->lex, self->arenas, self->locations };
+	free_generation(&current);
+	self->module = NULL;
+	self->items = NULL;
+	self->decls = NULL;
+	self->lex = NULL;
+	self->arenas = NULL;
+	self->locations = NULL;
+}
+
+static size_t generation_memory_usage(const ParserGeneration* gen) {
+	return lexer_memory_usage(gen->lex) + arrlen(gen->arenas) * ARENA_SIZE
+		+ (gen->locations? arrcap(gen->locations->entries) * sizeof(LocationEntry) : 0);
+}
+
+size_t parser_memory_usage(Parser self) {
+	ParserGeneration current = { self->generation, self->lex, self->arenas, self->locations };
+	size_t total = sizeof(struct _parse_state) + generation_memory_usage(&current)
+		+ arrlen(self->scratch_arenas) * ARENA_SIZE;
+	for (int i = 0; i < arrlen(self->retired); i++) total += generation_memory_usage(&self->retired[i]);
+	if (self->interner) total += node_interner_memory_usage(self->interner);
+	return total;
+}
+
+/// The location table of the generation whose arenas hold an item's nodes
+static LocationTable* generation_locations(Parser self, int id) {
+	for (int i = 0; i < arrlen(self->retired); i++) {
+		if (self->retired[i].id == id) return self->retired[i].locations;
+	}
+	return self->locations;
+}
+
+NodeLocation parser_node_location(Parser self, AST_Node* const* slot) {
+	const AST_Node* node = *slot;
+	if (!ast_is_shared(node)) return (NodeLocation) { node->start_line, node->start_col, node->end_line, node->end_col };
+	// A slot can have been recorded by an earlier generation, before its memory was reused
+	LocationEntry* found = find_location(self->locations, slot);
+	int found_id = self->generation;
+	for (int i = 0; i < arrlen(self->retired); i++) {
+		if (found && self->retired[i].id < found_id) continue;
+		LocationEntry* entry = find_location(self->retired[i].locations, slot);
+		if (entry) {
+			found = entry;
+			found_id = self->retired[i].id;
+		}
+	}
+	return found? found->location : (NodeLocation) {0};
+}
+
+static bool is_generated_key(const char* key) {
+	return key[0] == '<';  // <import_N>, for imports with 'using' and no name, <run_N>, <warn_N> and <op_N>
+}
+
+// Nodes can be shared (e.g. by the fields of a field list), so a walk may reach them twice.
+// They are only ever shared within an item, so the set is cleared between items, which
+// only takes a new stamp: slots with an older one count as empty.
+typedef struct {
+	struct { AST_Node* node; unsigned int stamp; }* slots;  // open addressing
+	size_t mask, count;
+	unsigned int stamp;
+} NodeSet;
+
+/// Returns false if the node was in the set already
+static bool node_set_add(NodeSet* set, AST_Node* node) {
+	if (2 * (set->count + 1) > set->mask) {
+		NodeSet bigger = { calloc(2 * (set->mask + 1), sizeof(*set->slots)), 2 * set->mask + 1, 0, 1 };
+		for (size_t i = 0; set->count && i <= set->mask; i++) {
+			if (set->slots[i].stamp == set->stamp) node_set_add(&bigger, set->slots[i].node);
+		}
+		free(set->slots);
+		*set = bigger;
+	}
+	size_t i = ((uintptr_t) node >> 3) * 0x9E3779B97F4A7C15ull >> 20;
+	for (i &= set->mask; set->slots[i].stamp == set->stamp; i = (i + 1) & set->mask) {
+		if (set->slots[i].node == node) return false;
+	}
+	set->slots[i].node = node;
+	set->slots[i].stamp = set->stamp;
+	set->count++;
+	return true;
+}
+
+static void node_set_clear(NodeSet* set) {
+	set->count = 0;
+	if (++set->stamp) return;
+	// The stamps wrapped around: clear for real
+	if (set->slots) memset(set->slots, 0, (set->mask + 1) * sizeof(*set->slots));
+	set->stamp = 1;
+}
+
+typedef struct {
+	int delta;
+	NodeSet seen;
+	LocationTable* locations;  // of the generation the item's nodes are from
+} LineShift;
+
+/// Moves the node in the slot; returns false if its children aren't to be moved with it
+static bool shift_node_lines(AST_Node** slot, LineShift* shift) {
+	AST_Node* node = *slot;
+	if (ast_is_shared(node)) {
+		// It's the occurrence that moves, not the node
+		LocationEntry* entry = find_location(shift->locations, slot);
+		if (entry && entry->location.start_line) entry->location.start_line += shift->delta;
+		if (entry && entry->location.end_line) entry->location.end_line += shift->delta;
+		return false;
+	}
+	if (!node_set_add(&shift->seen, node)) return false;
+	if (node->start_line) node->start_line += shift->delta;
+	if (node->end_line) node->end_line += shift->delta;
+	return true;
+}
+
+/// Moves every node of the tree. The order doesn't matter, so a plain stack of slots does
+/// instead of ast_walk_iterative: this runs over everything after a line added or removed.
+static void shift_tree(AST_Node** root, LineShift* shift, AST_Node** ARRAY* stack) {
+	if (*root) arrput(*stack, root);
+	while (arrlen(*stack)) {
+		AST_Node** slot = arrpop(*stack);
+		AST_Node* node = *slot;
+		if (!shift_node_lines(slot, shift) || (unsigned) node->node_type >= NODE_MAX) continue;
+		const AST_NodeLayout* layout = &AST_LAYOUT[node->node_type];
+		for (int i = 0; i < layout->n_fields; i++) {
+			char* at = (char*) node + layout->fields[i].offset;
+			switch (layout->fields[i].kind) {
+				case AST_CHILD_NODE:
+					if (*(AST_Node**) at) arrput(*stack, (AST_Node**) at);
+					break;
+				case AST_CHILD_ARRAY: {
+					AST_Node** children = *(AST_Node***) at;
+					for (int j = 0; j < arrlen(children); j++) {
+						if (children[j]) arrput(*stack, &children[j]);
+					}
+				} break;
+				case AST_CHILD_MAP: {
+					ASTMAP_NodeEntry* entries = *(ASTMAP_NodeEntry**) at;
+					for (int j = 0; j < shlen(entries); j++) {
+						if (entries[j].value) arrput(*stack, &entries[j].value);
+					}
+				} break;
+				default: break;
+			}
+		}
+	}
+}
+
+/// Moves the nodes of the given items by their line_shift
+static void shift_items(Parser self, ParsedItem ARRAY items, ParsedDecl ARRAY decls) {
+	int i = 0;
+	while (i < arrlen(items) && !items[i].line_shift) i++;
+	if (i == arrlen(items)) return;
+	LineShift shift = { 0, { NULL, 0, 0, 1 }, NULL };
+	AST_Node** ARRAY stack = NULL;
+	for (; i < arrlen(items); i++) {
+		shift.delta = items[i].line_shift;
+		items[i].line_shift = 0;
+		if (!shift.delta) continue;
+		shift.locations = generation_locations(self, items[i].generation);
+		node_set_clear(&shift.seen);
+		for (int j = 0; j < items[i].n_decls; j++) {
+			shift_tree(&decls[items[i].first_decl + j].value, &shift, &stack);
+		}
+	}
+	arrfree(stack);
+	free(shift.seen.slots);
+}
+
+/// Parses the top-level item at the current token, and records it if it parsed without errors
+static void parse_item(Parser self, AST_Module* module, ParsedItem ARRAY* items, ParsedDecl ARRAY* decls) {
+	unsigned int start_line = TOP().start_line, start_col = TOP().start_col;
+	int errors = self->error_count;
+	int n_decls = shlen(module->scope), n_tests = arrlen(module->tests);
+	self->item_reads_files = false;
+	lexer_fingerprint_reset(self->lex, start_line);
+	if (self->interner) scratch_rewind(self);  // whatever a failed item left there is garbage
+	if (!toplevel_item(self, module)) lexer_seek_toplevel(self->lex);
+	if (self->error_count > errors) return;
+	if (self->interner) share_item_nodes(self, module, n_decls, n_tests);
+	// Some items leave their end-of-line to the next one; it's part of this one as far as reuse goes
+	if (LOOKAHEAD(-1).type != TOK_EOL && TOP().type == TOK_EOL) POP();
+
+	ParsedItem item = {
+		.fingerprint = self->item_reads_files? 0 : lexer_fingerprint(self->lex),
+		.start_line = start_line,
+		.start_col = start_col,
+		.end_line = LOOKAHEAD(-1).type == TOK_EOL? LOOKAHEAD(-1).start_line : 0,
+		.generation = self->generation,
+		.first_decl = arrlen(*decls),
+		.n_decls = shlen(module->scope) - n_decls + arrlen(module->tests) - n_tests,
+		.scope_index = n_decls,
+		.test_index = n_tests,
+	};
+	for (int i = n_decls; i < shlen(module->scope); i++) {
+		ParsedDecl decl = { module->scope[i].key, module->scope[i].value };
+		arrpush(*decls, decl);
+	}
+	for (int i = n_tests; i < arrlen(module->tests); i++) {
+		ParsedDecl decl = { NULL, (AST_Node*) module->tests[i] };
+		arrpush(*decls, decl);
+	}
+	arrpush(*items, item);
+}
+
+/// Splices in an item of the last good parse at the current token, if nothing it declares
+/// is declared already. The lexer continues after it without looking at what's in between.
+static bool reuse_item(Parser self, AST_Module* module, const ParsedItem* old, int line_shift,
+		ParsedName MAP parsed_names, ParsedItem ARRAY* items, ParsedDecl ARRAY* decls) {
+	if (old->generation == self->stale_generation) return false;
+	const ParsedDecl* old_decls = &self->decls[old->first_decl];
+	for (int i = 0; parsed_names && i < old->n_decls; i++) {
+		const char* key = old_decls[i].key;
+		if (key && !is_generated_key(key) && shgeti(parsed_names, key) >= 0) return false;
+	}
+	if (!lexer_skip_to_line(self->lex, old->end_line + line_shift + 1)) return false;
+
+	ParsedItem item = *old;
+	item.start_line += line_shift;
+	item.end_line += line_shift;
+	item.line_shift += line_shift;
+	item.first_decl = arrlen(*decls);
+	for (int i = 0; i < old->n_decls; i++) {
+		ParsedDecl decl = old_decls[i];
+		if (!decl.key) {
+			arrpush(module->tests, (AST_Test*) decl.value);
+		}
+		else {
+			if (is_generated_key(decl.key)) {
+				char namebuf[32];
+				const char* kind;
+				switch (decl.value->node_type) {
+					case NODE_RUN: kind = "run"; break;
+					case NODE_WARN: kind = "warn"; break;
+					case NODE_FUNC_DEF: kind = "op"; break;
+					default: kind = "import";
+				}
+				snprintf(namebuf, sizeof(namebuf), "<%s_%d>", kind, (int) shlen(module->scope));
+				shput(module->scope, namebuf, decl.value);
+			}
+			else shput(module->scope, decl.key, decl.value);
+			decl.key = module->scope[shlen(module->scope) - 1].key;  // the old scope goes
+		}
+		arrpush(*decls, decl);
+	}
+	arrpush(*items, item);
+	return true;
+}
+
+/// Has a parsed item keep the nodes of an old item with the same tokens instead
+static void keep_old_nodes(AST_Module* module, ParsedItem* item, ParsedDecl* decls,
+		const ParsedItem* old, const ParsedDecl* old_decls) {
+	int scope_index = item->scope_index, test_index = item->test_index;
+	for (int i = 0; i < item->n_decls; i++) {
+		ast_free_owned(&decls[i].value);
+		AST_Node* value = old_decls[i].value;
+		if (decls[i].key) module->scope[scope_index++].value = value;
+		else module->tests[test_index++] = (AST_Test*) value;
+		decls[i].value = value;
+	}
+	item->generation = old->generation;
+	item->line_shift = old->line_shift + (int) item->start_line - (int) old->start_line;
+}
+
+static bool same_decls(const ParsedItem* a, const ParsedDecl* a_decls, const ParsedItem* b, const ParsedDecl* b_decls) {
+	if (a->n_decls != b->n_decls) return false;
+	for (int i = 0; i < a->n_decls; i++) {
+		if (!a_decls[i].key != !b_decls[i].key) return false;
+	}
+	return true;
+}
+
+/// Whether an old item lies on lines before the changed ones, or after them, and can be
+/// spliced in there
+static bool is_unchanged(const ParsedItem* old, const ChangedLines* changed, bool before) {
+	if (!old->end_line) return false;
+	if (before) return old->end_line < changed->start && old->end_line < changed->new_lines;
+	return old->start_line >= changed->old_end;
+}
+
+/// Has the items that were parsed after all keep the nodes of old items that weren't reused,
+/// if their tokens are the same (moved, or edited back)
+static void keep_moved_items(Parser self, AST_Module* module, ParsedItem ARRAY items, ParsedDecl ARRAY decls,
+		bool* reused) {
+	struct { uint64_t key; int value; } MAP by_fingerprint = NULL;
+	for (int i = 0; i < arrlen(self->items); i++) {
+		if (!reused[i] && self->items[i].fingerprint && self->items[i].generation != self->stale_generation
+				&& hmgeti(by_fingerprint, self->items[i].fingerprint) < 0) {
+			hmput(by_fingerprint, self->items[i].fingerprint, i);
+		}
+	}
+	for (int i = 0; by_fingerprint && i < arrlen(items); i++) {
+		if (items[i].generation != self->generation || !items[i].fingerprint) continue;
+		ptrdiff_t at = hmgeti(by_fingerprint, items[i].fingerprint);
+		int old = at >= 0? by_fingerprint[at].value : -1;
+		ParsedDecl* item_decls = &decls[items[i].first_decl];
+		const ParsedDecl* old_decls = old >= 0? &self->decls[self->items[old].first_decl] : NULL;
+		if (old >= 0 && !reused[old] && same_decls(&items[i], item_decls, &self->items[old], old_decls)) {
+			keep_old_nodes(module, &items[i], item_decls, &self->items[old], old_decls);
+			reused[old] = true;
+		}
+	}
+	hmfree(by_fingerprint);
+}
+
+/// Parses the whole module. Given the lines that changed since the last good parse, the
+/// items of that parse outside of them are reused. On success, the parse becomes the
+/// basis of the next reparse.
+static AST_Module* parse_module(Parser self, const ChangedLines* changed, ParserDelta* delta) {
+	clear_diagnostics(self);
 	NEW_NODE(module, NODE_MODULE);
 	sh_new_arena(module->scope);
-	bool is_pub = false;
-	while (TOP().type != TOK_EOF) {
-		if (!toplevel_item(self, module)) {
-			lexer_seek_toplevel(self->lex);
+	ParsedItem ARRAY items = NULL;
+	ParsedDecl ARRAY decls = NULL;
+	int n_old = changed? arrlen(self->items) : 0;
+	bool* reused = calloc(n_old + 1, sizeof(bool));
+	ParsedName MAP parsed_names = NULL;
+	int next_old = 0;
+	int line_shift = changed? (int) changed->new_end - (int) changed->old_end : 0;
+
+	while (true) {
+		while (TOP().type == TOK_EOL) POP();  // filter empty lines
+		if (TOP().type == TOK_EOF) break;
+		unsigned int line = TOP().start_line, col = TOP().start_col;
+
+		if (changed && (line < changed->start || line >= changed->new_end)) {
+			// Outside of the changed lines: an old item may start right here
+			unsigned int old_line = line < changed->start? line : line - line_shift;
+			while (next_old < n_old && (self->items[next_old].start_line < old_line
+					|| (self->items[next_old].start_line == old_line && self->items[next_old].start_col < col))) {
+				next_old++;
+			}
+			bool before = line < changed->start;
+			int shift = before? 0 : line_shift;
+			const ParsedItem* old = &self->items[next_old];
+			if (next_old < n_old && old->start_line == old_line && old->start_col == col
+					&& is_unchanged(old, changed, before)
+					&& reuse_item(self, module, old, shift, parsed_names, &items, &decls)) {
+				reused[next_old] = true;
+				// The lexer starts afresh on the line after an item, so on lines that are the same
+				// the items that followed it still do, and can be spliced in without looking
+				while (++next_old < n_old && is_unchanged(&self->items[next_old], changed, before)
+						&& reuse_item(self, module, &self->items[next_old], shift, parsed_names, &items, &decls)) {
+					reused[next_old] = true;
+				}
+				continue;
+			}
+		}
+
+		int n_names = shlen(module->scope);
+		parse_item(self, module, &items, &decls);
+		for (int i = n_names; n_old && i < shlen(module->scope); i++) shput(parsed_names, module->scope[i].key, true);
+	}
+	shfree(parsed_names);
+
+	if (self->error_count) {
+		// The last good parse stays valid, so its nodes are left as they were
+		for (int i = 0; i < arrlen(items); i++) {
+			if (items[i].generation == self->generation) free_item_nodes(&items[i], decls);
+		}
+		shfree(module->scope);
+		arrfree(module->tests);
+		free(reused);
+		arrfree(items);
+		arrfree(decls);
+		return NULL;
+	}
+	if (n_old) keep_moved_items(self, module, items, decls, reused);
+
+	if (delta) {
+		for (int i = 0; i < arrlen(items); i++) {
+			if (items[i].generation != self->generation) {
+				delta->items_reused++;
+				continue;
+			}
+			delta->items_parsed++;
+			for (int j = 0; j < items[i].n_decls; j++) arrpush(delta->changed, decls[items[i].first_decl + j].value);
+		}
+		for (int i = 0; i < n_old; i++) {
+			if (reused[i]) continue;
+			for (int j = 0; j < self->items[i].n_decls; j++) {
+				const char* key = self->decls[self->items[i].first_decl + j].key;
+				if (key && !is_generated_key(key) && shgeti(module->scope, key) < 0) arrpush(delta->removed, strdup(key));
+			}
 		}
 	}
-	if (self->error_count) return NULL;
+	for (int i = 0; i < arrlen(self->items); i++) {
+		if (i >= n_old || !reused[i]) free_item_nodes(&self->items[i], self->decls);
+	}
+	free(reused);
+	arrfree(self->items);
+	arrfree(self->decls);
+	if (self->module) {
+		shfree(self->module->scope);
+		arrfree(self->module->tests);
+	}
+	self->items = items;
+	self->decls = decls;
+	self->module = module;
+	self->module_generation = self->generation;
 	return module;
 }
 
-// === AST Printing ===
+AST_Node* parser_execute(Parser self) {
+	return (AST_Node*) parse_module(self, NULL, NULL);
+}
 
-#include "ast_print.impl.gen.h"
+/// Builds the text an edit produces from the text of the last parse
+static char* apply_edit(Parser self, const ParserEdit* edit, size_t* length) {
+	int n_lines;
+	const unsigned char** lines = lexer_get_lines(self->lex, &n_lines);
+	int start = edit->start_line - 1, end = edit->end_line? edit->end_line - 1 : n_lines;
+	if (start < 0 || start > n_lines || end < start || end > n_lines) {
+		fprintf(stderr, "Edit of lines %d-%d is outside of '%s', which has %d lines\n",
+			edit->start_line, edit->end_line, self->src, n_lines);
+		return NULL;
+	}
+	size_t size = edit->length;
+	for (int i = 0; i < n_lines; i++) {
+		if (i < start || i >= end) size += strlen(lines[i]) + 1;
+	}
+	char* text = malloc(size + 1);
+	char* out = text;
+	for (int i = 0; i < n_lines; i++) {
+		if (i == start) {
+			memcpy(out, edit->text, edit->length);
+			out += edit->length;
+		}
+		if (i >= start && i < end) continue;
+		size_t len = strlen(lines[i]);
+		memcpy(out, lines[i], len);
+		out += len;
+		if (i < n_lines - 1) *out++ = '\n';  // the last line has no line break of its own
+	}
+	if (start == n_lines) {
+		memcpy(out, edit->text, edit->length);
+		out += edit->length;
+	}
+	*length = out - text;
+	*out = 0;
+	return text;
+}
+
+/// Counts the line breaks in the text, eight bytes at a time
+static int count_lines(const char* text, const char* end) {
+	const uint64_t ONES = 0x0101010101010101ull, HIGH = 0x8080808080808080ull;
+	int lines = 0;
+	for (; end - text >= 8; text += 8) {
+		uint64_t word;
+		memcpy(&word, text, 8);
+		word ^= '\n' * ONES;  // line breaks become zero bytes
+		uint64_t zero = ~(((word & ~HIGH) + ~HIGH) | word | ~HIGH);  // the high bit of each zero byte
+		lines += (int) (((zero >> 7) * ONES) >> 56);  // the sum of those bits, in the top byte
+	}
+	for (; text < end; text++) lines += *text == '\n';
+	return lines;
+}
+
+/// diff_lines for an old text that is still in memory: whole lines are compared at once by
+/// comparing everything up to the first difference, and from the last one on
+static ChangedLines diff_text(const char* old, size_t old_length, int n_old, const char* new, size_t new_length) {
+	int n_new = count_lines(new, new + new_length) + 1;
+	size_t common = old_length < new_length? old_length : new_length;
+	// Most of the text is the same; memcmp finds the block where it isn't
+	size_t head = 0, tail = 0, block;
+	while (head < common) {
+		block = common - head < 4096? common - head : 4096;
+		if (memcmp(old + head, new + head, block) != 0) break;
+		head += block;
+	}
+	while (head < common && old[head] == new[head]) head++;
+	while (tail < common) {
+		block = common - tail < 4096? common - tail : 4096;
+		if (memcmp(old + old_length - tail - block, new + new_length - tail - block, block) != 0) break;
+		tail += block;
+	}
+	while (tail < common && old[old_length - 1 - tail] == new[new_length - 1 - tail]) tail++;
+	// The lines before the first difference are the same, and the line it's in is too if it
+	// is where both lines end
+	int prefix = count_lines(new, new + head);
+	if ((head == old_length || old[head] == '\n') && (head == new_length || new[head] == '\n')) prefix++;
+	// Every line break from the last difference on starts a line that's the same; the lines
+	// can overlap the prefix when text is repeated, and then just as much of them is left out
+	int suffix = count_lines(new + new_length - tail, new + new_length);
+	if (suffix > n_old - prefix) suffix = n_old - prefix;
+	if (suffix > n_new - prefix) suffix = n_new - prefix;
+	return (ChangedLines) { prefix + 1, n_old - suffix + 1, n_new - suffix + 1, n_new };
+}
+
+/// Finds the lines that differ between the text of the last good parse and the new one
+static ChangedLines diff_lines(Parser self, const char* text, size_t length) {
+	Lexer lex = self->lex;
+	for (int i = 0; i < arrlen(self->retired); i++) {
+		if (self->retired[i].id == self->module_generation) lex = self->retired[i].lex;
+	}
+	int n_old;
+	const unsigned char** old = lexer_get_lines(lex, &n_old);
+	size_t old_length;
+	const char* old_text = lexer_get_text(lex, &old_length);
+	if (old_text) return diff_text(old_text, old_length, n_old, text, length);
+	const char** new = NULL;
+	for (const char* line = text; line; ) {
+		arrpush(new, line);
+		line = memchr(line, '\n', text + length - line);
+		if (line) line++;
+	}
+	int n_new = arrlen(new);
+	// A line of the new text is only the same if it is as long as the old one, up to its line break
+	#define SAME_LINE(O, N) ( \
+		strncmp((const char*) old[O], new[N], len = strlen(old[O])) == 0 \
+		&& (new[N] + len == text + length || new[N][len] == '\n'))
+	size_t len;
+	int prefix = 0, suffix = 0;
+	while (prefix < n_old && prefix < n_new && SAME_LINE(prefix, prefix)) prefix++;
+	while (suffix < n_old - prefix && suffix < n_new - prefix
+		&& SAME_LINE(n_old - 1 - suffix, n_new - 1 - suffix)) suffix++;
+	#undef SAME_LINE
+	arrfree(new);
+	return (ChangedLines) { prefix + 1, n_old - suffix + 1, n_new - suffix + 1, n_new };
+}
+
+/// Each earlier parse that items still come from keeps its text and nodes. When there are too
+/// many, the one with the fewest items is given up on: they are parsed again instead.
+static int pick_stale_generation(Parser self) {
+	if (arrlen(self->retired) < MAX_RETIRED_GENERATIONS) return -1;
+	int oldest = self->generation;
+	for (int i = 0; i < arrlen(self->retired); i++) {
+		if (self->retired[i].id < oldest) oldest = self->retired[i].id;
+	}
+	int* n_items = calloc(self->generation - oldest + 1, sizeof(int));
+	for (int i = 0; i < arrlen(self->items); i++) n_items[self->items[i].generation - oldest]++;
+	int stale = -1;
+	for (int i = 0; i < arrlen(self->retired); i++) {
+		int id = self->retired[i].id;
+		if (id != self->module_generation && (stale < 0 || n_items[id - oldest] < n_items[stale - oldest])) stale = id;
+	}
+	free(n_items);
+	return stale;
+}
+
+AST_Node* parser_reparse(Parser self, const ParserEdit* edit, ParserDelta* delta) {
+	if (delta) *delta = (ParserDelta) {0};
+	size_t length;
+	char* text;
+	if (edit) text = apply_edit(self, edit, &length);
+	else if (strcmp(self->src, "-") == 0) {
+		fprintf(stderr, "Unable to re-read standard input\n");
+		return NULL;
+	}
+	else if ((text = (char*) read_entire_file(self->src))) length = strlen(text);
+	if (!text) return NULL;
+
+	ChangedLines changed = diff_lines(self, text, length);
+	self->stale_generation = pick_stale_generation(self);
+	Lexer lex = lexer_create_from_memory(text, length);
+	free(text);
+	if (!lex) return NULL;
+
+	// Nodes of the last parse stay where they are until nothing refers to them anymore
+	ParserGeneration old = { self->generation, self->lex, self->arenas, self->locations };
+	arrpush(self->retired, old);
+	self->lex = lex;
+	self->arenas = NULL;
+	self->locations = NULL;
+	self->arena_current = NULL;
+	self->generation++;
+	self->error_count = 0;
+	self->warning_count = 0;
+
+	AST_Module* module = parse_module(self, &changed, delta);
+
+	// Generations are numbered in order, so the ones still in use can be marked in one pass
+	int oldest = self->generation;
+	for (int i = 0; i < arrlen(self->retired); i++) {
+		if (self->retired[i].id < oldest) oldest = self->retired[i].id;
+	}
+	bool* in_use = calloc(self->generation - oldest + 1, sizeof(bool));
+	in_use[self->module_generation - oldest] = true;
+	for (int i = 0; i < arrlen(self->items); i++) in_use[self->items[i].generation - oldest] = true;
+	for (int i = 0; i < arrlen(self->retired); i++) {
+		if (!in_use[self->retired[i].id - oldest]) {
+			free_generation(&self->retired[i]);
+			arrdelswap(self->retired, i);
+			i--;
+		}
+	}
+	free(in_use);
+	return (AST_Node*) module;
+}
+
+void parser_settle_lines(Parser self) {
+	shift_items(self, self->items, self->decls);
+}
 
-void print_ast(FILE* stream, const AST_Node* root) {
-	fprintf(stream, "From '%s':\n  ", root->src_file);
-	print_ast_node(stream, root, 1);
+void parser_delta_free(ParserDelta* delta) {
+	arrfree(delta->changed);
+	for (int i = 0; i < arrlen(delta->removed); i++) free(delta->removed[i]);
+	arrfree(delta->removed);
 }
@@ -1,11 +1,79 @@
 #pragma once
 #include <stdint.h>
+#include <stdio.h>
 
 #include "ast.h"
 
 typedef struct _parse_state* Parser;
 
 Parser parser_create(const char* filename);
+/// Parses the given text instead of a file; name stands for the file in errors and locations
+Parser parser_create_from_memory(const char* name, const char* text, size_t length);
 void parser_destroy(Parser parser);
 
 AST_Node* parser_execute(Parser parser);
+
+/// Has the parser hash-cons types, literals and qualified names (see ast_intern.h), so that
+/// equal subtrees are the same node. Call before parser_execute; off by default.
+void parser_share_nodes(Parser parser, bool share);
+
+typedef struct {
+	unsigned int start_line, start_col, end_line, end_col;
+} NodeLocation;
+
+/// Where the node held in *slot occurs. Shared nodes have no location of their own, so
+/// this is the only way to find theirs; only the root of a shared subtree has one.
+NodeLocation parser_node_location(Parser parser, AST_Node* const* slot);
+
+typedef enum {
+	DIAGNOSTIC_ERROR,
+	DIAGNOSTIC_WARNING,
+	DIAGNOSTIC_NOTE,
+} DiagnosticSeverity;
+
+typedef struct {
+	DiagnosticSeverity severity;
+	unsigned int start_line, start_col, end_line, end_col;  // as in AST nodes
+	const char* kind;  // "Syntax error", "Syntax warning"...
+	char* message;
+} ParserDiagnostic;
+
+/// Has the parser keep its errors and warnings for parser_diagnostics instead of printing them
+void parser_collect_diagnostics(Parser parser, bool collect);
+
+/// What the last parse or reparse reported, in the order it was found. Valid until the next one.
+const ParserDiagnostic* parser_diagnostics(Parser parser, int* count);
+
+/// Bytes held by the parser: its lexers, and the arenas of every node still in use
+size_t parser_memory_usage(Parser parser);
+
+/// Replaces lines [start_line, end_line) of the text last parsed (1-based; end_line 0 means
+/// through the end) with the given text, which should include its own line breaks
+typedef struct {
+	int start_line, end_line;
+	const char* text;
+	size_t length;
+} ParserEdit;
+
+/// What a reparse changed, relative to the last parse that succeeded
+typedef struct {
+	AST_Node* ARRAY changed;  // declarations and tests that were parsed again, in source order
+	char* ARRAY removed;      // names that are no longer declared
+	int items_reused, items_parsed;
+} ParserDelta;
+
+/// Parses the module again after an edit, or after its file changed when edit is NULL.
+/// Only top-level items whose tokens changed are parsed; the nodes of the others are
+/// reused, and only how far they moved is recorded (see parser_settle_lines). Returns NULL
+/// on errors, in which case the module from the last successful parse stays valid; on
+/// success, that module no longer is.
+AST_Node* parser_reparse(Parser parser, const ParserEdit* edit, ParserDelta* delta);
+/// Brings the lines of the nodes that reparses reused, and of their shared occurrences
+/// (parser_node_location), up to date with the text. An edit that adds or removes lines
+/// moves every item after it, so reparses leave that walk until the lines are read.
+void parser_settle_lines(Parser parser);
+void parser_delta_free(ParserDelta* delta);
+
+/// Prints per-rule statistics for every parser destroyed so far, busiest rules first.
+/// Returns false without printing anything unless built with PROFILE_PARSE.
+bool parser_profile_report(FILE* stream);
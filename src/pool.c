@@ -0,0 +1,157 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "pool.h"
+
+// The tasks a worker has yet to run: it takes them from the front, thieves from the back
+typedef struct {
+	pthread_mutex_t lock;
+	int begin, end;
+	char padding[64];  // so that workers don't share cache lines
+} TaskRange;
+
+struct _task_pool {
+	int n_workers;
+	pthread_t* threads;  // of workers 1 and up; 0 is whichever thread runs the batch
+	TaskRange* ranges;
+	pthread_mutex_t lock;
+	pthread_cond_t started;
+	pthread_cond_t finished;
+	// The batch being run
+	TaskFunc func;
+	void* ctx;
+	unsigned batch;  // counts up, so that workers can tell a new batch from the last
+	int n_busy;      // threads still working on the batch
+	bool stopping;
+};
+
+typedef struct {
+	TaskPool pool;
+	int worker;
+} WorkerArgs;
+
+/// The next task for the worker, taken from its own range or stolen; -1 when there are none left
+static int next_task(TaskPool pool, int worker) {
+	TaskRange* own = &pool->ranges[worker];
+	pthread_mutex_lock(&own->lock);
+	int task = own->begin < own->end? own->begin++ : -1;
+	pthread_mutex_unlock(&own->lock);
+	if (task >= 0) return task;
+
+	// Tasks don't make more tasks, so once every range has been seen empty, the batch is done
+	for (int i = 1; i < pool->n_workers; i++) {
+		TaskRange* victim = &pool->ranges[(worker + i) % pool->n_workers];
+		pthread_mutex_lock(&victim->lock);
+		int left = victim->end - victim->begin;
+		int stolen_begin = victim->end - (left + 1) / 2, stolen_end = victim->end;
+		if (left > 0) victim->end = stolen_begin;
+		pthread_mutex_unlock(&victim->lock);
+		if (left <= 0) continue;
+		pthread_mutex_lock(&own->lock);
+		own->begin = stolen_begin + 1;
+		own->end = stolen_end;
+		pthread_mutex_unlock(&own->lock);
+		return stolen_begin;
+	}
+	return -1;
+}
+
+static void run_tasks(TaskPool pool, int worker) {
+	int task;
+	while ((task = next_task(pool, worker)) >= 0) pool->func(pool->ctx, task, worker);
+}
+
+static void* worker_main(void* arg) {
+	WorkerArgs args = *(WorkerArgs*) arg;
+	free(arg);
+	TaskPool pool = args.pool;
+	unsigned seen = 0;
+	pthread_mutex_lock(&pool->lock);
+	while (1) {
+		while (!pool->stopping && pool->batch == seen) pthread_cond_wait(&pool->started, &pool->lock);
+		if (pool->stopping) break;
+		seen = pool->batch;
+		pthread_mutex_unlock(&pool->lock);
+		run_tasks(pool, args.worker);
+		pthread_mutex_lock(&pool->lock);
+		if (--pool->n_busy == 0) pthread_cond_signal(&pool->finished);
+	}
+	pthread_mutex_unlock(&pool->lock);
+	return NULL;
+}
+
+TaskPool task_pool_create(int n_threads) {
+	if (n_threads <= 0) {
+		long n = sysconf(_SC_NPROCESSORS_ONLN);
+		n_threads = n > 0? (int) n : 1;
+	}
+	TaskPool pool = calloc(1, sizeof(struct _task_pool));
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->started, NULL);
+	pthread_cond_init(&pool->finished, NULL);
+	pool->ranges = calloc(n_threads, sizeof(TaskRange));
+	for (int i = 0; i < n_threads; i++) pthread_mutex_init(&pool->ranges[i].lock, NULL);
+	pool->threads = calloc(n_threads, sizeof(pthread_t));
+	pool->n_workers = 1;
+	for (int i = 1; i < n_threads; i++) {
+		WorkerArgs* args = malloc(sizeof(WorkerArgs));
+		*args = (WorkerArgs) { pool, i };
+		if (pthread_create(&pool->threads[i], NULL, worker_main, args) != 0) {
+			// Runs with as many as could be started
+			free(args);
+			break;
+		}
+		pool->n_workers++;
+	}
+	return pool;
+}
+
+void task_pool_destroy(TaskPool pool) {
+	if (!pool) return;
+	pthread_mutex_lock(&pool->lock);
+	pool->stopping = true;
+	pthread_cond_broadcast(&pool->started);
+	pthread_mutex_unlock(&pool->lock);
+	for (int i = 1; i < pool->n_workers; i++) pthread_join(pool->threads[i], NULL);
+	for (int i = 0; i < pool->n_workers; i++) pthread_mutex_destroy(&pool->ranges[i].lock);
+	pthread_cond_destroy(&pool->started);
+	pthread_cond_destroy(&pool->finished);
+	pthread_mutex_destroy(&pool->lock);
+	free(pool->ranges);
+	free(pool->threads);
+	free(pool);
+}
+
+int task_pool_size(TaskPool pool) {
+	return pool->n_workers;
+}
+
+void task_pool_run(TaskPool pool, int n_tasks, TaskFunc func, void* ctx) {
+	if (n_tasks <= 0) return;
+	pool->func = func;
+	pool->ctx = ctx;
+	if (pool->n_workers == 1 || n_tasks == 1) {
+		for (int i = 0; i < n_tasks; i++) func(ctx, i, 0);
+		return;
+	}
+	for (int i = 0; i < pool->n_workers; i++) {
+		TaskRange* range = &pool->ranges[i];
+		pthread_mutex_lock(&range->lock);
+		range->begin = (int) ((long long) n_tasks * i / pool->n_workers);
+		range->end = (int) ((long long) n_tasks * (i + 1) / pool->n_workers);
+		pthread_mutex_unlock(&range->lock);
+	}
+	pthread_mutex_lock(&pool->lock);
+	pool->batch++;
+	pool->n_busy = pool->n_workers - 1;
+	pthread_cond_broadcast(&pool->started);
+	pthread_mutex_unlock(&pool->lock);
+
+	run_tasks(pool, 0);
+
+	pthread_mutex_lock(&pool->lock);
+	while (pool->n_busy > 0) pthread_cond_wait(&pool->finished, &pool->lock);
+	pthread_mutex_unlock(&pool->lock);
+}
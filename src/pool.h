@@ -0,0 +1,19 @@
+#pragma once
+// A fixed set of worker threads that run batches of independent tasks. Each worker starts
+// with a contiguous share of a batch and, once it runs out, steals half of what another has
+// left, so uneven tasks still keep every worker busy.
+
+typedef struct _task_pool* TaskPool;
+
+/// Runs task number `task` of a batch; `worker` is that of the thread running it, from 0 to
+/// task_pool_size - 1, for indexing state kept per worker
+typedef void (*TaskFunc)(void* ctx, int task, int worker);
+
+/// n_threads <= 0 for one per processor. The thread that runs a batch is one of them.
+TaskPool task_pool_create(int n_threads);
+void task_pool_destroy(TaskPool pool);
+
+int task_pool_size(TaskPool pool);
+
+/// Runs tasks 0 to n_tasks - 1, returning once they are all done. Tasks may not run batches.
+void task_pool_run(TaskPool pool, int n_tasks, TaskFunc func, void* ctx);
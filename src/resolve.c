@@ -0,0 +1,456 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "resolve.h"
+#include "ast_walk.h"
+#include "ast_intern.h"
+#include "stb_ds.h"
+
+// Names are found by the address of their slot. The entries are grouped by the page of
+// memory the slot is on, and sorted within it, so a lookup is a probe into the (small)
+// table of pages and a search among the few names of one page.
+#define NAME_PAGE_BITS 12
+
+typedef struct {
+	AST_Node* const* slot;
+	ResolvedName name;
+} NameEntry;
+
+typedef struct {
+	uintptr_t page;  // 0 = free
+	int first, count;  // of its entries
+} NamePage;
+
+struct _resolution {
+	Symbol ARRAY symbols;    // by id; 0 is a placeholder
+	Scope ARRAY scopes;
+	SymbolId ARRAY members;  // of each scope in turn
+	NameEntry ARRAY names;
+	NamePage* pages;         // open addressing
+	size_t pages_mask, n_pages;
+	int n_unresolved;
+};
+
+typedef struct {
+	int scope;
+	int first_open;  // of its symbols in Resolver.open
+} OpenScope;
+
+// Every distinct name gets a number, under which the walk keeps what the name means at the
+// current point. A declaration replaces the meaning of its name until the end of its scope,
+// when the old one is put back.
+typedef struct {
+	const char* text;  // NULL = free
+	uint64_t hash;
+	int number;
+} Spelling;
+
+typedef struct {
+	Resolution res;
+	Spelling* spellings;  // open addressing
+	size_t spellings_mask;
+	SymbolId ARRAY meaning;   // by name number
+	int ARRAY name_of;        // by symbol: the number of its name
+	SymbolId ARRAY shadowed;  // by symbol: what its name meant before it was declared
+	SymbolId ARRAY open;      // declared in the open scopes, innermost last
+	OpenScope ARRAY stack;
+	AST_Node** ARRAY not_uses;  // slots the walk is yet to reach of names that aren't uses
+	struct { AST_Node* key; bool value; } MAP shared_seen;
+	char ARRAY joined;        // scratch for dotted names
+} Resolver;
+
+// === Names by slot ===
+
+static inline size_t hash_page(uintptr_t page) {
+	return page * 0x9e3779b97f4a7c15ull >> 32;
+}
+
+static NamePage* find_page(Resolution res, uintptr_t page) {
+	if (!res->pages) return NULL;
+	for (size_t i = hash_page(page) & res->pages_mask; res->pages[i].page; i = (i + 1) & res->pages_mask) {
+		if (res->pages[i].page == page) return &res->pages[i];
+	}
+	return NULL;
+}
+
+static NamePage* add_page(Resolution res, uintptr_t page) {
+	if (2 * (res->n_pages + 1) > res->pages_mask) {
+		size_t old_mask = res->pages_mask;
+		NamePage* old = res->pages;
+		res->pages_mask = res->pages_mask < 255? 255 : 2 * res->pages_mask + 1;
+		res->pages = calloc(res->pages_mask + 1, sizeof(NamePage));
+		for (size_t i = 0; old && i <= old_mask; i++) {
+			if (!old[i].page) continue;
+			size_t j = hash_page(old[i].page) & res->pages_mask;
+			while (res->pages[j].page) j = (j + 1) & res->pages_mask;
+			res->pages[j] = old[i];
+		}
+		free(old);
+	}
+	size_t i = hash_page(page) & res->pages_mask;
+	while (res->pages[i].page) i = (i + 1) & res->pages_mask;
+	res->pages[i] = (NamePage) { page, 0, 0 };
+	res->n_pages++;
+	return &res->pages[i];
+}
+
+static void put_name(Resolution res, AST_Node* const* slot, ResolvedName name) {
+	NameEntry entry = { slot, name };
+	arrput(res->names, entry);
+}
+
+/// Groups the names, which are put in the order the walk meets them, by page. The page
+/// runs are sized for every entry, so a run may end short of where the next one starts.
+static void index_names(Resolution res) {
+	int n = arrlen(res->names);
+	for (int i = 0; i < n; i++) {
+		uintptr_t page = (uintptr_t) res->names[i].slot >> NAME_PAGE_BITS;
+		NamePage* entry = find_page(res, page);
+		if (!entry) entry = add_page(res, page);
+		entry->count++;
+	}
+	int first = 0;
+	for (size_t i = 0; res->pages && i <= res->pages_mask; i++) {
+		res->pages[i].first = first;
+		first += res->pages[i].count;
+		res->pages[i].count = 0;
+	}
+	NameEntry* sorted = malloc(n * sizeof(NameEntry) + 1);
+	for (int i = 0; i < n; i++) {
+		NamePage* entry = find_page(res, (uintptr_t) res->names[i].slot >> NAME_PAGE_BITS);
+		// Insertion sort: the walk meets the names on a page mostly in order
+		NameEntry* run = &sorted[entry->first];
+		AST_Node* const* slot = res->names[i].slot;
+		int j = entry->count;
+		while (j > 0 && run[j - 1].slot > slot) j--;
+		// A subtree the parser gives to several nodes (as the type of 'x, y: Int') is walked once for each
+		if (j > 0 && run[j - 1].slot == slot) continue;
+		memmove(&run[j + 1], &run[j], (entry->count - j) * sizeof(NameEntry));
+		run[j] = res->names[i];
+		entry->count++;
+		if (!run[j].name.symbol) res->n_unresolved++;
+	}
+	if (n) memcpy(res->names, sorted, n * sizeof(NameEntry));
+	free(sorted);
+}
+
+// === Scopes and declarations ===
+
+static inline uint64_t hash_text(const char* text) {
+	uint64_t hash = 0xcbf29ce484222325ull;
+	for (; *text; text++) {
+		hash ^= (unsigned char) *text;
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+/// The number of a name, or -1 if it hasn't been seen and isn't to be added
+static int name_number(Resolver* r, const char* text, bool add) {
+	uint64_t hash = hash_text(text);
+	size_t i = hash & r->spellings_mask;
+	for (; r->spellings && r->spellings[i].text; i = (i + 1) & r->spellings_mask) {
+		if (r->spellings[i].hash == hash && strcmp(r->spellings[i].text, text) == 0) return r->spellings[i].number;
+	}
+	if (!add) return -1;
+	int number = arrlen(r->meaning);
+	if (2 * (size_t) (number + 1) > r->spellings_mask) {
+		size_t old_mask = r->spellings_mask;
+		Spelling* old = r->spellings;
+		r->spellings_mask = r->spellings_mask < 255? 255 : 2 * r->spellings_mask + 1;
+		r->spellings = calloc(r->spellings_mask + 1, sizeof(Spelling));
+		for (size_t j = 0; old && j <= old_mask; j++) {
+			if (!old[j].text) continue;
+			size_t k = old[j].hash & r->spellings_mask;
+			while (r->spellings[k].text) k = (k + 1) & r->spellings_mask;
+			r->spellings[k] = old[j];
+		}
+		free(old);
+		for (i = hash & r->spellings_mask; r->spellings[i].text; i = (i + 1) & r->spellings_mask) {}
+	}
+	r->spellings[i] = (Spelling) { text, hash, number };
+	arrput(r->meaning, 0);
+	return number;
+}
+
+static SymbolId meaning_of(Resolver* r, const char* text) {
+	int number = name_number(r, text, false);
+	return number < 0? 0 : r->meaning[number];
+}
+
+static void open_scope(Resolver* r, AST_Node* owner) {
+	Scope scope = { arrlen(r->stack)? arrlast(r->stack).scope : -1, owner, 0, 0 };
+	arrput(r->res->scopes, scope);
+	OpenScope open = { arrlen(r->res->scopes) - 1, arrlen(r->open) };
+	arrput(r->stack, open);
+}
+
+static void close_scope(Resolver* r) {
+	OpenScope top = arrpop(r->stack);
+	int n = arrlen(r->open) - top.first_open;
+	Scope* scope = &r->res->scopes[top.scope];
+	scope->first_member = arrlen(r->res->members);
+	scope->n_members = n;
+	if (n) {
+		size_t at = arraddn(r->res->members, n);
+		memcpy(&r->res->members[at], &r->open[top.first_open], n * sizeof(SymbolId));
+	}
+	// Latest first, so that a name declared twice in the scope ends up with its meaning from before both
+	for (int i = arrlen(r->open) - 1; i >= top.first_open; i--) {
+		SymbolId id = r->open[i];
+		r->meaning[r->name_of[id]] = r->shadowed[id];
+	}
+	arrsetlen(r->open, top.first_open);
+}
+
+static void declare(Resolver* r, const char* name, AST_Name** slot, AST_Node* decl, DeclKind kind) {
+	Symbol symbol = { name, decl, *slot, arrlast(r->stack).scope, kind };
+	arrput(r->res->symbols, symbol);
+	SymbolId id = arrlen(r->res->symbols) - 1;
+	int number = name_number(r, name, true);
+	arrput(r->name_of, number);
+	arrput(r->shadowed, r->meaning[number]);
+	r->meaning[number] = id;
+	arrput(r->open, id);
+	ResolvedName declared = { id, 1 };
+	put_name(r->res, (AST_Node* const*) slot, declared);
+}
+
+static void declare_name(Resolver* r, AST_Name** slot, AST_Node* decl, DeclKind kind) {
+	if (*slot) declare(r, (*slot)->name, slot, decl, kind);
+}
+
+/// Has the walk pass over a name it is about to reach that isn't a use: that of a
+/// declaration, or a member
+static void not_a_use(Resolver* r, void* slot) {
+	if (*(AST_Node**) slot) arrput(r->not_uses, slot);
+}
+
+static bool is_not_a_use(Resolver* r, AST_Node** slot) {
+	// Mostly the last one
+	for (int i = arrlen(r->not_uses) - 1; i >= 0; i--) {
+		if (r->not_uses[i] == slot) {
+			r->not_uses[i] = arrlast(r->not_uses);
+			arrsetlen(r->not_uses, arrlen(r->not_uses) - 1);
+			return true;
+		}
+	}
+	return false;
+}
+
+static void declare_item(Resolver* r, const char* key, AST_Node* item) {
+	switch (item->node_type) {
+		case NODE_IMPORT: {
+			AST_Import* imp = (AST_Import*) item;
+			if (imp->local_name) declare(r, key, &imp->local_name, item, DECL_IMPORT);
+		} break;
+		case NODE_FUNC_DEF: declare(r, key, &((AST_FuncDef*) item)->name, item, DECL_FUNCTION); break;
+		case NODE_MACRO: declare(r, key, &((AST_Macro*) item)->name, item, DECL_MACRO); break;
+		case NODE_FUNC_OVERLOAD: declare(r, key, &((AST_FuncOverload*) item)->name, item, DECL_OVERLOAD); break;
+		case NODE_CONST: declare(r, key, &((AST_Const*) item)->name, item, DECL_CONST); break;
+		case NODE_STRUCT: declare(r, key, &((AST_Struct*) item)->name, item, DECL_STRUCT); break;
+		case NODE_ENUM: declare(r, key, &((AST_Enum*) item)->name, item, DECL_ENUM); break;
+		default: break;
+	}
+}
+
+// === Uses ===
+
+/// The first part of a qualified name is looked up, unless it names nothing; then the
+/// longest dotted prefix that does, as 'import a.b' declares a.b
+static ResolvedName resolve_qualname(Resolver* r, const AST_Qualname* qn) {
+	int n = arrlen(qn->parts);
+	ResolvedName found = { meaning_of(r, qn->parts[0]), 1 };
+	if (found.symbol || n < 2) {
+		if (!found.symbol) found.n_parts = 0;
+		return found;
+	}
+	if (r->joined) stbds_header(r->joined)->length = 0;
+	for (int i = 0; i < n; i++) {
+		size_t length = strlen(qn->parts[i]);
+		if (i) r->joined[arrlen(r->joined) - 1] = '.';
+		size_t at = arraddn(r->joined, length + 1);
+		memcpy(&r->joined[at], qn->parts[i], length + 1);
+		SymbolId id = i? meaning_of(r, r->joined) : 0;
+		if (id) found = (ResolvedName) { id, i + 1 };
+	}
+	if (!found.symbol) found.n_parts = 0;
+	return found;
+}
+
+static WalkAction resolve_pre(AST_Node** slot, void* ctx) {
+	Resolver* r = ctx;
+	AST_Node* node = *slot;
+	switch (node->node_type) {
+		case NODE_NAME:
+		case NODE_QUALNAME: {
+			if (arrlen(r->not_uses) && is_not_a_use(r, slot)) return WALK_SKIP;
+			ResolvedName found;
+			if (node->node_type == NODE_NAME) {
+				found.symbol = meaning_of(r, ((AST_Name*) node)->name);
+				found.n_parts = found.symbol? 1 : 0;
+			}
+			else found = resolve_qualname(r, (AST_Qualname*) node);
+			put_name(r->res, slot, found);
+			return WALK_SKIP;
+		}
+
+		case NODE_MODULE: {
+			AST_Module* module = (AST_Module*) node;
+			open_scope(r, node);
+			for (int i = 0; i < shlen(module->scope); i++) declare_item(r, module->scope[i].key, module->scope[i].value);
+		} break;
+
+		// Module paths and loop labels aren't symbols
+		case NODE_IMPORT:
+		case NODE_BREAK:
+		case NODE_SKIP:
+			return WALK_SKIP;
+
+		case NODE_FUNC_DEF:
+			not_a_use(r, &((AST_FuncDef*) node)->name);
+			open_scope(r, node);
+			break;
+		case NODE_MACRO:
+			not_a_use(r, &((AST_Macro*) node)->name);
+			open_scope(r, node);
+			break;
+		case NODE_FOR_LOOP:
+			not_a_use(r, &((AST_ForLoop*) node)->label);
+			open_scope(r, node);
+			break;
+		case NODE_TEST:
+		case NODE_RUN:
+		case NODE_BLOCK:
+			open_scope(r, node);
+			break;
+
+		// Declared once what they declare with has been resolved
+		case NODE_PARAM: not_a_use(r, &((AST_Param*) node)->name); break;
+		case NODE_VAR_DECL: not_a_use(r, &((AST_VarDecl*) node)->name); break;
+		case NODE_CONTEXT: not_a_use(r, &((AST_Context*) node)->name); break;
+		case NODE_FOR_SIMPLE: not_a_use(r, &((AST_ForSimple*) node)->name); break;
+		case NODE_FOR_RANGE: not_a_use(r, &((AST_ForRange*) node)->name); break;
+		case NODE_FOR_PARALLEL: {
+			AST_ForParallel* parallel = (AST_ForParallel*) node;
+			for (int i = 0; i < arrlen(parallel->names); i++) not_a_use(r, &parallel->names[i]);
+		} break;
+
+		// Module items are declared with the module; members aren't looked up in scopes
+		case NODE_CONST: not_a_use(r, &((AST_Const*) node)->name); break;
+		case NODE_STRUCT: not_a_use(r, &((AST_Struct*) node)->name); break;
+		case NODE_ENUM: not_a_use(r, &((AST_Enum*) node)->name); break;
+		case NODE_FUNC_OVERLOAD: not_a_use(r, &((AST_FuncOverload*) node)->name); break;
+		case NODE_FIELD: not_a_use(r, &((AST_Field*) node)->name); break;
+		case NODE_ENUM_VALUE: not_a_use(r, &((AST_EnumValue*) node)->name); break;
+		case NODE_FIELD_ACCESS: not_a_use(r, &((AST_FieldAccess*) node)->field); break;
+
+		default:
+			// A shared node is the same wherever it occurs, and so are the slots in it
+			if (ast_is_shared(node)) {
+				if (hmgeti(r->shared_seen, node) >= 0) return WALK_SKIP;
+				hmput(r->shared_seen, node, true);
+			}
+	}
+	return WALK_CONTINUE;
+}
+
+static WalkAction resolve_post(AST_Node** slot, void* ctx) {
+	Resolver* r = ctx;
+	AST_Node* node = *slot;
+	switch (node->node_type) {
+		case NODE_MODULE:
+		case NODE_FUNC_DEF:
+		case NODE_MACRO:
+		case NODE_FOR_LOOP:
+		case NODE_TEST:
+		case NODE_RUN:
+		case NODE_BLOCK:
+			close_scope(r);
+			break;
+
+		case NODE_PARAM: declare_name(r, &((AST_Param*) node)->name, node, DECL_PARAM); break;
+		case NODE_VAR_DECL: declare_name(r, &((AST_VarDecl*) node)->name, node, DECL_LOCAL); break;
+		case NODE_CONTEXT: declare_name(r, &((AST_Context*) node)->name, node, DECL_CONTEXT); break;
+		case NODE_FOR_SIMPLE: declare_name(r, &((AST_ForSimple*) node)->name, node, DECL_LOOP_VAR); break;
+		case NODE_FOR_RANGE: declare_name(r, &((AST_ForRange*) node)->name, node, DECL_LOOP_VAR); break;
+		case NODE_FOR_PARALLEL: {
+			AST_ForParallel* parallel = (AST_ForParallel*) node;
+			for (int i = 0; i < arrlen(parallel->names); i++) declare_name(r, &parallel->names[i], node, DECL_LOOP_VAR);
+		} break;
+
+		default: break;
+	}
+	return WALK_CONTINUE;
+}
+
+Resolution resolve_module(AST_Module* module) {
+	Resolution res = calloc(1, sizeof(struct _resolution));
+	Symbol none = {0};
+	arrput(res->symbols, none);
+	Resolver r = { .res = res };
+	arrput(r.name_of, 0);
+	arrput(r.shadowed, 0);
+	AST_Visitor visitor = { resolve_pre, resolve_post, &r };
+	AST_Node* root = (AST_Node*) module;
+	ast_walk_iterative(&root, &visitor);
+	index_names(res);
+	free(r.spellings);
+	arrfree(r.meaning);
+	arrfree(r.name_of);
+	arrfree(r.shadowed);
+	arrfree(r.open);
+	arrfree(r.stack);
+	arrfree(r.not_uses);
+	hmfree(r.shared_seen);
+	arrfree(r.joined);
+	return res;
+}
+
+void resolution_destroy(Resolution res) {
+	if (!res) return;
+	arrfree(res->symbols);
+	arrfree(res->scopes);
+	arrfree(res->members);
+	arrfree(res->names);
+	free(res->pages);
+	free(res);
+}
+
+int resolution_symbol_count(Resolution res) {
+	return arrlen(res->symbols) - 1;
+}
+
+const Symbol* resolution_symbol(Resolution res, SymbolId id) {
+	return id > 0 && id < arrlen(res->symbols)? &res->symbols[id] : NULL;
+}
+
+int resolution_scope_count(Resolution res) {
+	return arrlen(res->scopes);
+}
+
+const Scope* resolution_scope(Resolution res, int scope) {
+	return scope >= 0 && scope < arrlen(res->scopes)? &res->scopes[scope] : NULL;
+}
+
+const SymbolId* resolution_scope_members(Resolution res, int scope, int* count) {
+	*count = res->scopes[scope].n_members;
+	return res->members + res->scopes[scope].first_member;
+}
+
+ResolvedName resolution_lookup(Resolution res, AST_Node* const* slot) {
+	const NamePage* page = find_page(res, (uintptr_t) slot >> NAME_PAGE_BITS);
+	if (!page) return (ResolvedName) {0};
+	const NameEntry* run = &res->names[page->first];
+	int lo = 0, hi = page->count;
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		if (run[mid].slot < slot) lo = mid + 1;
+		else hi = mid;
+	}
+	return lo < page->count && run[lo].slot == slot? run[lo].name : (ResolvedName) {0};
+}
+
+int resolution_unresolved_count(Resolution res) {
+	return res->n_unresolved;
+}
@@ -0,0 +1,67 @@
+#pragma once
+// Name resolution: every declaration in a module gets a symbol id, and every name that is
+// used gets the id of the declaration it refers to
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "ast.h"
+
+typedef struct _resolution* Resolution;
+
+/// Symbols are numbered densely from 1, in the order they are declared. 0 is no symbol: the
+/// name isn't declared in the module (a builtin, or something a 'using' import brings in).
+typedef int32_t SymbolId;
+
+typedef enum {
+	DECL_IMPORT,
+	DECL_FUNCTION,
+	DECL_MACRO,
+	DECL_OVERLOAD,
+	DECL_CONST,
+	DECL_STRUCT,
+	DECL_ENUM,
+	DECL_PARAM,
+	DECL_LOCAL,     // AST_VarDecl
+	DECL_LOOP_VAR,  // the name of an AST_ForSimple, AST_ForRange or AST_ForParallel
+	DECL_CONTEXT,   // AST_Context
+} DeclKind;
+
+typedef struct {
+	const char* name;
+	AST_Node* decl;       // the node of the kind above
+	AST_Name* name_node;
+	int scope;
+	DeclKind kind;
+} Symbol;
+
+/// Scopes are kept in one array and refer to their parent by index. The module's is 0.
+typedef struct {
+	int parent;       // -1 for the module's
+	AST_Node* owner;  // the module, function, macro, test, #run, block or for loop that opens it
+	int first_member, n_members;  // see resolution_scope_members
+} Scope;
+
+typedef struct {
+	SymbolId symbol;
+	int n_parts;  // of an AST_Qualname, how many name the symbol (the rest are members of it); 0 if unresolved
+} ResolvedName;
+
+/// Resolves the names of a parsed module. Module items are visible throughout it, and
+/// anything else from its declaration to the end of its scope.
+Resolution resolve_module(AST_Module* module);
+void resolution_destroy(Resolution res);
+
+int resolution_symbol_count(Resolution res);
+const Symbol* resolution_symbol(Resolution res, SymbolId id);
+
+int resolution_scope_count(Resolution res);
+const Scope* resolution_scope(Resolution res, int scope);
+/// The symbols declared directly in the scope, in order
+const SymbolId* resolution_scope_members(Resolution res, int scope, int* count);
+
+/// What the AST_Name or AST_Qualname held in *slot refers to, or what the name held there
+/// declares. Shared nodes (see ast_intern.h) are resolved where they first occur.
+ResolvedName resolution_lookup(Resolution res, AST_Node* const* slot);
+
+/// Names that were used but aren't declared in the module
+int resolution_unresolved_count(Resolution res);
@@ -0,0 +1,421 @@
+#define _XOPEN_SOURCE 700
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "rhast.h"
+#include "stb_ds.h"
+
+#pragma GCC diagnostic ignored "-Wcast-qual"
+// Which helpers the generated code calls depends on the field types in ast_nodes.h
+#pragma GCC diagnostic ignored "-Wunused-function"
+
+#define RHAST_ALIGN 16
+#define SLOT_SIZE ((size_t) 1 << RHAST_SLOT_BITS)
+
+// === Slots ===
+// Which slots files are mapped at in this process, so a file written now doesn't take one
+
+static atomic_uint_fast64_t slots_mapped[RHAST_SLOTS / 64];
+
+static uintptr_t slot_address(uint32_t slot) {
+	return RHAST_REGION + ((uintptr_t) slot << RHAST_SLOT_BITS);
+}
+
+static bool slot_is_mapped(uint32_t slot) {
+	return atomic_load(&slots_mapped[slot / 64]) & (UINT64_C(1) << slot % 64);
+}
+
+static void set_slot_mapped(uint32_t slot, bool mapped) {
+	if (mapped) atomic_fetch_or(&slots_mapped[slot / 64], UINT64_C(1) << slot % 64);
+	else atomic_fetch_and(&slots_mapped[slot / 64], ~(UINT64_C(1) << slot % 64));
+}
+
+/// The slot the file at `path` is written for: the same one each time, unless it's taken
+static uint32_t pick_slot(const char* path) {
+	uint32_t slot = stbds_hash_string((char*) path, 0) % RHAST_SLOTS;
+	for (int i = 0; i < RHAST_SLOTS && slot_is_mapped(slot); i++) slot = (slot + 1) % RHAST_SLOTS;
+	return slot;
+}
+
+// === Writing ===
+
+typedef struct {
+	RhOff field;                     // where the map goes
+	ASTMAP_NodeEntry ARRAY entries;  // with the pointers for the file
+} PendingMap;
+
+/// A node to be written, and where the pointer to it goes: in the file, or in a map's entries
+typedef struct {
+	const AST_Node* node;
+	RhOff at;
+	int map, entry;  // map is -1 for the file
+} PendingNode;
+
+typedef struct {
+	char ARRAY buf;  // the whole file
+	struct { const char* key; RhOff value; } MAP interned;
+	PendingNode ARRAY nodes;  // children of the nodes written, which go after them
+	PendingMap ARRAY maps;    // written last, together, as their headers are written when loaded
+	uintptr_t base;  // which the pointers written are made for
+	uint32_t node_count;
+} RhastWriter;
+
+#define WRITER_AT(T, OFF) ((T*) (w->buf + (OFF)))
+
+static RhOff writer_reserve(RhastWriter* w, size_t n_bytes, size_t align) {
+	size_t off = (arrlen(w->buf) + align - 1) & ~(align - 1);
+	size_t end = off + n_bytes;
+	size_t old_len = arrlen(w->buf);
+	arrsetlen(w->buf, end);
+	memset(w->buf + old_len, 0, end - old_len);
+	return (RhOff) off;
+}
+
+static void* writer_pointer(RhastWriter* w, RhOff off) {
+	return off? (void*) (w->base + off) : NULL;
+}
+
+static RhOff write_string(RhastWriter* w, const char* str) {
+	if (!str) return 0;
+	ptrdiff_t i = shgeti(w->interned, str);
+	if (i >= 0) return w->interned[i].value;
+	size_t len = strlen(str) + 1;
+	RhOff result = writer_reserve(w, len, 1);
+	memcpy(w->buf + result, str, len);
+	shput(w->interned, str, result);
+	return result;
+}
+
+/// Reserves a node, with the fields every node has; its own are written by the caller
+static RhOff write_record(RhastWriter* w, const AST_Node* node, size_t size, size_t align) {
+	RhOff off = writer_reserve(w, size, align);
+	RhOff src_file = write_string(w, node->src_file);
+	AST_Node* dest = WRITER_AT(AST_Node, off);
+	dest->node_type = node->node_type;
+	dest->src_file = writer_pointer(w, src_file);
+	dest->start_line = node->start_line;
+	dest->start_col = node->start_col;
+	dest->end_line = node->end_line;
+	dest->end_col = node->end_col;
+	w->node_count++;
+	return off;
+}
+
+static void write_later(RhastWriter* w, RhOff at, const AST_Node* node) {
+	if (node) arrput(w->nodes, ((PendingNode) { node, at, -1, 0 }));
+}
+
+/// Reserves an stb_ds array of `len` items, with nothing to spare; returns where its items go
+static RhOff write_array(RhastWriter* w, size_t len, size_t item_size) {
+	RhOff off = writer_reserve(w, sizeof(stbds_array_header) + len * item_size, RHAST_ALIGN);
+	*WRITER_AT(stbds_array_header, off) = (stbds_array_header) { .length = len, .capacity = len };
+	return off + sizeof(stbds_array_header);
+}
+
+static void write_node_array(RhastWriter* w, RhOff field, const AST_Node* const* nodes) {
+	if (!nodes) return;
+	size_t len = arrlen(nodes);
+	RhOff items = write_array(w, len, sizeof(AST_Node*));
+	*WRITER_AT(void*, field) = writer_pointer(w, items);
+	for (size_t i = 0; i < len; i++) write_later(w, items + i * sizeof(AST_Node*), nodes[i]);
+}
+
+static RhOff write_string_array(RhastWriter* w, const char* const* strings) {
+	if (!strings) return 0;
+	size_t len = arrlen(strings);
+	RhOff items = write_array(w, len, sizeof(char*));
+	for (size_t i = 0; i < len; i++) {
+		RhOff item = write_string(w, strings[i]);
+		WRITER_AT(void*, items)[i] = writer_pointer(w, item);
+	}
+	return items;
+}
+
+static RhOff write_value_array(RhastWriter* w, const void* values, size_t len, size_t item_size) {
+	if (!values) return 0;
+	RhOff items = write_array(w, len, item_size);
+	memcpy(w->buf + items, values, len * item_size);
+	return items;
+}
+
+/// Writes the keys of a map now, its values as the other children, and the map itself with
+/// the other maps, at the end
+static void write_node_map(RhastWriter* w, RhOff field, const ASTMAP_NodeEntry* map) {
+	if (!map) return;
+	PendingMap pending = { .field = field };
+	for (ptrdiff_t i = 0; i < shlen(map); i++) {
+		RhOff key = write_string(w, map[i].key);
+		arrput(pending.entries, ((ASTMAP_NodeEntry) { writer_pointer(w, key), NULL }));
+		if (map[i].value) arrput(w->nodes, ((PendingNode) { map[i].value, 0, arrlen(w->maps), i }));
+	}
+	arrput(w->maps, pending);
+}
+
+/// Writes the maps as stb_ds maps: an array headed by the entry for keys that aren't in it
+static void write_maps(RhastWriter* w) {
+	for (ptrdiff_t i = 0; i < arrlen(w->maps); i++) {
+		ASTMAP_NodeEntry ARRAY entries = w->maps[i].entries;
+		RhOff items = write_array(w, arrlen(entries) + 1, sizeof(ASTMAP_NodeEntry));
+		memcpy(WRITER_AT(ASTMAP_NodeEntry, items) + 1, entries, arrlen(entries) * sizeof(ASTMAP_NodeEntry));
+		*WRITER_AT(void*, w->maps[i].field) = writer_pointer(w, items + sizeof(ASTMAP_NodeEntry));
+		arrfree(entries);
+	}
+	arrfree(w->maps);
+}
+
+// === Checking ===
+// Everything a mapped file points to is checked to be in it before anything is used, and
+// children must come after their parents, as they are written. Nodes, arrays and maps may
+// not overlap, as they are written to, so a damaged file can't have them change each other
+// once they are checked, nor make the check go round in circles.
+
+typedef struct {
+	const char* base;
+	size_t size;
+	uint64_t* claimed;                    // a bit for each 8 bytes that are a node's, array's or map's
+	AST_Node* ARRAY pending;              // nodes found but not checked yet
+	ASTMAP_NodeEntry* ARRAY maps;         // indexed once the whole file is known good
+	ASTMAP_NodeEntry** ARRAY empty_maps;  // map fields with no map
+} RhastCheck;
+
+static bool in_file(RhastCheck* k, const void* p, size_t n_bytes) {
+	uintptr_t at = (uintptr_t) p - (uintptr_t) k->base;
+	return at <= k->size && n_bytes <= k->size - at;
+}
+
+/// Takes the bytes for a node, array or map, if they are in the file and nothing else has them
+static bool claim(RhastCheck* k, const void* p, size_t n_bytes) {
+	if (!in_file(k, p, n_bytes)) return false;
+	size_t at = (const char*) p - k->base;
+	size_t from = at / 8, to = (at + n_bytes + 7) / 8;
+	while (from < to) {
+		size_t n_bits = to - from < 64 - from % 64? to - from : 64 - from % 64;
+		uint64_t bits = (n_bits == 64? ~(uint64_t) 0 : ((uint64_t) 1 << n_bits) - 1) << from % 64;
+		if (k->claimed[from / 64] & bits) return false;
+		k->claimed[from / 64] |= bits;
+		from += n_bits;
+	}
+	return true;
+}
+
+// The file ends with a 0 byte, which is claimed first, so a string that starts in it ends in it
+static bool check_string(RhastCheck* k, const char* str) {
+	return !str || in_file(k, str, 1);
+}
+
+/// Checks a child's place, and its type if the field has one (any goes for NODE_EMPTY)
+static bool check_child(RhastCheck* k, const void* parent, const AST_Node* child, NodeType type) {
+	if (!child) return true;
+	bool ok = (uintptr_t) child > (uintptr_t) parent
+		&& (uintptr_t) child % _Alignof(AST_Node) == 0
+		&& in_file(k, child, sizeof(AST_Node))
+		&& (type == NODE_EMPTY || child->node_type == type);
+	if (ok) arrput(k->pending, (AST_Node*) child);
+	return ok;
+}
+
+static bool check_array(RhastCheck* k, const void* parent, const void* items, size_t item_size) {
+	if (!items) return true;
+	const stbds_array_header* h = (const stbds_array_header*) items - 1;
+	return (uintptr_t) h > (uintptr_t) parent
+		&& (uintptr_t) h % RHAST_ALIGN == 0
+		&& in_file(k, h, sizeof(*h))
+		&& h->length == h->capacity && !h->hash_table
+		&& h->length <= k->size / item_size
+		&& claim(k, h, sizeof(*h) + h->length * item_size);
+}
+
+static bool check_node_array(RhastCheck* k, const void* parent, AST_Node* const* nodes, NodeType type) {
+	if (!check_array(k, parent, nodes, sizeof(*nodes))) return false;
+	for (ptrdiff_t i = 0; i < arrlen(nodes); i++) {
+		if (!check_child(k, nodes, nodes[i], type)) return false;
+	}
+	return true;
+}
+
+static bool check_string_array(RhastCheck* k, const void* parent, const char* const* strings) {
+	if (!check_array(k, parent, strings, sizeof(*strings))) return false;
+	for (ptrdiff_t i = 0; i < arrlen(strings); i++) {
+		if (!check_string(k, strings[i])) return false;
+	}
+	return true;
+}
+
+// Maps are written after every node, so their values come after the node with the map
+// rather than after the map
+static bool check_map(RhastCheck* k, const void* parent, ASTMAP_NodeEntry** field, NodeType type) {
+	ASTMAP_NodeEntry* map = *field;
+	if (!map) {
+		arrput(k->empty_maps, field);
+		return true;
+	}
+	const ASTMAP_NodeEntry* items = map - 1;
+	if (!check_array(k, parent, items, sizeof(*items)) || !arrlen(items) || items->key || items->value) return false;
+	for (ptrdiff_t i = 0; i < shlen(map); i++) {
+		if (!map[i].key || !check_string(k, map[i].key) || !check_child(k, parent, map[i].value, type)) return false;
+	}
+	arrput(k->maps, map);
+	return true;
+}
+
+#include "rhast.impl.gen.h"
+
+// === Files ===
+
+/// Writes the tree from a stack rather than recursing, as trees can be as deep as the parser's
+static RhOff write_tree(RhastWriter* w, const AST_Node* root) {
+	RhOff off = write_node(w, root);
+	while (arrlen(w->nodes)) {
+		PendingNode pending = arrpop(w->nodes);
+		void* node = writer_pointer(w, write_node(w, pending.node));
+		if (pending.map >= 0) w->maps[pending.map].entries[pending.entry].value = node;
+		else *WRITER_AT(void*, pending.at) = node;
+	}
+	arrfree(w->nodes);
+	return off;
+}
+
+bool rhast_write(const char* path, const AST_Module* module,
+		int64_t source_mtime, int64_t source_size, uint64_t source_hash) {
+	uint32_t slot = pick_slot(path);
+	RhastWriter w = { .base = slot_address(slot) };
+	RhOff header = writer_reserve(&w, sizeof(RhastHeader), _Alignof(RhastHeader));
+	RhOff root = write_tree(&w, (const AST_Node*) module);
+	write_maps(&w);
+	arrput(w.buf, 0);
+
+	RhastHeader* h = (RhastHeader*) (w.buf + header);
+	memcpy(h->magic, RHAST_MAGIC, sizeof(h->magic));
+	h->version = RHAST_VERSION;
+	h->layout_hash = RHAST_LAYOUT_HASH;
+	h->node_count = w.node_count;
+	h->file_size = arrlen(w.buf);
+	h->base = w.base;
+	h->root = root;
+	h->source_mtime = source_mtime;
+	h->source_size = source_size;
+	h->source_hash = source_hash;
+
+	// Write to a temporary name first so that readers never map a partial file
+	char tmp_path[4096];
+	snprintf(tmp_path, sizeof(tmp_path), "%s.%d.tmp", path, (int) getpid());
+	bool ok = false;
+	FILE* fp = arrlen(w.buf) <= (ptrdiff_t) SLOT_SIZE? fopen(tmp_path, "wb") : NULL;
+	if (fp) {
+		ok = fwrite(w.buf, 1, arrlen(w.buf), fp) == (size_t) arrlen(w.buf);
+		ok = (fclose(fp) == 0) && ok;
+		ok = ok && rename(tmp_path, path) == 0;
+		if (!ok) remove(tmp_path);
+	}
+	arrfree(w.buf);
+	shfree(w.interned);
+	return ok;
+}
+
+struct _rhast_file {
+	const char* base;
+	size_t size;
+	ASTMAP_NodeEntry* ARRAY maps;         // which have an index made for them on the heap
+	ASTMAP_NodeEntry** ARRAY empty_maps;  // looking a key up in no map makes one, on the heap
+};
+
+/// Checks the mapped file, then indexes its maps
+static bool check_file(RhastFile self) {
+	const RhastHeader* h = rhast_header(self);
+	RhastCheck k = { .base = self->base, .size = self->size };
+	k.claimed = calloc(self->size / 512 + 1, sizeof(uint64_t));
+	AST_Node* root = (AST_Node*) (self->base + h->root);
+	bool ok = k.claimed && self->base[self->size - 1] == 0
+		&& claim(&k, h, sizeof(*h)) && claim(&k, self->base + self->size - 1, 1)
+		&& h->root && check_child(&k, h, root, NODE_MODULE);
+	while (ok && arrlen(k.pending)) ok = check_node(&k, arrpop(k.pending));
+	// Each map is emptied and its entries put back, which makes its index: it has the room
+	// for them, so it stays where it is. Each entry is read before anything is written over it.
+	for (ptrdiff_t i = 0; ok && i < arrlen(k.maps); i++) {
+		ASTMAP_NodeEntry* map = k.maps[i];
+		stbds_array_header* header = stbds_header(map - 1);
+		ptrdiff_t len = shlen(map);
+		header->length = 1;
+		for (ptrdiff_t j = 0; j < len; j++) {
+			ASTMAP_NodeEntry entry = map[j];
+			shput(map, entry.key, entry.value);
+		}
+	}
+	arrfree(k.pending);
+	free(k.claimed);
+	if (ok) {
+		self->maps = k.maps;
+		self->empty_maps = k.empty_maps;
+	}
+	else {
+		arrfree(k.maps);
+		arrfree(k.empty_maps);
+	}
+	return ok;
+}
+
+RhastFile rhast_open(const char* path) {
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) return NULL;
+	struct stat st;
+	RhastHeader h;
+	bool ok = fstat(fd, &st) == 0
+		&& pread(fd, &h, sizeof(h), 0) == sizeof(h)
+		&& memcmp(h.magic, RHAST_MAGIC, sizeof(h.magic)) == 0
+		&& h.version == RHAST_VERSION
+		&& h.layout_hash == RHAST_LAYOUT_HASH
+		&& h.file_size == (uint64_t) st.st_size
+		&& h.file_size <= SLOT_SIZE
+		&& rhast_maps((void*) h.base) && (h.base - RHAST_REGION) % SLOT_SIZE == 0
+		&& h.root < h.file_size;
+	// The address is only a hint: the mapping goes elsewhere when something is there already
+	void* base = ok? mmap((void*) h.base, h.file_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+	close(fd);
+	if (base == MAP_FAILED) return NULL;
+	if ((uintptr_t) base != h.base) {
+		munmap(base, h.file_size);
+		return NULL;
+	}
+	RhastFile self = calloc(1, sizeof(struct _rhast_file));
+	self->base = base;
+	self->size = h.file_size;
+	if (!check_file(self)) {
+		munmap(base, self->size);
+		free(self);
+		return NULL;
+	}
+	set_slot_mapped((h.base - RHAST_REGION) >> RHAST_SLOT_BITS, true);
+	return self;
+}
+
+void rhast_close(RhastFile self) {
+	for (ptrdiff_t i = 0; i < arrlen(self->empty_maps); i++) {
+		if (*self->empty_maps[i]) shfree(*self->empty_maps[i]);
+	}
+	arrfree(self->empty_maps);
+	for (ptrdiff_t i = 0; i < arrlen(self->maps); i++) {
+		stbds_array_header* h = stbds_header(self->maps[i] - 1);
+		free(h->hash_table);
+		h->hash_table = NULL;
+	}
+	arrfree(self->maps);
+	set_slot_mapped(((uintptr_t) self->base - RHAST_REGION) >> RHAST_SLOT_BITS, false);
+	munmap((void*) self->base, self->size);
+	free(self);
+}
+
+const RhastHeader* rhast_header(RhastFile self) {
+	return (const RhastHeader*) self->base;
+}
+
+AST_Module* rhast_module(RhastFile self) {
+	return (AST_Module*) (self->base + rhast_header(self)->root);
+}
@@ -0,0 +1,60 @@
+#pragma once
+// .rhast: a parsed module as it is in memory, to be mapped back in and used in place
+//
+// Layout: RhastHeader, then the nodes, arrays and strings, then the maps, and a final 0 byte.
+// Nodes are the AST_* structs themselves and arrays and maps are stb_ds ones, with pointers
+// made for the address the file is written to be mapped at, so a mapped file needs no fixups.
+// That address is one of the slots of a region kept for these files; a file whose slot is
+// taken isn't loaded. Only the maps' hash indexes are made when loading.
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "ast.h"
+
+#define RHAST_MAGIC "RHAS"
+#define RHAST_VERSION 5
+#define RHAST_EXTENSION ".rhast"
+
+#define RHAST_REGION ((uintptr_t) 0x300000000000)  // 48 TiB, clear of the binary, heap, libraries and ASan's shadow
+#define RHAST_SLOT_BITS 28                          // 256 MiB for each file at most
+#define RHAST_SLOTS (1 << 14)
+
+typedef uint32_t RhOff;
+
+typedef struct {
+	char magic[4];
+	uint32_t version;
+	uint32_t layout_hash;  // changes whenever ast_nodes.h changes shape
+	uint32_t node_count;
+	uint64_t file_size;
+	uint64_t base;         // the address the file is mapped at, which its pointers are made for
+	RhOff root;
+	uint32_t _pad;
+	// Identity of the source file this was produced from (see LoadedModule)
+	int64_t source_mtime;
+	int64_t source_size;
+	uint64_t source_hash;
+} RhastHeader;
+
+typedef struct _rhast_file* RhastFile;
+
+/// Serializes the module to `path`. Returns false on I/O errors, or if it is too large.
+bool rhast_write(const char* path, const AST_Module* module,
+	int64_t source_mtime, int64_t source_size, uint64_t source_hash);
+
+/// Maps a .rhast file at its address, after checking that everything in it stays in it.
+/// Returns NULL if it is missing, truncated, damaged, produced by a different version of
+/// the compiler, or its address is taken.
+RhastFile rhast_open(const char* path);
+void rhast_close(RhastFile file);
+
+const RhastHeader* rhast_header(RhastFile file);
+
+/// The module, used in place: it is valid as long as the file is open. Its nodes, arrays and
+/// maps are in the mapping, which is private, so passes may change them but not grow them.
+AST_Module* rhast_module(RhastFile file);
+
+/// Whether memory is in a mapped .rhast file, where it isn't to be freed or grown
+static inline bool rhast_maps(const void* p) {
+	return (uintptr_t) p - RHAST_REGION < (uintptr_t) RHAST_SLOTS << RHAST_SLOT_BITS;
+}
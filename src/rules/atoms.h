@@ -1,12 +1,14 @@
 // To be included *only* from parser.c
 
 static AST_Name* simple_name(Parser self) {
+	PROFILE_RULE(simple_name);
 	NEW_NODE(n, NODE_NAME);
 	n->name = POP().str_value;
 	RETURN(n);
 }
 
 static AST_Qualname* qualname(Parser self) {
+	PROFILE_RULE(qualname);
 	NEW_NODE(qn, NODE_QUALNAME);
 	EXPECT(TOK_IDENT, "Expected an identifier here");
 	do {
@@ -34,6 +36,7 @@ static const char* join_qualname(Parser self, AST_Qualname* qn) {
 }
 
 static AST_Int* null_literal(Parser self) {
+	PROFILE_RULE(null_literal);
 	NEW_NODE(leaf, NODE_NULL);
 	EXPECT(TOK_NULL, "Expected null here");
 	POP();
@@ -41,6 +44,7 @@ static AST_Int* null_literal(Parser self) {
 }
 
 static AST_Int* int_literal(Parser self) {
+	PROFILE_RULE(int_literal);
 	NEW_NODE(leaf, NODE_INT);
 	EXPECT(TOK_INT, "Expected an integer here");
 	leaf->value = POP().int_value;
@@ -48,6 +52,7 @@ static AST_Int* int_literal(Parser self) {
 }
 
 static AST_Float* float_literal(Parser self) {
+	PROFILE_RULE(float_literal);
 	NEW_NODE(leaf, NODE_FLOAT);
 	EXPECT(TOK_FLOAT, "Expected a float here");
 	leaf->value = POP().float_value;
@@ -55,6 +60,7 @@ static AST_Float* float_literal(Parser self) {
 }
 
 static AST_Bool* bool_literal(Parser self) {
+	PROFILE_RULE(bool_literal);
 	NEW_NODE(leaf, NODE_BOOL);
 	EXPECT(TOK_BOOL, "Expected a boolean here");
 	leaf->value = POP().bool_value;
@@ -62,6 +68,7 @@ static AST_Bool* bool_literal(Parser self) {
 }
 
 static AST_Char* char_literal(Parser self) {
+	PROFILE_RULE(char_literal);
 	NEW_NODE(leaf, NODE_CHAR);
 	EXPECT(TOK_CHAR, "Expected a character here");
 	leaf->value = POP().char_value;
@@ -69,6 +76,7 @@ static AST_Char* char_literal(Parser self) {
 }
 
 static AST_String* string_literal(Parser self) {
+	PROFILE_RULE(string_literal);
 	NEW_NODE(leaf, NODE_STRING);
 	EXPECT(TOK_STRING, "Expected a string here");
 	const char* first = POP().str_value;
@@ -97,6 +105,7 @@ static AST_String* string_literal(Parser self) {
 }
 
 static AST_Node* atom(Parser self) {
+	PROFILE_RULE(atom);
 	switch (TOP().type) {
 		case TOK_NULL: return null_literal(self);
 		case TOK_INT: return int_literal(self);
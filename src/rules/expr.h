@@ -1,487 +1,824 @@
+// Binding powers and the per-token dispatch below come from operators.list
+#include "operators.gen.h"
 
-// Note: precedence uses odd/even to indicate associativity
-//   Even = left associative
-//   Odd = right associative
-
-#define REREF_PRECEDENCE     150
-#define EXP_PRECEDENCE       101
-#define UNARY_PRECEDENCE      99
-#define MULDIV_PRECEDENCE     80
-#define ADDSUB_PRECEDENCE     70
-#define WORD_PRECEDENCE       60
-#define ORELSE_PRECEDENCE     50
-#define TERNARY_PRECEDENCE    40
-#define BAR_PRECEDENCE        30
-#define AWAIT_PRECEDENCE      20
-#define CMP_PRECEDENCE        10
-#define NOT_PRECEDENCE         8
-#define AND_PRECEDENCE         6
-#define OR_PRECEDENCE          4
-#define SEMICOLON_PRECEDENCE   2
-
-static int precedence_of(char first_char) {
-	switch (first_char) {
-		case '^':
-			return EXP_PRECEDENCE;
-		case '*': case '/': case '%': case '&':
-			return MULDIV_PRECEDENCE;
-		case '+': case '-': case '~':
-			return ADDSUB_PRECEDENCE;
-		default:  // word operators
-			return WORD_PRECEDENCE;
-		case '?':
-			return ORELSE_PRECEDENCE;
-		case '|':
-			return BAR_PRECEDENCE;
-		case '=': case '>': case '<':
-			return CMP_PRECEDENCE;
-		case ';':
-			return SEMICOLON_PRECEDENCE;
+static bool is_comparison(int type) {
+	return expr_rule(type)->infix == EXPR_INFIX_COMPARISON;
+}
+
+// expression() doesn't recurse for sub-expressions. Each pending sub-expression is a
+// frame on self->expr_stack, and `resume` says what its parent does with the result.
+// Machine-generated sources can nest as deep as memory allows.
+
+typedef enum {
+	EXPR_RESUME_CALLER,  // the frame expression() was called for
+	EXPR_RESUME_OPERAND,  // store in *slot and finish the node
+	EXPR_RESUME_PAREN,
+	EXPR_RESUME_WORD_OP,
+	EXPR_RESUME_COMPARISON,
+	EXPR_RESUME_TERNARY_CONDITION,
+	EXPR_RESUME_TERNARY_FALSE,
+	EXPR_RESUME_ARRAY_FIRST,
+	EXPR_RESUME_ARRAY_ELEMENT,
+	EXPR_RESUME_RANGE_END,
+	EXPR_RESUME_RANGE_STEP,
+	EXPR_RESUME_CALL_ARG,
+	EXPR_RESUME_CALL_KWARG,
+	EXPR_RESUME_SUBSCRIPT,
+	EXPR_RESUME_SLICE_END,
+	EXPR_RESUME_SLICE_STEP,
+} ExprResume;
+
+typedef struct _expr_frame {
+	AST_Node* sub_expr;  // parsed so far
+	AST_Node* node;      // construct waiting on a sub-expression
+	AST_Slice* slice;    // slice being built inside the subscript in `node`
+	AST_Node** slot;     // for EXPR_RESUME_OPERAND
+	const char* key;     // named argument being parsed
+	Token mark;          // '[' of an array literal or '..' of a slice; copied, it might fall off the buffer
+	int precedence_before;
+	uint8_t resume;      // ExprResume
+	bool ternary_seen;   // to make ternary non-associative
+	bool seen_kwarg;
+} ExprFrame;
+
+inline static ptrdiff_t expr_push(Parser self, int precedence_before, ExprResume resume) {
+	arrpush(self->expr_stack, ((ExprFrame) {
+		.precedence_before = precedence_before,
+		.resume = resume,
+		.ternary_seen = TERNARY_PRECEDENCE == precedence_before,
+	}));
+	return arrlen(self->expr_stack) - 1;
+}
+
+// The current frame. Rules called from here may grow the stack, so never hold on to a pointer
+#define F (self->expr_stack[top])
+
+// Parses a sub-expression in a new frame; its result comes back through RESUME
+#define SUB_EXPRESSION(PRECEDENCE, RESUME) { \
+	top = expr_push(self, PRECEDENCE, RESUME); \
+	continue; \
+}
+
+// Array literals of plain numbers are read in a tight loop. When such a literal turns out
+// rectangular, of one kind of number and large, it becomes a single AST_PackedArray.
+// Anything else met on the way goes back to the frames: what was read so far is replayed
+// from a log into the nodes a normal parse would have made, with frames for the arrays
+// still open, and parsing carries on from there.
+
+#ifndef PACKED_ARRAY_MIN_ELEMENTS
+#define PACKED_ARRAY_MIN_ELEMENTS 64
+#endif
+
+// Beyond this many events, the log is freed after use instead of being kept for the next literal
+#define PACKED_LOG_KEEP 4096
+
+typedef enum {
+	PACKED_EVENT_OPEN,
+	PACKED_EVENT_VALUE,
+	PACKED_EVENT_CLOSE,
+} PackedEventKind;
+
+typedef struct {
+	uint8_t kind;  // PackedEventKind
+	unsigned int start_line, start_col, end_line, end_col;  // of the bracket, or the value with its '-'
+	unsigned int number_line, number_col;  // where the number itself starts
+	const unsigned char* minus;  // text of the '-' before the number, if any
+} PackedEvent;
+
+typedef struct _packed_literal {
+	PackedEvent ARRAY events;
+	intmax_t ARRAY ints;       // values in order, negated ones included
+	long double ARRAY floats;
+	size_t ARRAY counts;  // elements so far in each open array, outermost first
+	size_t ARRAY shape;   // length of the arrays at each depth, 0 until one of them closes
+} PackedLiteral;
+
+typedef enum {
+	PACKED_DONE,   // F.sub_expr is the whole array literal
+	PACKED_NEXT,   // F.node is an unfinished array literal; carry on at its next element
+	PACKED_FIRST,  // F still waits for the first element of its array
+} PackedOutcome;
+
+static void packed_literal_reset(PackedLiteral* pk) {
+	if (arrcap(pk->events) > PACKED_LOG_KEEP) {
+		arrfree(pk->events);
+		arrfree(pk->ints);
+		arrfree(pk->floats);
 	}
+	if (pk->events) stbds_header(pk->events)->length = 0;
+	if (pk->ints) stbds_header(pk->ints)->length = 0;
+	if (pk->floats) stbds_header(pk->floats)->length = 0;
+	if (pk->counts) stbds_header(pk->counts)->length = 0;
+	if (pk->shape) stbds_header(pk->shape)->length = 0;
 }
 
-static bool is_comparison(int type) {
-	switch (type) {
-		case TOK_EQ:
-		case TOK_NE:
-		case TOK_LT:
-		case TOK_LE:
-		case TOK_GT:
-		case TOK_GE:
-			return true;
-		default:
-			return false;
+static void packed_literal_destroy(PackedLiteral* pk) {
+	if (!pk) return;
+	packed_literal_reset(pk);
+	arrfree(pk->events);
+	arrfree(pk->ints);
+	arrfree(pk->floats);
+	arrfree(pk->counts);
+	arrfree(pk->shape);
+	free(pk);
+}
+
+static void packed_log_bracket(PackedLiteral* pk, PackedEventKind kind, const Token* bracket) {
+	arrput(pk->events, ((PackedEvent) {
+		.kind = kind,
+		.start_line = bracket->start_line, .start_col = bracket->start_col,
+		.end_line = bracket->end_line, .end_col = bracket->end_col,
+	}));
+}
+
+// Whether the tokens from `offset` on could start an element of a packed array
+static bool packed_element_ahead(Parser self, int offset) {
+	int type = LOOKAHEAD(offset).type;
+	if (type == TOK_MINUS) type = LOOKAHEAD(offset + 1).type;
+	return type == TOK_INT || type == TOK_FLOAT || type == TOK_LSQUARE;
+}
+
+// Whether a number ('-' included) makes up the whole element ahead, and in how many tokens
+static bool packed_number_ahead(Parser self, int* n_tokens) {
+	int n = TOP().type == TOK_MINUS;
+	int type = LOOKAHEAD(n).type;
+	if (type != TOK_INT && type != TOK_FLOAT) return false;
+	type = LOOKAHEAD(n + 1).type;
+	*n_tokens = n + 1;
+	return type == TOK_COMMA || type == TOK_RSQUARE;
+}
+
+typedef struct {
+	const PackedEvent* open;
+	AST_ArrayLiteral* arr;  // made along with its first element
+} PackedLevel;
+
+static void packed_replay_add(Parser self, PackedLevel* level, AST_Node* element) {
+	if (!level->arr) {
+		NEW_NODE_FROM(arr, NODE_ARRAY, level->open);
+		level->arr = arr;
 	}
+	arrpush(level->arr->elements, element);
 }
 
-static AST_Node* expression(Parser self, int precedence_before) {
-	AST_Node* sub_expr = 0;
-	bool ternary_seen = TERNARY_PRECEDENCE == precedence_before;  // to make ternary non-associative
-	while (1) {
-		switch (TOP().type) {
-			case TOK_IDENT:
-			case TOK_INT:
-			case TOK_FLOAT:
-			case TOK_BOOL:
-			case TOK_STRING:
-			case TOK_CHAR:
-			case TOK_NULL:
-				if (sub_expr) SYNTAX_ERROR("Unexpected atom in expression");
-				APPLY(sub_expr, atom);
+// Builds the nodes for everything logged, and frames for the arrays still open
+static PackedOutcome packed_replay(Parser self, ptrdiff_t* top_inout, bool ints) {
+	PackedLiteral* pk = self->packed;
+	ptrdiff_t top = *top_inout;
+	PackedLevel ARRAY levels = NULL;
+	size_t next_value = 0;
+	for (int i = 0; i < arrlen(pk->events); i++) {
+		const PackedEvent* ev = &pk->events[i];
+		switch (ev->kind) {
+			case PACKED_EVENT_OPEN:
+				arrput(levels, ((PackedLevel) { ev, NULL }));
 				break;
 
-			case TOK_BACKSLASH:
-				if (sub_expr) {  // word operator
-					POP();  // '\'
-					EXPECT(TOK_IDENT, "Expected qualified name here (for word operator)");
-					APPLY(sub_expr, word_op, sub_expr);
+			case PACKED_EVENT_VALUE: {
+				AST_Node* number;
+				if (ints) {
+					AST_Int* leaf = node_create(self, NODE_INT);
+					leaf->value = pk->ints[next_value++];
+					if (ev->minus) leaf->value = -leaf->value;
+					number = (AST_Node*) leaf;
 				}
-				else {  // use for annotations? intrinsics?
-					SYNTAX_ERROR("Unexpected backslash");
+				else {
+					AST_Float* leaf = node_create(self, NODE_FLOAT);
+					leaf->value = pk->floats[next_value++];
+					if (ev->minus) leaf->value = -leaf->value;
+					number = (AST_Node*) leaf;
 				}
-				break;
+				number->start_line = ev->number_line;
+				number->start_col = ev->number_col;
+				number->end_line = ev->end_line;
+				number->end_col = ev->end_col;
+				if (ev->minus) {
+					NEW_NODE_FROM(op, NODE_UNARY, ev);
+					op->op = ev->minus;
+					op->expr = number;
+					op->end_line = ev->end_line;
+					op->end_col = ev->end_col;
+					number = (AST_Node*) op;
+				}
+				packed_replay_add(self, &arrlast(levels), number);
+			} break;
 
-			case TOK_PLUS:
-			case TOK_MINUS:
-			case TOK_STAR:
-			case TOK_SLASH:
-			case TOK_TILDE:
-			case TOK_PERCENT:
-			case TOK_CARET:
-			case TOK_AMP:
-			case TOK_BAR:
-			case TOK_QMARK:
-			case TOK_CUSTOM_OPERATOR:
-				if (sub_expr) {
-					if (LOOKAHEAD(1).type == TOK_ASSIGN) RETURN(sub_expr);
-					char first_char = TOP().literal_text[0];
-					int precedence = precedence_of(first_char);
-					if (precedence >= (precedence_before | 1)) {
-						NEW_NODE_FROM(op, NODE_BINOP, sub_expr);
-						op->lhs = sub_expr;
-						op->op = POP().literal_text;
-						APPLY(op->rhs, expression, precedence_of(op->op[0]));
-						FINISH(op);
-						sub_expr = op;
-					}
-					else RETURN(sub_expr);
+			case PACKED_EVENT_CLOSE: {
+				// Arrays are only closed with an element in them
+				AST_ArrayLiteral* arr = arrpop(levels).arr;
+				arr->end_line = ev->end_line;
+				arr->end_col = ev->end_col;
+				if (arrlen(levels)) {
+					packed_replay_add(self, &arrlast(levels), (AST_Node*) arr);
 				}
 				else {
-					NEW_NODE(op, NODE_UNARY);
-					op->op = POP().literal_text;
-					APPLY(op->expr, expression, UNARY_PRECEDENCE);
-					FINISH(op);
-					sub_expr = op;
+					F.sub_expr = arr;
 				}
-				break;
+			} break;
+		}
+	}
 
-			case TOK_AT:
-				if (sub_expr) SYNTAX_ERROR("Re-referencing must occur before a value");
-				else {
-					NEW_NODE(reref, NODE_REREFERENCE);
-					do {
-						POP();  // '@'
-						reref->levels++;
-					}
-					while (TOP().type == TOK_AT);
-					APPLY(reref->target, expression, REREF_PRECEDENCE);
-					FINISH(reref);
-					sub_expr = reref;
-				}
-				break;
+	PackedOutcome outcome = PACKED_DONE;
+	for (int i = 0; i < arrlen(levels); i++) {
+		if (i > 0) {
+			// The outermost array is F's own; each inner one is an element of the one before
+			top = expr_push(self, 0, levels[i - 1].arr? EXPR_RESUME_ARRAY_ELEMENT : EXPR_RESUME_ARRAY_FIRST);
+			F.mark = (Token) {
+				.type = TOK_LSQUARE,
+				.start_line = levels[i].open->start_line, .start_col = levels[i].open->start_col,
+				.end_line = levels[i].open->end_line, .end_col = levels[i].open->end_col,
+			};
+		}
+		F.node = levels[i].arr;
+		outcome = levels[i].arr? PACKED_NEXT : PACKED_FIRST;
+	}
+	arrfree(levels);
+	*top_inout = top;
+	return outcome;
+}
 
-			case KW_NOT:
-				if (sub_expr) SYNTAX_ERROR("Boolean 'not' must precede a value");
-				else {
-					POP();  // 'not'
-					NEW_NODE(op, NODE_NOT);
-					APPLY(op->expr, expression, UNARY_PRECEDENCE);
-					FINISH(op);
-					sub_expr = op;
-				}
-				break;
+// Called with the '[' popped into F.mark, and packed_element_ahead() true
+static PackedOutcome packed_array(Parser self, ptrdiff_t* top_inout) {
+	ptrdiff_t top = *top_inout;
+	if (!self->packed) self->packed = calloc(1, sizeof(PackedLiteral));
+	PackedLiteral* pk = self->packed;
+	int kind = -1;  // token type of the numbers
+	int leaf = -1;  // depth of the arrays that hold them
+	packed_log_bracket(pk, PACKED_EVENT_OPEN, &F.mark);
+	arrput(pk->counts, 0);
+	arrput(pk->shape, 0);
 
-			case KW_AND:
-				if (!sub_expr) SYNTAX_ERROR("Boolean 'and' requires an expression to its left");
-				else if (AND_PRECEDENCE > precedence_before) {
-					POP();  // 'and'
-					NEW_NODE_FROM(op, NODE_AND, sub_expr);
-					op->lhs = sub_expr;
-					APPLY(op->rhs, expression, AND_PRECEDENCE);
-					FINISH(op);
-					sub_expr = op;
-				}
-				else RETURN(sub_expr);
-				break;
+	while (1) {
+		// At an element
+		ptrdiff_t depth = arrlen(pk->counts) - 1;
+		int type = TOP().type;
+		if (type == TOK_LSQUARE) {
+			if ((leaf >= 0 && leaf <= depth) || !packed_element_ahead(self, 1)) goto hand_back;
+			packed_log_bracket(pk, PACKED_EVENT_OPEN, &POP());
+			arrput(pk->counts, 0);
+			if (arrlen(pk->shape) == depth + 1) arrput(pk->shape, 0);
+			continue;
+		}
+		if (type != TOK_RSQUARE) {  // ']' after a trailing comma
+			int n;
+			if (!packed_number_ahead(self, &n)) goto hand_back;
+			type = LOOKAHEAD(n - 1).type;
+			if ((leaf >= 0 && leaf != depth) || (kind >= 0 && kind != type)) goto hand_back;
+			leaf = depth;
+			kind = type;
+
+			PackedEvent ev = { .kind = PACKED_EVENT_VALUE };
+			if (n == 2) {
+				const Token* minus = lexer_pop_token(self->lex);
+				ev.start_line = minus->start_line;
+				ev.start_col = minus->start_col;
+				ev.minus = minus->literal_text;
+			}
+			const Token* number = lexer_pop_token(self->lex);
+			if (!ev.minus) {
+				ev.start_line = number->start_line;
+				ev.start_col = number->start_col;
+			}
+			ev.number_line = number->start_line;
+			ev.number_col = number->start_col;
+			ev.end_line = number->end_line;
+			ev.end_col = number->end_col;
+			if (kind == TOK_INT) arrput(pk->ints, ev.minus? -number->int_value : number->int_value);
+			else arrput(pk->floats, ev.minus? -number->float_value : number->float_value);
+			arrput(pk->events, ev);
+			pk->counts[depth]++;
+		}
+
+		// After an element, only ',' or ']' can come
+		while (TOP().type == TOK_RSQUARE) {
+			depth = arrlen(pk->counts) - 1;
+			if (pk->shape[depth] && pk->shape[depth] != pk->counts[depth]) goto hand_back;
+			// Inner arrays must be whole elements too
+			if (depth > 0 && LOOKAHEAD(1).type != TOK_COMMA && LOOKAHEAD(1).type != TOK_RSQUARE) goto hand_back;
+			pk->shape[depth] = pk->counts[depth];
+			packed_log_bracket(pk, PACKED_EVENT_CLOSE, &POP());
+			arrsetlen(pk->counts, depth);
+			if (depth == 0) goto done;
+			pk->counts[depth - 1]++;
+		}
+		POP();  // ','
+	}
+
+done: {
+		size_t n_values = kind == TOK_INT? arrlen(pk->ints) : arrlen(pk->floats);
+		if (n_values < PACKED_ARRAY_MIN_ELEMENTS) goto hand_back;
+		NEW_NODE_FROM(packed, NODE_PACKED_ARRAY, &F.mark);
+		arrsetlen(packed->shape, leaf + 1);
+		memcpy(packed->shape, pk->shape, (leaf + 1) * sizeof(size_t));
+		if (kind == TOK_INT) {
+			packed->kind = PACKED_INT;
+			arrsetlen(packed->ints, n_values);
+			memcpy(packed->ints, pk->ints, n_values * sizeof(intmax_t));
+		}
+		else {
+			packed->kind = PACKED_FLOAT;
+			arrsetlen(packed->floats, n_values);
+			for (size_t i = 0; i < n_values; i++) packed->floats[i] = pk->floats[i];
+		}
+		FINISH(packed);
+		F.sub_expr = packed;
+		packed_literal_reset(pk);
+		return PACKED_DONE;
+	}
+
+hand_back: {
+		PackedOutcome outcome = packed_replay(self, top_inout, kind != TOK_FLOAT);
+		packed_literal_reset(pk);
+		return outcome;
+	}
+}
+
+inline static AST_Node* expression_frames(Parser self, int precedence_before) {
+	const ptrdiff_t base = expr_push(self, precedence_before, EXPR_RESUME_CALLER);
+	ptrdiff_t top = base;
+	AST_Node* value = NULL;  // from the frame that just finished
+	ExprResume resume = EXPR_RESUME_CALLER;
+	while (1) {
+		if (value) {
+			AST_Node* result = value;
+			value = NULL;
+			switch (resume) {
+				case EXPR_RESUME_OPERAND:
+					*F.slot = result;
+					FINISH(F.node);
+					F.sub_expr = F.node;
+					break;
+
+				case EXPR_RESUME_PAREN:
+					CONSUME(TOK_RPAREN, "Expected ')' at end of parenthesized sub-expression");
+					FINISH(result);
+					F.sub_expr = result;
+					break;
 
-			case KW_OR:
-				if (!sub_expr) SYNTAX_ERROR("Boolean 'or' requires an expression to its left");
-				else if (OR_PRECEDENCE > precedence_before) {
-					POP();  // 'or'
-					NEW_NODE_FROM(op, NODE_OR, sub_expr);
-					op->lhs = sub_expr;
-					APPLY(op->rhs, expression, OR_PRECEDENCE);
+				case EXPR_RESUME_WORD_OP: {
+					AST_FuncCall* op = F.node;
+					arrpush(op->pos_args, result);
 					FINISH(op);
-					sub_expr = op;
-				}
-				else RETURN(sub_expr);
-				break;
+					F.sub_expr = op;
+				} break;
 
-			case TOK_EQ:
-			case TOK_NE:
-			case TOK_LT:
-			case TOK_LE:
-			case TOK_GT:
-			case TOK_GE:
-				if (!sub_expr) SYNTAX_ERROR("Comparison operator is missing left side expression");
-				else if (CMP_PRECEDENCE > precedence_before) {
-					NEW_NODE_FROM(chain, NODE_COMPARISON, sub_expr);
-					arrpush(chain->operands, sub_expr);
-					do {
+				case EXPR_RESUME_COMPARISON: {
+					AST_ComparisonChain* chain = F.node;
+					arrpush(chain->operands, result);
+					if (is_comparison(TOP().type)) {
 						const char* cmp = POP().literal_text;  // TODO: consider enum representations instead of string
 						arrpush(chain->comparisons, cmp);
-						APPEND(chain->operands, expression, CMP_PRECEDENCE);
-					} while (is_comparison(TOP().type));
+						SUB_EXPRESSION(CMP_PRECEDENCE, EXPR_RESUME_COMPARISON);
+					}
 					FINISH(chain);
-					sub_expr = chain;
-				}
-				else RETURN(sub_expr);
-				break;
+					F.sub_expr = chain;
+				} break;
 
-			case KW_IF:
-				if (!sub_expr) SYNTAX_ERROR("'if' requires a preceding sub-expression in an expression context");
-				else if (TERNARY_PRECEDENCE > precedence_before) {
-					if (ternary_seen) SYNTAX_ERROR("ternary is non-associative");
-					NEW_NODE_FROM(ternary, NODE_TERNARY, sub_expr);
-					ternary->true_expr = sub_expr;
-					POP();  // 'if'
-					APPLY(ternary->condition, expression, 0);
+				case EXPR_RESUME_TERNARY_CONDITION: {
+					AST_Ternary* ternary = F.node;
+					ternary->condition = result;
 					EXPECT(KW_ELSE, "Expected 'else' after ternary condition");
 					POP(); // 'else'
-					APPLY(ternary->false_expr, expression, TERNARY_PRECEDENCE);
+					SUB_EXPRESSION(TERNARY_PRECEDENCE, EXPR_RESUME_TERNARY_FALSE);
+				}
+
+				case EXPR_RESUME_TERNARY_FALSE: {
+					AST_Ternary* ternary = F.node;
+					ternary->false_expr = result;
 					FINISH(ternary);
-					sub_expr = ternary;
-					ternary_seen = true;
+					F.sub_expr = ternary;
+					F.ternary_seen = true;
+				} break;
+
+				case EXPR_RESUME_ARRAY_FIRST:
+					switch (TOP().type) {
+						case TOK_COMMA:
+							POP();
+							// drop through is intentional
+						case TOK_RSQUARE: {
+							NEW_NODE_FROM(arr, NODE_ARRAY, &F.mark);
+							arrpush(arr->elements, result);
+							F.node = arr;
+							goto array_next;
+						}
+						case KW_FOR:
+							SYNTAX_ERROR("Array comprehensions are not implemented yet.");
+						case TOK_RANGE: {
+							NEW_NODE_FROM(arr_range, NODE_ARRAY_RANGE, &F.mark);
+							arr_range->start = result;
+							arr_range->is_inclusive = POP().is_inclusive;
+							F.node = arr_range;
+							SUB_EXPRESSION(0, EXPR_RESUME_RANGE_END);
+						}
+						default:
+							SYNTAX_ERROR("Expected comma, 'for', range, or end of array");
+					}
+
+				case EXPR_RESUME_ARRAY_ELEMENT: {
+					AST_ArrayLiteral* arr = F.node;
+					arrpush(arr->elements, result);
+					if (TOP().type == TOK_COMMA) POP();
+					else if (TOP().type != TOK_RSQUARE) SYNTAX_ERROR("Expected a comma here.");
+					goto array_next;
+				}
+
+				case EXPR_RESUME_RANGE_END: {
+					AST_ArrayRange* arr_range = F.node;
+					arr_range->end = result;
+					if (TOP().type == TOK_COLON) {
+						POP();
+						SUB_EXPRESSION(0, EXPR_RESUME_RANGE_STEP);
+					}
+					goto range_done;
 				}
-				else RETURN(sub_expr);
-				break;
 
-			case KW_ELSE:
-				if (!sub_expr || TERNARY_PRECEDENCE < precedence_before) SYNTAX_ERROR("Unexpected 'else' in expression");
-				else RETURN(sub_expr);
+				case EXPR_RESUME_RANGE_STEP: {
+					AST_ArrayRange* arr_range = F.node;
+					arr_range->step = result;
+					goto range_done;
+				}
 
-			case KW_ASYNC:
-				if (sub_expr) SYNTAX_ERROR("'async' must come before an expression, not after");
-				else {
+				case EXPR_RESUME_CALL_ARG: {
+					AST_FuncCall* call = F.node;
+					arrpush(call->pos_args, result);
+					goto argument_separator;
+				}
+
+				case EXPR_RESUME_CALL_KWARG: {
+					AST_FuncCall* call = F.node;
+					shput(call->kw_args, F.key, result);
+					goto argument_separator;
+				}
+
+				case EXPR_RESUME_SUBSCRIPT:
+					if (TOP().type == TOK_RANGE) {
+						NEW_NODE_FROM(slice, NODE_SLICE, result);
+						slice->start = result;
+						F.slice = slice;
+						goto slice_range;
+					}
+					else {
+						AST_Subscript* sub = F.node;
+						arrpush(sub->subscripts, result);
+						goto subscript_separator;
+					}
+
+				case EXPR_RESUME_SLICE_END:
+					F.slice->end = result;
+					if (TOP().type != TOK_COLON) goto slice_done;
+					goto slice_step;
+
+				case EXPR_RESUME_SLICE_STEP:
+					F.slice->step = result;
+					goto slice_done;
+			}
+			continue;
+		}
+
+		const ExprRule* rule = expr_rule(TOP().type);
+		if (!F.sub_expr) {
+			switch (rule->prefix) {
+				case EXPR_PREFIX_ATOM: {
+					AST_Node* atom_node;
+					APPLY(atom_node, atom);
+					F.sub_expr = atom_node;
+				} break;
+
+				case EXPR_PREFIX_UNARY: {
+					NEW_NODE(op, NODE_UNARY);
+					op->op = POP().literal_text;
+					F.node = op;
+					F.slot = &op->expr;
+					SUB_EXPRESSION(UNARY_PRECEDENCE, EXPR_RESUME_OPERAND);
+				}
+
+				case EXPR_PREFIX_REREF: {
+					NEW_NODE(reref, NODE_REREFERENCE);
+					do {
+						POP();  // '@'
+						reref->levels++;
+					}
+					while (TOP().type == TOK_AT);
+					F.node = reref;
+					F.slot = &reref->target;
+					SUB_EXPRESSION(REREF_PRECEDENCE, EXPR_RESUME_OPERAND);
+				}
+
+				case EXPR_PREFIX_NOT: {
+					POP();  // 'not'
+					NEW_NODE(op, NODE_NOT);
+					F.node = op;
+					F.slot = &op->expr;
+					SUB_EXPRESSION(UNARY_PRECEDENCE, EXPR_RESUME_OPERAND);
+				}
+
+				case EXPR_PREFIX_ASYNC: {
 					NEW_NODE(async, NODE_ASYNC);
 					POP();  // 'async'
-					APPLY(async->target, expression, UNARY_PRECEDENCE);
-					FINISH(async);
-					sub_expr = async;
+					F.node = async;
+					F.slot = &async->target;
+					SUB_EXPRESSION(UNARY_PRECEDENCE, EXPR_RESUME_OPERAND);
 				}
-				break;
 
-			case KW_AWAIT:
-				if (sub_expr) SYNTAX_ERROR("'await' must come before an expression, not after");
-				else {
+				case EXPR_PREFIX_AWAIT: {
 					NEW_NODE(await, NODE_AWAIT);
 					POP();  // 'await'
-					APPLY(await->target, expression, UNARY_PRECEDENCE);
-					FINISH(await);
-					sub_expr = await;
+					F.node = await;
+					F.slot = &await->target;
+					SUB_EXPRESSION(UNARY_PRECEDENCE, EXPR_RESUME_OPERAND);
 				}
-				break;
 
-			case KW_TYPE:
-				if (sub_expr) SYNTAX_ERROR("'type' must precede a type");
-				else {
+				case EXPR_PREFIX_TYPE: {
+					AST_Node* type_node;
 					POP();  // 'type'
 					if (TOP().type == TOK_LSQUARE) {
 						POP();  // '['
-						APPLY(sub_expr, type, 0);
+						APPLY(type_node, type, 0);
 						CONSUME(TOK_RSQUARE, "Bracketed type must end with a ']'");
 					}
-					else APPLY(sub_expr, type, 0);
-				}
-				break;
+					else APPLY(type_node, type, 0);
+					F.sub_expr = type_node;
+				} break;
 
-			case TOK_LPAREN:
-				if (sub_expr) {
-					APPLY(sub_expr, func_call, sub_expr);
-				}
-				else {
+				case EXPR_PREFIX_PAREN:
 					POP();  // '('
-					APPLY(sub_expr, expression, 0);
-					CONSUME(TOK_RPAREN, "Expected ')' at end of parenthesized sub-expression");
-					FINISH(sub_expr);
-				}
-				break;
+					SUB_EXPRESSION(0, EXPR_RESUME_PAREN);
 
-			case TOK_LSQUARE:
-				if (sub_expr) {
-					if (LOOKAHEAD(1).type == TOK_RSQUARE) {
-						NEW_NODE_FROM(broadcast, NODE_BROADCAST, sub_expr);
-						POP(); POP();  // []
-						broadcast->target = sub_expr;
-						sub_expr = broadcast;
+				case EXPR_PREFIX_ARRAY:
+					F.mark = POP();  // '['
+					if (TOP().type == TOK_RSQUARE) {
+						NEW_NODE_FROM(arr, NODE_ARRAY, &F.mark);
+						POP();
+						FINISH(arr);
+						F.sub_expr = arr;
+						break;
 					}
-					else {
-						APPLY(sub_expr, subscript, sub_expr);
+					if (packed_element_ahead(self, 0)) {
+						switch (packed_array(self, &top)) {
+							case PACKED_DONE: break;
+							case PACKED_NEXT: goto array_next;
+							case PACKED_FIRST: SUB_EXPRESSION(0, EXPR_RESUME_ARRAY_FIRST);
+						}
+						break;
 					}
-				}
-				else {
-					APPLY(sub_expr, array_of_some_sort);
-				}
-				FINISH(sub_expr);
-				break;
+					SUB_EXPRESSION(0, EXPR_RESUME_ARRAY_FIRST);
 
-			case TOK_LBRACE:
-				if (sub_expr) RETURN(sub_expr);
-				else {
+				case EXPR_PREFIX_BLOCK: {
 					// TODO: trigger a syntax warning when this is used in an if, for, while, or match
 					// Suggest user add parens around block
-					APPLY(sub_expr, block);
-				}
-				break;
-
-			case TOK_DOT:
-				if (!sub_expr) SYNTAX_ERROR("Expected value before field access");
-				else {
-					POP();  // '.'
-					NEW_NODE_FROM(field_access, NODE_FIELD_ACCESS, sub_expr);
-					field_access->base = sub_expr;
-					APPLY(field_access->field, qualname);
-					sub_expr = field_access;
-					FINISH(sub_expr);
-				}
-				break;
+					AST_Node* blk;
+					APPLY(blk, block);
+					F.sub_expr = blk;
+				} break;
 
-			case DIR_READ:
-				if (sub_expr) SYNTAX_ERROR("#read cannot be used in contexts where a string is not valid");
-				else {
+				case EXPR_PREFIX_READ: {
 					NEW_NODE(str, NODE_STRING);
 					POP();
 					EXPECT(TOK_STRING, "Expected name of file to read");
 					unsigned int end_col = TOP().end_col;
 					const unsigned char* filename = POP().str_value;
+					self->item_reads_files = true;
 					if (!(str->value = read_entire_file(filename))) {
 						OUTPUT_ERROR(str->start_line, str->start_col, str->start_line, end_col,
 							"File error", "Unable to open '%s'", filename);
 						self->error_count++;
 						return NULL;
 					}
-					sub_expr = str;
-					FINISH(sub_expr);
-				}
-				break;
+					F.sub_expr = str;
+					FINISH(F.sub_expr);
+				} break;
 
-			default:
-			case TOK_EOL:
-			case TOK_RPAREN:
-			case TOK_RBRACE:
-			case TOK_RSQUARE:
-				if (sub_expr) RETURN(sub_expr);
-				// Drop through is intentional
-				SYNTAX_ERROR("Expected an expression here");
+				default:
+					SYNTAX_ERROR("%s", rule->misuse? rule->misuse : "Expected an expression here");
+			}
+			continue;
 		}
-	}
-}
 
+		switch (rule->infix) {
+			case EXPR_INFIX_END:
+				goto finished;
+			case EXPR_INFIX_NONE:
+				SYNTAX_ERROR("%s", rule->misuse);
+		}
+		int precedence = rule->precedence? rule->precedence : OPERATOR_PRECEDENCE[(unsigned char) TOP().literal_text[0]];
+		if (precedence < (F.precedence_before | 1)) goto finished;
 
-static AST_FuncCall* word_op(Parser self, AST_Node* left_side) {
-	NEW_NODE_FROM(op, NODE_FUNC_CALL, left_side);
-	op->is_word_op = true;
-	APPLY(op->func, qualname);
-	arrpush(op->pos_args, left_side);
-	APPEND(op->pos_args, expression, WORD_PRECEDENCE);
-	RETURN(op);
-}
+		switch (rule->infix) {
+			case EXPR_INFIX_BINOP: {
+				if (LOOKAHEAD(1).type == TOK_ASSIGN) goto finished;
+				NEW_NODE_FROM(op, NODE_BINOP, F.sub_expr);
+				op->lhs = F.sub_expr;
+				op->op = POP().literal_text;
+				F.node = op;
+				F.slot = &op->rhs;
+				SUB_EXPRESSION(precedence, EXPR_RESUME_OPERAND);
+			}
 
-static AST_Array* array_of_some_sort(Parser self) {
-	Token arr_start = POP();  // copy the token because it might fall off the buffer when parsing the element
-	if (TOP().type == TOK_RSQUARE) {
-		NEW_NODE_FROM(arr, NODE_ARRAY, &arr_start);
-		POP();
-		RETURN(arr);
-	}
-	AST_Node* first = expression(self, 0);
-	if (!first) return NULL;
-	switch (TOP().type) {
-		case TOK_COMMA:
-			POP();
-			// drop through is intentional
-		case TOK_RSQUARE: {
-			NEW_NODE_FROM(arr, NODE_ARRAY, &arr_start);
-			arrpush(arr->elements, first);
-			while (TOP().type != TOK_RSQUARE) {
-				APPEND(arr->elements, expression, 0);
-				if (TOP().type == TOK_COMMA) POP();
-				else if (TOP().type != TOK_RSQUARE) SYNTAX_ERROR("Expected a comma here.");
+			case EXPR_INFIX_WORD_OP: {
+				POP();  // '\\'
+				EXPECT(TOK_IDENT, "Expected qualified name here (for word operator)");
+				NEW_NODE_FROM(op, NODE_FUNC_CALL, F.sub_expr);
+				op->is_word_op = true;
+				APPLY(op->func, qualname);
+				arrpush(op->pos_args, F.sub_expr);
+				F.node = op;
+				SUB_EXPRESSION(WORD_PRECEDENCE, EXPR_RESUME_WORD_OP);
 			}
-			POP();  // ']'
-			RETURN(arr);
+
+			case EXPR_INFIX_AND: {
+				POP();  // 'and'
+				NEW_NODE_FROM(op, NODE_AND, F.sub_expr);
+				op->lhs = F.sub_expr;
+				F.node = op;
+				F.slot = &op->rhs;
+				SUB_EXPRESSION(AND_PRECEDENCE, EXPR_RESUME_OPERAND);
+			}
+
+			case EXPR_INFIX_OR: {
+				POP();  // 'or'
+				NEW_NODE_FROM(op, NODE_OR, F.sub_expr);
+				op->lhs = F.sub_expr;
+				F.node = op;
+				F.slot = &op->rhs;
+				SUB_EXPRESSION(OR_PRECEDENCE, EXPR_RESUME_OPERAND);
+			}
+
+			case EXPR_INFIX_COMPARISON: {
+				NEW_NODE_FROM(chain, NODE_COMPARISON, F.sub_expr);
+				arrpush(chain->operands, F.sub_expr);
+				const char* cmp = POP().literal_text;  // TODO: consider enum representations instead of string
+				arrpush(chain->comparisons, cmp);
+				F.node = chain;
+				SUB_EXPRESSION(CMP_PRECEDENCE, EXPR_RESUME_COMPARISON);
+			}
+
+			case EXPR_INFIX_TERNARY: {
+				if (F.ternary_seen) SYNTAX_ERROR("ternary is non-associative");
+				NEW_NODE_FROM(ternary, NODE_TERNARY, F.sub_expr);
+				ternary->true_expr = F.sub_expr;
+				POP();  // 'if'
+				F.node = ternary;
+				SUB_EXPRESSION(0, EXPR_RESUME_TERNARY_CONDITION);
+			}
+
+			case EXPR_INFIX_CALL: {
+				NEW_NODE_FROM(call, NODE_FUNC_CALL, F.sub_expr);
+				POP();  // '('
+				call->func = F.sub_expr;
+				F.node = call;
+				F.seen_kwarg = false;
+				goto next_argument;
+			}
+
+			case EXPR_INFIX_SUBSCRIPT:
+				if (LOOKAHEAD(1).type == TOK_RSQUARE) {
+					NEW_NODE_FROM(broadcast, NODE_BROADCAST, F.sub_expr);
+					POP(); POP();  // []
+					broadcast->target = F.sub_expr;
+					F.sub_expr = broadcast;
+					FINISH(F.sub_expr);
+				}
+				else {
+					NEW_NODE_FROM(sub, NODE_SUBSCRIPT, F.sub_expr);
+					POP();  // '['
+					sub->array = F.sub_expr;
+					F.node = sub;
+					goto next_subscript;
+				}
+				break;
+
+			case EXPR_INFIX_FIELD_ACCESS: {
+				POP();  // '.'
+				NEW_NODE_FROM(field_access, NODE_FIELD_ACCESS, F.sub_expr);
+				field_access->base = F.sub_expr;
+				APPLY(field_access->field, qualname);
+				F.sub_expr = field_access;
+				FINISH(F.sub_expr);
+			} break;
 		}
-		case KW_FOR: {
-			SYNTAX_ERROR("Array comprehensions are not implemented yet.");
-			NEW_NODE_FROM(arr_comp, NODE_ARRAY_COMP, &arr_start);
+		continue;
+
+		// Array literals and ranges
+	array_next: {
+			AST_ArrayLiteral* arr = F.node;
+			if (TOP().type != TOK_RSQUARE) SUB_EXPRESSION(0, EXPR_RESUME_ARRAY_ELEMENT);
+			POP();  // ']'
+			FINISH(arr);
+			F.sub_expr = arr;
+			continue;
 		}
-		case TOK_RANGE: {
-			NEW_NODE_FROM(arr_range, NODE_ARRAY_RANGE, &arr_start);
-			arr_range->start = first;
-			arr_range->is_inclusive = POP().is_inclusive;
-			APPLY(arr_range->end, expression, 0);
-			if (TOP().type == TOK_COLON) {
-				POP();
-				APPLY(arr_range->step, expression, 0);
-			}
+	range_done: {
 			CONSUME(TOK_RSQUARE, "Expected a ']' at end of range array.");
-			RETURN(arr_range);
+			FINISH(F.node);
+			F.sub_expr = F.node;
+			continue;
 		}
-		default:
-			SYNTAX_ERROR("Expected comma, 'for', range, or end of array");
-	}
-}
 
-static AST_FuncCall* func_call(Parser self, AST_Node* func) {
-	NEW_NODE_FROM(call, NODE_FUNC_CALL, func);
-	POP();  // '('
-	call->func = func;
-	bool seen_kwarg = false;
-	while (TOP().type != TOK_RPAREN) {
-		if (TOP().type == TOK_COMMA) {
-			SYNTAX_ERROR("Expected an argument to be supplied here");
-		}
-		else if (TOP().type == TOK_IDENT && LOOKAHEAD(1).type == TOK_ASSIGN) {
-			seen_kwarg = true;
-			const char* key = TOP().str_value;
-			if (shgeti(call->kw_args, key) >= 0) SYNTAX_ERROR_NONFATAL("Repeated named argument '%s'", key);
-			POP();  // Identifier
-			POP();  // '='
-			if (call->kw_args == NULL) {
-				sh_new_arena(call->kw_args);
+		// Call arguments
+	next_argument: {
+			AST_FuncCall* call = F.node;
+			if (TOP().type == TOK_RPAREN) {
+				POP();  // ')'
+				FINISH(call);
+				F.sub_expr = call;
+				continue;
+			}
+			if (TOP().type == TOK_COMMA) {
+				SYNTAX_ERROR("Expected an argument to be supplied here");
+			}
+			else if (TOP().type == TOK_IDENT && LOOKAHEAD(1).type == TOK_ASSIGN) {
+				F.seen_kwarg = true;
+				const char* key = TOP().str_value;
+				if (shgeti(call->kw_args, key) >= 0) SYNTAX_ERROR_NONFATAL("Repeated named argument '%s'", key);
+				POP();  // Identifier
+				POP();  // '='
+				if (call->kw_args == NULL) {
+					sh_new_arena(call->kw_args);
+				}
+				F.key = key;
+				SUB_EXPRESSION(0, EXPR_RESUME_CALL_KWARG);
+			}
+			else {
+				if (F.seen_kwarg) SYNTAX_ERROR_NONFATAL("Positional arguments cannot be supplied after named arguments.");
+				SUB_EXPRESSION(0, EXPR_RESUME_CALL_ARG);
 			}
-			AST_Node* value;
-			APPLY(value, expression, 0);
-			shput(call->kw_args, key, value);
-		}
-		else {
-			if (seen_kwarg) SYNTAX_ERROR_NONFATAL("Positional arguments cannot be supplied after named arguments.");
-			APPEND(call->pos_args, expression, 0);
 		}
+	argument_separator:
 		if (TOP().type == TOK_COMMA) POP();
 		else if (TOP().type != TOK_RPAREN) SYNTAX_ERROR("Expected a comma here.");
-	}
-	POP();  // ')'
-	RETURN(call); // will be FINISHed by caller
-}
-
-inline static AST_Slice* finish_slice(Parser self, AST_Slice* slice) {
-	switch (TOP().type) {
-		case TOK_RANGE: {
-			const Token* range_token = &POP();
-			slice->is_inclusive = range_token->is_inclusive;
-			switch (TOP().type) {
-				case TOK_COMMA:
-					if (!slice->is_inclusive) {
-						SYNTAX_ERROR("Exclusive slice must have an explicit end value");
-					}
-					goto exit;
-				default:
-					APPLY(slice->end, expression, 0);
-					if (TOP().type != TOK_COLON) goto exit;
-				case TOK_COLON:
-					if (!slice->is_inclusive) {
-						SYNTAX_ERROR("Exclusive slice must have an explicit end value");
-					}
-					if (!slice->start && !slice->end) {
-						OUTPUT_ERROR(
-							range_token->start_line, range_token->start_col,
-							range_token->end_line, range_token->end_col,
-							"Syntax note", "subscript slice has no bounds and can be omitted here");
-					}
-					break;
-			}
-		}
-			// drop-thru is intentional
-		case TOK_COLON:
-			POP();
-			APPLY(slice->step, expression, 0);
-	}
-	exit:
-	RETURN(slice);
-}
+		goto next_argument;
 
-static AST_Subscript* subscript(Parser self, AST_Node* array) {
-	NEW_NODE_FROM(sub, NODE_SUBSCRIPT, array);
-	POP();  // '['
-	sub->array = array;
-	do {
+		// Subscripts and slices
+	next_subscript:
 		if (TOP().type == TOK_RANGE) {
 			NEW_NODE(slice, NODE_SLICE);
-			if (!finish_slice(self, slice)) return NULL;
-			arrpush(sub->subscripts, slice);
+			F.slice = slice;
+			goto slice_range;
 		}
 		else if (TOP().type == TOK_COLON) {
 			NEW_NODE(slice, NODE_SLICE);
-			APPLY(slice->step, expression, 0);
-			arrpush(sub->subscripts, slice);
+			F.slice = slice;
+			SUB_EXPRESSION(0, EXPR_RESUME_SLICE_STEP);
 		}
-		else {
-			AST_Node* sub_expr = expression(self, 0);
-			if (!sub_expr) return NULL;
-			if (TOP().type == TOK_RANGE) {
-				NEW_NODE_FROM(slice, NODE_SLICE, sub_expr);
-				slice->start = sub_expr;
-				if (!finish_slice(self, slice)) return NULL;
-				arrpush(sub->subscripts, slice);
-			}
-			else {
-				arrpush(sub->subscripts, sub_expr);
-			}
+		SUB_EXPRESSION(0, EXPR_RESUME_SUBSCRIPT);
+	slice_range:
+		F.mark = POP();  // '..'
+		F.slice->is_inclusive = F.mark.is_inclusive;
+		switch (TOP().type) {
+			case TOK_COMMA:
+				if (!F.slice->is_inclusive) {
+					SYNTAX_ERROR("Exclusive slice must have an explicit end value");
+				}
+				goto slice_done;
+			case TOK_COLON:
+				goto slice_step;
+			default:
+				SUB_EXPRESSION(0, EXPR_RESUME_SLICE_END);
+		}
+	slice_step:
+		if (!F.slice->is_inclusive) {
+			SYNTAX_ERROR("Exclusive slice must have an explicit end value");
+		}
+		if (!F.slice->start && !F.slice->end) {
+			OUTPUT_ERROR(
+				F.mark.start_line, F.mark.start_col,
+				F.mark.end_line, F.mark.end_col,
+				"Syntax note", "subscript slice has no bounds and can be omitted here");
 		}
+		POP();  // ':'
+		SUB_EXPRESSION(0, EXPR_RESUME_SLICE_STEP);
+	slice_done: {
+			AST_Subscript* sub = F.node;
+			FINISH(F.slice);
+			arrpush(sub->subscripts, F.slice);
+		}
+	subscript_separator:
 		if (TOP().type == TOK_COMMA) POP();
 		else if (TOP().type != TOK_RSQUARE) SYNTAX_ERROR("Expected a comma here.");
-	} while (TOP().type != TOK_RSQUARE);
-	POP();  // ']'
-	RETURN(sub);
+		if (TOP().type != TOK_RSQUARE) goto next_subscript;
+		POP();  // ']'
+		FINISH(F.node);
+		F.sub_expr = F.node;
+		continue;
+
+	finished:  // F is complete; hand it to the frame that asked for it
+		FINISH(F.sub_expr);
+		if (top == base) return F.sub_expr;
+		value = F.sub_expr;
+		resume = F.resume;
+		arrsetlen(self->expr_stack, top);
+		top--;
+	}
+}
+
+#undef SUB_EXPRESSION
+#undef F
+
+static AST_Node* expression(Parser self, int precedence_before) {
+	PROFILE_RULE(expression);
+	ENTER_NESTED();
+	ptrdiff_t base = arrlen(self->expr_stack);
+	AST_Node* result = expression_frames(self, precedence_before);
+	arrsetlen(self->expr_stack, base);
+	return result;
 }
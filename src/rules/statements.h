@@ -13,6 +13,7 @@
 } while (0);
 
 static AST_Node* statement(Parser self) {
+	PROFILE_RULE(statement);
 	AST_Node* stmt = NULL;
 	while (!stmt) {
 		switch (TOP().type) {
@@ -60,6 +61,19 @@ static AST_Node* statement(Parser self) {
 				END_STMT(assert_stmt, "assertion");
 			}
 
+			case DIR_PRE:
+			case DIR_POST:
+			case DIR_ASSUME: {
+				NEW_NODE(contract, NODE_CONTRACT);
+				switch (POP().type) {
+					case DIR_PRE:  contract->kind = CONTRACT_PRE; break;
+					case DIR_POST: contract->kind = CONTRACT_POST; break;
+					default:       contract->kind = CONTRACT_ASSUME; break;
+				}
+				APPLY(contract->condition, expression, 0);
+				END_STMT(contract, "'#%s' condition", contract->kind == CONTRACT_PRE? "pre" : contract->kind == CONTRACT_POST? "post" : "assume");
+			}
+
 			case KW_DEFER: {
 				if (LOOKAHEAD(1).type == KW_DEFER) SYNTAX_ERROR("Repeated 'defer'");
 				NEW_NODE(defer, NODE_DEFER);
@@ -148,6 +162,7 @@ static AST_Node* statement(Parser self) {
 } break
 
 static AST_VarDecl* declaration(Parser self) {
+	PROFILE_RULE(declaration);
 	NEW_NODE(var, NODE_VAR_DECL);
 
 	EXPECT(TOK_IDENT, "Expected name of variable");
@@ -186,6 +201,8 @@ static AST_VarDecl* declaration(Parser self) {
 #undef DECL_SPECIAL
 
 static AST_Block* block(Parser self) {
+	PROFILE_RULE(block);
+	ENTER_NESTED();
 	NEW_NODE(blk, NODE_BLOCK);
 	POP();  // '{'
 	int errors_before = self->error_count;
@@ -201,7 +218,8 @@ static AST_Block* block(Parser self) {
 				switch (POP().type) {
 					case TOK_LBRACE: depth++; break;
 					case TOK_RBRACE: depth--; break;
-					case TOK_EOL: if (depth == 0) return NULL;
+					case TOK_EOL: if (depth == 0) return NULL; break;
+					case TOK_EOF: return NULL;
 				}
 				if (depth < 0) return NULL;
 			}
@@ -213,6 +231,7 @@ static AST_Block* block(Parser self) {
 }
 
 static AST_IfStatement* if_stmt(Parser self) {
+	PROFILE_RULE(if_stmt);
 	NEW_NODE(cond, NODE_IF_STMT);
 	POP();  // 'if'
 	APPLY(cond->condition, expression, 0);
@@ -237,6 +256,7 @@ static AST_IfStatement* if_stmt(Parser self) {
 }
 
 static AST_WhileLoop* while_loop(Parser self) {
+	PROFILE_RULE(while_loop);
 	NEW_NODE(loop, NODE_WHILE_LOOP);
 	POP();  // 'while'
 	APPLY(loop->condition, expression, 0);
@@ -279,6 +299,7 @@ inline static AST_Node* for_simple_or_range(Parser self, AST_Name* name, AST_Nod
 }
 
 static AST_Node* for_range(Parser self) {
+	PROFILE_RULE(for_range);
 	if (TOP().type == TOK_IDENT) {
 		switch (LOOKAHEAD(1).type) {
 			case TOK_COLON: {
@@ -337,6 +358,7 @@ static AST_Node* for_range(Parser self) {
 }
 
 static AST_ForLoop* for_loop(Parser self) {
+	PROFILE_RULE(for_loop);
 	NEW_NODE(loop, NODE_FOR_LOOP);
 	POP();  // 'for'
 	while (1) {
@@ -359,6 +381,7 @@ static AST_ForLoop* for_loop(Parser self) {
 }
 
 static AST_AssignChain* assignment(Parser self, AST_Node* lhs) {
+	PROFILE_RULE(assignment);
 	NEW_NODE_FROM(assign, NODE_ASSIGN, lhs);
 	arrpush(assign->dest_exprs, lhs);
 	while (1) {
@@ -389,10 +412,12 @@ static AST_AssignChain* assignment(Parser self, AST_Node* lhs) {
 }
 
 static AST_AssignParallel* assign_many(Parser self, AST_Node* ARRAY lhs) {
+	PROFILE_RULE(assign_many);
 	SYNTAX_ERROR("Parallel assignments are not yet implemented");
 }
 
 static AST_OpAssign* op_assignment(Parser self, AST_Node* lhs) {
+	PROFILE_RULE(op_assignment);
 	NEW_NODE_FROM(assign, NODE_OP_ASSIGN, lhs);
 	assign->dest_expr = lhs;
 	assign->op = POP().literal_text;
@@ -402,13 +427,16 @@ static AST_OpAssign* op_assignment(Parser self, AST_Node* lhs) {
 }
 
 static AST_Node* type_match(Parser self) {
+	PROFILE_RULE(type_match);
 	SYNTAX_ERROR("Type matching not yet supported");
 }
 
 static AST_Node* pattern_match(Parser self) {
+	PROFILE_RULE(pattern_match);
 	SYNTAX_ERROR("Pattern matching not yet supported");
 }
 
 static AST_With* with_block(Parser self) {
+	PROFILE_RULE(with_block);
 	SYNTAX_ERROR("'with' blocks not yet supported");
 }
@@ -13,6 +13,7 @@
 #define ADD_DECL(K, V) ADD_ITEM(module->scope, K, V, "module '%s'", self->filename)
 
 static int toplevel_item(Parser self, AST_Module* module) {
+	PROFILE_RULE(toplevel_item);
 	while (TOP().type == TOK_EOL) POP();  // filter empty lines
 
 	bool is_pub = TOP().type == KW_PUB? (POP(), true) : false;
@@ -55,7 +56,13 @@ static int toplevel_item(Parser self, AST_Module* module) {
 					self->error_count++;
 					return 0;
 				}
-				ADD_DECL(func->name, func);
+				if (ast_is_operator_name(func->name->name)) {
+					// An operator can have any number of overloads
+					char namebuf[32];
+					snprintf(namebuf, sizeof(namebuf), "<op_%d>", (int) shlen(module->scope));
+					shput(module->scope, namebuf, func);
+				}
+				else ADD_DECL(func->name, func);
 				CONSUME(TOK_EOL, "Expected end-of-line after function definition");
 				return 1;
 			}
@@ -177,6 +184,32 @@ static int toplevel_item(Parser self, AST_Module* module) {
 			else return 0;
 		} break;
 
+		case DIR_RUN: {
+			if (is_pub) SYNTAX_ERROR_NONFATAL("'pub' cannot be applied to #run");
+			NEW_NODE(run, NODE_RUN);
+			POP();  // '#run'
+			if (TOP().type == TOK_EOL) SYNTAX_ERROR("Expected a statement to run");
+			APPLY(run->statement, statement);
+			FINISH(run);  // the statement has eaten its end of line, unless it is a block
+			char namebuf[32];
+			snprintf(namebuf, sizeof(namebuf), "<run_%d>", (int) shlen(module->scope));
+			shput(module->scope, namebuf, run);
+			return 1;
+		}
+
+		case DIR_WARN: {
+			if (is_pub) SYNTAX_ERROR_NONFATAL("'pub' cannot be applied to #warn");
+			NEW_NODE(warn, NODE_WARN);
+			POP();  // '#warn'
+			EXPECT(TOK_IDENT, "Expected the name of a warning to turn on");
+			warn->warning = POP().str_value;
+			FINISH(warn);
+			char namebuf[32];
+			snprintf(namebuf, sizeof(namebuf), "<warn_%d>", (int) shlen(module->scope));
+			shput(module->scope, namebuf, warn);
+			break;
+		}
+
 		case TOK_RPAREN: SYNTAX_ERROR("Unmatched parenthesis");
 		case TOK_RBRACE: SYNTAX_ERROR("Unmatched curly brace");
 		case TOK_RSQUARE: SYNTAX_ERROR("Unmatched square bracket");
@@ -196,6 +229,7 @@ static int toplevel_item(Parser self, AST_Module* module) {
 }
 
 static AST_Const* const_def(Parser self) {
+	PROFILE_RULE(const_def);
 	NEW_NODE(constant, NODE_CONST);
 
 	EXPECT(TOK_IDENT, "Expected name of constant");
@@ -219,13 +253,15 @@ static AST_Const* const_def(Parser self) {
 	RETURN(constant);
 }
 
-#define ADD_FIELD(M, F, T) ADD_ITEM((M)->fields, (F)->name, F, T " '%s'", (M)->name)
+#define ADD_FIELD(M, F, T) ADD_ITEM((M)->fields, (F)->name, F, T " '%s'", (M)->name->name)
 
 static AST_Node* table_def(Parser self) {
+	PROFILE_RULE(table_def);
 	return 0;
 }
 
 static AST_Struct* struct_def(Parser self) {
+	PROFILE_RULE(struct_def);
 	NEW_NODE(structure, NODE_STRUCT);
 	POP();  // 'struct'
 
@@ -302,6 +338,10 @@ static AST_Struct* struct_def(Parser self) {
 							POP();
 							APPLY(field->default_value, expression, 0);
 						}
+						if (TOP().type == (int) DIR_INVARIANT) {
+							POP();
+							APPLY(field->invariant, expression, 0);
+						}
 						FINISH(field);
 						ADD_FIELD(structure, field, "struct");
 						CONSUME(TOK_EOL, "Expected end-of-line after struct field");
@@ -329,6 +369,7 @@ static AST_Struct* struct_def(Parser self) {
 }
 
 static AST_Enum* enum_def(Parser self) {
+	PROFILE_RULE(enum_def);
 	NEW_NODE(enumeration, NODE_ENUM);
 	POP();  // 'enum'
 
@@ -364,6 +405,7 @@ static AST_Enum* enum_def(Parser self) {
 }
 
 static AST_Import* import(Parser self) {
+	PROFILE_RULE(import);
 	NEW_NODE(imp, NODE_IMPORT);
 	POP();  // 'import'
 	switch (TOP().type) {
@@ -427,10 +469,28 @@ static AST_Import* import(Parser self) {
 }
 
 static AST_FuncDef* func_def(Parser self) {
+	PROFILE_RULE(func_def);
 	NEW_NODE(func, NODE_FUNC_DEF);
 	POP();  // 'func'
 	switch (TOP().type) {
 		case TOK_IDENT:
+		// Operator overloads
+		case TOK_PLUS:
+		case TOK_MINUS:
+		case TOK_STAR:
+		case TOK_SLASH:
+		case TOK_TILDE:
+		case TOK_PERCENT:
+		case TOK_CARET:
+		case TOK_AMP:
+		case TOK_BAR:
+		case TOK_EQ:
+		case TOK_NE:
+		case TOK_LT:
+		case TOK_LE:
+		case TOK_GT:
+		case TOK_GE:
+		case TOK_CUSTOM_OPERATOR:
 			APPLY(func->name, simple_name);
 			break;
 		case TOK_LPAREN:
@@ -447,9 +507,15 @@ static AST_FuncDef* func_def(Parser self) {
 			CONSUME(TOK_COMMA, "Expected comma after lone ellipsis in parameter list");
 			EXPECT(TOK_IDENT, "Expected a keyword-only parameter after lone ellipsis");
 		}
+		bool allow_alias = false;
+		if (TOP().type == (int) DIR_ALLOW_ALIAS) {
+			POP();
+			allow_alias = true;
+		}
 		if (TOP().type != TOK_IDENT) SYNTAX_ERROR("Expected the name of a parameter");
 		NEW_NODE(param, NODE_PARAM);
 		param->is_kw_only = vararg_seen;
+		param->allow_alias = allow_alias;
 		APPLY(param->name, simple_name);
 		if (shgeti(func->params, param->name->name) >= 0) {
 			SYNTAX_ERROR_FROM_NONFATAL(
@@ -492,6 +558,7 @@ static AST_FuncDef* func_def(Parser self) {
 }
 
 static AST_Test* test_def(Parser self) {
+	PROFILE_RULE(test_def);
 	NEW_NODE(test, NODE_TEST);
 	POP();  // 'test'
 	if (TOP().type == TOK_STRING) {
@@ -1,201 +1,309 @@
-
-
 #define MODIFIER_PRECEDENCE 100
 #define UNION_PRECEDENCE     20
 #define FUNCTYPE_PRECEDENCE  15
 
-#define FUNC_TYPE_RHS() do { \
-	POP();  /* '=>' */ \
-	switch (TOP().type) { \
-		default: \
-			break; \
-		case TOK_LPAREN: \
-			if (LOOKAHEAD(1).type == TOK_RPAREN && LOOKAHEAD(2).type != TOK_ARROW) { \
-				POP();  /* '(' */ \
-				POP();  /* ')' */ \
-				break; \
-			} \
-			/* Drop through is intentional */ \
-		case TOK_ARROW: \
-		case TOK_IDENT: \
-		case TOK_AT: \
-		case TOK_LSQUARE: \
-		case TOK_BAR: \
-			APPLY(func->return_type, type, FUNCTYPE_PRECEDENCE); \
-			break; \
-	} \
+// Like expression(), type() keeps pending sub-types on an explicit stack (self->type_stack)
+
+typedef enum {
+	TYPE_RESUME_CALLER,  // the frame type() was called for
+	TYPE_RESUME_MUTABLE,
+	TYPE_RESUME_OPTIONAL,
+	TYPE_RESUME_POINTER,
+	TYPE_RESUME_ARRAY_ELEMENT,
+	TYPE_RESUME_UNION,
+	TYPE_RESUME_PAREN,
+	TYPE_RESUME_FUNC_PARAM,
+	TYPE_RESUME_FUNC_RETURN,
+} TypeResume;
+
+typedef struct _type_frame {
+	AST_Node* sub_type;  // parsed so far
+	AST_Node* node;      // construct waiting on a sub-type
+	unsigned int mark_line, mark_start_col, mark_end_col;  // modifier, for redundancy warnings
+	int precedence_before;
+	uint8_t resume;      // TypeResume
+} TypeFrame;
+
+inline static ptrdiff_t type_push(Parser self, int precedence_before, TypeResume resume) {
+	arrpush(self->type_stack, ((TypeFrame) { .precedence_before = precedence_before, .resume = resume }));
+	return arrlen(self->type_stack) - 1;
+}
+
+// The current frame. Rules called from here may grow the stack, so never hold on to a pointer
+#define F (self->type_stack[top])
+
+// Parses a sub-type in a new frame; its result comes back through RESUME
+#define SUB_TYPE(PRECEDENCE, RESUME) { \
+	top = type_push(self, PRECEDENCE, RESUME); \
+	continue; \
+}
+
+#define MARK_MODIFIER() do { \
+	F.mark_line = TOP().start_line; \
+	F.mark_start_col = TOP().start_col; \
+	F.mark_end_col = TOP().end_col; \
 } while (0)
 
-static AST_Node* type(Parser self, int precedence_before) {
-	AST_Node* sub_type = NULL;
+inline static AST_Node* type_frames(Parser self, int precedence_before) {
+	const ptrdiff_t base = type_push(self, precedence_before, TYPE_RESUME_CALLER);
+	ptrdiff_t top = base;
+	AST_Node* value = NULL;  // from the frame that just finished
+	TypeResume resume = TYPE_RESUME_CALLER;
 	while (1) {
-		switch(TOP().type) {
-			case TOK_IDENT:
-				if (sub_type) SYNTAX_ERROR("Unexpected identifier in type");
-				else {
-					NEW_NODE(simple, NODE_SIMPLE_TYPE);
-					APPLY(simple->base, qualname);
-					FINISH(simple);
-					sub_type = simple;
-				}
-				break;
-
-			case KW_MUT:
-			case TOK_BANG:
-				if (sub_type) SYNTAX_ERROR("Mutable modifier must precede a type");
-				else {
-					NEW_NODE(mut, NODE_MUTABLE_TYPE);
-					unsigned int line = TOP().start_line;
-					unsigned int sc = TOP().start_col;
-					unsigned int ec = TOP().end_col;
-					POP();
-					APPLY(mut->base, type, MODIFIER_PRECEDENCE);
+		if (value) {
+			AST_Node* result = value;
+			value = NULL;
+			switch (resume) {
+				case TYPE_RESUME_MUTABLE: {
+					AST_MutableType* mut = F.node;
+					mut->base = result;
 					FINISH(mut);
 					if (mut->base->node_type == NODE_MUTABLE_TYPE
 						|| mut->base->node_type == NODE_OPTIONAL_TYPE
 						&& ((AST_OptionalType*) mut->base)->base->node_type == NODE_MUTABLE_TYPE) {
-						OUTPUT_ERROR(line, sc, line, ec, "Syntax warning", "Redundant mutable modifier");
+						OUTPUT_ERROR(F.mark_line, F.mark_start_col, F.mark_line, F.mark_end_col, "Syntax warning", "Redundant mutable modifier");
 						self->warning_count++;
-						sub_type = mut->base;
+						F.sub_type = mut->base;
 					}
 					else {
-						sub_type = mut;
+						F.sub_type = mut;
 					}
-				}
-				break;
+				} break;
 
-			case KW_OPT:
-			case TOK_QMARK:
-				if (sub_type) SYNTAX_ERROR("Optional modifier must precede a type");
-				else {
-					NEW_NODE(opt, NODE_OPTIONAL_TYPE);
-					unsigned int line = TOP().start_line;
-					unsigned int sc = TOP().start_col;
-					unsigned int ec = TOP().end_col;
-					POP();
-					APPLY(opt->base, type, MODIFIER_PRECEDENCE);
+				case TYPE_RESUME_OPTIONAL: {
+					AST_OptionalType* opt = F.node;
+					opt->base = result;
 					FINISH(opt);
 					if (opt->base->node_type == NODE_OPTIONAL_TYPE
 						|| opt->base->node_type == NODE_MUTABLE_TYPE
 						&& ((AST_MutableType*) opt->base)->base->node_type == NODE_OPTIONAL_TYPE) {
-						OUTPUT_ERROR(line, sc, line, ec, "Syntax warning", "Redundant optional modifier");
+						OUTPUT_ERROR(F.mark_line, F.mark_start_col, F.mark_line, F.mark_end_col, "Syntax warning", "Redundant optional modifier");
 						self->warning_count++;
-						sub_type = opt->base;
+						F.sub_type = opt->base;
 					}
 					else if (opt->base->node_type == NODE_MUTABLE_TYPE) {
 						// Enforce canonical order of !? by swapping the nodes
 						AST_MutableType* mut = opt->base;
 						opt->base = mut->base;
 						mut->base = opt;
-						sub_type = mut;
+						F.sub_type = mut;
 					}
 					else {
-						sub_type = opt;
+						F.sub_type = opt;
+					}
+				} break;
+
+				case TYPE_RESUME_POINTER: {
+					AST_PointerType* pointer = F.node;
+					pointer->base = result;
+					FINISH(pointer);
+					F.sub_type = pointer;
+				} break;
+
+				case TYPE_RESUME_ARRAY_ELEMENT: {
+					AST_ArrayType* array = F.node;
+					array->element_type = result;
+					FINISH(array);
+					F.sub_type = array;
+				} break;
+
+				case TYPE_RESUME_UNION: {
+					AST_UnionType* union_chain = F.node;
+					arrpush(union_chain->variants, result);
+					if (TOP().type == TOK_BAR) {
+						POP();  // '|'
+						SUB_TYPE(UNION_PRECEDENCE, TYPE_RESUME_UNION);
+					}
+					FINISH(union_chain);
+					F.sub_type = union_chain;
+				} break;
+
+				case TYPE_RESUME_PAREN:
+					if (TOP().type == TOK_COMMA) {
+						// Oh boy! We have a function type!
+						NEW_NODE_FROM(func, NODE_FUNC_TYPE, result);
+						arrpush(func->param_types, result);
+						F.node = func;
+						POP();  // ','
+						SUB_TYPE(0, TYPE_RESUME_FUNC_PARAM);
 					}
+					EXPECT(TOK_RPAREN, "Expected matching parenthesis here");
+					POP();  // ')'
+					FINISH(result);
+					F.sub_type = result;
+					break;
+
+				case TYPE_RESUME_FUNC_PARAM: {
+					AST_FuncType* func = F.node;
+					arrpush(func->param_types, result);
+					if (TOP().type == TOK_COMMA) {
+						POP();  // ','
+						SUB_TYPE(0, TYPE_RESUME_FUNC_PARAM);
+					}
+					EXPECT(TOK_RPAREN, "Expected end of parameter type list here");
+					POP();  // ')'
+					EXPECT(TOK_ARROW, "Expected function arrow here");
+					goto func_type_rhs;
+				}
+
+				case TYPE_RESUME_FUNC_RETURN: {
+					AST_FuncType* func = F.node;
+					func->return_type = result;
+					FINISH(func);
+					F.sub_type = func;
+				} break;
+			}
+			continue;
+		}
+
+		switch(TOP().type) {
+			case TOK_IDENT:
+				if (F.sub_type) SYNTAX_ERROR("Unexpected identifier in type");
+				else {
+					NEW_NODE(simple, NODE_SIMPLE_TYPE);
+					APPLY(simple->base, qualname);
+					FINISH(simple);
+					F.sub_type = simple;
 				}
 				break;
 
+			case KW_MUT:
+			case TOK_BANG:
+				if (F.sub_type) SYNTAX_ERROR("Mutable modifier must precede a type");
+				else {
+					NEW_NODE(mut, NODE_MUTABLE_TYPE);
+					MARK_MODIFIER();
+					POP();
+					F.node = mut;
+					SUB_TYPE(MODIFIER_PRECEDENCE, TYPE_RESUME_MUTABLE);
+				}
+
+			case KW_OPT:
+			case TOK_QMARK:
+				if (F.sub_type) SYNTAX_ERROR("Optional modifier must precede a type");
+				else {
+					NEW_NODE(opt, NODE_OPTIONAL_TYPE);
+					MARK_MODIFIER();
+					POP();
+					F.node = opt;
+					SUB_TYPE(MODIFIER_PRECEDENCE, TYPE_RESUME_OPTIONAL);
+				}
+
 			case TOK_AT:
-				if (sub_type) SYNTAX_ERROR("Pointer designations must precdede a type");
+				if (F.sub_type) SYNTAX_ERROR("Pointer designations must precdede a type");
 				else {
 					NEW_NODE(pointer, NODE_POINTER_TYPE);
 					POP();
-					APPLY(pointer->base, type, MODIFIER_PRECEDENCE);
-					FINISH(pointer);
-					sub_type = pointer;
+					F.node = pointer;
+					SUB_TYPE(MODIFIER_PRECEDENCE, TYPE_RESUME_POINTER);
 				}
-				break;
 
 			case TOK_LSQUARE:
 				// Maybe this should be a prefix for types?
-				if (sub_type) SYNTAX_ERROR("Array brackets should precede the element type");
+				if (F.sub_type) SYNTAX_ERROR("Array brackets should precede the element type");
 				else {
-					APPLY(sub_type, array_type);
-					FINISH(sub_type);
+					AST_Node* array;
+					APPLY(array, array_type);
+					F.node = array;
+					SUB_TYPE(MODIFIER_PRECEDENCE, TYPE_RESUME_ARRAY_ELEMENT);
 				}
-				break;
 
 			case TOK_BAR:
-				if (!sub_type) SYNTAX_ERROR("Union type chain requires a type to the left");
-				else if (UNION_PRECEDENCE > precedence_before) {
-					NEW_NODE_FROM(union_chain, NODE_UNION, sub_type);
-					arrpush(union_chain->variants, sub_type);
-					do {
-						POP();  // '|'
-						APPEND(union_chain->variants, type, UNION_PRECEDENCE);
-					} while (TOP().type == TOK_BAR);
-					FINISH(union_chain);
-					sub_type = union_chain;
+				if (!F.sub_type) SYNTAX_ERROR("Union type chain requires a type to the left");
+				else if (UNION_PRECEDENCE > F.precedence_before) {
+					NEW_NODE_FROM(union_chain, NODE_UNION, F.sub_type);
+					arrpush(union_chain->variants, F.sub_type);
+					POP();  // '|'
+					F.node = union_chain;
+					SUB_TYPE(UNION_PRECEDENCE, TYPE_RESUME_UNION);
 				}
-				else return sub_type;
-				break;
+				else goto finished;
 
 			case TOK_ARROW:
-				if (FUNCTYPE_PRECEDENCE >= precedence_before) {
+				if (FUNCTYPE_PRECEDENCE >= F.precedence_before) {
 					AST_FuncType* func = node_create(self, NODE_FUNC_TYPE);
-					if (sub_type) {
-						func->start_line = sub_type->start_line;
-						func->start_col = sub_type->start_col;
-						arrpush(func->param_types, sub_type);
+					if (F.sub_type) {
+						func->start_line = F.sub_type->start_line;
+						func->start_col = F.sub_type->start_col;
+						arrpush(func->param_types, F.sub_type);
 					}
 					else {
 						Token t = TOP();
 						func->start_line = t.start_line;
 						func->start_col = t.start_col;
 					}
-					FUNC_TYPE_RHS();
-					FINISH(func);
-					sub_type = func;
+					F.node = func;
+					goto func_type_rhs;
 				}
-				else return sub_type;
-				break;
+				else goto finished;
 
 			case TOK_LPAREN:
-				if (sub_type) SYNTAX_ERROR("Template types are not implemented yet");
+				if (F.sub_type) SYNTAX_ERROR("Template types are not implemented yet");
 				else if (LOOKAHEAD(1).type == TOK_RPAREN && LOOKAHEAD(2).type == TOK_ARROW) {
 					NEW_NODE(func, NODE_FUNC_TYPE);
 					POP();  // '('
 					POP();  // ')'
-					FUNC_TYPE_RHS();
-					FINISH(func);
-					sub_type = func;
+					F.node = func;
+					goto func_type_rhs;
 				}
 				else {
 					POP();  // '('
-					APPLY(sub_type, type, 0);
-					if (TOP().type == TOK_COMMA) {
-						// Oh boy! We have a function type!
-						NEW_NODE_FROM(func, NODE_FUNC_TYPE, sub_type);
-						arrpush(func->param_types, sub_type);
-						do {
-							POP();  // ','
-							APPEND(func->param_types, type, 0);
-						} while (TOP().type == TOK_COMMA);
-						EXPECT(TOK_RPAREN, "Expected end of parameter type list here");
-						POP();  // ')'
-						EXPECT(TOK_ARROW, "Expected function arrow here");
-						FUNC_TYPE_RHS();
-						sub_type = func;
-						FINISH(sub_type);
-					}
-					else {
-						EXPECT(TOK_RPAREN, "Expected matching parenthesis here");
-						POP();  // ')'
-						FINISH(sub_type);
-					}
+					SUB_TYPE(0, TYPE_RESUME_PAREN);
 				}
-				break;
 
 			default:
-				if (sub_type) return sub_type;
+				if (F.sub_type) goto finished;
 				else SYNTAX_ERROR("Expected a type here");
 		}
+		continue;
+
+	func_type_rhs:  // F.node is a function type, at its '=>'
+		POP();  /* '=>' */
+		switch (TOP().type) {
+			default:
+				break;
+			case TOK_LPAREN:
+				if (LOOKAHEAD(1).type == TOK_RPAREN && LOOKAHEAD(2).type != TOK_ARROW) {
+					POP();  /* '(' */
+					POP();  /* ')' */
+					break;
+				}
+				/* Drop through is intentional */
+			case TOK_ARROW:
+			case TOK_IDENT:
+			case TOK_AT:
+			case TOK_LSQUARE:
+			case TOK_BAR:
+				SUB_TYPE(FUNCTYPE_PRECEDENCE, TYPE_RESUME_FUNC_RETURN);
+		}
+		FINISH(F.node);
+		F.sub_type = F.node;
+		continue;
+
+	finished:  // F is complete; hand it to the frame that asked for it
+		if (top == base) return F.sub_type;
+		value = F.sub_type;
+		resume = F.resume;
+		arrsetlen(self->type_stack, top);
+		top--;
 	}
 }
 
-#undef FUNC_TYPE_RHS
+#undef MARK_MODIFIER
+#undef SUB_TYPE
+#undef F
+
+static AST_Node* type(Parser self, int precedence_before) {
+	PROFILE_RULE(type);
+	ENTER_NESTED();
+	ptrdiff_t base = arrlen(self->type_stack);
+	AST_Node* result = type_frames(self, precedence_before);
+	arrsetlen(self->type_stack, base);
+	return result;
+}
 
 static AST_ArrayType* array_type(Parser self) {
+	PROFILE_RULE(array_type);
 	NEW_NODE(array, NODE_ARRAY_TYPE);
 
 	POP();  // '['
@@ -237,7 +345,5 @@ static AST_ArrayType* array_type(Parser self) {
 
 	EXPECT(TOK_RSQUARE, "Expected right square bracket to end array dimensions");
 	POP();  // ']'
-
-	APPLY(array->element_type, type, MODIFIER_PRECEDENCE);
-	return array;
+	return array;  // type() parses the element type
 }
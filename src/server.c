@@ -0,0 +1,415 @@
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+#include "server.h"
+#include "modules.h"
+#include "resolve.h"
+#include "typecheck.h"
+#include "stb_ds.h"
+
+#define MAX_REQUEST_LENGTH (PATH_MAX + 64)
+#define LISTEN_BACKLOG 16
+
+typedef struct {
+	int in, out;         // the same socket, or stdin and stdout; in is -1 once the client is gone
+	char ARRAY pending;  // what has been read past the last complete request
+} Client;
+
+typedef struct {
+	const ServerOptions* options;
+	ModuleGraph graph;
+	// Directories holding loaded modules are watched, and changes to the files in them
+	// are passed on to module_graph_invalidate. -1 if watching is unavailable.
+	int watch_fd;
+	struct { char* key; int value; } MAP watched_dirs;
+	struct { int key; const char* value; } MAP dirs_by_watch;  // keys of watched_dirs
+	int diagnostics_fd;  // stdout and stderr are pointed here while a request runs
+	long long requests;
+	bool shutdown;
+} Server;
+
+static long long now_us(void) {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec * 1000000ll + t.tv_nsec / 1000;
+}
+
+static bool write_all(int fd, const char* data, size_t length) {
+	while (length) {
+		ssize_t n = write(fd, data, length);
+		if (n < 0) {
+			if (errno == EINTR) continue;
+			return false;
+		}
+		data += n;
+		length -= n;
+	}
+	return true;
+}
+
+// === File watching ===
+
+#ifdef __linux__
+#define WATCH_EVENTS (IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO)
+
+static void stop_watching(Server* self) {
+	close(self->watch_fd);
+	self->watch_fd = -1;
+	module_graph_set_watched(self->graph, false);
+	module_graph_invalidate(self->graph, NULL);
+}
+
+/// Watches the directory of every loaded module that isn't watched yet. Editors often
+/// replace files rather than write to them, so files are not watched individually.
+static void watch_new_directories(Server* self) {
+	for (int i = 0; self->watch_fd >= 0 && i < module_graph_count(self->graph); i++) {
+		LoadedModule* mod = module_graph_module(self->graph, i);
+		const char* slash = strrchr(mod->path, '/');
+		if (!mod->ast || !slash) continue;
+		char dir[PATH_MAX];
+		snprintf(dir, sizeof(dir), "%.*s", slash == mod->path? 1 : (int) (slash - mod->path), mod->path);
+		if (shgeti(self->watched_dirs, dir) >= 0) continue;
+
+		int wd = inotify_add_watch(self->watch_fd, dir, WATCH_EVENTS);
+		if (wd < 0) {
+			fprintf(stderr, "Unable to watch '%s' (%s); checking every file on every request instead\n",
+				dir, strerror(errno));
+			stop_watching(self);
+			return;
+		}
+		shput(self->watched_dirs, dir, wd);
+		hmput(self->dirs_by_watch, wd, self->watched_dirs[shgeti(self->watched_dirs, dir)].key);
+		// The files may have changed between being parsed and being watched
+		for (int j = 0; j < module_graph_count(self->graph); j++) {
+			LoadedModule* other = module_graph_module(self->graph, j);
+			const char* other_slash = strrchr(other->path, '/');
+			if (other_slash - other->path == slash - mod->path && strncmp(other->path, mod->path, slash - mod->path) == 0) {
+				module_graph_invalidate(self->graph, other->path);
+			}
+		}
+	}
+}
+
+/// Passes on every change reported since the last call, without blocking
+static void read_file_events(Server* self) {
+	_Alignas(struct inotify_event) char buf[4096];
+	ssize_t length;
+	while (self->watch_fd >= 0 && (length = read(self->watch_fd, buf, sizeof(buf))) > 0) {
+		const struct inotify_event* event;
+		for (char* at = buf; at < buf + length; at += sizeof(struct inotify_event) + event->len) {
+			event = (const struct inotify_event*) at;
+			if (event->mask & IN_Q_OVERFLOW) {
+				module_graph_invalidate(self->graph, NULL);
+				continue;
+			}
+			ptrdiff_t watch = hmgeti(self->dirs_by_watch, event->wd);
+			if (watch < 0) continue;
+			const char* dir = self->dirs_by_watch[watch].value;
+			if (event->mask & IN_IGNORED) {
+				// The directory is gone; it gets watched again if a module is loaded from it
+				(void) hmdel(self->dirs_by_watch, event->wd);
+				(void) shdel(self->watched_dirs, dir);
+				module_graph_invalidate(self->graph, NULL);
+			}
+			else if (event->len) {
+				char path[PATH_MAX];
+				snprintf(path, sizeof(path), "%s/%s", strcmp(dir, "/") == 0? "" : dir, event->name);
+				module_graph_invalidate(self->graph, path);
+			}
+		}
+	}
+}
+
+static void start_watching(Server* self) {
+	self->watch_fd = inotify_init1(IN_NONBLOCK);
+	if (self->watch_fd < 0) {
+		fprintf(stderr, "Unable to watch files (%s); checking every file on every request instead\n",
+			strerror(errno));
+		return;
+	}
+	module_graph_set_watched(self->graph, true);
+}
+#else
+static void watch_new_directories(Server* self) { (void) self; }
+static void read_file_events(Server* self) { (void) self; }
+static void start_watching(Server* self) { self->watch_fd = -1; }
+#endif
+
+// === Requests ===
+
+typedef enum {
+	REPLY_OK,
+	REPLY_FAILED,
+	REPLY_ERROR,
+} ReplyStatus;
+
+static const char* const STATUS_NAMES[] = { "ok", "failed", "error" };
+
+static void print_stats(Server* self, FILE* out) {
+	int n_modules = module_graph_count(self->graph), n_loaded = 0;
+	for (int i = 0; i < n_modules; i++) {
+		if (module_graph_module(self->graph, i)->ast) n_loaded++;
+	}
+	fprintf(out, "modules %d (%d loaded)\n", n_modules, n_loaded);
+	fprintf(out, "memory %zu bytes (limit %zu)\n", module_graph_memory_usage(self->graph), self->options->memory_limit);
+	fprintf(out, "requests %lld\n", self->requests);
+	if (self->watch_fd >= 0) fprintf(out, "watching %d directories\n", (int) shlen(self->watched_dirs));
+	else fprintf(out, "not watching files\n");
+}
+
+/// Resolves and type-checks the module and everything it imports, with their types in one
+/// table, as --check does. Errors are reported to stderr; returns how many there were.
+static int check_module(LoadedModule* root) {
+	LoadedModule* ARRAY stack = NULL;
+	struct { LoadedModule* key; bool value; } MAP seen = NULL;
+	TypeTable table = type_table_create();
+	int n_errors = 0;
+	arrput(stack, root);
+	hmput(seen, root, true);
+	while (arrlen(stack)) {
+		LoadedModule* module = arrpop(stack);
+		for (int i = 0; i < arrlen(module->imports); i++) {
+			if (hmgeti(seen, module->imports[i]) >= 0) continue;
+			hmput(seen, module->imports[i], true);
+			arrput(stack, module->imports[i]);
+		}
+		if (!module->ast) continue;
+		Resolution res = resolve_module(module->ast);
+		TypeCheck check = typecheck_module(module->ast, res, table, NULL);
+		if (typecheck_error_count(check)) {
+			fprintf(stderr, "%s: %d type errors\n", module->path, typecheck_error_count(check));
+		}
+		n_errors += typecheck_error_count(check);
+		typecheck_destroy(check);
+		resolution_destroy(res);
+	}
+	type_table_destroy(table);
+	hmfree(seen);
+	arrfree(stack);
+	return n_errors;
+}
+
+static ReplyStatus run_request(Server* self, const char* command, const char* file, FILE* out) {
+	bool dump_ast = strcmp(command, "dump-ast") == 0, dump_json = strcmp(command, "dump-json") == 0;
+	bool check = strcmp(command, "check") == 0;
+	if (dump_ast || dump_json || check || strcmp(command, "parse") == 0) {
+		if (!*file) {
+			fprintf(stderr, "'%s' needs a file\n", command);
+			return REPLY_ERROR;
+		}
+		if (strcmp(file, "-") == 0) {
+			fprintf(stderr, "The server can't read sources from its standard input\n");
+			return REPLY_ERROR;
+		}
+		read_file_events(self);
+		LoadedModule* root = module_graph_load(self->graph, file);
+		if (!root) return REPLY_FAILED;
+		if (check && check_module(root)) return REPLY_FAILED;
+		if (dump_ast) print_ast(out, (AST_Node*) root->ast);
+		if (dump_json) ast_to_json(out, (AST_Node*) root->ast);
+		return REPLY_OK;
+	}
+	if (strcmp(command, "stats") == 0) {
+		print_stats(self, out);
+		return REPLY_OK;
+	}
+	if (strcmp(command, "shutdown") == 0) {
+		self->shutdown = true;
+		return REPLY_OK;
+	}
+	fprintf(stderr, "Unknown request '%s'\n", command);
+	return REPLY_ERROR;
+}
+
+/// Answers one request line. Returns false if the reply couldn't be sent.
+static bool handle_request(Server* self, Client* client, char* line) {
+	long long start = now_us();
+	self->requests++;
+	size_t length = strlen(line);
+	while (length && (line[length - 1] == '\r' || line[length - 1] == ' ')) line[--length] = 0;
+	while (*line == ' ') line++;
+	char* file = strchr(line, ' ');
+	if (file) {
+		*file++ = 0;
+		while (*file == ' ') file++;
+	}
+	else file = line + strlen(line);
+
+	char* output;
+	size_t output_length;
+	FILE* out = open_memstream(&output, &output_length);
+
+	// Whatever the compiler prints while the request runs is part of the reply
+	fflush(stdout);
+	fflush(stderr);
+	int saved_stdout = dup(STDOUT_FILENO), saved_stderr = dup(STDERR_FILENO);
+	dup2(self->diagnostics_fd, STDOUT_FILENO);
+	dup2(self->diagnostics_fd, STDERR_FILENO);
+	ReplyStatus status = run_request(self, line, file, out);
+	fflush(stdout);
+	fflush(stderr);
+	dup2(saved_stdout, STDOUT_FILENO);
+	dup2(saved_stderr, STDERR_FILENO);
+	close(saved_stdout);
+	close(saved_stderr);
+	fclose(out);
+
+	off_t diagnostics_length = lseek(self->diagnostics_fd, 0, SEEK_END);
+	char* diagnostics = malloc(diagnostics_length + 1);
+	if (pread(self->diagnostics_fd, diagnostics, diagnostics_length, 0) != diagnostics_length) diagnostics_length = 0;
+	if (ftruncate(self->diagnostics_fd, 0) == 0) lseek(self->diagnostics_fd, 0, SEEK_SET);
+
+	// Watch what was just loaded, and make room for the next request
+	watch_new_directories(self);
+	module_graph_evict(self->graph, self->options->memory_limit);
+
+	char header[128];
+	int header_length = snprintf(header, sizeof(header), "%s %lld %zu %lld\n", STATUS_NAMES[status],
+		(long long) diagnostics_length, output_length, now_us() - start);
+	bool sent = write_all(client->out, header, header_length)
+		&& write_all(client->out, diagnostics, diagnostics_length)
+		&& write_all(client->out, output, output_length);
+	free(diagnostics);
+	free(output);
+	return sent;
+}
+
+// === Connections ===
+
+static int listen_on(const char* path) {
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		fprintf(stderr, "Socket path '%s' is too long\n", path);
+		return -1;
+	}
+	strcpy(addr.sun_path, path);
+	// A socket left behind by a server that didn't shut down cleanly
+	struct stat st;
+	if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode)) unlink(path);
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0 || bind(fd, (struct sockaddr*) &addr, sizeof(addr)) != 0 || listen(fd, LISTEN_BACKLOG) != 0) {
+		fprintf(stderr, "Unable to listen on '%s': %s\n", path, strerror(errno));
+		if (fd >= 0) close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+static void close_client(Client* client) {
+	if (client->in != STDIN_FILENO) close(client->in);
+	if (client->out != client->in) close(client->out);
+	client->in = -1;
+	arrfree(client->pending);
+}
+
+/// Reads what the client sent and answers every complete request in it
+static void serve_client(Server* self, Client* client) {
+	char buf[4096];
+	ssize_t n = read(client->in, buf, sizeof(buf));
+	if (n < 0 && errno == EINTR) return;
+	if (n <= 0) {
+		close_client(client);
+		return;
+	}
+	(void) arraddn(client->pending, n);
+	memcpy(&client->pending[arrlen(client->pending) - n], buf, n);
+	char* eol;
+	while (!self->shutdown && (eol = memchr(client->pending, '\n', arrlen(client->pending)))) {
+		*eol = 0;
+		if (!handle_request(self, client, client->pending)) {
+			close_client(client);
+			return;
+		}
+		arrdeln(client->pending, 0, eol - client->pending + 1);
+	}
+	if (arrlen(client->pending) > MAX_REQUEST_LENGTH) {
+		fprintf(stderr, "Dropping a client whose request is longer than %d bytes\n", MAX_REQUEST_LENGTH);
+		close_client(client);
+	}
+}
+
+int server_run(const ServerOptions* options) {
+	Server self = { .options = options, .watch_fd = -1 };
+	FILE* diagnostics = tmpfile();
+	if (!diagnostics) {
+		fprintf(stderr, "Unable to create a file for diagnostics: %s\n", strerror(errno));
+		return 1;
+	}
+	self.diagnostics_fd = fileno(diagnostics);
+	int listener = -1;
+	Client ARRAY clients = NULL;
+	if (options->socket_path) {
+		if ((listener = listen_on(options->socket_path)) < 0) {
+			fclose(diagnostics);
+			return 1;
+		}
+	}
+	else {
+		// Replies get the real stdout; anything else printed there goes to stderr
+		Client client = { STDIN_FILENO, dup(STDOUT_FILENO), NULL };
+		dup2(STDERR_FILENO, STDOUT_FILENO);
+		arrpush(clients, client);
+	}
+	signal(SIGPIPE, SIG_IGN);  // a client that hangs up early only loses its reply
+
+	self.graph = module_graph_create();
+	if (options->cache_dir) module_graph_set_cache_dir(self.graph, options->cache_dir);
+	module_graph_set_share_nodes(self.graph, options->share_nodes);
+	sh_new_strdup(self.watched_dirs);
+	start_watching(&self);
+
+	struct pollfd ARRAY fds = NULL;
+	while (!self.shutdown && (listener >= 0 || arrlen(clients))) {
+		if (fds) stbds_header(fds)->length = 0;
+		arrpush(fds, ((struct pollfd) { self.watch_fd, POLLIN, 0 }));
+		arrpush(fds, ((struct pollfd) { listener, POLLIN, 0 }));
+		for (int i = 0; i < arrlen(clients); i++) arrpush(fds, ((struct pollfd) { clients[i].in, POLLIN, 0 }));
+		if (poll(fds, arrlen(fds), -1) < 0) {
+			if (errno == EINTR) continue;
+			fprintf(stderr, "poll: %s\n", strerror(errno));
+			break;
+		}
+		// Changes are also read right before every load; this only keeps the queue short
+		if (fds[0].revents) read_file_events(&self);
+		for (int i = 0; i < arrlen(clients) && !self.shutdown; i++) {
+			if (fds[2 + i].revents) serve_client(&self, &clients[i]);
+		}
+		for (int i = arrlen(clients) - 1; i >= 0; i--) {
+			if (clients[i].in < 0) arrdel(clients, i);
+		}
+		if (fds[1].revents & POLLIN) {
+			int fd = accept(listener, NULL, NULL);
+			if (fd >= 0) arrpush(clients, ((Client) { fd, fd, NULL }));
+		}
+	}
+	arrfree(fds);
+
+	for (int i = 0; i < arrlen(clients); i++) close_client(&clients[i]);
+	arrfree(clients);
+	if (listener >= 0) {
+		close(listener);
+		unlink(options->socket_path);
+	}
+	if (self.watch_fd >= 0) close(self.watch_fd);
+	hmfree(self.dirs_by_watch);
+	shfree(self.watched_dirs);
+	module_graph_destroy(self.graph);
+	fclose(diagnostics);
+	return 0;
+}
@@ -0,0 +1,26 @@
+#pragma once
+// A compile server: keeps the module graph in memory between requests
+//
+// Requests are lines of the form `COMMAND [FILE]`, with FILE relative to the server's
+// working directory:
+//   parse FILE      loads FILE and everything it imports
+//   check FILE      parse, then resolve and type-check FILE and everything it imports
+//   dump-ast FILE   parse, then print the AST of FILE as the compiler does
+//   dump-json FILE  parse, then print the AST of FILE as JSON
+//   stats           modules held, memory in use, requests served
+//   shutdown        stops the server once the reply is sent
+// Every reply starts with a header line `STATUS DIAGNOSTICS_BYTES OUTPUT_BYTES MICROSECONDS`,
+// followed by that many bytes of diagnostics (what the compiler would print to stderr)
+// and then of output. STATUS is `ok`, `failed` (the sources have errors) or `error` (bad request).
+#include <stddef.h>
+#include <stdbool.h>
+
+typedef struct {
+	const char* socket_path;  // Unix socket to listen on; NULL to answer stdin on stdout
+	const char* cache_dir;    // see module_graph_set_cache_dir
+	size_t memory_limit;      // bytes of ASTs to keep around; least recently used modules go first
+	bool share_nodes;         // see module_graph_set_share_nodes
+} ServerOptions;
+
+/// Answers requests until a shutdown request, or the end of stdin. Returns the exit status.
+int server_run(const ServerOptions* options);
@@ -0,0 +1,1834 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "typecheck.h"
+#include "overload.h"
+#include "pool.h"
+#include "ast_walk.h"
+#include "ast_intern.h"
+#include "util.h"
+#include "stb_ds.h"
+
+#define TYPE_PAGE_BITS 12
+#define MAX_LITERAL_DIMENSIONS 32  // that nested array literals are made one array of
+
+// Types by address, in pages of addresses: the nodes of a function are mostly allocated
+// together, so checking it touches few pages. stb_ds maps aren't used, as making one changes
+// a global that other threads may be making theirs with.
+typedef struct {
+	uintptr_t page;  // 0 = free
+	TypeId* types;   // by address within the page, in steps of 8: the type + 1, or 0 for none
+} TypePage;
+
+typedef struct {
+	TypePage* pages;  // open addressing
+	size_t mask, count;
+} TypeMap;
+
+typedef enum {
+	SYMBOL_PENDING,
+	SYMBOL_IN_PROGRESS,
+	SYMBOL_DONE,
+} SymbolState;
+
+typedef struct {
+	const char* src_file;
+	int line, start_col, end_col;
+	int task, order;  // which body it was found in (-1 for none), and when, to keep it stable
+	char* message;
+} Diagnostic;
+
+// What each thread checking a module has to itself
+typedef struct {
+	struct _type_check* check;
+	TypeTable table;
+	Resolution res;
+	TypeMap exprs;       // by the address of their slot: shared nodes have a type for each use
+	TypeMap type_nodes;  // as semantic types
+	TypeMap checked;     // consts and params checked ahead of the walk
+	TypeMap targets;     // the functions calls and operators resolve to, as symbol ids
+	DispatchCache dispatch;        // the overloads argument types resolved to
+	int n_dispatched;              // calls and operators resolved to overloads
+	AST_FuncDef* ARRAY functions;  // being checked, innermost last; NULL for a test
+	AST_Node** ARRAY* bodies;      // where bodies are put aside to be checked apart, if they are
+	const AST_Node* where;         // the last node with a location, for errors in shared ones
+	AST_Node* const* callee;       // of the last call entered, which may name a builtin
+	AST_Node** ARRAY members;      // the fields of the field accesses entered, which aren't names
+	int task;
+	Diagnostic ARRAY diagnostics;
+	char ARRAY text;               // scratch for messages
+	uint8_t ARRAY given;           // scratch: which params a call has arguments for
+	TypeId ARRAY keys;             // scratch: the argument types of an overloaded call
+	const char* ARRAY kw_names;    // scratch: and the names of its keyword arguments
+	SymbolId ARRAY viable;         // scratch: the overloads that can be called with them
+	uint8_t ARRAY matches;         // scratch: how well, by argument (a Match)
+} Checker;
+
+// Once the signatures of a module's declarations are known, the bodies of its functions and
+// tests are checked apart, on as many threads as there are, each writing only the types of
+// what is declared in them
+struct _type_check {
+	TypeTable table;
+	Resolution res;
+	TypeId ARRAY symbol_types;    // by id
+	uint8_t ARRAY symbol_states;  // SymbolState, by id
+	bool has_using_imports;       // so undeclared names may be types from elsewhere
+	Overloads overloads;
+	Checker main;                 // checks everything but the bodies
+	AST_Node** ARRAY bodies;      // of top-level functions and tests, in order
+	Checker* workers;             // kept for the types of the expressions in the bodies
+	int n_workers;
+	int n_errors;
+};
+
+static WalkAction check_pre(AST_Node** slot, void* ctx);
+static WalkAction check_post(AST_Node** slot, void* ctx);
+
+// === Errors ===
+
+/// Errors are kept until the module is checked, then reported in the order of the source
+static void type_error(Checker* c, const AST_Node* at, const char* fmt, ...) {
+	if (!at || ast_is_shared(at)) at = c->where;
+	va_list args;
+	va_start(args, fmt);
+	int length = vsnprintf(NULL, 0, fmt, args);
+	va_end(args);
+	char* message = malloc(length + 1);
+	va_start(args, fmt);
+	vsnprintf(message, length + 1, fmt, args);
+	va_end(args);
+	Diagnostic diagnostic = {
+		at->src_file, at->start_line, at->start_col, at->end_line > at->start_line? -1 : (int) at->end_col,
+		c->task, arrlen(c->diagnostics), message,
+	};
+	arrput(c->diagnostics, diagnostic);
+}
+
+static int compare_diagnostics(const void* a, const void* b) {
+	const Diagnostic* x = a;
+	const Diagnostic* y = b;
+	if (x->line != y->line) return x->line < y->line? -1 : 1;
+	if (x->start_col != y->start_col) return x->start_col < y->start_col? -1 : 1;
+	if (x->task != y->task) return x->task < y->task? -1 : 1;
+	return (x->order > y->order) - (x->order < y->order);
+}
+
+static void report_diagnostics(Diagnostic* diagnostics, int n) {
+	if (!n) return;
+	qsort(diagnostics, n, sizeof(Diagnostic), compare_diagnostics);
+	char* source = NULL;
+	const char* ARRAY lines = NULL;
+	for (int i = 0; i < n; i++) {
+		const Diagnostic* d = &diagnostics[i];
+		if (!source) {
+			source = (char*) read_entire_file(d->src_file);
+			for (char* p = source; p && *p; p++) {
+				if (p == source) arrput(lines, p);
+				if (*p != '\n') continue;
+				*p = 0;
+				arrput(lines, p + 1);
+			}
+		}
+		fprintf(stderr, "In '%s' at line %d, column %d...\n  Type error: %s\n", d->src_file, d->line, d->start_col, d->message);
+		if (d->line >= 1 && d->line <= arrlen(lines)) {
+			const char* line = lines[d->line - 1];
+			show_error_line(stderr, line, d->line, d->start_col, d->end_col < 0? (int) strlen(line) : d->end_col);
+		}
+	}
+	free(source);
+	arrfree(lines);
+}
+
+static const char* qualname_text(Checker* c, const AST_Qualname* qn) {
+	if (c->text) stbds_header(c->text)->length = 0;
+	for (int i = 0; i < arrlen(qn->parts); i++) {
+		size_t length = strlen(qn->parts[i]);
+		if (i) arrput(c->text, '.');
+		if (!length) continue;  // arraddn can't start an array with nothing
+		size_t at = arraddn(c->text, length);
+		memcpy(&c->text[at], qn->parts[i], length);
+	}
+	arrput(c->text, 0);
+	return c->text;
+}
+
+// === Expression types ===
+
+static inline size_t hash_page(uintptr_t page) {
+	return page * 0x9e3779b97f4a7c15ull >> 32;
+}
+
+static TypePage* find_page(const TypeMap* map, uintptr_t page) {
+	if (!map->pages) return NULL;
+	for (size_t i = hash_page(page) & map->mask; map->pages[i].page; i = (i + 1) & map->mask) {
+		if (map->pages[i].page == page) return &map->pages[i];
+	}
+	return NULL;
+}
+
+static TypePage* add_page(TypeMap* map, uintptr_t page) {
+	if (2 * (map->count + 1) > map->mask) {
+		TypeMap old = *map;
+		map->mask = old.mask? 2 * old.mask + 1 : 255;
+		map->pages = calloc(map->mask + 1, sizeof(TypePage));
+		for (size_t i = 0; old.pages && i <= old.mask; i++) {
+			if (!old.pages[i].page) continue;
+			size_t j = hash_page(old.pages[i].page) & map->mask;
+			while (map->pages[j].page) j = (j + 1) & map->mask;
+			map->pages[j] = old.pages[i];
+		}
+		free(old.pages);
+	}
+	size_t i = hash_page(page) & map->mask;
+	while (map->pages[i].page) i = (i + 1) & map->mask;
+	map->pages[i] = (TypePage) { page, calloc(1 << (TYPE_PAGE_BITS - 3), sizeof(TypeId)) };
+	map->count++;
+	return &map->pages[i];
+}
+
+static void type_map_put(TypeMap* map, const void* key, TypeId type) {
+	uintptr_t page = (uintptr_t) key >> TYPE_PAGE_BITS;
+	TypePage* found = find_page(map, page);
+	if (!found) found = add_page(map, page);
+	found->types[((uintptr_t) key & ((1 << TYPE_PAGE_BITS) - 1)) >> 3] = type + 1;
+}
+
+static bool type_map_get(const TypeMap* map, const void* key, TypeId* type) {
+	const TypePage* found = find_page(map, (uintptr_t) key >> TYPE_PAGE_BITS);
+	TypeId kept = found? found->types[((uintptr_t) key & ((1 << TYPE_PAGE_BITS) - 1)) >> 3] : 0;
+	if (!kept) return false;
+	*type = kept - 1;
+	return true;
+}
+
+static void type_map_free(TypeMap* map) {
+	for (size_t i = 0; map->pages && i <= map->mask; i++) free(map->pages[i].types);
+	free(map->pages);
+}
+
+static inline bool type_map_has(const TypeMap* map, const void* key) {
+	TypeId type;
+	return type_map_get(map, key, &type);
+}
+
+static inline void put_type(Checker* c, AST_Node* const* slot, TypeId type) {
+	type_map_put(&c->exprs, slot, type);
+}
+
+static TypeId type_of(Checker* c, AST_Node* const* slot) {
+	switch ((*slot)->node_type) {
+		case NODE_INT: return TYPE_INT;
+		case NODE_FLOAT: return TYPE_FLOAT;
+		case NODE_BOOL: return TYPE_BOOL;
+		case NODE_STRING: return TYPE_STRING;
+		case NODE_CHAR: return TYPE_RUNE;
+		case NODE_NULL: return TYPE_NULL;
+		// 'type T'
+		case NODE_SIMPLE_TYPE:
+		case NODE_POINTER_TYPE:
+		case NODE_MUTABLE_TYPE:
+		case NODE_OPTIONAL_TYPE:
+		case NODE_ARRAY_TYPE:
+		case NODE_FUNC_TYPE:
+		case NODE_TEMPLATE_TYPE:
+		case NODE_UNION:
+			return TYPE_TYPE;
+		default: break;
+	}
+	// Bodies are checked after the rest, whose types they may use
+	TypeId type;
+	if (type_map_get(&c->exprs, slot, &type)) return type;
+	if (c != &c->check->main && type_map_get(&c->check->main.exprs, slot, &type)) return type;
+	return TYPE_UNKNOWN;
+}
+
+/// Its type, wherever it was checked
+static TypeId checked_type(TypeCheck check, AST_Node* const* slot) {
+	TypeId type;
+	for (int i = 0; i < check->n_workers; i++) {
+		if (type_map_get(&check->workers[i].exprs, slot, &type)) return type;
+	}
+	return type_of(&check->main, slot);
+}
+
+/// The value a type holds, once dereferenced. Optionals are looked through too if `nullable`
+/// is given, and it is set if there was one.
+static TypeId value_of(Checker* c, TypeId type, bool* nullable) {
+	while (1) {
+		const Type* t = type_get(c->table, type);
+		if (t->kind == TYPE_KIND_OPTIONAL && nullable) *nullable = true;
+		else if (t->kind != TYPE_KIND_MUTABLE && t->kind != TYPE_KIND_POINTER) return type;
+		type = t->base;
+	}
+}
+
+static inline TypeKind kind_of(Checker* c, TypeId type) {
+	return type_get(c->table, type)->kind;
+}
+
+static inline bool is_integer_kind(TypeKind kind) {
+	return kind == TYPE_KIND_SINT || kind == TYPE_KIND_UINT;
+}
+
+static inline bool is_number_kind(TypeKind kind) {
+	return is_integer_kind(kind) || kind == TYPE_KIND_FLOAT || kind == TYPE_KIND_COMPLEX;
+}
+
+/// Builtin operators are only defined for these; for anything else they may be overloaded
+static inline bool is_scalar_kind(TypeKind kind) {
+	return (kind >= TYPE_KIND_BOOL && kind <= TYPE_KIND_RAWPTR) || kind == TYPE_KIND_VECTOR;
+}
+
+/// Number literals take the type they are used as, if they fit in it
+static bool literal_fits(Checker* c, AST_Node* const* slot, TypeId to) {
+	const AST_Node* node = *slot;
+	bool negative = false;
+	if (node->node_type == NODE_UNARY && strcmp(((AST_Unary*) node)->op, "-") == 0) {
+		node = ((AST_Unary*) node)->expr;
+		negative = true;
+	}
+	bool nullable = false;
+	const Type* t = type_get(c->table, value_of(c, to, &nullable));
+	if (node->node_type == NODE_FLOAT) return t->kind == TYPE_KIND_FLOAT || t->kind == TYPE_KIND_COMPLEX;
+	if (node->node_type != NODE_INT) return false;
+	intmax_t value = ((const AST_Int*) node)->value;
+	if (negative) value = -value;
+	switch (t->kind) {
+		case TYPE_KIND_SINT: return t->bits >= 64 || (value >= -((intmax_t) 1 << (t->bits - 1)) && value < (intmax_t) 1 << (t->bits - 1));
+		case TYPE_KIND_UINT: return value >= 0 && (t->bits >= 64 || value < (intmax_t) 1 << t->bits);
+		case TYPE_KIND_FLOAT:
+		case TYPE_KIND_COMPLEX: return true;
+		default: return false;
+	}
+}
+
+/// Checks that the value held in *slot can be used where a value of type `to` is wanted
+static bool check_value(Checker* c, AST_Node* const* slot, TypeId to, const AST_Node* at, const char* what) {
+	if (literal_fits(c, slot, to)) return true;
+	const AST_Node* node = *slot;
+	if (!ast_is_shared(node)) at = node;
+	const Type* t = type_get(c->table, type_unqualified(c->table, to));
+	if (t->kind == TYPE_KIND_ARRAY && node->node_type == NODE_ARRAY && arrlen(((AST_ArrayLiteral*) node)->elements)) {
+		// Element by element, so that their literals can take the element type
+		AST_ArrayLiteral* array = (AST_ArrayLiteral*) node;
+		int n = arrlen(array->elements);
+		int n_extents;
+		const int64_t* extents = type_extents(c->table, type_unqualified(c->table, to), &n_extents);
+		if (n_extents && !t->is_dynamic && extents[0] >= 0 && extents[0] != n) {
+			type_error(c, at, "%s has %d elements, where %s is expected", what, n, type_name(c->table, to));
+			return false;
+		}
+		TypeId element = t->count > 1? type_array(c->table, t->base, t->count - 1, extents + 1, false) : t->base;
+		bool ok = true;
+		for (int i = 0; i < n; i++) ok = check_value(c, &array->elements[i], element, at, what) && ok;
+		return ok;
+	}
+	if (t->kind == TYPE_KIND_ARRAY && node->node_type == NODE_PACKED_ARRAY) {
+		const AST_PackedArray* packed = (const AST_PackedArray*) node;
+		TypeKind element = kind_of(c, value_of(c, t->base, NULL));
+		bool fits = packed->kind == PACKED_INT? is_number_kind(element) : element == TYPE_KIND_FLOAT || element == TYPE_KIND_COMPLEX;
+		if ((fits || element == TYPE_KIND_UNKNOWN) && (t->count < 0 || t->count == arrlen(packed->shape))) return true;
+	}
+	TypeId from = type_of(c, slot);
+	if (type_coercion(c->table, from, to) != COERCE_NONE) return true;
+	type_error(c, at, "%s has type %s, where %s is expected", what, type_name(c->table, from), type_name(c->table, to));
+	return false;
+}
+
+static void check_condition(Checker* c, AST_Node* const* slot, const AST_Node* at) {
+	TypeId type = type_of(c, slot);
+	if (type_coercion(c->table, type, TYPE_BOOL) != COERCE_NONE) return;
+	type_error(c, ast_is_shared(*slot)? at : *slot, "A condition must be a Bool, not %s", type_name(c->table, type));
+}
+
+static void check_index(Checker* c, AST_Node* const* slot, const AST_Node* at) {
+	bool nullable = false;
+	TypeId type = value_of(c, type_of(c, slot), &nullable);
+	if (type == TYPE_UNKNOWN || is_integer_kind(kind_of(c, type))) return;
+	type_error(c, ast_is_shared(*slot)? at : *slot, "Indices and bounds must be integers, not %s", type_name(c->table, type));
+}
+
+// === Declarations ===
+
+static TypeId symbol_type(Checker* c, SymbolId id);
+
+static SymbolId declared_symbol(Checker* c, AST_Name* const* name) {
+	return resolution_lookup(c->res, (AST_Node* const*) name).symbol;
+}
+
+static void set_symbol_type(Checker* c, SymbolId id, TypeId type) {
+	if (!id) return;
+	c->check->symbol_types[id] = type;
+	c->check->symbol_states[id] = SYMBOL_DONE;
+}
+
+static TypeId resolve_type(Checker* c, AST_Node* node);
+
+static TypeId named_type(Checker* c, AST_Qualname* const* slot) {
+	const AST_Qualname* qn = *slot;
+	ResolvedName found = resolution_lookup(c->res, (AST_Node* const*) slot);
+	if (found.symbol) {
+		const Symbol* symbol = resolution_symbol(c->res, found.symbol);
+		if (symbol->kind == DECL_IMPORT) return TYPE_UNKNOWN;  // declared in another module
+		if (found.n_parts == arrlen(qn->parts) && symbol->kind == DECL_STRUCT) {
+			return type_nominal(c->table, TYPE_KIND_STRUCT, symbol->decl, symbol->name);
+		}
+		if (found.n_parts == arrlen(qn->parts) && symbol->kind == DECL_ENUM) {
+			return type_nominal(c->table, TYPE_KIND_ENUM, symbol->decl, symbol->name);
+		}
+		type_error(c, NULL, "'%s' isn't a type", qualname_text(c, qn));
+		return TYPE_UNKNOWN;
+	}
+	if (arrlen(qn->parts) == 1) {
+		TypeId builtin = type_builtin(c->table, qn->parts[0]);
+		if (builtin) return builtin;
+	}
+	if (!c->check->has_using_imports) type_error(c, NULL, "Unknown type '%s'", qualname_text(c, qn));
+	return TYPE_UNKNOWN;
+}
+
+static TypeId resolve_type_uncached(Checker* c, AST_Node* node) {
+	switch (node->node_type) {
+		case NODE_SIMPLE_TYPE: return named_type(c, &((AST_SimpleType*) node)->base);
+		case NODE_POINTER_TYPE: return type_pointer(c->table, resolve_type(c, ((AST_PointerType*) node)->base));
+		case NODE_MUTABLE_TYPE: return type_mutable(c->table, resolve_type(c, ((AST_MutableType*) node)->base));
+		case NODE_OPTIONAL_TYPE: return type_optional(c->table, resolve_type(c, ((AST_OptionalType*) node)->base));
+
+		case NODE_ARRAY_TYPE: {
+			AST_ArrayType* array = (AST_ArrayType*) node;
+			TypeId element = resolve_type(c, array->element_type);
+			int n = arrlen(array->shape);
+			int64_t runtime = -1;
+			if (!n) return array->is_dynamic? type_array(c->table, element, 1, &runtime, true) : type_array(c->table, element, -1, NULL, false);
+			int64_t ARRAY extents = NULL;
+			for (int i = 0; i < n; i++) {
+				// Extents other than literals are worked out at run time
+				AST_Node* extent = array->shape[i];
+				arrput(extents, extent && extent->node_type == NODE_INT? ((AST_Int*) extent)->value : -1);
+			}
+			TypeId type = type_array(c->table, element, n, extents, false);
+			arrfree(extents);
+			return type;
+		}
+
+		case NODE_FUNC_TYPE: {
+			AST_FuncType* func = (AST_FuncType*) node;
+			TypeId ARRAY params = NULL;
+			for (int i = 0; i < arrlen(func->param_types); i++) arrput(params, resolve_type(c, func->param_types[i]));
+			TypeId ret = func->return_type? resolve_type(c, func->return_type) : TYPE_VOID;
+			TypeId type = type_func(c->table, params, arrlen(params), ret);
+			arrfree(params);
+			return type;
+		}
+
+		case NODE_UNION: {
+			AST_UnionType* union_type = (AST_UnionType*) node;
+			TypeId ARRAY variants = NULL;
+			for (int i = 0; i < arrlen(union_type->variants); i++) arrput(variants, resolve_type(c, union_type->variants[i]));
+			TypeId type = type_union(c->table, variants, arrlen(variants));
+			arrfree(variants);
+			return type;
+		}
+
+		default:  // templates aren't parsed yet
+			return TYPE_UNKNOWN;
+	}
+}
+
+/// The type a pointer, mutable, optional or array type is built on
+static AST_Node* base_type_node(AST_Node* node) {
+	switch (node->node_type) {
+		case NODE_POINTER_TYPE: return ((AST_PointerType*) node)->base;
+		case NODE_MUTABLE_TYPE: return ((AST_MutableType*) node)->base;
+		case NODE_OPTIONAL_TYPE: return ((AST_OptionalType*) node)->base;
+		case NODE_ARRAY_TYPE: return ((AST_ArrayType*) node)->element_type;
+		default: return NULL;
+	}
+}
+
+/// The semantic type an AST type stands for
+static TypeId resolve_type(Checker* c, AST_Node* node) {
+	if (!node) return TYPE_UNKNOWN;
+	TypeId type;
+	if (type_map_get(&c->type_nodes, node, &type)) return type;
+	// Bases nest as deeply as they're written, so they're resolved innermost first instead of by recursing
+	AST_Node* ARRAY bases = NULL;
+	for (AST_Node* base = base_type_node(node); base && !type_map_has(&c->type_nodes, base); base = base_type_node(base)) arrput(bases, base);
+	for (ptrdiff_t i = arrlen(bases) - 1; i >= 0; i--) type_map_put(&c->type_nodes, bases[i], resolve_type_uncached(c, bases[i]));
+	arrfree(bases);
+	type = resolve_type_uncached(c, node);
+	type_map_put(&c->type_nodes, node, type);
+	return type;
+}
+
+/// Walks a declaration before the walk of the module gets to it, as its type is needed first
+static void check_ahead(Checker* c, AST_Node* decl) {
+	const AST_Node* where = c->where;
+	AST_Visitor visitor = { check_pre, check_post, c };
+	ast_walk_iterative(&decl, &visitor);
+	c->where = where;
+}
+
+static TypeId param_type(Checker* c, AST_Param* param) {
+	if (param->type) return resolve_type(c, param->type);
+	if (!param->default_value) return TYPE_UNKNOWN;
+	TypeId type = symbol_type(c, declared_symbol(c, &param->name));
+	return param->is_vararg? TYPE_UNKNOWN : type_unqualified(c->table, type);
+}
+
+static TypeId signature(Checker* c, AST_FuncDef* func) {
+	TypeId ARRAY params = NULL;
+	for (int i = 0; i < shlen(func->params); i++) {
+		AST_Param* param = func->params[i].value;
+		TypeId type = param_type(c, param);
+		int64_t runtime = -1;
+		arrput(params, param->is_vararg? type_array(c->table, type, 1, &runtime, true) : type);
+	}
+	TypeId ret = func->ret_type? resolve_type(c, func->ret_type) : TYPE_VOID;
+	TypeId type = type_func(c->table, params, arrlen(params), ret);
+	arrfree(params);
+	return type;
+}
+
+static TypeId symbol_type(Checker* c, SymbolId id) {
+	if (!id) return TYPE_UNKNOWN;
+	const Symbol* symbol = resolution_symbol(c->res, id);
+	switch (c->check->symbol_states[id]) {
+		case SYMBOL_DONE: return c->check->symbol_types[id];
+		case SYMBOL_IN_PROGRESS:
+			type_error(c, (AST_Node*) symbol->name_node, "The type of '%s' depends on itself", symbol->name);
+			set_symbol_type(c, id, TYPE_UNKNOWN);
+			return TYPE_UNKNOWN;
+		default: break;
+	}
+	c->check->symbol_states[id] = SYMBOL_IN_PROGRESS;
+	switch (symbol->kind) {
+		case DECL_FUNCTION:
+			set_symbol_type(c, id, signature(c, (AST_FuncDef*) symbol->decl));
+			break;
+		case DECL_STRUCT:
+		case DECL_ENUM:
+			set_symbol_type(c, id, TYPE_TYPE);
+			break;
+		case DECL_CONST: {
+			AST_Const* constant = (AST_Const*) symbol->decl;
+			if (constant->type) set_symbol_type(c, id, resolve_type(c, constant->type));
+			else check_ahead(c, symbol->decl);
+		} break;
+		case DECL_PARAM: {
+			AST_Param* param = (AST_Param*) symbol->decl;
+			if (param->type) {
+				TypeId type = resolve_type(c, param->type);
+				int64_t runtime = -1;
+				set_symbol_type(c, id, param->is_vararg? type_array(c->table, type, 1, &runtime, true) : type);
+			}
+			else check_ahead(c, symbol->decl);
+		} break;
+		case DECL_LOCAL:
+		case DECL_LOOP_VAR:
+		case DECL_CONTEXT:
+			// Set where they are declared, which comes before they can be used
+			c->check->symbol_states[id] = SYMBOL_PENDING;
+			return TYPE_UNKNOWN;
+		default:
+			set_symbol_type(c, id, TYPE_UNKNOWN);
+	}
+	if (c->check->symbol_states[id] != SYMBOL_DONE) set_symbol_type(c, id, TYPE_UNKNOWN);
+	return c->check->symbol_types[id];
+}
+
+// === Members ===
+
+// stb_ds lookups write to the map, and other threads may be reading the same declarations
+#define FIND_KEY(map, name) find_key(&(map)->key, sizeof(*(map)), shlen(map), (name))
+
+static ptrdiff_t find_key(const char* const* first_key, size_t stride, ptrdiff_t n, const char* name) {
+	for (ptrdiff_t i = 0; i < n; i++) {
+		const char* key = *(const char* const*) ((const char*) first_key + i * stride);
+		if (strcmp(key, name) == 0) return i;
+	}
+	return -1;
+}
+
+static TypeId field_type(Checker* c, AST_Field* field) {
+	if (field->type) return resolve_type(c, field->type);
+	return field->default_value? type_unqualified(c->table, type_of(c, &field->default_value)) : TYPE_UNKNOWN;
+}
+
+/// .xyzw and ._1af7 pick elements by position; .lo, .hi, .even and .odd pick halves
+static TypeId swizzle_type(Checker* c, TypeId vector, const char* name, const AST_Node* at) {
+	const Type* t = type_get(c->table, vector);
+	int n = 0;
+	bool valid = true;
+	if (!strcmp(name, "lo") || !strcmp(name, "hi") || !strcmp(name, "even") || !strcmp(name, "odd")) n = (t->count + 1) / 2;
+	else if (name[0] == '_') {
+		for (const char* p = name + 1; *p && valid; p++, n++) {
+			int index = *p >= '0' && *p <= '9'? *p - '0' : *p >= 'a' && *p <= 'f'? *p - 'a' + 10 : 16;
+			valid = index < t->count;
+		}
+	}
+	else {
+		for (const char* p = name; *p && valid; p++, n++) {
+			const char* letter = strchr("xyzw", *p);
+			valid = *p && letter && letter - "xyzw" < t->count;
+		}
+	}
+	if (valid && n == 1) return t->base;
+	if (valid && (n == 2 || n == 3 || n == 4 || n == 8 || n == 16)) return type_vector(c->table, t->base, n);
+	type_error(c, at, "%s has no element '%s'", type_name(c->table, vector), name);
+	return TYPE_UNKNOWN;
+}
+
+/// The type of a field of a value of the given type. Fields of null are null.
+static TypeId member_type(Checker* c, TypeId type, const char* name, const AST_Node* at) {
+	bool nullable = false;
+	TypeId base = value_of(c, type, &nullable);
+	const Type* t = type_get(c->table, base);
+	TypeId member;
+	switch (t->kind) {
+		case TYPE_KIND_UNKNOWN: return TYPE_UNKNOWN;
+		case TYPE_KIND_STRUCT: {
+			AST_Struct* decl = (AST_Struct*) t->decl;
+			ptrdiff_t i = FIND_KEY(decl->fields, name);
+			if (i < 0) {
+				type_error(c, at, "%s has no field '%s'", t->name, name);
+				return TYPE_UNKNOWN;
+			}
+			member = field_type(c, decl->fields[i].value);
+		} break;
+		case TYPE_KIND_VECTOR:
+			member = swizzle_type(c, base, name, at);
+			break;
+		// Their properties aren't typed yet
+		case TYPE_KIND_ARRAY:
+		case TYPE_KIND_STRING:
+			return TYPE_UNKNOWN;
+		default:
+			type_error(c, at, "%s has no field '%s'", type_name(c->table, base), name);
+			return TYPE_UNKNOWN;
+	}
+	return nullable? type_optional(c->table, member) : member;
+}
+
+/// The type of what a name refers to; `member` for the field of a field access, which isn't one
+static TypeId qualname_type(Checker* c, AST_Node* const* slot, bool member) {
+	const AST_Qualname* qn = (const AST_Qualname*) *slot;
+	int n = arrlen(qn->parts);
+	ResolvedName found = resolution_lookup(c->res, slot);
+	if (!found.symbol) {
+		// A builtin type, called to cast
+		if (n == 1 && type_builtin(c->table, qn->parts[0])) return TYPE_TYPE;
+		// Builtin functions aren't declared, and names may come from modules imported with 'using'
+		if (!member && slot != c->callee && !c->check->has_using_imports) type_error(c, NULL, "Unknown name '%s'", qualname_text(c, qn));
+		return TYPE_UNKNOWN;
+	}
+	const Symbol* symbol = resolution_symbol(c->res, found.symbol);
+	int i = found.n_parts;
+	TypeId type;
+	if (symbol->kind == DECL_ENUM && i < n) {
+		AST_Enum* decl = (AST_Enum*) symbol->decl;
+		if (FIND_KEY(decl->fields, qn->parts[i]) < 0) {
+			type_error(c, NULL, "%s has no value '%s'", symbol->name, qn->parts[i]);
+			return TYPE_UNKNOWN;
+		}
+		type = type_nominal(c->table, TYPE_KIND_ENUM, symbol->decl, symbol->name);
+		i++;
+	}
+	else type = symbol_type(c, found.symbol);
+	for (; i < n; i++) type = member_type(c, type, qn->parts[i], NULL);
+	return type;
+}
+
+// === Overloads ===
+
+static void check_argument(Checker* c, AST_Node* const* arg, TypeId want, const AST_Node* at, bool* nullable, const char* what);
+static TypeId param_type(Checker* c, AST_Param* param);
+
+// How well an argument matches a parameter, best first
+typedef enum {
+	MATCH_EXACT,
+	MATCH_LITERAL,  // a number literal taking the parameter's type
+	MATCH_NUMERIC,
+	MATCH_COERCED,
+	MATCH_NONE,
+} Match;
+
+static inline void put_target(Checker* c, const void* key, SymbolId id) {
+	type_map_put(&c->targets, key, (TypeId) id);
+}
+
+/// The type an argument is resolved by. Number literals are told apart, as they fit more types.
+static TypeId argument_key(Checker* c, AST_Node* const* slot) {
+	const AST_Node* node = *slot;
+	if (node->node_type == NODE_UNARY && strcmp(((const AST_Unary*) node)->op, "-") == 0) node = ((const AST_Unary*) node)->expr;
+	if (node->node_type == NODE_INT) return TYPE_INT | DISPATCH_LITERAL;
+	if (node->node_type == NODE_FLOAT) return TYPE_FLOAT | DISPATCH_LITERAL;
+	return type_unqualified(c->table, type_of(c, slot));
+}
+
+static Match match_argument(Checker* c, TypeId arg, TypeId param) {
+	param = type_unqualified(c->table, param);
+	if (arg & DISPATCH_LITERAL) {
+		arg &= ~DISPATCH_LITERAL;
+		TypeKind kind = kind_of(c, param);
+		if (param == arg) return MATCH_EXACT;
+		// Whether it fits is checked once the overload is picked
+		if (kind == TYPE_KIND_FLOAT || kind == TYPE_KIND_COMPLEX || (arg == TYPE_INT && is_integer_kind(kind))) return MATCH_LITERAL;
+	}
+	switch (type_coercion(c->table, arg, param)) {
+		case COERCE_NONE: return MATCH_NONE;
+		case COERCE_EXACT: return MATCH_EXACT;
+		case COERCE_NUMERIC: return MATCH_NUMERIC;
+		default: return MATCH_COERCED;
+	}
+}
+
+/// Matches the arguments (the positional ones, then those named in `kw_names`) against the
+/// function's parameters, into one Match for each. False if it can't be called with them.
+static bool match_candidate(Checker* c, SymbolId id, const TypeId* args, int n_positional, const char* const* kw_names, int n_kw, uint8_t* matches) {
+	AST_FuncDef* func = (AST_FuncDef*) resolution_symbol(c->res, id)->decl;
+	int n_params = shlen(func->params), n_types;
+	const TypeId* types = type_members(c->table, symbol_type(c, id), &n_types);
+	if (n_types != n_params) return false;
+	int vararg = -1;
+	for (int i = 0; i < n_params && vararg < 0; i++) {
+		if (func->params[i].value->is_vararg) vararg = i;
+	}
+	arrsetlen(c->given, n_params);
+	if (n_params) memset(c->given, 0, n_params);
+	for (int i = 0; i < n_positional + n_kw; i++) {
+		int p = i >= n_positional? (int) FIND_KEY(func->params, kw_names[i - n_positional]) : vararg >= 0 && i >= vararg? vararg : i;
+		if (p < 0 || p >= n_params || (c->given[p] && p != vararg)) return false;
+		c->given[p] = 1;
+		matches[i] = match_argument(c, args[i], p == vararg? type_get(c->table, types[p])->base : types[p]);
+		if (matches[i] == MATCH_NONE) return false;
+	}
+	for (int p = 0; p < n_params; p++) {
+		AST_Param* param = func->params[p].value;
+		if (!c->given[p] && !param->default_value && !param->is_vararg) return false;
+	}
+	return true;
+}
+
+/// The overload that matches each argument at least as well as every other one that can be
+/// called does, and one argument better. 0 if none can be called, -1 if none is best.
+static SymbolId pick_overload(Checker* c, int set, const TypeId* args, int n_positional, const char* const* kw_names, int n_kw) {
+	int n_candidates, n_args = n_positional + n_kw;
+	const SymbolId* candidates = overloads_candidates(c->check->overloads, set, &n_candidates);
+	if (c->viable) stbds_header(c->viable)->length = 0;
+	if (c->matches) stbds_header(c->matches)->length = 0;
+	for (int i = 0; i < n_candidates; i++) {
+		size_t at = arraddn(c->matches, n_args + 1);
+		if (match_candidate(c, candidates[i], args, n_positional, kw_names, n_kw, &c->matches[at])) arrput(c->viable, candidates[i]);
+		else arrsetlen(c->matches, at);
+	}
+	int n_viable = arrlen(c->viable);
+	for (int v = 0; v < n_viable; v++) {
+		const uint8_t* mine = &c->matches[v * (n_args + 1)];
+		bool best = true;
+		for (int w = 0; w < n_viable && best; w++) {
+			if (w == v) continue;
+			const uint8_t* theirs = &c->matches[w * (n_args + 1)];
+			bool better = false;
+			for (int i = 0; i < n_args && best; i++) {
+				if (mine[i] > theirs[i]) best = false;
+				else if (mine[i] < theirs[i]) better = true;
+			}
+			best = best && better;
+		}
+		if (best) return c->viable[v];
+	}
+	return n_viable? -1 : 0;
+}
+
+/// The function of the set a call with the arguments resolves to, or 0 if there is none,
+/// which is an error unless the types of the arguments aren't known. The first call with
+/// some argument types picks it; the rest with the same are a lookup.
+static SymbolId resolve_overload(Checker* c, int set, const AST_Node* at, const TypeId* args, int n_positional, const char* const* kw_names, int n_kw) {
+	for (int i = 0; i < n_positional + n_kw; i++) {
+		if (args[i] == TYPE_UNKNOWN) return 0;
+	}
+	SymbolId chosen;
+	// The names of keyword arguments would have to be part of the key, so those calls aren't cached
+	if (n_kw || !dispatch_cache_get(c->dispatch, set, args, n_positional, &chosen)) {
+		chosen = pick_overload(c, set, args, n_positional, kw_names, n_kw);
+		if (!n_kw) dispatch_cache_put(c->dispatch, set, args, n_positional, chosen);
+	}
+	if (chosen > 0) {
+		c->n_dispatched++;
+		return chosen;
+	}
+	if (c->text) stbds_header(c->text)->length = 0;
+	arrput(c->text, '(');
+	for (int i = 0; i < n_positional + n_kw; i++) {
+		char buf[256];
+		const char* type = type_name(c->table, args[i] & ~DISPATCH_LITERAL);
+		int length = i < n_positional? snprintf(buf, sizeof(buf), "%s%s", i? ", " : "", type)
+			: snprintf(buf, sizeof(buf), "%s%s: %s", i? ", " : "", kw_names[i - n_positional], type);
+		if (length >= (int) sizeof(buf)) length = sizeof(buf) - 1;
+		memcpy(&c->text[arraddn(c->text, length)], buf, length);
+	}
+	arrput(c->text, ')');
+	arrput(c->text, 0);
+	const char* name = overloads_name(c->check->overloads, set);
+	if (chosen) type_error(c, at, "More than one overload of '%s' is as good a match for %s", name, c->text);
+	else type_error(c, at, "No overload of '%s' takes %s", name, c->text);
+	return 0;
+}
+
+/// The type an operator gives for operands it isn't builtin for, from the overload of it
+/// they resolve to, which is recorded under `key`. Unknown if there is none.
+static TypeId operator_type(Checker* c, const AST_Node* at, const void* key, const char* op, AST_Node* const* lhs, AST_Node* const* rhs) {
+	int set = overloads_of_operator(c->check->overloads, op);
+	if (set < 0) return TYPE_UNKNOWN;
+	AST_Node* const* operands[2] = { lhs, rhs };
+	TypeId args[2];
+	int n = rhs? 2 : 1;
+	for (int i = 0; i < n; i++) args[i] = argument_key(c, operands[i]);
+	SymbolId chosen = resolve_overload(c, set, at, args, n, NULL, 0);
+	if (!chosen) return TYPE_UNKNOWN;
+	put_target(c, key, chosen);
+	AST_FuncDef* func = (AST_FuncDef*) resolution_symbol(c->res, chosen)->decl;
+	bool nullable = false;
+	char what[64];
+	for (int i = 0; i < n; i++) {
+		snprintf(what, sizeof(what), "Operand %d of '%s'", i + 1, op);
+		AST_Param* param = func->params[i < shlen(func->params)? i : shlen(func->params) - 1].value;
+		check_argument(c, operands[i], param_type(c, param), at, &nullable, what);
+	}
+	TypeId ret = type_get(c->table, symbol_type(c, chosen))->base;
+	return nullable? type_optional(c->table, ret) : ret;
+}
+
+// === Operators ===
+
+static TypeId arithmetic_type(Checker* c, const AST_Node* at, const char* op, AST_Node* const* lhs, AST_Node* const* rhs) {
+	TypeId left = type_of(c, lhs), right = type_of(c, rhs);
+	if (strcmp(op, "?") == 0) {
+		// Or else: the left side, unless it is null
+		TypeId value = type_unqualified(c->table, left);
+		if (kind_of(c, value) == TYPE_KIND_OPTIONAL) value = type_get(c->table, value)->base;
+		TypeId common;
+		if (literal_fits(c, rhs, value)) return value;
+		if (type_common(c->table, value, right, &common)) return common;
+		type_error(c, at, "The sides of '?' have types %s and %s", type_name(c->table, left), type_name(c->table, right));
+		return TYPE_UNKNOWN;
+	}
+	// Custom operators are overloads
+	if (op[1] || !strchr("+-*/%^", op[0])) return operator_type(c, at, at, op, lhs, rhs);
+
+	bool nullable = false;
+	TypeId a = value_of(c, left, &nullable), b = value_of(c, right, &nullable);
+	if (a == TYPE_UNKNOWN || b == TYPE_UNKNOWN) return TYPE_UNKNOWN;
+	if (literal_fits(c, lhs, b)) a = b;
+	else if (literal_fits(c, rhs, a)) b = a;
+	TypeKind ka = kind_of(c, a), kb = kind_of(c, b);
+	if (!is_scalar_kind(ka) || !is_scalar_kind(kb)) return operator_type(c, at, at, op, lhs, rhs);
+
+	TypeId result;
+	bool arithmetic = (is_number_kind(ka) || ka == TYPE_KIND_VECTOR) && (is_number_kind(kb) || kb == TYPE_KIND_VECTOR);
+	// true * x = x, false * x = the zero of its type, and a string times n is it repeated
+	if (op[0] == '*' && a == TYPE_BOOL) result = b;
+	else if (op[0] == '*' && b == TYPE_BOOL) result = a;
+	else if (op[0] == '*' && a == TYPE_STRING && is_integer_kind(kb)) result = TYPE_STRING;
+	else if (!arithmetic || !type_common(c->table, a, b, &result)) {
+		if (overloads_of_operator(c->check->overloads, op) >= 0) return operator_type(c, at, at, op, lhs, rhs);
+		type_error(c, at, "Operator '%s' isn't defined for %s and %s", op, type_name(c->table, a), type_name(c->table, b));
+		return TYPE_UNKNOWN;
+	}
+	return nullable? type_optional(c->table, result) : result;
+}
+
+static bool is_nullable(Checker* c, TypeId type) {
+	TypeKind kind = kind_of(c, type_unqualified(c->table, type));
+	return kind == TYPE_KIND_OPTIONAL || kind == TYPE_KIND_POINTER || kind == TYPE_KIND_RAWPTR || kind == TYPE_KIND_NULL || kind == TYPE_KIND_UNKNOWN;
+}
+
+/// Comparisons of values they aren't builtin for are overloads, which must give a Bool
+static void comparison_overload(Checker* c, const AST_Node* at, const void* key, const char* op, AST_Node* const* lhs, AST_Node* const* rhs) {
+	TypeId result = value_of(c, operator_type(c, at, key, op, lhs, rhs), NULL);
+	if (result != TYPE_UNKNOWN && result != TYPE_BOOL) {
+		type_error(c, at, "The overload of '%s' gives %s rather than a Bool", op, type_name(c->table, result));
+	}
+}
+
+/// `key` is what an overload it resolves to is recorded under
+static void check_comparison(Checker* c, const AST_Node* at, const void* key, const char* op, AST_Node* const* lhs, AST_Node* const* rhs) {
+	TypeId left = type_of(c, lhs), right = type_of(c, rhs);
+	bool equality = op[0] == '=' || op[0] == '!';
+	if (left == TYPE_NULL || right == TYPE_NULL) {
+		TypeId other = left == TYPE_NULL? right : left;
+		if (!equality) type_error(c, at, "Nullable values can't be compared with '%s'", op);
+		else if (!is_nullable(c, other)) type_error(c, at, "%s can't be null, so it can't be compared with null", type_name(c->table, other));
+		return;
+	}
+	bool nullable = false;
+	TypeId a = value_of(c, left, &nullable), b = value_of(c, right, &nullable);
+	if (a == TYPE_UNKNOWN || b == TYPE_UNKNOWN) return;
+	if (literal_fits(c, lhs, b)) a = b;
+	else if (literal_fits(c, rhs, a)) b = a;
+	TypeKind ka = kind_of(c, a), kb = kind_of(c, b);
+	if (ka == TYPE_KIND_ENUM || kb == TYPE_KIND_ENUM) {
+		if (a != b) type_error(c, at, "Can't compare %s and %s", type_name(c->table, a), type_name(c->table, b));
+		return;
+	}
+	if (!is_scalar_kind(ka) || !is_scalar_kind(kb)) {
+		comparison_overload(c, at, key, op, lhs, rhs);
+		return;
+	}
+
+	TypeId common;
+	if (!type_common(c->table, a, b, &common)) {
+		if (overloads_of_operator(c->check->overloads, op) >= 0) comparison_overload(c, at, key, op, lhs, rhs);
+		else type_error(c, at, "Can't compare %s and %s", type_name(c->table, a), type_name(c->table, b));
+		return;
+	}
+	const Type* t = type_get(c->table, common);
+	TypeKind kind = t->kind == TYPE_KIND_VECTOR? kind_of(c, t->base) : t->kind;
+	if (equality) {
+		// Only exact types: no floats
+		if (kind == TYPE_KIND_FLOAT || kind == TYPE_KIND_COMPLEX) type_error(c, at, "%s values can't be compared with '%s'", type_name(c->table, common), op);
+	}
+	else if (nullable) type_error(c, at, "Nullable values can't be compared with '%s'", op);
+	else if (t->kind == TYPE_KIND_VECTOR || (!is_number_kind(kind) && kind != TYPE_KIND_STRING) || kind == TYPE_KIND_COMPLEX) {
+		type_error(c, at, "%s values can't be ordered", type_name(c->table, common));
+	}
+}
+
+static TypeId logic_type(Checker* c, const AST_Node* at, AST_Node* const* operand) {
+	check_condition(c, operand, at);
+	TypeId type = type_unqualified(c->table, type_of(c, operand));
+	return kind_of(c, type) == TYPE_KIND_OPTIONAL? type_optional(c->table, TYPE_BOOL) : TYPE_BOOL;
+}
+
+static bool is_addressable(Checker* c, AST_Node* const* slot) {
+	switch ((*slot)->node_type) {
+		case NODE_FIELD_ACCESS:
+		case NODE_SUBSCRIPT:
+			return true;
+		case NODE_QUALNAME: {
+			SymbolId id = resolution_lookup(c->res, slot).symbol;
+			if (!id) return true;
+			DeclKind kind = resolution_symbol(c->res, id)->kind;
+			return kind == DECL_LOCAL || kind == DECL_PARAM || kind == DECL_LOOP_VAR || kind == DECL_CONTEXT;
+		}
+		default:
+			return false;
+	}
+}
+
+/// Each '@' takes away one of the dereferences a value gets when it is used. One more than
+/// the value has pointers is its address.
+static TypeId reref_type(Checker* c, AST_Reref* reref) {
+	TypeId type = type_of(c, &reref->target);
+	if (type == TYPE_UNKNOWN) return TYPE_UNKNOWN;
+	int depth = 0;
+	for (TypeId layer = type; ; ) {
+		const Type* t = type_get(c->table, layer);
+		if (t->kind == TYPE_KIND_POINTER) depth++;
+		else if (t->kind != TYPE_KIND_MUTABLE && t->kind != TYPE_KIND_OPTIONAL) break;
+		layer = t->base;
+	}
+	if (reref->levels <= depth) {
+		TypeId layer = type;
+		for (int to_peel = depth - reref->levels; to_peel; ) {
+			const Type* t = type_get(c->table, layer);
+			if (t->kind == TYPE_KIND_POINTER) to_peel--;
+			layer = t->base;
+		}
+		return type_unqualified(c->table, layer);
+	}
+	if (reref->levels == depth + 1) {
+		if (!is_addressable(c, &reref->target)) type_error(c, (AST_Node*) reref, "Only variables, fields and elements have an address");
+		return type_pointer(c->table, type);
+	}
+	type_error(c, (AST_Node*) reref, "Too many '@' for a value of type %s", type_name(c->table, type));
+	return TYPE_UNKNOWN;
+}
+
+// === Calls ===
+
+static void check_argument(Checker* c, AST_Node* const* arg, TypeId want, const AST_Node* at, bool* nullable, const char* what) {
+	// Null given where it isn't wanted makes the result null
+	if (type_coercion(c->table, type_of(c, arg), want) == COERCE_UNWRAP) *nullable = true;
+	check_value(c, arg, want, at, what);
+}
+
+/// A function used as a word operator ('a \dot b') takes the operands as its first two
+/// arguments and the defaults of any others, and can't change them
+static void check_word_op(Checker* c, AST_FuncCall* call, AST_FuncDef* func, const char* name) {
+	int n_params = shlen(func->params);
+	bool vararg = n_params && func->params[n_params - 1].value->is_vararg;
+	if (n_params < 2 && !vararg) {
+		type_error(c, (AST_Node*) call, "'%s' takes %d argument%s, so it can't be a word operator", name, n_params, n_params == 1? "" : "s");
+		return;
+	}
+	for (int p = 0; p < n_params; p++) {
+		AST_Param* param = func->params[p].value;
+		if (p >= 2 && !param->default_value && !param->is_vararg) {
+			type_error(c, (AST_Node*) call, "'%s' can't be a word operator, as its parameter '%s' has no default", name, func->params[p].key);
+		}
+		if (kind_of(c, param_type(c, param)) == TYPE_KIND_MUTABLE) {
+			type_error(c, (AST_Node*) call, "'%s' can't be a word operator, as its parameter '%s' is mutable", name, func->params[p].key);
+		}
+	}
+}
+
+static TypeId call_func(Checker* c, AST_FuncCall* call, AST_FuncDef* func, const char* name) {
+	int n_params = shlen(func->params), n_positional = arrlen(call->pos_args);
+	int vararg = -1;
+	for (int i = 0; i < n_params && vararg < 0; i++) {
+		if (func->params[i].value->is_vararg) vararg = i;
+	}
+	if (call->is_word_op) check_word_op(c, call, func, name);
+	arrsetlen(c->given, n_params);
+	if (n_params) memset(c->given, 0, n_params);
+	bool nullable = false;
+	char what[256];
+	for (int i = 0; i < n_positional; i++) {
+		int p = vararg >= 0 && i >= vararg? vararg : i;
+		if (p >= n_params) {
+			if (!call->is_word_op) type_error(c, (AST_Node*) call, "'%s' takes %d arguments, not %d", name, n_params, n_positional);
+			break;
+		}
+		c->given[p] = 1;
+		snprintf(what, sizeof(what), "Argument %d of '%s'", i + 1, name);
+		check_argument(c, &call->pos_args[i], param_type(c, func->params[p].value), (AST_Node*) call, &nullable, what);
+	}
+	for (int i = 0; i < shlen(call->kw_args); i++) {
+		ptrdiff_t p = FIND_KEY(func->params, call->kw_args[i].key);
+		if (p < 0) {
+			type_error(c, (AST_Node*) call, "'%s' has no parameter '%s'", name, call->kw_args[i].key);
+			continue;
+		}
+		c->given[p] = 1;
+		snprintf(what, sizeof(what), "Argument '%s' of '%s'", call->kw_args[i].key, name);
+		check_argument(c, &call->kw_args[i].value, param_type(c, func->params[p].value), (AST_Node*) call, &nullable, what);
+	}
+	for (int p = 0; p < n_params; p++) {
+		AST_Param* param = func->params[p].value;
+		if (c->given[p] || param->default_value || param->is_vararg || call->is_word_op) continue;
+		type_error(c, (AST_Node*) call, "Missing an argument for '%s' of '%s'", func->params[p].key, name);
+	}
+	TypeId ret = func->ret_type? resolve_type(c, func->ret_type) : TYPE_VOID;
+	return nullable? type_optional(c->table, ret) : ret;
+}
+
+/// Struct values are made by calling the struct with its fields, in order or by name
+static TypeId call_struct(Checker* c, AST_FuncCall* call, const Symbol* symbol) {
+	AST_Struct* decl = (AST_Struct*) symbol->decl;
+	int n_fields = shlen(decl->fields), n_positional = arrlen(call->pos_args);
+	bool nullable = false;
+	char what[256];
+	if (n_positional > n_fields) type_error(c, (AST_Node*) call, "%s has %d fields, not %d", symbol->name, n_fields, n_positional);
+	for (int i = 0; i < n_positional && i < n_fields; i++) {
+		snprintf(what, sizeof(what), "Field '%s' of %s", decl->fields[i].key, symbol->name);
+		check_argument(c, &call->pos_args[i], field_type(c, decl->fields[i].value), (AST_Node*) call, &nullable, what);
+	}
+	for (int i = 0; i < shlen(call->kw_args); i++) {
+		ptrdiff_t f = FIND_KEY(decl->fields, call->kw_args[i].key);
+		if (f < 0) {
+			type_error(c, (AST_Node*) call, "%s has no field '%s'", symbol->name, call->kw_args[i].key);
+			continue;
+		}
+		snprintf(what, sizeof(what), "Field '%s' of %s", call->kw_args[i].key, symbol->name);
+		check_argument(c, &call->kw_args[i].value, field_type(c, decl->fields[f].value), (AST_Node*) call, &nullable, what);
+	}
+	TypeId type = type_nominal(c->table, TYPE_KIND_STRUCT, symbol->decl, symbol->name);
+	return nullable? type_optional(c->table, type) : type;
+}
+
+/// Casts look like calls of builtin types, and so do vectors made of their elements
+static TypeId call_cast(Checker* c, AST_FuncCall* call, TypeId to) {
+	const Type* vector = type_get(c->table, to);
+	if (vector->kind == TYPE_KIND_VECTOR && arrlen(call->pos_args) == vector->count && !shlen(call->kw_args)) {
+		bool nullable = false;
+		char what[64];
+		for (int i = 0; i < vector->count; i++) {
+			snprintf(what, sizeof(what), "Element %d of %s", i + 1, type_name(c->table, to));
+			check_argument(c, &call->pos_args[i], vector->base, (AST_Node*) call, &nullable, what);
+		}
+		return nullable? type_optional(c->table, to) : to;
+	}
+	if (arrlen(call->pos_args) != 1 || shlen(call->kw_args)) {
+		type_error(c, (AST_Node*) call, "A cast to %s takes one value", type_name(c->table, to));
+		return to;
+	}
+	bool nullable = false;
+	TypeId from = value_of(c, type_of(c, &call->pos_args[0]), &nullable);
+	TypeKind kf = kind_of(c, from), kt = kind_of(c, to);
+	bool castable = from == TYPE_UNKNOWN || type_coercion(c->table, from, to) != COERCE_NONE
+		|| ((is_number_kind(kf) || kf == TYPE_KIND_BOOL || kf == TYPE_KIND_RUNE) && (is_number_kind(kt) || kt == TYPE_KIND_BOOL || kt == TYPE_KIND_RUNE));
+	if (!castable) type_error(c, (AST_Node*) call, "Can't cast %s to %s", type_name(c->table, from), type_name(c->table, to));
+	return nullable? type_optional(c->table, to) : to;
+}
+
+static TypeId call_overload(Checker* c, AST_FuncCall* call, int set) {
+	int n_positional = arrlen(call->pos_args), n_kw = shlen(call->kw_args);
+	if (c->keys) stbds_header(c->keys)->length = 0;
+	if (c->kw_names) stbds_header(c->kw_names)->length = 0;
+	for (int i = 0; i < n_positional; i++) arrput(c->keys, argument_key(c, &call->pos_args[i]));
+	for (int i = 0; i < n_kw; i++) {
+		arrput(c->keys, argument_key(c, &call->kw_args[i].value));
+		arrput(c->kw_names, call->kw_args[i].key);
+	}
+	SymbolId chosen = resolve_overload(c, set, (AST_Node*) call, c->keys, n_positional, c->kw_names, n_kw);
+	if (!chosen) return TYPE_UNKNOWN;
+	put_target(c, call, chosen);
+	const Symbol* symbol = resolution_symbol(c->res, chosen);
+	return call_func(c, call, (AST_FuncDef*) symbol->decl, symbol->name);
+}
+
+/// The builtin math of numbers (sqrt, min, bit_and...): floating point functions give a Float
+/// (an F32 for an F32), the others a number of the type of their arguments. TYPE_UNKNOWN
+/// for anything else, which is left to be evaluated or reported where it is used.
+static TypeId math_type(Checker* c, AST_FuncCall* call, const char* name) {
+	static const char* const unary_float[] = { "sqrt", "sin", "cos", "tan", "exp", "log", "floor", "ceil" };
+	static const char* const binary[] = { "min", "max", "bit_and", "bit_or", "bit_xor" };
+	int n = arrlen(call->pos_args);
+	if (shlen(call->kw_args) || n < 1 || n > 2) return TYPE_UNKNOWN;
+	TypeId a = type_unqualified(c->table, value_of(c, type_of(c, &call->pos_args[0]), NULL));
+	TypeId b = n == 2? type_unqualified(c->table, value_of(c, type_of(c, &call->pos_args[1]), NULL)) : a;
+	TypeKind kind = kind_of(c, a);
+	if (kind != TYPE_KIND_FLOAT && !is_integer_kind(kind)) return TYPE_UNKNOWN;
+	for (size_t i = 0; n == 1 && i < sizeof(unary_float) / sizeof(*unary_float); i++) {
+		if (strcmp(name, unary_float[i]) == 0) return a == TYPE_F32? TYPE_F32 : TYPE_FLOAT;
+	}
+	if (n == 1 && (strcmp(name, "abs") == 0 || (strcmp(name, "bit_not") == 0 && is_integer_kind(kind)))) return a;
+	if (n == 2 && is_integer_kind(kind) && is_integer_kind(kind_of(c, b))
+		&& (strcmp(name, "shift_left") == 0 || strcmp(name, "shift_right") == 0)) return a;
+	TypeId common;
+	for (size_t i = 0; n == 2 && i < sizeof(binary) / sizeof(*binary); i++) {
+		if (strcmp(name, binary[i]) != 0 || !type_common(c->table, a, b, &common)) continue;
+		if (i < 2 || is_integer_kind(kind_of(c, common))) return common;
+	}
+	return TYPE_UNKNOWN;
+}
+
+static TypeId call_type(Checker* c, AST_FuncCall* call) {
+	if (call->func->node_type == NODE_QUALNAME) {
+		const AST_Qualname* qn = (const AST_Qualname*) call->func;
+		ResolvedName found = resolution_lookup(c->res, &call->func);
+		if (found.symbol && found.n_parts == arrlen(qn->parts)) {
+			const Symbol* symbol = resolution_symbol(c->res, found.symbol);
+			switch (symbol->kind) {
+				case DECL_FUNCTION:
+					put_target(c, call, found.symbol);
+					return call_func(c, call, (AST_FuncDef*) symbol->decl, symbol->name);
+				case DECL_STRUCT: return call_struct(c, call, symbol);
+				case DECL_OVERLOAD: return call_overload(c, call, overloads_of_symbol(c->check->overloads, found.symbol));
+				// Left to macro expansion
+				case DECL_MACRO:
+					return TYPE_UNKNOWN;
+				default: break;
+			}
+		}
+		else if (!found.symbol && arrlen(qn->parts) == 1) {
+			TypeId cast = type_builtin(c->table, qn->parts[0]);
+			if (cast) return call_cast(c, call, cast);
+			// 'len' of an array or string counts its elements
+			if (strcmp(qn->parts[0], "len") == 0 && arrlen(call->pos_args) == 1 && !shlen(call->kw_args)) {
+				TypeKind kind = kind_of(c, value_of(c, type_of(c, &call->pos_args[0]), NULL));
+				if (kind == TYPE_KIND_ARRAY || kind == TYPE_KIND_STRING) return TYPE_INT;
+			}
+			TypeId math = math_type(c, call, qn->parts[0]);
+			if (math) return math;
+		}
+	}
+	bool nullable = false;
+	TypeId callee = value_of(c, type_of(c, &call->func), &nullable);
+	const Type* t = type_get(c->table, callee);
+	if (t->kind == TYPE_KIND_UNKNOWN || t->kind == TYPE_KIND_TYPE) return TYPE_UNKNOWN;
+	if (t->kind != TYPE_KIND_FUNC) {
+		type_error(c, (AST_Node*) call, "A value of type %s can't be called", type_name(c->table, callee));
+		return TYPE_UNKNOWN;
+	}
+	int n_params;
+	const TypeId* params = type_members(c->table, callee, &n_params);
+	int n_positional = arrlen(call->pos_args);
+	if (n_positional != n_params || shlen(call->kw_args)) {
+		type_error(c, (AST_Node*) call, "A function of type %s takes %d arguments", type_name(c->table, callee), n_params);
+	}
+	char what[64];
+	for (int i = 0; i < n_positional && i < n_params; i++) {
+		snprintf(what, sizeof(what), "Argument %d", i + 1);
+		check_argument(c, &call->pos_args[i], params[i], (AST_Node*) call, &nullable, what);
+	}
+	return nullable? type_optional(c->table, t->base) : t->base;
+}
+
+// === Arrays ===
+
+static TypeId subscript_type(Checker* c, AST_Subscript* sub) {
+	bool nullable = false;
+	TypeId array = value_of(c, type_of(c, &sub->array), &nullable);
+	const Type* t = type_get(c->table, array);
+	int n = arrlen(sub->subscripts), n_slices = 0;
+	for (int i = 0; i < n; i++) {
+		if (sub->subscripts[i]->node_type == NODE_SLICE) n_slices++;
+		else check_index(c, &sub->subscripts[i], (AST_Node*) sub);
+	}
+	TypeId result;
+	switch (t->kind) {
+		case TYPE_KIND_UNKNOWN: return TYPE_UNKNOWN;
+		case TYPE_KIND_ARRAY: {
+			if (t->count >= 0 && n > t->count) {
+				type_error(c, (AST_Node*) sub, "%s has %d dimensions, not %d", type_name(c->table, array), t->count, n);
+				return TYPE_UNKNOWN;
+			}
+			int rest = t->count - n;
+			if (!n_slices && rest <= 0) {
+				result = t->base;
+				break;
+			}
+			if (t->count < 0) {
+				result = type_array(c->table, t->base, -1, NULL, false);
+				break;
+			}
+			// Slices keep their dimensions, with extents known at run time
+			int n_extents;
+			const int64_t* extents = type_extents(c->table, array, &n_extents);
+			int64_t ARRAY kept = NULL;
+			for (int i = 0; i < n; i++) {
+				if (sub->subscripts[i]->node_type == NODE_SLICE) arrput(kept, -1);
+			}
+			for (int i = n; i < t->count; i++) arrput(kept, i < n_extents && !t->is_dynamic? extents[i] : -1);
+			result = type_array(c->table, t->base, arrlen(kept), kept, false);
+			arrfree(kept);
+		} break;
+		case TYPE_KIND_STRING:
+			result = n_slices? TYPE_STRING : TYPE_RUNE;
+			break;
+		case TYPE_KIND_VECTOR:
+			result = t->base;
+			break;
+		case TYPE_KIND_STRUCT:
+		case TYPE_KIND_UNION:
+			return TYPE_UNKNOWN;
+		default:
+			type_error(c, (AST_Node*) sub, "A value of type %s can't be subscripted", type_name(c->table, array));
+			return TYPE_UNKNOWN;
+	}
+	return nullable? type_optional(c->table, result) : result;
+}
+
+static TypeId array_literal_type(Checker* c, AST_ArrayLiteral* array) {
+	int n = arrlen(array->elements);
+	int64_t extent = n;
+	if (!n) return type_array(c->table, TYPE_UNKNOWN, 1, &extent, false);
+	TypeId element = type_unqualified(c->table, type_of(c, &array->elements[0]));
+	bool all_arrays = true;
+	for (int i = 0; i < n; i++) {
+		NodeType node_type = array->elements[i]->node_type;
+		all_arrays = all_arrays && (node_type == NODE_ARRAY || node_type == NODE_PACKED_ARRAY);
+		if (i == 0 || literal_fits(c, &array->elements[i], element)) continue;
+		TypeId type = type_of(c, &array->elements[i]);
+		if (!type_common(c->table, element, type, &element)) {
+			type_error(c, (AST_Node*) array, "Array elements have types %s and %s", type_name(c->table, element), type_name(c->table, type));
+			return TYPE_UNKNOWN;
+		}
+	}
+	// Nested literals of the same shape make one array of more dimensions, up to a point, as
+	// each level has a type with the extents of those it's in
+	const Type* t = type_get(c->table, element);
+	if (all_arrays && t->kind == TYPE_KIND_ARRAY && t->count > 0 && t->count < MAX_LITERAL_DIMENSIONS && !t->is_dynamic) {
+		int n_extents;
+		const int64_t* extents = type_extents(c->table, element, &n_extents);
+		int64_t ARRAY shape = NULL;
+		arrput(shape, extent);
+		for (int i = 0; i < n_extents; i++) arrput(shape, extents[i]);
+		TypeId type = type_array(c->table, t->base, arrlen(shape), shape, false);
+		arrfree(shape);
+		return type;
+	}
+	return type_array(c->table, element, 1, &extent, false);
+}
+
+static TypeId packed_array_type(Checker* c, AST_PackedArray* packed) {
+	int64_t ARRAY shape = NULL;
+	for (int i = 0; i < arrlen(packed->shape); i++) arrput(shape, (int64_t) packed->shape[i]);
+	TypeId type = type_array(c->table, packed->kind == PACKED_INT? TYPE_INT : TYPE_FLOAT, arrlen(shape), shape, false);
+	arrfree(shape);
+	return type;
+}
+
+/// What a for loop over a value of the type gets in each iteration
+static TypeId element_type(Checker* c, AST_Node* const* slot, const AST_Node* at) {
+	bool nullable = false;
+	TypeId type = value_of(c, type_of(c, slot), &nullable);
+	const Type* t = type_get(c->table, type);
+	switch (t->kind) {
+		case TYPE_KIND_ARRAY: {
+			if (t->count <= 1) return t->base;
+			int n_extents;
+			const int64_t* extents = type_extents(c->table, type, &n_extents);
+			return type_array(c->table, t->base, t->count - 1, extents + 1, false);
+		}
+		case TYPE_KIND_STRING: return TYPE_RUNE;
+		case TYPE_KIND_VECTOR: return t->base;
+		case TYPE_KIND_UNKNOWN:
+		case TYPE_KIND_STRUCT:
+		case TYPE_KIND_UNION:
+			return TYPE_UNKNOWN;
+		default:
+			type_error(c, ast_is_shared(*slot)? at : *slot, "Can't loop over a value of type %s", type_name(c->table, type));
+			return TYPE_UNKNOWN;
+	}
+}
+
+// === Statements ===
+
+/// Whether a value can be written through a variable of the type: through its pointers,
+/// `peel` of them (all of them if negative)
+static bool is_writable(Checker* c, TypeId type, int peel) {
+	bool writable = false;
+	for (TypeId layer = type; ; ) {
+		const Type* t = type_get(c->table, layer);
+		if (t->kind == TYPE_KIND_MUTABLE) writable = true;
+		else if (t->kind == TYPE_KIND_POINTER && peel) {
+			writable = false;
+			peel--;
+		}
+		else if (t->kind != TYPE_KIND_OPTIONAL) return writable || t->kind == TYPE_KIND_UNKNOWN;
+		layer = t->base;
+	}
+}
+
+static void check_assignable(Checker* c, AST_Node* const* slot, const AST_Node* at) {
+	// Down to the variable that holds what is written
+	int levels = -1;
+	while (1) {
+		AST_Node* node = *slot;
+		if (node->node_type == NODE_FIELD_ACCESS) slot = &((AST_FieldAccess*) node)->base;
+		else if (node->node_type == NODE_SUBSCRIPT) slot = &((AST_Subscript*) node)->array;
+		else if (node->node_type == NODE_REREFERENCE) {
+			levels = ((AST_Reref*) node)->levels;
+			slot = &((AST_Reref*) node)->target;
+		}
+		else break;
+	}
+	if ((*slot)->node_type != NODE_QUALNAME) {
+		if ((*slot)->node_type != NODE_FUNC_CALL) type_error(c, at, "Only variables, fields and elements can be assigned to");
+		return;
+	}
+	ResolvedName found = resolution_lookup(c->res, slot);
+	if (!found.symbol) return;
+	const Symbol* symbol = resolution_symbol(c->res, found.symbol);
+	switch (symbol->kind) {
+		case DECL_LOCAL:
+		case DECL_PARAM:
+		case DECL_LOOP_VAR:
+		case DECL_CONTEXT:
+			break;
+		default:
+			type_error(c, at, "'%s' can't be assigned to", symbol->name);
+			return;
+	}
+	TypeId type = symbol_type(c, found.symbol);
+	int depth = 0;
+	for (TypeId layer = type; kind_of(c, layer) >= TYPE_KIND_POINTER && kind_of(c, layer) <= TYPE_KIND_OPTIONAL; layer = type_get(c->table, layer)->base) {
+		if (kind_of(c, layer) == TYPE_KIND_POINTER) depth++;
+	}
+	int peel = levels < 0? -1 : depth - levels;
+	if (peel < -1) peel = 0;
+	if (!is_writable(c, type, peel)) type_error(c, at, "'%s' can't be assigned to, as %s isn't mutable", symbol->name, type_name(c->table, type));
+}
+
+static void check_assignment(Checker* c, const AST_Node* at, AST_Node* const* dest, AST_Node* const* src) {
+	check_assignable(c, dest, at);
+	TypeId want = type_of(c, dest);
+	if ((*dest)->node_type == NODE_REREFERENCE) {
+		// As many '@' are added to the right side as it takes
+		bool nullable = false;
+		TypeId have = value_of(c, type_of(c, src), &nullable);
+		TypeId target = value_of(c, want, &nullable);
+		if (type_coercion(c->table, have, target) == COERCE_NONE) {
+			type_error(c, at, "A value of type %s can't be assigned to %s", type_name(c->table, have), type_name(c->table, want));
+		}
+		return;
+	}
+	check_value(c, src, want, at, "The assigned value");
+}
+
+static void check_return(Checker* c, AST_Return* ret) {
+	if (!arrlen(c->functions) || !arrlast(c->functions)) return;
+	AST_FuncDef* func = arrlast(c->functions);
+	TypeId want = func->ret_type? resolve_type(c, func->ret_type) : TYPE_VOID;
+	if (ret->value && want == TYPE_VOID) {
+		type_error(c, (AST_Node*) ret, "'%s' has no return type, so it can't return a value", func->name->name);
+	}
+	else if (ret->value) check_value(c, &ret->value, want, (AST_Node*) ret, "The returned value");
+	else if (want != TYPE_VOID && want != TYPE_UNKNOWN) {
+		type_error(c, (AST_Node*) ret, "'%s' must return a value of type %s", func->name->name, type_name(c->table, want));
+	}
+}
+
+static void check_var_decl(Checker* c, AST_VarDecl* var) {
+	TypeId type;
+	char what[256];
+	snprintf(what, sizeof(what), "The value of '%s'", var->name->name);
+	if (var->type) {
+		type = resolve_type(c, var->type);
+		if (var->value) check_value(c, &var->value, type, (AST_Node*) var, what);
+	}
+	else if (var->value) {
+		TypeId value = type_unqualified(c->table, type_of(c, &var->value));
+		if (value == TYPE_NULL || value == TYPE_VOID) {
+			type_error(c, (AST_Node*) var, "The type of '%s' can't be inferred from %s", var->name->name, value == TYPE_NULL? "null" : "a function that returns nothing");
+			value = TYPE_UNKNOWN;
+		}
+		// Inferred locals are as mutable as they can be
+		type = type_mutable(c->table, value);
+	}
+	else type = TYPE_UNKNOWN;
+	set_symbol_type(c, declared_symbol(c, &var->name), type);
+}
+
+static void check_const(Checker* c, AST_Const* constant) {
+	SymbolId id = declared_symbol(c, &constant->name);
+	if (constant->type) {
+		TypeId type = resolve_type(c, constant->type);
+		char what[256];
+		snprintf(what, sizeof(what), "The value of '%s'", constant->name->name);
+		if (constant->value) check_value(c, &constant->value, type, (AST_Node*) constant, what);
+		set_symbol_type(c, id, type);
+	}
+	else set_symbol_type(c, id, constant->value? type_unqualified(c->table, type_of(c, &constant->value)) : TYPE_UNKNOWN);
+}
+
+static void check_param(Checker* c, AST_Param* param) {
+	SymbolId id = declared_symbol(c, &param->name);
+	int64_t runtime = -1;
+	if (param->type) {
+		TypeId type = resolve_type(c, param->type);
+		char what[256];
+		snprintf(what, sizeof(what), "The default of '%s'", param->name->name);
+		if (param->default_value) check_value(c, &param->default_value, type, (AST_Node*) param, what);
+		set_symbol_type(c, id, param->is_vararg? type_array(c->table, type, 1, &runtime, true) : type);
+	}
+	else {
+		TypeId type = param->default_value? type_unqualified(c->table, type_of(c, &param->default_value)) : TYPE_UNKNOWN;
+		set_symbol_type(c, id, param->is_vararg? type_array(c->table, type, 1, &runtime, true) : type);
+	}
+}
+
+static void check_for_range(Checker* c, AST_ForRange* range) {
+	TypeId type = TYPE_INT;
+	AST_Node** bounds[] = { &range->start, &range->end, &range->step };
+	for (int i = 0; i < 3; i++) {
+		if (!*bounds[i]) continue;
+		check_index(c, bounds[i], (AST_Node*) range);
+		TypeId bound = value_of(c, type_of(c, bounds[i]), NULL);
+		if (i == 0 || !literal_fits(c, bounds[i], type)) {
+			if (!type_common(c->table, i? type : bound, bound, &type)) type = TYPE_UNKNOWN;
+		}
+	}
+	set_symbol_type(c, declared_symbol(c, &range->name), is_integer_kind(kind_of(c, type))? type : TYPE_UNKNOWN);
+}
+
+// === Walk ===
+
+/// Operators take one operand or two, and comparisons give a Bool
+static void check_operator(Checker* c, AST_FuncDef* func) {
+	const char* op = func->name->name;
+	int n_required = 0;
+	for (int i = 0; i < shlen(func->params); i++) {
+		if (!func->params[i].value->default_value && !func->params[i].value->is_vararg) n_required++;
+	}
+	if (n_required > 2 || !shlen(func->params)) type_error(c, (AST_Node*) func->name, "An overload of '%s' must take one operand or two", op);
+	bool comparison = (op[0] == '=' || op[0] == '!' || op[0] == '<' || op[0] == '>') && (!op[1] || (op[1] == '=' && !op[2]));
+	TypeId ret = func->ret_type? type_unqualified(c->table, resolve_type(c, func->ret_type)) : TYPE_VOID;
+	if (comparison && ret != TYPE_BOOL && ret != TYPE_UNKNOWN) {
+		type_error(c, (AST_Node*) func->name, "An overload of '%s' must return a Bool, not %s", op, type_name(c->table, ret));
+	}
+}
+
+static WalkAction check_pre(AST_Node** slot, void* ctx) {
+	Checker* c = ctx;
+	AST_Node* node = *slot;
+	switch (node->node_type) {
+		// Resolved where they are used
+		case NODE_SIMPLE_TYPE:
+		case NODE_POINTER_TYPE:
+		case NODE_MUTABLE_TYPE:
+		case NODE_OPTIONAL_TYPE:
+		case NODE_ARRAY_TYPE:
+		case NODE_FUNC_TYPE:
+		case NODE_TEMPLATE_TYPE:
+		case NODE_UNION:
+		case NODE_NAME:
+		// Not checked until they are used
+		case NODE_IMPORT:
+		case NODE_MACRO:
+			return WALK_SKIP;
+
+		case NODE_FUNC_CALL:
+			c->callee = &((AST_FuncCall*) node)->func;
+			break;
+		// Its field is walked last, after what it is in
+		case NODE_FIELD_ACCESS:
+			arrput(c->members, (AST_Node**) &((AST_FieldAccess*) node)->field);
+			break;
+
+		case NODE_FUNC_OVERLOAD: {
+			AST_FuncOverload* overload = (AST_FuncOverload*) node;
+			for (int i = 0; i < arrlen(overload->overloads); i++) {
+				SymbolId id = declared_symbol(c, &overload->overloads[i]);
+				if (!id || resolution_symbol(c->res, id)->kind == DECL_FUNCTION) continue;
+				type_error(c, (AST_Node*) overload->overloads[i], "'%s' is in the overloads of '%s', but isn't a function",
+					overload->overloads[i]->name, overload->name->name);
+			}
+			return WALK_SKIP;
+		}
+
+		case NODE_CONST:
+		case NODE_PARAM:
+			if (type_map_has(&c->checked, node)) return WALK_SKIP;
+			break;
+
+		case NODE_FUNC_DEF:
+			if (((AST_FuncDef*) node)->name && ast_is_operator_name(((AST_FuncDef*) node)->name->name)) check_operator(c, (AST_FuncDef*) node);
+			// fallthrough
+		case NODE_TEST:
+			arrput(c->functions, node->node_type == NODE_FUNC_DEF? (AST_FuncDef*) node : NULL);
+			if (c->bodies) {
+				arrput(*c->bodies, slot);
+				return WALK_SKIP;
+			}
+			break;
+
+		default: break;
+	}
+	return WALK_CONTINUE;
+}
+
+static WalkAction check_post(AST_Node** slot, void* ctx) {
+	Checker* c = ctx;
+	AST_Node* node = *slot;
+	if (!ast_is_shared(node)) c->where = node;
+	switch (node->node_type) {
+		// Expressions
+		case NODE_QUALNAME: {
+			bool member = arrlen(c->members) && arrlast(c->members) == slot;
+			if (member) (void) arrpop(c->members);
+			put_type(c, slot, qualname_type(c, slot, member));
+		} break;
+		case NODE_BINOP: {
+			AST_Binop* binop = (AST_Binop*) node;
+			put_type(c, slot, arithmetic_type(c, node, binop->op, &binop->lhs, &binop->rhs));
+		} break;
+		case NODE_COMPARISON: {
+			AST_ComparisonChain* chain = (AST_ComparisonChain*) node;
+			for (int i = 0; i < arrlen(chain->comparisons); i++) {
+				check_comparison(c, node, &chain->comparisons[i], chain->comparisons[i], &chain->operands[i], &chain->operands[i + 1]);
+			}
+			put_type(c, slot, TYPE_BOOL);
+		} break;
+		case NODE_UNARY: {
+			AST_Unary* unary = (AST_Unary*) node;
+			bool nullable = false;
+			TypeId type = value_of(c, type_of(c, &unary->expr), &nullable);
+			TypeKind kind = kind_of(c, type);
+			if ((strcmp(unary->op, "-") && strcmp(unary->op, "+")) || !is_scalar_kind(kind)) {
+				put_type(c, slot, operator_type(c, node, node, unary->op, &unary->expr, NULL));
+				break;
+			}
+			if (!is_number_kind(kind) && kind != TYPE_KIND_VECTOR) {
+				type_error(c, node, "Operator '%s' isn't defined for %s", unary->op, type_name(c->table, type));
+				type = TYPE_UNKNOWN;
+			}
+			put_type(c, slot, nullable? type_optional(c->table, type) : type);
+		} break;
+		case NODE_NOT: put_type(c, slot, logic_type(c, node, &((AST_Not*) node)->expr)); break;
+		case NODE_AND:
+		case NODE_OR: {
+			AST_And* logic = (AST_And*) node;
+			TypeId left = logic_type(c, node, &logic->lhs), right = logic_type(c, node, &logic->rhs);
+			put_type(c, slot, left != TYPE_BOOL? left : right);
+		} break;
+		case NODE_TERNARY: {
+			AST_Ternary* ternary = (AST_Ternary*) node;
+			check_condition(c, &ternary->condition, node);
+			TypeId yes = type_of(c, &ternary->true_expr), no = type_of(c, &ternary->false_expr), type;
+			if (literal_fits(c, &ternary->true_expr, no)) type = type_unqualified(c->table, no);
+			else if (literal_fits(c, &ternary->false_expr, yes)) type = type_unqualified(c->table, yes);
+			else if (!type_common(c->table, yes, no, &type)) {
+				type_error(c, node, "The branches of the conditional have types %s and %s", type_name(c->table, yes), type_name(c->table, no));
+				type = TYPE_UNKNOWN;
+			}
+			put_type(c, slot, type);
+		} break;
+		case NODE_REREFERENCE: put_type(c, slot, reref_type(c, (AST_Reref*) node)); break;
+		case NODE_FUNC_CALL: put_type(c, slot, call_type(c, (AST_FuncCall*) node)); break;
+		case NODE_SUBSCRIPT: put_type(c, slot, subscript_type(c, (AST_Subscript*) node)); break;
+		case NODE_SLICE: {
+			AST_Slice* slice = (AST_Slice*) node;
+			if (slice->start) check_index(c, &slice->start, node);
+			if (slice->end) check_index(c, &slice->end, node);
+			if (slice->step) check_index(c, &slice->step, node);
+		} break;
+		case NODE_FIELD_ACCESS: {
+			AST_FieldAccess* access = (AST_FieldAccess*) node;
+			TypeId type = type_of(c, &access->base);
+			for (int i = 0; i < arrlen(access->field->parts); i++) type = member_type(c, type, access->field->parts[i], node);
+			put_type(c, slot, type);
+		} break;
+		case NODE_ARRAY: put_type(c, slot, array_literal_type(c, (AST_ArrayLiteral*) node)); break;
+		case NODE_PACKED_ARRAY: put_type(c, slot, packed_array_type(c, (AST_PackedArray*) node)); break;
+		case NODE_ARRAY_RANGE: {
+			AST_ArrayRange* range = (AST_ArrayRange*) node;
+			if (range->start) check_index(c, &range->start, node);
+			if (range->end) check_index(c, &range->end, node);
+			if (range->step) check_index(c, &range->step, node);
+			int64_t runtime = -1;
+			put_type(c, slot, type_array(c->table, TYPE_INT, 1, &runtime, false));
+		} break;
+
+		// Statements
+		case NODE_VAR_DECL: check_var_decl(c, (AST_VarDecl*) node); break;
+		case NODE_ASSIGN: {
+			AST_AssignChain* assign = (AST_AssignChain*) node;
+			for (int i = 0; i < arrlen(assign->dest_exprs); i++) check_assignment(c, node, &assign->dest_exprs[i], &assign->src_expr);
+		} break;
+		case NODE_ASSIGN_MANY: {
+			AST_AssignParallel* assign = (AST_AssignParallel*) node;
+			int n = arrlen(assign->dest_exprs);
+			if (n != arrlen(assign->src_exprs)) {
+				type_error(c, node, "%d values are assigned to %d destinations", (int) arrlen(assign->src_exprs), n);
+				break;
+			}
+			for (int i = 0; i < n; i++) check_assignment(c, node, &assign->dest_exprs[i], &assign->src_exprs[i]);
+		} break;
+		case NODE_OP_ASSIGN: {
+			AST_OpAssign* assign = (AST_OpAssign*) node;
+			check_assignable(c, &assign->dest_expr, node);
+			TypeId result = arithmetic_type(c, node, assign->op, &assign->dest_expr, &assign->src_expr);
+			TypeId want = type_of(c, &assign->dest_expr);
+			if (type_coercion(c->table, result, want) == COERCE_NONE) {
+				type_error(c, node, "The result of '%s=' has type %s, which can't be stored in %s", assign->op, type_name(c->table, result), type_name(c->table, want));
+			}
+		} break;
+		case NODE_IF_STMT: check_condition(c, &((AST_IfStatement*) node)->condition, node); break;
+		case NODE_WHILE_LOOP: check_condition(c, &((AST_WhileLoop*) node)->condition, node); break;
+		case NODE_ASSERT: {
+			AST_Assert* assert = (AST_Assert*) node;
+			check_condition(c, &assert->value, node);
+			if (assert->message) check_value(c, &assert->message, TYPE_STRING, node, "The message of the assertion");
+		} break;
+		case NODE_CONTRACT: check_condition(c, &((AST_Contract*) node)->condition, node); break;
+		case NODE_RETURN: check_return(c, (AST_Return*) node); break;
+		case NODE_FOR_SIMPLE: {
+			AST_ForSimple* loop = (AST_ForSimple*) node;
+			set_symbol_type(c, declared_symbol(c, &loop->name), element_type(c, &loop->iterable, node));
+		} break;
+		case NODE_FOR_RANGE: check_for_range(c, (AST_ForRange*) node); break;
+		case NODE_FOR_PARALLEL: {
+			AST_ForParallel* loop = (AST_ForParallel*) node;
+			for (int i = 0; i < arrlen(loop->names) && i < shlen(loop->zips); i++) {
+				set_symbol_type(c, declared_symbol(c, &loop->names[i]), element_type(c, &loop->zips[i].value, node));
+			}
+		} break;
+		case NODE_CONTEXT: {
+			AST_Context* context = (AST_Context*) node;
+			if (context->value) set_symbol_type(c, declared_symbol(c, &context->name), type_unqualified(c->table, type_of(c, &context->value)));
+		} break;
+
+		// Declarations
+		case NODE_CONST:
+			if (type_map_has(&c->checked, node)) break;
+			check_const(c, (AST_Const*) node);
+			type_map_put(&c->checked, node, TYPE_UNKNOWN);
+			break;
+		case NODE_PARAM:
+			if (type_map_has(&c->checked, node)) break;
+			check_param(c, (AST_Param*) node);
+			type_map_put(&c->checked, node, TYPE_UNKNOWN);
+			break;
+		case NODE_FIELD: {
+			AST_Field* field = (AST_Field*) node;
+			TypeId type = resolve_type(c, field->type);
+			char what[256];
+			snprintf(what, sizeof(what), "The default of '%s'", field->name->name);
+			if (field->type && field->default_value) check_value(c, &field->default_value, type, node, what);
+			if (field->invariant) check_condition(c, &field->invariant, node);
+		} break;
+		case NODE_ENUM_VALUE: {
+			AST_EnumValue* value = (AST_EnumValue*) node;
+			if (value->value) check_index(c, &value->value, node);
+		} break;
+		case NODE_FUNC_DEF:
+		case NODE_TEST:
+			(void) arrpop(c->functions);
+			break;
+
+		default: break;
+	}
+	return WALK_CONTINUE;
+}
+
+static void checker_init(Checker* c, TypeCheck check, int task) {
+	*c = (Checker) { .check = check, .table = check->table, .res = check->res, .task = task, .dispatch = dispatch_cache_create() };
+}
+
+static void checker_free(Checker* c) {
+	type_map_free(&c->exprs);
+	type_map_free(&c->type_nodes);
+	type_map_free(&c->checked);
+	type_map_free(&c->targets);
+	dispatch_cache_destroy(c->dispatch);
+	arrfree(c->functions);
+	for (int i = 0; i < arrlen(c->diagnostics); i++) free(c->diagnostics[i].message);
+	arrfree(c->diagnostics);
+	arrfree(c->text);
+	arrfree(c->given);
+	arrfree(c->keys);
+	arrfree(c->kw_names);
+	arrfree(c->viable);
+	arrfree(c->matches);
+	arrfree(c->members);
+}
+
+/// Everything but the bodies of the module's functions and tests, which are put aside, and
+/// the types of the symbols declared outside of them
+static void check_signatures(TypeCheck check, AST_Module* module) {
+	Checker* c = &check->main;
+	c->bodies = &check->bodies;
+	AST_Visitor visitor = { check_pre, check_post, c };
+	AST_Node* root = (AST_Node*) module;
+	ast_walk_iterative(&root, &visitor);
+	c->bodies = NULL;
+	for (int i = 0; i < arrlen(check->bodies); i++) {
+		if ((*check->bodies[i])->node_type != NODE_FUNC_DEF) continue;
+		AST_FuncDef* func = (AST_FuncDef*) *check->bodies[i];
+		for (int j = 0; j < shlen(func->params); j++) {
+			if (!type_map_has(&c->checked, func->params[j].value)) check_ahead(c, (AST_Node*) func->params[j].value);
+		}
+	}
+	int n_members;
+	const SymbolId* members = resolution_scope_members(check->res, 0, &n_members);
+	for (int i = 0; i < n_members; i++) symbol_type(c, members[i]);
+}
+
+static void check_body(void* ctx, int task, int worker) {
+	TypeCheck check = ctx;
+	Checker* c = &check->workers[worker];
+	AST_Node* node = *check->bodies[task];
+	c->task = task;
+	c->where = node;
+	AST_Node** body;
+	if (node->node_type == NODE_FUNC_DEF) {
+		arrput(c->functions, (AST_FuncDef*) node);
+		body = (AST_Node**) &((AST_FuncDef*) node)->body;
+	}
+	else {
+		arrput(c->functions, NULL);
+		body = (AST_Node**) &((AST_Test*) node)->body;
+	}
+	AST_Visitor visitor = { check_pre, check_post, c };
+	ast_walk_iterative(body, &visitor);
+	if (c->functions) stbds_header(c->functions)->length = 0;
+}
+
+TypeCheck typecheck_module(AST_Module* module, Resolution res, TypeTable table, TaskPool pool) {
+	TypeCheck check = calloc(1, sizeof(struct _type_check));
+	check->table = table;
+	check->res = res;
+	int n_symbols = resolution_symbol_count(res) + 1;
+	arrsetlen(check->symbol_types, n_symbols);
+	arrsetlen(check->symbol_states, n_symbols);
+	memset(check->symbol_types, 0, n_symbols * sizeof(TypeId));
+	memset(check->symbol_states, 0, n_symbols);
+	for (int i = 0; i < shlen(module->scope); i++) {
+		AST_Node* item = module->scope[i].value;
+		if (item->node_type == NODE_IMPORT && ((AST_Import*) item)->is_using) check->has_using_imports = true;
+	}
+	check->overloads = overloads_create(res);
+	checker_init(&check->main, check, -1);
+	check->main.where = (AST_Node*) module;
+	check_signatures(check, module);
+
+	check->n_workers = pool? task_pool_size(pool) : 1;
+	check->workers = malloc(check->n_workers * sizeof(Checker));
+	for (int i = 0; i < check->n_workers; i++) checker_init(&check->workers[i], check, 0);
+	if (pool) task_pool_run(pool, arrlen(check->bodies), check_body, check);
+	else {
+		for (int i = 0; i < arrlen(check->bodies); i++) check_body(check, i, 0);
+	}
+
+	// The errors the workers found go with the rest
+	Checker* c = &check->main;
+	for (int i = 0; i < check->n_workers; i++) {
+		Checker* worker = &check->workers[i];
+		for (int j = 0; j < arrlen(worker->diagnostics); j++) arrput(c->diagnostics, worker->diagnostics[j]);
+		if (worker->diagnostics) stbds_header(worker->diagnostics)->length = 0;
+	}
+	check->n_errors = arrlen(c->diagnostics);
+	report_diagnostics(c->diagnostics, arrlen(c->diagnostics));
+	return check;
+}
+
+void typecheck_destroy(TypeCheck check) {
+	if (!check) return;
+	arrfree(check->symbol_types);
+	arrfree(check->symbol_states);
+	arrfree(check->bodies);
+	checker_free(&check->main);
+	for (int i = 0; i < check->n_workers; i++) checker_free(&check->workers[i]);
+	free(check->workers);
+	overloads_destroy(check->overloads);
+	free(check);
+}
+
+int typecheck_error_count(TypeCheck check) {
+	return check->n_errors;
+}
+
+TypeId typecheck_symbol_type(TypeCheck check, SymbolId id) {
+	if (id <= 0 || id >= arrlen(check->symbol_types)) return TYPE_UNKNOWN;
+	return check->symbol_states[id] == SYMBOL_DONE? check->symbol_types[id] : TYPE_UNKNOWN;
+}
+
+TypeId typecheck_type_of(TypeCheck check, const AST_Node* type_node) {
+	TypeId type;
+	if (!type_node) return TYPE_UNKNOWN;
+	if (type_map_get(&check->main.type_nodes, type_node, &type)) return type;
+	for (int i = 0; i < check->n_workers; i++) {
+		if (type_map_get(&check->workers[i].type_nodes, type_node, &type)) return type;
+	}
+	return TYPE_UNKNOWN;
+}
+
+TypeId typecheck_expr_type(TypeCheck check, AST_Node* const* slot) {
+	return checked_type(check, slot);
+}
+
+static SymbolId find_target(TypeCheck check, const void* key) {
+	TypeId id;
+	if (type_map_get(&check->main.targets, key, &id)) return (SymbolId) id;
+	for (int i = 0; i < check->n_workers; i++) {
+		if (type_map_get(&check->workers[i].targets, key, &id)) return (SymbolId) id;
+	}
+	return 0;
+}
+
+SymbolId typecheck_call_target(TypeCheck check, const AST_Node* node) {
+	return find_target(check, node);
+}
+
+SymbolId typecheck_comparison_target(TypeCheck check, const AST_ComparisonChain* chain, int i) {
+	return find_target(check, &chain->comparisons[i]);
+}
+
+int typecheck_dispatch_count(TypeCheck check) {
+	int n = check->main.n_dispatched;
+	for (int i = 0; i < check->n_workers; i++) n += check->workers[i].n_dispatched;
+	return n;
+}
+
+int typecheck_dispatch_cache_hits(TypeCheck check) {
+	int n = dispatch_cache_hits(check->main.dispatch);
+	for (int i = 0; i < check->n_workers; i++) n += dispatch_cache_hits(check->workers[i].dispatch);
+	return n;
+}
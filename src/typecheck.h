@@ -0,0 +1,39 @@
+#pragma once
+// Type checking of a module's declarations and expressions, on top of its name resolution
+#include <stdbool.h>
+
+#include "ast.h"
+#include "resolve.h"
+#include "types.h"
+#include "pool.h"
+
+typedef struct _type_check* TypeCheck;
+
+/// Works out the type of every symbol and expression of the module, and reports the
+/// errors it finds to stderr, in the order of the source. The types are interned in the
+/// given table, which may be shared by the checks of several modules. With a pool, the
+/// bodies of functions and tests are checked on its threads; with NULL, on this one.
+TypeCheck typecheck_module(AST_Module* module, Resolution res, TypeTable table, TaskPool pool);
+void typecheck_destroy(TypeCheck check);
+
+int typecheck_error_count(TypeCheck check);
+
+// These only read what the check found, so once it is done they can be used from any thread
+
+/// TYPE_UNKNOWN where it couldn't be worked out, as for names that aren't declared in the
+/// module, or declared in code that wasn't checked
+TypeId typecheck_symbol_type(TypeCheck check, SymbolId id);
+/// The type of the expression held in *slot
+TypeId typecheck_expr_type(TypeCheck check, AST_Node* const* slot);
+/// The type a type node of the module stands for
+TypeId typecheck_type_of(TypeCheck check, const AST_Node* type_node);
+/// The function of the module a call, operator or op-assignment node resolves to: the one
+/// it calls, or the overload picked for its arguments. 0 if there is none, as for builtin
+/// operators, casts and calls of values.
+SymbolId typecheck_call_target(TypeCheck check, const AST_Node* node);
+/// The same for comparison i of a chain, which is overloaded if its operands aren't builtin types
+SymbolId typecheck_comparison_target(TypeCheck check, const AST_ComparisonChain* chain, int i);
+
+/// Calls and operators resolved to overloads, and of those, how many were a cache lookup
+int typecheck_dispatch_count(TypeCheck check);
+int typecheck_dispatch_cache_hits(TypeCheck check);
@@ -0,0 +1,709 @@
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "types.h"
+#include "stb_ds.h"
+
+#define NO_COMMON_TYPE UINT32_MAX
+
+#define TYPE_CHUNK_BITS 12
+#define MAX_TYPE_CHUNKS (1 << 16)
+#define PARTS_BLOCK_SIZE 65536
+#define MAX_NAME_LENGTH 500  // of a type's name, beyond which it's cut short with "..."
+
+typedef struct {
+	const char* spelling;
+	TypeId id;
+} Spelling;
+
+// A rule worked out for a pair of types, by (a << 32 | b); 0 = free, as pairs of scalars are never kept
+typedef struct {
+	uint64_t key;
+	uint32_t value;
+} PairRule;
+
+typedef struct {
+	PairRule* slots;
+	size_t mask, count;
+} PairRules;
+
+// Threads may share a table: types are never moved once added, so they are read without
+// locking, and an id is only had once the type it names has been added
+struct _type_table {
+	Type* chunks[MAX_TYPE_CHUNKS];  // of 1 << TYPE_CHUNK_BITS types
+	uint32_t n_types;
+	uint32_t ARRAY hashes;   // by id, of the compound types
+	char* ARRAY blocks;      // which params, variants and extents are kept in
+	size_t block_left;
+	TypeId* slots;           // open addressing by structure; TYPE_UNKNOWN = free
+	size_t slots_mask;
+	pthread_rwlock_t lock;   // of all of the above
+	Spelling spellings[64];  // sorted
+	int n_spellings;
+	// The rules applied to pairs of scalars, worked out up front, and to other pairs, as they come up
+	uint8_t scalar_coercions[TYPE_FIRST_COMPOUND][TYPE_FIRST_COMPOUND];  // Coercion
+	TypeId scalar_commons[TYPE_FIRST_COMPOUND][TYPE_FIRST_COMPOUND];     // or NO_COMMON_TYPE
+	PairRules coercions;
+	PairRules commons;
+	pthread_rwlock_t rules_lock;
+	char* ARRAY names;       // by id, as they are asked for
+	pthread_mutex_t names_lock;
+};
+
+static const struct { TypeKind kind; int bits; const char* spellings[7]; } SCALARS[TYPE_FIRST_COMPOUND] = {
+	[TYPE_UNKNOWN] = { TYPE_KIND_UNKNOWN, 0, { "<unknown>" } },
+	[TYPE_VOID] = { TYPE_KIND_VOID, 0, { "Void" } },
+	[TYPE_NULL] = { TYPE_KIND_NULL, 0, { "null" } },
+	[TYPE_BOOL] = { TYPE_KIND_BOOL, 8, { "Bool", "Boolean" } },
+	[TYPE_S8] = { TYPE_KIND_SINT, 8, { "Int8", "SInt8", "S8" } },
+	[TYPE_S16] = { TYPE_KIND_SINT, 16, { "Int16", "SInt16", "S16" } },
+	[TYPE_S32] = { TYPE_KIND_SINT, 32, { "Int32", "SInt32", "S32" } },
+	[TYPE_S64] = { TYPE_KIND_SINT, 64, { "Int", "SInt", "Int64", "SInt64", "S64", "Integer" } },
+	[TYPE_U8] = { TYPE_KIND_UINT, 8, { "UInt8", "U8" } },
+	[TYPE_U16] = { TYPE_KIND_UINT, 16, { "UInt16", "U16" } },
+	[TYPE_U32] = { TYPE_KIND_UINT, 32, { "UInt32", "U32" } },
+	[TYPE_U64] = { TYPE_KIND_UINT, 64, { "UInt", "UInt64", "U64" } },
+	[TYPE_F32] = { TYPE_KIND_FLOAT, 32, { "Float32", "F32" } },
+	[TYPE_F64] = { TYPE_KIND_FLOAT, 64, { "Float", "Float64", "F64" } },
+	[TYPE_C32] = { TYPE_KIND_COMPLEX, 32, { "Complex32", "C32" } },
+	[TYPE_C64] = { TYPE_KIND_COMPLEX, 64, { "Complex", "Complex64", "C64" } },
+	[TYPE_STRING] = { TYPE_KIND_STRING, 0, { "String", "Str" } },
+	[TYPE_RUNE] = { TYPE_KIND_RUNE, 32, { "Rune", "Char" } },
+	[TYPE_RAWPTR] = { TYPE_KIND_RAWPTR, 64, { "RawPtr" } },
+	[TYPE_ANY] = { TYPE_KIND_ANY, 0, { "Any" } },
+	[TYPE_TYPE] = { TYPE_KIND_TYPE, 0, { "Type" } },
+};
+
+static inline bool is_number(TypeKind kind) {
+	return kind == TYPE_KIND_SINT || kind == TYPE_KIND_UINT || kind == TYPE_KIND_FLOAT || kind == TYPE_KIND_COMPLEX;
+}
+
+static inline bool is_integer(TypeKind kind) {
+	return kind == TYPE_KIND_SINT || kind == TYPE_KIND_UINT;
+}
+
+// === Scalar rules ===
+
+static Coercion scalar_coercion(TypeId from, TypeId to) {
+	TypeKind f = SCALARS[from].kind, t = SCALARS[to].kind;
+	int f_bits = SCALARS[from].bits, t_bits = SCALARS[to].bits;
+	if (from == to || from == TYPE_UNKNOWN || to == TYPE_UNKNOWN) return COERCE_EXACT;
+	if (from == TYPE_VOID || to == TYPE_VOID) return COERCE_NONE;
+	if (to == TYPE_ANY) return COERCE_WRAP;
+	if (to == TYPE_BOOL) return is_number(f) || f == TYPE_KIND_RAWPTR? COERCE_TO_BOOL : COERCE_NONE;
+	if (!is_number(f) || !is_number(t)) return COERCE_NONE;
+	if (f == t || (f == TYPE_KIND_UINT && t == TYPE_KIND_SINT)) return f_bits <= t_bits? COERCE_NUMERIC : COERCE_NONE;
+	if (is_integer(f)) return t == TYPE_KIND_FLOAT || t == TYPE_KIND_COMPLEX? COERCE_NUMERIC : COERCE_NONE;
+	return f == TYPE_KIND_FLOAT && t == TYPE_KIND_COMPLEX? COERCE_NUMERIC : COERCE_NONE;
+}
+
+static TypeId scalar_of(TypeKind kind, int bits) {
+	for (TypeId id = 0; id < TYPE_FIRST_COMPOUND; id++) {
+		if (SCALARS[id].kind == kind && SCALARS[id].bits == bits) return id;
+	}
+	return NO_COMMON_TYPE;
+}
+
+static TypeId scalar_common(TypeId a, TypeId b) {
+	TypeKind ka = SCALARS[a].kind, kb = SCALARS[b].kind;
+	if (a == b) return a;
+	if (a == TYPE_UNKNOWN || b == TYPE_UNKNOWN) return TYPE_UNKNOWN;
+	if ((a == TYPE_BOOL && is_number(kb)) || (b == TYPE_BOOL && is_number(ka))) return TYPE_BOOL;
+	if (!is_number(ka) || !is_number(kb)) return NO_COMMON_TYPE;
+	int bits = SCALARS[a].bits > SCALARS[b].bits? SCALARS[a].bits : SCALARS[b].bits;
+	if (ka == kb) return scalar_of(ka, bits);
+	if (is_integer(ka) && is_integer(kb)) return scalar_of(TYPE_KIND_SINT, bits);
+	// Int and Float: Float, Float and Complex: Complex
+	if (ka < kb) return is_integer(ka)? b : scalar_of(kb, bits);
+	return is_integer(kb)? a : scalar_of(ka, bits);
+}
+
+// === Interning ===
+
+static uint32_t hash_type(const Type* type, const TypeId* members, const int64_t* extents) {
+	uint64_t hash = 0xcbf29ce484222325ull;
+	uint64_t fields[] = { type->kind, type->bits, (uint64_t) type->count, type->base, type->is_dynamic, (uintptr_t) type->decl };
+	for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) hash = (hash ^ fields[i]) * 0x100000001b3ull;
+	int n_members = type->kind == TYPE_KIND_FUNC || type->kind == TYPE_KIND_UNION? type->count : 0;
+	for (int i = 0; i < n_members; i++) hash = (hash ^ members[i]) * 0x100000001b3ull;
+	int n_extents = type->kind == TYPE_KIND_ARRAY && type->count > 0? type->count : 0;
+	for (int i = 0; i < n_extents; i++) hash = (hash ^ (uint64_t) extents[i]) * 0x100000001b3ull;
+	return (uint32_t) (hash ^ hash >> 32);
+}
+
+static inline Type* type_at(TypeTable table, TypeId id) {
+	return &table->chunks[id >> TYPE_CHUNK_BITS][id & ((1 << TYPE_CHUNK_BITS) - 1)];
+}
+
+static bool same_type(const Type* a, const Type* b, const TypeId* members, const int64_t* extents) {
+	if (a->kind != b->kind || a->bits != b->bits || a->count != b->count || a->base != b->base
+		|| a->is_dynamic != b->is_dynamic || a->decl != b->decl) return false;
+	if (a->kind == TYPE_KIND_FUNC || a->kind == TYPE_KIND_UNION) {
+		return memcmp(a->members, members, a->count * sizeof(TypeId)) == 0;
+	}
+	if (a->kind == TYPE_KIND_ARRAY && a->count > 0) {
+		return memcmp(a->extents, extents, a->count * sizeof(int64_t)) == 0;
+	}
+	return true;
+}
+
+static void grow_slots(TypeTable table) {
+	free(table->slots);
+	table->slots_mask = table->slots_mask? 2 * table->slots_mask + 1 : 1023;
+	table->slots = calloc(table->slots_mask + 1, sizeof(TypeId));
+	for (TypeId id = TYPE_FIRST_COMPOUND; id < table->n_types; id++) {
+		size_t i = table->hashes[id] & table->slots_mask;
+		while (table->slots[i]) i = (i + 1) & table->slots_mask;
+		table->slots[i] = id;
+	}
+}
+
+/// A copy of the params, variants or extents of a type, which stays where it is
+static void* keep_parts(TypeTable table, const void* parts, size_t size) {
+	if (size > table->block_left) {
+		size_t block_size = size > PARTS_BLOCK_SIZE? size : PARTS_BLOCK_SIZE;
+		arrput(table->blocks, malloc(block_size));
+		table->block_left = block_size;
+	}
+	char* block = arrlast(table->blocks);
+	char* kept = block + (size > PARTS_BLOCK_SIZE? 0 : PARTS_BLOCK_SIZE - table->block_left);
+	memcpy(kept, parts, size);
+	// Extents are 8 bytes, so every part starts at a multiple of that
+	size_t aligned = (size + 7) & ~(size_t) 7;
+	table->block_left -= aligned < table->block_left? aligned : table->block_left;
+	return kept;
+}
+
+/// Where the type is in the slots, or the free slot where it would go
+static size_t find_slot(TypeTable table, const Type* type, const TypeId* members, const int64_t* extents, uint32_t hash) {
+	size_t i = hash & table->slots_mask;
+	for (; table->slots[i]; i = (i + 1) & table->slots_mask) {
+		TypeId id = table->slots[i];
+		if (table->hashes[id] == hash && same_type(type_at(table, id), type, members, extents)) return i;
+	}
+	return i;
+}
+
+static TypeId add_type(TypeTable table, Type type, uint32_t hash) {
+	TypeId id = table->n_types;
+	if (!(id & ((1 << TYPE_CHUNK_BITS) - 1))) {
+		if (id >> TYPE_CHUNK_BITS >= MAX_TYPE_CHUNKS) {
+			fprintf(stderr, "Too many types\n");
+			abort();
+		}
+		table->chunks[id >> TYPE_CHUNK_BITS] = malloc(sizeof(Type) << TYPE_CHUNK_BITS);
+	}
+	*type_at(table, id) = type;
+	arrput(table->hashes, hash);
+	table->n_types++;
+	return id;
+}
+
+/// The id of the compound type, which is added if it's new
+static TypeId intern(TypeTable table, Type type, const TypeId* members, const int64_t* extents) {
+	uint32_t hash = hash_type(&type, members, extents);
+	// Most types asked for are there already, and can be found alongside other readers
+	pthread_rwlock_rdlock(&table->lock);
+	TypeId id = table->slots[find_slot(table, &type, members, extents, hash)];
+	pthread_rwlock_unlock(&table->lock);
+	if (id) return id;
+
+	pthread_rwlock_wrlock(&table->lock);
+	size_t i = find_slot(table, &type, members, extents, hash);
+	id = table->slots[i];
+	if (!id) {
+		if (type.kind == TYPE_KIND_FUNC || type.kind == TYPE_KIND_UNION) {
+			type.members = type.count? keep_parts(table, members, type.count * sizeof(TypeId)) : NULL;
+		}
+		else if (type.kind == TYPE_KIND_ARRAY && type.count > 0) {
+			type.extents = keep_parts(table, extents, type.count * sizeof(int64_t));
+		}
+		id = add_type(table, type, hash);
+		if (2 * (size_t) (table->n_types - TYPE_FIRST_COMPOUND) > table->slots_mask) grow_slots(table);
+		else table->slots[i] = id;
+	}
+	pthread_rwlock_unlock(&table->lock);
+	return id;
+}
+
+// === Rules of pairs ===
+
+static inline uint64_t pair_key(TypeId a, TypeId b) {
+	return (uint64_t) a << 32 | b;
+}
+
+static inline size_t hash_pair(uint64_t key) {
+	return (key * 0x9e3779b97f4a7c15ull) >> 32;
+}
+
+static bool find_rule(TypeTable table, PairRules* rules, uint64_t key, uint32_t* value) {
+	bool found = false;
+	pthread_rwlock_rdlock(&table->rules_lock);
+	for (size_t i = hash_pair(key) & rules->mask; rules->slots && rules->slots[i].key; i = (i + 1) & rules->mask) {
+		if (rules->slots[i].key != key) continue;
+		*value = rules->slots[i].value;
+		found = true;
+		break;
+	}
+	pthread_rwlock_unlock(&table->rules_lock);
+	return found;
+}
+
+/// Two threads may work out the same rule; they get the same result
+static void keep_rule(TypeTable table, PairRules* rules, uint64_t key, uint32_t value) {
+	pthread_rwlock_wrlock(&table->rules_lock);
+	if (2 * (rules->count + 1) > rules->mask) {
+		PairRules old = *rules;
+		rules->mask = old.mask? 2 * old.mask + 1 : 1023;
+		rules->slots = calloc(rules->mask + 1, sizeof(PairRule));
+		for (size_t i = 0; old.slots && i <= old.mask; i++) {
+			if (!old.slots[i].key) continue;
+			size_t j = hash_pair(old.slots[i].key) & rules->mask;
+			while (rules->slots[j].key) j = (j + 1) & rules->mask;
+			rules->slots[j] = old.slots[i];
+		}
+		free(old.slots);
+	}
+	size_t i = hash_pair(key) & rules->mask;
+	while (rules->slots[i].key && rules->slots[i].key != key) i = (i + 1) & rules->mask;
+	if (!rules->slots[i].key) rules->count++;
+	rules->slots[i] = (PairRule) { key, value };
+	pthread_rwlock_unlock(&table->rules_lock);
+}
+
+static int compare_spellings(const void* a, const void* b) {
+	return strcmp(((const Spelling*) a)->spelling, ((const Spelling*) b)->spelling);
+}
+
+static TypeId find_spelling(TypeTable table, const char* spelling) {
+	Spelling key = { spelling, 0 };
+	const Spelling* found = bsearch(&key, table->spellings, table->n_spellings, sizeof(Spelling), compare_spellings);
+	return found? found->id : TYPE_UNKNOWN;
+}
+
+TypeTable type_table_create(void) {
+	TypeTable table = calloc(1, sizeof(struct _type_table));
+	pthread_rwlock_init(&table->lock, NULL);
+	pthread_rwlock_init(&table->rules_lock, NULL);
+	pthread_mutex_init(&table->names_lock, NULL);
+	for (TypeId id = 0; id < TYPE_FIRST_COMPOUND; id++) {
+		add_type(table, (Type) { .kind = SCALARS[id].kind, .bits = SCALARS[id].bits }, 0);
+		// Unknown and null can't be written
+		for (int i = 0; i < 7 && SCALARS[id].spellings[i] && id != TYPE_UNKNOWN && id != TYPE_NULL; i++) {
+			table->spellings[table->n_spellings++] = (Spelling) { SCALARS[id].spellings[i], id };
+		}
+		for (TypeId other = 0; other < TYPE_FIRST_COMPOUND; other++) {
+			table->scalar_coercions[id][other] = scalar_coercion(id, other);
+			table->scalar_commons[id][other] = scalar_common(id, other);
+		}
+	}
+	qsort(table->spellings, table->n_spellings, sizeof(Spelling), compare_spellings);
+	grow_slots(table);
+	return table;
+}
+
+void type_table_destroy(TypeTable table) {
+	if (!table) return;
+	for (uint32_t i = 0; i < table->n_types; i += 1 << TYPE_CHUNK_BITS) free(table->chunks[i >> TYPE_CHUNK_BITS]);
+	arrfree(table->hashes);
+	for (int i = 0; i < arrlen(table->blocks); i++) free(table->blocks[i]);
+	arrfree(table->blocks);
+	free(table->slots);
+	free(table->coercions.slots);
+	free(table->commons.slots);
+	for (int i = 0; i < arrlen(table->names); i++) free(table->names[i]);
+	arrfree(table->names);
+	pthread_rwlock_destroy(&table->lock);
+	pthread_rwlock_destroy(&table->rules_lock);
+	pthread_mutex_destroy(&table->names_lock);
+	free(table);
+}
+
+int type_count(TypeTable table) {
+	pthread_rwlock_rdlock(&table->lock);
+	int count = table->n_types;
+	pthread_rwlock_unlock(&table->lock);
+	return count;
+}
+
+const Type* type_get(TypeTable table, TypeId id) {
+	return type_at(table, id);
+}
+
+TypeId type_builtin(TypeTable table, const char* spelling) {
+	TypeId found = find_spelling(table, spelling);
+	if (found) return found;
+	// Vectors: Vec4, Float32Vec2, SInt8Vec8...
+	const char* vec = strstr(spelling, "Vec");
+	if (!vec) return TYPE_UNKNOWN;
+	int lanes = 0;
+	for (const char* c = vec + 3; *c; c++) {
+		if (*c < '0' || *c > '9' || lanes > 16) return TYPE_UNKNOWN;
+		lanes = 10 * lanes + *c - '0';
+	}
+	if (lanes != 2 && lanes != 3 && lanes != 4 && lanes != 8 && lanes != 16) return TYPE_UNKNOWN;
+	TypeId element = TYPE_FLOAT;
+	if (vec > spelling) {
+		char prefix[32];
+		if (vec - spelling >= (ptrdiff_t) sizeof(prefix)) return TYPE_UNKNOWN;
+		memcpy(prefix, spelling, vec - spelling);
+		prefix[vec - spelling] = 0;
+		element = find_spelling(table, prefix);
+		if (!element || !is_number(SCALARS[element].kind)) return TYPE_UNKNOWN;
+	}
+	return type_vector(table, element, lanes);
+}
+
+// === Constructors ===
+
+TypeId type_pointer(TypeTable table, TypeId base) {
+	if (base == TYPE_UNKNOWN) return TYPE_UNKNOWN;
+	return intern(table, (Type) { .kind = TYPE_KIND_POINTER, .base = base }, NULL, NULL);
+}
+
+TypeId type_mutable(TypeTable table, TypeId base) {
+	if (base == TYPE_UNKNOWN || type_at(table, base)->kind == TYPE_KIND_MUTABLE) return base;
+	return intern(table, (Type) { .kind = TYPE_KIND_MUTABLE, .base = base }, NULL, NULL);
+}
+
+TypeId type_optional(TypeTable table, TypeId base) {
+	const Type* type = type_at(table, base);
+	if (base == TYPE_UNKNOWN || base == TYPE_NULL || type->kind == TYPE_KIND_OPTIONAL) return base;
+	if (type->kind == TYPE_KIND_MUTABLE) return type_mutable(table, type_optional(table, type->base));
+	return intern(table, (Type) { .kind = TYPE_KIND_OPTIONAL, .base = base }, NULL, NULL);
+}
+
+TypeId type_array(TypeTable table, TypeId element, int n_dims, const int64_t* extents, bool is_dynamic) {
+	Type array = { .kind = TYPE_KIND_ARRAY, .base = element, .count = n_dims, .is_dynamic = is_dynamic };
+	return intern(table, array, NULL, extents);
+}
+
+TypeId type_vector(TypeTable table, TypeId element, int lanes) {
+	Type vector = { .kind = TYPE_KIND_VECTOR, .base = element, .bits = type_at(table, element)->bits, .count = lanes };
+	return intern(table, vector, NULL, NULL);
+}
+
+TypeId type_func(TypeTable table, const TypeId* params, int n_params, TypeId ret) {
+	return intern(table, (Type) { .kind = TYPE_KIND_FUNC, .base = ret, .count = n_params }, params, NULL);
+}
+
+static int compare_ids(const void* a, const void* b) {
+	TypeId x = *(const TypeId*) a, y = *(const TypeId*) b;
+	return (x > y) - (x < y);
+}
+
+TypeId type_union(TypeTable table, const TypeId* variants, int n_variants) {
+	TypeId ARRAY flat = NULL;
+	for (int i = 0; i < n_variants; i++) {
+		const Type* variant = type_at(table, variants[i]);
+		if (variants[i] == TYPE_UNKNOWN) {
+			arrfree(flat);
+			return TYPE_UNKNOWN;
+		}
+		if (variant->kind == TYPE_KIND_UNION) {
+			for (int j = 0; j < variant->count; j++) arrput(flat, variant->members[j]);
+		}
+		else arrput(flat, variants[i]);
+	}
+	int n = arrlen(flat);
+	qsort(flat, n, sizeof(TypeId), compare_ids);
+	int kept = 0;
+	for (int i = 0; i < n; i++) {
+		if (!kept || flat[kept - 1] != flat[i]) flat[kept++] = flat[i];
+	}
+	TypeId id = kept == 1? flat[0] : intern(table, (Type) { .kind = TYPE_KIND_UNION, .count = kept }, flat, NULL);
+	arrfree(flat);
+	return id;
+}
+
+TypeId type_nominal(TypeTable table, TypeKind kind, const AST_Node* decl, const char* name) {
+	return intern(table, (Type) { .kind = kind, .decl = decl, .name = name }, NULL, NULL);
+}
+
+const TypeId* type_members(TypeTable table, TypeId id, int* count) {
+	const Type* type = type_at(table, id);
+	bool has_members = type->kind == TYPE_KIND_FUNC || type->kind == TYPE_KIND_UNION;
+	*count = has_members? type->count : 0;
+	return has_members? type->members : NULL;
+}
+
+const int64_t* type_extents(TypeTable table, TypeId id, int* count) {
+	const Type* type = type_at(table, id);
+	bool has_extents = type->kind == TYPE_KIND_ARRAY && type->count > 0;
+	*count = has_extents? type->count : 0;
+	return has_extents? type->extents : NULL;
+}
+
+TypeId type_unqualified(TypeTable table, TypeId id) {
+	return type_at(table, id)->kind == TYPE_KIND_MUTABLE? type_at(table, id)->base : id;
+}
+
+// === Rules ===
+
+static Coercion array_coercion(TypeTable table, const Type* from, const Type* to) {
+	if (to->count >= 0) {
+		if (from->count != to->count) return COERCE_NONE;
+		if (to->is_dynamic && to->count != 1) return COERCE_NONE;
+		// A resizable array can be seen as one of any extents, checked when it happens
+		if (!to->is_dynamic && !from->is_dynamic && to->count > 0) {
+			for (int i = 0; i < to->count; i++) {
+				int64_t want = to->extents[i], have = from->extents[i];
+				if (want >= 0 && have >= 0 && want != have) return COERCE_NONE;
+			}
+		}
+	}
+	Coercion element = type_coercion(table, from->base, to->base);
+	return element == COERCE_EXACT || element == COERCE_NUMERIC? element : COERCE_NONE;
+}
+
+static Coercion compound_coercion(TypeTable table, TypeId from, TypeId to) {
+	from = type_unqualified(table, from);
+	to = type_unqualified(table, to);
+	if (from == to || from == TYPE_UNKNOWN || to == TYPE_UNKNOWN) return COERCE_EXACT;
+	if (from < TYPE_FIRST_COMPOUND && to < TYPE_FIRST_COMPOUND) return table->scalar_coercions[from][to];
+	const Type* f = type_at(table, from);
+	const Type* t = type_at(table, to);
+	if (f->kind == TYPE_KIND_VOID || t->kind == TYPE_KIND_VOID) return COERCE_NONE;
+	if (t->kind == TYPE_KIND_ANY) return COERCE_WRAP;
+	if (t->kind == TYPE_KIND_BOOL && (f->kind == TYPE_KIND_POINTER || f->kind == TYPE_KIND_OPTIONAL)) return COERCE_TO_BOOL;
+
+	if (t->kind == TYPE_KIND_OPTIONAL) {
+		if (f->kind == TYPE_KIND_NULL) return COERCE_WRAP;
+		if (f->kind == TYPE_KIND_OPTIONAL) return type_coercion(table, f->base, t->base);
+		return type_coercion(table, from, t->base)? COERCE_WRAP : COERCE_NONE;
+	}
+	if (f->kind == TYPE_KIND_OPTIONAL) return type_coercion(table, f->base, to)? COERCE_UNWRAP : COERCE_NONE;
+
+	if (t->kind == TYPE_KIND_UNION) {
+		int n;
+		const TypeId* variants = type_members(table, to, &n);
+		if (f->kind == TYPE_KIND_UNION) {
+			int n_from;
+			const TypeId* from_variants = type_members(table, from, &n_from);
+			for (int i = 0; i < n_from; i++) {
+				if (!type_coercion(table, from_variants[i], to)) return COERCE_NONE;
+			}
+			return COERCE_WRAP;
+		}
+		for (int i = 0; i < n; i++) {
+			if (type_coercion(table, from, variants[i])) return COERCE_WRAP;
+		}
+		return COERCE_NONE;
+	}
+
+	if (t->kind == TYPE_KIND_POINTER) {
+		if (f->kind == TYPE_KIND_RAWPTR) return COERCE_RAWPTR;
+		// A pointer to something mutable may be used as a pointer to it that can't change it
+		if (f->kind == TYPE_KIND_POINTER) return type_unqualified(table, f->base) == t->base? COERCE_EXACT : COERCE_NONE;
+		return type_coercion(table, from, t->base) == COERCE_EXACT? COERCE_ADDRESS : COERCE_NONE;
+	}
+	if (f->kind == TYPE_KIND_POINTER) {
+		if (t->kind == TYPE_KIND_RAWPTR) return COERCE_RAWPTR;
+		return type_coercion(table, f->base, to)? COERCE_DEREF : COERCE_NONE;
+	}
+
+	if (f->kind == TYPE_KIND_ARRAY && t->kind == TYPE_KIND_ARRAY) return array_coercion(table, f, t);
+	if (f->kind == TYPE_KIND_VECTOR && t->kind == TYPE_KIND_VECTOR && f->count == t->count) {
+		Coercion element = type_coercion(table, f->base, t->base);
+		return element == COERCE_EXACT || element == COERCE_NUMERIC? element : COERCE_NONE;
+	}
+	return COERCE_NONE;
+}
+
+/// The pair a coercion between two types is worked out from, when there's a single one to go on
+static bool coercion_base(TypeTable table, TypeId* from, TypeId* to) {
+	TypeId a = type_unqualified(table, *from), b = type_unqualified(table, *to);
+	if (a == b || (a < TYPE_FIRST_COMPOUND && b < TYPE_FIRST_COMPOUND)) return false;
+	const Type* f = type_at(table, a);
+	const Type* t = type_at(table, b);
+	bool same_kind = f->kind == t->kind && (f->kind == TYPE_KIND_OPTIONAL || f->kind == TYPE_KIND_ARRAY || f->kind == TYPE_KIND_VECTOR);
+	if (same_kind) *from = f->base, *to = t->base;
+	else if (t->kind == TYPE_KIND_OPTIONAL || t->kind == TYPE_KIND_POINTER) *from = a, *to = t->base;
+	else if (f->kind == TYPE_KIND_OPTIONAL || f->kind == TYPE_KIND_POINTER) *from = f->base, *to = b;
+	else return false;
+	return true;
+}
+
+Coercion type_coercion(TypeTable table, TypeId from, TypeId to) {
+	if (from == to) return COERCE_EXACT;
+	if (from < TYPE_FIRST_COMPOUND && to < TYPE_FIRST_COMPOUND) return table->scalar_coercions[from][to];
+	uint32_t kept;
+	if (find_rule(table, &table->coercions, pair_key(from, to), &kept)) return kept;
+	// Types nest as deeply as they're written, so what a coercion is worked out from is
+	// worked out first, innermost first, rather than by recursing
+	uint64_t ARRAY bases = NULL;
+	for (TypeId a = from, b = to; coercion_base(table, &a, &b);) {
+		bool known = a == b || (a < TYPE_FIRST_COMPOUND && b < TYPE_FIRST_COMPOUND) || find_rule(table, &table->coercions, pair_key(a, b), &kept);
+		if (known) break;
+		arrput(bases, pair_key(a, b));
+	}
+	for (ptrdiff_t i = arrlen(bases) - 1; i >= 0; i--) {
+		TypeId a = bases[i] >> 32, b = (TypeId) bases[i];
+		keep_rule(table, &table->coercions, bases[i], compound_coercion(table, a, b));
+	}
+	arrfree(bases);
+	Coercion coercion = compound_coercion(table, from, to);
+	keep_rule(table, &table->coercions, pair_key(from, to), coercion);
+	return coercion;
+}
+
+static TypeId compound_common(TypeTable table, TypeId a, TypeId b) {
+	a = type_unqualified(table, a);
+	b = type_unqualified(table, b);
+	if (a == b) return a;
+	if (a == TYPE_UNKNOWN || b == TYPE_UNKNOWN) return TYPE_UNKNOWN;
+	if (a < TYPE_FIRST_COMPOUND && b < TYPE_FIRST_COMPOUND) return table->scalar_commons[a][b];
+	const Type* ta = type_at(table, a);
+	const Type* tb = type_at(table, b);
+	if (ta->kind == TYPE_KIND_VOID || tb->kind == TYPE_KIND_VOID) return NO_COMMON_TYPE;
+	if (ta->kind == TYPE_KIND_NULL) return type_optional(table, b);
+	if (tb->kind == TYPE_KIND_NULL) return type_optional(table, a);
+
+	TypeId common;
+	if (ta->kind == TYPE_KIND_OPTIONAL || tb->kind == TYPE_KIND_OPTIONAL) {
+		TypeId base_a = ta->kind == TYPE_KIND_OPTIONAL? ta->base : a;
+		TypeId base_b = tb->kind == TYPE_KIND_OPTIONAL? tb->base : b;
+		return type_common(table, base_a, base_b, &common)? type_optional(table, common) : NO_COMMON_TYPE;
+	}
+	// Pointers are dereferenced to be operated on
+	if (ta->kind == TYPE_KIND_POINTER || tb->kind == TYPE_KIND_POINTER) {
+		TypeId base_a = ta->kind == TYPE_KIND_POINTER? ta->base : a;
+		TypeId base_b = tb->kind == TYPE_KIND_POINTER? tb->base : b;
+		return type_common(table, base_a, base_b, &common)? common : NO_COMMON_TYPE;
+	}
+	if (ta->kind == TYPE_KIND_VECTOR || tb->kind == TYPE_KIND_VECTOR) {
+		// A scalar goes with every element
+		if (ta->kind == TYPE_KIND_VECTOR && tb->kind == TYPE_KIND_VECTOR && ta->count != tb->count) return NO_COMMON_TYPE;
+		int lanes = ta->kind == TYPE_KIND_VECTOR? ta->count : tb->count;
+		TypeId element_a = ta->kind == TYPE_KIND_VECTOR? ta->base : a;
+		TypeId element_b = tb->kind == TYPE_KIND_VECTOR? tb->base : b;
+		if (!type_common(table, element_a, element_b, &common) || !is_number(type_at(table, common)->kind)) return NO_COMMON_TYPE;
+		return type_vector(table, common, lanes);
+	}
+	// A variant and its union
+	if (type_coercion(table, b, a) == COERCE_WRAP && (ta->kind == TYPE_KIND_UNION || ta->kind == TYPE_KIND_ANY)) return a;
+	if (type_coercion(table, a, b) == COERCE_WRAP && (tb->kind == TYPE_KIND_UNION || tb->kind == TYPE_KIND_ANY)) return b;
+	if (type_coercion(table, a, b) == COERCE_EXACT) return b;
+	if (type_coercion(table, b, a) == COERCE_EXACT) return a;
+	return NO_COMMON_TYPE;
+}
+
+bool type_common(TypeTable table, TypeId a, TypeId b, TypeId* common) {
+	TypeId found;
+	if (a == b) found = type_unqualified(table, a);
+	else if (a < TYPE_FIRST_COMPOUND && b < TYPE_FIRST_COMPOUND) found = table->scalar_commons[a][b];
+	else {
+		if (!find_rule(table, &table->commons, pair_key(a, b), &found)) {
+			found = compound_common(table, a, b);
+			keep_rule(table, &table->commons, pair_key(a, b), found);
+		}
+	}
+	if (found == NO_COMMON_TYPE) return false;
+	*common = found;
+	return true;
+}
+
+// === Names ===
+
+static void append(char ARRAY* text, const char* s) {
+	size_t length = strlen(s);
+	size_t at = arraddn(*text, length);
+	memcpy(&(*text)[at], s, length);
+}
+
+/// Func types and unions bind looser than the modifiers and arrays that may hold them
+static void append_part(TypeTable table, char ARRAY* text, TypeId id) {
+	TypeKind kind = type_at(table, id)->kind;
+	bool parens = kind == TYPE_KIND_FUNC || kind == TYPE_KIND_UNION;
+	if (parens) arrput(*text, '(');
+	append(text, table->names[id]);
+	if (parens) arrput(*text, ')');
+}
+
+static char* build_name(TypeTable table, TypeId id) {
+	const Type* type = type_at(table, id);
+	char ARRAY text = NULL;
+	char number[32];
+	switch (type->kind) {
+		case TYPE_KIND_POINTER: arrput(text, '@'); append_part(table, &text, type->base); break;
+		case TYPE_KIND_MUTABLE: arrput(text, '!'); append_part(table, &text, type->base); break;
+		case TYPE_KIND_OPTIONAL: arrput(text, '?'); append_part(table, &text, type->base); break;
+
+		case TYPE_KIND_ARRAY:
+			arrput(text, '[');
+			if (type->count < 0) append(&text, "...");
+			for (int i = 0; i < type->count && !type->is_dynamic; i++) {
+				int64_t extent = type->extents[i];
+				if (i) append(&text, ", ");
+				if (extent < 0) append(&text, "?");
+				else {
+					snprintf(number, sizeof(number), "%lld", (long long) extent);
+					append(&text, number);
+				}
+			}
+			arrput(text, ']');
+			append_part(table, &text, type->base);
+			break;
+
+		case TYPE_KIND_VECTOR:
+			if (type->base != TYPE_FLOAT) append(&text, table->names[type->base]);
+			snprintf(number, sizeof(number), "Vec%d", type->count);
+			append(&text, number);
+			break;
+
+		case TYPE_KIND_FUNC:
+			if (type->count != 1) arrput(text, '(');
+			for (int i = 0; i < type->count; i++) {
+				if (i) append(&text, ", ");
+				append_part(table, &text, type->members[i]);
+			}
+			append(&text, type->count != 1? ") => " : " => ");
+			append_part(table, &text, type->base);
+			break;
+
+		case TYPE_KIND_UNION:
+			for (int i = 0; i < type->count; i++) {
+				if (i) append(&text, " | ");
+				append_part(table, &text, type->members[i]);
+			}
+			break;
+
+		case TYPE_KIND_STRUCT:
+		case TYPE_KIND_ENUM:
+			append(&text, type->name);
+			break;
+
+		default:
+			append(&text, SCALARS[id].spellings[0]);
+	}
+	// Names are made from the names of their parts, so types nested deeply would have names
+	// as long as they are deep
+	if (arrlen(text) > MAX_NAME_LENGTH) {
+		ptrdiff_t length = MAX_NAME_LENGTH;
+		while (length && (text[length] & 0xC0) == 0x80) length--;  // inside a UTF-8 sequence
+		stbds_header(text)->length = length;
+		append(&text, "...");
+	}
+	char* name = malloc(arrlen(text) + 1);
+	memcpy(name, text, arrlen(text));
+	name[arrlen(text)] = 0;
+	arrfree(text);
+	return name;
+}
+
+const char* type_name(TypeTable table, TypeId id) {
+	pthread_mutex_lock(&table->names_lock);
+	// A type's parts are interned before it, so naming in order of id needs no recursion
+	while (arrlen(table->names) <= (ptrdiff_t) id) {
+		TypeId next = arrlen(table->names);
+		arrput(table->names, NULL);
+		table->names[next] = build_name(table, next);
+	}
+	const char* name = table->names[id];
+	pthread_mutex_unlock(&table->names_lock);
+	return name;
+}
@@ -0,0 +1,121 @@
+#pragma once
+// Semantic types. Every distinct type is kept once in a TypeTable, so two types are the
+// same exactly when their ids are equal, whichever of its spellings the source used.
+// A table may be used by several threads at once.
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "ast.h"
+
+typedef struct _type_table* TypeTable;
+typedef uint32_t TypeId;
+
+typedef enum {
+	TYPE_KIND_UNKNOWN,  // couldn't be worked out; goes with anything, so one error doesn't cause more
+	TYPE_KIND_VOID,
+	TYPE_KIND_NULL,     // of the 'null' literal
+	TYPE_KIND_BOOL,
+	TYPE_KIND_SINT,
+	TYPE_KIND_UINT,
+	TYPE_KIND_FLOAT,
+	TYPE_KIND_COMPLEX,
+	TYPE_KIND_STRING,
+	TYPE_KIND_RUNE,
+	TYPE_KIND_RAWPTR,
+	TYPE_KIND_ANY,
+	TYPE_KIND_TYPE,     // of a type used as a value
+	TYPE_KIND_VECTOR,
+	TYPE_KIND_POINTER,
+	TYPE_KIND_MUTABLE,
+	TYPE_KIND_OPTIONAL,
+	TYPE_KIND_ARRAY,
+	TYPE_KIND_FUNC,
+	TYPE_KIND_UNION,
+	TYPE_KIND_STRUCT,
+	TYPE_KIND_ENUM,
+} TypeKind;
+
+/// The scalar types have fixed ids, below TYPE_FIRST_COMPOUND
+enum {
+	TYPE_UNKNOWN = 0,
+	TYPE_VOID,
+	TYPE_NULL,
+	TYPE_BOOL,
+	TYPE_S8, TYPE_S16, TYPE_S32, TYPE_S64,
+	TYPE_U8, TYPE_U16, TYPE_U32, TYPE_U64,
+	TYPE_F32, TYPE_F64,
+	TYPE_C32, TYPE_C64,
+	TYPE_STRING,
+	TYPE_RUNE,
+	TYPE_RAWPTR,
+	TYPE_ANY,
+	TYPE_TYPE,
+	TYPE_FIRST_COMPOUND,
+
+	TYPE_INT = TYPE_S64,
+	TYPE_FLOAT = TYPE_F64,
+};
+
+typedef struct {
+	TypeKind kind;
+	int bits;         // of a number, or of a vector's elements
+	int count;        // vector lanes, array dimensions (-1 for any number), func params, union variants
+	TypeId base;      // what a pointer, mutable or optional is of; array and vector elements; func return
+	bool is_dynamic;  // a resizable 1-dimensional array
+	const AST_Node* decl;  // of a struct or enum
+	const char* name;      // of a struct or enum
+	const TypeId* members;   // the params of a func, the variants of a union; see type_members
+	const int64_t* extents;  // of an array
+} Type;
+
+typedef enum {
+	COERCE_NONE,     // not allowed
+	COERCE_EXACT,    // the same type, mutability aside
+	COERCE_NUMERIC,  // a wider number of the same kind, unsigned to signed, integer to float
+	COERCE_TO_BOOL,
+	COERCE_WRAP,     // into an optional or union (or Any) the value is a variant of
+	COERCE_UNWRAP,   // out of an optional; allowed where the value is known not to be null
+	COERCE_ADDRESS,  // a value to a pointer to it, where it is addressable
+	COERCE_DEREF,    // a pointer to what it points to
+	COERCE_RAWPTR,   // between RawPtr and any pointer
+} Coercion;
+
+TypeTable type_table_create(void);
+void type_table_destroy(TypeTable table);
+
+/// Types in the table, including the scalars
+int type_count(TypeTable table);
+const Type* type_get(TypeTable table, TypeId id);
+
+/// The builtin type with the given spelling (Int, S64, Integer, Float32Vec4...), or TYPE_UNKNOWN
+TypeId type_builtin(TypeTable table, const char* spelling);
+
+TypeId type_pointer(TypeTable table, TypeId base);
+/// Mutable of mutable is the same type, and so is !?T of ?!T
+TypeId type_mutable(TypeTable table, TypeId base);
+TypeId type_optional(TypeTable table, TypeId base);
+/// n_dims = -1 for any number of dimensions. Extents are -1 where only known at run time.
+TypeId type_array(TypeTable table, TypeId element, int n_dims, const int64_t* extents, bool is_dynamic);
+TypeId type_vector(TypeTable table, TypeId element, int lanes);
+TypeId type_func(TypeTable table, const TypeId* params, int n_params, TypeId ret);
+/// Nested unions are flattened and the variants put in a canonical order; one variant is itself
+TypeId type_union(TypeTable table, const TypeId* variants, int n_variants);
+/// Structs and enums are the same type only if they have the same declaration
+TypeId type_nominal(TypeTable table, TypeKind kind, const AST_Node* decl, const char* name);
+
+/// The params of a func type, or the variants of a union
+const TypeId* type_members(TypeTable table, TypeId id, int* count);
+/// The extents of an array type, by dimension
+const int64_t* type_extents(TypeTable table, TypeId id, int* count);
+
+/// The type with its outer mutability taken off
+TypeId type_unqualified(TypeTable table, TypeId id);
+
+/// How a value of one type becomes a value of the other, per the coercion rules of design.md
+Coercion type_coercion(TypeTable table, TypeId from, TypeId to);
+/// The type that operands of the two types are brought to (Int and Float: Float; S8 and
+/// S32: S32...). False if there is none.
+bool type_common(TypeTable table, TypeId a, TypeId b, TypeId* common);
+
+/// How the type is written, e.g. "!?@Int"; kept by the table
+const char* type_name(TypeTable table, TypeId id);
@@ -32,6 +32,7 @@ const char* read_entire_file(const char* filename) {
 	rewind(fp);
 	char* buffer = malloc(src_size + 1);
 	fread(buffer, 1, src_size, fp);
+	fclose(fp);
 	buffer[src_size] = 0;
 	return buffer;
 }
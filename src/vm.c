@@ -0,0 +1,555 @@
+#include <inttypes.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "vm.h"
+#include "jit.h"
+#include "stb_ds.h"
+
+// Threaded dispatch jumps from each instruction straight to the code of the next, so each
+// has a branch of its own to predict. Define VM_SWITCH_DISPATCH to use a switch instead.
+#if defined(__GNUC__) && !defined(VM_SWITCH_DISPATCH)
+#define VM_THREADED 1
+#else
+#define VM_THREADED 0
+#endif
+
+typedef struct {
+	Slot* slots;
+	int64_t size;
+} Block;
+
+/// Where the arena was up to
+typedef struct {
+	int block;
+	int64_t used;
+} Mark;
+
+typedef struct {
+	const Function* f;
+	const Instr* ip;  // where it goes on from, when what it called returns
+	Slot* r;
+	Mark mark;        // the arena before the frame was taken from it
+	int ret;          // the caller's register for the result
+} Frame;
+
+struct _vm {
+	Program program;
+	Block ARRAY blocks;
+	Mark top;
+	Frame ARRAY frames;
+	int jit;             // calls and jumps back before a function is compiled, or -1
+	int* hot;            // by function: how many of them so far, or -1 if it can't be compiled
+	Native* native;      // by function, once compiled
+	JitHooks hooks;
+	int nested;          // frames of compiled functions called by compiled functions, on the C stack
+	int max_depth;       // of calls, in this run
+};
+
+static JitFrame jit_call(void* vm, int at);
+static void jit_return(void* vm);
+
+VM vm_create(Program program) {
+	VM vm = calloc(1, sizeof(struct _vm));
+	vm->program = program;
+	vm->jit = jit_supported()? VM_JIT_THRESHOLD : -1;
+	vm->hot = calloc(program_function_count(program), sizeof(int));
+	vm->native = calloc(program_function_count(program), sizeof(Native));
+	vm->hooks = (JitHooks) { vm, jit_call, jit_return };
+	return vm;
+}
+
+void vm_destroy(VM vm) {
+	for (int i = 0; i < program_function_count(vm->program); i++) {
+		if (vm->native[i]) jit_destroy(vm->native[i]);
+	}
+	free(vm->hot);
+	free(vm->native);
+	for (int i = 0; i < arrlen(vm->blocks); i++) free(vm->blocks[i].slots);
+	arrfree(vm->blocks);
+	arrfree(vm->frames);
+	free(vm);
+}
+
+void vm_set_jit(VM vm, int threshold) {
+	vm->jit = jit_supported() && threshold >= 0? threshold : -1;
+}
+
+// === Arena ===
+
+/// `n` slots, given back with the frame that took them. Frames are taken and given back in
+/// order, so the arena is a stack of blocks that are kept for the next call.
+static Slot* arena_take(VM vm, int64_t n) {
+	while (vm->top.block < arrlen(vm->blocks)) {
+		Block* block = &vm->blocks[vm->top.block];
+		if (block->size - vm->top.used >= n) {
+			Slot* slots = block->slots + vm->top.used;
+			vm->top.used += n;
+			return slots;
+		}
+		vm->top.block++;
+		vm->top.used = 0;
+	}
+	Block block = { NULL, n > VM_BLOCK_SLOTS? n : VM_BLOCK_SLOTS };
+	block.slots = malloc(block.size * sizeof(Slot));
+	if (!block.slots) return NULL;
+	arrput(vm->blocks, block);
+	vm->top = (Mark) { (int) arrlen(vm->blocks) - 1, n };
+	return block.slots;
+}
+
+// === JIT ===
+
+/// Counts a call of function `fi`, or a jump back in it, compiling it once it is hot: its
+/// machine code, if it has been compiled
+static Native promote(VM vm, int fi) {
+	if (vm->native[fi]) return vm->native[fi];
+	if (vm->jit < 0 || vm->hot[fi] < 0 || ++vm->hot[fi] < vm->jit) return NULL;
+	vm->native[fi] = jit_compile(program_function(vm->program, fi), program_globals(vm->program), &vm->hooks);
+	if (!vm->native[fi]) vm->hot[fi] = -1;
+	return vm->native[fi];
+}
+
+/// A CALL in machine code: takes the frame as the CALL of the VM does, if the callee is compiled
+/// to be called in turn. Anything else, and errors, are left to the VM's CALL.
+static JitFrame jit_call(void* ctx, int at) {
+	VM vm = ctx;
+	Frame* caller = &arrlast(vm->frames);
+	Instr instr = caller->f->code[at];
+	const Function* callee = program_function(vm->program, (int) instr.ux);
+	Native native = vm->native[instr.ux];
+	if (!native || vm->nested == VM_JIT_MAX_NESTING || arrlen(vm->frames) == VM_MAX_DEPTH) return (JitFrame) { 0 };
+	Mark mark = vm->top;
+	Slot* frame = arena_take(vm, (int64_t) callee->n_registers + callee->n_memory);
+	if (!frame) {
+		vm->top = mark;
+		return (JitFrame) { 0 };
+	}
+	memcpy(frame, &caller->r[instr.a], callee->n_params * sizeof(Slot));
+	caller->ip = caller->f->code + at + 1;
+	arrput(vm->frames, ((Frame) { callee, NULL, frame, mark, instr.a }));
+	if (arrlen(vm->frames) > vm->max_depth) vm->max_depth = (int) arrlen(vm->frames);
+	vm->nested++;
+	return (JitFrame) { frame, native };
+}
+
+/// A compiled function returning to the compiled function that called it, which has the result
+static void jit_return(void* ctx) {
+	VM vm = ctx;
+	Frame frame = arrpop(vm->frames);
+	vm->top = frame.mark;
+	vm->nested--;
+}
+
+// === Runtime ===
+
+static void runtime_error(VM vm, const Function* f, const Instr* ip, const char* fmt, ...) {
+	fflush(stdout);
+	int line = ip? f->lines[ip - 1 - f->code] : 0;
+	fprintf(stderr, "%s:%d: ", program_src_file(vm->program), line);
+	va_list args;
+	va_start(args, fmt);
+	vfprintf(stderr, fmt, args);
+	va_end(args);
+	fputc('\n', stderr);
+}
+
+// Strings that are zero are empty
+static inline int64_t string_len(Slot s) {
+	return s.p? ((const StringValue*) s.p)->len : 0;
+}
+
+static inline const char* string_data(Slot s) {
+	return s.p? ((const StringValue*) s.p)->data : "";
+}
+
+static int string_cmp(Slot a, Slot b) {
+	int64_t n = string_len(a), m = string_len(b);
+	int order = n && m? memcmp(string_data(a), string_data(b), n < m? n : m) : 0;
+	return order? order : (n > m) - (n < m);
+}
+
+// Integers wrap, as they do at compile time
+static inline uint64_t upow(uint64_t base, uint64_t e) {
+	uint64_t result = 1;
+	for (; e; e >>= 1, base *= base) {
+		if (e & 1) result *= base;
+	}
+	return result;
+}
+
+static inline bool float_eq(double a, double b) {
+	return a >= b && a <= b;
+}
+
+static double math_function(MathFunc func, double x) {
+	switch (func) {
+		case MATH_SQRT: return sqrt(x);
+		case MATH_SIN: return sin(x);
+		case MATH_COS: return cos(x);
+		case MATH_TAN: return tan(x);
+		case MATH_EXP: return exp(x);
+		case MATH_LOG: return log(x);
+		case MATH_FLOOR: return floor(x);
+		case MATH_CEIL: return ceil(x);
+	}
+	return x;
+}
+
+static void print_rune(int64_t r) {
+	char utf8[4];
+	int n = 0;
+	if (r < 0x80) utf8[n++] = (char) r;
+	else if (r < 0x800) {
+		utf8[n++] = (char) (0xC0 | r >> 6);
+		utf8[n++] = (char) (0x80 | (r & 0x3F));
+	}
+	else if (r < 0x10000) {
+		utf8[n++] = (char) (0xE0 | r >> 12);
+		utf8[n++] = (char) (0x80 | (r >> 6 & 0x3F));
+		utf8[n++] = (char) (0x80 | (r & 0x3F));
+	}
+	else {
+		utf8[n++] = (char) (0xF0 | r >> 18);
+		utf8[n++] = (char) (0x80 | (r >> 12 & 0x3F));
+		utf8[n++] = (char) (0x80 | (r >> 6 & 0x3F));
+		utf8[n++] = (char) (0x80 | (r & 0x3F));
+	}
+	fwrite(utf8, 1, n, stdout);
+}
+
+static void print_value(Slot x, PrintKind kind) {
+	switch (kind) {
+		case PRINT_INT: printf("%" PRId64, x.i); break;
+		case PRINT_UINT: printf("%" PRIu64, x.u); break;
+		case PRINT_FLOAT: printf("%g", x.f); break;
+		case PRINT_BOOL: fputs(x.i? "true" : "false", stdout); break;
+		case PRINT_STRING: fwrite(string_data(x), 1, (size_t) string_len(x), stdout); break;
+		case PRINT_RUNE: print_rune(x.i); break;
+	}
+}
+
+// === Interpreter ===
+
+bool vm_run(VM vm, int function, VMStats* stats) {
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	const Function* functions = program_function(vm->program, 0);
+	Slot* globals = program_globals(vm->program);
+	int64_t n = 0;
+	vm->max_depth = 1;
+	bool ok = false;
+	Slot result = { 0 };
+
+	const Function* f = &functions[function];
+	const Instr* ip = NULL;
+	Mark base = vm->top;
+	Slot* r = arena_take(vm, (int64_t) f->n_registers + f->n_memory);
+	if (!r) {
+		runtime_error(vm, f, ip, "Out of memory");
+		goto done;
+	}
+	arrput(vm->frames, ((Frame) { f, NULL, r, base, -1 }));
+	ip = f->code;
+	const Slot* k = f->constants;
+	Slot* m = r + f->n_registers;
+	Instr instr;
+	Native native;
+
+#if VM_THREADED
+	static void* const labels[] = {
+#define OPCODE_LABEL(name) &&op_##name,
+		OPCODES(OPCODE_LABEL)
+#undef OPCODE_LABEL
+	};
+#define CASE(name) op_##name:
+#define NEXT do { instr = *ip++; n++; goto *labels[instr.op]; } while (0)
+	NEXT;
+#else
+#define CASE(name) case OP_##name:
+#define NEXT goto dispatch
+dispatch:
+	instr = *ip++;
+	n++;
+	switch ((Opcode) instr.op) {
+#endif
+#define A r[instr.a]
+#define B r[instr.b]
+#define C r[instr.c]
+#define AT(slot) ((Slot*) (slot).p)
+#define INT_OP(name, expr) CASE(name) A.i = (int64_t) (expr); NEXT;
+#define FLOAT_OP(name, expr) CASE(name) A.f = (expr); NEXT;
+// Jumps back are where loops go round, so they count towards compiling the function, and
+// go on in its machine code once it has been
+#define JUMP(by) do { \
+		int32_t by_ = (by); \
+		ip += by_; \
+		if (by_ < 0 && (native = promote(vm, (int) (f - functions)))) goto enter_native; \
+	} while (0)
+#define JUMP_IF(name, cond) CASE(name) if (cond) JUMP(1 + ip->sx); else ip++; NEXT;
+
+	CASE(MOVE) A = B; NEXT;
+	CASE(LOADK) A = k[instr.ux]; NEXT;
+	CASE(LOADI) A.i = instr.sx; NEXT;
+	CASE(LOCAL) A.p = m + instr.ux; NEXT;
+	CASE(GLOBAL) A.p = globals + instr.ux; NEXT;
+	CASE(LOAD) A = AT(B)[instr.c]; NEXT;
+	CASE(STORE) AT(A)[instr.c] = B; NEXT;
+	CASE(LOADX) A = AT(B)[C.i]; NEXT;
+	CASE(STOREX) AT(A)[B.i] = C; NEXT;
+	CASE(LEA) A.p = AT(B) + instr.c; NEXT;
+	CASE(ADDR) A.p = AT(B) + C.i; NEXT;
+	CASE(COPY) memmove(A.p, B.p, instr.c * sizeof(Slot)); NEXT;
+	CASE(COPYN) memmove(A.p, B.p, C.i * sizeof(Slot)); NEXT;
+	CASE(ZERO) memset(A.p, 0, instr.b * sizeof(Slot)); NEXT;
+	CASE(ZERON) memset(A.p, 0, B.i * sizeof(Slot)); NEXT;
+
+	INT_OP(ADD, B.u + C.u)
+	INT_OP(SUB, B.u - C.u)
+	INT_OP(MUL, B.u * C.u)
+	CASE(DIV)
+		if (!C.i) goto division_by_zero;
+		A.i = C.i == -1? (int64_t) (0 - B.u) : B.i / C.i;
+		NEXT;
+	CASE(MOD)
+		if (!C.i) goto division_by_zero;
+		A.i = C.i == -1? 0 : B.i % C.i;
+		NEXT;
+	CASE(UDIV)
+		if (!C.u) goto division_by_zero;
+		A.u = B.u / C.u;
+		NEXT;
+	CASE(UMOD)
+		if (!C.u) goto division_by_zero;
+		A.u = B.u % C.u;
+		NEXT;
+	INT_OP(POW, upow(B.u, C.u))
+	INT_OP(UPOW, upow(B.u, C.u))
+	INT_OP(NEG, 0 - B.u)
+	INT_OP(ADDK, B.u + (uint64_t) (int64_t) (int16_t) instr.c)
+	INT_OP(MULK, B.u * instr.c)
+
+	FLOAT_OP(FADD, B.f + C.f)
+	FLOAT_OP(FSUB, B.f - C.f)
+	FLOAT_OP(FMUL, B.f * C.f)
+	FLOAT_OP(FDIV, B.f / C.f)
+	FLOAT_OP(FMOD, fmod(B.f, C.f))
+	FLOAT_OP(FPOW, pow(B.f, C.f))
+	FLOAT_OP(FNEG, -B.f)
+	FLOAT_OP(F32, (float) B.f)
+
+	INT_OP(SEXT, (int64_t) (B.u << (64 - instr.c)) >> (64 - instr.c))
+	INT_OP(ZEXT, B.u & (((uint64_t) 1 << instr.c) - 1))
+	FLOAT_OP(ITOF, (double) B.i)
+	FLOAT_OP(UTOF, (double) B.u)
+	INT_OP(FTOI, (int64_t) B.f)
+	INT_OP(FTOU, (uint64_t) B.f)
+	INT_OP(BOOL, B.i != 0)
+	INT_OP(FBOOL, !float_eq(B.f, 0))
+	INT_OP(NOT, !B.i)
+
+	INT_OP(BAND, B.u & C.u)
+	INT_OP(BOR, B.u | C.u)
+	INT_OP(BXOR, B.u ^ C.u)
+	INT_OP(SHL, C.u < 64? B.u << C.u : 0)
+	INT_OP(SHR, C.u < 64? B.i >> C.u : B.i >> 63)
+	INT_OP(USHR, C.u < 64? B.u >> C.u : 0)
+	INT_OP(BNOT, ~B.u)
+
+	INT_OP(EQ, B.i == C.i)
+	INT_OP(NE, B.i != C.i)
+	INT_OP(LT, B.i < C.i)
+	INT_OP(LE, B.i <= C.i)
+	INT_OP(ULT, B.u < C.u)
+	INT_OP(ULE, B.u <= C.u)
+	INT_OP(FEQ, float_eq(B.f, C.f))
+	INT_OP(FNE, !float_eq(B.f, C.f))
+	INT_OP(FLT, B.f < C.f)
+	INT_OP(FLE, B.f <= C.f)
+	INT_OP(SEQ, string_len(B) == string_len(C) && string_cmp(B, C) == 0)
+	INT_OP(SLT, string_cmp(B, C) < 0)
+	INT_OP(SLE, string_cmp(B, C) <= 0)
+
+	INT_OP(MIN, B.i < C.i? B.i : C.i)
+	INT_OP(MAX, B.i > C.i? B.i : C.i)
+	INT_OP(UMIN, B.u < C.u? B.u : C.u)
+	INT_OP(UMAX, B.u > C.u? B.u : C.u)
+	FLOAT_OP(FMIN, fmin(B.f, C.f))
+	FLOAT_OP(FMAX, fmax(B.f, C.f))
+	INT_OP(ABS, B.i < 0? 0 - B.u : B.u)
+	FLOAT_OP(FABS, fabs(B.f))
+	FLOAT_OP(MATH, math_function((MathFunc) instr.c, B.f))
+
+	CASE(JMP) JUMP(instr.sx); NEXT;
+	CASE(JT) if (A.i) JUMP(instr.sx); NEXT;
+	CASE(JF) if (!A.i) JUMP(instr.sx); NEXT;
+	JUMP_IF(JLT, A.i < B.i)
+	JUMP_IF(JLE, A.i <= B.i)
+	JUMP_IF(JGT, A.i > B.i)
+	JUMP_IF(JGE, A.i >= B.i)
+	JUMP_IF(JEQ, A.i == B.i)
+	JUMP_IF(JNE, A.i != B.i)
+	JUMP_IF(JFLT, A.f < B.f)
+	JUMP_IF(JFLE, A.f <= B.f)
+	JUMP_IF(JFGT, A.f > B.f)
+	JUMP_IF(JFGE, A.f >= B.f)
+
+	CASE(CALL) {
+		const Function* callee = &functions[instr.ux];
+		if (arrlen(vm->frames) == VM_MAX_DEPTH) {
+			runtime_error(vm, f, ip, "Stack overflow, calling '%s'", callee->name);
+			goto done;
+		}
+		Mark mark = vm->top;
+		Slot* frame = arena_take(vm, (int64_t) callee->n_registers + callee->n_memory);
+		if (!frame) goto out_of_memory;
+		memcpy(frame, &A, callee->n_params * sizeof(Slot));
+		arrlast(vm->frames).ip = ip;
+		arrput(vm->frames, ((Frame) { callee, NULL, frame, mark, instr.a }));
+		if (arrlen(vm->frames) > vm->max_depth) vm->max_depth = (int) arrlen(vm->frames);
+		f = callee;
+		ip = f->code;
+		r = frame;
+		k = f->constants;
+		m = r + f->n_registers;
+		if ((native = promote(vm, (int) instr.ux))) goto enter_native;
+		NEXT;
+	}
+	CASE(RET)
+		result = A;
+		goto ret;
+	CASE(RETV)
+		result.i = 0;
+		goto ret;
+
+	CASE(CHECK)
+		if ((uint64_t) A.i >= (uint64_t) B.i) {
+			runtime_error(vm, f, ip, "Index %" PRId64 " is out of bounds for length %" PRId64, A.i, B.i);
+			goto done;
+		}
+		NEXT;
+	CASE(CHECKI)
+		if ((uint64_t) A.i >= instr.ux) {
+			runtime_error(vm, f, ip, "Index %" PRId64 " is out of bounds for length %" PRIu32, A.i, instr.ux);
+			goto done;
+		}
+		NEXT;
+	CASE(CHECKSLICE)
+		if (A.i < 0 || B.i < A.i || B.i > C.i) {
+			runtime_error(vm, f, ip, "Slice %" PRId64 "..<%" PRId64 " is out of bounds for length %" PRId64, A.i, B.i, C.i);
+			goto done;
+		}
+		NEXT;
+
+	CASE(NEW)
+		A.p = calloc(instr.ux, sizeof(Slot));
+		if (!A.p) goto out_of_memory;
+		NEXT;
+	CASE(TNEW)
+		A.p = arena_take(vm, instr.ux);
+		if (!A.p) goto out_of_memory;
+		memset(A.p, 0, instr.ux * sizeof(Slot));
+		NEXT;
+	CASE(FREE) free(A.p); NEXT;
+	CASE(MARK)
+		A.i = vm->top.block;
+		r[instr.a + 1].i = vm->top.used;
+		NEXT;
+	CASE(RELEASE) vm->top = (Mark) { (int) A.i, r[instr.a + 1].i }; NEXT;
+
+	INT_OP(LEN, string_len(B))
+	CASE(PRINT) print_value(A, (PrintKind) instr.c); NEXT;
+	CASE(PRINTA)
+		fputc('[', stdout);
+		for (int64_t i = 0; i < B.i; i++) {
+			if (i) fputs(", ", stdout);
+			print_value(AT(A)[i], (PrintKind) instr.c);
+		}
+		fputc(']', stdout);
+		NEXT;
+	CASE(PRINTK) print_value(k[instr.ux], PRINT_STRING); NEXT;
+	CASE(FAIL) {
+		Slot message = instr.c? A : (Slot) { 0 };
+		const char* what = instr.b == FAILURE_ASSERT? "Assertion failed" : "Failed";
+		runtime_error(vm, f, ip, "%s%s%.*s", what, string_len(message)? ": " : "", (int) string_len(message), string_data(message));
+		goto done;
+	}
+
+#if !VM_THREADED
+		case OP_COUNT: break;
+	}
+#endif
+
+ret: {
+	Frame frame = arrpop(vm->frames);
+	vm->top = frame.mark;
+	if (!arrlen(vm->frames)) {
+		ok = true;
+		goto done;
+	}
+	Frame* caller = &arrlast(vm->frames);
+	f = caller->f;
+	ip = caller->ip;
+	r = caller->r;
+	k = f->constants;
+	m = r + f->n_registers;
+	r[frame.ret] = result;
+	if ((native = vm->native[f - functions])) goto enter_native;
+	NEXT;
+}
+
+// Until an instruction the machine code leaves to the VM, which is run next, in whichever
+// function it was in by then
+enter_native: {
+	int at = jit_enter(native, r, (int) (ip - f->code), &result);
+	vm->nested = 0;
+	if (at == JIT_RETURNED) goto ret;
+	f = arrlast(vm->frames).f;
+	ip = f->code + at;
+	r = arrlast(vm->frames).r;
+	k = f->constants;
+	m = r + f->n_registers;
+	NEXT;
+}
+
+division_by_zero:
+	runtime_error(vm, f, ip, "Division by zero");
+	goto done;
+out_of_memory:
+	runtime_error(vm, f, ip, "Out of memory");
+
+done:
+#undef CASE
+#undef NEXT
+#undef A
+#undef B
+#undef C
+#undef AT
+#undef INT_OP
+#undef FLOAT_OP
+#undef JUMP
+#undef JUMP_IF
+	while (arrlen(vm->frames)) (void) arrpop(vm->frames);
+	vm->top = base;
+	fflush(stdout);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	if (stats) {
+		stats->instructions = n;
+		stats->ms = (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6;
+		stats->result = result;
+		stats->max_depth = vm->max_depth;
+		stats->jit_functions = 0;
+		stats->jit_bytes = 0;
+		for (int i = 0; i < program_function_count(vm->program); i++) {
+			if (!vm->native[i]) continue;
+			stats->jit_functions++;
+			stats->jit_bytes += jit_code_size(vm->native[i]);
+		}
+	}
+	return ok;
+}
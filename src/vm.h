@@ -0,0 +1,42 @@
+#pragma once
+// The VM: runs a bytecode program (bytecode.h) with threaded dispatch, in frames of registers
+// and memory taken from an arena of its own. Functions that get hot are compiled to machine
+// code (jit.h) where the platform allows it.
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "bytecode.h"
+
+/// Slots in each of the arena's blocks; a frame bigger than that gets a block of its own
+#define VM_BLOCK_SLOTS ((int64_t) 1 << 20)
+/// Calls deep, before the VM stops with a stack overflow
+#define VM_MAX_DEPTH 100000
+/// Calls of a function, and jumps back in its loops, before it is compiled to machine code
+#define VM_JIT_THRESHOLD 1000
+/// Compiled functions calling each other directly, deep, before calls go through the VM, which
+/// takes them off the C stack
+#define VM_JIT_MAX_NESTING 10000
+
+typedef struct _vm* VM;
+
+typedef struct {
+	int64_t instructions;  // dispatched
+	double ms;
+	Slot result;           // of the function run, if it returns a value
+	int max_depth;         // of calls
+	int jit_functions;     // compiled to machine code, so far
+	size_t jit_bytes;      // of their machine code
+} VMStats;
+
+VM vm_create(Program program);
+void vm_destroy(VM vm);
+
+/// Calls and jumps back before a function is compiled to machine code; negative for never.
+/// The instructions run as machine code aren't counted in the stats.
+void vm_set_jit(VM vm, int threshold);
+
+/// Runs a function of the program that takes no arguments (main, or a test). Runtime errors
+/// (failures, assertions, subscripts out of bounds...) are printed to stderr with the line
+/// of the source, and stop it: returns false. `stats` may be NULL.
+bool vm_run(VM vm, int function, VMStats* stats);
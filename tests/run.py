@@ -0,0 +1,88 @@
+#!/usr/bin/env python3
+r"""Runs the compiler on the modules in tests/ and checks what it says about them.
+
+Usage: tests/run.py [COMPILER]
+Each module starts with lines of what to run it with and what should come of it:
+
+    \\ --check -> error: Unknown name 'z'
+    \\ --run -> ok
+
+'ok' is a run that exits with 0, and 'error: TEXT' one that doesn't, with TEXT in what it
+printed to stderr. The modules are run from the directory they are in, with --quiet unless
+--print is given, which asks for the AST to be printed.
+
+The modules in GENERATED are too large to keep, and are written out for the run.
+"""
+
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+EXPECT = re.compile(r'\\\\ (--[\w-]+(?: --[\w-]+)*) -> (ok|error: (.*))$')
+
+# Nested deeper than the C stack would take if the compiler recursed on them; the printed
+# AST is indented as deep as it nests, so that module is less deep
+DEEP = 100000
+DEEP_PRINTED = 20000
+
+GENERATED = {
+    'deep_expression.rh': '\\\\ --json -> ok\n\\\\ --check -> ok\n'
+        f'func main(): Int {{\n\tx := {"(" * DEEP}1{" + 1)" * DEEP}\n\treturn x\n}}\n',
+    'deep_printed.rh': '\\\\ --print -> ok\n'
+        f'func main(): Int {{\n\tx := {"(" * DEEP_PRINTED}1{" + 1)" * DEEP_PRINTED}\n\treturn x\n}}\n',
+    'deep_type.rh': '\\\\ --json -> ok\n\\\\ --check -> ok\n'
+        f'func main(): Int {{\n\tp: ?{"@" * DEEP}Int = null\n\treturn 0\n}}\n',
+    'deep_array.rh': '\\\\ --check -> ok\n'
+        f'func main(): Int {{\n\ta := {"[" * DEEP}1{"]" * DEEP}\n\treturn 0\n}}\n',
+}
+
+def run(compiler, path, flags, want_ok, message):
+    flags = flags.split()
+    quiet = [] if '--print' in flags else ['--quiet']
+    flags = [flag for flag in flags if flag != '--print']
+    proc = subprocess.run([compiler, *quiet, *flags, os.path.basename(path)],
+        cwd=os.path.dirname(path), stdout=subprocess.DEVNULL, stderr=subprocess.PIPE, text=True, timeout=120)
+    if want_ok and proc.returncode != 0:
+        return f'exited with {proc.returncode}:\n{proc.stderr[-2000:]}'
+    if not want_ok and proc.returncode == 0:
+        return 'succeeded'
+    if message and message not in proc.stderr:
+        return f'didn\'t say "{message}":\n{proc.stderr[-2000:]}'
+    return None
+
+def check(compiler, path):
+    """The number of runs of the module at `path`, and how those that failed did."""
+    with open(path) as f:
+        expectations = [EXPECT.match(line.rstrip('\n')) for line in f if line.startswith('\\\\ --')]
+    failures = []
+    for m in expectations:
+        if not m:
+            continue
+        failure = run(compiler, path, m.group(1), m.group(2) == 'ok', m.group(3))
+        if failure:
+            failures.append(f'FAIL {os.path.basename(path)} {m.group(1)}: {failure}')
+    return len([m for m in expectations if m]), failures
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    compiler = os.path.abspath(sys.argv[1] if len(sys.argv) > 1 else os.path.join(here, '..', 'compiler'))
+    n_run = n_failed = 0
+    with tempfile.TemporaryDirectory() as generated:
+        paths = [os.path.join(here, name) for name in sorted(os.listdir(here)) if name.endswith('.rh')]
+        for name, text in GENERATED.items():
+            paths.append(os.path.join(generated, name))
+            with open(paths[-1], 'w') as f:
+                f.write(text)
+        for path in paths:
+            n, failures = check(compiler, path)
+            n_run += n
+            n_failed += len(failures)
+            for failure in failures:
+                print(failure)
+    print(f'{n_run - n_failed} of {n_run} passed')
+    sys.exit(1 if n_failed else 0)
+
+if __name__ == '__main__':
+    main()